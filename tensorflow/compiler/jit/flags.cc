@@ -164,6 +164,8 @@ void AllocateAndParseFlags() {
   ops_flags = new XlaOpsCommonFlags;
   ops_flags->tf_xla_always_defer_compilation = false;
   ops_flags->tf_xla_async_compilation = false;
+  ops_flags->tf_xla_persistent_cache_directory = "";
+  ops_flags->tf_xla_persistent_cache_size_limit_mb = 1024;
 
   jitter_flags = new IntroduceFloatingPointJitterPassFlags;
   jitter_flags->jitter_amount = 1e-5;
@@ -222,6 +224,15 @@ void AllocateAndParseFlags() {
             "When lazy compilation is enabled, asynchronous compilation starts "
             "the cluster compilation in the background, and the fallback path "
             "is executed until the compilation has finished."),
+       Flag("tf_xla_persistent_cache_directory",
+            &ops_flags->tf_xla_persistent_cache_directory,
+            "If non-empty, the compiled HLO of each XLA cluster is stored in "
+            "this directory and reused by later processes with the same "
+            "cluster signature and compiler flags."),
+       Flag("tf_xla_persistent_cache_size_limit_mb",
+            &ops_flags->tf_xla_persistent_cache_size_limit_mb,
+            "Maximum size of the persistent XLA compilation cache in "
+            "megabytes. Least recently used entries are evicted first."),
 
        Flag("tf_introduce_floating_point_jitter_to_tensors",
             setter_for_jitter_tensor_names, "",
@@ -102,6 +102,13 @@ struct XlaOpsCommonFlags {
   // If true, _XlaCompile compiles the cluster asynchronously with respect to
   // the main execution. The fallback path is taken while compilation happens.
   bool tf_xla_async_compilation;
+  // If non-empty, the XLA compilation cache persists the results of lowering
+  // clusters to HLO in this directory and reuses them across processes.
+  string tf_xla_persistent_cache_directory;
+  // Upper bound on the total size of the persistent compilation cache
+  // directory, in megabytes. Least recently used entries are evicted once it
+  // is exceeded.
+  int64_t tf_xla_persistent_cache_size_limit_mb;
 };
 
 // Flags for the build_xla_ops pass.
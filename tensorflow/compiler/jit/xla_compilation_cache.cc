@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "tensorflow/compiler/jit/xla_compilation_cache.h"
 
+#include <algorithm>
+#include <cstdlib>
 #include <numeric>
 
 #include "tensorflow/compiler/mlir/mlir_bridge_rollout_policy.h"
@@ -43,8 +45,10 @@ limitations under the License.
 #include "tensorflow/core/graph/algorithm.h"
 #include "tensorflow/core/graph/node_builder.h"
 #include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/fingerprint.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/protobuf/graph_debug_info.pb.h"
 #include "tensorflow/core/public/version.h"
@@ -59,9 +63,27 @@ constexpr int64_t
 constexpr int64_t
     XlaCompilationCache::AsyncCompilationState::kMaxNumOngoingCompilations;
 
+namespace {
+
+// Returns the persistent cache to use for `device_type`. Only the CPU and GPU
+// JIT devices are supported, since other devices may lower clusters using
+// state that is not captured by the persistent cache key.
+XlaPersistentCompilationCache* PersistentCacheForDevice(
+    const DeviceType& device_type) {
+  if (device_type != DeviceType(DEVICE_CPU_XLA_JIT) &&
+      device_type != DeviceType(DEVICE_GPU_XLA_JIT)) {
+    return nullptr;
+  }
+  return XlaPersistentCompilationCache::Global();
+}
+
+}  // namespace
+
 XlaCompilationCache::XlaCompilationCache(xla::LocalClient* client,
                                          DeviceType device_type)
-    : client_(client), device_type_(std::move(device_type)) {}
+    : client_(client),
+      device_type_(std::move(device_type)),
+      persistent_cache_(PersistentCacheForDevice(device_type_)) {}
 
 XlaCompilationCache::~XlaCompilationCache() {
   // Ensure any use of our programs have completed by waiting for all stream
@@ -164,6 +186,70 @@ StatusOr<XlaCompilationCache::Signature> XlaCompilationCache::BuildSignature(
   return std::move(signature);
 }
 
+StatusOr<XlaPersistentCacheKey> XlaCompilationCache::BuildPersistentCacheKey(
+    const XlaCompiler::CompileOptions& compile_options,
+    const XlaCompiler::Options& options, const NameAttrList& function,
+    absl::Span<const XlaCompiler::Argument> args, CompileScope scope) {
+  TF_ASSIGN_OR_RETURN(Signature signature, BuildSignature(function, args));
+
+  // Signature::Hash is not stable across processes, so fingerprint the
+  // signature again here.
+  uint64 fingerprint = Fingerprint64(signature.name);
+  for (const auto& arg : signature.arg_shapes) {
+    fingerprint = FingerprintCat64(fingerprint, arg.first);
+    fingerprint = FingerprintCat64(fingerprint, arg.second.size());
+    for (int dim : arg.second) {
+      fingerprint = FingerprintCat64(fingerprint, dim);
+    }
+  }
+  for (const Tensor& value : signature.arg_values) {
+    fingerprint = FingerprintCat64(fingerprint, value.dtype());
+    fingerprint = FingerprintCat64(fingerprint, value.dims());
+    for (int64_t dim : value.shape().dim_sizes()) {
+      fingerprint = FingerprintCat64(fingerprint, dim);
+    }
+    fingerprint =
+        FingerprintCat64(fingerprint, Fingerprint64(value.tensor_data()));
+  }
+  // The function name alone does not identify a function across processes, so
+  // include the definitions of everything the cluster may call.
+  const FunctionDef* fdef =
+      options.flib_def ? options.flib_def->Find(function.name()) : nullptr;
+  if (fdef != nullptr) {
+    FunctionLibraryDefinition reachable =
+        options.flib_def->ReachableDefinitions(*fdef);
+    std::vector<string> names = reachable.ListFunctionNames();
+    std::sort(names.begin(), names.end());
+    fingerprint =
+        FingerprintCat64(fingerprint, DeterministicProtoHash64(*fdef));
+    for (const string& name : names) {
+      fingerprint = FingerprintCat64(
+          fingerprint, DeterministicProtoHash64(*reachable.Find(name)));
+    }
+  }
+
+  uint64 config_fingerprint = Fingerprint64(absl::StrCat(
+      static_cast<int>(scope), compile_options.use_tuple_arg,
+      compile_options.return_updated_values_for_all_resources,
+      compile_options.always_return_tuple, compile_options.is_entry_computation,
+      compile_options.add_token_input_output,
+      compile_options.alias_resource_update, options.graph_def_version,
+      options.allow_cpu_custom_calls, options.custom_fake_quant_op_calls,
+      options.alias_passthrough_params));
+  for (const char* flags_env_var : {"TF_XLA_FLAGS", "XLA_FLAGS"}) {
+    const char* flags = std::getenv(flags_env_var);
+    config_fingerprint = FingerprintCat64(
+        config_fingerprint, Fingerprint64(flags != nullptr ? flags : ""));
+  }
+
+  XlaPersistentCacheKey key;
+  key.set_signature_fingerprint(fingerprint);
+  key.set_config_fingerprint(config_fingerprint);
+  key.set_device_type(options.device_type.type_string());
+  key.set_tf_version(absl::StrCat(TF_VERSION_STRING, "-", tf_git_version()));
+  return key;
+}
+
 Status XlaCompilationCache::BuildExecutable(
     const XlaCompiler::Options& options,
     const XlaCompiler::CompilationResult& result,
@@ -362,10 +448,33 @@ Status XlaCompilationCache::CompileStrict(
   tensorflow::Env* env = tensorflow::Env::Default();
   const uint64 compile_start_us = env->NowMicros();
 
+  // Clusters whose lowering depends on a resource manager populated by the
+  // caller can't be reproduced from the persistent cache key.
+  absl::optional<XlaPersistentCacheKey> persistent_key;
+  bool persistent_cache_hit = false;
+  if (persistent_cache_ != nullptr &&
+      options.populate_resource_manager == nullptr) {
+    TF_ASSIGN_OR_RETURN(persistent_key,
+                        BuildPersistentCacheKey(compile_options, options,
+                                                function, args, scope));
+    StatusOr<bool> lookup = persistent_cache_->Lookup(
+        *persistent_key, &entry->compilation_result);
+    if (lookup.ok()) {
+      persistent_cache_hit = lookup.ValueOrDie();
+    } else {
+      LOG(WARNING) << "Persistent XLA compilation cache lookup failed: "
+                   << lookup.status();
+    }
+  }
+
   XlaCompiler compiler(options);
   entry->compile_state = CompileState::kCompiled;
   entry->compilation_status = [&] {
-    if (scope == CompileScope::kOp) {
+    if (persistent_cache_hit) {
+      VLOG(2) << "Loaded " << function.name()
+              << " from the persistent compilation cache";
+      return Status::OK();
+    } else if (scope == CompileScope::kOp) {
       return XlaSingleOpToHlo(&compiler, options, args, ctx, compile_options,
                               &entry->compilation_result);
 
@@ -376,6 +485,14 @@ Status XlaCompilationCache::CompileStrict(
     }
   }();
   TF_RETURN_IF_ERROR(entry->compilation_status);
+  if (persistent_key && !persistent_cache_hit) {
+    Status s = persistent_cache_->Insert(*persistent_key,
+                                         entry->compilation_result);
+    if (!s.ok()) {
+      LOG(WARNING) << "Failed to persist XLA compilation of "
+                   << function.name() << ": " << s;
+    }
+  }
   TF_RET_CHECK(entry->executable.get() == nullptr);
   entry->compilation_status =
       BuildExecutable(options, entry->compilation_result, &entry->executable);
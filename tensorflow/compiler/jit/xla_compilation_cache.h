@@ -20,6 +20,7 @@ limitations under the License.
 #include "absl/container/inlined_vector.h"
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
+#include "tensorflow/compiler/jit/xla_persistent_compilation_cache.h"
 #include "tensorflow/compiler/tf2xla/xla_compiler.h"
 #include "tensorflow/compiler/tf2xla/xla_context.h"
 #include "tensorflow/compiler/xla/client/local_client.h"
@@ -136,6 +137,15 @@ class XlaCompilationCache : public ResourceBase {
       const NameAttrList& function,
       absl::Span<const XlaCompiler::Argument> args);
 
+  // Builds the key of the persistent compilation cache entry for a
+  // compilation. Unlike the signature, the key covers the definitions of all
+  // functions reachable from `function` as well as the compile options, since
+  // it must stay valid across processes.
+  static StatusOr<XlaPersistentCacheKey> BuildPersistentCacheKey(
+      const XlaCompiler::CompileOptions& compile_options,
+      const XlaCompiler::Options& options, const NameAttrList& function,
+      absl::Span<const XlaCompiler::Argument> args, CompileScope scope);
+
  private:
   // Common implementation of Compile and CompileSingleOp. The `OpKernelContext`
   // parameter is always null for the former.
@@ -162,6 +172,9 @@ class XlaCompilationCache : public ResourceBase {
   xla::LocalClient* const client_;
   const DeviceType device_type_;
 
+  // Cache shared with other processes, or nullptr if disabled.
+  XlaPersistentCompilationCache* const persistent_cache_;
+
   // The value associated with a cache entry.
   struct Entry {
     mutex mu;
@@ -18,6 +18,7 @@ limitations under the License.
 #include "tensorflow/compiler/jit/flags.h"
 #include "tensorflow/compiler/tf2xla/shape_util.h"
 #include "tensorflow/compiler/xla/client/client_library.h"
+#include "tensorflow/core/framework/function_testlib.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
 
@@ -78,6 +79,57 @@ TEST(XlaCompilationCacheTest, TestDisabledXlaCompilation) {
       absl::StrContains(status.error_message(), "XLA compilation disabled"));
 }
 
+TEST(XlaCompilationCacheTest, PersistentCacheKey) {
+  NameAttrList fn;
+  fn.set_name("XTimesTwo");
+  (*fn.mutable_attr())["T"].set_type(DT_FLOAT);
+  std::vector<XlaCompiler::Argument> args(1);
+  args[0].kind = XlaCompiler::Argument::kParameter;
+  args[0].type = DT_FLOAT;
+  args[0].shape = TensorShape({4});
+
+  FunctionDefLibrary library;
+  *library.add_function() = test::function::XTimesTwo();
+  FunctionLibraryDefinition flib_def(OpRegistry::Global(), library);
+  XlaCompiler::Options options;
+  options.device_type = DeviceType(DEVICE_CPU_XLA_JIT);
+  options.flib_def = &flib_def;
+  XlaCompiler::CompileOptions compile_options;
+  auto build_key = [&]() {
+    return XlaCompilationCache::BuildPersistentCacheKey(
+               compile_options, options, fn, args,
+               XlaCompilationCache::CompileScope::kFunction)
+        .ValueOrDie();
+  };
+
+  XlaPersistentCacheKey key = build_key();
+  EXPECT_EQ(key.device_type(), DEVICE_CPU_XLA_JIT);
+  // Keys are deterministic.
+  EXPECT_EQ(key.SerializeAsString(), build_key().SerializeAsString());
+
+  // Changing the arguments changes the signature.
+  args[0].shape = TensorShape({8});
+  EXPECT_NE(key.signature_fingerprint(), build_key().signature_fingerprint());
+  args[0].shape = TensorShape({4});
+
+  // So does redefining the function under the same name.
+  FunctionDefLibrary other_library;
+  *other_library.add_function() = test::function::XTimesTwo();
+  other_library.mutable_function(0)->mutable_node_def(2)->set_op("Add");
+  FunctionLibraryDefinition other_flib_def(OpRegistry::Global(),
+                                           other_library);
+  options.flib_def = &other_flib_def;
+  EXPECT_NE(key.signature_fingerprint(), build_key().signature_fingerprint());
+  options.flib_def = &flib_def;
+
+  // Compile options only change the configuration.
+  compile_options.always_return_tuple = false;
+  XlaPersistentCacheKey other_options_key = build_key();
+  EXPECT_EQ(key.signature_fingerprint(),
+            other_options_key.signature_fingerprint());
+  EXPECT_NE(key.config_fingerprint(), other_options_key.config_fingerprint());
+}
+
 void BM_BuildSignature(::testing::benchmark::State& state) {
   const int n_args = state.range(0);
 
@@ -0,0 +1,332 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/jit/xla_persistent_compilation_cache.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/compiler/jit/flags.h"
+#include "tensorflow/compiler/xla/client/xla_computation.h"
+#include "tensorflow/core/framework/metrics.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/random.h"
+
+namespace tensorflow {
+namespace {
+
+constexpr char kEntrySuffix[] = ".xla_cache";
+
+constexpr char kLookupHit[] = "hit";
+constexpr char kLookupMiss[] = "miss";
+constexpr char kLookupInvalid[] = "invalid";
+
+Status ValidateEntry(const XlaPersistentCacheKey& key,
+                     const XlaPersistentCacheEntry& entry) {
+  const XlaPersistentCacheKey& entry_key = entry.key();
+  if (entry_key.signature_fingerprint() != key.signature_fingerprint() ||
+      entry_key.config_fingerprint() != key.config_fingerprint() ||
+      entry_key.device_type() != key.device_type() ||
+      entry_key.tf_version() != key.tf_version()) {
+    return errors::DataLoss("Key mismatch: expected ", key.ShortDebugString(),
+                            ", found ", entry_key.ShortDebugString());
+  }
+  const uint64 hlo_fingerprint =
+      DeterministicProtoHash64(entry.result().computation());
+  if (hlo_fingerprint != entry.hlo_fingerprint()) {
+    return errors::DataLoss("HLO fingerprint mismatch: expected ",
+                            entry.hlo_fingerprint(), ", found ",
+                            hlo_fingerprint);
+  }
+  return Status::OK();
+}
+
+}  // namespace
+
+Status SerializeCompilationResult(const XlaCompilationResult& result,
+                                  XlaSerializedCompilationResult* proto) {
+  if (result.computation == nullptr) {
+    return errors::InvalidArgument(
+        "Cannot serialize a compilation result without a computation");
+  }
+  proto->Clear();
+  for (int index : result.input_mapping) {
+    proto->add_input_mapping(index);
+  }
+  for (const xla::Shape& shape : result.xla_input_shapes) {
+    *proto->add_xla_input_shapes() = shape.ToProto();
+  }
+  *proto->mutable_xla_output_shape() = result.xla_output_shape.ToProto();
+  for (const XlaOutputDescription& output : result.outputs) {
+    auto* output_proto = proto->add_outputs();
+    output_proto->set_type(output.type);
+    output.shape.AsProto(output_proto->mutable_shape());
+    if (output.is_constant) {
+      output.constant_value.AsProtoTensorContent(
+          output_proto->mutable_constant_value());
+    }
+    output_proto->set_input_index(output.input_index);
+    output_proto->set_is_tensor_list(output.is_tensor_list);
+  }
+  *proto->mutable_host_compute_metadata() = result.host_compute_metadata;
+  for (const XlaResourceUpdate& update : result.resource_updates) {
+    auto* update_proto = proto->add_resource_updates();
+    update_proto->set_input_index(update.input_index);
+    update_proto->set_type(update.type);
+    update.shape.AsProto(update_proto->mutable_shape());
+    update_proto->set_modified(update.modified);
+    for (const string& gradient : update.tensor_array_gradients_accessed) {
+      update_proto->add_tensor_array_gradients_accessed(gradient);
+    }
+  }
+  *proto->mutable_computation() = result.computation->proto();
+  if (result.collective_reduce_info) {
+    auto* info = proto->mutable_collective_reduce_info();
+    info->set_group_key(result.collective_reduce_info->group_key);
+    info->set_group_size(result.collective_reduce_info->group_size);
+  }
+  return Status::OK();
+}
+
+Status DeserializeCompilationResult(const XlaSerializedCompilationResult& proto,
+                                    XlaCompilationResult* result) {
+  *result = XlaCompilationResult();
+  result->input_mapping.assign(proto.input_mapping().begin(),
+                               proto.input_mapping().end());
+  for (const xla::ShapeProto& shape : proto.xla_input_shapes()) {
+    result->xla_input_shapes.emplace_back(shape);
+  }
+  result->xla_output_shape = xla::Shape(proto.xla_output_shape());
+  for (const auto& output_proto : proto.outputs()) {
+    XlaOutputDescription output;
+    output.type = output_proto.type();
+    TF_RETURN_IF_ERROR(TensorShape::IsValidShape(output_proto.shape()));
+    output.shape = TensorShape(output_proto.shape());
+    output.is_constant = output_proto.has_constant_value();
+    if (output.is_constant &&
+        !output.constant_value.FromProto(output_proto.constant_value())) {
+      return errors::DataLoss("Invalid constant value for output ",
+                              result->outputs.size());
+    }
+    output.input_index = output_proto.input_index();
+    output.is_tensor_list = output_proto.is_tensor_list();
+    result->outputs.push_back(std::move(output));
+  }
+  result->host_compute_metadata = proto.host_compute_metadata();
+  for (const auto& update_proto : proto.resource_updates()) {
+    XlaResourceUpdate update;
+    update.input_index = update_proto.input_index();
+    update.type = update_proto.type();
+    TF_RETURN_IF_ERROR(TensorShape::IsValidShape(update_proto.shape()));
+    update.shape = TensorShape(update_proto.shape());
+    update.modified = update_proto.modified();
+    update.tensor_array_gradients_accessed.insert(
+        update_proto.tensor_array_gradients_accessed().begin(),
+        update_proto.tensor_array_gradients_accessed().end());
+    result->resource_updates.push_back(std::move(update));
+  }
+  result->computation =
+      std::make_shared<xla::XlaComputation>(proto.computation());
+  if (proto.has_collective_reduce_info()) {
+    result->collective_reduce_info =
+        XlaCompilationResult::CollectiveReduceV2OpInfo{
+            proto.collective_reduce_info().group_key(),
+            proto.collective_reduce_info().group_size()};
+  }
+  return Status::OK();
+}
+
+XlaPersistentCompilationCache::XlaPersistentCompilationCache(
+    std::string directory, int64_t max_size_in_bytes, Env* env)
+    : directory_(std::move(directory)),
+      max_size_in_bytes_(max_size_in_bytes),
+      env_(env) {}
+
+XlaPersistentCompilationCache* XlaPersistentCompilationCache::Global() {
+  static XlaPersistentCompilationCache* cache = []() {
+    const XlaOpsCommonFlags& flags = GetXlaOpsCommonFlags();
+    if (flags.tf_xla_persistent_cache_directory.empty()) {
+      return static_cast<XlaPersistentCompilationCache*>(nullptr);
+    }
+    VLOG(1) << "Using persistent XLA compilation cache in "
+            << flags.tf_xla_persistent_cache_directory;
+    return new XlaPersistentCompilationCache(
+        flags.tf_xla_persistent_cache_directory,
+        flags.tf_xla_persistent_cache_size_limit_mb * 1024 * 1024);
+  }();
+  return cache;
+}
+
+std::string XlaPersistentCompilationCache::Filename(
+    const XlaPersistentCacheKey& key) const {
+  return absl::StrCat(absl::Hex(DeterministicProtoHash64(key), absl::kZeroPad16),
+                      kEntrySuffix);
+}
+
+Status XlaPersistentCompilationCache::InitializeLocked() {
+  if (initialized_) return Status::OK();
+  TF_RETURN_IF_ERROR(env_->RecursivelyCreateDir(directory_));
+  std::vector<string> children;
+  TF_RETURN_IF_ERROR(env_->GetChildren(directory_, &children));
+  std::vector<std::pair<int64_t, std::string>> entries_by_mtime;
+  for (const string& child : children) {
+    if (!absl::EndsWith(child, kEntrySuffix)) continue;
+    FileStatistics stat;
+    if (!env_->Stat(io::JoinPath(directory_, child), &stat).ok()) continue;
+    entries_by_mtime.emplace_back(stat.mtime_nsec, child);
+    files_[child].size = stat.length;
+  }
+  std::sort(entries_by_mtime.begin(), entries_by_mtime.end());
+  for (const auto& entry : entries_by_mtime) {
+    FileInfo& info = files_[entry.second];
+    info.lru_position = lru_.insert(lru_.end(), entry.second);
+    size_in_bytes_ += info.size;
+  }
+  initialized_ = true;
+  EvictLocked();
+  return Status::OK();
+}
+
+void XlaPersistentCompilationCache::TouchLocked(const std::string& filename,
+                                                int64_t size) {
+  auto it = files_.find(filename);
+  if (it == files_.end()) {
+    FileInfo& info = files_[filename];
+    info.size = size;
+    info.lru_position = lru_.insert(lru_.end(), filename);
+    size_in_bytes_ += size;
+    return;
+  }
+  size_in_bytes_ += size - it->second.size;
+  it->second.size = size;
+  lru_.splice(lru_.end(), lru_, it->second.lru_position);
+}
+
+void XlaPersistentCompilationCache::RemoveLocked(const std::string& filename) {
+  Status s = env_->DeleteFile(io::JoinPath(directory_, filename));
+  if (!s.ok() && !errors::IsNotFound(s)) {
+    LOG(WARNING) << "Failed to delete persistent XLA compilation cache entry "
+                 << filename << ": " << s;
+  }
+  auto it = files_.find(filename);
+  if (it == files_.end()) return;
+  size_in_bytes_ -= it->second.size;
+  lru_.erase(it->second.lru_position);
+  files_.erase(it);
+}
+
+void XlaPersistentCompilationCache::EvictLocked() {
+  while (size_in_bytes_ > max_size_in_bytes_ && !lru_.empty()) {
+    VLOG(2) << "Evicting persistent XLA compilation cache entry "
+            << lru_.front();
+    RemoveLocked(lru_.front());
+  }
+}
+
+StatusOr<bool> XlaPersistentCompilationCache::Lookup(
+    const XlaPersistentCacheKey& key, XlaCompilationResult* result) {
+  const std::string filename = Filename(key);
+  {
+    mutex_lock l(mu_);
+    TF_RETURN_IF_ERROR(InitializeLocked());
+    if (!files_.contains(filename)) {
+      // The entry may have been written by another process sharing the
+      // directory since we listed it.
+      if (!env_->FileExists(io::JoinPath(directory_, filename)).ok()) {
+        metrics::RecordXlaPersistentCacheLookup(kLookupMiss);
+        return false;
+      }
+    }
+  }
+
+  // Read and validate the entry outside of the lock; this is the expensive
+  // part of a lookup.
+  XlaPersistentCacheEntry entry;
+  XlaCompilationResult loaded;
+  Status s = ReadBinaryProto(env_, io::JoinPath(directory_, filename), &entry);
+  if (s.ok()) s = ValidateEntry(key, entry);
+  if (s.ok()) s = DeserializeCompilationResult(entry.result(), &loaded);
+
+  mutex_lock l(mu_);
+  if (!s.ok()) {
+    LOG(WARNING) << "Discarding invalid persistent XLA compilation cache entry "
+                 << filename << ": " << s;
+    RemoveLocked(filename);
+    metrics::RecordXlaPersistentCacheLookup(kLookupInvalid);
+    return false;
+  }
+  *result = std::move(loaded);
+  TouchLocked(filename, entry.ByteSizeLong());
+  metrics::RecordXlaPersistentCacheLookup(kLookupHit);
+  return true;
+}
+
+Status XlaPersistentCompilationCache::Insert(
+    const XlaPersistentCacheKey& key, const XlaCompilationResult& result) {
+  XlaPersistentCacheEntry entry;
+  *entry.mutable_key() = key;
+  TF_RETURN_IF_ERROR(
+      SerializeCompilationResult(result, entry.mutable_result()));
+  entry.set_hlo_fingerprint(
+      DeterministicProtoHash64(entry.result().computation()));
+  std::string serialized;
+  if (!SerializeToStringDeterministic(entry, &serialized)) {
+    return errors::Internal("Failed to serialize XLA compilation cache entry");
+  }
+  if (serialized.size() > max_size_in_bytes_) {
+    VLOG(2) << "Not persisting XLA compilation cache entry of "
+            << serialized.size() << " bytes: exceeds the cache size limit of "
+            << max_size_in_bytes_ << " bytes";
+    return Status::OK();
+  }
+
+  // Write to a temporary file first so that concurrent readers, possibly in
+  // other processes, never observe a partially written entry.
+  const std::string filename = Filename(key);
+  const std::string path = io::JoinPath(directory_, filename);
+  {
+    mutex_lock l(mu_);
+    TF_RETURN_IF_ERROR(InitializeLocked());
+  }
+  const std::string temp_path =
+      absl::StrCat(path, ".tmp", absl::Hex(random::New64()));
+  Status s = WriteStringToFile(env_, temp_path, serialized);
+  if (s.ok()) s = env_->RenameFile(temp_path, path);
+  if (!s.ok()) {
+    // Do not leave a partially written temporary file behind; it would never
+    // be picked up (or evicted) as a cache entry.
+    env_->DeleteFile(temp_path).IgnoreError();
+    return s;
+  }
+
+  mutex_lock l(mu_);
+  TouchLocked(filename, serialized.size());
+  EvictLocked();
+  return Status::OK();
+}
+
+int64_t XlaPersistentCompilationCache::size_in_bytes() {
+  mutex_lock l(mu_);
+  return size_in_bytes_;
+}
+
+}  // namespace tensorflow
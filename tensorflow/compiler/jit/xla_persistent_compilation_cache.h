@@ -0,0 +1,118 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_COMPILER_JIT_XLA_PERSISTENT_COMPILATION_CACHE_H_
+#define TENSORFLOW_COMPILER_JIT_XLA_PERSISTENT_COMPILATION_CACHE_H_
+
+#include <list>
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/compiler/jit/xla_persistent_compilation_cache.pb.h"
+#include "tensorflow/compiler/tf2xla/xla_helpers.h"
+#include "tensorflow/compiler/xla/statusor.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+
+// Converts between an XlaCompilationResult and its serialized form.
+Status SerializeCompilationResult(const XlaCompilationResult& result,
+                                  XlaSerializedCompilationResult* proto);
+Status DeserializeCompilationResult(const XlaSerializedCompilationResult& proto,
+                                    XlaCompilationResult* result);
+
+// A directory of XLA compilation results that outlives the process.
+//
+// Each entry is stored in its own file, named after the fingerprint of its
+// key. Entries record their full key and a fingerprint of their HLO, both of
+// which are validated on load; entries that fail validation are deleted and
+// reported as misses. The cache keeps the total size of its entries below
+// `max_size_in_bytes` by evicting the least recently used ones. Recency is
+// tracked in memory and seeded from file modification times, so it is only
+// approximate across processes sharing the directory.
+//
+// The cache stores the output of lowering a cluster to HLO, not the final
+// executable: XLA has no way to reload a serialized LocalExecutable, so a hit
+// saves the TF-to-HLO bridge but still runs the XLA backend.
+//
+// Thread-safe.
+class XlaPersistentCompilationCache {
+ public:
+  XlaPersistentCompilationCache(std::string directory,
+                                int64_t max_size_in_bytes,
+                                Env* env = Env::Default());
+
+  XlaPersistentCompilationCache(const XlaPersistentCompilationCache&) = delete;
+  XlaPersistentCompilationCache& operator=(
+      const XlaPersistentCompilationCache&) = delete;
+
+  // Returns the process-wide cache configured by the
+  // `tf_xla_persistent_cache_directory` flag, or nullptr if it is unset.
+  static XlaPersistentCompilationCache* Global();
+
+  // Looks up `key`. Returns true and populates `result` on a hit.
+  StatusOr<bool> Lookup(const XlaPersistentCacheKey& key,
+                        XlaCompilationResult* result);
+
+  // Stores `result` under `key`, replacing any existing entry, and evicts
+  // least recently used entries until the cache fits in its size limit.
+  Status Insert(const XlaPersistentCacheKey& key,
+                const XlaCompilationResult& result);
+
+  // Returns the total size of the entries currently in the cache.
+  int64_t size_in_bytes();
+
+  const std::string& directory() const { return directory_; }
+
+ private:
+  // Populates `lru_` from the directory contents on first use.
+  Status InitializeLocked() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Marks `filename` as the most recently used entry.
+  void TouchLocked(const std::string& filename, int64_t size)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Deletes `filename` and forgets about it.
+  void RemoveLocked(const std::string& filename)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Evicts entries, least recently used first, until the cache fits.
+  void EvictLocked() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  std::string Filename(const XlaPersistentCacheKey& key) const;
+
+  const std::string directory_;
+  const int64_t max_size_in_bytes_;
+  Env* const env_;
+
+  struct FileInfo {
+    int64_t size;
+    std::list<std::string>::iterator lru_position;
+  };
+
+  mutex mu_;
+  bool initialized_ TF_GUARDED_BY(mu_) = false;
+  int64_t size_in_bytes_ TF_GUARDED_BY(mu_) = 0;
+  // Entry filenames, least recently used first.
+  std::list<std::string> lru_ TF_GUARDED_BY(mu_);
+  absl::flat_hash_map<std::string, FileInfo> files_ TF_GUARDED_BY(mu_);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_COMPILER_JIT_XLA_PERSISTENT_COMPILATION_CACHE_H_
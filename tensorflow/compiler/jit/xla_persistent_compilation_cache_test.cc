@@ -0,0 +1,215 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/compiler/jit/xla_persistent_compilation_cache.h"
+
+#include <vector>
+
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+XlaCompilationResult MakeCompilationResult(float constant) {
+  xla::XlaBuilder builder("computation");
+  xla::Shape shape = xla::ShapeUtil::MakeShape(xla::F32, {2});
+  xla::Add(xla::Parameter(&builder, 0, shape, "x"),
+           xla::ConstantR1<float>(&builder, {constant, constant}));
+
+  XlaCompilationResult result;
+  result.input_mapping = {1};
+  result.xla_input_shapes = {shape};
+  result.xla_output_shape = xla::ShapeUtil::MakeTupleShape({shape});
+  result.outputs.resize(2);
+  result.outputs[0].type = DT_FLOAT;
+  result.outputs[0].shape = TensorShape({2});
+  result.outputs[1].type = DT_INT32;
+  result.outputs[1].shape = TensorShape({});
+  result.outputs[1].is_constant = true;
+  result.outputs[1].constant_value = test::AsScalar<int32>(7);
+  result.resource_updates.resize(1);
+  result.resource_updates[0].input_index = 0;
+  result.resource_updates[0].type = DT_FLOAT;
+  result.resource_updates[0].shape = TensorShape({2});
+  result.resource_updates[0].modified = true;
+  result.resource_updates[0].tensor_array_gradients_accessed = {"grad"};
+  result.collective_reduce_info =
+      XlaCompilationResult::CollectiveReduceV2OpInfo{3, 4};
+  result.computation =
+      std::make_shared<xla::XlaComputation>(builder.Build().ValueOrDie());
+  return result;
+}
+
+XlaPersistentCacheKey MakeKey(uint64 signature_fingerprint) {
+  XlaPersistentCacheKey key;
+  key.set_signature_fingerprint(signature_fingerprint);
+  key.set_config_fingerprint(42);
+  key.set_device_type("XLA_CPU_JIT");
+  key.set_tf_version("test");
+  return key;
+}
+
+void ExpectResultsEqual(const XlaCompilationResult& expected,
+                        const XlaCompilationResult& actual) {
+  EXPECT_EQ(expected.input_mapping, actual.input_mapping);
+  ASSERT_EQ(expected.xla_input_shapes.size(), actual.xla_input_shapes.size());
+  for (int i = 0; i < expected.xla_input_shapes.size(); ++i) {
+    EXPECT_TRUE(xla::ShapeUtil::Equal(expected.xla_input_shapes[i],
+                                      actual.xla_input_shapes[i]));
+  }
+  EXPECT_TRUE(
+      xla::ShapeUtil::Equal(expected.xla_output_shape, actual.xla_output_shape));
+  ASSERT_EQ(expected.outputs.size(), actual.outputs.size());
+  for (int i = 0; i < expected.outputs.size(); ++i) {
+    EXPECT_EQ(expected.outputs[i].type, actual.outputs[i].type);
+    EXPECT_EQ(expected.outputs[i].shape, actual.outputs[i].shape);
+    EXPECT_EQ(expected.outputs[i].is_constant, actual.outputs[i].is_constant);
+    if (expected.outputs[i].is_constant) {
+      test::ExpectTensorEqual<int32>(expected.outputs[i].constant_value,
+                                     actual.outputs[i].constant_value);
+    }
+  }
+  ASSERT_EQ(expected.resource_updates.size(), actual.resource_updates.size());
+  for (int i = 0; i < expected.resource_updates.size(); ++i) {
+    EXPECT_EQ(expected.resource_updates[i].input_index,
+              actual.resource_updates[i].input_index);
+    EXPECT_EQ(expected.resource_updates[i].shape,
+              actual.resource_updates[i].shape);
+    EXPECT_EQ(expected.resource_updates[i].modified,
+              actual.resource_updates[i].modified);
+    EXPECT_EQ(expected.resource_updates[i].tensor_array_gradients_accessed,
+              actual.resource_updates[i].tensor_array_gradients_accessed);
+  }
+  ASSERT_TRUE(actual.collective_reduce_info.has_value());
+  EXPECT_EQ(expected.collective_reduce_info->group_key,
+            actual.collective_reduce_info->group_key);
+  EXPECT_EQ(expected.collective_reduce_info->group_size,
+            actual.collective_reduce_info->group_size);
+  EXPECT_EQ(expected.computation->proto().SerializeAsString(),
+            actual.computation->proto().SerializeAsString());
+}
+
+string TestDirectory(const string& name) {
+  string directory = io::JoinPath(testing::TmpDir(), name);
+  int64_t undeleted_files, undeleted_dirs;
+  Env::Default()
+      ->DeleteRecursively(directory, &undeleted_files, &undeleted_dirs)
+      .IgnoreError();
+  return directory;
+}
+
+TEST(XlaPersistentCompilationCacheTest, SerializationRoundTrip) {
+  XlaCompilationResult result = MakeCompilationResult(1.0f);
+  XlaSerializedCompilationResult proto;
+  TF_ASSERT_OK(SerializeCompilationResult(result, &proto));
+  XlaCompilationResult deserialized;
+  TF_ASSERT_OK(DeserializeCompilationResult(proto, &deserialized));
+  ExpectResultsEqual(result, deserialized);
+}
+
+TEST(XlaPersistentCompilationCacheTest, HitAndMiss) {
+  const string directory = TestDirectory("hit_and_miss");
+  XlaCompilationResult result = MakeCompilationResult(1.0f);
+  {
+    XlaPersistentCompilationCache cache(directory, 1 << 20);
+    XlaCompilationResult loaded;
+    TF_ASSERT_OK_AND_ASSIGN(bool hit, cache.Lookup(MakeKey(1), &loaded));
+    EXPECT_FALSE(hit);
+    TF_ASSERT_OK(cache.Insert(MakeKey(1), result));
+    TF_ASSERT_OK_AND_ASSIGN(hit, cache.Lookup(MakeKey(1), &loaded));
+    EXPECT_TRUE(hit);
+    ExpectResultsEqual(result, loaded);
+    TF_ASSERT_OK_AND_ASSIGN(hit, cache.Lookup(MakeKey(2), &loaded));
+    EXPECT_FALSE(hit);
+  }
+
+  // A new cache over the same directory, e.g. in a later process, sees the
+  // entry, but not under a different configuration.
+  XlaPersistentCompilationCache cache(directory, 1 << 20);
+  EXPECT_GT(cache.size_in_bytes(), 0);
+  XlaCompilationResult loaded;
+  TF_ASSERT_OK_AND_ASSIGN(bool hit, cache.Lookup(MakeKey(1), &loaded));
+  EXPECT_TRUE(hit);
+  ExpectResultsEqual(result, loaded);
+  XlaPersistentCacheKey other_config = MakeKey(1);
+  other_config.set_config_fingerprint(43);
+  TF_ASSERT_OK_AND_ASSIGN(hit, cache.Lookup(other_config, &loaded));
+  EXPECT_FALSE(hit);
+}
+
+TEST(XlaPersistentCompilationCacheTest, CorruptedEntryIsDiscarded) {
+  const string directory = TestDirectory("corrupted_entry");
+  XlaPersistentCompilationCache cache(directory, 1 << 20);
+  TF_ASSERT_OK(cache.Insert(MakeKey(1), MakeCompilationResult(1.0f)));
+
+  std::vector<string> children;
+  TF_ASSERT_OK(Env::Default()->GetChildren(directory, &children));
+  ASSERT_EQ(children.size(), 1);
+  const string path = io::JoinPath(directory, children[0]);
+  XlaPersistentCacheEntry entry;
+  TF_ASSERT_OK(ReadBinaryProto(Env::Default(), path, &entry));
+  entry.mutable_result()->mutable_computation()->set_name("tampered");
+  TF_ASSERT_OK(WriteBinaryProto(Env::Default(), path, entry));
+
+  XlaCompilationResult loaded;
+  TF_ASSERT_OK_AND_ASSIGN(bool hit, cache.Lookup(MakeKey(1), &loaded));
+  EXPECT_FALSE(hit);
+  EXPECT_EQ(loaded.computation, nullptr);
+  EXPECT_TRUE(errors::IsNotFound(Env::Default()->FileExists(path)));
+  EXPECT_EQ(cache.size_in_bytes(), 0);
+}
+
+TEST(XlaPersistentCompilationCacheTest, EvictsLeastRecentlyUsed) {
+  const string directory = TestDirectory("evicts_lru");
+  XlaCompilationResult result = MakeCompilationResult(1.0f);
+  XlaPersistentCacheEntry entry;
+  TF_ASSERT_OK(SerializeCompilationResult(result, entry.mutable_result()));
+  // Leave room for two entries, but not three.
+  const int64_t max_size = 5 * entry.ByteSizeLong() / 2;
+
+  XlaPersistentCompilationCache cache(directory, max_size);
+  TF_ASSERT_OK(cache.Insert(MakeKey(1), result));
+  TF_ASSERT_OK(cache.Insert(MakeKey(2), result));
+  XlaCompilationResult loaded;
+  TF_ASSERT_OK_AND_ASSIGN(bool hit, cache.Lookup(MakeKey(1), &loaded));
+  EXPECT_TRUE(hit);
+  TF_ASSERT_OK(cache.Insert(MakeKey(3), result));
+  EXPECT_LE(cache.size_in_bytes(), max_size);
+
+  TF_ASSERT_OK_AND_ASSIGN(hit, cache.Lookup(MakeKey(2), &loaded));
+  EXPECT_FALSE(hit);
+  TF_ASSERT_OK_AND_ASSIGN(hit, cache.Lookup(MakeKey(1), &loaded));
+  EXPECT_TRUE(hit);
+  TF_ASSERT_OK_AND_ASSIGN(hit, cache.Lookup(MakeKey(3), &loaded));
+  EXPECT_TRUE(hit);
+}
+
+TEST(XlaPersistentCompilationCacheTest, SkipsEntriesLargerThanTheCache) {
+  const string directory = TestDirectory("skips_large_entries");
+  XlaPersistentCompilationCache cache(directory, 16);
+  TF_ASSERT_OK(cache.Insert(MakeKey(1), MakeCompilationResult(1.0f)));
+  EXPECT_EQ(cache.size_in_bytes(), 0);
+  XlaCompilationResult loaded;
+  TF_ASSERT_OK_AND_ASSIGN(bool hit, cache.Lookup(MakeKey(1), &loaded));
+  EXPECT_FALSE(hit);
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -16,13 +16,17 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/bfc_allocator.h"
 
 #include <atomic>
+#include <functional>
+#include <thread>  // NOLINT
 
+#include "absl/memory/memory.h"
 #include "absl/strings/string_view.h"
 #include "tensorflow/core/common_runtime/allocator_retry.h"
 #include "tensorflow/core/lib/core/bits.h"
 #include "tensorflow/core/lib/strings/numbers.h"
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/file_system.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/mutex.h"
@@ -37,14 +41,18 @@ limitations under the License.
 namespace tensorflow {
 
 constexpr BFCAllocator::ChunkHandle BFCAllocator::kInvalidChunkHandle;
+constexpr size_t BFCAllocator::kMaxCachedChunkSize;
+constexpr int BFCAllocator::kNumCacheSizeClasses;
+constexpr int BFCAllocator::kMaxPendingFrees;
 
 BFCAllocator::BFCAllocator(SubAllocator* sub_allocator, size_t total_memory,
                            bool allow_growth, const string& name,
-                           bool garbage_collection)
+                           bool garbage_collection, size_t core_cache_bytes)
     : garbage_collection_(garbage_collection),
       coalesce_regions_(sub_allocator->SupportsCoalescing()),
       sub_allocator_(sub_allocator),
       name_(name),
+      core_cache_bytes_(core_cache_bytes),
       free_chunks_list_(kInvalidChunkHandle),
       next_allocation_id_(1) {
   if (allow_growth) {
@@ -78,6 +86,16 @@ BFCAllocator::BFCAllocator(SubAllocator* sub_allocator, size_t total_memory,
       CHECK_NE(BinForSize(bin_size * 2), BinFromIndex(b));
     }
   }
+
+  if (core_cache_bytes_ > 0) {
+    const int num_core_caches = std::max(port::NumTotalCPUs(), 1);
+    VLOG(1) << "Creating " << num_core_caches << " core caches of "
+            << strings::HumanReadableNumBytes(core_cache_bytes_);
+    core_caches_.reserve(num_core_caches);
+    for (int i = 0; i < num_core_caches; ++i) {
+      core_caches_.push_back(absl::make_unique<CoreCache>());
+    }
+  }
 }
 
 BFCAllocator::~BFCAllocator() {
@@ -256,6 +274,16 @@ void* BFCAllocator::AllocateRawInternalWithRetry(
 void* BFCAllocator::AllocateRaw(size_t unused_alignment, size_t num_bytes,
                                 const AllocationAttributes& allocation_attr) {
   VLOG(3) << "AllocateRaw " << Name() << "  " << num_bytes;
+  if (!core_caches_.empty() && num_bytes > 0 &&
+      num_bytes <= kMaxCachedChunkSize && timing_counter_ == nullptr &&
+      allocation_attr.freed_by_func == nullptr) {
+    void* result = AllocateFromCoreCache(RoundedBytes(num_bytes));
+    if (result != nullptr) {
+      VLOG(3) << "AllocateRaw " << Name() << "  " << num_bytes << " "
+              << result << " (core cache)";
+      return result;
+    }
+  }
   void* result = [&] {
     if (!allocation_attr.retry_on_failure) {
       // Return immediately upon the first failure if this is for allocating an
@@ -427,6 +455,15 @@ void* BFCAllocator::AllocateRawInternal(size_t unused_alignment,
     }
   }
 
+  // Under memory pressure, stop hoarding chunks in the core caches.
+  if (FlushCoreCaches()) {
+    ptr = FindChunkPtr(bin_num, rounded_bytes, num_bytes, freed_before);
+    if (ptr != nullptr) {
+      AddTraceMe("MemoryAllocation", ptr);
+      return ptr;
+    }
+  }
+
   if ((freed_before == 0) && (!timestamped_chunks_.empty())) {
     // We're unable to satisfy an allocation request without a specific
     // timestamp requirement.  Rather than fail, try merging any held-out
@@ -655,7 +692,11 @@ void BFCAllocator::SplitChunk(BFCAllocator::ChunkHandle h, size_t num_bytes) {
 void BFCAllocator::DeallocateRaw(void* ptr) {
   VLOG(3) << "DeallocateRaw " << Name() << " "
           << (ptr ? RequestedSize(ptr) : 0);
-  DeallocateRawInternal(ptr);
+  if (ptr != nullptr && !core_caches_.empty() && timing_counter_ == nullptr) {
+    DeallocateToCoreCache(ptr);
+  } else {
+    DeallocateRawInternal(ptr);
+  }
   retry_helper_.NotifyDealloc();
 }
 
@@ -665,7 +706,10 @@ void BFCAllocator::DeallocateRawInternal(void* ptr) {
     return;
   }
   mutex_lock l(lock_);
+  DeallocateRawLocked(ptr);
+}
 
+void BFCAllocator::DeallocateRawLocked(void* ptr) {
   // Find the chunk from the ptr.
   BFCAllocator::ChunkHandle h = region_manager_.get_handle(ptr);
   CHECK(h != kInvalidChunkHandle);
@@ -694,6 +738,95 @@ void BFCAllocator::DeallocateRawInternal(void* ptr) {
   }
 }
 
+BFCAllocator::CoreCache* BFCAllocator::CurrentCoreCache() {
+  int cpu = port::GetCurrentCPU();
+  if (cpu < 0) {
+    // Fall back to spreading threads across the caches.
+    cpu = std::hash<std::thread::id>()(std::this_thread::get_id()) %
+          core_caches_.size();
+  }
+  return core_caches_[cpu % core_caches_.size()].get();
+}
+
+void* BFCAllocator::AllocateFromCoreCache(size_t rounded_bytes) {
+  CoreCache* cache = CurrentCoreCache();
+  mutex_lock l(cache->mu);
+  std::vector<void*>& chunks =
+      cache->free_chunks[rounded_bytes / kMinAllocationSize - 1];
+  if (chunks.empty()) {
+    ++cache->num_misses;
+    return nullptr;
+  }
+  void* ptr = chunks.back();
+  chunks.pop_back();
+  cache->bytes -= rounded_bytes;
+  ++cache->num_hits;
+  return ptr;
+}
+
+void BFCAllocator::DeallocateToCoreCache(void* ptr) {
+  CoreCache* cache = CurrentCoreCache();
+  std::vector<void*> pending_frees;
+  {
+    mutex_lock l(cache->mu);
+    cache->pending_frees.push_back(ptr);
+    if (cache->pending_frees.size() < static_cast<size_t>(kMaxPendingFrees)) {
+      return;
+    }
+    std::swap(pending_frees, cache->pending_frees);
+  }
+  mutex_lock l(lock_);
+  std::vector<ChunkHandle> cacheable;
+  for (void* p : pending_frees) {
+    ChunkHandle h = region_manager_.get_handle(p);
+    CHECK(h != kInvalidChunkHandle);
+    if (ChunkFromHandle(h)->size <= kMaxCachedChunkSize) {
+      cacheable.push_back(h);
+    } else {
+      DeallocateRawLocked(p);
+    }
+  }
+  std::vector<void*> uncached;
+  {
+    mutex_lock cache_l(cache->mu);
+    for (ChunkHandle h : cacheable) {
+      const Chunk* c = ChunkFromHandle(h);
+      if (cache->bytes + c->size > core_cache_bytes_) {
+        uncached.push_back(c->ptr);
+        continue;
+      }
+      cache->free_chunks[c->size / kMinAllocationSize - 1].push_back(c->ptr);
+      cache->bytes += c->size;
+    }
+  }
+  for (void* p : uncached) {
+    DeallocateRawLocked(p);
+  }
+}
+
+bool BFCAllocator::FlushCoreCaches() {
+  std::vector<void*> ptrs;
+  for (const auto& cache : core_caches_) {
+    mutex_lock l(cache->mu);
+    ptrs.insert(ptrs.end(), cache->pending_frees.begin(),
+                cache->pending_frees.end());
+    cache->pending_frees.clear();
+    for (std::vector<void*>& chunks : cache->free_chunks) {
+      ptrs.insert(ptrs.end(), chunks.begin(), chunks.end());
+      chunks.clear();
+    }
+    cache->bytes = 0;
+  }
+  if (!ptrs.empty()) {
+    VLOG(2) << "Flushing " << ptrs.size() << " chunks from the core caches of "
+            << Name();
+  }
+  for (void* ptr : ptrs) {
+    DeallocateRawLocked(ptr);
+  }
+  return !ptrs.empty();
+}
+
 // Merges h1 and h2 when Chunk(h1)->next is h2 and Chunk(h2)->prev is c1.
 // We merge Chunk(h2) into Chunk(h1).
 void BFCAllocator::Merge(BFCAllocator::ChunkHandle h1,
@@ -1179,7 +1312,17 @@ MemoryDump BFCAllocator::RecordMemoryMapInternal() {
 
 absl::optional<AllocatorStats> BFCAllocator::GetStats() {
   mutex_lock l(lock_);
-  return stats_;
+  AllocatorStats stats = stats_;
+  for (const auto& cache : core_caches_) {
+    mutex_lock cache_l(cache->mu);
+    // Cached chunks are in use as far as the bins are concerned.
+    stats.bytes_in_use -= cache->bytes;
+    stats.num_allocs += cache->num_hits;
+    stats.bytes_cached += cache->bytes;
+    stats.num_cache_hits += cache->num_hits;
+    stats.num_cache_misses += cache->num_misses;
+  }
+  return stats;
 }
 
 bool BFCAllocator::ClearStats() {
@@ -1187,6 +1330,11 @@ bool BFCAllocator::ClearStats() {
   stats_.num_allocs = 0;
   stats_.peak_bytes_in_use = stats_.bytes_in_use;
   stats_.largest_alloc_size = 0;
+  for (const auto& cache : core_caches_) {
+    mutex_lock cache_l(cache->mu);
+    cache->num_hits = 0;
+    cache->num_misses = 0;
+  }
   return true;
 }
 
@@ -49,9 +49,14 @@ class MemoryDump;
 class BFCAllocator : public Allocator {
  public:
   // Takes ownership of sub_allocator.
+  //
+  // If `core_cache_bytes` is positive, freed chunks of at most
+  // `kMaxCachedChunkSize` bytes are kept in per-core caches of at most
+  // `core_cache_bytes` bytes each, from which later allocations of the same
+  // size are served without taking the allocator lock. See `CoreCache`.
   BFCAllocator(SubAllocator* sub_allocator, size_t total_memory,
                bool allow_growth, const string& name,
-               bool garbage_collection = false);
+               bool garbage_collection = false, size_t core_cache_bytes = 0);
   ~BFCAllocator() override;
 
   string Name() override { return name_; }
@@ -95,6 +100,7 @@ class BFCAllocator : public Allocator {
 
  private:
   struct Bin;
+  struct CoreCache;
 
   void* AllocateRawInternal(size_t alignment, size_t num_bytes,
                             bool dump_log_on_failure,
@@ -106,6 +112,25 @@ class BFCAllocator : public Allocator {
 
   void DeallocateRawInternal(void* ptr);
 
+  // Returns the chunk of `ptr` to the bins, coalescing it with its neighbors
+  // unless a timing counter is set.
+  void DeallocateRawLocked(void* ptr) TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Returns the cache of the core the calling thread is running on.
+  CoreCache* CurrentCoreCache();
+
+  // Returns a cached chunk of exactly `rounded_bytes` bytes, or nullptr if the
+  // cache of the current core has none.
+  void* AllocateFromCoreCache(size_t rounded_bytes) TF_LOCKS_EXCLUDED(lock_);
+
+  // Queues `ptr` to be moved into the cache of the current core, or returned
+  // to the bins if that cache is full or its chunk is too large to cache.
+  void DeallocateToCoreCache(void* ptr) TF_LOCKS_EXCLUDED(lock_);
+
+  // Returns all chunks held by the core caches to the bins. Returns true if
+  // any chunk was returned.
+  bool FlushCoreCaches() TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
   // Chunks whose freed_at_count is later than the safe frontier value are kept
   // on a special list and not subject to merging immediately upon being freed.
   //
@@ -263,6 +288,37 @@ class BFCAllocator : public Allocator {
   static constexpr size_t kMinAllocationBits = 8;
   static constexpr size_t kMinAllocationSize = 1 << kMinAllocationBits;
 
+  // Chunks of at most this many bytes are eligible for the core caches.
+  static constexpr size_t kMaxCachedChunkSize = 64 << 10;
+  static constexpr int kNumCacheSizeClasses =
+      kMaxCachedChunkSize / kMinAllocationSize;
+  // The number of frees a core cache queues before sorting them into its
+  // size classes under the allocator lock.
+  static constexpr int kMaxPendingFrees = 32;
+
+  // A cache of freed small chunks used by the threads running on one core.
+  //
+  // Chunks in a core cache remain in use as far as the bins are concerned, so
+  // serving an allocation from the cache or freeing a chunk into it only takes
+  // the (mostly uncontended) lock of the cache. Since the size of a freed
+  // chunk is only known under the allocator lock, frees are queued in
+  // `pending_frees` and sorted into the size classes in batches.
+  //
+  // The chunk of an allocation served from a core cache keeps the requested
+  // size and allocation id of the allocation it was first handed out for.
+  // Queued frees are reported as in use by `GetStats()` until they are sorted.
+  struct CoreCache {
+    mutex mu;
+    // Entry i holds chunks of (i + 1) * kMinAllocationSize bytes.
+    std::array<std::vector<void*>, kNumCacheSizeClasses> free_chunks
+        TF_GUARDED_BY(mu);
+    std::vector<void*> pending_frees TF_GUARDED_BY(mu);
+    // The total size of the chunks in `free_chunks`.
+    size_t bytes TF_GUARDED_BY(mu) = 0;
+    int64_t num_hits TF_GUARDED_BY(mu) = 0;
+    int64_t num_misses TF_GUARDED_BY(mu) = 0;
+  };
+
   // BFCAllocator allocates memory into a collection of disjoint
   // AllocationRegions.  Each AllocationRegion corresponds to one call to
   // SubAllocator::Alloc().  (Actually, if a subsequent call to
@@ -588,6 +644,11 @@ class BFCAllocator : public Allocator {
 
   std::atomic<uint64> safe_frontier_ = {0};
 
+  // The maximum number of bytes held by each core cache, or 0 if the core
+  // caches are disabled.
+  const size_t core_cache_bytes_;
+  std::vector<std::unique_ptr<CoreCache>> core_caches_;
+
   // Structures mutable after construction
   mutable mutex lock_;
   RegionManager region_manager_ TF_GUARDED_BY(lock_);
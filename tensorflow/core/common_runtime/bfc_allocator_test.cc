@@ -0,0 +1,225 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/bfc_allocator.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "tensorflow/core/common_runtime/pool_allocator.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/blocking_counter.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/numa.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+SubAllocator* CreateCPUSubAllocator() {
+  return new BasicCPUAllocator(port::kNUMANoAffinity, {}, {});
+}
+
+void FreeAll(BFCAllocator* a, std::vector<void*>* ptrs) {
+  for (void* p : *ptrs) {
+    a->DeallocateRaw(p);
+  }
+  ptrs->clear();
+}
+
+TEST(BFCAllocatorTest, CoreCacheDisabledByDefault) {
+  BFCAllocator a(CreateCPUSubAllocator(), 1 << 30, /*allow_growth=*/true,
+                 "cpu_bfc");
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 64; ++i) {
+    ptrs.push_back(a.AllocateRaw(1, 1024));
+  }
+  FreeAll(&a, &ptrs);
+  void* p = a.AllocateRaw(1, 1024);
+  a.DeallocateRaw(p);
+  absl::optional<AllocatorStats> stats = a.GetStats();
+  ASSERT_TRUE(stats);
+  EXPECT_EQ(stats->bytes_in_use, 0);
+  EXPECT_EQ(stats->bytes_cached, 0);
+  EXPECT_EQ(stats->num_cache_hits, 0);
+  EXPECT_EQ(stats->num_cache_misses, 0);
+}
+
+TEST(BFCAllocatorTest, CoreCacheServesFreedChunks) {
+  BFCAllocator a(CreateCPUSubAllocator(), 1 << 30, /*allow_growth=*/true,
+                 "cpu_bfc", /*garbage_collection=*/false,
+                 /*core_cache_bytes=*/1 << 20);
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 256; ++i) {
+    ptrs.push_back(a.AllocateRaw(1, 1000));
+  }
+  FreeAll(&a, &ptrs);
+  absl::optional<AllocatorStats> stats = a.GetStats();
+  ASSERT_TRUE(stats);
+  EXPECT_EQ(stats->num_cache_misses, 256);
+  EXPECT_GT(stats->bytes_cached, 0);
+  EXPECT_LE(stats->bytes_cached, 256 * 1024);
+
+  // Chunks freed on one core are only visible to threads running on that
+  // core, so allocate until a hit regardless of migrations.
+  for (int i = 0; i < 256; ++i) {
+    void* p = a.AllocateRaw(1, 1000);
+    EXPECT_EQ(a.AllocatedSize(p), 1024);
+    ptrs.push_back(p);
+  }
+  stats = a.GetStats();
+  ASSERT_TRUE(stats);
+  EXPECT_GT(stats->num_cache_hits, 0);
+  EXPECT_EQ(stats->num_allocs, 512);
+
+  // Only exact size classes are served from the cache.
+  void* large = a.AllocateRaw(1, 2048);
+  EXPECT_EQ(a.AllocatedSize(large), 2048);
+  a.DeallocateRaw(large);
+  FreeAll(&a, &ptrs);
+}
+
+TEST(BFCAllocatorTest, CoreCacheIsBounded) {
+  const size_t kCoreCacheBytes = 16 << 10;
+  BFCAllocator a(CreateCPUSubAllocator(), 1 << 30, /*allow_growth=*/true,
+                 "cpu_bfc", /*garbage_collection=*/false, kCoreCacheBytes);
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 1024; ++i) {
+    ptrs.push_back(a.AllocateRaw(1, 4096));
+  }
+  FreeAll(&a, &ptrs);
+  absl::optional<AllocatorStats> stats = a.GetStats();
+  ASSERT_TRUE(stats);
+  EXPECT_LE(stats->bytes_cached,
+            static_cast<int64_t>(kCoreCacheBytes) * port::NumTotalCPUs());
+}
+
+TEST(BFCAllocatorTest, CoreCacheFlushedUnderMemoryPressure) {
+  // All of the memory fits in the core caches.
+  const size_t kMemoryLimit = 1 << 20;
+  BFCAllocator a(CreateCPUSubAllocator(), kMemoryLimit,
+                 /*allow_growth=*/false, "cpu_bfc",
+                 /*garbage_collection=*/false, kMemoryLimit);
+  std::vector<void*> ptrs;
+  for (size_t i = 0; i < kMemoryLimit / (32 << 10); ++i) {
+    void* p = a.AllocateRaw(1, 32 << 10);
+    ASSERT_NE(p, nullptr);
+    ptrs.push_back(p);
+  }
+  FreeAll(&a, &ptrs);
+
+  // The chunks held by the caches are returned to the bins and coalesced.
+  void* p = a.AllocateRaw(1, kMemoryLimit / 2);
+  EXPECT_NE(p, nullptr);
+  absl::optional<AllocatorStats> stats = a.GetStats();
+  ASSERT_TRUE(stats);
+  EXPECT_EQ(stats->bytes_cached, 0);
+  a.DeallocateRaw(p);
+}
+
+TEST(BFCAllocatorTest, CoreCacheMultithreaded) {
+  BFCAllocator a(CreateCPUSubAllocator(), 1 << 30, /*allow_growth=*/true,
+                 "cpu_bfc", /*garbage_collection=*/false,
+                 /*core_cache_bytes=*/256 << 10);
+  const int kNumThreads = 16;
+  mutex mu;
+  absl::flat_hash_set<void*> live;
+  thread::ThreadPool pool(Env::Default(), "test", kNumThreads);
+  BlockingCounter counter(kNumThreads);
+  for (int t = 0; t < kNumThreads; ++t) {
+    pool.Schedule([&, t]() {
+      random::PhiloxRandom philox(t, 17);
+      random::SimplePhilox rand(&philox);
+      std::vector<void*> ptrs;
+      for (int i = 0; i < 10000; ++i) {
+        if (ptrs.size() < 64 && rand.Uniform(2) == 0) {
+          void* p = a.AllocateRaw(1, 1 + rand.Uniform(128 << 10));
+          EXPECT_NE(p, nullptr);
+          {
+            mutex_lock l(mu);
+            // No chunk is handed out twice.
+            EXPECT_TRUE(live.insert(p).second);
+          }
+          ptrs.push_back(p);
+        } else if (!ptrs.empty()) {
+          {
+            mutex_lock l(mu);
+            live.erase(ptrs.back());
+          }
+          a.DeallocateRaw(ptrs.back());
+          ptrs.pop_back();
+        }
+      }
+      FreeAll(&a, &ptrs);
+      counter.DecrementCount();
+    });
+  }
+  counter.Wait();
+  absl::optional<AllocatorStats> stats = a.GetStats();
+  ASSERT_TRUE(stats);
+  // Allocations larger than the largest size class bypass the caches.
+  EXPECT_LE(stats->num_cache_hits + stats->num_cache_misses,
+            stats->num_allocs);
+}
+
+// Allocates and frees small buffers from `state.range(0)` threads, with the
+// core caches disabled (`state.range(1) == 0`) or enabled.
+void BM_MultithreadedSmallAllocations(::testing::benchmark::State& state) {
+  const int num_threads = state.range(0);
+  const size_t core_cache_bytes = state.range(1) ? 1 << 20 : 0;
+  const int kAllocationsPerThread = 1000;
+  BFCAllocator a(CreateCPUSubAllocator(), 1ull << 33, /*allow_growth=*/true,
+                 "cpu_bfc", /*garbage_collection=*/false, core_cache_bytes);
+  thread::ThreadPool pool(Env::Default(), "test", num_threads);
+  for (auto s : state) {
+    BlockingCounter counter(num_threads);
+    for (int t = 0; t < num_threads; ++t) {
+      pool.Schedule([&a, &counter]() {
+        const std::vector<size_t> sizes = {64,   256,   512,  1024,
+                                           4096, 16384, 65536};
+        std::vector<void*> ptrs(8, nullptr);
+        for (int i = 0; i < kAllocationsPerThread; ++i) {
+          void*& p = ptrs[i % ptrs.size()];
+          if (p != nullptr) {
+            a.DeallocateRaw(p);
+          }
+          p = a.AllocateRaw(1, sizes[i % sizes.size()]);
+        }
+        for (void* p : ptrs) {
+          a.DeallocateRaw(p);
+        }
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          num_threads * kAllocationsPerThread);
+}
+
+BENCHMARK(BM_MultithreadedSmallAllocations)
+    ->ArgPair(1, 0)
+    ->ArgPair(1, 1)
+    ->ArgPair(8, 0)
+    ->ArgPair(8, 1)
+    ->ArgPair(64, 0)
+    ->ArgPair(64, 1);
+
+}  // namespace
+}  // namespace tensorflow
@@ -58,6 +58,7 @@ limitations under the License.
 #include "tensorflow/core/lib/gtl/manual_constructor.h"
 #include "tensorflow/core/lib/hash/hash.h"
 #include "tensorflow/core/platform/context.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/logging.h"
@@ -138,7 +139,14 @@ typedef gtl::InlinedVector<AllocatorAttributes, 4> AllocatorAttributeVec;
 
 class ExecutorImpl : public Executor {
  public:
-  explicit ExecutorImpl(const LocalExecutorParams& p) : immutable_state_(p) {}
+  // If `work_stealing` is true, ready nodes are scheduled on per-step worker
+  // loops with work stealing (see `WorkStealingReadyQueues`) instead of being
+  // handed to the runner one by one.
+  explicit ExecutorImpl(const LocalExecutorParams& p,
+                        bool work_stealing = false)
+      : immutable_state_(p),
+        num_work_stealing_workers_(work_stealing ? port::MaxParallelism()
+                                                 : 0) {}
 
   Status Initialize(const Graph& graph) {
     TF_RETURN_IF_ERROR(immutable_state_.Initialize(graph));
@@ -216,10 +224,97 @@ class ExecutorImpl : public Executor {
 
   ImmutableExecutorState immutable_state_;
   KernelStats kernel_stats_;
+  // Maximum number of concurrent worker loops of a step, or 0 if work stealing
+  // is disabled.
+  const int num_work_stealing_workers_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(ExecutorImpl);
 };
 
+// Ready queues of one step of the work-stealing executor, one per worker.
+//
+// A worker pushes the nodes made ready by the nodes it runs onto the back of
+// its own queue and pops from the back as well, so that nodes tend to run on
+// the thread that produced their inputs. Idle workers steal from the front of
+// the other queues. Each queue has its own lock, which is uncontended unless
+// the queue is being stolen from.
+template <typename Node>
+class WorkStealingReadyQueues {
+ public:
+  explicit WorkStealingReadyQueues(int num_queues)
+      : num_queues_(num_queues), queues_(new Queue[num_queues]) {}
+
+  int num_queues() const { return num_queues_; }
+
+  // Returns the number of queued nodes.
+  int64_t size() const { return size_.load(); }
+
+  void Push(int queue, const Node& node) {
+    Queue& q = queues_[queue];
+    mutex_lock l(q.mu);
+    q.nodes.push_back(node);
+    size_.fetch_add(1);
+  }
+
+  // Pops the most recently pushed node of `queue`, or else steals the oldest
+  // node of another queue. Returns nullopt if all queues are empty.
+  absl::optional<Node> Pop(int queue) {
+    absl::optional<Node> node;
+    if (size_.load(std::memory_order_relaxed) <= 0) return node;
+    if (PopBack(&queues_[queue], &node)) return node;
+    for (int i = 1; i < num_queues_; ++i) {
+      if (PopFront(&queues_[(queue + i) % num_queues_], &node)) return node;
+    }
+    return node;
+  }
+
+ private:
+  struct Queue {
+    mutex mu;
+    // Queued nodes are `nodes[front:]`.
+    std::vector<Node> nodes TF_GUARDED_BY(mu);
+    size_t front TF_GUARDED_BY(mu) = 0;
+  };
+
+  bool PopBack(Queue* q, absl::optional<Node>* node) {
+    mutex_lock l(q->mu);
+    if (q->nodes.size() == q->front) return false;
+    node->emplace(q->nodes.back());
+    q->nodes.pop_back();
+    MaybeReset(q);
+    size_.fetch_sub(1);
+    return true;
+  }
+
+  bool PopFront(Queue* q, absl::optional<Node>* node) {
+    mutex_lock l(q->mu);
+    if (q->nodes.size() == q->front) return false;
+    node->emplace(q->nodes[q->front++]);
+    MaybeReset(q);
+    size_.fetch_sub(1);
+    return true;
+  }
+
+  static void MaybeReset(Queue* q) TF_EXCLUSIVE_LOCKS_REQUIRED(q->mu) {
+    if (q->nodes.size() == q->front) {
+      q->nodes.clear();
+      q->front = 0;
+    }
+  }
+
+  const int num_queues_;
+  std::unique_ptr<Queue[]> queues_;
+  std::atomic<int64_t> size_{0};
+};
+
+// The work-stealing worker loop running on the current thread, if any. Set by
+// `ExecutorState::WorkerLoop()`.
+struct CurrentWorker {
+  const void* executor_state = nullptr;
+  int index = -1;
+};
+thread_local CurrentWorker current_worker;
+
 // The state associated with one invocation of ExecutorImpl::Run.
 //
 // ExecutorState dispatches nodes when they become ready, and delegates to an
@@ -274,7 +369,8 @@ class ExecutorState {
  public:
   ExecutorState(const Executor::Args& args,
                 const ImmutableExecutorState& immutable_state_,
-                ExecutorImpl::KernelStats* kernel_stats_);
+                ExecutorImpl::KernelStats* kernel_stats_,
+                int num_work_stealing_workers);
   ~ExecutorState();
 
   void RunAsync(Executor::DoneCallback done);
@@ -326,6 +422,25 @@ class ExecutorState {
   // REQUIRES: `!ready->empty()`.
   void ScheduleReady(TaggedNodeSeq* ready, TaggedNodeReadyQueue* inline_ready);
 
+  // Variant of ScheduleReady() for the work-stealing executor. Called from a
+  // worker loop, the first node in `*ready` is continued on the current thread
+  // and the others are pushed onto the worker's queue. Otherwise all nodes are
+  // spread over the queues. Starts workers for the queued nodes if fewer than
+  // `num_work_stealing_workers_` are running.
+  void ScheduleReadyWorkStealing(TaggedNodeSeq* ready,
+                                 TaggedNodeReadyQueue* inline_ready);
+
+  // Runs queued nodes until all work queues are empty. Each running worker
+  // counts as an outstanding op, so the state outlives all its workers.
+  void WorkerLoop(int worker);
+
+  // Starts up to `num_workers` additional worker loops.
+  void MaybeStartWorkers(int num_workers);
+
+  // Increments `num_active_workers_` unless `num_work_stealing_workers_`
+  // workers are active. Returns true on success.
+  bool TryActivateWorker();
+
   // A wrapper for runner_ to keep track of the pending queue length. Op
   // execution should dispatch work using this function instead of using runner_
   // directly.
@@ -379,6 +494,12 @@ class ExecutorState {
 
   PropagatorStateType propagator_;
 
+  // Only used by the work-stealing executor, otherwise `work_queues_` is null.
+  const int num_work_stealing_workers_;
+  std::unique_ptr<WorkStealingReadyQueues<TaggedNode>> work_queues_;
+  std::atomic<int> num_active_workers_{0};
+  std::atomic<int> next_queue_{0};
+
   // Invoked when the execution finishes.
   Executor::DoneCallback done_cb_;
 
@@ -397,7 +518,7 @@ class ExecutorState {
 template <class PropagatorStateType>
 ExecutorState<PropagatorStateType>::ExecutorState(
     const Executor::Args& args, const ImmutableExecutorState& immutable_state,
-    ExecutorImpl::KernelStats* kernel_stats)
+    ExecutorImpl::KernelStats* kernel_stats, int num_work_stealing_workers)
     : vlog_(VLOG_IS_ON(1)),
       log_memory_(LogMemory::IsEnabled()),
       step_id_(args.step_id),
@@ -424,12 +545,19 @@ ExecutorState<PropagatorStateType>::ExecutorState(
       sync_on_finish_(args.sync_on_finish),
       run_all_kernels_inline_(args.run_all_kernels_inline),
       propagator_(immutable_state, step_id_, vlog_),
+      num_work_stealing_workers_(num_work_stealing_workers),
       num_outstanding_ops_(0) {
   if (args.user_intra_op_threadpool != nullptr) {
     Device* device = immutable_state_.params().device;
     user_device_ = RenamedDevice::NewRenamedDevice(
         device->name(), device, false, false, args.user_intra_op_threadpool);
   }
+  // Running all kernels inline already avoids the scheduling overhead that
+  // work stealing addresses.
+  if (num_work_stealing_workers_ > 0 && !run_all_kernels_inline_) {
+    work_queues_ = absl::make_unique<WorkStealingReadyQueues<TaggedNode>>(
+        num_work_stealing_workers_);
+  }
 }
 
 template <class PropagatorStateType>
@@ -1160,6 +1288,12 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
     TaggedNodeSeq* ready, TaggedNodeReadyQueue* inline_ready) {
   DCHECK(!ready->empty());
 
+  if (work_queues_) {
+    ScheduleReadyWorkStealing(ready, inline_ready);
+    ready->clear();
+    return;
+  }
+
   int64_t scheduled_nsec = 0;
   if (stats_collector_) {
     scheduled_nsec = nodestats::NowInNsec();
@@ -1219,6 +1353,83 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
   ready->clear();
 }
 
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::ScheduleReadyWorkStealing(
+    TaggedNodeSeq* ready, TaggedNodeReadyQueue* inline_ready) {
+  int worker = -1;
+  if (inline_ready != nullptr && current_worker.executor_state == this) {
+    worker = current_worker.index;
+  }
+  auto it = ready->begin();
+  if (worker >= 0 && inline_ready->empty()) {
+    // Continue with a successor of the node that just ran on this thread,
+    // while its inputs are still hot in the cache.
+    inline_ready->push_back(*it);
+    ++it;
+  }
+  const int num_queued = ready->end() - it;
+  if (num_queued == 0) return;
+  if (worker >= 0) {
+    // Push in reverse order, so that the worker pops the nodes in order.
+    for (auto rit = ready->end(); rit != it;) {
+      work_queues_->Push(worker, *--rit);
+    }
+  } else {
+    for (; it != ready->end(); ++it) {
+      work_queues_->Push(next_queue_.fetch_add(1, std::memory_order_relaxed) %
+                             work_queues_->num_queues(),
+                         *it);
+    }
+  }
+  MaybeStartWorkers(num_queued);
+}
+
+template <class PropagatorStateType>
+bool ExecutorState<PropagatorStateType>::TryActivateWorker() {
+  int num_active = num_active_workers_.load();
+  while (num_active < num_work_stealing_workers_) {
+    if (num_active_workers_.compare_exchange_weak(num_active, num_active + 1)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::MaybeStartWorkers(int num_workers) {
+  for (int i = 0; i < num_workers && TryActivateWorker(); ++i) {
+    num_outstanding_ops_.fetch_add(1, std::memory_order_relaxed);
+    // Two workers may share a queue if workers retire and restart
+    // concurrently, which only costs locality.
+    const int worker = next_queue_.fetch_add(1, std::memory_order_relaxed) %
+                       work_queues_->num_queues();
+    RunTask([this, worker]() { WorkerLoop(worker); });
+  }
+}
+
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::WorkerLoop(int worker) {
+  // Executors may nest on a thread, e.g. for inlined function calls.
+  const CurrentWorker saved_worker = current_worker;
+  current_worker = {this, worker};
+  while (true) {
+    absl::optional<TaggedNode> tagged_node = work_queues_->Pop(worker);
+    if (tagged_node.has_value()) {
+      Process(*tagged_node, stats_collector_ ? nodestats::NowInNsec() : 0);
+      continue;
+    }
+    // A thread that pushes a node after the queues were found empty, but
+    // before this worker retired, may not start a new worker. Check for such
+    // nodes once retired; the atomics order this against the pusher's check
+    // of `num_active_workers_`.
+    num_active_workers_.fetch_sub(1);
+    if (work_queues_->size() > 0 && TryActivateWorker()) continue;
+    break;
+  }
+  current_worker = saved_worker;
+  if (num_outstanding_ops_.fetch_sub(1) == 1) ScheduleFinish();
+}
+
 template <class PropagatorStateType>
 void ExecutorState<PropagatorStateType>::ScheduleFinish() {
   // Checks condition to decide if needs to invoke Finish(). If there are
@@ -1356,11 +1567,13 @@ void ExecutorState<PropagatorStateType>::Finish() {
 
 void ExecutorImpl::RunAsync(const Args& args, DoneCallback done) {
   if (immutable_state_.requires_control_flow_support()) {
-    (new ExecutorState<PropagatorState>(args, immutable_state_, &kernel_stats_))
+    (new ExecutorState<PropagatorState>(args, immutable_state_, &kernel_stats_,
+                                        num_work_stealing_workers_))
         ->RunAsync(std::move(done));
   } else {
     (new ExecutorState<SimplePropagatorState>(args, immutable_state_,
-                                              &kernel_stats_))
+                                              &kernel_stats_,
+                                              num_work_stealing_workers_))
         ->RunAsync(std::move(done));
   }
 }
@@ -1414,6 +1627,29 @@ class DefaultExecutorRegistrar {
 };
 static DefaultExecutorRegistrar registrar;
 
+// Registers the "WORK_STEALING" executor type, which schedules ready nodes on
+// per-step worker loops with work stealing. This reduces the scheduling
+// overhead of graphs with many inexpensive nodes.
+class WorkStealingExecutorRegistrar {
+ public:
+  WorkStealingExecutorRegistrar() {
+    ExecutorFactory::Register("WORK_STEALING", new Factory);
+  }
+
+ private:
+  class Factory : public ExecutorFactory {
+    Status NewExecutor(const LocalExecutorParams& params, const Graph& graph,
+                       std::unique_ptr<Executor>* out_executor) override {
+      auto impl =
+          absl::make_unique<ExecutorImpl>(params, /*work_stealing=*/true);
+      TF_RETURN_IF_ERROR(impl->Initialize(graph));
+      *out_executor = std::move(impl);
+      return Status::OK();
+    }
+  };
+};
+static WorkStealingExecutorRegistrar work_stealing_registrar;
+
 }  // namespace
 
 }  // namespace tensorflow
@@ -25,6 +25,7 @@ limitations under the License.
 #include "tensorflow/cc/ops/standard_ops.h"
 #include "tensorflow/core/common_runtime/device.h"
 #include "tensorflow/core/common_runtime/device_factory.h"
+#include "tensorflow/core/common_runtime/executor_factory.h"
 #include "tensorflow/core/common_runtime/graph_constructor.h"
 #include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
 #include "tensorflow/core/common_runtime/lower_functional_ops.h"
@@ -48,7 +49,8 @@ limitations under the License.
 
 namespace tensorflow {
 
-class ExecutorTest : public ::testing::Test {
+// Parameterized by the executor type.
+class ExecutorTest : public ::testing::TestWithParam<string> {
  protected:
   ExecutorTest()
       : device_(DeviceFactory::NewDevice("CPU", {},
@@ -82,7 +84,9 @@ class ExecutorTest : public ::testing::Test {
     };
     rendez_ = NewLocalRendezvous();
     delete exec_;
-    TF_CHECK_OK(NewLocalExecutor(params, *graph, &exec_));
+    std::unique_ptr<Executor> executor;
+    TF_CHECK_OK(NewExecutor(GetParam(), params, *graph, &executor));
+    exec_ = executor.release();
     runner_ = [this](std::function<void()> fn) { thread_pool_->Schedule(fn); };
   }
 
@@ -154,7 +158,7 @@ Rendezvous::ParsedKey Key(const string& sender, const uint64 incarnation,
 #define ALICE "/job:j/replica:0/task:0/cpu:0"
 #define BOB "/job:j/replica:0/task:0/device:GPU:0"
 
-TEST_F(ExecutorTest, SimpleAdd) {
+TEST_P(ExecutorTest, SimpleAdd) {
   // c = a + b
   auto g = absl::make_unique<Graph>(OpRegistry::Global());
   auto in0 = test::graph::Recv(g.get(), "a", "float", ALICE, 1, BOB);
@@ -175,7 +179,7 @@ TEST_F(ExecutorTest, SimpleAdd) {
   EXPECT_EQ(2.0, V(out));  // out = 1.0 + 1.0 = 2.0
 }
 
-TEST_F(ExecutorTest, SelfAdd) {
+TEST_P(ExecutorTest, SelfAdd) {
   // v0 <- a
   // v1 = v0 + v0
   // v2 = v1 + v1
@@ -240,7 +244,7 @@ void BuildTree(int N, Graph* g) {
   test::graph::Send(g, nodes.back(), "b", BOB, 1, ALICE);
 }
 
-TEST_F(ExecutorTest, RandomTree) {
+TEST_P(ExecutorTest, RandomTree) {
   auto g = absl::make_unique<Graph>(OpRegistry::Global());
   BuildTree(4096, g.get());
   Create(std::move(g));
@@ -273,7 +277,7 @@ void BuildConcurrentAddAssign(Graph* g) {
 }
 
 #ifndef THREAD_SANITIZER
-TEST_F(ExecutorTest, ConcurrentAddAssign) {
+TEST_P(ExecutorTest, ConcurrentAddAssign) {
   auto g = absl::make_unique<Graph>(OpRegistry::Global());
   BuildConcurrentAddAssign(g.get());
   Create(std::move(g));
@@ -292,7 +296,7 @@ TEST_F(ExecutorTest, ConcurrentAddAssign) {
 }
 #endif
 
-TEST_F(ExecutorTest, SimpleSwitchLive) {
+TEST_P(ExecutorTest, SimpleSwitchLive) {
   auto g = absl::make_unique<Graph>(OpRegistry::Global());
   auto in0 = test::graph::Recv(g.get(), "a", "float", ALICE, 1, BOB);
   auto in1 = test::graph::Constant(g.get(), VB(false));
@@ -311,7 +315,7 @@ TEST_F(ExecutorTest, SimpleSwitchLive) {
   EXPECT_FALSE(is_dead);
 }
 
-TEST_F(ExecutorTest, SimpleSwitchDead) {
+TEST_P(ExecutorTest, SimpleSwitchDead) {
   auto g = absl::make_unique<Graph>(OpRegistry::Global());
   auto in0 = test::graph::Recv(g.get(), "a", "float", ALICE, 1, BOB);
   auto in1 = test::graph::Constant(g.get(), VB(true));
@@ -329,7 +333,7 @@ TEST_F(ExecutorTest, SimpleSwitchDead) {
   EXPECT_TRUE(is_dead);
 }
 
-TEST_F(ExecutorTest, Abort) {
+TEST_P(ExecutorTest, Abort) {
   // e = a + b + c + d
   auto g = absl::make_unique<Graph>(OpRegistry::Global());
   auto in0 = test::graph::Recv(g.get(), "a", "float", ALICE, 1, BOB);
@@ -382,7 +386,7 @@ TEST_F(ExecutorTest, Abort) {
   }
 }
 
-TEST_F(ExecutorTest, RecvInvalidDtype) {
+TEST_P(ExecutorTest, RecvInvalidDtype) {
   auto g = absl::make_unique<Graph>(OpRegistry::Global());
   // An input vector of type float of size 1.
   auto one = test::graph::Recv(g.get(), "one", "float", ALICE, 1, BOB);
@@ -407,7 +411,7 @@ TEST_F(ExecutorTest, RecvInvalidDtype) {
   rendez->Unref();
 }
 
-TEST_F(ExecutorTest, RecvInvalidRefDtype) {
+TEST_P(ExecutorTest, RecvInvalidRefDtype) {
   auto g = absl::make_unique<Graph>(OpRegistry::Global());
   // A var that always produces as invalid dtype.
   auto var = test::graph::InvalidRefType(g.get(), DT_FLOAT, DT_DOUBLE);
@@ -422,7 +426,7 @@ TEST_F(ExecutorTest, RecvInvalidRefDtype) {
   rendez->Unref();
 }
 
-TEST_F(ExecutorTest, NoInputTensors) {
+TEST_P(ExecutorTest, NoInputTensors) {
   // Create a graph where none of the nodes have input tensors.
   auto g = absl::make_unique<Graph>(OpRegistry::Global());
   test::graph::Constant(g.get(), V(1.0));
@@ -430,10 +434,14 @@ TEST_F(ExecutorTest, NoInputTensors) {
   TF_ASSERT_OK(Run(rendez_));
 }
 
+INSTANTIATE_TEST_SUITE_P(ExecutorTypes, ExecutorTest,
+                         ::testing::Values("DEFAULT", "WORK_STEALING"));
+
 // Create a graph that is 'depth' deep. At each level, fan-in and fan-out a
 // maximum of 'width' nodes. All nodes are no-ops and all dependencies are
 // control dependencies.
-static void BM_executor(::testing::benchmark::State& state) {
+static void BM_executor_helper(::testing::benchmark::State& state,
+                               const string& executor_type) {
   const int width = state.range(0);
   const int depth = state.range(1);
 
@@ -467,12 +475,19 @@ static void BM_executor(::testing::benchmark::State& state) {
   }
 
   FixupSourceAndSinkEdges(g);
-  test::Benchmark("cpu", g, /*old_benchmark_api=*/false).Run(state);
+  test::Benchmark("cpu", g, /*options=*/nullptr, /*init=*/nullptr,
+                  /*rendez=*/nullptr, executor_type.c_str(),
+                  /*old_benchmark_api=*/false)
+      .Run(state);
 
   state.SetLabel(strings::StrCat("Nodes = ", cur));
   state.SetItemsProcessed(cur * static_cast<int64_t>(state.iterations()));
 }
 
+static void BM_executor(::testing::benchmark::State& state) {
+  BM_executor_helper(state, "");
+}
+
 // Tall skinny graphs
 BENCHMARK(BM_executor)->UseRealTime()->ArgPair(16, 1024);
 BENCHMARK(BM_executor)->UseRealTime()->ArgPair(32, 8192);
@@ -484,6 +499,16 @@ BENCHMARK(BM_executor)->UseRealTime()->ArgPair(8192, 32);
 // Tall fat graph
 BENCHMARK(BM_executor)->UseRealTime()->ArgPair(1024, 1024);
 
+static void BM_work_stealing_executor(::testing::benchmark::State& state) {
+  BM_executor_helper(state, "WORK_STEALING");
+}
+
+BENCHMARK(BM_work_stealing_executor)->UseRealTime()->ArgPair(16, 1024);
+BENCHMARK(BM_work_stealing_executor)->UseRealTime()->ArgPair(32, 8192);
+BENCHMARK(BM_work_stealing_executor)->UseRealTime()->ArgPair(1024, 16);
+BENCHMARK(BM_work_stealing_executor)->UseRealTime()->ArgPair(8192, 32);
+BENCHMARK(BM_work_stealing_executor)->UseRealTime()->ArgPair(1024, 1024);
+
 static void BM_const_identity(::testing::benchmark::State& state) {
   const int width = state.range(0);
   const int outputs_per_const = state.range(1);
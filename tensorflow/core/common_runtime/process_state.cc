@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/process_state.h"
 
+#include <algorithm>
 #include <atomic>
 #include <cstring>
 #include <vector>
@@ -99,10 +100,18 @@ Allocator* ProcessState::GetCPUAllocator(int numa_node) {
         LOG(ERROR) << "GetCPUAllocator: " << status.error_message();
       }
       int64_t cpu_mem_limit = cpu_mem_limit_in_mb * (1LL << 20);
+      // Per-core caches of small freed chunks, disabled by default.
+      int64_t core_cache_in_kb = 0;
+      status = ReadInt64FromEnvVar("TF_CPU_BFC_CORE_CACHE_IN_KB", 0,
+                                   &core_cache_in_kb);
+      if (!status.ok()) {
+        LOG(ERROR) << "GetCPUAllocator: " << status.error_message();
+      }
       DCHECK(sub_allocator);
-      allocator =
-          new BFCAllocator(sub_allocator, cpu_mem_limit, /*allow_growth=*/true,
-                           /*name=*/"bfc_cpu_allocator_for_gpu");
+      allocator = new BFCAllocator(
+          sub_allocator, cpu_mem_limit, /*allow_growth=*/true,
+          /*name=*/"bfc_cpu_allocator_for_gpu", /*garbage_collection=*/false,
+          /*core_cache_bytes=*/std::max<int64_t>(core_cache_in_kb, 0) << 10);
       VLOG(2) << "Using BFCAllocator with memory limit of "
               << cpu_mem_limit_in_mb << " MB for ProcessState CPU allocator";
     } else if (sub_allocator) {
@@ -0,0 +1,80 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Builds the record index of uncompressed TFRecord files, so that
+// TFRecordDataset can read them in any order and skip records without reading
+// them when TF_TFRECORD_USE_INDEX=1. The index of "file" is "file.idx".
+//
+// Usage: build_tfrecord_index --files=<glob>[,<glob>...]
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_split.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/io/record_index.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/init_main.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/command_line_flags.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+Status BuildIndices(const std::string& patterns) {
+  Env* env = Env::Default();
+  for (absl::string_view pattern :
+       absl::StrSplit(patterns, ',', absl::SkipEmpty())) {
+    std::vector<std::string> filenames;
+    TF_RETURN_IF_ERROR(
+        env->GetMatchingPaths(std::string(pattern), &filenames));
+    if (filenames.empty()) {
+      return errors::NotFound("No files match ", pattern);
+    }
+    for (const std::string& filename : filenames) {
+      const std::string index_filename = io::RecordIndexFilename(filename);
+      TF_RETURN_IF_ERROR(io::BuildRecordIndex(env, filename, index_filename));
+      LOG(INFO) << "Wrote " << index_filename;
+    }
+  }
+  return Status::OK();
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
+
+int main(int argc, char** argv) {
+  std::string files;
+  std::vector<tensorflow::Flag> flag_list = {
+      tensorflow::Flag("files", &files,
+                       "Comma-separated globs of the uncompressed TFRecord "
+                       "files to index"),
+  };
+  bool parse_result = tensorflow::Flags::Parse(&argc, argv, flag_list);
+  if (!parse_result || files.empty()) {
+    std::cerr << tensorflow::Flags::Usage(argv[0], flag_list);
+    return -1;
+  }
+  tensorflow::port::InitMain(argv[0], &argc, &argv);
+  tensorflow::Status s = tensorflow::data::BuildIndices(files);
+  if (!s.ok()) {
+    LOG(ERROR) << s;
+    return 1;
+  }
+  return 0;
+}
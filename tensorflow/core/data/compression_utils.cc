@@ -14,77 +14,173 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/data/compression_utils.h"
 
+#include <algorithm>
 #include <limits>
+#include <string>
+#include <vector>
 
+#include <zlib.h>
+
+#include "absl/strings/string_view.h"
 #include "tensorflow/core/common_runtime/dma_helper.h"
 #include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/snappy.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 namespace data {
+namespace {
 
-Status CompressElement(const std::vector<Tensor>& element,
-                       CompressedElement* out) {
-  // Step 1: Determine the total uncompressed size. This requires serializing
-  // non-memcopyable tensors, which we save to use again later.
-  std::vector<TensorProto> non_memcpy_components;
-  size_t total_size = 0;
-  for (auto& component : element) {
-    if (DataTypeCanUseMemcpy(component.dtype())) {
-      const TensorBuffer* buffer = DMAHelper::buffer(&component);
-      if (buffer) {
-        total_size += buffer->size();
-      }
-    } else {
-      non_memcpy_components.emplace_back();
-      component.AsProtoTensorContent(&non_memcpy_components.back());
-      total_size += non_memcpy_components.back().ByteSizeLong();
+// The layout of `CompressedElement` written by `CompressElement`.
+constexpr int64_t kCompressedElementVersion = 1;
+
+// Protocol buffers can't be serialized past 2GB, so the compressed data of an
+// element must fit within it.
+constexpr size_t kMaxCompressedElementBytes =
+    std::numeric_limits<int32>::max();
+
+// A chunk of a component to compress.
+struct Chunk {
+  int component_index;
+  absl::string_view uncompressed;
+  // Owns the compressed bytes, unless the chunk is stored uncompressed.
+  std::string compressed_buffer;
+  absl::string_view compressed;
+  Status status;
+};
+
+thread::ThreadPool* SharedThreadPool() {
+  static thread::ThreadPool* pool = new thread::ThreadPool(
+      Env::Default(), "tf_data_compression", port::MaxParallelism());
+  return pool;
+}
+
+// Calls `fn(i)` for `i` in [0, n), in parallel on `pool` when n > 1.
+void ParallelFor(thread::ThreadPool* pool, int64_t n,
+                 const std::function<void(int64_t)>& fn) {
+  if (n <= 1) {
+    for (int64_t i = 0; i < n; ++i) {
+      fn(i);
     }
+    return;
   }
+  BlockingCounter counter(n - 1);
+  for (int64_t i = 1; i < n; ++i) {
+    pool->Schedule([&fn, &counter, i] {
+      fn(i);
+      counter.DecrementCount();
+    });
+  }
+  fn(0);
+  counter.Wait();
+}
 
-  // Step 2: Write the tensor data to a buffer, and compress that buffer.
-  // We use tstring for access to resize_uninitialized.
-  tstring uncompressed;
-  uncompressed.resize_uninitialized(total_size);
-  // Position in `uncompressed` to write the next component.
-  char* position = uncompressed.mdata();
-  int non_memcpy_component_index = 0;
-  for (auto& component : element) {
-    CompressedComponentMetadata* metadata =
-        out->mutable_component_metadata()->Add();
-    metadata->set_dtype(component.dtype());
-    component.shape().AsProto(metadata->mutable_tensor_shape());
-    if (DataTypeCanUseMemcpy(component.dtype())) {
-      const TensorBuffer* buffer = DMAHelper::buffer(&component);
-      if (buffer) {
-        memcpy(position, buffer->data(), buffer->size());
-        metadata->set_tensor_size_bytes(buffer->size());
+Status CompressChunk(CompressionCodec codec, absl::string_view input,
+                     std::string* output) {
+  switch (codec) {
+    case COMPRESSION_CODEC_NONE:
+      output->assign(input.data(), input.size());
+      return Status::OK();
+    case COMPRESSION_CODEC_SNAPPY:
+      if (!port::Snappy_Compress(input.data(), input.size(), output)) {
+        return errors::Internal("Failed to compress using snappy.");
       }
-    } else {
-      TensorProto& proto = non_memcpy_components[non_memcpy_component_index++];
-      proto.SerializeToArray(position, proto.ByteSizeLong());
-      metadata->set_tensor_size_bytes(proto.ByteSizeLong());
+      return Status::OK();
+    case COMPRESSION_CODEC_ZLIB: {
+      uLongf output_size = compressBound(input.size());
+      output->resize(output_size);
+      int result = compress2(reinterpret_cast<Bytef*>(&(*output)[0]),
+                             &output_size,
+                             reinterpret_cast<const Bytef*>(input.data()),
+                             input.size(), Z_DEFAULT_COMPRESSION);
+      if (result != Z_OK) {
+        return errors::Internal("Failed to compress using zlib: ", result);
+      }
+      output->resize(output_size);
+      return Status::OK();
     }
-    position += metadata->tensor_size_bytes();
+    default:
+      return errors::InvalidArgument("Unknown compression codec: ", codec);
   }
-  if (total_size > kuint32max) {
-    return errors::OutOfRange("Encountered dataset element of size ",
-                              total_size, ", exceeding the 4GB limit.");
+}
+
+Status UncompressChunk(CompressionCodec codec, absl::string_view input,
+                       char* output, size_t output_size) {
+  switch (codec) {
+    case COMPRESSION_CODEC_NONE:
+      if (input.size() != output_size) {
+        return errors::Internal("Uncompressed chunk size mismatch. Expected ",
+                                output_size, " bytes, got ", input.size());
+      }
+      memcpy(output, input.data(), output_size);
+      return Status::OK();
+    case COMPRESSION_CODEC_SNAPPY: {
+      size_t uncompressed_size;
+      if (!port::Snappy_GetUncompressedLength(input.data(), input.size(),
+                                              &uncompressed_size)) {
+        return errors::Internal(
+            "Could not get snappy uncompressed length. Compressed data size: ",
+            input.size());
+      }
+      if (uncompressed_size != output_size) {
+        return errors::Internal("Uncompressed size mismatch. Snappy expects ",
+                                uncompressed_size,
+                                " whereas the tensor metadata suggests ",
+                                output_size);
+      }
+      if (!port::Snappy_Uncompress(input.data(), input.size(), output)) {
+        return errors::Internal("Failed to perform snappy decompression.");
+      }
+      return Status::OK();
+    }
+    case COMPRESSION_CODEC_ZLIB: {
+      uLongf uncompressed_size = output_size;
+      int result = uncompress(reinterpret_cast<Bytef*>(output),
+                              &uncompressed_size,
+                              reinterpret_cast<const Bytef*>(input.data()),
+                              input.size());
+      if (result != Z_OK || uncompressed_size != output_size) {
+        return errors::Internal("Failed to perform zlib decompression: ",
+                                result);
+      }
+      return Status::OK();
+    }
+    default:
+      return errors::InvalidArgument("Unknown compression codec: ", codec);
   }
-  DCHECK_EQ(position, uncompressed.mdata() + total_size);
+}
+
+// Returns the number of chunks a component of `size` bytes is split into.
+int64_t NumChunks(int64_t size, int64_t chunk_size_bytes) {
+  return (size + chunk_size_bytes - 1) / chunk_size_bytes;
+}
 
-  if (!port::Snappy_Compress(uncompressed.mdata(), total_size,
-                             out->mutable_data())) {
-    return errors::Internal("Failed to compress using snappy.");
+CompressionOptions MakeDefaultCompressionOptions() {
+  CompressionOptions options;
+  std::string codec;
+  Status s =
+      ReadStringFromEnvVar("TF_DATA_COMPRESSION_CODEC", "snappy", &codec);
+  if (!s.ok()) {
+    LOG(WARNING) << s;
+  } else if (codec == "none") {
+    options.codec = COMPRESSION_CODEC_NONE;
+  } else if (codec == "zlib") {
+    options.codec = COMPRESSION_CODEC_ZLIB;
+  } else if (codec != "snappy") {
+    LOG(WARNING) << "Unknown TF_DATA_COMPRESSION_CODEC " << codec
+                 << ", using snappy.";
   }
-  VLOG(3) << "Compressed element from " << total_size << " bytes to "
-          << out->data().size() << " bytes";
-  return Status::OK();
+  return options;
 }
 
-Status UncompressElement(const CompressedElement& compressed,
-                         std::vector<Tensor>* out) {
+// Uncompresses an element written before components were compressed in
+// chunks.
+Status UncompressElementV0(const CompressedElement& compressed,
+                           std::vector<Tensor>* out) {
   int num_components = compressed.component_metadata_size();
   out->clear();
   out->reserve(num_components);
@@ -161,5 +257,253 @@ Status UncompressElement(const CompressedElement& compressed,
   return Status::OK();
 }
 
+// Uncompresses an element whose components were compressed in chunks.
+Status UncompressElementV1(const CompressedElement& compressed,
+                           std::vector<Tensor>* out) {
+  const int num_components = compressed.component_metadata_size();
+  const int64_t chunk_size_bytes = compressed.chunk_size_bytes();
+  out->clear();
+  out->reserve(num_components);
+  // Serialized TensorProtos of components which can't be memcopied.
+  std::vector<tstring> tensor_proto_strs(num_components);
+
+  // Step 1: Allocate the components and locate their chunks.
+  struct ChunkLocation {
+    CompressionCodec codec;
+    absl::string_view compressed;
+    char* output;
+    size_t output_size;
+  };
+  std::vector<ChunkLocation> chunks;
+  const std::string& data = compressed.data();
+  size_t offset = 0;
+  for (int i = 0; i < num_components; ++i) {
+    const CompressedComponentMetadata& metadata =
+        compressed.component_metadata(i);
+    char* output = nullptr;
+    int64_t size = 0;
+    if (DataTypeCanUseMemcpy(metadata.dtype())) {
+      out->emplace_back(metadata.dtype(), metadata.tensor_shape());
+      TensorBuffer* buffer = DMAHelper::buffer(&out->back());
+      if (buffer) {
+        output = static_cast<char*>(buffer->data());
+        size = buffer->size();
+      }
+    } else {
+      out->emplace_back();
+      tensor_proto_strs[i].resize_uninitialized(metadata.tensor_size_bytes());
+      output = tensor_proto_strs[i].mdata();
+      size = tensor_proto_strs[i].size();
+    }
+    if (size > 0 && chunk_size_bytes <= 0) {
+      return errors::Internal("Invalid compressed chunk size ",
+                              chunk_size_bytes);
+    }
+    const int64_t num_chunks = size > 0 ? NumChunks(size, chunk_size_bytes) : 0;
+    if (metadata.compressed_chunk_sizes_size() != num_chunks) {
+      return errors::Internal("Component ", i, " of ", size, " bytes has ",
+                              metadata.compressed_chunk_sizes_size(),
+                              " compressed chunks, expected ", num_chunks);
+    }
+    for (int64_t j = 0; j < num_chunks; ++j) {
+      const int64_t compressed_size = metadata.compressed_chunk_sizes(j);
+      if (compressed_size < 0 || offset + compressed_size > data.size()) {
+        return errors::Internal("Compressed chunk ", j, " of component ", i,
+                                " exceeds the compressed data of size ",
+                                data.size());
+      }
+      const int64_t start = j * chunk_size_bytes;
+      chunks.push_back(
+          {metadata.codec(),
+           absl::string_view(data.data() + offset, compressed_size),
+           output + start,
+           static_cast<size_t>(std::min(chunk_size_bytes, size - start))});
+      offset += compressed_size;
+    }
+  }
+
+  // Step 2: Uncompress the chunks into the components.
+  std::vector<Status> statuses(chunks.size());
+  ParallelFor(SharedThreadPool(), chunks.size(), [&](int64_t i) {
+    const ChunkLocation& chunk = chunks[i];
+    statuses[i] = UncompressChunk(chunk.codec, chunk.compressed, chunk.output,
+                                  chunk.output_size);
+  });
+  for (const Status& s : statuses) {
+    TF_RETURN_IF_ERROR(s);
+  }
+
+  // Step 3: Deserialize tensor proto strings to tensors.
+  for (int i = 0; i < num_components; ++i) {
+    if (DataTypeCanUseMemcpy(compressed.component_metadata(i).dtype())) {
+      continue;
+    }
+    TensorProto tp;
+    if (!tp.ParseFromString(tensor_proto_strs[i])) {
+      return errors::Internal("Could not parse TensorProto");
+    }
+    if (!out->at(i).FromProto(tp)) {
+      return errors::Internal("Could not parse Tensor");
+    }
+  }
+  return Status::OK();
+}
+
+}  // namespace
+
+const CompressionOptions& DefaultCompressionOptions() {
+  static const CompressionOptions* options =
+      new CompressionOptions(MakeDefaultCompressionOptions());
+  return *options;
+}
+
+Status CompressElement(const std::vector<Tensor>& element,
+                       CompressedElement* out) {
+  return CompressElement(element, DefaultCompressionOptions(), out);
+}
+
+Status CompressElement(const std::vector<Tensor>& element,
+                       const CompressionOptions& options,
+                       CompressedElement* out) {
+  if (options.chunk_size_bytes <= 0) {
+    return errors::InvalidArgument("Compression chunk size must be positive, ",
+                                   "got ", options.chunk_size_bytes);
+  }
+  // Step 1: Find the bytes of each component. This requires serializing
+  // non-memcopyable tensors, which we save until the element is compressed.
+  // Reserve space so that the strings' data is never moved.
+  std::vector<tstring> tensor_proto_strs;
+  tensor_proto_strs.reserve(element.size());
+  std::vector<absl::string_view> components;
+  components.reserve(element.size());
+  size_t uncompressed_size = 0;
+  for (auto& component : element) {
+    CompressedComponentMetadata* metadata =
+        out->mutable_component_metadata()->Add();
+    metadata->set_dtype(component.dtype());
+    component.shape().AsProto(metadata->mutable_tensor_shape());
+    if (DataTypeCanUseMemcpy(component.dtype())) {
+      const TensorBuffer* buffer = DMAHelper::buffer(&component);
+      if (buffer) {
+        components.emplace_back(static_cast<const char*>(buffer->data()),
+                                buffer->size());
+      } else {
+        components.emplace_back();
+      }
+    } else {
+      TensorProto proto;
+      component.AsProtoTensorContent(&proto);
+      tensor_proto_strs.emplace_back();
+      tstring& proto_str = tensor_proto_strs.back();
+      proto_str.resize_uninitialized(proto.ByteSizeLong());
+      proto.SerializeToArray(proto_str.mdata(), proto_str.size());
+      components.emplace_back(proto_str.data(), proto_str.size());
+    }
+    metadata->set_tensor_size_bytes(components.back().size());
+    metadata->set_codec(options.codec);
+    uncompressed_size += components.back().size();
+  }
+
+  // Step 2: Split the components into chunks.
+  std::vector<Chunk> chunks;
+  // Index of the first chunk of each component.
+  std::vector<int64_t> first_chunks(components.size());
+  for (size_t i = 0; i < components.size(); ++i) {
+    first_chunks[i] = chunks.size();
+    absl::string_view component = components[i];
+    for (size_t start = 0; start < component.size();
+         start += options.chunk_size_bytes) {
+      chunks.emplace_back();
+      chunks.back().component_index = i;
+      chunks.back().uncompressed =
+          component.substr(start, options.chunk_size_bytes);
+    }
+  }
+  thread::ThreadPool* pool =
+      options.thread_pool ? options.thread_pool : SharedThreadPool();
+  auto compress = [&chunks, out](int64_t i) {
+    Chunk& chunk = chunks[i];
+    CompressionCodec codec =
+        out->component_metadata(chunk.component_index).codec();
+    if (codec == COMPRESSION_CODEC_NONE) {
+      chunk.compressed = chunk.uncompressed;
+      return;
+    }
+    chunk.status =
+        CompressChunk(codec, chunk.uncompressed, &chunk.compressed_buffer);
+    chunk.compressed = chunk.compressed_buffer;
+  };
+
+  // Step 3: Compress the first chunk of each component, and store components
+  // which don't compress well uncompressed.
+  std::vector<int64_t> samples;
+  for (size_t i = 0; i < components.size(); ++i) {
+    if (!components[i].empty()) {
+      samples.push_back(first_chunks[i]);
+    }
+  }
+  ParallelFor(pool, samples.size(),
+              [&](int64_t i) { compress(samples[i]); });
+  for (int64_t i : samples) {
+    Chunk& chunk = chunks[i];
+    TF_RETURN_IF_ERROR(chunk.status);
+    if (chunk.compressed.size() >
+        options.max_compression_ratio * chunk.uncompressed.size()) {
+      out->mutable_component_metadata(chunk.component_index)
+          ->set_codec(COMPRESSION_CODEC_NONE);
+      chunk.compressed_buffer.clear();
+      chunk.compressed = chunk.uncompressed;
+    }
+  }
+
+  // Step 4: Compress the remaining chunks.
+  std::vector<int64_t> remaining;
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    if (first_chunks[chunks[i].component_index] != static_cast<int64_t>(i)) {
+      remaining.push_back(i);
+    }
+  }
+  ParallelFor(pool, remaining.size(),
+              [&](int64_t i) { compress(remaining[i]); });
+
+  // Step 5: Concatenate the compressed chunks.
+  size_t compressed_size = 0;
+  for (Chunk& chunk : chunks) {
+    TF_RETURN_IF_ERROR(chunk.status);
+    out->mutable_component_metadata(chunk.component_index)
+        ->add_compressed_chunk_sizes(chunk.compressed.size());
+    compressed_size += chunk.compressed.size();
+  }
+  if (compressed_size > kMaxCompressedElementBytes) {
+    return errors::OutOfRange(
+        "Encountered dataset element of size ", uncompressed_size,
+        " which compresses to ", compressed_size,
+        " bytes, exceeding the 2GB limit of a serialized CompressedElement.");
+  }
+  std::string* data = out->mutable_data();
+  data->reserve(compressed_size);
+  for (const Chunk& chunk : chunks) {
+    data->append(chunk.compressed.data(), chunk.compressed.size());
+  }
+  out->set_version(kCompressedElementVersion);
+  out->set_chunk_size_bytes(options.chunk_size_bytes);
+  VLOG(3) << "Compressed element from " << uncompressed_size
+          << " bytes to " << compressed_size << " bytes";
+  return Status::OK();
+}
+
+Status UncompressElement(const CompressedElement& compressed,
+                         std::vector<Tensor>* out) {
+  switch (compressed.version()) {
+    case 0:
+      return UncompressElementV0(compressed, out);
+    case kCompressedElementVersion:
+      return UncompressElementV1(compressed, out);
+    default:
+      return errors::Unimplemented("Unsupported compressed element version ",
+                                   compressed.version());
+  }
+}
+
 }  // namespace data
 }  // namespace tensorflow
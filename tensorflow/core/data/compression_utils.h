@@ -18,20 +18,46 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/dma_helper.h"
 #include "tensorflow/core/data/dataset.pb.h"
 #include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/threadpool.h"
 
 namespace tensorflow {
 namespace data {
 
+// Options for compressing dataset elements.
+struct CompressionOptions {
+  // The codec used to compress components.
+  CompressionCodec codec = COMPRESSION_CODEC_SNAPPY;
+  // Components are split into chunks of this many bytes, which are compressed
+  // independently so that large components compress in parallel.
+  int64_t chunk_size_bytes = 1 << 20;
+  // A component whose first chunk doesn't compress to at most this fraction of
+  // its size is stored uncompressed, to avoid wasting time on data which is
+  // already compressed.
+  double max_compression_ratio = 0.9;
+  // The thread pool to compress chunks on. If null, elements with more than
+  // one chunk are compressed on a shared thread pool.
+  thread::ThreadPool* thread_pool = nullptr;
+};
+
+// Returns the default compression options. The codec may be overridden with
+// the TF_DATA_COMPRESSION_CODEC environment variable, set to "none",
+// "snappy", or "zlib".
+const CompressionOptions& DefaultCompressionOptions();
+
 // Compresses the components of `element` into the `CompressedElement` proto.
 //
 // In addition to writing the actual compressed bytes, `Compress` fills
 // out the per-component metadata for the `CompressedElement`.
-//
-// Returns an error if the uncompressed size of the element exceeds 4GB.
+Status CompressElement(const std::vector<Tensor>& element,
+                       const CompressionOptions& options,
+                       CompressedElement* out);
+
+// Same as above, using `DefaultCompressionOptions()`.
 Status CompressElement(const std::vector<Tensor>& element,
                        CompressedElement* out);
 
 // Uncompresses a `CompressedElement` into a vector of tensor components.
+// Chunks of large components are uncompressed in parallel.
 Status UncompressElement(const CompressedElement& compressed,
                          std::vector<Tensor>* out);
 
@@ -16,7 +16,10 @@ limitations under the License.
 
 #include "tensorflow/core/data/dataset_test_base.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/snappy.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 
 namespace tensorflow {
 namespace data {
@@ -49,5 +52,126 @@ std::vector<std::vector<Tensor>> TestCases() {
 INSTANTIATE_TEST_SUITE_P(Instantiation, ParameterizedCompressionUtilsTest,
                          ::testing::ValuesIn(TestCases()));
 
+// Returns a tensor of `size` bytes which don't compress.
+Tensor RandomTensor(int64_t size) {
+  Tensor tensor(DT_UINT8, TensorShape({size}));
+  random::PhiloxRandom philox(/*seed=*/42);
+  random::SimplePhilox rand(&philox);
+  auto flat = tensor.flat<uint8>();
+  for (int64_t i = 0; i < size; ++i) {
+    flat(i) = rand.Uniform(256);
+  }
+  return tensor;
+}
+
+class CodecCompressionUtilsTest
+    : public DatasetOpsTestBase,
+      public ::testing::WithParamInterface<
+          std::tuple<CompressionCodec, int64_t>> {};
+
+TEST_P(CodecCompressionUtilsTest, RoundTrip) {
+  CompressionOptions options;
+  options.codec = std::get<0>(GetParam());
+  options.chunk_size_bytes = std::get<1>(GetParam());
+  std::vector<Tensor> element = {
+      CreateTensor<int64_t>(TensorShape{4, 4}, std::vector<int64_t>(16, 7)),
+      CreateTensor<tstring>(TensorShape{3}, {"a", "bb", "ccc"}),
+      RandomTensor(100),
+      CreateTensor<float>(TensorShape{0}, {}),
+  };
+  CompressedElement compressed;
+  TF_ASSERT_OK(CompressElement(element, options, &compressed));
+  std::vector<Tensor> round_trip_element;
+  TF_ASSERT_OK(UncompressElement(compressed, &round_trip_element));
+  TF_EXPECT_OK(
+      ExpectEqual(element, round_trip_element, /*compare_order=*/true));
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Instantiation, CodecCompressionUtilsTest,
+    ::testing::Combine(::testing::Values(COMPRESSION_CODEC_NONE,
+                                         COMPRESSION_CODEC_SNAPPY,
+                                         COMPRESSION_CODEC_ZLIB),
+                       ::testing::Values(7, 64, 1 << 20)));
+
+TEST(CompressionUtilsTest, SkipIncompressibleComponents) {
+  CompressionOptions options;
+  options.chunk_size_bytes = 1024;
+  std::vector<Tensor> element = {
+      RandomTensor(4096),
+      CreateTensor<int64_t>(TensorShape{512}, std::vector<int64_t>(512, 1))};
+  CompressedElement compressed;
+  TF_ASSERT_OK(CompressElement(element, options, &compressed));
+  EXPECT_EQ(compressed.component_metadata(0).codec(), COMPRESSION_CODEC_NONE);
+  EXPECT_EQ(compressed.component_metadata(0).compressed_chunk_sizes_size(), 4);
+  EXPECT_EQ(compressed.component_metadata(1).codec(),
+            COMPRESSION_CODEC_SNAPPY);
+  EXPECT_EQ(compressed.component_metadata(1).compressed_chunk_sizes_size(), 4);
+  EXPECT_LT(compressed.data().size(), 4096 + 4096);
+}
+
+TEST(CompressionUtilsTest, UncompressVersion0) {
+  std::vector<Tensor> element = {
+      CreateTensor<int64_t>(TensorShape{2}, {1, 2}),
+      CreateTensor<tstring>(TensorShape{1}, {"a"})};
+  // Elements compressed as one snappy buffer, before components were split
+  // into chunks.
+  CompressedElement compressed;
+  std::string uncompressed;
+  for (const Tensor& component : element) {
+    CompressedComponentMetadata* metadata = compressed.add_component_metadata();
+    metadata->set_dtype(component.dtype());
+    component.shape().AsProto(metadata->mutable_tensor_shape());
+    if (DataTypeCanUseMemcpy(component.dtype())) {
+      uncompressed.append(component.tensor_data().data(),
+                          component.tensor_data().size());
+      metadata->set_tensor_size_bytes(component.tensor_data().size());
+    } else {
+      TensorProto proto;
+      component.AsProtoTensorContent(&proto);
+      uncompressed.append(proto.SerializeAsString());
+      metadata->set_tensor_size_bytes(proto.ByteSizeLong());
+    }
+  }
+  ASSERT_TRUE(port::Snappy_Compress(uncompressed.data(), uncompressed.size(),
+                                    compressed.mutable_data()));
+
+  std::vector<Tensor> round_trip_element;
+  TF_ASSERT_OK(UncompressElement(compressed, &round_trip_element));
+  TF_EXPECT_OK(DatasetOpsTestBase::ExpectEqual(element, round_trip_element,
+                                               /*compare_order=*/true));
+}
+
+TEST(CompressionUtilsTest, CorruptChunkSizes) {
+  std::vector<Tensor> element = {RandomTensor(100)};
+  CompressedElement compressed;
+  TF_ASSERT_OK(CompressElement(element, &compressed));
+  compressed.mutable_component_metadata(0)->set_compressed_chunk_sizes(0, 1000);
+  std::vector<Tensor> round_trip_element;
+  EXPECT_EQ(UncompressElement(compressed, &round_trip_element).code(),
+            error::INTERNAL);
+}
+
+// Compresses an element with one 64MB component of compressible data, split
+// into chunks of `state.range(0)` bytes.
+void BM_CompressElement(::testing::benchmark::State& state) {
+  CompressionOptions options;
+  options.chunk_size_bytes = state.range(0);
+  constexpr int64_t kNumElements = 8 << 20;
+  Tensor tensor(DT_INT64, TensorShape({kNumElements}));
+  auto flat = tensor.flat<int64_t>();
+  for (int64_t i = 0; i < kNumElements; ++i) {
+    flat(i) = i % 1000;
+  }
+  std::vector<Tensor> element = {tensor};
+  for (auto s : state) {
+    CompressedElement compressed;
+    TF_CHECK_OK(CompressElement(element, options, &compressed));
+  }
+  state.SetBytesProcessed(state.iterations() * tensor.TotalBytes());
+}
+
+BENCHMARK(BM_CompressElement)->Arg(1 << 20)->Arg(64 << 20);
+
 }  // namespace data
 }  // namespace tensorflow
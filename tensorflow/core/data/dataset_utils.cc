@@ -69,6 +69,7 @@ static absl::flat_hash_map<string, int64_t>* get_dataset_experiments() {
 constexpr char kMapAndBatchFusionOpt[] = "map_and_batch_fusion";
 constexpr char kNoopEliminationOpt[] = "noop_elimination";
 constexpr char kMapParallelizationOpt[] = "map_parallelization";
+constexpr char kMapVectorizationOpt[] = "map_vectorization";
 constexpr char kShuffleAndRepeatFusionOpt[] = "shuffle_and_repeat_fusion";
 constexpr char kFilterFusionOpt[] = "filter_fusion";
 constexpr char kMapAndFilterFusionOpt[] = "map_and_filter_fusion";
@@ -155,6 +156,14 @@ void DefaultOptimizationGraphRewrites(
       optimization_disabled->insert(kMapFusionOpt);
     }
   }
+  if (optimization_options.optional_map_vectorization_case() ==
+      OptimizationOptions::kMapVectorization) {
+    if (optimization_options.map_vectorization()) {
+      optimization_enabled->insert(kMapVectorizationOpt);
+    } else {
+      optimization_disabled->insert(kMapVectorizationOpt);
+    }
+  }
   if (optimization_options.optional_noop_elimination_case() ==
       OptimizationOptions::kNoopElimination) {
     if (optimization_options.noop_elimination()) {
@@ -821,6 +830,47 @@ Status CopyBatch(CopyBatchParams params,
   return Status::OK();
 }
 
+bool CanBatchInPlace(const DatasetBase* input, int64_t batch_size,
+                     bool drop_remainder, bool parallel_copy) {
+  if (parallel_copy || !input->SupportsGetNextIntoSlice()) {
+    return false;
+  }
+  for (const PartialTensorShape& shape : input->output_shapes()) {
+    if (!shape.IsFullyDefined()) {
+      return false;
+    }
+  }
+  // A batch is preallocated at its full size, which is wasteful when
+  // `batch_size` is an upper bound used to stack the whole input.
+  const int64_t cardinality = input->Cardinality();
+  return drop_remainder || cardinality == kInfiniteCardinality ||
+         cardinality >= batch_size;
+}
+
+Status AllocateBatch(CopyBatchParams params, int64_t batch_size,
+                     const DataTypeVector& dtypes,
+                     const std::vector<PartialTensorShape>& shapes,
+                     std::vector<Tensor>* batch) {
+  batch->clear();
+  batch->reserve(dtypes.size());
+  for (size_t i = 0; i < dtypes.size(); ++i) {
+    TensorShape element_shape;
+    if (!shapes[i].AsTensorShape(&element_shape)) {
+      return errors::InvalidArgument(
+          "Cannot preallocate a batch of elements of shape ",
+          shapes[i].DebugString(), " in component ", i, ".");
+    }
+    TensorShape batch_component_shape({batch_size});
+    batch_component_shape.AppendShape(element_shape);
+    batch->emplace_back(params.allocator, dtypes[i], batch_component_shape);
+    if (!batch->back().IsInitialized()) {
+      return errors::ResourceExhausted(
+          "Failed to allocate memory for the batch of component ", i);
+    }
+  }
+  return Status::OK();
+}
+
 absl::flat_hash_set<tstring> CreateGraphRewriteConfigs(const Options& options) {
   absl::flat_hash_set<tstring> configs;
   const auto& autotune_options = options.autotune_options();
@@ -902,6 +952,10 @@ REGISTER_DATASET_EXPERIMENT("parallelize_batch_copy", 100);
 REGISTER_DATASET_EXPERIMENT("max_parallelism", 100);
 REGISTER_DATASET_EXPERIMENT("min_outer_interleave_parallelism", 0);
 REGISTER_DATASET_EXPERIMENT("inject_prefetch", 50);
+REGISTER_DATASET_EXPERIMENT("sharded_shuffle_buffer", 0);
+REGISTER_DATASET_EXPERIMENT("autotune_critical_path", 0);
+REGISTER_DATASET_EXPERIMENT("runtime_scheduler", 0);
+REGISTER_DATASET_EXPERIMENT("memory_accountant", 0);
 }  // namespace
 }  // namespace data
 }  // namespace tensorflow
@@ -307,6 +307,23 @@ Status CopyBatch(CopyBatchParams params,
                  std::function<Status()> allocation_callback,
                  std::vector<Tensor>* out_tensors);
 
+// Returns whether batches of `batch_size` elements of `input` can be allocated
+// before their elements are read, so that the elements are written into the
+// batch in place with `IteratorBase::GetNextIntoSlice()` rather than being
+// collected and copied with `CopyBatch()`. This requires `input` to support
+// `GetNextIntoSlice()`, the shapes of the elements to be fully defined, and all
+// batches except possibly the last one to be full. Parallel copies are only
+// supported by `CopyBatch()`.
+bool CanBatchInPlace(const DatasetBase* input, int64_t batch_size,
+                     bool drop_remainder, bool parallel_copy);
+
+// Allocates one tensor of shape `[batch_size] + shapes[i]` for each of the
+// components described by `dtypes` and `shapes`, which must be fully defined.
+Status AllocateBatch(CopyBatchParams params, int64_t batch_size,
+                     const DataTypeVector& dtypes,
+                     const std::vector<PartialTensorShape>& shapes,
+                     std::vector<Tensor>* batch);
+
 // Computes the set of experiments to apply based on the job name, rollout
 // percentage of registered experiments, and the TF_DATA_EXPERIMENT_OPT_IN and
 // TF_DATA_EXPERIMENT_OPT_OUT environment variables.
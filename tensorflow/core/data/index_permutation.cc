@@ -0,0 +1,78 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/index_permutation.h"
+
+#include "tensorflow/core/lib/core/bits.h"
+#include "tensorflow/core/lib/random/philox_random.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+// The finalizer of SplitMix64, which is a bijective mixing function with good
+// avalanche behavior.
+uint64 Mix(uint64 x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+}  // namespace
+
+IndexPermutation::IndexPermutation(int64_t n, int64_t seed, int64_t seed2)
+    : n_(n) {
+  DCHECK_GE(n, 0);
+  if (n > 1) {
+    half_bits_ = (Log2Ceiling64(n) + 1) / 2;
+    half_mask_ = (uint64{1} << half_bits_) - 1;
+  }
+  random::PhiloxRandom generator(seed, seed2);
+  for (int i = 0; i < kNumRounds; i += 2) {
+    random::PhiloxRandom::ResultType sample = generator();
+    round_keys_[i] = (static_cast<uint64>(sample[0]) << 32) | sample[1];
+    round_keys_[i + 1] = (static_cast<uint64>(sample[2]) << 32) | sample[3];
+  }
+}
+
+int64_t IndexPermutation::operator()(int64_t position) const {
+  DCHECK_GE(position, 0);
+  DCHECK_LT(position, n_);
+  uint64 value = position;
+  do {
+    value = Encrypt(value);
+  } while (value >= static_cast<uint64>(n_));
+  return value;
+}
+
+uint64 IndexPermutation::Encrypt(uint64 value) const {
+  if (half_bits_ == 0) {
+    return value;
+  }
+  uint64 left = value >> half_bits_;
+  uint64 right = value & half_mask_;
+  for (uint64 key : round_keys_) {
+    const uint64 next_right = left ^ (Mix(right ^ key) & half_mask_);
+    left = right;
+    right = next_right;
+  }
+  return (left << half_bits_) | right;
+}
+
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,61 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_INDEX_PERMUTATION_H_
+#define TENSORFLOW_CORE_DATA_INDEX_PERMUTATION_H_
+
+#include <array>
+#include <cstdint>
+
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data {
+
+// A pseudo-random permutation of the indices [0, n) which is computed on the
+// fly, so that it takes constant memory regardless of `n`.
+//
+// The permutation is a balanced Feistel network over the smallest domain of
+// 4^k values which contains [0, n). Values that fall outside of [0, n) are
+// encrypted again until they land inside it ("cycle walking"). As the domain
+// has fewer than 4n values, this takes fewer than four encryptions on average.
+class IndexPermutation {
+ public:
+  // Creates a permutation of [0, n) keyed by `seed` and `seed2`. Permutations
+  // with the same `n` and seeds are identical.
+  IndexPermutation(int64_t n, int64_t seed, int64_t seed2);
+
+  // Returns the index at `position` in the permutation. `position` must be in
+  // [0, n).
+  int64_t operator()(int64_t position) const;
+
+  int64_t size() const { return n_; }
+
+ private:
+  static constexpr int kNumRounds = 6;
+
+  // Applies the Feistel network to `value`, which must be in the domain.
+  uint64 Encrypt(uint64 value) const;
+
+  const int64_t n_;
+  // Each half of a value in the domain has `half_bits_` bits.
+  int half_bits_ = 0;
+  uint64 half_mask_ = 0;
+  std::array<uint64, kNumRounds> round_keys_;
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_INDEX_PERMUTATION_H_
@@ -0,0 +1,110 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/index_permutation.h"
+
+#include <vector>
+
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+class IndexPermutationTest : public ::testing::TestWithParam<int64_t> {};
+
+TEST_P(IndexPermutationTest, IsPermutation) {
+  const int64_t n = GetParam();
+  IndexPermutation permutation(n, /*seed=*/7, /*seed2=*/11);
+  EXPECT_EQ(permutation.size(), n);
+  std::vector<bool> seen(n, false);
+  for (int64_t i = 0; i < n; ++i) {
+    const int64_t index = permutation(i);
+    ASSERT_GE(index, 0);
+    ASSERT_LT(index, n);
+    EXPECT_FALSE(seen[index]) << "Index " << index << " produced twice";
+    seen[index] = true;
+  }
+}
+
+TEST_P(IndexPermutationTest, IsDeterministic) {
+  const int64_t n = GetParam();
+  IndexPermutation permutation1(n, /*seed=*/1, /*seed2=*/2);
+  IndexPermutation permutation2(n, /*seed=*/1, /*seed2=*/2);
+  for (int64_t i = 0; i < n; ++i) {
+    EXPECT_EQ(permutation1(i), permutation2(i));
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(IndexPermutationTest, IndexPermutationTest,
+                         ::testing::Values(0, 1, 2, 3, 4, 5, 17, 64, 100, 1000,
+                                           4097));
+
+TEST(IndexPermutationTest, SeedsChangePermutation) {
+  constexpr int64_t kNumElements = 1000;
+  IndexPermutation permutation1(kNumElements, /*seed=*/1, /*seed2=*/2);
+  IndexPermutation permutation2(kNumElements, /*seed=*/1, /*seed2=*/3);
+  int num_differences = 0;
+  for (int64_t i = 0; i < kNumElements; ++i) {
+    num_differences += permutation1(i) != permutation2(i);
+  }
+  EXPECT_GT(num_differences, kNumElements / 2);
+}
+
+TEST(IndexPermutationTest, MixesSortedInput) {
+  // Consecutive positions should not map to nearby indices, which is what
+  // makes the permutation useful for inputs sorted by e.g. time.
+  constexpr int64_t kNumElements = 1 << 16;
+  IndexPermutation permutation(kNumElements, /*seed=*/42, /*seed2=*/0);
+  int64_t num_fixed_points = 0;
+  int64_t num_ascending = 0;
+  for (int64_t i = 0; i < kNumElements; ++i) {
+    num_fixed_points += permutation(i) == i;
+    if (i > 0) {
+      num_ascending += permutation(i) > permutation(i - 1);
+    }
+  }
+  // A random permutation has one fixed point on average, and half of its
+  // consecutive pairs ascending.
+  EXPECT_LT(num_fixed_points, 16);
+  EXPECT_NEAR(num_ascending, kNumElements / 2, kNumElements / 20);
+}
+
+TEST(IndexPermutationTest, LargeDomain) {
+  IndexPermutation permutation(kint64max, /*seed=*/3, /*seed2=*/4);
+  for (int64_t i : {int64_t{0}, int64_t{1}, kint64max - 1}) {
+    const int64_t index = permutation(i);
+    EXPECT_GE(index, 0);
+    EXPECT_LT(index, kint64max);
+  }
+}
+
+void BM_IndexPermutation(::testing::benchmark::State& state) {
+  const int64_t num_elements = state.range(0);
+  IndexPermutation permutation(num_elements, /*seed=*/1, /*seed2=*/2);
+  int64_t position = 0;
+  int64_t sum = 0;
+  for (auto s : state) {
+    sum += permutation(position);
+    if (++position == num_elements) position = 0;
+  }
+  tensorflow::testing::DoNotOptimize(sum);
+}
+
+BENCHMARK(BM_IndexPermutation)->Arg(1000)->Arg(1 << 20)->Arg(1 << 30);
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
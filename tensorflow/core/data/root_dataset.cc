@@ -18,6 +18,7 @@ limitations under the License.
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/data/name_utils.h"
 #include "tensorflow/core/data/rewrite_utils.h"
+#include "tensorflow/core/framework/memory_accountant.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/stringprintf.h"
 
@@ -31,6 +32,9 @@ constexpr char kCpuBudget[] = "cpu_budget";
 constexpr char kRamBudget[] = "ram_budget_bytes";
 constexpr char kHillClimb[] = "hill_climb";
 constexpr char kGradientDescent[] = "gradient_descent";
+constexpr char kCriticalPath[] = "critical_path";
+constexpr char kCriticalPathExperiment[] = "autotune_critical_path";
+constexpr char kMemoryAccountantExperiment[] = "memory_accountant";
 constexpr char kIntraOpParallelism[] = "intra_op_parallelism";
 constexpr char kPrivateThreadpoolSize[] = "threadpool_size";
 constexpr char kMemBandwidth[] = "mem_bw_used_megabytes_per_sec";
@@ -59,7 +63,10 @@ Status RootDataset::FromOptions(DatasetBase* input, DatasetBase** output) {
   }
   params.autotune = ShouldUseAutotuning(options);
   if (params.autotune) {
-    params.autotune_algorithm = model::AutotuneAlgorithm::HILL_CLIMB;
+    params.autotune_algorithm =
+        GetExperiments().contains(kCriticalPathExperiment)
+            ? model::AutotuneAlgorithm::CRITICAL_PATH
+            : model::AutotuneAlgorithm::HILL_CLIMB;
     params.autotune_cpu_budget = value_or_default(
         options.autotune_options().cpu_budget(), 0, GetCpuBudget());
     params.autotune_ram_budget =
@@ -91,6 +98,11 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
           threadpool_size_);
     }
     cancellation_manager_ = absl::make_unique<CancellationManager>();
+    // Without a registered pipeline, buffers reserve no memory and are only
+    // bounded by their own sizes.
+    if (GetExperiments().contains(kMemoryAccountantExperiment)) {
+      memory_pipeline_ = MemoryAccountant::Global()->RegisterPipeline();
+    }
   }
 
   ~Iterator() override { cancellation_manager_->StartCancel(); }
@@ -146,6 +158,7 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
     if (dataset()->params_.autotune) {
       params.model = model_;
     }
+    params.memory_pipeline = memory_pipeline_;
     if (dataset()->params_.private_threadpool_size >= 0) {
       params.runner = [pool = thread_pool_.get()](std::function<void()> c) {
         pool->Schedule(std::move(c));
@@ -156,6 +169,13 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
       params.runner =
           RunnerWithMaxParallelism(params.runner, max_intra_op_parallelism_);
     }
+    if (dataset()->params_.private_threadpool_size >= 0 ||
+        dataset()->params_.max_intra_op_parallelism >= 0) {
+      // Keep all closures of the pipeline on its runner, which enforces the
+      // private threadpool and the maximum intra-op parallelism.
+      params.compute_pool = nullptr;
+      params.blocking_pool = nullptr;
+    }
     return params;
   }
 
@@ -185,6 +205,9 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
   int64_t max_intra_op_parallelism_;
   int64_t threadpool_size_;
   std::unique_ptr<thread::ThreadPool> thread_pool_;
+  // Accounts for the elements buffered by the input pipeline against the
+  // process-wide tf.data memory budget.
+  std::shared_ptr<MemoryAccountant::Pipeline> memory_pipeline_;
 
   // Must be ordered last as its execution may depend on other members.
   std::unique_ptr<IteratorBase> input_impl_;
@@ -196,11 +219,18 @@ RootDataset::RootDataset(const DatasetBase* input, Params params)
       input_(input),
       params_(std::move(params)) {
   if (params_.autotune) {
-    traceme_metadata_.push_back(std::make_pair(
-        kAlgorithm,
-        params_.autotune_algorithm == model::AutotuneAlgorithm::HILL_CLIMB
-            ? kHillClimb
-            : kGradientDescent));
+    const char* algorithm;
+    switch (params_.autotune_algorithm) {
+      case model::AutotuneAlgorithm::HILL_CLIMB:
+        algorithm = kHillClimb;
+        break;
+      case model::AutotuneAlgorithm::CRITICAL_PATH:
+        algorithm = kCriticalPath;
+        break;
+      default:
+        algorithm = kGradientDescent;
+    }
+    traceme_metadata_.push_back(std::make_pair(kAlgorithm, algorithm));
     traceme_metadata_.push_back(std::make_pair(
         kCpuBudget, strings::Printf("%lld", static_cast<long long>(
                                                 params_.autotune_cpu_budget))));
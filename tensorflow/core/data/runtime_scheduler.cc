@@ -0,0 +1,180 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/runtime_scheduler.h"
+
+#include <algorithm>
+
+#include "absl/memory/memory.h"
+#include "tensorflow/core/framework/metrics.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+constexpr char kComputePool[] = "tf_data_compute";
+constexpr char kBlockingPool[] = "tf_data_blocking";
+constexpr char kDedicatedPool[] = "tf_data_dedicated";
+
+// The number of threads of the shared pool for closures that block on I/O.
+constexpr int kNumBlockingThreads = 8;
+
+// The pool and the index of the thread that the current thread belongs to, if
+// any.
+thread_local const WorkStealingThreadPool* current_pool = nullptr;
+thread_local int current_thread_id = -1;
+
+}  // namespace
+
+WorkStealingThreadPool::WorkStealingThreadPool(Env* env, const string& name,
+                                               int num_threads)
+    : name_(name) {
+  DCHECK_GT(num_threads, 0);
+  num_threads = std::max(num_threads, 1);
+  queues_.reserve(num_threads);
+  for (int i = 0; i < num_threads; ++i) {
+    queues_.push_back(absl::make_unique<Queue>());
+  }
+  threads_.reserve(num_threads);
+  for (int i = 0; i < num_threads; ++i) {
+    threads_.push_back(absl::WrapUnique(
+        env->StartThread({}, name_, [this, i]() { WorkerThread(i); })));
+  }
+  metrics::RecordTFDataRuntimeThreads(name_, num_threads);
+}
+
+WorkStealingThreadPool::~WorkStealingThreadPool() {
+  {
+    mutex_lock l(mu_);
+    cancelled_ = true;
+    cond_var_.notify_all();
+  }
+  // Wait for the threads to run the remaining closures and exit.
+  threads_.clear();
+  metrics::RecordTFDataRuntimeThreads(name_, 0);
+}
+
+void WorkStealingThreadPool::Schedule(std::function<void()> fn) {
+  const size_t id = current_pool == this
+                        ? current_thread_id
+                        : next_queue_.fetch_add(1) % queues_.size();
+  {
+    mutex_lock l(queues_[id]->mu);
+    queues_[id]->closures.push_back(std::move(fn));
+  }
+  ++num_pending_;
+  // A sleeping thread increments `num_sleeping_` before it checks
+  // `num_pending_`, so either it observes the new closure or it is notified.
+  if (num_sleeping_ > 0) {
+    mutex_lock l(mu_);
+    cond_var_.notify_one();
+  }
+}
+
+int WorkStealingThreadPool::NumThreads() const { return queues_.size(); }
+
+int WorkStealingThreadPool::CurrentThreadId() const {
+  return current_pool == this ? current_thread_id : -1;
+}
+
+void WorkStealingThreadPool::WorkerThread(int id) {
+  current_pool = this;
+  current_thread_id = id;
+  std::function<void()> fn;
+  while (true) {
+    if (Pop(id, &fn)) {
+      fn();
+      fn = nullptr;
+      continue;
+    }
+    mutex_lock l(mu_);
+    ++num_sleeping_;
+    while (num_pending_ <= 0 && !cancelled_) {
+      metrics::RecordTFDataRuntimeContextSwitch(name_);
+      cond_var_.wait(l);
+    }
+    --num_sleeping_;
+    if (num_pending_ <= 0 && cancelled_) {
+      return;
+    }
+  }
+}
+
+bool WorkStealingThreadPool::Pop(int id, std::function<void()>* fn) {
+  {
+    Queue& queue = *queues_[id];
+    mutex_lock l(queue.mu);
+    if (!queue.closures.empty()) {
+      *fn = std::move(queue.closures.back());
+      queue.closures.pop_back();
+      --num_pending_;
+      return true;
+    }
+  }
+  for (size_t i = 1; i < queues_.size(); ++i) {
+    Queue& queue = *queues_[(id + i) % queues_.size()];
+    mutex_lock l(queue.mu);
+    if (!queue.closures.empty()) {
+      *fn = std::move(queue.closures.front());
+      queue.closures.pop_front();
+      --num_pending_;
+      metrics::RecordTFDataRuntimeSteal(name_);
+      return true;
+    }
+  }
+  return false;
+}
+
+// Starts logical threads in the dedicated pool of a `RuntimeScheduler` and
+// keeps track of the number of logical threads which are running.
+class RuntimeScheduler::CountingThreadFactory : public ThreadFactory {
+ public:
+  explicit CountingThreadFactory(RuntimeScheduler* scheduler)
+      : scheduler_(scheduler),
+        thread_factory_(scheduler->dedicated_pool_.get_thread_factory()) {}
+
+  std::unique_ptr<Thread> StartThread(const string& name,
+                                      std::function<void()> fn) override {
+    metrics::RecordTFDataRuntimeThreads(
+        kDedicatedPool, ++scheduler_->num_logical_threads_);
+    return thread_factory_->StartThread(
+        name, [scheduler = scheduler_, fn = std::move(fn)]() {
+          fn();
+          metrics::RecordTFDataRuntimeThreads(
+              kDedicatedPool, --scheduler->num_logical_threads_);
+        });
+  }
+
+ private:
+  RuntimeScheduler* const scheduler_;  // Not owned.
+  const std::shared_ptr<ThreadFactory> thread_factory_;
+};
+
+RuntimeScheduler::RuntimeScheduler(Env* env, int num_compute_threads,
+                                   int num_blocking_threads)
+    : compute_pool_(env, kComputePool, num_compute_threads),
+      blocking_pool_(env, kBlockingPool, num_blocking_threads),
+      dedicated_pool_(env, kDedicatedPool),
+      thread_factory_(std::make_shared<CountingThreadFactory>(this)) {}
+
+RuntimeScheduler* RuntimeScheduler::Global() {
+  static RuntimeScheduler* scheduler = new RuntimeScheduler(
+      Env::Default(), port::MaxParallelism(), kNumBlockingThreads);
+  return scheduler;
+}
+
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,134 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_RUNTIME_SCHEDULER_H_
+#define TENSORFLOW_CORE_DATA_RUNTIME_SCHEDULER_H_
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/data/unbounded_thread_pool.h"
+#include "tensorflow/core/framework/thread_factory.h"
+#include "tensorflow/core/lib/core/threadpool_interface.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace data {
+
+// A `WorkStealingThreadPool` executes closures on a fixed number of threads,
+// each of which owns a queue of closures. Closures scheduled from a thread of
+// the pool are added to the queue of that thread, which executes the most
+// recently added closure first. Other closures are distributed over the queues
+// round-robin. A thread whose queue is empty steals the oldest closure from the
+// queue of another thread before it goes to sleep.
+//
+// Since the number of threads is fixed, closures which block can starve the
+// pool and should be scheduled elsewhere.
+class WorkStealingThreadPool : public thread::ThreadPoolInterface {
+ public:
+  // `name` is used to name the threads and to export the metrics of the pool.
+  WorkStealingThreadPool(Env* env, const string& name, int num_threads);
+
+  // Waits for all scheduled closures to execute.
+  ~WorkStealingThreadPool() override;
+
+  void Schedule(std::function<void()> fn) override;
+  int NumThreads() const override;
+  int CurrentThreadId() const override;
+
+ private:
+  struct Queue {
+    mutex mu;
+    std::deque<std::function<void()>> closures TF_GUARDED_BY(mu);
+  };
+
+  void WorkerThread(int id);
+
+  // Pops a closure from the queue of thread `id`, or steals one from the queue
+  // of another thread. Returns false if all queues are empty.
+  bool Pop(int id, std::function<void()>* fn);
+
+  const string name_;
+  std::vector<std::unique_ptr<Queue>> queues_;
+  // The number of closures in all queues.
+  std::atomic<int64_t> num_pending_{0};
+  // The number of threads waiting on `cond_var_`.
+  std::atomic<int64_t> num_sleeping_{0};
+  std::atomic<uint64_t> next_queue_{0};
+  mutex mu_;
+  condition_variable cond_var_;
+  bool cancelled_ TF_GUARDED_BY(mu_) = false;
+  std::vector<std::unique_ptr<Thread>> threads_;
+};
+
+// A `RuntimeScheduler` provides the threads of tf.data input pipelines. It runs
+//
+// - short closures which do not block on a `WorkStealingThreadPool` with one
+//   thread per core,
+// - closures which block on I/O on a small, separate `WorkStealingThreadPool`,
+// - and the logical threads started by iterators on an `UnboundedThreadPool`.
+//
+// Input pipelines which share a scheduler share its threads, instead of each
+// pipeline creating threads of its own. Iterators opt into the compute and
+// blocking pools through `IteratorContext::ScheduleCompute()` and
+// `IteratorContext::ScheduleBlocking()`, e.g. for the function calls of
+// parallel map. Iterator threads, which block on condition variables, still
+// run on the unbounded dedicated pool.
+class RuntimeScheduler {
+ public:
+  RuntimeScheduler(Env* env, int num_compute_threads,
+                   int num_blocking_threads);
+
+  // Returns the scheduler shared by all input pipelines of the process.
+  static RuntimeScheduler* Global();
+
+  // The pool for short closures which do not block.
+  thread::ThreadPoolInterface* compute_pool() { return &compute_pool_; }
+
+  // The pool for closures which block on I/O.
+  thread::ThreadPoolInterface* blocking_pool() { return &blocking_pool_; }
+
+  // The pool for long-running closures which may block on other closures,
+  // suitable for `IteratorContext::Params::thread_pool`.
+  thread::ThreadPoolInterface* dedicated_pool() { return &dedicated_pool_; }
+
+  // Returns an implementation of `ThreadFactory` that starts logical threads
+  // in the dedicated pool.
+  std::shared_ptr<ThreadFactory> get_thread_factory() {
+    return thread_factory_;
+  }
+
+  // Returns the number of logical threads started by the factory which are
+  // still running.
+  int64_t num_logical_threads() const { return num_logical_threads_; }
+
+ private:
+  class CountingThreadFactory;
+
+  WorkStealingThreadPool compute_pool_;
+  WorkStealingThreadPool blocking_pool_;
+  UnboundedThreadPool dedicated_pool_;
+  std::atomic<int64_t> num_logical_threads_{0};
+  const std::shared_ptr<ThreadFactory> thread_factory_;
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_RUNTIME_SCHEDULER_H_
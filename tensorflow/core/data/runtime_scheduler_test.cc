@@ -0,0 +1,121 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/runtime_scheduler.h"
+
+#include "tensorflow/core/lib/core/blocking_counter.h"
+#include "tensorflow/core/lib/core/notification.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+TEST(WorkStealingThreadPool, NestedSchedule) {
+  WorkStealingThreadPool pool(Env::Default(), "test", /*num_threads=*/4);
+
+  // Schedule ten closures that each schedule ten closures from a thread of the
+  // pool, and ensure that they all run to completion.
+  const int kNumClosures = 10;
+  BlockingCounter counter(kNumClosures * kNumClosures);
+  for (int i = 0; i < kNumClosures; ++i) {
+    pool.Schedule([&pool, &counter]() {
+      EXPECT_GE(pool.CurrentThreadId(), 0);
+      EXPECT_LT(pool.CurrentThreadId(), pool.NumThreads());
+      for (int j = 0; j < kNumClosures; ++j) {
+        pool.Schedule([&counter]() { counter.DecrementCount(); });
+      }
+    });
+  }
+  counter.Wait();
+  EXPECT_EQ(pool.CurrentThreadId(), -1);
+}
+
+TEST(WorkStealingThreadPool, StealFromBlockedThread) {
+  WorkStealingThreadPool pool(Env::Default(), "test", /*num_threads=*/2);
+
+  // The closures are added to the queue of the thread which schedules them. As
+  // that thread waits for them, they can only run if another thread steals
+  // them.
+  const int kNumClosures = 10;
+  Notification done;
+  pool.Schedule([&pool, &done]() {
+    BlockingCounter counter(kNumClosures);
+    for (int i = 0; i < kNumClosures; ++i) {
+      pool.Schedule([&counter]() { counter.DecrementCount(); });
+    }
+    counter.Wait();
+    done.Notify();
+  });
+  done.WaitForNotification();
+}
+
+TEST(WorkStealingThreadPool, DestructorRunsPendingClosures) {
+  const int kNumClosures = 100;
+  std::atomic<int> i(0);
+  {
+    WorkStealingThreadPool pool(Env::Default(), "test", /*num_threads=*/2);
+    for (int j = 0; j < kNumClosures; ++j) {
+      pool.Schedule([&i]() { ++i; });
+    }
+  }
+  EXPECT_EQ(i, kNumClosures);
+}
+
+TEST(RuntimeScheduler, BlockingClosuresDoNotStarveCompute) {
+  RuntimeScheduler scheduler(Env::Default(), /*num_compute_threads=*/1,
+                             /*num_blocking_threads=*/2);
+
+  // Occupy all threads of the blocking pool, and ensure that closures in the
+  // compute pool still make progress.
+  Notification unblock;
+  BlockingCounter blocked(2);
+  for (int i = 0; i < 2; ++i) {
+    scheduler.blocking_pool()->Schedule([&unblock, &blocked]() {
+      blocked.DecrementCount();
+      unblock.WaitForNotification();
+    });
+  }
+  blocked.Wait();
+  Notification computed;
+  scheduler.compute_pool()->Schedule([&computed]() { computed.Notify(); });
+  computed.WaitForNotification();
+  unblock.Notify();
+}
+
+TEST(RuntimeScheduler, CountLogicalThreads) {
+  RuntimeScheduler scheduler(Env::Default(), /*num_compute_threads=*/1,
+                             /*num_blocking_threads=*/1);
+  auto thread_factory = scheduler.get_thread_factory();
+
+  std::vector<std::unique_ptr<Thread>> threads;
+  const int kNumThreads = 5;
+  Notification n;
+  BlockingCounter started(kNumThreads);
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.push_back(thread_factory->StartThread("", [&n, &started]() {
+      started.DecrementCount();
+      n.WaitForNotification();
+    }));
+  }
+  started.Wait();
+  EXPECT_EQ(scheduler.num_logical_threads(), kNumThreads);
+  n.Notify();
+  threads.clear();
+  EXPECT_EQ(scheduler.num_logical_threads(), 0);
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
@@ -84,6 +84,11 @@ class WorkerIndexResolver {
   // NotFound error if the worker is not registered.
   StatusOr<int64_t> GetWorkerIndex(absl::string_view worker_address) const;
 
+  // Returns the worker addresses, with ports replaced for the added workers.
+  const std::vector<std::string>& worker_addresses() const {
+    return worker_addresses_;
+  }
+
  private:
   std::vector<std::string> worker_addresses_;
 };
@@ -26,6 +26,7 @@ limitations under the License.
 #include "tensorflow/core/platform/status_matchers.h"
 #include "tensorflow/core/platform/statusor.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/platform/tstring.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/protobuf/data_service.pb.h"
@@ -95,6 +96,28 @@ TEST(DataServiceTest, RangeDataset_DynamicShard) {
   EXPECT_THAT(result, UnorderedElementsAreArray(Range(20)));
 }
 
+TEST(DataServiceTest, RangeDataset_DynamicShardWithSplitPrefetch) {
+  TestCluster::Config config;
+  config.num_workers = 5;
+  config.split_prefetch_window = 8;
+  TestCluster cluster(config);
+  TF_ASSERT_OK(cluster.Initialize());
+  DatasetClient<int64_t> dataset_client(cluster);
+
+  TF_ASSERT_OK_AND_ASSIGN(
+      DatasetClient<int64_t>::WorkerResultMap worker_results,
+      dataset_client.Read(RangeDataset(100), ProcessingModeDef::DYNAMIC,
+                          TARGET_WORKERS_AUTO));
+
+  // Each split is produced by exactly one worker.
+  std::vector<int64_t> result;
+  for (const auto& worker_result : worker_results) {
+    result.insert(result.end(), worker_result.second.begin(),
+                  worker_result.second.end());
+  }
+  EXPECT_THAT(result, UnorderedElementsAreArray(Range(100)));
+}
+
 using DataServiceTest_DataShard =
     ::testing::TestWithParam<ProcessingModeDef::ShardingPolicy>;
 
@@ -258,6 +281,119 @@ TEST(DataServiceTest, GetWorkers) {
   EXPECT_EQ(1, workers.size());
 }
 
+TEST(DataServiceTest, RetriedGetSplitsReturnsSameSplits) {
+  TestCluster cluster(/*num_workers=*/1);
+  TF_ASSERT_OK(cluster.Initialize());
+  DataServiceDispatcherClient dispatcher(cluster.DispatcherAddress(), "grpc");
+  int64_t dataset_id = 0;
+  TF_ASSERT_OK(dispatcher.RegisterDataset(RangeDataset(1000),
+                                          /*element_spec=*/absl::nullopt,
+                                          dataset_id));
+  ProcessingModeDef processing_mode;
+  processing_mode.set_sharding_policy(ProcessingModeDef::DYNAMIC);
+  int64_t job_client_id = 0;
+  TF_ASSERT_OK(dispatcher.GetOrCreateJob(
+      dataset_id, processing_mode, /*job_key=*/absl::nullopt,
+      /*num_consumers=*/absl::nullopt, TARGET_WORKERS_AUTO, job_client_id));
+  ClientHeartbeatRequest req;
+  req.set_job_client_id(job_client_id);
+  ClientHeartbeatResponse resp;
+  TF_ASSERT_OK(dispatcher.ClientHeartbeat(req, resp));
+  ASSERT_EQ(resp.task_info_size(), 1);
+  const int64_t job_id = resp.task_info(0).job_id();
+
+  std::vector<Tensor> splits, retried_splits, next_splits;
+  bool end_of_splits = false;
+  TF_ASSERT_OK(dispatcher.GetSplits(job_id, /*repetition=*/0,
+                                    /*split_provider_index=*/0,
+                                    /*max_splits=*/4, /*requester_id=*/7,
+                                    /*sequence_number=*/1, splits,
+                                    end_of_splits));
+  TF_ASSERT_OK(dispatcher.GetSplits(job_id, /*repetition=*/0,
+                                    /*split_provider_index=*/0,
+                                    /*max_splits=*/4, /*requester_id=*/7,
+                                    /*sequence_number=*/1, retried_splits,
+                                    end_of_splits));
+  TF_ASSERT_OK(dispatcher.GetSplits(job_id, /*repetition=*/0,
+                                    /*split_provider_index=*/0,
+                                    /*max_splits=*/4, /*requester_id=*/7,
+                                    /*sequence_number=*/2, next_splits,
+                                    end_of_splits));
+  ASSERT_EQ(splits.size(), 4);
+  ASSERT_EQ(retried_splits.size(), 4);
+  ASSERT_EQ(next_splits.size(), 4);
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(retried_splits[i].DebugString(), splits[i].DebugString());
+    EXPECT_NE(next_splits[i].DebugString(), splits[i].DebugString());
+  }
+}
+
+TEST(DataServiceTest, RetriedSingleSplitRequestReturnsSameSplit) {
+  TestCluster cluster(/*num_workers=*/1);
+  TF_ASSERT_OK(cluster.Initialize());
+  DataServiceDispatcherClient dispatcher(cluster.DispatcherAddress(), "grpc");
+  int64_t dataset_id = 0;
+  TF_ASSERT_OK(dispatcher.RegisterDataset(RangeDataset(1000),
+                                          /*element_spec=*/absl::nullopt,
+                                          dataset_id));
+  ProcessingModeDef processing_mode;
+  processing_mode.set_sharding_policy(ProcessingModeDef::DYNAMIC);
+  int64_t job_client_id = 0;
+  TF_ASSERT_OK(dispatcher.GetOrCreateJob(
+      dataset_id, processing_mode, /*job_key=*/absl::nullopt,
+      /*num_consumers=*/absl::nullopt, TARGET_WORKERS_AUTO, job_client_id));
+  ClientHeartbeatRequest req;
+  req.set_job_client_id(job_client_id);
+  ClientHeartbeatResponse resp;
+  TF_ASSERT_OK(dispatcher.ClientHeartbeat(req, resp));
+  ASSERT_EQ(resp.task_info_size(), 1);
+  const int64_t job_id = resp.task_info(0).job_id();
+
+  // Request 2 is sent twice, as if the response to its first attempt was
+  // lost. The retry must return the lost split instead of skipping it, and
+  // the next request must not return it again.
+  std::vector<std::vector<Tensor>> splits;
+  for (int64_t sequence_number : {1, 2, 2, 3}) {
+    std::vector<Tensor> response;
+    bool end_of_splits = false;
+    TF_ASSERT_OK(dispatcher.GetSplits(job_id, /*repetition=*/0,
+                                      /*split_provider_index=*/0,
+                                      /*max_splits=*/1, /*requester_id=*/7,
+                                      sequence_number, response,
+                                      end_of_splits));
+    ASSERT_FALSE(end_of_splits);
+    ASSERT_EQ(response.size(), 1);
+    splits.push_back(std::move(response));
+  }
+  const std::string lost_split = splits[1][0].DebugString();
+  EXPECT_EQ(splits[2][0].DebugString(), lost_split);
+  EXPECT_NE(splits[0][0].DebugString(), lost_split);
+  EXPECT_NE(splits[3][0].DebugString(), lost_split);
+}
+
+// Reads a dynamically sharded range dataset, where every element is a split,
+// from a local cluster to measure how many splits per second the dispatcher
+// hands out. `state.range(0)` is the workers' split prefetch window.
+void BM_DynamicShardSplits(::testing::benchmark::State& state) {
+  constexpr int64_t kNumSplits = 10000;
+  TestCluster::Config config;
+  config.num_workers = 4;
+  config.split_prefetch_window = state.range(0);
+  TestCluster cluster(config);
+  TF_CHECK_OK(cluster.Initialize());
+  DatasetClient<int64_t> dataset_client(cluster);
+
+  for (auto s : state) {
+    StatusOr<DatasetClient<int64_t>::WorkerResultMap> result =
+        dataset_client.Read(RangeDataset(kNumSplits),
+                            ProcessingModeDef::DYNAMIC, TARGET_WORKERS_AUTO);
+    TF_CHECK_OK(result.status());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumSplits);
+}
+
+BENCHMARK(BM_DynamicShardSplits)->Arg(0)->Arg(16)->Arg(128);
+
 }  // namespace
 }  // namespace data
 }  // namespace tensorflow
@@ -113,6 +113,49 @@ Status DataServiceDispatcherClient::GetSplit(int64_t job_id, int64_t repetition,
   return Status::OK();
 }
 
+Status DataServiceDispatcherClient::GetSplits(int64_t job_id,
+                                              int64_t repetition,
+                                              int64_t split_provider_index,
+                                              int64_t max_splits,
+                                              int64_t requester_id,
+                                              int64_t sequence_number,
+                                              std::vector<Tensor>& splits,
+                                              bool& end_of_splits) {
+  TF_RETURN_IF_ERROR(EnsureInitialized());
+  GetSplitRequest req;
+  req.set_job_id(job_id);
+  req.set_repetition(repetition);
+  req.set_split_provider_index(split_provider_index);
+  req.set_max_splits(max_splits);
+  req.set_requester_id(requester_id);
+  req.set_sequence_number(sequence_number);
+  GetSplitResponse resp;
+  grpc::ClientContext client_ctx;
+  grpc::Status status = stub_->GetSplit(&client_ctx, req, &resp);
+  if (!status.ok()) {
+    return grpc_util::WrapError("Failed to get splits", status);
+  }
+  splits.clear();
+  splits.reserve(resp.splits_size());
+  for (const TensorProto& split_proto : resp.splits()) {
+    Tensor split;
+    if (!split.FromProto(split_proto)) {
+      return errors::Internal("Failed to parse split tensor proto");
+    }
+    splits.push_back(std::move(split));
+  }
+  end_of_splits = resp.end_of_splits();
+  // Dispatchers which don't batch splits return a single split.
+  if (splits.empty() && !end_of_splits) {
+    Tensor split;
+    if (!split.FromProto(resp.split())) {
+      return errors::Internal("Failed to parse split tensor proto");
+    }
+    splits.push_back(std::move(split));
+  }
+  return Status::OK();
+}
+
 Status DataServiceDispatcherClient::RegisterDataset(
     const DatasetDef& dataset, const absl::optional<std::string>& element_spec,
     int64_t& dataset_id) {
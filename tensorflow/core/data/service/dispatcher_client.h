@@ -64,6 +64,15 @@ class DataServiceDispatcherClient : public DataServiceClientBase {
                   int64_t split_provider_index, Tensor& split,
                   bool& end_of_splits);
 
+  // Gets up to `max_splits` next splits for the specified job id, repetition,
+  // and split provider index. `end_of_splits` indicates that the split
+  // provider ended after the returned splits. Retrying a call with the same
+  // `requester_id` and `sequence_number` returns the same splits.
+  Status GetSplits(int64_t job_id, int64_t repetition,
+                   int64_t split_provider_index, int64_t max_splits,
+                   int64_t requester_id, int64_t sequence_number,
+                   std::vector<Tensor>& splits, bool& end_of_splits);
+
   // Registers a dataset with the tf.data service, and stores the generated
   // dataset id in `dataset_id`.
   Status RegisterDataset(const DatasetDef& dataset,
@@ -72,6 +72,9 @@ constexpr char kDatasetsDir[] = "datasets";
 constexpr int64_t kDefaultJobGcCheckIntervalMs = 10 * 60 * 1000;  // 10 minutes.
 constexpr int64_t kDefaultJobGcTimeoutMs = 5 * 60 * 1000;         // 5 minutes.
 constexpr int64_t kDefaultClientTimeoutMs = 2 * 60 * 1000;        // 2 minutes.
+constexpr int64_t kDefaultJournalSnapshotInterval = 10000;
+// Bounds how long a single GetSplit request holds the dispatcher lock.
+constexpr int64_t kMaxSplitsPerRequest = 1024;
 
 constexpr std::array<const char*, 8> kNodeNameSharingOps = {
     "HashTable",
@@ -143,6 +146,9 @@ DispatcherConfig ApplyConfigDefaults(const DispatcherConfig& config) {
   if (new_config.client_timeout_ms() == 0) {
     new_config.set_client_timeout_ms(kDefaultClientTimeoutMs);
   }
+  if (new_config.journal_snapshot_interval() == 0) {
+    new_config.set_journal_snapshot_interval(kDefaultJournalSnapshotInterval);
+  }
   return new_config;
 }
 
@@ -195,17 +201,32 @@ Status DataServiceDispatcherImpl::Start() {
       env_, JournalDir(config_.work_dir()));
   LOG(INFO) << "Attempting to restore dispatcher state from journal in "
             << JournalDir(config_.work_dir());
+  int64_t start_sequence_number = 0;
+  DispatcherStateSnapshot snapshot;
+  Status s = ReadLatestJournalSnapshot(env_, JournalDir(config_.work_dir()),
+                                       snapshot, start_sequence_number);
+  if (s.ok()) {
+    LOG(INFO) << "Restoring dispatcher state from journal snapshot "
+              << start_sequence_number;
+    TF_RETURN_IF_ERROR(state_.Restore(snapshot));
+  } else if (!errors::IsNotFound(s)) {
+    return s;
+  }
   Update update;
   bool end_of_journal = false;
-  FileJournalReader reader(env_, JournalDir(config_.work_dir()));
-  Status s = reader.Read(update, end_of_journal);
+  FileJournalReader reader(env_, JournalDir(config_.work_dir()),
+                           start_sequence_number);
+  s = reader.Read(update, end_of_journal);
   if (errors::IsNotFound(s)) {
-    LOG(INFO) << "No journal found. Starting dispatcher from new state.";
+    if (start_sequence_number == 0) {
+      LOG(INFO) << "No journal found. Starting dispatcher from new state.";
+    }
   } else if (!s.ok()) {
     return s;
   } else {
     while (!end_of_journal) {
       TF_RETURN_IF_ERROR(ApplyWithoutJournaling(update));
+      ++updates_since_snapshot_;
       TF_RETURN_IF_ERROR(reader.Read(update, end_of_journal));
     }
   }
@@ -367,6 +388,9 @@ Status DataServiceDispatcherImpl::WorkerUpdate(
       TF_RETURN_IF_ERROR(Apply(update));
       VLOG(3) << "Task " << task_id << " from job " << task->job->job_id
               << " completed";
+      if (task->job->finished) {
+        split_batches_.erase(task->job->job_id);
+      }
     }
   }
   return Status::OK();
@@ -400,6 +424,21 @@ Status DataServiceDispatcherImpl::GetSplit(const GetSplitRequest* request,
         "Cannot get split for job ", job_id,
         ", since it is not a distributed_epoch job.");
   }
+  const bool batched = request->max_splits() > 1;
+  // Any request with a sequence number may be a retry, including requests for
+  // a single split, so its response is kept until the next request.
+  const bool replayable = request->sequence_number() > 0;
+  if (replayable) {
+    const auto& batches = split_batches_[job_id];
+    auto it = batches.find(request->requester_id());
+    if (it != batches.end() &&
+        it->second.sequence_number == request->sequence_number()) {
+      VLOG(1) << "Returning the splits of retried GetSplit request "
+              << request->sequence_number() << " for job " << job_id;
+      *response = it->second.response;
+      return Status::OK();
+    }
+  }
   int64_t current_repetition =
       job->distributed_epoch_state.value().repetitions[provider_index];
   if (repetition < current_repetition) {
@@ -412,17 +451,36 @@ Status DataServiceDispatcherImpl::GetSplit(const GetSplitRequest* request,
   SplitProvider* split_provider =
       split_providers_[job_id][provider_index].get();
   DCHECK(split_provider != nullptr);
-  Tensor split;
+  const int64_t max_splits =
+      batched ? std::min(request->max_splits(), kMaxSplitsPerRequest) : 1;
+  int64_t num_splits = 0;
   bool end_of_splits = false;
-  TF_RETURN_IF_ERROR(split_provider->GetNext(&split, &end_of_splits));
-  TF_RETURN_IF_ERROR(RecordSplitProduced(
-      job_id, repetition, request->split_provider_index(), end_of_splits));
-  response->set_end_of_splits(end_of_splits);
+  while (num_splits < max_splits) {
+    Tensor split;
+    TF_RETURN_IF_ERROR(split_provider->GetNext(&split, &end_of_splits));
+    if (end_of_splits) {
+      break;
+    }
+    ++num_splits;
+    if (batched) {
+      split.AsProtoTensorContent(response->add_splits());
+    } else {
+      split.AsProtoTensorContent(response->mutable_split());
+    }
+  }
+  // The splits are journaled before they are returned, so that a restarted
+  // dispatcher never hands out the same split twice.
+  TF_RETURN_IF_ERROR(RecordSplitProduced(job_id, repetition, provider_index,
+                                         num_splits, end_of_splits));
   if (end_of_splits) {
     // Reset the split provider to prepare for the next repetition.
-    TF_RETURN_IF_ERROR(split_providers_[job_id][provider_index]->Reset());
-  } else {
-    split.AsProtoTensorContent(response->mutable_split());
+    TF_RETURN_IF_ERROR(split_provider->Reset());
+  }
+  response->set_end_of_splits(end_of_splits);
+  if (replayable) {
+    SplitBatch& batch = split_batches_[job_id][request->requester_id()];
+    batch.sequence_number = request->sequence_number();
+    batch.response = *response;
   }
   VLOG(3) << "Returning from GetSplit, end_of_splits=" << end_of_splits;
   return Status::OK();
@@ -995,13 +1053,14 @@ Status DataServiceDispatcherImpl::CheckStarted() TF_LOCKS_EXCLUDED(mu_) {
 
 Status DataServiceDispatcherImpl::RecordSplitProduced(
     int64_t job_id, int64_t repetition, int64_t split_provider_index,
-    bool finished) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    int64_t num_splits, bool finished) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
   Update update;
   ProduceSplitUpdate* produce_split = update.mutable_produce_split();
   produce_split->set_job_id(job_id);
   produce_split->set_repetition(repetition);
   produce_split->set_split_provider_index(split_provider_index);
   produce_split->set_finished(finished);
+  produce_split->set_num_splits(num_splits);
   return Apply(update);
 }
 
@@ -1012,10 +1071,22 @@ Status DataServiceDispatcherImpl::ApplyWithoutJournaling(const Update& update)
 
 Status DataServiceDispatcherImpl::Apply(const Update& update)
     TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
-  if (journal_writer_.has_value()) {
-    TF_RETURN_IF_ERROR(journal_writer_.value()->Write(update));
+  if (!journal_writer_.has_value()) {
+    return state_.Apply(update);
   }
-  return state_.Apply(update);
+  TF_RETURN_IF_ERROR(journal_writer_.value()->Write(update));
+  TF_RETURN_IF_ERROR(state_.Apply(update));
+  if (config_.journal_snapshot_interval() > 0 &&
+      ++updates_since_snapshot_ >= config_.journal_snapshot_interval()) {
+    // The update is already durable, so failing to snapshot only delays
+    // truncating the journal.
+    Status s = journal_writer_.value()->WriteSnapshot(state_.Snapshot());
+    if (!s.ok()) {
+      LOG(WARNING) << "Failed to snapshot dispatcher state: " << s;
+    }
+    updates_since_snapshot_ = 0;
+  }
+  return Status::OK();
 }
 
 void DataServiceDispatcherImpl::JobGcThread() {
@@ -1080,6 +1151,7 @@ Status DataServiceDispatcherImpl::GcOldJobs() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
     Update update;
     update.mutable_garbage_collect_job()->set_job_id(job->job_id);
     TF_RETURN_IF_ERROR(state_.Apply(update));
+    split_batches_.erase(job->job_id);
     LOG(INFO) << "Garbage collected job " << job->DebugString();
   }
   return Status::OK();
@@ -132,8 +132,9 @@ class DataServiceDispatcherImpl {
 
   ~DataServiceDispatcherImpl();
 
-  // Starts the dispatcher. If there is a journal, this will read from the
-  // journal to restore the dispatcher's state.
+  // Starts the dispatcher. If there is a journal, this will restore the latest
+  // journal snapshot and read the journal after it to restore the
+  // dispatcher's state.
   Status Start();
 
   // Returns the number of active jobs.
@@ -263,10 +264,11 @@ class DataServiceDispatcherImpl {
       TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
   // Checks that the dispatcher has started, returning UNAVAILABLE if it hasn't.
   Status CheckStarted() TF_LOCKS_EXCLUDED(mu_);
-  // Records that a split was produced by a call to `GetSplit`.
+  // Records that `num_splits` splits were produced by a call to `GetSplit`,
+  // and whether the split provider reached its end.
   Status RecordSplitProduced(int64_t job_id, int64_t repetition,
-                             int64_t split_provider_index, bool finished)
-      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+                             int64_t split_provider_index, int64_t num_splits,
+                             bool finished) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
   // Applies a state update, updating both the journal and the in-memory state.
   Status Apply(const Update& update) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
   // Applies a state update, but doesn't update the journal. Only meant to be
@@ -305,6 +307,15 @@ class DataServiceDispatcherImpl {
   // Mapping from job id to the split providers for the job.
   absl::flat_hash_map<int64_t, std::vector<std::unique_ptr<SplitProvider>>>
       split_providers_ TF_GUARDED_BY(mu_);
+  // The last batched `GetSplit` response to a requester.
+  struct SplitBatch {
+    int64_t sequence_number = 0;
+    GetSplitResponse response;
+  };
+  // Mapping from job id to the last split batch of each requester of the job,
+  // keyed by requester id. Retried requests are answered from here.
+  absl::flat_hash_map<int64_t, absl::flat_hash_map<int64_t, SplitBatch>>
+      split_batches_ TF_GUARDED_BY(mu_);
   // Mapping from round robin job id to the round the job is currently on. This
   // is based on the data provided by client heartbeats, and may be stale.
   absl::flat_hash_map<int64_t, int64_t> round_robin_rounds_ TF_GUARDED_BY(mu_);
@@ -317,6 +328,8 @@ class DataServiceDispatcherImpl {
 
   absl::optional<std::unique_ptr<JournalWriter>> journal_writer_
       TF_GUARDED_BY(mu_);
+  // Number of updates written to the journal since the last snapshot.
+  int64_t updates_since_snapshot_ TF_GUARDED_BY(mu_) = 0;
   DispatcherState state_ TF_GUARDED_BY(mu_);
   // Condition variable for waking up the job gc thread.
   condition_variable job_gc_thread_cv_;
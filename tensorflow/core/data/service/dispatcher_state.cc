@@ -14,7 +14,9 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/data/service/dispatcher_state.h"
 
+#include <algorithm>
 #include <memory>
+#include <queue>
 #include <string>
 #include <vector>
 
@@ -31,6 +33,22 @@ limitations under the License.
 
 namespace tensorflow {
 namespace data {
+namespace {
+
+// Returns the keys of `map` in sorted order, so that snapshots are
+// deterministic.
+template <typename Map>
+std::vector<typename Map::key_type> SortedKeys(const Map& map) {
+  std::vector<typename Map::key_type> keys;
+  keys.reserve(map.size());
+  for (const auto& it : map) {
+    keys.push_back(it.first);
+  }
+  std::sort(keys.begin(), keys.end());
+  return keys;
+}
+
+}  // namespace
 
 DispatcherState::DispatcherState()
     : worker_index_resolver_(std::vector<std::string>{}) {}
@@ -87,6 +105,235 @@ Status DispatcherState::Apply(const Update& update) {
   return Status::OK();
 }
 
+DispatcherStateSnapshot DispatcherState::Snapshot() const {
+  DispatcherStateSnapshot snapshot;
+  snapshot.set_next_available_dataset_id(next_available_dataset_id_);
+  snapshot.set_next_available_job_id(next_available_job_id_);
+  snapshot.set_next_available_job_client_id(next_available_job_client_id_);
+  snapshot.set_next_available_task_id(next_available_task_id_);
+
+  for (int64_t dataset_id : SortedKeys(datasets_by_id_)) {
+    RegisterDatasetUpdate* dataset = snapshot.add_datasets();
+    dataset->set_dataset_id(dataset_id);
+    dataset->set_fingerprint(datasets_by_id_.at(dataset_id)->fingerprint);
+  }
+  for (int64_t dataset_id : SortedKeys(id_element_spec_info_)) {
+    SetElementSpecUpdate* element_spec = snapshot.add_element_specs();
+    element_spec->set_dataset_id(dataset_id);
+    element_spec->set_element_spec(id_element_spec_info_.at(dataset_id));
+  }
+
+  for (const std::string& address : SortedKeys(workers_)) {
+    const Worker& worker = *workers_.at(address);
+    RegisterWorkerUpdate* register_worker = snapshot.add_workers();
+    register_worker->set_worker_address(worker.address);
+    register_worker->set_transfer_address(worker.transfer_address);
+    *register_worker->mutable_worker_tags() = {worker.tags.begin(),
+                                               worker.tags.end()};
+  }
+  for (const std::string& address : worker_index_resolver_.worker_addresses()) {
+    snapshot.add_worker_index_addresses(address);
+  }
+
+  // Pending tasks are not listed in `tasks_` if they were removed.
+  TasksById tasks = tasks_;
+  for (int64_t job_id : SortedKeys(jobs_)) {
+    const Job& job = *jobs_.at(job_id);
+    JobSnapshot* job_snapshot = snapshot.add_jobs();
+    CreateJobUpdate* create_job = job_snapshot->mutable_create_job();
+    create_job->set_job_id(job_id);
+    create_job->set_dataset_id(job.dataset_id);
+    *create_job->mutable_processing_mode_def() = job.processing_mode;
+    if (job.named_job_key.has_value()) {
+      NamedJobKeyDef* key = create_job->mutable_named_job_key();
+      key->set_name(job.named_job_key->name);
+      key->set_index(job.named_job_key->index);
+    }
+    if (job.num_consumers.has_value()) {
+      create_job->set_num_consumers(job.num_consumers.value());
+    }
+    create_job->set_target_workers(job.target_workers);
+    if (job.distributed_epoch_state.has_value()) {
+      const DistributedEpochState& state = job.distributed_epoch_state.value();
+      create_job->set_num_split_providers(state.repetitions.size());
+      *job_snapshot->mutable_split_repetitions() = {state.repetitions.begin(),
+                                                    state.repetitions.end()};
+      *job_snapshot->mutable_split_indices() = {state.indices.begin(),
+                                                state.indices.end()};
+    }
+    job_snapshot->set_last_client_released_micros(
+        job.last_client_released_micros);
+    job_snapshot->set_finished(job.finished);
+    job_snapshot->set_garbage_collected(job.garbage_collected);
+
+    auto it = tasks_by_job_.find(job_id);
+    if (it != tasks_by_job_.end()) {
+      for (const auto& task : it->second) {
+        job_snapshot->add_task_ids(task->task_id);
+      }
+    }
+    std::queue<PendingTask> pending_tasks = job.pending_tasks;
+    while (!pending_tasks.empty()) {
+      const PendingTask& pending_task = pending_tasks.front();
+      PendingTaskSnapshot* pending_task_snapshot =
+          job_snapshot->add_pending_tasks();
+      pending_task_snapshot->set_task_id(pending_task.task->task_id);
+      pending_task_snapshot->set_target_round(pending_task.target_round);
+      std::vector<int64_t> ready_consumers(
+          pending_task.ready_consumers.begin(),
+          pending_task.ready_consumers.end());
+      std::sort(ready_consumers.begin(), ready_consumers.end());
+      *pending_task_snapshot->mutable_ready_consumers() = {
+          ready_consumers.begin(), ready_consumers.end()};
+      pending_task_snapshot->set_failures(pending_task.failures);
+      tasks.emplace(pending_task.task->task_id, pending_task.task);
+      pending_tasks.pop();
+    }
+  }
+
+  for (int64_t task_id : SortedKeys(tasks)) {
+    const Task& task = *tasks.at(task_id);
+    TaskSnapshot* task_snapshot = snapshot.add_tasks();
+    CreateTaskUpdate* create_task = task_snapshot->mutable_create_task();
+    create_task->set_task_id(task_id);
+    create_task->set_job_id(task.job->job_id);
+    create_task->set_worker_address(task.worker_address);
+    create_task->set_transfer_address(task.transfer_address);
+    *create_task->mutable_worker_tags() = {task.worker_tags.begin(),
+                                           task.worker_tags.end()};
+    task_snapshot->set_starting_round(task.starting_round);
+    task_snapshot->set_finished(task.finished);
+    task_snapshot->set_removed(task.removed);
+    auto it = tasks_by_worker_.find(task.worker_address);
+    task_snapshot->set_assigned_to_worker(it != tasks_by_worker_.end() &&
+                                          it->second.contains(task_id));
+  }
+
+  for (int64_t job_client_id : SortedKeys(jobs_for_client_ids_)) {
+    const std::shared_ptr<Job>& job = jobs_for_client_ids_.at(job_client_id);
+    // `JobForJobClientId` may leave empty entries for unknown clients.
+    if (!job) {
+      continue;
+    }
+    AcquireJobClientUpdate* job_client = snapshot.add_job_clients();
+    job_client->set_job_id(job->job_id);
+    job_client->set_job_client_id(job_client_id);
+  }
+  return snapshot;
+}
+
+Status DispatcherState::Restore(const DispatcherStateSnapshot& snapshot) {
+  if (!datasets_by_id_.empty() || !workers_.empty() || !jobs_.empty()) {
+    return errors::FailedPrecondition(
+        "Dispatcher state snapshots can only be restored into an empty "
+        "state.");
+  }
+  for (const RegisterDatasetUpdate& dataset : snapshot.datasets()) {
+    RegisterDataset(dataset);
+  }
+  for (const SetElementSpecUpdate& element_spec : snapshot.element_specs()) {
+    SetElementSpec(element_spec);
+  }
+  for (const RegisterWorkerUpdate& worker : snapshot.workers()) {
+    RegisterWorker(worker);
+  }
+  // Worker indices depend on the order in which workers registered, so they
+  // are restored as they were rather than recomputed.
+  worker_index_resolver_ =
+      WorkerIndexResolver(snapshot.worker_index_addresses());
+
+  for (const JobSnapshot& job_snapshot : snapshot.jobs()) {
+    CreateJob(job_snapshot.create_job());
+    std::shared_ptr<Job>& job = jobs_[job_snapshot.create_job().job_id()];
+    if (job->distributed_epoch_state.has_value()) {
+      DistributedEpochState& state = job->distributed_epoch_state.value();
+      if (job_snapshot.split_repetitions_size() != state.repetitions.size() ||
+          job_snapshot.split_indices_size() != state.indices.size()) {
+        return errors::DataLoss("Invalid split state for job ", job->job_id,
+                                " in dispatcher state snapshot.");
+      }
+      state.repetitions.assign(job_snapshot.split_repetitions().begin(),
+                               job_snapshot.split_repetitions().end());
+      state.indices.assign(job_snapshot.split_indices().begin(),
+                           job_snapshot.split_indices().end());
+    }
+    job->last_client_released_micros =
+        job_snapshot.last_client_released_micros();
+    job->finished = job_snapshot.finished();
+    job->garbage_collected = job_snapshot.garbage_collected();
+  }
+
+  TasksById restored_tasks;
+  for (const TaskSnapshot& task_snapshot : snapshot.tasks()) {
+    const CreateTaskUpdate& create_task = task_snapshot.create_task();
+    auto job_it = jobs_.find(create_task.job_id());
+    if (job_it == jobs_.end()) {
+      return errors::DataLoss("Job ", create_task.job_id(), " of task ",
+                              create_task.task_id(),
+                              " not found in dispatcher state snapshot.");
+    }
+    auto task = std::make_shared<Task>(create_task, job_it->second);
+    task->starting_round = task_snapshot.starting_round();
+    task->finished = task_snapshot.finished();
+    task->removed = task_snapshot.removed();
+    restored_tasks[task->task_id] = task;
+    if (!task->removed) {
+      tasks_[task->task_id] = task;
+    }
+    TasksById& worker_tasks = tasks_by_worker_[task->worker_address];
+    if (task_snapshot.assigned_to_worker()) {
+      worker_tasks[task->task_id] = task;
+    }
+  }
+
+  for (const JobSnapshot& job_snapshot : snapshot.jobs()) {
+    int64_t job_id = job_snapshot.create_job().job_id();
+    std::shared_ptr<Job>& job = jobs_[job_id];
+    std::vector<std::shared_ptr<Task>>& tasks_for_job = tasks_by_job_[job_id];
+    for (int64_t task_id : job_snapshot.task_ids()) {
+      auto it = restored_tasks.find(task_id);
+      if (it == restored_tasks.end()) {
+        return errors::DataLoss("Task ", task_id, " of job ", job_id,
+                                " not found in dispatcher state snapshot.");
+      }
+      tasks_for_job.push_back(it->second);
+    }
+    for (const PendingTaskSnapshot& pending_task :
+         job_snapshot.pending_tasks()) {
+      auto it = restored_tasks.find(pending_task.task_id());
+      if (it == restored_tasks.end()) {
+        return errors::DataLoss("Pending task ", pending_task.task_id(),
+                                " of job ", job_id,
+                                " not found in dispatcher state snapshot.");
+      }
+      job->pending_tasks.emplace(it->second, pending_task.target_round());
+      PendingTask& restored = job->pending_tasks.back();
+      restored.ready_consumers.insert(pending_task.ready_consumers().begin(),
+                                      pending_task.ready_consumers().end());
+      restored.failures = pending_task.failures();
+    }
+  }
+
+  for (const AcquireJobClientUpdate& job_client : snapshot.job_clients()) {
+    if (!jobs_.contains(job_client.job_id())) {
+      return errors::DataLoss("Job ", job_client.job_id(), " of job client ",
+                              job_client.job_client_id(),
+                              " not found in dispatcher state snapshot.");
+    }
+    AcquireJobClient(job_client);
+  }
+
+  next_available_dataset_id_ = std::max(next_available_dataset_id_,
+                                        snapshot.next_available_dataset_id());
+  next_available_job_id_ =
+      std::max(next_available_job_id_, snapshot.next_available_job_id());
+  next_available_job_client_id_ = std::max(
+      next_available_job_client_id_, snapshot.next_available_job_client_id());
+  next_available_task_id_ =
+      std::max(next_available_task_id_, snapshot.next_available_task_id());
+  return Status::OK();
+}
+
 void DispatcherState::RegisterDataset(
     const RegisterDatasetUpdate& register_dataset) {
   int64_t id = register_dataset.dataset_id();
@@ -147,7 +394,8 @@ void DispatcherState::ProduceSplit(const ProduceSplitUpdate& produce_split) {
     state.indices[provider_index] = 0;
     return;
   }
-  state.indices[provider_index]++;
+  state.indices[provider_index] +=
+      std::max<int64_t>(produce_split.num_splits(), 1);
 }
 
 void DispatcherState::AcquireJobClient(
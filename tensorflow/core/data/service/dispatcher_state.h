@@ -38,8 +38,9 @@ namespace tensorflow {
 namespace data {
 
 // A class encapsulating the journaled state of the dispatcher. All state
-// modifications must be done via `Apply`. This helps to ensure that
-// replaying the journal will allow us to restore the exact same state.
+// modifications must be done via `Apply`, or `Restore` when recovering from a
+// snapshot. This helps to ensure that replaying the journal will allow us to
+// restore the exact same state.
 //
 // The following usage pattern will keep the journal in sync with the state of
 // the dispatcher:
@@ -72,6 +73,13 @@ class DispatcherState {
   // Applies the given update to the dispatcher's state.
   Status Apply(const Update& update);
 
+  // Returns a snapshot of the dispatcher's state. Restoring the snapshot
+  // produces the same state as replaying the updates applied so far.
+  DispatcherStateSnapshot Snapshot() const;
+  // Restores the state from `snapshot`. Must be called before applying any
+  // updates.
+  Status Restore(const DispatcherStateSnapshot& snapshot);
+
   // A dataset registered with the dispatcher.
   struct Dataset {
     explicit Dataset(int64_t dataset_id, int64_t fingerprint)
@@ -25,6 +25,7 @@ limitations under the License.
 #include "tensorflow/core/platform/path.h"
 #include "tensorflow/core/platform/status_matchers.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/protobuf/data_service.pb.h"
 #include "tensorflow/core/protobuf/error_codes.pb.h"
 #include "tensorflow/core/protobuf/service_config.pb.h"
@@ -38,6 +39,7 @@ using Worker = DispatcherState::Worker;
 using NamedJobKey = DispatcherState::NamedJobKey;
 using Job = DispatcherState::Job;
 using Task = DispatcherState::Task;
+using ::tensorflow::testing::IsOkAndHolds;
 using ::tensorflow::testing::StatusIs;
 using ::testing::HasSubstr;
 using ::testing::IsEmpty;
@@ -141,6 +143,132 @@ Status FinishTask(int64_t task_id, DispatcherState& state) {
   TF_RETURN_IF_ERROR(state.Apply(update));
   return Status::OK();
 }
+
+Status CreateDynamicShardJob(int64_t job_id, int64_t dataset_id,
+                             DispatcherState& state) {
+  Update update;
+  CreateJobUpdate* create_job = update.mutable_create_job();
+  create_job->set_job_id(job_id);
+  create_job->set_dataset_id(dataset_id);
+  create_job->mutable_processing_mode_def()->set_sharding_policy(
+      ProcessingModeDef::DYNAMIC);
+  create_job->set_num_split_providers(2);
+  TF_RETURN_IF_ERROR(state.Apply(update));
+  return Status::OK();
+}
+
+Status ProduceSplit(int64_t job_id, int64_t repetition,
+                    int64_t split_provider_index, bool finished,
+                    DispatcherState& state) {
+  Update update;
+  ProduceSplitUpdate* produce_split = update.mutable_produce_split();
+  produce_split->set_job_id(job_id);
+  produce_split->set_repetition(repetition);
+  produce_split->set_split_provider_index(split_provider_index);
+  produce_split->set_finished(finished);
+  TF_RETURN_IF_ERROR(state.Apply(update));
+  return Status::OK();
+}
+
+Status CreateRoundRobinJob(int64_t job_id, int64_t dataset_id,
+                           int64_t num_consumers, DispatcherState& state) {
+  Update update;
+  CreateJobUpdate* create_job = update.mutable_create_job();
+  create_job->set_job_id(job_id);
+  create_job->set_dataset_id(dataset_id);
+  create_job->mutable_processing_mode_def()->set_sharding_policy(
+      ProcessingModeDef::OFF);
+  create_job->set_num_consumers(num_consumers);
+  TF_RETURN_IF_ERROR(state.Apply(update));
+  return Status::OK();
+}
+
+Status CreatePendingTask(int64_t task_id, int64_t job_id,
+                         const std::string& worker_address,
+                         int64_t starting_round, DispatcherState& state) {
+  Update update;
+  CreatePendingTaskUpdate* create_pending_task =
+      update.mutable_create_pending_task();
+  create_pending_task->set_task_id(task_id);
+  create_pending_task->set_job_id(job_id);
+  create_pending_task->set_worker_address(worker_address);
+  create_pending_task->set_starting_round(starting_round);
+  TF_RETURN_IF_ERROR(state.Apply(update));
+  return Status::OK();
+}
+
+Status AcceptPendingTask(int64_t job_client_id, DispatcherState& state) {
+  Update update;
+  ClientHeartbeatUpdate* client_heartbeat = update.mutable_client_heartbeat();
+  client_heartbeat->set_job_client_id(job_client_id);
+  client_heartbeat->set_task_accepted(true);
+  TF_RETURN_IF_ERROR(state.Apply(update));
+  return Status::OK();
+}
+
+Status GarbageCollectJob(int64_t job_id, DispatcherState& state) {
+  Update update;
+  update.mutable_garbage_collect_job()->set_job_id(job_id);
+  TF_RETURN_IF_ERROR(state.Apply(update));
+  return Status::OK();
+}
+
+// Applies updates covering every kind of dispatcher state to `state`.
+Status PopulateState(DispatcherState& state) {
+  TF_RETURN_IF_ERROR(RegisterDataset(/*id=*/1, /*fingerprint=*/10, state));
+  TF_RETURN_IF_ERROR(RegisterDataset(/*id=*/2, /*fingerprint=*/20, state));
+  TF_RETURN_IF_ERROR(SetElementSpec(/*dataset_id=*/1, "element_spec", state));
+  TF_RETURN_IF_ERROR(RegisterWorker("/worker/task/0:20000", state));
+  TF_RETURN_IF_ERROR(RegisterWorker("/worker/task/1:20000", state));
+
+  // A named job which was garbage collected and recreated.
+  TF_RETURN_IF_ERROR(
+      CreateNamedJob(/*job_id=*/1, /*dataset_id=*/1, NamedJobKey("job", 0),
+                     state));
+  TF_RETURN_IF_ERROR(AcquireJobClientId(/*job_id=*/1, /*job_client_id=*/1,
+                                        state));
+  TF_RETURN_IF_ERROR(CreateTask(/*task_id=*/1, /*job_id=*/1,
+                                "/worker/task/0:20000", state));
+  TF_RETURN_IF_ERROR(ReleaseJobClientId(/*job_client_id=*/1,
+                                        /*release_time=*/100, state));
+  TF_RETURN_IF_ERROR(GarbageCollectJob(/*job_id=*/1, state));
+  TF_RETURN_IF_ERROR(
+      CreateNamedJob(/*job_id=*/2, /*dataset_id=*/1, NamedJobKey("job", 0),
+                     state));
+  TF_RETURN_IF_ERROR(AcquireJobClientId(/*job_id=*/2, /*job_client_id=*/2,
+                                        state));
+
+  // A dynamically sharded job with splits in flight.
+  TF_RETURN_IF_ERROR(CreateDynamicShardJob(/*job_id=*/3, /*dataset_id=*/2,
+                                           state));
+  TF_RETURN_IF_ERROR(ProduceSplit(/*job_id=*/3, /*repetition=*/0,
+                                  /*split_provider_index=*/0,
+                                  /*finished=*/false, state));
+  TF_RETURN_IF_ERROR(ProduceSplit(/*job_id=*/3, /*repetition=*/0,
+                                  /*split_provider_index=*/0,
+                                  /*finished=*/true, state));
+  TF_RETURN_IF_ERROR(ProduceSplit(/*job_id=*/3, /*repetition=*/0,
+                                  /*split_provider_index=*/1,
+                                  /*finished=*/false, state));
+  TF_RETURN_IF_ERROR(CreateTask(/*task_id=*/2, /*job_id=*/3,
+                                "/worker/task/0:20000", state));
+  TF_RETURN_IF_ERROR(CreateTask(/*task_id=*/3, /*job_id=*/3,
+                                "/worker/task/1:20000", state));
+  TF_RETURN_IF_ERROR(FinishTask(/*task_id=*/2, state));
+
+  // A round-robin job with a task waiting to be accepted by its consumers.
+  TF_RETURN_IF_ERROR(CreateRoundRobinJob(/*job_id=*/4, /*dataset_id=*/2,
+                                         /*num_consumers=*/2, state));
+  TF_RETURN_IF_ERROR(AcquireJobClientId(/*job_id=*/4, /*job_client_id=*/3,
+                                        state));
+  TF_RETURN_IF_ERROR(AcquireJobClientId(/*job_id=*/4, /*job_client_id=*/4,
+                                        state));
+  TF_RETURN_IF_ERROR(CreatePendingTask(/*task_id=*/4, /*job_id=*/4,
+                                       "/worker/task/1:20000",
+                                       /*starting_round=*/5, state));
+  TF_RETURN_IF_ERROR(AcceptPendingTask(/*job_client_id=*/3, state));
+  return Status::OK();
+}
 }  // namespace
 
 TEST(DispatcherState, SetElementSpec) {
@@ -336,6 +464,28 @@ TEST(DispatcherState, NumConsumersJob) {
   EXPECT_EQ(job->num_consumers, num_consumers);
 }
 
+TEST(DispatcherState, ProduceSplitBatch) {
+  DispatcherState state;
+  TF_EXPECT_OK(RegisterDataset(/*id=*/1, /*fingerprint=*/10, state));
+  TF_EXPECT_OK(CreateDynamicShardJob(/*job_id=*/2, /*dataset_id=*/1, state));
+  Update update;
+  ProduceSplitUpdate* produce_split = update.mutable_produce_split();
+  produce_split->set_job_id(2);
+  produce_split->set_repetition(0);
+  produce_split->set_split_provider_index(1);
+  produce_split->set_num_splits(5);
+  TF_EXPECT_OK(state.Apply(update));
+  // Updates without `num_splits` produced one split.
+  TF_EXPECT_OK(ProduceSplit(/*job_id=*/2, /*repetition=*/0,
+                            /*split_provider_index=*/1, /*finished=*/false,
+                            state));
+  std::shared_ptr<const Job> job;
+  TF_EXPECT_OK(state.JobFromId(2, job));
+  ASSERT_TRUE(job->distributed_epoch_state.has_value());
+  EXPECT_THAT(job->distributed_epoch_state->indices,
+              ::testing::ElementsAre(0, 6));
+}
+
 TEST(DispatcherState, CreateTask) {
   int64_t job_id = 3;
   int64_t dataset_id = 10;
@@ -582,5 +732,156 @@ TEST(DispatcherState, ListActiveClients) {
   EXPECT_THAT(state.ListActiveClientIds(), UnorderedElementsAre(6, 8));
 }
 
+TEST(DispatcherState, SnapshotRoundTrip) {
+  DispatcherState state;
+  TF_ASSERT_OK(PopulateState(state));
+  DispatcherStateSnapshot snapshot = state.Snapshot();
+
+  DispatcherState restored;
+  TF_ASSERT_OK(restored.Restore(snapshot));
+  EXPECT_EQ(restored.Snapshot().DebugString(), snapshot.DebugString());
+  EXPECT_EQ(restored.NextAvailableDatasetId(), state.NextAvailableDatasetId());
+  EXPECT_EQ(restored.NextAvailableJobId(), state.NextAvailableJobId());
+  EXPECT_EQ(restored.NextAvailableJobClientId(),
+            state.NextAvailableJobClientId());
+  EXPECT_EQ(restored.NextAvailableTaskId(), state.NextAvailableTaskId());
+
+  std::shared_ptr<const Job> job;
+  TF_ASSERT_OK(restored.NamedJobByKey(NamedJobKey("job", 0), job));
+  EXPECT_EQ(job->job_id, 2);
+  EXPECT_EQ(job->num_clients, 1);
+  TF_ASSERT_OK(restored.JobFromId(1, job));
+  EXPECT_TRUE(job->garbage_collected);
+  EXPECT_EQ(job->last_client_released_micros, 100);
+  TF_ASSERT_OK(restored.JobFromId(3, job));
+  ASSERT_TRUE(job->distributed_epoch_state.has_value());
+  EXPECT_THAT(job->distributed_epoch_state->repetitions,
+              ::testing::ElementsAre(1, 0));
+  EXPECT_THAT(job->distributed_epoch_state->indices,
+              ::testing::ElementsAre(0, 1));
+  TF_ASSERT_OK(restored.JobForJobClientId(4, job));
+  EXPECT_EQ(job->job_id, 4);
+  ASSERT_EQ(job->pending_tasks.size(), 1);
+  EXPECT_EQ(job->pending_tasks.front().target_round, 5);
+  EXPECT_THAT(job->pending_tasks.front().ready_consumers,
+              UnorderedElementsAre(3));
+
+  std::vector<std::shared_ptr<const Task>> tasks;
+  TF_ASSERT_OK(restored.TasksForJob(3, tasks));
+  EXPECT_THAT(tasks, SizeIs(2));
+  TF_ASSERT_OK(restored.TasksForWorker("/worker/task/0:20000", tasks));
+  EXPECT_THAT(tasks, IsEmpty());
+  TF_ASSERT_OK(restored.TasksForWorker("/worker/task/1:20000", tasks));
+  EXPECT_THAT(tasks, SizeIs(2));
+  EXPECT_THAT(restored.ListActiveClientIds(), UnorderedElementsAre(2, 3, 4));
+
+  // The restored state accepts the updates which follow the snapshot.
+  TF_EXPECT_OK(AcceptPendingTask(/*job_client_id=*/4, restored));
+  TF_EXPECT_OK(AcceptPendingTask(/*job_client_id=*/4, state));
+  EXPECT_EQ(restored.Snapshot().DebugString(), state.Snapshot().DebugString());
+}
+
+TEST(DispatcherState, RestoreWorkerIndices) {
+  experimental::DispatcherConfig dispatcher_config;
+  dispatcher_config.add_worker_addresses("/worker/task/0:%port%");
+  dispatcher_config.add_worker_addresses("/worker/task/0:%port%");
+  DispatcherState state(dispatcher_config);
+  TF_ASSERT_OK(RegisterWorker("/worker/task/0:20001", state));
+  TF_ASSERT_OK(RegisterWorker("/worker/task/0:20000", state));
+
+  DispatcherState restored(dispatcher_config);
+  TF_ASSERT_OK(restored.Restore(state.Snapshot()));
+  EXPECT_THAT(restored.GetWorkerIndex("/worker/task/0:20001"),
+              IsOkAndHolds(0));
+  EXPECT_THAT(restored.GetWorkerIndex("/worker/task/0:20000"),
+              IsOkAndHolds(1));
+}
+
+TEST(DispatcherState, RestoreIntoNonEmptyState) {
+  DispatcherState state;
+  TF_ASSERT_OK(PopulateState(state));
+  EXPECT_THAT(state.Restore(state.Snapshot()),
+              StatusIs(error::FAILED_PRECONDITION));
+}
+
+// Measures how long it takes to recover a dispatcher state from a journal of
+// `state.range(0)` updates, either by replaying the whole journal or by
+// restoring a snapshot taken before the last `state.range(1)` updates and
+// replaying the rest.
+void BM_Recovery(::testing::benchmark::State& state) {
+  const int64_t num_updates = state.range(0);
+  const int64_t num_tail_updates = state.range(1);
+  std::vector<Update> updates;
+  updates.reserve(num_updates);
+  for (int64_t i = 0; i < num_updates; ++i) {
+    Update update;
+    // Jobs are repeatedly created, read by one task, and finished.
+    switch (i % 3) {
+      case 0: {
+        CreateJobUpdate* create_job = update.mutable_create_job();
+        create_job->set_job_id(i);
+        create_job->set_dataset_id(1);
+        create_job->mutable_processing_mode_def()->set_sharding_policy(
+            ProcessingModeDef::OFF);
+        break;
+      }
+      case 1: {
+        CreateTaskUpdate* create_task = update.mutable_create_task();
+        create_task->set_task_id(i);
+        create_task->set_job_id(i - 1);
+        create_task->set_worker_address("/worker/task/0:20000");
+        break;
+      }
+      case 2:
+        update.mutable_finish_task()->set_task_id(i - 1);
+        break;
+    }
+    updates.push_back(std::move(update));
+  }
+  Update register_dataset;
+  register_dataset.mutable_register_dataset()->set_dataset_id(1);
+  register_dataset.mutable_register_dataset()->set_fingerprint(1);
+
+  const int64_t num_snapshot_updates =
+      std::max<int64_t>(num_updates - num_tail_updates, 0);
+  DispatcherStateSnapshot snapshot;
+  {
+    DispatcherState snapshot_state;
+    TF_CHECK_OK(snapshot_state.Apply(register_dataset));
+    for (int64_t i = 0; i < num_snapshot_updates; ++i) {
+      TF_CHECK_OK(snapshot_state.Apply(updates[i]));
+    }
+    snapshot = snapshot_state.Snapshot();
+  }
+  // Recovery reads the snapshot from disk, so parsing it is part of the cost.
+  const std::string serialized_snapshot = snapshot.SerializeAsString();
+
+  for (auto s : state) {
+    DispatcherState recovered;
+    int64_t first_update = 0;
+    if (num_tail_updates >= 0) {
+      DispatcherStateSnapshot parsed;
+      CHECK(parsed.ParseFromString(serialized_snapshot));
+      TF_CHECK_OK(recovered.Restore(parsed));
+      first_update = num_snapshot_updates;
+    } else {
+      TF_CHECK_OK(recovered.Apply(register_dataset));
+    }
+    for (int64_t i = first_update; i < num_updates; ++i) {
+      TF_CHECK_OK(recovered.Apply(updates[i]));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * num_updates);
+}
+
+// A tail of -1 replays the whole journal without a snapshot.
+BENCHMARK(BM_Recovery)
+    ->ArgPair(3000, -1)
+    ->ArgPair(3000, 300)
+    ->ArgPair(30000, -1)
+    ->ArgPair(30000, 300)
+    ->ArgPair(300000, -1)
+    ->ArgPair(300000, 300);
+
 }  // namespace data
 }  // namespace tensorflow
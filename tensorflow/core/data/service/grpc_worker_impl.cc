@@ -61,6 +61,7 @@ void GrpcWorkerImpl::Stop() {
 HANDLER(ProcessTask);
 HANDLER(GetElement);
 HANDLER(GetWorkerTasks);
+HANDLER(GetShmTransferToken);
 #undef HANDLER
 
 }  // namespace data
@@ -49,6 +49,10 @@ class GrpcWorkerImpl : public WorkerService::Service {
     };
   }
 
+  void SetShmTransferTokenIssuer(std::function<std::string()> issuer) {
+    impl_->SetShmTransferTokenIssuer(std::move(issuer));
+  }
+
 #define HANDLER(method)                                 \
   ::grpc::Status method(::grpc::ServerContext* context, \
                         const method##Request* request, \
@@ -56,6 +60,7 @@ class GrpcWorkerImpl : public WorkerService::Service {
   HANDLER(ProcessTask);
   HANDLER(GetElement);
   HANDLER(GetWorkerTasks);
+  HANDLER(GetShmTransferToken);
 #undef HANDLER
 
  private:
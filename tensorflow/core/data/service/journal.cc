@@ -16,6 +16,8 @@ limitations under the License.
 #include "tensorflow/core/data/service/journal.h"
 
 #include "absl/memory/memory.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
 #include "tensorflow/core/data/service/journal.pb.h"
 #include "tensorflow/core/lib/io/record_reader.h"
 #include "tensorflow/core/lib/io/record_writer.h"
@@ -29,6 +31,9 @@ namespace data {
 
 namespace {
 constexpr StringPiece kJournal = "journal";
+constexpr StringPiece kSnapshot = "snapshot";
+// Suffix of snapshots which are still being written.
+constexpr StringPiece kTempSuffix = ".tmp";
 
 Status ParseSequenceNumber(const std::string& journal_file,
                            int64_t* sequence_number) {
@@ -38,6 +43,14 @@ Status ParseSequenceNumber(const std::string& journal_file,
   }
   return Status::OK();
 }
+
+bool IsSnapshotFile(const std::string& file) {
+  return absl::StartsWith(file, kSnapshot);
+}
+
+bool IsTempFile(const std::string& file) {
+  return absl::EndsWith(file, kTempSuffix);
+}
 }  // namespace
 
 std::string DataServiceJournalFile(const std::string& journal_dir,
@@ -46,6 +59,46 @@ std::string DataServiceJournalFile(const std::string& journal_dir,
                       absl::StrCat(kJournal, "_", sequence_number));
 }
 
+std::string DataServiceJournalSnapshotFile(const std::string& journal_dir,
+                                           int64_t sequence_number) {
+  return io::JoinPath(journal_dir,
+                      absl::StrCat(kSnapshot, "_", sequence_number));
+}
+
+Status ReadLatestJournalSnapshot(Env* env, const std::string& journal_dir,
+                                 DispatcherStateSnapshot& snapshot,
+                                 int64_t& sequence_number) {
+  std::vector<std::string> files;
+  TF_RETURN_IF_ERROR(env->GetChildren(journal_dir, &files));
+  int64_t latest_sequence_number = -1;
+  for (const auto& file : files) {
+    if (!IsSnapshotFile(file) || IsTempFile(file)) {
+      continue;
+    }
+    int64_t snapshot_sequence_number;
+    TF_RETURN_IF_ERROR(ParseSequenceNumber(file, &snapshot_sequence_number));
+    latest_sequence_number =
+        std::max(latest_sequence_number, snapshot_sequence_number);
+  }
+  if (latest_sequence_number < 0) {
+    return errors::NotFound("No snapshot found in ", journal_dir);
+  }
+  std::string filename =
+      DataServiceJournalSnapshotFile(journal_dir, latest_sequence_number);
+  VLOG(1) << "Reading journal snapshot " << filename;
+  std::unique_ptr<RandomAccessFile> file;
+  TF_RETURN_IF_ERROR(env->NewRandomAccessFile(filename, &file));
+  io::RecordReader reader(file.get());
+  uint64 offset = 0;
+  tstring record;
+  TF_RETURN_IF_ERROR(reader.ReadRecord(&offset, &record));
+  if (!snapshot.ParseFromString(record)) {
+    return errors::DataLoss("Failed to parse journal snapshot ", filename);
+  }
+  sequence_number = latest_sequence_number;
+  return Status::OK();
+}
+
 FileJournalWriter::FileJournalWriter(Env* env, const std::string& journal_dir)
     : env_(env), journal_dir_(journal_dir) {}
 
@@ -56,14 +109,29 @@ Status FileJournalWriter::EnsureInitialized() {
   std::vector<std::string> journal_files;
   TF_RETURN_IF_ERROR(env_->RecursivelyCreateDir(journal_dir_));
   TF_RETURN_IF_ERROR(env_->GetChildren(journal_dir_, &journal_files));
-  int64_t latest_sequence_number = -1;
+  int64_t next_sequence_number = 0;
   for (const auto& file : journal_files) {
+    if (IsTempFile(file)) {
+      // A snapshot which was not completed before a restart.
+      continue;
+    }
     int64_t sequence_number;
     TF_RETURN_IF_ERROR(ParseSequenceNumber(file, &sequence_number));
-    latest_sequence_number = std::max(latest_sequence_number, sequence_number);
+    if (IsSnapshotFile(file)) {
+      // The journal resumes at the sequence number of the snapshot.
+      next_sequence_number = std::max(next_sequence_number, sequence_number);
+    } else {
+      next_sequence_number =
+          std::max(next_sequence_number, sequence_number + 1);
+    }
   }
+  sequence_number_ = next_sequence_number;
+  return OpenFile();
+}
+
+Status FileJournalWriter::OpenFile() {
   std::string journal_file =
-      DataServiceJournalFile(journal_dir_, latest_sequence_number + 1);
+      DataServiceJournalFile(journal_dir_, sequence_number_);
   TF_RETURN_IF_ERROR(env_->NewAppendableFile(journal_file, &file_));
   writer_ = absl::make_unique<io::RecordWriter>(file_.get());
   VLOG(1) << "Created journal writer to write to " << journal_file;
@@ -86,14 +154,66 @@ Status FileJournalWriter::Write(const Update& update) {
   return Status::OK();
 }
 
-FileJournalReader::FileJournalReader(Env* env, StringPiece journal_dir)
-    : env_(env), journal_dir_(journal_dir) {}
+Status FileJournalWriter::WriteSnapshot(
+    const DispatcherStateSnapshot& snapshot) {
+  TF_RETURN_IF_ERROR(EnsureInitialized());
+  // The snapshot covers the current journal file, so later updates go to the
+  // next one.
+  TF_RETURN_IF_ERROR(writer_->Close());
+  TF_RETURN_IF_ERROR(file_->Close());
+  writer_.reset();
+  file_.reset();
+  ++sequence_number_;
+
+  std::string filename =
+      DataServiceJournalSnapshotFile(journal_dir_, sequence_number_);
+  std::string temp_filename = absl::StrCat(filename, kTempSuffix);
+  std::string record = snapshot.SerializeAsString();
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_RETURN_IF_ERROR(env_->NewWritableFile(temp_filename, &file));
+    io::RecordWriter writer(file.get());
+    TF_RETURN_IF_ERROR(writer.WriteRecord(record));
+    TF_RETURN_IF_ERROR(writer.Close());
+    TF_RETURN_IF_ERROR(file->Sync());
+    TF_RETURN_IF_ERROR(file->Close());
+  }
+  // Renaming makes the snapshot visible atomically, so that recovery never
+  // reads a partial snapshot.
+  TF_RETURN_IF_ERROR(env_->RenameFile(temp_filename, filename));
+  VLOG(1) << "Wrote journal snapshot " << filename << " of "
+          << record.size() << " bytes";
+  TF_RETURN_IF_ERROR(OpenFile());
+  return Truncate();
+}
+
+Status FileJournalWriter::Truncate() {
+  std::vector<std::string> files;
+  TF_RETURN_IF_ERROR(env_->GetChildren(journal_dir_, &files));
+  for (const auto& file : files) {
+    int64_t sequence_number;
+    if (!IsTempFile(file)) {
+      TF_RETURN_IF_ERROR(ParseSequenceNumber(file, &sequence_number));
+      if (sequence_number >= sequence_number_) {
+        continue;
+      }
+    }
+    TF_RETURN_IF_ERROR(env_->DeleteFile(io::JoinPath(journal_dir_, file)));
+  }
+  return Status::OK();
+}
+
+FileJournalReader::FileJournalReader(Env* env, StringPiece journal_dir,
+                                     int64_t start_sequence_number)
+    : env_(env),
+      journal_dir_(journal_dir),
+      sequence_number_(start_sequence_number) {}
 
 Status FileJournalReader::EnsureInitialized() {
   if (reader_) {
     return Status::OK();
   }
-  return UpdateFile(DataServiceJournalFile(journal_dir_, 0));
+  return UpdateFile(DataServiceJournalFile(journal_dir_, sequence_number_));
 }
 
 Status FileJournalReader::Read(Update& update, bool& end_of_journal) {
@@ -28,12 +28,27 @@ namespace data {
 std::string DataServiceJournalFile(const std::string& journal_dir,
                                    int64_t sequence_number);
 
+// Returns the location of the snapshot covering the journal files before
+// `sequence_number` within the journal directory.
+std::string DataServiceJournalSnapshotFile(const std::string& journal_dir,
+                                           int64_t sequence_number);
+
+// Reads the latest snapshot in the journal directory into `snapshot`, and sets
+// `sequence_number` to the sequence number of the first journal file after
+// it. Returns NotFound if there is no snapshot.
+Status ReadLatestJournalSnapshot(Env* env, const std::string& journal_dir,
+                                 DispatcherStateSnapshot& snapshot,
+                                 int64_t& sequence_number);
+
 // Interface for writing to a journal.
 class JournalWriter {
  public:
   virtual ~JournalWriter() = default;
   // Writes and syncs an update to the journal.
   virtual Status Write(const Update& update) = 0;
+  // Writes and syncs a snapshot of the state produced by the updates written
+  // so far, then truncates the journal before the snapshot.
+  virtual Status WriteSnapshot(const DispatcherStateSnapshot& snapshot) = 0;
   // Initializes the writer if it is not yet initialized.
   virtual Status EnsureInitialized() = 0;
 };
@@ -54,6 +69,10 @@ class JournalWriter {
 // "journal_0", "journal_1", and "journal_2", the writer will write to
 // "journal_3". The writer will flush updates as they are written, so that they
 // can be stored durably in case of machine failure.
+//
+// Writing a snapshot closes the current journal file, writes the snapshot to
+// "snapshot_<n>" where n is the next sequence number, and deletes the journal
+// files and snapshots before it. Later updates are written to "journal_<n>".
 class FileJournalWriter : public JournalWriter {
  public:
   // Creates a journal writer to write to the given journal directory.
@@ -64,11 +83,19 @@ class FileJournalWriter : public JournalWriter {
   FileJournalWriter& operator=(const FileJournalWriter&) = delete;
 
   Status Write(const Update& update) override;
+  Status WriteSnapshot(const DispatcherStateSnapshot& snapshot) override;
   Status EnsureInitialized() override;
 
  private:
+  // Opens the journal file with sequence number `sequence_number_`.
+  Status OpenFile();
+  // Deletes the journal files and snapshots before `sequence_number_`.
+  Status Truncate();
+
   Env* env_;
   const std::string journal_dir_;
+  // Sequence number of current journal file.
+  int64_t sequence_number_ = 0;
   std::unique_ptr<WritableFile> file_;
   std::unique_ptr<io::RecordWriter> writer_;
 };
@@ -86,10 +113,12 @@ class JournalReader {
 // used by multiple threads.
 //
 // The journal reader reads through all journal files in the configured journal
-// directory, in order of their sequence numbers. See FileJournalWriter above.
+// directory, in order of their sequence numbers, starting from
+// `start_sequence_number`. See FileJournalWriter above.
 class FileJournalReader : public JournalReader {
  public:
-  explicit FileJournalReader(Env* env, StringPiece journal_dir);
+  explicit FileJournalReader(Env* env, StringPiece journal_dir,
+                             int64_t start_sequence_number = 0);
   FileJournalReader(const FileJournalReader&) = delete;
   FileJournalReader& operator=(const FileJournalReader&) = delete;
 
@@ -104,7 +133,7 @@ class FileJournalReader : public JournalReader {
   Env* env_;
   const std::string journal_dir_;
   // Sequence number of current journal file.
-  int64_t sequence_number_ = 0;
+  int64_t sequence_number_;
   std::unique_ptr<RandomAccessFile> file_;
   std::unique_ptr<io::SequentialRecordReader> reader_;
 };
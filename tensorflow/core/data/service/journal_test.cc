@@ -17,6 +17,7 @@ limitations under the License.
 #include <string>
 
 #include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
 #include "tensorflow/core/data/service/common.pb.h"
 #include "tensorflow/core/data/service/journal.pb.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
@@ -30,6 +31,7 @@ namespace data {
 
 namespace {
 using ::testing::HasSubstr;
+using ::testing::UnorderedElementsAre;
 
 bool NewJournalDir(std::string& journal_dir) {
   std::string filename = testing::TmpDir();
@@ -65,9 +67,19 @@ Update MakeRegisterDatasetUpdate() {
   return update;
 }
 
+DispatcherStateSnapshot MakeSnapshot() {
+  DispatcherStateSnapshot snapshot;
+  snapshot.set_next_available_dataset_id(3);
+  RegisterDatasetUpdate* dataset = snapshot.add_datasets();
+  dataset->set_dataset_id(2);
+  dataset->set_fingerprint(3);
+  return snapshot;
+}
+
 Status CheckJournalContent(StringPiece journal_dir,
-                           const std::vector<Update>& expected) {
-  FileJournalReader reader(Env::Default(), journal_dir);
+                           const std::vector<Update>& expected,
+                           int64_t start_sequence_number = 0) {
+  FileJournalReader reader(Env::Default(), journal_dir, start_sequence_number);
   for (const auto& update : expected) {
     Update result;
     bool end_of_journal = true;
@@ -113,6 +125,87 @@ TEST(Journal, AppendExistingJournal) {
   TF_EXPECT_OK(CheckJournalContent(journal_dir, updates));
 }
 
+TEST(Journal, SnapshotTruncatesJournal) {
+  std::string journal_dir;
+  EXPECT_TRUE(NewJournalDir(journal_dir));
+  FileJournalWriter writer(Env::Default(), journal_dir);
+  TF_EXPECT_OK(writer.Write(MakeRegisterDatasetUpdate()));
+  TF_EXPECT_OK(writer.Write(MakeCreateJobUpdate()));
+  TF_EXPECT_OK(writer.WriteSnapshot(MakeSnapshot()));
+  std::vector<Update> updates = {MakeFinishTaskUpdate()};
+  TF_EXPECT_OK(writer.Write(updates[0]));
+
+  DispatcherStateSnapshot snapshot;
+  int64_t sequence_number;
+  TF_ASSERT_OK(ReadLatestJournalSnapshot(Env::Default(), journal_dir, snapshot,
+                                         sequence_number));
+  EXPECT_EQ(sequence_number, 1);
+  EXPECT_EQ(snapshot.SerializeAsString(), MakeSnapshot().SerializeAsString());
+  EXPECT_TRUE(errors::IsNotFound(Env::Default()->FileExists(
+      DataServiceJournalFile(journal_dir, /*sequence_number=*/0))));
+  TF_EXPECT_OK(CheckJournalContent(journal_dir, updates, sequence_number));
+}
+
+TEST(Journal, SnapshotAcrossRestarts) {
+  std::string journal_dir;
+  EXPECT_TRUE(NewJournalDir(journal_dir));
+  {
+    FileJournalWriter writer(Env::Default(), journal_dir);
+    TF_EXPECT_OK(writer.Write(MakeRegisterDatasetUpdate()));
+    TF_EXPECT_OK(writer.WriteSnapshot(MakeSnapshot()));
+  }
+  std::vector<Update> updates = {MakeCreateJobUpdate(),
+                                 MakeFinishTaskUpdate()};
+  for (const auto& update : updates) {
+    FileJournalWriter writer(Env::Default(), journal_dir);
+    TF_EXPECT_OK(writer.Write(update));
+  }
+  {
+    FileJournalWriter writer(Env::Default(), journal_dir);
+    TF_EXPECT_OK(writer.WriteSnapshot(MakeSnapshot()));
+  }
+
+  DispatcherStateSnapshot snapshot;
+  int64_t sequence_number;
+  TF_ASSERT_OK(ReadLatestJournalSnapshot(Env::Default(), journal_dir, snapshot,
+                                         sequence_number));
+  EXPECT_EQ(sequence_number, 5);
+  std::vector<std::string> files;
+  TF_ASSERT_OK(Env::Default()->GetChildren(journal_dir, &files));
+  EXPECT_THAT(files, UnorderedElementsAre("snapshot_5", "journal_5"));
+  TF_EXPECT_OK(CheckJournalContent(journal_dir, {}, sequence_number));
+}
+
+TEST(Journal, IgnoreIncompleteSnapshot) {
+  std::string journal_dir;
+  EXPECT_TRUE(NewJournalDir(journal_dir));
+  std::vector<Update> updates = {MakeCreateJobUpdate()};
+  {
+    FileJournalWriter writer(Env::Default(), journal_dir);
+    TF_EXPECT_OK(writer.Write(updates[0]));
+  }
+  TF_ASSERT_OK(WriteStringToFile(
+      Env::Default(),
+      absl::StrCat(DataServiceJournalSnapshotFile(journal_dir, 1), ".tmp"),
+      "partial snapshot"));
+
+  DispatcherStateSnapshot snapshot;
+  int64_t sequence_number;
+  EXPECT_TRUE(errors::IsNotFound(ReadLatestJournalSnapshot(
+      Env::Default(), journal_dir, snapshot, sequence_number)));
+  TF_EXPECT_OK(CheckJournalContent(journal_dir, updates));
+}
+
+TEST(Journal, MissingSnapshot) {
+  std::string journal_dir;
+  EXPECT_TRUE(NewJournalDir(journal_dir));
+  DispatcherStateSnapshot snapshot;
+  int64_t sequence_number;
+  Status s = ReadLatestJournalSnapshot(Env::Default(), journal_dir, snapshot,
+                                       sequence_number);
+  EXPECT_TRUE(errors::IsNotFound(s));
+}
+
 TEST(Journal, MissingFile) {
   std::string journal_dir;
   EXPECT_TRUE(NewJournalDir(journal_dir));
@@ -19,13 +19,20 @@ limitations under the License.
 #include "tensorflow/core/data/service/grpc_dispatcher_impl.h"
 #include "tensorflow/core/data/service/grpc_util.h"
 #include "tensorflow/core/data/service/grpc_worker_impl.h"
+#include "tensorflow/core/data/service/shm_transfer.h"
 #include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 namespace data {
 
 namespace {
 constexpr char kPortPlaceholder[] = "%port%";
+// The default size of the shared memory ring of each client.
+constexpr int64_t kDefaultShmRingMb = 128;
+// The default number of clients which may read from a worker through shared
+// memory at the same time.
+constexpr int64_t kDefaultShmMaxConnections = 16;
 }
 
 GrpcDataServerBase::GrpcDataServerBase(int port, const std::string& protocol,
@@ -143,7 +150,31 @@ Status WorkerGrpcDataServer::StartServiceInternal() {
       /*replace_all=*/false);
   std::string transfer_address = worker_address;
   std::string transfer_protocol = config_.data_transfer_protocol();
-  if (!transfer_protocol.empty() && transfer_protocol != "grpc") {
+  if (transfer_protocol == kShmTransferProtocol) {
+    // The shared memory server is found through the gRPC port, so clients
+    // which cannot use it fall back to the worker address.
+    int64_t ring_mb;
+    TF_RETURN_IF_ERROR(ReadInt64FromEnvVar("TF_DATA_SHM_TRANSFER_RING_MB",
+                                           kDefaultShmRingMb, &ring_mb));
+    int64_t max_connections;
+    TF_RETURN_IF_ERROR(ReadInt64FromEnvVar(
+        "TF_DATA_SHM_TRANSFER_MAX_CONNECTIONS", kDefaultShmMaxConnections,
+        &max_connections));
+    auto shm_server = std::make_shared<ShmDataTransferServer>(
+        service_->get_element_getter(), bound_port(), ring_mb << 20,
+        max_connections);
+    TF_RETURN_IF_ERROR(shm_server->Start());
+    // Clients get a token through gRPC before connecting to the shared memory
+    // server. The server may be stopped before the worker service.
+    std::weak_ptr<ShmDataTransferServer> weak_shm_server = shm_server;
+    service_->SetShmTransferTokenIssuer([weak_shm_server]() -> std::string {
+      std::shared_ptr<ShmDataTransferServer> server = weak_shm_server.lock();
+      return server ? server->IssueToken() : "";
+    });
+    transfer_server_ = std::move(shm_server);
+    LOG(INFO) << "Shared memory data transfer server started for port "
+              << bound_port();
+  } else if (!transfer_protocol.empty() && transfer_protocol != "grpc") {
     TF_RETURN_IF_ERROR(DataTransferServer::Build(
         transfer_protocol, service_->get_element_getter(), &transfer_server_));
     TF_RETURN_IF_ERROR(transfer_server_->Start());
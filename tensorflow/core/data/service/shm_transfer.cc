@@ -0,0 +1,869 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/shm_transfer.h"
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif  // defined(__linux__)
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/data/dataset.pb.h"
+#include "tensorflow/core/data/service/worker.pb.h"
+#include "tensorflow/core/framework/allocation_description.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/framework/variant.h"
+#include "tensorflow/core/platform/coding.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/host_info.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/protobuf.h"
+
+namespace tensorflow {
+namespace data {
+
+std::string ShmTransferSocketName(int port) {
+  return absl::StrCat("tf_data_shm_transfer_", port);
+}
+
+#if defined(__linux__) && defined(SYS_memfd_create)
+
+namespace {
+
+// Each block of the ring starts with a header, and its data is aligned to
+// `kBlockAlignment` for Eigen.
+constexpr int64_t kBlockAlignment = 64;
+constexpr int64_t kBlockHeaderSize = kBlockAlignment;
+// How long the server waits for the client to release blocks of the ring
+// before sending an element through the socket instead.
+constexpr int64_t kReleaseTimeoutMicros = 50 * 1000;
+constexpr size_t kMaxMessageSize = 1ULL << 31;
+// Requests are small, so larger ones are rejected before they are read.
+constexpr size_t kMaxRequestSize = 1 << 20;
+// How long the server waits for a client to send its token after connecting.
+constexpr int64_t kConnectTimeoutSeconds = 10;
+// The number of random bytes of a token.
+constexpr int64_t kTokenBytes = 32;
+// The number of tokens which may be outstanding. Older tokens are revoked.
+constexpr size_t kMaxOutstandingTokens = 1024;
+
+// The header of a block of the ring, shared by the server and the client.
+struct BlockHeader {
+  // 1 while the client holds the block, and 0 once it is released. Also used
+  // as a futex to wake up the server when the block is released.
+  std::atomic<uint32_t> in_use;
+};
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+              "std::atomic<uint32_t> cannot be used as a futex.");
+
+int64_t RoundUpToAlignment(int64_t n) {
+  return (n + kBlockAlignment - 1) / kBlockAlignment * kBlockAlignment;
+}
+
+Status ErrnoError(const std::string& context) {
+  return errors::Unavailable(context, ": ", strerror(errno));
+}
+
+// Sets the timeout of reads from `fd`, or disables it if `seconds` is 0.
+Status SetReceiveTimeout(int fd, int64_t seconds) {
+  struct timeval timeout;
+  timeout.tv_sec = seconds;
+  timeout.tv_usec = 0;
+  if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) !=
+      0) {
+    return ErrnoError("Failed to set shared memory transfer socket timeout");
+  }
+  return Status::OK();
+}
+
+void FutexWait(std::atomic<uint32_t>* word, uint32_t expected,
+               int64_t timeout_micros) {
+  struct timespec timeout;
+  timeout.tv_sec = timeout_micros / 1000000;
+  timeout.tv_nsec = (timeout_micros % 1000000) * 1000;
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected,
+          &timeout, nullptr, 0);
+}
+
+void FutexWake(std::atomic<uint32_t>* word) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, 1, nullptr,
+          nullptr, 0);
+}
+
+Status WriteAll(int fd, const char* data, size_t size) {
+  while (size > 0) {
+    ssize_t n = send(fd, data, size, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return ErrnoError("Failed to write to shared memory transfer socket");
+    }
+    data += n;
+    size -= n;
+  }
+  return Status::OK();
+}
+
+Status ReadAll(int fd, char* data, size_t size) {
+  while (size > 0) {
+    ssize_t n = recv(fd, data, size, 0);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return ErrnoError("Failed to read from shared memory transfer socket");
+    }
+    if (n == 0) {
+      return errors::Unavailable("Shared memory transfer socket was closed.");
+    }
+    data += n;
+    size -= n;
+  }
+  return Status::OK();
+}
+
+// Messages are sent as their size followed by their serialization.
+Status SendMessage(int fd, const protobuf::MessageLite& message) {
+  std::string buffer(sizeof(uint32), '\0');
+  const size_t size = message.ByteSizeLong();
+  if (size >= kMaxMessageSize) {
+    return errors::ResourceExhausted("Message of ", size,
+                                     " bytes is too large to send.");
+  }
+  core::EncodeFixed32(&buffer[0], size);
+  if (!message.AppendToString(&buffer)) {
+    return errors::Internal("Failed to serialize message.");
+  }
+  return WriteAll(fd, buffer.data(), buffer.size());
+}
+
+// Receives a message of at most `max_size` bytes.
+Status ReceiveMessage(int fd, size_t max_size,
+                      protobuf::MessageLite* message) {
+  char size_buffer[sizeof(uint32)];
+  TF_RETURN_IF_ERROR(ReadAll(fd, size_buffer, sizeof(size_buffer)));
+  const uint32 size = core::DecodeFixed32(size_buffer);
+  if (size > max_size) {
+    return errors::DataLoss("Received a message of ", size,
+                            " bytes, but at most ", max_size,
+                            " bytes are expected.");
+  }
+  std::string buffer(size, '\0');
+  TF_RETURN_IF_ERROR(ReadAll(fd, &buffer[0], size));
+  if (!message->ParseFromString(buffer)) {
+    return errors::DataLoss("Failed to parse message.");
+  }
+  return Status::OK();
+}
+
+// Sends the file descriptor of the ring and its capacity.
+Status SendRing(int socket_fd, int ring_fd, int64_t capacity) {
+  char payload[sizeof(uint64)];
+  core::EncodeFixed64(payload, capacity);
+  struct iovec iov;
+  iov.iov_base = payload;
+  iov.iov_len = sizeof(payload);
+  char control[CMSG_SPACE(sizeof(int))];
+  memset(control, 0, sizeof(control));
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  memcpy(CMSG_DATA(cmsg), &ring_fd, sizeof(int));
+  if (sendmsg(socket_fd, &msg, MSG_NOSIGNAL) != sizeof(payload)) {
+    return ErrnoError("Failed to send shared memory ring");
+  }
+  return Status::OK();
+}
+
+Status ReceiveRing(int socket_fd, int* ring_fd, int64_t* capacity) {
+  char payload[sizeof(uint64)];
+  struct iovec iov;
+  iov.iov_base = payload;
+  iov.iov_len = sizeof(payload);
+  char control[CMSG_SPACE(sizeof(int))];
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  if (recvmsg(socket_fd, &msg, MSG_CMSG_CLOEXEC) != sizeof(payload)) {
+    return ErrnoError("Failed to receive shared memory ring");
+  }
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  if (cmsg == nullptr || cmsg->cmsg_level != SOL_SOCKET ||
+      cmsg->cmsg_type != SCM_RIGHTS) {
+    return errors::Unavailable("Did not receive a shared memory ring.");
+  }
+  memcpy(ring_fd, CMSG_DATA(cmsg), sizeof(int));
+  *capacity = core::DecodeFixed64(payload);
+  return Status::OK();
+}
+
+struct sockaddr_un SocketAddress(int port, socklen_t* length) {
+  // Abstract socket names start with '\0' and need no cleanup.
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  const std::string name = ShmTransferSocketName(port);
+  memcpy(addr.sun_path + 1, name.data(), name.size());
+  *length = offsetof(struct sockaddr_un, sun_path) + 1 + name.size();
+  return addr;
+}
+
+// A memory-mapped ring.
+class Ring {
+ public:
+  Ring(char* data, int64_t capacity) : data_(data), capacity_(capacity) {}
+  ~Ring() { munmap(data_, capacity_); }
+
+  char* data() const { return data_; }
+  int64_t capacity() const { return capacity_; }
+
+  BlockHeader* header(int64_t offset) const {
+    return reinterpret_cast<BlockHeader*>(data_ + offset);
+  }
+
+ private:
+  char* const data_;
+  const int64_t capacity_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(Ring);
+};
+
+// Maps the ring referred to by `fd`, which is closed.
+Status MapRing(int fd, int64_t capacity, std::shared_ptr<Ring>* ring) {
+  void* data =
+      mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return ErrnoError("Failed to map shared memory ring");
+  }
+  *ring = std::make_shared<Ring>(static_cast<char*>(data), capacity);
+  return Status::OK();
+}
+
+// The buffer of a tensor received in a block of the ring. Releases the block
+// when destroyed.
+class RingTensorBuffer : public TensorBuffer {
+ public:
+  RingTensorBuffer(std::shared_ptr<Ring> ring, int64_t offset, size_t size)
+      : TensorBuffer(ring->data() + offset + kBlockHeaderSize),
+        ring_(std::move(ring)),
+        offset_(offset),
+        size_(size) {}
+
+  ~RingTensorBuffer() override {
+    BlockHeader* header = ring_->header(offset_);
+    header->in_use.store(0, std::memory_order_release);
+    FutexWake(&header->in_use);
+  }
+
+  size_t size() const override { return size_; }
+  TensorBuffer* root_buffer() override { return this; }
+  void FillAllocationDescription(AllocationDescription* proto) const override {
+    proto->set_requested_bytes(size_);
+    proto->set_allocator_name("shm_transfer");
+  }
+  bool GetAllocatedBytes(size_t* out_bytes) const override { return false; }
+
+ private:
+  const std::shared_ptr<Ring> ring_;
+  const int64_t offset_;
+  const size_t size_;
+};
+
+bool CanUseRing(const std::vector<Tensor>& components) {
+  for (const Tensor& component : components) {
+    if (!DataTypeCanUseMemcpy(component.dtype())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Moves the element into the response like the gRPC worker does.
+Status MoveElementToResponse(std::vector<Tensor>&& element,
+                             GetElementResponse& resp) {
+  if (element.size() != 1 || element[0].dtype() != DT_VARIANT ||
+      !TensorShapeUtils::IsScalar(element[0].shape())) {
+    for (const auto& component : element) {
+      UncompressedElement* uncompressed = resp.mutable_uncompressed();
+      component.AsProtoTensorContent(uncompressed->add_components());
+    }
+    return Status::OK();
+  }
+  Variant& variant = element[0].scalar<Variant>()();
+  CompressedElement* compressed = variant.get<CompressedElement>();
+  if (compressed == nullptr) {
+    return errors::FailedPrecondition(
+        "Expected dataset to produce a CompressedElement variant tensor, but "
+        "it produced ",
+        variant.TypeName());
+  }
+  *resp.mutable_compressed() = *compressed;
+  return Status::OK();
+}
+
+class ShmDataTransferClient : public DataTransferClient {
+ public:
+  ShmDataTransferClient(int fd, std::shared_ptr<Ring> ring)
+      : fd_(fd), ring_(std::move(ring)) {}
+
+  ~ShmDataTransferClient() override { close(fd_); }
+
+  Status GetElement(const GetElementRequest& req,
+                    GetElementResult& result) override {
+    VLOG(3) << "GetElement for task " << req.task_id()
+            << " from shared memory worker server.";
+    // Requests are answered in order, so only one may be in flight.
+    mutex_lock l(mu_);
+    TF_RETURN_IF_ERROR(VerifyClientIsNotCancelled());
+    ShmGetElementResponse resp;
+    Status s = SendMessage(fd_, req);
+    if (s.ok()) {
+      s = ReceiveMessage(fd_, kMaxMessageSize, &resp);
+    }
+    if (!s.ok()) {
+      TF_RETURN_IF_ERROR(VerifyClientIsNotCancelled());
+      return s;
+    }
+    if (resp.error_code() != error::OK) {
+      return Status(static_cast<error::Code>(resp.error_code()),
+                    resp.error_message());
+    }
+    const GetElementResponse& element = resp.response();
+    result.end_of_sequence = element.end_of_sequence();
+    result.skip = element.skip_task();
+    result.element_index = element.element_index();
+    switch (element.element_case()) {
+      case GetElementResponse::kCompressed: {
+        Tensor tensor(DT_VARIANT, TensorShape{});
+        tensor.scalar<Variant>()() = std::move(element.compressed());
+        result.components.push_back(tensor);
+        break;
+      }
+      case GetElementResponse::kUncompressed:
+        for (const auto& component : element.uncompressed().components()) {
+          result.components.emplace_back();
+          if (!result.components.back().FromProto(component)) {
+            return errors::Internal("Failed to parse tensor.");
+          }
+        }
+        break;
+      case GetElementResponse::ELEMENT_NOT_SET:
+        break;
+    }
+    for (const ShmComponent& component : resp.components()) {
+      TF_RETURN_IF_ERROR(ReadComponent(component, result.components));
+    }
+    return Status::OK();
+  }
+
+  void TryCancel() override {
+    VLOG(2) << "Cancel ShmDataTransferClient.";
+    mutex_lock l(cancel_mu_);
+    cancelled_ = true;
+    // Unblocks the in-flight request, if any.
+    shutdown(fd_, SHUT_RDWR);
+  }
+
+ private:
+  Status VerifyClientIsNotCancelled() TF_LOCKS_EXCLUDED(cancel_mu_) {
+    mutex_lock l(cancel_mu_);
+    if (cancelled_) {
+      return errors::Cancelled("Client was cancelled.");
+    }
+    return Status::OK();
+  }
+
+  // Wraps a component written to the ring in a tensor.
+  Status ReadComponent(const ShmComponent& component,
+                       std::vector<Tensor>& components) {
+    TF_RETURN_IF_ERROR(TensorShape::IsValidShape(component.tensor_shape()));
+    TensorShape shape(component.tensor_shape());
+    if (component.offset() < 0) {
+      components.emplace_back(component.dtype(), shape);
+      return Status::OK();
+    }
+    const size_t size = DataTypeSize(component.dtype()) * shape.num_elements();
+    if (component.offset() + kBlockHeaderSize + size > ring_->capacity()) {
+      return errors::DataLoss("Component of ", size, " bytes at offset ",
+                              component.offset(),
+                              " is outside of the shared memory ring.");
+    }
+    auto* buffer = new RingTensorBuffer(ring_, component.offset(), size);
+    components.emplace_back(component.dtype(), shape, buffer);
+    buffer->Unref();
+    return Status::OK();
+  }
+
+  const int fd_;
+  const std::shared_ptr<Ring> ring_;
+  mutex mu_;
+  mutex cancel_mu_;
+  bool cancelled_ TF_GUARDED_BY(cancel_mu_) = false;
+};
+
+}  // namespace
+
+// A connection with a client, served by its own thread.
+class ShmDataTransferServer::Connection {
+ public:
+  explicit Connection(int fd) : fd_(fd) {}
+
+  ~Connection() { close(fd_); }
+
+  // Serves the requests of the client until it disconnects or `Close` is
+  // called. The client gets a ring only if it sends a token issued by
+  // `server`.
+  Status Serve(ShmDataTransferServer& server) {
+    TF_RETURN_IF_ERROR(Authenticate(server));
+    TF_RETURN_IF_ERROR(CreateRing(server.ring_capacity_bytes_));
+    while (true) {
+      GetElementRequest req;
+      TF_RETURN_IF_ERROR(ReceiveMessage(fd_, kMaxRequestSize, &req));
+      ShmGetElementResponse resp;
+      HandleRequest(server.get_element_, req, resp);
+      TF_RETURN_IF_ERROR(SendMessage(fd_, resp));
+    }
+  }
+
+  // Unblocks `Serve`.
+  void Close() { shutdown(fd_, SHUT_RDWR); }
+
+  bool closed() const { return closed_.load(); }
+  void set_closed() { closed_.store(true); }
+
+ private:
+  Status Authenticate(ShmDataTransferServer& server) {
+    // Clients which do not send their token do not hold on to a connection.
+    TF_RETURN_IF_ERROR(SetReceiveTimeout(fd_, kConnectTimeoutSeconds));
+    ShmConnectRequest req;
+    TF_RETURN_IF_ERROR(ReceiveMessage(fd_, kMaxRequestSize, &req));
+    TF_RETURN_IF_ERROR(SetReceiveTimeout(fd_, /*seconds=*/0));
+    if (!server.ConsumeToken(req.token())) {
+      return errors::PermissionDenied(
+          "Shared memory transfer client sent an invalid token.");
+    }
+    return Status::OK();
+  }
+
+  Status CreateRing(int64_t capacity) {
+    int ring_fd = syscall(SYS_memfd_create, "tf_data_shm_transfer",
+                          /*MFD_CLOEXEC=*/1U);
+    if (ring_fd < 0) {
+      return ErrnoError("Failed to create shared memory ring");
+    }
+    if (ftruncate(ring_fd, capacity) != 0) {
+      close(ring_fd);
+      return ErrnoError("Failed to size shared memory ring");
+    }
+    Status s = SendRing(fd_, ring_fd, capacity);
+    if (!s.ok()) {
+      close(ring_fd);
+      return s;
+    }
+    return MapRing(ring_fd, capacity, &ring_);
+  }
+
+  void HandleRequest(const GetElementT& get_element,
+                     const GetElementRequest& req,
+                     ShmGetElementResponse& resp) {
+    GetElementResult result;
+    Status s = get_element(&req, &result);
+    if (s.ok()) {
+      GetElementResponse* element = resp.mutable_response();
+      element->set_end_of_sequence(result.end_of_sequence);
+      element->set_skip_task(result.skip);
+      element->set_element_index(result.element_index);
+      if (!result.components.empty() &&
+          !(CanUseRing(result.components) &&
+            WriteToRing(result.components, resp))) {
+        s = MoveElementToResponse(std::move(result.components), *element);
+      }
+    }
+    if (!s.ok()) {
+      resp.Clear();
+      resp.set_error_code(s.code());
+      resp.set_error_message(s.error_message());
+    }
+  }
+
+  // Copies the components into the ring. Returns false if they do not fit in
+  // the ring before the client releases enough of it.
+  bool WriteToRing(const std::vector<Tensor>& components,
+                   ShmGetElementResponse& resp) {
+    const uint64 deadline_micros = Env::Default()->NowMicros() +
+                                   kReleaseTimeoutMicros;
+    std::vector<int64_t> offsets;
+    for (const Tensor& component : components) {
+      const StringPiece data = component.tensor_data();
+      int64_t offset = -1;
+      if (!data.empty()) {
+        if (!Allocate(data.size(), deadline_micros, &offset)) {
+          // Releases the blocks allocated to the previous components.
+          for (int64_t allocated : offsets) {
+            if (allocated >= 0) {
+              ring_->header(allocated)->in_use.store(0);
+            }
+          }
+          resp.clear_components();
+          return false;
+        }
+        memcpy(ring_->data() + offset + kBlockHeaderSize, data.data(),
+               data.size());
+      }
+      offsets.push_back(offset);
+      ShmComponent* shm_component = resp.add_components();
+      shm_component->set_dtype(component.dtype());
+      component.shape().AsProto(shm_component->mutable_tensor_shape());
+      shm_component->set_offset(offset);
+    }
+    return true;
+  }
+
+  // Allocates a block for `size` bytes of data, waiting until
+  // `deadline_micros` for the client to release blocks if the ring is full.
+  bool Allocate(size_t size, uint64 deadline_micros, int64_t* offset) {
+    const int64_t block_size = kBlockHeaderSize + RoundUpToAlignment(size);
+    if (block_size > ring_->capacity()) {
+      return false;
+    }
+    while (true) {
+      // Blocks are reclaimed in the order they were allocated.
+      while (!blocks_.empty() &&
+             ring_->header(blocks_.front().first)->in_use.load(
+                 std::memory_order_acquire) == 0) {
+        if (blocks_.front().first == stalled_head_) {
+          stalled_head_ = -1;
+        }
+        blocks_.pop_front();
+      }
+      if (FindSpace(block_size, offset)) {
+        ring_->header(*offset)->in_use.store(1, std::memory_order_relaxed);
+        blocks_.emplace_back(*offset, block_size);
+        tail_ = *offset + block_size;
+        return true;
+      }
+      // A block which the client keeps, e.g. in a shuffle buffer, would
+      // otherwise delay every later element which does not fit. They are sent
+      // through the socket without waiting until it is released.
+      const int64_t head = blocks_.front().first;
+      if (head == stalled_head_) {
+        return false;
+      }
+      const uint64 now_micros = Env::Default()->NowMicros();
+      if (now_micros >= deadline_micros) {
+        stalled_head_ = head;
+        return false;
+      }
+      FutexWait(&ring_->header(head)->in_use, /*expected=*/1,
+                deadline_micros - now_micros);
+    }
+  }
+
+  // Finds free space for a block of `block_size` bytes after the allocated
+  // blocks, wrapping around to the start of the ring if needed.
+  bool FindSpace(int64_t block_size, int64_t* offset) {
+    if (blocks_.empty()) {
+      *offset = 0;
+      return true;
+    }
+    const int64_t head = blocks_.front().first;
+    if (tail_ > head) {
+      if (tail_ + block_size <= ring_->capacity()) {
+        *offset = tail_;
+        return true;
+      }
+      if (block_size <= head) {
+        *offset = 0;
+        return true;
+      }
+      return false;
+    }
+    if (tail_ + block_size <= head) {
+      *offset = tail_;
+      return true;
+    }
+    return false;
+  }
+
+  const int fd_;
+  std::shared_ptr<Ring> ring_;
+  // The offsets and sizes of the blocks held by the client, oldest first.
+  std::deque<std::pair<int64_t, int64_t>> blocks_;
+  // The end of the newest block.
+  int64_t tail_ = 0;
+  // The offset of the oldest block if the server timed out waiting for the
+  // client to release it, or -1.
+  int64_t stalled_head_ = -1;
+  std::atomic<bool> closed_{false};
+};
+
+ShmDataTransferServer::ShmDataTransferServer(GetElementT get_element, int port,
+                                             int64_t ring_capacity_bytes,
+                                             int64_t max_connections)
+    : get_element_(std::move(get_element)),
+      port_(port),
+      ring_capacity_bytes_(RoundUpToAlignment(ring_capacity_bytes)),
+      max_connections_(max_connections) {}
+
+ShmDataTransferServer::~ShmDataTransferServer() {
+  absl::flat_hash_map<std::shared_ptr<Connection>, std::unique_ptr<Thread>>
+      connections;
+  {
+    mutex_lock l(mu_);
+    stopped_ = true;
+    if (listen_fd_ >= 0) {
+      // Unblocks `accept`.
+      shutdown(listen_fd_, SHUT_RDWR);
+    }
+    for (auto& connection : connections_) {
+      connection.first->Close();
+    }
+  }
+  accept_thread_.reset();
+  {
+    mutex_lock l(mu_);
+    connections = std::move(connections_);
+    if (listen_fd_ >= 0) {
+      close(listen_fd_);
+    }
+  }
+  // Joins the connection threads.
+  connections.clear();
+}
+
+Status ShmDataTransferServer::Start() {
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return ErrnoError("Failed to create shared memory transfer socket");
+  }
+  socklen_t length;
+  struct sockaddr_un addr = SocketAddress(port_, &length);
+  if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), length) != 0 ||
+      listen(fd, SOMAXCONN) != 0) {
+    Status s = ErrnoError(
+        absl::StrCat("Failed to listen on shared memory transfer socket ",
+                     ShmTransferSocketName(port_)));
+    close(fd);
+    return s;
+  }
+  {
+    mutex_lock l(mu_);
+    listen_fd_ = fd;
+  }
+  accept_thread_ = absl::WrapUnique(Env::Default()->StartThread(
+      {}, "tf_data_shm_transfer_accept", [this]() { AcceptLoop(); }));
+  return Status::OK();
+}
+
+void ShmDataTransferServer::AcceptLoop() {
+  int listen_fd;
+  {
+    mutex_lock l(mu_);
+    listen_fd = listen_fd_;
+  }
+  while (true) {
+    int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+    mutex_lock l(mu_);
+    if (stopped_) {
+      if (fd >= 0) {
+        close(fd);
+      }
+      return;
+    }
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) continue;
+      LOG(ERROR) << "Failed to accept shared memory transfer connection: "
+                 << strerror(errno);
+      return;
+    }
+    // Abstract sockets have no file permissions, so clients of other users
+    // are rejected here.
+    struct ucred peer;
+    socklen_t peer_length = sizeof(peer);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &peer, &peer_length) != 0 ||
+        peer.uid != geteuid()) {
+      LOG(WARNING) << "Rejected shared memory transfer connection from a "
+                   << "process of another user.";
+      close(fd);
+      continue;
+    }
+    JoinClosedConnections();
+    if (static_cast<int64_t>(connections_.size()) >= max_connections_) {
+      // The client reads through gRPC instead.
+      LOG(WARNING) << "Rejected shared memory transfer connection: "
+                   << max_connections_ << " clients are already connected.";
+      close(fd);
+      continue;
+    }
+    auto connection = std::make_shared<Connection>(fd);
+    connections_[connection] = absl::WrapUnique(Env::Default()->StartThread(
+        {}, "tf_data_shm_transfer_connection", [this, connection]() {
+          Status s = connection->Serve(*this);
+          VLOG(2) << "Shared memory transfer connection closed: " << s;
+          connection->set_closed();
+        }));
+  }
+}
+
+std::string ShmDataTransferServer::IssueToken() {
+  std::random_device random;
+  std::string token(kTokenBytes, '\0');
+  for (char& c : token) {
+    c = static_cast<char>(random());
+  }
+  mutex_lock l(mu_);
+  tokens_.push_back(token);
+  if (tokens_.size() > kMaxOutstandingTokens) {
+    tokens_.pop_front();
+  }
+  return token;
+}
+
+bool ShmDataTransferServer::ConsumeToken(const std::string& token) {
+  mutex_lock l(mu_);
+  auto it = std::find(tokens_.begin(), tokens_.end(), token);
+  if (it == tokens_.end()) {
+    return false;
+  }
+  tokens_.erase(it);
+  return true;
+}
+
+void ShmDataTransferServer::JoinClosedConnections() {
+  for (auto it = connections_.begin(); it != connections_.end();) {
+    if (it->first->closed()) {
+      connections_.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+}
+
+Status CreateShmDataTransferClient(const std::string& address,
+                                   const std::string& token,
+                                   std::unique_ptr<DataTransferClient>* out) {
+  const size_t colon = address.rfind(':');
+  int port;
+  if (colon == std::string::npos ||
+      !absl::SimpleAtoi(address.substr(colon + 1), &port)) {
+    return errors::Unavailable("Cannot find the port of worker address ",
+                               address);
+  }
+  const std::string host = address.substr(0, colon);
+  if (host != "localhost" && host != "127.0.0.1" && host != "[::1]" &&
+      host != port::Hostname()) {
+    return errors::Unavailable("Worker ", address, " is not on this host.");
+  }
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return ErrnoError("Failed to create shared memory transfer socket");
+  }
+  socklen_t length;
+  struct sockaddr_un addr = SocketAddress(port, &length);
+  if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), length) != 0) {
+    Status s = ErrnoError(absl::StrCat(
+        "Failed to connect to shared memory transfer server of ", address));
+    close(fd);
+    return s;
+  }
+  ShmConnectRequest req;
+  req.set_token(token);
+  int ring_fd;
+  int64_t capacity;
+  std::shared_ptr<Ring> ring;
+  // The server closes the socket instead of sending the ring if it rejects
+  // the client.
+  Status s = SendMessage(fd, req);
+  if (s.ok()) {
+    s = ReceiveRing(fd, &ring_fd, &capacity);
+  }
+  if (s.ok()) {
+    s = MapRing(ring_fd, capacity, &ring);
+  }
+  if (!s.ok()) {
+    close(fd);
+    return s;
+  }
+  VLOG(2) << "Create ShmDataTransferClient for worker " << address << ".";
+  *out = absl::make_unique<ShmDataTransferClient>(fd, std::move(ring));
+  return Status::OK();
+}
+
+#else  // defined(__linux__) && defined(SYS_memfd_create)
+
+class ShmDataTransferServer::Connection {};
+
+ShmDataTransferServer::ShmDataTransferServer(GetElementT get_element, int port,
+                                             int64_t ring_capacity_bytes,
+                                             int64_t max_connections)
+    : get_element_(std::move(get_element)),
+      port_(port),
+      ring_capacity_bytes_(ring_capacity_bytes),
+      max_connections_(max_connections) {}
+
+ShmDataTransferServer::~ShmDataTransferServer() {}
+
+Status ShmDataTransferServer::Start() {
+  LOG(WARNING) << "Shared memory transfers are not supported on this "
+               << "platform. Clients will read through gRPC instead.";
+  return Status::OK();
+}
+
+std::string ShmDataTransferServer::IssueToken() { return ""; }
+
+bool ShmDataTransferServer::ConsumeToken(const std::string& token) {
+  return false;
+}
+
+void ShmDataTransferServer::AcceptLoop() {}
+
+void ShmDataTransferServer::JoinClosedConnections() {}
+
+Status CreateShmDataTransferClient(const std::string& address,
+                                   const std::string& token,
+                                   std::unique_ptr<DataTransferClient>* out) {
+  return errors::Unavailable(
+      "Shared memory transfers are not supported on this platform.");
+}
+
+#endif  // defined(__linux__) && defined(SYS_memfd_create)
+
+}  // namespace data
+}  // namespace tensorflow
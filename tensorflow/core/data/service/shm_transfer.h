@@ -0,0 +1,115 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_SERVICE_SHM_TRANSFER_H_
+#define TENSORFLOW_CORE_DATA_SERVICE_SHM_TRANSFER_H_
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/data/service/data_transfer.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace data {
+
+// Transfers elements between a tf.data service worker and clients on the same
+// host through shared memory.
+//
+// Each client gets a one-time token from the worker through gRPC, connects to
+// a Unix domain socket named after the port of the worker's gRPC server with
+// the token, and receives a memory-mapped ring from the worker. The worker only
+// accepts clients of its own user, and a limited number of them.
+// Requests and small responses go through the socket. The components of
+// elements are copied into the ring by the worker, and handed to the client as
+// tensors backed by the ring, without serialization. Destroying the tensors
+// releases their blocks of the ring, waking up the worker through a futex if
+// it is waiting for space.
+//
+// Elements are sent through the socket as protos, like with gRPC, if they
+// are compressed, have components which cannot be memcpy'd, or do not fit in
+// the ring in time. Clients which cannot connect to the socket, e.g. because
+// they are on another host, read from the worker through gRPC instead.
+//
+// Only supported on Linux.
+constexpr const char kShmTransferProtocol[] = "shm";
+
+// Returns the name of the socket of the shared memory transfer server for the
+// worker whose gRPC server listens on `port`.
+std::string ShmTransferSocketName(int port);
+
+// Serves GetElement requests through shared memory, see above.
+class ShmDataTransferServer : public DataTransferServer {
+ public:
+  // Serves the elements returned by `get_element` for the worker whose gRPC
+  // server listens on `port`. Each client gets a ring of
+  // `ring_capacity_bytes`, and at most `max_connections` clients are served at
+  // the same time.
+  ShmDataTransferServer(GetElementT get_element, int port,
+                        int64_t ring_capacity_bytes, int64_t max_connections);
+
+  // Disconnects all clients, blocking until in-flight requests finish.
+  ~ShmDataTransferServer() override;
+
+  Status Start() override;
+
+  int get_port() override { return port_; }
+
+  // Returns a token which allows one client to connect.
+  std::string IssueToken() TF_LOCKS_EXCLUDED(mu_);
+
+ private:
+  class Connection;
+
+  // Returns whether `token` was issued and not used yet, and marks it used.
+  bool ConsumeToken(const std::string& token) TF_LOCKS_EXCLUDED(mu_);
+
+  // Accepts connections until the server is destroyed.
+  void AcceptLoop() TF_LOCKS_EXCLUDED(mu_);
+
+  // Joins the threads of connections which were closed by their clients.
+  void JoinClosedConnections() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const GetElementT get_element_;
+  const int port_;
+  const int64_t ring_capacity_bytes_;
+  const int64_t max_connections_;
+
+  mutex mu_;
+  // Tokens which were issued but not used yet, oldest first.
+  std::deque<std::string> tokens_ TF_GUARDED_BY(mu_);
+  int listen_fd_ TF_GUARDED_BY(mu_) = -1;
+  bool stopped_ TF_GUARDED_BY(mu_) = false;
+  absl::flat_hash_map<std::shared_ptr<Connection>, std::unique_ptr<Thread>>
+      connections_ TF_GUARDED_BY(mu_);
+  std::unique_ptr<Thread> accept_thread_;
+};
+
+// Connects to the shared memory transfer server of the worker at `address`
+// with a `token` issued by the worker. Returns Unavailable if the worker is not
+// on this host, does not serve shared memory transfers, or rejects the client.
+Status CreateShmDataTransferClient(const std::string& address,
+                                   const std::string& token,
+                                   std::unique_ptr<DataTransferClient>* out);
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_SERVICE_SHM_TRANSFER_H_
@@ -0,0 +1,310 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/shm_transfer.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/data/service/data_transfer.h"
+#include "tensorflow/core/data/service/worker.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/net.h"
+#include "tensorflow/core/platform/status_matchers.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/protobuf/error_codes.pb.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+using ::tensorflow::testing::StatusIs;
+
+class ShmTransferTest : public ::testing::Test {
+ protected:
+  Status StartServer(int64_t ring_capacity_bytes,
+                     DataTransferServer::GetElementT get_element,
+                     int64_t max_connections = 16) {
+    port_ = tensorflow::internal::PickUnusedPortOrDie();
+    server_ = absl::make_unique<ShmDataTransferServer>(
+        std::move(get_element), port_, ring_capacity_bytes, max_connections);
+    return server_->Start();
+  }
+
+  Status CreateClient(std::unique_ptr<DataTransferClient>* client) {
+    return CreateClient(server_ ? server_->IssueToken() : "", client);
+  }
+
+  Status CreateClient(const std::string& token,
+                      std::unique_ptr<DataTransferClient>* client) {
+    return CreateShmDataTransferClient(absl::StrCat("localhost:", port_),
+                                       token, client);
+  }
+
+  int port_ = 0;
+  std::unique_ptr<ShmDataTransferServer> server_;
+};
+
+// Returns elements whose first component has `element_bytes` bytes, and whose
+// second component is their index.
+DataTransferServer::GetElementT RangeGetter(int64_t element_bytes) {
+  auto next = std::make_shared<int64_t>(0);
+  return [element_bytes, next](const GetElementRequest* req,
+                               GetElementResult* result) {
+    Tensor data(DT_UINT8, TensorShape({element_bytes}));
+    data.flat<uint8>().setConstant(static_cast<uint8>(*next));
+    result->components = {data, Tensor(int64_t{*next})};
+    result->element_index = (*next)++;
+    return Status::OK();
+  };
+}
+
+TEST_F(ShmTransferTest, ReadElements) {
+  TF_ASSERT_OK(StartServer(/*ring_capacity_bytes=*/1 << 20, RangeGetter(100)));
+  std::unique_ptr<DataTransferClient> client;
+  TF_ASSERT_OK(CreateClient(&client));
+  for (int64_t i = 0; i < 10; ++i) {
+    GetElementResult result;
+    TF_ASSERT_OK(client->GetElement(GetElementRequest(), result));
+    ASSERT_EQ(result.components.size(), 2);
+    Tensor expected(DT_UINT8, TensorShape({100}));
+    expected.flat<uint8>().setConstant(static_cast<uint8>(i));
+    test::ExpectEqual(result.components[0], expected);
+    test::ExpectEqual(result.components[1], Tensor(i));
+    EXPECT_EQ(result.element_index, i);
+    EXPECT_FALSE(result.end_of_sequence);
+  }
+}
+
+TEST_F(ShmTransferTest, RingWrapsAround) {
+  // Each element takes 1152 bytes of the ring, so the ring holds 5 elements.
+  TF_ASSERT_OK(StartServer(/*ring_capacity_bytes=*/6 << 10, RangeGetter(900)));
+  std::unique_ptr<DataTransferClient> client;
+  TF_ASSERT_OK(CreateClient(&client));
+  for (int64_t i = 0; i < 100; ++i) {
+    GetElementResult result;
+    TF_ASSERT_OK(client->GetElement(GetElementRequest(), result));
+    test::ExpectEqual(result.components[1], Tensor(i));
+  }
+}
+
+TEST_F(ShmTransferTest, RingFull) {
+  TF_ASSERT_OK(StartServer(/*ring_capacity_bytes=*/4 << 10, RangeGetter(900)));
+  std::unique_ptr<DataTransferClient> client;
+  TF_ASSERT_OK(CreateClient(&client));
+  // Holding on to the elements keeps the ring full, so later elements are
+  // sent through the socket instead.
+  std::vector<GetElementResult> results(5);
+  for (int64_t i = 0; i < results.size(); ++i) {
+    TF_ASSERT_OK(client->GetElement(GetElementRequest(), results[i]));
+  }
+  for (int64_t i = 0; i < results.size(); ++i) {
+    Tensor expected(DT_UINT8, TensorShape({900}));
+    expected.flat<uint8>().setConstant(static_cast<uint8>(i));
+    test::ExpectEqual(results[i].components[0], expected);
+    test::ExpectEqual(results[i].components[1], Tensor(i));
+  }
+}
+
+TEST_F(ShmTransferTest, HeldBlockDoesNotDelayLaterElements) {
+  TF_ASSERT_OK(StartServer(/*ring_capacity_bytes=*/4 << 10, RangeGetter(900)));
+  std::unique_ptr<DataTransferClient> client;
+  TF_ASSERT_OK(CreateClient(&client));
+  GetElementResult held;
+  TF_ASSERT_OK(client->GetElement(GetElementRequest(), held));
+  // Only the first element which does not fit waits for the held block.
+  const uint64 start_micros = Env::Default()->NowMicros();
+  for (int64_t i = 1; i < 100; ++i) {
+    GetElementResult result;
+    TF_ASSERT_OK(client->GetElement(GetElementRequest(), result));
+    test::ExpectEqual(result.components[1], Tensor(i));
+  }
+  EXPECT_LT(Env::Default()->NowMicros() - start_micros, 1000 * 1000);
+  test::ExpectEqual(held.components[1], Tensor(int64_t{0}));
+}
+
+TEST_F(ShmTransferTest, StringsAndEmptyTensors) {
+  TF_ASSERT_OK(StartServer(
+      /*ring_capacity_bytes=*/1 << 20,
+      [](const GetElementRequest* req, GetElementResult* result) {
+        result->components = {Tensor(tstring("hello")),
+                              Tensor(DT_FLOAT, TensorShape({0, 3}))};
+        return Status::OK();
+      }));
+  std::unique_ptr<DataTransferClient> client;
+  TF_ASSERT_OK(CreateClient(&client));
+  GetElementResult result;
+  TF_ASSERT_OK(client->GetElement(GetElementRequest(), result));
+  ASSERT_EQ(result.components.size(), 2);
+  test::ExpectEqual(result.components[0], Tensor(tstring("hello")));
+  test::ExpectEqual(result.components[1],
+                    Tensor(DT_FLOAT, TensorShape({0, 3})));
+}
+
+TEST_F(ShmTransferTest, EndOfSequence) {
+  TF_ASSERT_OK(StartServer(
+      /*ring_capacity_bytes=*/1 << 20,
+      [](const GetElementRequest* req, GetElementResult* result) {
+        result->end_of_sequence = true;
+        return Status::OK();
+      }));
+  std::unique_ptr<DataTransferClient> client;
+  TF_ASSERT_OK(CreateClient(&client));
+  GetElementResult result;
+  TF_ASSERT_OK(client->GetElement(GetElementRequest(), result));
+  EXPECT_TRUE(result.end_of_sequence);
+  EXPECT_TRUE(result.components.empty());
+}
+
+TEST_F(ShmTransferTest, Error) {
+  TF_ASSERT_OK(StartServer(
+      /*ring_capacity_bytes=*/1 << 20,
+      [](const GetElementRequest* req, GetElementResult* result) {
+        return errors::NotFound("Task ", req->task_id(), " not found.");
+      }));
+  std::unique_ptr<DataTransferClient> client;
+  TF_ASSERT_OK(CreateClient(&client));
+  GetElementRequest req;
+  req.set_task_id(3);
+  GetElementResult result;
+  EXPECT_THAT(client->GetElement(req, result),
+              StatusIs(error::NOT_FOUND, "Task 3 not found."));
+}
+
+TEST_F(ShmTransferTest, Cancel) {
+  TF_ASSERT_OK(StartServer(/*ring_capacity_bytes=*/1 << 20, RangeGetter(1)));
+  std::unique_ptr<DataTransferClient> client;
+  TF_ASSERT_OK(CreateClient(&client));
+  client->TryCancel();
+  GetElementResult result;
+  EXPECT_THAT(client->GetElement(GetElementRequest(), result),
+              StatusIs(error::CANCELLED));
+}
+
+TEST_F(ShmTransferTest, ServerNotRunning) {
+  port_ = tensorflow::internal::PickUnusedPortOrDie();
+  std::unique_ptr<DataTransferClient> client;
+  EXPECT_THAT(CreateClient(&client), StatusIs(error::UNAVAILABLE));
+}
+
+TEST_F(ShmTransferTest, RemoteWorker) {
+  std::unique_ptr<DataTransferClient> client;
+  EXPECT_THAT(CreateShmDataTransferClient("remote-host:1234", "token", &client),
+              StatusIs(error::UNAVAILABLE));
+}
+
+TEST_F(ShmTransferTest, InvalidToken) {
+  TF_ASSERT_OK(StartServer(/*ring_capacity_bytes=*/1 << 20, RangeGetter(1)));
+  std::unique_ptr<DataTransferClient> client;
+  EXPECT_THAT(CreateClient("invalid token", &client),
+              StatusIs(error::UNAVAILABLE));
+}
+
+TEST_F(ShmTransferTest, TokenIsUsedOnce) {
+  TF_ASSERT_OK(StartServer(/*ring_capacity_bytes=*/1 << 20, RangeGetter(1)));
+  const std::string token = server_->IssueToken();
+  std::unique_ptr<DataTransferClient> client;
+  TF_ASSERT_OK(CreateClient(token, &client));
+  std::unique_ptr<DataTransferClient> other_client;
+  EXPECT_THAT(CreateClient(token, &other_client),
+              StatusIs(error::UNAVAILABLE));
+}
+
+TEST_F(ShmTransferTest, TooManyConnections) {
+  TF_ASSERT_OK(StartServer(/*ring_capacity_bytes=*/1 << 20, RangeGetter(1),
+                           /*max_connections=*/2));
+  std::vector<std::unique_ptr<DataTransferClient>> clients(2);
+  for (auto& client : clients) {
+    TF_ASSERT_OK(CreateClient(&client));
+  }
+  std::unique_ptr<DataTransferClient> client;
+  EXPECT_THAT(CreateClient(&client), StatusIs(error::UNAVAILABLE));
+  // Clients may connect again once others disconnect.
+  clients.clear();
+  Status s;
+  for (int i = 0; i < 100; ++i) {
+    s = CreateClient(&client);
+    if (s.ok()) break;
+    Env::Default()->SleepForMicroseconds(10 * 1000);
+  }
+  TF_EXPECT_OK(s);
+}
+
+// Reads elements of `state.range(0)` bytes through shared memory.
+void BM_ShmTransfer(::testing::benchmark::State& state) {
+  const int64_t element_bytes = state.range(0);
+  const int port = tensorflow::internal::PickUnusedPortOrDie();
+  Tensor element(DT_UINT8, TensorShape({element_bytes}));
+  element.flat<uint8>().setZero();
+  ShmDataTransferServer server(
+      [&element](const GetElementRequest* req, GetElementResult* result) {
+        result->components = {element};
+        return Status::OK();
+      },
+      port, /*ring_capacity_bytes=*/int64_t{256} << 20,
+      /*max_connections=*/1);
+  TF_CHECK_OK(server.Start());
+  std::unique_ptr<DataTransferClient> client;
+  TF_CHECK_OK(CreateShmDataTransferClient(absl::StrCat("localhost:", port),
+                                          server.IssueToken(), &client));
+  for (auto s : state) {
+    GetElementResult result;
+    TF_CHECK_OK(client->GetElement(GetElementRequest(), result));
+  }
+  state.SetBytesProcessed(state.iterations() * element_bytes);
+}
+
+// Serializes and parses elements of `state.range(0)` bytes like the gRPC
+// transfer does, for comparison with `BM_ShmTransfer`.
+void BM_ProtoTransfer(::testing::benchmark::State& state) {
+  const int64_t element_bytes = state.range(0);
+  Tensor element(DT_UINT8, TensorShape({element_bytes}));
+  element.flat<uint8>().setZero();
+  for (auto s : state) {
+    GetElementResponse resp;
+    element.AsProtoTensorContent(resp.mutable_uncompressed()->add_components());
+    std::string serialized = resp.SerializeAsString();
+    GetElementResponse parsed;
+    CHECK(parsed.ParseFromString(serialized));
+    Tensor tensor;
+    CHECK(tensor.FromProto(parsed.uncompressed().components(0)));
+  }
+  state.SetBytesProcessed(state.iterations() * element_bytes);
+}
+
+BENCHMARK(BM_ShmTransfer)
+    ->UseRealTime()
+    ->Arg(1 << 10)
+    ->Arg(1 << 16)
+    ->Arg(1 << 20)
+    ->Arg(16 << 20);
+
+BENCHMARK(BM_ProtoTransfer)
+    ->UseRealTime()
+    ->Arg(1 << 10)
+    ->Arg(1 << 16)
+    ->Arg(1 << 20)
+    ->Arg(16 << 20);
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
@@ -18,38 +18,144 @@ limitations under the License.
 #include <functional>
 #include <memory>
 #include <string>
+#include <vector>
 
+#include "absl/memory/memory.h"
 #include "tensorflow/core/data/service/dispatcher_client.h"
 #include "tensorflow/core/data/service/grpc_util.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/random.h"
 #include "tensorflow/core/platform/status.h"
 
 namespace tensorflow {
 namespace data {
 
+DataServiceSplitProvider::DataServiceSplitProvider(
+    const std::string& address, const std::string& protocol, int64_t job_id,
+    int64_t split_provider_index, int64_t timeout_ms, int64_t prefetch_window)
+    : address_(address),
+      protocol_(protocol),
+      job_id_(job_id),
+      split_provider_index_(split_provider_index),
+      timeout_ms_(timeout_ms),
+      prefetch_window_(prefetch_window),
+      requester_id_(static_cast<int64_t>(random::New64())),
+      dispatcher_(
+          absl::make_unique<DataServiceDispatcherClient>(address, protocol)) {}
+
+DataServiceSplitProvider::~DataServiceSplitProvider() {
+  {
+    mutex_lock l(mu_);
+    cancelled_ = true;
+    cv_.notify_all();
+  }
+  // Joins the prefetch thread.
+  prefetch_thread_.reset();
+}
+
 Status DataServiceSplitProvider::GetNext(Tensor* split, bool* end_of_splits) {
   mutex_lock l(mu_);
-  if (!dispatcher_) {
-    dispatcher_ =
-        absl::make_unique<DataServiceDispatcherClient>(address_, protocol_);
+  if (prefetch_window_ <= 0) {
+    return grpc_util::Retry(
+        [this, split, end_of_splits] {
+          return dispatcher_->GetSplit(job_id_, repetition_,
+                                       split_provider_index_, *split,
+                                       *end_of_splits);
+        },
+        "get next split",
+        /*deadline_micros=*/Env::Default()->NowMicros() +
+            (timeout_ms_ * EnvTime::kMillisToMicros));
+  }
+  if (!prefetch_thread_) {
+    prefetch_thread_ = absl::WrapUnique(Env::Default()->StartThread(
+        {}, "tf_data_service_split_prefetch", [this] { PrefetchThread(); }));
+  }
+  while (splits_.empty() && !end_of_splits_ && status_.ok()) {
+    cv_.wait(l);
+  }
+  if (!splits_.empty()) {
+    *split = std::move(splits_.front());
+    splits_.pop_front();
+    *end_of_splits = false;
+    cv_.notify_all();
+    return Status::OK();
+  }
+  TF_RETURN_IF_ERROR(status_);
+  *end_of_splits = true;
+  return Status::OK();
+}
+
+void DataServiceSplitProvider::PrefetchThread() {
+  int64_t sequence_number = 0;
+  while (true) {
+    int64_t repetition;
+    int64_t max_splits;
+    {
+      mutex_lock l(mu_);
+      // Refills at a low watermark, so that requests are batched in the
+      // steady state.
+      const int64_t low_watermark = prefetch_window_ / 2;
+      while (!cancelled_ &&
+             (end_of_splits_ ||
+              static_cast<int64_t>(splits_.size()) > low_watermark)) {
+        cv_.wait(l);
+      }
+      if (cancelled_) {
+        return;
+      }
+      repetition = repetition_;
+      max_splits = prefetch_window_ - splits_.size();
+    }
+    // Retries reuse the sequence number, so that the dispatcher returns the
+    // splits of a request whose response was lost instead of skipping them.
+    ++sequence_number;
+    std::vector<Tensor> splits;
+    bool end_of_splits = false;
+    Status s = grpc_util::Retry(
+        [&] {
+          return dispatcher_->GetSplits(
+              job_id_, repetition, split_provider_index_, max_splits,
+              requester_id_, sequence_number, splits, end_of_splits);
+        },
+        [this] {
+          mutex_lock l(mu_);
+          return !cancelled_;
+        },
+        "get next splits",
+        /*deadline_micros=*/Env::Default()->NowMicros() +
+            (timeout_ms_ * EnvTime::kMillisToMicros));
+    mutex_lock l(mu_);
+    if (!s.ok()) {
+      status_ = s;
+      cv_.notify_all();
+      return;
+    }
+    if (repetition != repetition_) {
+      // The provider was reset while fetching, so the splits belong to a
+      // repetition which is no longer being read.
+      continue;
+    }
+    for (Tensor& split : splits) {
+      splits_.push_back(std::move(split));
+    }
+    end_of_splits_ = end_of_splits;
+    cv_.notify_all();
   }
-  return grpc_util::Retry(
-      [this, split, end_of_splits] {
-        return dispatcher_->GetSplit(job_id_, repetition_,
-                                     split_provider_index_, *split,
-                                     *end_of_splits);
-      },
-      "get next split",
-      /*deadline_micros=*/Env::Default()->NowMicros() +
-          (timeout_ms_ * EnvTime::kMillisToMicros));
 }
 
 Status DataServiceSplitProvider::Reset() {
   mutex_lock l(mu_);
   repetition_++;
+  if (!splits_.empty()) {
+    VLOG(1) << "Dropping " << splits_.size() << " prefetched splits of job "
+            << job_id_ << " on reset";
+  }
+  splits_.clear();
+  end_of_splits_ = false;
+  cv_.notify_all();
   return Status::OK();
 }
 
@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DATA_SERVICE_SPLIT_PROVIDER_H_
 #define TENSORFLOW_CORE_DATA_SERVICE_SPLIT_PROVIDER_H_
 
+#include <deque>
 #include <functional>
 #include <memory>
 #include <string>
@@ -23,6 +24,7 @@ limitations under the License.
 #include "tensorflow/core/data/service/dispatcher_client.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/status.h"
 
@@ -30,16 +32,21 @@ namespace tensorflow {
 namespace data {
 
 // SplitProvider which reads splits from a tf.data service dispatcher over RPC.
+//
+// If `prefetch_window` is positive, a background thread keeps up to
+// `prefetch_window` splits buffered, fetching them from the dispatcher in
+// batches, so that iteration doesn't wait for an RPC per split. The buffer is
+// refilled once it drains to half of the window, so that each request carries
+// a batch of splits rather than one split per consumed split. The dispatcher
+// assigns buffered splits to this provider, so like a split being processed
+// they are not handed to other workers if this worker fails.
 class DataServiceSplitProvider : public SplitProvider {
  public:
   DataServiceSplitProvider(const std::string& address,
                            const std::string& protocol, int64_t job_id,
-                           int64_t split_provider_index, int64_t timeout_ms)
-      : address_(address),
-        protocol_(protocol),
-        job_id_(job_id),
-        split_provider_index_(split_provider_index),
-        timeout_ms_(timeout_ms) {}
+                           int64_t split_provider_index, int64_t timeout_ms,
+                           int64_t prefetch_window = 0);
+  ~DataServiceSplitProvider() override;
 
   Status GetNext(Tensor* split, bool* end_of_splits) override;
   Status Reset() override;
@@ -49,15 +56,32 @@ class DataServiceSplitProvider : public SplitProvider {
                  IteratorStateReader* reader) override;
 
  private:
+  // Fills the split buffer until the dispatcher runs out of splits for the
+  // current repetition, waiting whenever the buffer is full.
+  void PrefetchThread();
+
   const std::string address_;
   const std::string protocol_;
   const int64_t job_id_;
   const int64_t split_provider_index_;
   const int64_t timeout_ms_;
+  const int64_t prefetch_window_;
+  // Identifies this provider's requests to the dispatcher.
+  const int64_t requester_id_;
+  const std::unique_ptr<DataServiceDispatcherClient> dispatcher_;
 
   mutex mu_;
-  int64_t repetition_ = 0;
-  std::unique_ptr<DataServiceDispatcherClient> dispatcher_;
+  condition_variable cv_;
+  int64_t repetition_ TF_GUARDED_BY(mu_) = 0;
+  // Prefetched splits of the current repetition.
+  std::deque<Tensor> splits_ TF_GUARDED_BY(mu_);
+  // Whether the dispatcher has no more splits for the current repetition.
+  bool end_of_splits_ TF_GUARDED_BY(mu_) = false;
+  // The error which stopped prefetching, if any.
+  Status status_ TF_GUARDED_BY(mu_);
+  bool cancelled_ TF_GUARDED_BY(mu_) = false;
+  // Started on the first call to `GetNext` when prefetching.
+  std::unique_ptr<Thread> prefetch_thread_;
 };
 
 }  // namespace data
@@ -14,6 +14,7 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/data/service/task_runner.h"
 
+#include <algorithm>
 #include <memory>
 #include <vector>
 
@@ -21,6 +22,7 @@ limitations under the License.
 #include "tensorflow/core/data/standalone.h"
 #include "tensorflow/core/framework/cancellation.h"
 #include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/framework/tensor_util.h"
 #include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/platform/env.h"
@@ -53,6 +55,169 @@ int64_t StandaloneTaskIterator::Cardinality() const {
   return dataset_->Get()->Cardinality();
 }
 
+SlidingWindowCache::SlidingWindowCache(std::unique_ptr<TaskIterator> iterator,
+                                       int64_t window_size)
+    : iterator_(std::move(iterator)),
+      window_size_(window_size),
+      cardinality_(iterator_->Cardinality()) {
+  VLOG(1) << "Creating sliding-window cache of " << window_size
+          << " elements";
+  thread_ = absl::WrapUnique(Env::Default()->StartThread(
+      {}, "tf_data_service_sliding_window_cache", [this] { Run(); }));
+}
+
+SlidingWindowCache::~SlidingWindowCache() {
+  {
+    mutex_lock l(mu_);
+    cancelled_ = true;
+    cv_.notify_all();
+  }
+  iterator_->Cancel();
+  thread_.reset();
+}
+
+bool SlidingWindowCache::AddReader(int64_t task_id, int64_t job_id) {
+  mutex_lock l(mu_);
+  if (window_start_ > 0 && cardinality_ != kInfiniteCardinality) {
+    return false;
+  }
+  auto reader = absl::make_unique<Reader>();
+  reader->job_id = job_id;
+  reader->position = window_start_;
+  metrics::RecordTFDataServiceCrossJobCacheLag(job_id,
+                                               EndLocked() - window_start_);
+  readers_[task_id] = std::move(reader);
+  return true;
+}
+
+void SlidingWindowCache::RemoveReader(int64_t task_id) {
+  mutex_lock l(mu_);
+  auto it = readers_.find(task_id);
+  if (it == readers_.end()) {
+    return;
+  }
+  metrics::RecordTFDataServiceCrossJobCacheLag(it->second->job_id, 0);
+  readers_.erase(it);
+  EvictLocked();
+  cv_.notify_all();
+}
+
+void SlidingWindowCache::CancelReader(int64_t task_id) {
+  mutex_lock l(mu_);
+  auto it = readers_.find(task_id);
+  if (it == readers_.end()) {
+    return;
+  }
+  it->second->cancelled = true;
+  EvictLocked();
+  cv_.notify_all();
+}
+
+Status SlidingWindowCache::GetNext(int64_t task_id,
+                                   std::vector<Tensor>& element,
+                                   bool& end_of_sequence) {
+  mutex_lock l(mu_);
+  auto it = readers_.find(task_id);
+  if (it == readers_.end()) {
+    return errors::Internal("Task ", task_id,
+                            " does not read from the sliding-window cache.");
+  }
+  // Readers are only removed once their task stops reading.
+  Reader* reader = it->second.get();
+  while (!cancelled_ && !reader->cancelled && status_.ok() &&
+         !end_of_sequence_ && reader->position >= EndLocked()) {
+    cv_.wait(l);
+  }
+  if (cancelled_ || reader->cancelled) {
+    return errors::Cancelled("Sliding-window cache reader is cancelled.");
+  }
+  if (reader->position < EndLocked()) {
+    element = window_[reader->position - window_start_];
+    end_of_sequence = false;
+    ++reader->position;
+    metrics::RecordTFDataServiceCrossJobCacheLag(
+        reader->job_id, EndLocked() - reader->position);
+    EvictLocked();
+    return Status::OK();
+  }
+  TF_RETURN_IF_ERROR(status_);
+  end_of_sequence = true;
+  return Status::OK();
+}
+
+void SlidingWindowCache::Run() {
+  while (true) {
+    {
+      mutex_lock l(mu_);
+      while (!cancelled_ && window_.size() >= window_size_) {
+        cv_.wait(l);
+      }
+      if (cancelled_) {
+        return;
+      }
+    }
+    std::vector<Tensor> element;
+    bool end_of_sequence;
+    Status s = iterator_->GetNext(element, end_of_sequence);
+    mutex_lock l(mu_);
+    if (!s.ok() || end_of_sequence) {
+      status_ = s;
+      end_of_sequence_ = end_of_sequence;
+      cv_.notify_all();
+      return;
+    }
+    window_.push_back(std::move(element));
+    for (const auto& reader : readers_) {
+      metrics::RecordTFDataServiceCrossJobCacheLag(
+          reader.second->job_id, EndLocked() - reader.second->position);
+    }
+    cv_.notify_all();
+  }
+}
+
+void SlidingWindowCache::EvictLocked() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  int64_t min_position = kint64max;
+  for (const auto& reader : readers_) {
+    if (!reader.second->cancelled) {
+      min_position = std::min(min_position, reader.second->position);
+    }
+  }
+  if (min_position == kint64max) {
+    // Keeps the elements for readers which may still join.
+    return;
+  }
+  bool evicted = false;
+  while (window_start_ < min_position) {
+    window_.pop_front();
+    ++window_start_;
+    evicted = true;
+  }
+  if (evicted) {
+    cv_.notify_all();
+  }
+}
+
+SlidingWindowCacheTaskIterator::SlidingWindowCacheTaskIterator(
+    std::shared_ptr<SlidingWindowCache> cache, int64_t task_id)
+    : cache_(std::move(cache)), task_id_(task_id) {}
+
+SlidingWindowCacheTaskIterator::~SlidingWindowCacheTaskIterator() {
+  cache_->RemoveReader(task_id_);
+}
+
+Status SlidingWindowCacheTaskIterator::GetNext(std::vector<Tensor>& element,
+                                               bool& end_of_sequence) {
+  return cache_->GetNext(task_id_, element, end_of_sequence);
+}
+
+int64_t SlidingWindowCacheTaskIterator::Cardinality() const {
+  return cache_->Cardinality();
+}
+
+void SlidingWindowCacheTaskIterator::Cancel() {
+  cache_->CancelReader(task_id_);
+}
+
 Status TaskRunner::Create(const experimental::WorkerConfig& worker_config,
                           const TaskDef& task_def,
                           std::unique_ptr<TaskIterator> iterator,
@@ -132,6 +297,7 @@ FirstComeFirstServedTaskRunner::GetNextFromInputIterator()
 void FirstComeFirstServedTaskRunner::Cancel() {
   VLOG(2) << "Cancelling tf.data service FCFS task.";
   buffer_.Cancel(errors::Cancelled("tf.data service FCFS task is cancelled."));
+  iterator_->Cancel();
 }
 
 RoundRobinTaskRunner::RoundRobinTaskRunner(
@@ -262,9 +428,12 @@ Status RoundRobinTaskRunner::GetNext(const GetElementRequest& req,
 }
 
 void RoundRobinTaskRunner::Cancel() {
-  mutex_lock l(mu_);
-  cancelled_ = true;
-  new_round_cv_.notify_all();
+  {
+    mutex_lock l(mu_);
+    cancelled_ = true;
+    new_round_cv_.notify_all();
+  }
+  prefetch_thread_.Cancel();
 }
 
 PrefetchThread::PrefetchThread(std::unique_ptr<TaskIterator> iterator,
@@ -274,10 +443,15 @@ PrefetchThread::PrefetchThread(std::unique_ptr<TaskIterator> iterator,
       Env::Default()->StartThread({}, "round-robin-prefetch", [&] { Run(); }));
 }
 
-PrefetchThread::~PrefetchThread() {
-  mutex_lock l(mu_);
-  cancelled_ = true;
-  cv_.notify_all();
+PrefetchThread::~PrefetchThread() { Cancel(); }
+
+void PrefetchThread::Cancel() {
+  {
+    mutex_lock l(mu_);
+    cancelled_ = true;
+    cv_.notify_all();
+  }
+  iterator_->Cancel();
 }
 
 void PrefetchThread::Run() {
@@ -15,9 +15,11 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DATA_SERVICE_TASK_RUNNER_H_
 #define TENSORFLOW_CORE_DATA_SERVICE_TASK_RUNNER_H_
 
+#include <deque>
 #include <memory>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "tensorflow/core/data/service/common.pb.h"
 #include "tensorflow/core/data/service/data_transfer.h"
 #include "tensorflow/core/data/service/thread_safe_buffer.h"
@@ -44,6 +46,9 @@ class TaskIterator {
                          bool& end_of_sequence) = 0;
   // Reports the cardinality of the dataset that created this iterator.
   virtual int64_t Cardinality() const = 0;
+  // Unblocks in-progress `GetNext` calls. Iterators whose `GetNext` always
+  // returns on its own do not need to override this.
+  virtual void Cancel() {}
 };
 
 // Implementation of TaskIterator wrapping a standalone iterator.
@@ -62,6 +67,86 @@ class StandaloneTaskIterator : public TaskIterator {
   std::unique_ptr<standalone::Iterator> iterator_;
 };
 
+// A sliding window over the elements of an iterator, shared by the tasks of
+// several jobs so that the elements are only produced once. Each task reads
+// the elements in order from its own position in the window. Elements are
+// evicted once all tasks have read them, and production blocks while the
+// slowest task is `window_size` elements behind.
+class SlidingWindowCache {
+ public:
+  SlidingWindowCache(std::unique_ptr<TaskIterator> iterator,
+                     int64_t window_size);
+  ~SlidingWindowCache();
+
+  // Adds a reader for task `task_id` of job `job_id`, starting at the oldest
+  // element in the window. Returns false if the task cannot join because
+  // elements of a finite dataset have already been evicted, so that it would
+  // not see all of them.
+  bool AddReader(int64_t task_id, int64_t job_id);
+  // Removes the reader of task `task_id`.
+  void RemoveReader(int64_t task_id);
+  // Unblocks `GetNext` calls for task `task_id`, and makes subsequent calls
+  // return Cancelled. The task no longer holds back eviction.
+  void CancelReader(int64_t task_id);
+  // Gets the next element for task `task_id`, blocking until it is produced.
+  Status GetNext(int64_t task_id, std::vector<Tensor>& element,
+                 bool& end_of_sequence);
+  // Reports the cardinality of the dataset that created the iterator.
+  int64_t Cardinality() const { return cardinality_; }
+
+ private:
+  struct Reader {
+    int64_t job_id;
+    // The index of the next element to read.
+    int64_t position;
+    bool cancelled = false;
+  };
+
+  // Produces elements until the end of the input, an error, or destruction.
+  void Run();
+  // Evicts the elements read by all active readers.
+  void EvictLocked() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // The index after the newest element in the window.
+  int64_t EndLocked() const TF_SHARED_LOCKS_REQUIRED(mu_) {
+    return window_start_ + window_.size();
+  }
+
+  const std::unique_ptr<TaskIterator> iterator_;
+  const int64_t window_size_;
+  const int64_t cardinality_;
+  mutex mu_;
+  // Notified when elements are produced or evicted, and on cancellation.
+  condition_variable cv_;
+  std::deque<std::vector<Tensor>> window_ TF_GUARDED_BY(mu_);
+  // The index of the oldest element in the window.
+  int64_t window_start_ TF_GUARDED_BY(mu_) = 0;
+  bool end_of_sequence_ TF_GUARDED_BY(mu_) = false;
+  Status status_ TF_GUARDED_BY(mu_);
+  bool cancelled_ TF_GUARDED_BY(mu_) = false;
+  // Readers keyed by task id.
+  absl::flat_hash_map<int64_t, std::unique_ptr<Reader>> readers_
+      TF_GUARDED_BY(mu_);
+  std::unique_ptr<Thread> thread_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(SlidingWindowCache);
+};
+
+// Task iterator reading from a `SlidingWindowCache` on behalf of a task whose
+// reader has already been added to the cache.
+class SlidingWindowCacheTaskIterator : public TaskIterator {
+ public:
+  SlidingWindowCacheTaskIterator(std::shared_ptr<SlidingWindowCache> cache,
+                                 int64_t task_id);
+  ~SlidingWindowCacheTaskIterator() override;
+  Status GetNext(std::vector<Tensor>& element, bool& end_of_sequence) override;
+  int64_t Cardinality() const override;
+  void Cancel() override;
+
+ private:
+  const std::shared_ptr<SlidingWindowCache> cache_;
+  const int64_t task_id_;
+};
+
 // Interface for providing elements to task consumers.
 class TaskRunner {
  public:
@@ -101,8 +186,9 @@ class FirstComeFirstServedTaskRunner : public TaskRunner {
   // Gets the next element from the input iterator.
   StatusOr<GetElementResult> GetNextFromInputIterator() TF_LOCKS_EXCLUDED(mu_);
 
+  // Calls to `iterator_->GetNext` are serialized by `mu_`.
+  const std::unique_ptr<TaskIterator> iterator_;
   mutex mu_;
-  std::unique_ptr<TaskIterator> iterator_ TF_GUARDED_BY(mu_);
   int64_t element_index_ TF_GUARDED_BY(mu_) = 0;
 
   ThreadSafeBuffer<GetElementResult> buffer_;
@@ -128,6 +214,8 @@ class PrefetchThread {
   explicit PrefetchThread(std::unique_ptr<TaskIterator> iterator,
                           int64_t round_size);
   ~PrefetchThread();
+  // Stops the prefetch thread and unblocks `FillBuffer` calls.
+  void Cancel();
   // Runs the prefetch thread. It runs until an error is encountered or the
   // destructor is called.
   void Run();
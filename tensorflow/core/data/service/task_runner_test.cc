@@ -75,6 +75,19 @@ class TestErrorIterator : public TaskIterator {
   const Status status_;
 };
 
+class FiniteTestTaskIterator : public TestTaskIterator {
+ public:
+  explicit FiniteTestTaskIterator(
+      const std::vector<std::vector<Tensor>>& elements)
+      : TestTaskIterator(elements, /*repeat=*/false),
+        cardinality_(elements.size()) {}
+
+  int64_t Cardinality() const override { return cardinality_; }
+
+ private:
+  const int64_t cardinality_;
+};
+
 std::vector<std::vector<Tensor>> GetRangeDataset(const size_t range) {
   std::vector<std::vector<Tensor>> dataset;
   for (int64_t i = 0; i < range; ++i) {
@@ -271,5 +284,145 @@ TEST(RoundRobinTaskRunner, ConsumeParallelPartialRound) {
               expected_consumer_results[consumer]);
   }
 }
+
+// Reads the next element of task `task_id` from `cache`.
+StatusOr<int64_t> ReadFromCache(SlidingWindowCache& cache, int64_t task_id) {
+  std::vector<Tensor> element;
+  bool end_of_sequence;
+  TF_RETURN_IF_ERROR(cache.GetNext(task_id, element, end_of_sequence));
+  if (end_of_sequence) {
+    return errors::OutOfRange("End of sequence");
+  }
+  return element[0].flat<int64_t>()(0);
+}
+
+TEST(SlidingWindowCacheTest, JobsShareElements) {
+  std::vector<std::vector<Tensor>> elements = GetRangeDataset(10);
+  auto cache = std::make_shared<SlidingWindowCache>(
+      absl::make_unique<TestTaskIterator>(elements, /*repeat=*/false),
+      /*window_size=*/2);
+  ASSERT_TRUE(cache->AddReader(/*task_id=*/0, /*job_id=*/0));
+  ASSERT_TRUE(cache->AddReader(/*task_id=*/1, /*job_id=*/1));
+  FirstComeFirstServedTaskRunner runner0(
+      absl::make_unique<SlidingWindowCacheTaskIterator>(cache, 0));
+  FirstComeFirstServedTaskRunner runner1(
+      absl::make_unique<SlidingWindowCacheTaskIterator>(cache, 1));
+  for (auto& expected_element : elements) {
+    for (TaskRunner* runner : {&runner0, &runner1}) {
+      GetElementResult result;
+      TF_ASSERT_OK(runner->GetNext(GetElementRequest(), result));
+      ASSERT_FALSE(result.end_of_sequence);
+      test::ExpectEqual(result.components[0], expected_element[0]);
+    }
+  }
+  for (TaskRunner* runner : {&runner0, &runner1}) {
+    GetElementResult result;
+    TF_ASSERT_OK(runner->GetNext(GetElementRequest(), result));
+    EXPECT_TRUE(result.end_of_sequence);
+  }
+}
+
+TEST(SlidingWindowCacheTest, SlowReaderHoldsWindow) {
+  SlidingWindowCache cache(
+      absl::make_unique<TestTaskIterator>(GetRangeDataset(10),
+                                          /*repeat=*/false),
+      /*window_size=*/3);
+  ASSERT_TRUE(cache.AddReader(/*task_id=*/0, /*job_id=*/0));
+  ASSERT_TRUE(cache.AddReader(/*task_id=*/1, /*job_id=*/1));
+  for (int64_t i = 0; i < 3; ++i) {
+    EXPECT_THAT(ReadFromCache(cache, /*task_id=*/0),
+                testing::IsOkAndHolds(i));
+  }
+  // The window is full until the slow reader reads the oldest element.
+  StatusOr<int64_t> next;
+  std::unique_ptr<Thread> fast_reader =
+      absl::WrapUnique(Env::Default()->StartThread(
+          {}, "fast_reader", [&] { next = ReadFromCache(cache, 0); }));
+  EXPECT_THAT(ReadFromCache(cache, /*task_id=*/1), testing::IsOkAndHolds(0));
+  fast_reader.reset();
+  EXPECT_THAT(next, testing::IsOkAndHolds(3));
+}
+
+TEST(SlidingWindowCacheTest, CancelledReaderReleasesWindow) {
+  SlidingWindowCache cache(
+      absl::make_unique<TestTaskIterator>(GetRangeDataset(10),
+                                          /*repeat=*/false),
+      /*window_size=*/1);
+  ASSERT_TRUE(cache.AddReader(/*task_id=*/0, /*job_id=*/0));
+  ASSERT_TRUE(cache.AddReader(/*task_id=*/1, /*job_id=*/1));
+  cache.CancelReader(/*task_id=*/1);
+  for (int64_t i = 0; i < 10; ++i) {
+    EXPECT_THAT(ReadFromCache(cache, /*task_id=*/0),
+                testing::IsOkAndHolds(i));
+  }
+  EXPECT_THAT(ReadFromCache(cache, /*task_id=*/1),
+              testing::StatusIs(error::CANCELLED));
+}
+
+TEST(SlidingWindowCacheTest, LateReaderOfFiniteDataset) {
+  SlidingWindowCache cache(
+      absl::make_unique<FiniteTestTaskIterator>(GetRangeDataset(10)),
+      /*window_size=*/2);
+  ASSERT_TRUE(cache.AddReader(/*task_id=*/0, /*job_id=*/0));
+  EXPECT_THAT(ReadFromCache(cache, /*task_id=*/0), testing::IsOkAndHolds(0));
+  // Element 0 has been evicted, so a new reader would miss it.
+  EXPECT_FALSE(cache.AddReader(/*task_id=*/1, /*job_id=*/1));
+}
+
+TEST(SlidingWindowCacheTest, LateReaderOfInfiniteDataset) {
+  SlidingWindowCache cache(
+      absl::make_unique<TestTaskIterator>(GetRangeDataset(10),
+                                          /*repeat=*/true),
+      /*window_size=*/2);
+  ASSERT_TRUE(cache.AddReader(/*task_id=*/0, /*job_id=*/0));
+  EXPECT_THAT(ReadFromCache(cache, /*task_id=*/0), testing::IsOkAndHolds(0));
+  // The new reader starts at the oldest element in the window.
+  ASSERT_TRUE(cache.AddReader(/*task_id=*/1, /*job_id=*/1));
+  EXPECT_THAT(ReadFromCache(cache, /*task_id=*/1), testing::IsOkAndHolds(1));
+  EXPECT_THAT(ReadFromCache(cache, /*task_id=*/0), testing::IsOkAndHolds(1));
+}
+
+TEST(SlidingWindowCacheTest, Error) {
+  SlidingWindowCache cache(
+      absl::make_unique<TestErrorIterator>(errors::Aborted("Aborted")),
+      /*window_size=*/2);
+  ASSERT_TRUE(cache.AddReader(/*task_id=*/0, /*job_id=*/0));
+  ASSERT_TRUE(cache.AddReader(/*task_id=*/1, /*job_id=*/1));
+  EXPECT_THAT(ReadFromCache(cache, /*task_id=*/0),
+              testing::StatusIs(error::ABORTED));
+  EXPECT_THAT(ReadFromCache(cache, /*task_id=*/1),
+              testing::StatusIs(error::ABORTED));
+}
+
+TEST(SlidingWindowCacheTest, RoundRobin) {
+  const int64_t num_consumers = 2;
+  auto cache = std::make_shared<SlidingWindowCache>(
+      absl::make_unique<TestTaskIterator>(GetRangeDataset(10),
+                                          /*repeat=*/true),
+      /*window_size=*/4);
+  std::vector<std::unique_ptr<RoundRobinTaskRunner>> runners;
+  for (int64_t task_id = 0; task_id < 2; ++task_id) {
+    ASSERT_TRUE(cache->AddReader(task_id, /*job_id=*/task_id));
+    runners.push_back(absl::make_unique<RoundRobinTaskRunner>(
+        absl::make_unique<SlidingWindowCacheTaskIterator>(cache, task_id),
+        num_consumers, /*worker_address=*/"test_worker_address"));
+  }
+  for (auto& runner : runners) {
+    std::vector<std::vector<int64_t>> per_consumer_results(num_consumers);
+    std::vector<std::unique_ptr<Thread>> consumers;
+    for (int consumer = 0; consumer < num_consumers; ++consumer) {
+      consumers.push_back(absl::WrapUnique(Env::Default()->StartThread(
+          {}, absl::StrCat("consumer_", consumer), [&, consumer] {
+            TF_CHECK_OK(RunConsumer(consumer, /*start_index=*/0,
+                                    /*end_index=*/3, *runner,
+                                    per_consumer_results[consumer]));
+          })));
+    }
+    consumers.clear();
+    EXPECT_EQ(per_consumer_results[0], std::vector<int64_t>({0, 2, 4}));
+    EXPECT_EQ(per_consumer_results[1], std::vector<int64_t>({1, 3, 5}));
+  }
+}
+
 }  // namespace data
 }  // namespace tensorflow
@@ -49,6 +49,7 @@ class TestCluster {
     int64_t client_timeout_ms = 0;
     int64_t job_gc_check_interval_ms = 0;
     int64_t job_gc_timeout_ms = 0;
+    int64_t split_prefetch_window = 0;
   };
 
   // Creates a new test cluster with a dispatcher and `num_workers` workers.
@@ -32,6 +32,7 @@ limitations under the License.
 #include "tensorflow/core/data/service/credentials_factory.h"
 #include "tensorflow/core/data/service/data_transfer.h"
 #include "tensorflow/core/data/service/grpc_util.h"
+#include "tensorflow/core/data/service/shm_transfer.h"
 #include "tensorflow/core/data/service/worker.grpc.pb.h"
 #include "tensorflow/core/data/service/worker.pb.h"
 #include "tensorflow/core/data/service/worker_impl.h"
@@ -71,13 +72,22 @@ Status DataServiceWorkerClient::EnsureInitialized() {
   if (client_) {
     return Status::OK();
   }
-  TF_RETURN_IF_ERROR(DataTransferClient::Build(
-      GetDataTransferProtocol(), {protocol_, address_}, &client_));
-  return Status::OK();
+  const std::string transfer_protocol = GetDataTransferProtocol();
+  Status s = DataTransferClient::Build(transfer_protocol,
+                                       {protocol_, address_}, &client_);
+  if (!s.ok() && transfer_protocol == kShmTransferProtocol) {
+    // Workers serve gRPC requests at the same address.
+    VLOG(1) << "Failed to read from worker " << address_
+            << " through shared memory, reading through gRPC instead: " << s;
+    s = DataTransferClient::Build(kGrpcTransferProtocol,
+                                  {protocol_, address_}, &client_);
+  }
+  return s;
 }
 
 std::string DataServiceWorkerClient::GetDataTransferProtocol() const {
-  if (transfer_protocol_ == kGrpcTransferProtocol &&
+  if ((transfer_protocol_ == kGrpcTransferProtocol ||
+       transfer_protocol_ == kShmTransferProtocol) &&
       LocalWorkers::Get(address_) != nullptr) {
     return kLocalTransferProtocol;
   }
@@ -182,6 +192,34 @@ class GrpcTransferClientRegistrar {
 };
 static GrpcTransferClientRegistrar gprc_client_registrar;
 
+class ShmTransferClientRegistrar {
+ public:
+  ShmTransferClientRegistrar() {
+    DataTransferClient::Register(
+        kShmTransferProtocol, [](DataTransferClient::Config config,
+                                 std::unique_ptr<DataTransferClient>* out) {
+          // The worker only accepts shared memory clients which can reach it
+          // through gRPC, with a token issued through gRPC.
+          std::shared_ptr<grpc::ChannelCredentials> credentials;
+          TF_RETURN_IF_ERROR(CredentialsFactory::CreateClientCredentials(
+              config.protocol, &credentials));
+          std::unique_ptr<WorkerService::Stub> stub = WorkerService::NewStub(
+              grpc::CreateChannel(config.address, credentials));
+          grpc::ClientContext ctx;
+          GetShmTransferTokenRequest req;
+          GetShmTransferTokenResponse resp;
+          grpc::Status s = stub->GetShmTransferToken(&ctx, req, &resp);
+          if (!s.ok()) {
+            return grpc_util::WrapError(
+                "Failed to get shared memory transfer token", s);
+          }
+          return CreateShmDataTransferClient(config.address, resp.token(),
+                                             out);
+        });
+  }
+};
+static ShmTransferClientRegistrar shm_client_registrar;
+
 class LocalDataTransferClient : public DataTransferClient {
  public:
   explicit LocalDataTransferClient(absl::string_view worker_address)
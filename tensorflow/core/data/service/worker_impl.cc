@@ -282,13 +282,8 @@ Status DataServiceWorkerImpl::EnsureTaskInitialized(
   if (task.initialized) {
     return Status::OK();
   }
-  TF_ASSIGN_OR_RETURN(DatasetDef dataset_def, GetDatasetDef(task.task_def));
-  TF_ASSIGN_OR_RETURN(std::unique_ptr<standalone::Dataset> dataset,
-                      MakeDataset(dataset_def, task.task_def));
-  TF_ASSIGN_OR_RETURN(std::unique_ptr<standalone::Iterator> iterator,
-                      MakeDatasetIterator(*dataset, task.task_def));
-  auto task_iterator = absl::make_unique<StandaloneTaskIterator>(
-      std::move(dataset), std::move(iterator));
+  TF_ASSIGN_OR_RETURN(std::unique_ptr<TaskIterator> task_iterator,
+                      MakeTaskIterator(task.task_def));
   TF_RETURN_IF_ERROR(TaskRunner::Create(
       config_, task.task_def, std::move(task_iterator), task.task_runner));
 
@@ -350,7 +345,7 @@ DataServiceWorkerImpl::MakeDatasetIterator(standalone::Dataset& dataset,
     for (int i = 0; i < task_def.num_split_providers(); ++i) {
       split_providers.push_back(absl::make_unique<DataServiceSplitProvider>(
           config_.dispatcher_address(), config_.protocol(), task_def.job_id(),
-          i, config_.dispatcher_timeout_ms()));
+          i, config_.dispatcher_timeout_ms(), config_.split_prefetch_window()));
     }
     TF_RETURN_IF_ERROR(
         dataset.MakeIterator(std::move(split_providers), &iterator));
@@ -361,6 +356,51 @@ DataServiceWorkerImpl::MakeDatasetIterator(standalone::Dataset& dataset,
                                  task_def.processing_mode_def().DebugString());
 }
 
+StatusOr<std::unique_ptr<TaskIterator>>
+DataServiceWorkerImpl::MakeTaskIterator(const TaskDef& task_def) {
+  // Jobs only read the same elements if the dataset is not sharded.
+  const bool use_cross_job_cache =
+      config_.cross_job_cache_window_size() > 0 &&
+      IsNoShard(task_def.processing_mode_def());
+  if (use_cross_job_cache) {
+    mutex_lock l(cross_job_caches_mu_);
+    std::shared_ptr<SlidingWindowCache> cache =
+        cross_job_caches_[task_def.dataset_id()].lock();
+    if (cache && cache->AddReader(task_def.task_id(), task_def.job_id())) {
+      VLOG(1) << "Task " << task_def.task_id() << " of job "
+              << task_def.job_id() << " reads from the cross-job cache of "
+              << "dataset " << task_def.dataset_id();
+      return std::unique_ptr<TaskIterator>(
+          absl::make_unique<SlidingWindowCacheTaskIterator>(
+              std::move(cache), task_def.task_id()));
+    }
+  }
+
+  TF_ASSIGN_OR_RETURN(DatasetDef dataset_def, GetDatasetDef(task_def));
+  TF_ASSIGN_OR_RETURN(std::unique_ptr<standalone::Dataset> dataset,
+                      MakeDataset(dataset_def, task_def));
+  TF_ASSIGN_OR_RETURN(std::unique_ptr<standalone::Iterator> iterator,
+                      MakeDatasetIterator(*dataset, task_def));
+  std::unique_ptr<TaskIterator> task_iterator =
+      absl::make_unique<StandaloneTaskIterator>(std::move(dataset),
+                                                std::move(iterator));
+  if (!use_cross_job_cache) {
+    return task_iterator;
+  }
+  auto cache = std::make_shared<SlidingWindowCache>(
+      std::move(task_iterator), config_.cross_job_cache_window_size());
+  cache->AddReader(task_def.task_id(), task_def.job_id());
+  {
+    mutex_lock l(cross_job_caches_mu_);
+    // Replaces the cache which the task could not join, if any. Its readers
+    // keep it alive until they finish.
+    cross_job_caches_[task_def.dataset_id()] = cache;
+  }
+  return std::unique_ptr<TaskIterator>(
+      absl::make_unique<SlidingWindowCacheTaskIterator>(std::move(cache),
+                                                        task_def.task_id()));
+}
+
 void DataServiceWorkerImpl::StopTask(Task& task) TF_LOCKS_EXCLUDED(mu_) {
   {
     mutex_lock l(task.mu);
@@ -403,6 +443,28 @@ Status DataServiceWorkerImpl::GetWorkerTasks(
   return Status::OK();
 }
 
+void DataServiceWorkerImpl::SetShmTransferTokenIssuer(
+    std::function<std::string()> issuer) {
+  mutex_lock l(mu_);
+  shm_transfer_token_issuer_ = std::move(issuer);
+}
+
+Status DataServiceWorkerImpl::GetShmTransferToken(
+    const GetShmTransferTokenRequest* request,
+    GetShmTransferTokenResponse* response) {
+  std::function<std::string()> issuer;
+  {
+    mutex_lock l(mu_);
+    issuer = shm_transfer_token_issuer_;
+  }
+  if (!issuer) {
+    return errors::FailedPrecondition(
+        "The worker does not serve shared memory transfers.");
+  }
+  response->set_token(issuer());
+  return Status::OK();
+}
+
 void DataServiceWorkerImpl::TaskCompletionThread() TF_LOCKS_EXCLUDED(mu_) {
   while (true) {
     {
@@ -15,6 +15,7 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DATA_SERVICE_WORKER_IMPL_H_
 #define TENSORFLOW_CORE_DATA_SERVICE_WORKER_IMPL_H_
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <utility>
@@ -69,6 +70,10 @@ class DataServiceWorkerImpl {
   // method is not visible to gRPC clients.
   void DeleteLocalTask(const TaskInfo& task_info);
 
+  // Sets the function which issues the tokens returned by GetShmTransferToken.
+  // Called before the worker starts if it serves shared memory transfers.
+  void SetShmTransferTokenIssuer(std::function<std::string()> issuer);
+
   // See worker.proto for API documentation.
 
   /// Dispatcher-facing API.
@@ -80,6 +85,8 @@ class DataServiceWorkerImpl {
                     GetElementResponse* response);
   Status GetWorkerTasks(const GetWorkerTasksRequest* request,
                         GetWorkerTasksResponse* response);
+  Status GetShmTransferToken(const GetShmTransferTokenRequest* request,
+                             GetShmTransferTokenResponse* response);
 
  private:
   struct Task {
@@ -117,6 +124,10 @@ class DataServiceWorkerImpl {
   // Creates an iterator for `dataset`.
   StatusOr<std::unique_ptr<standalone::Iterator>> MakeDatasetIterator(
       standalone::Dataset& dataset, const TaskDef& task_def) const;
+  // Creates the iterator of a task. The iterator reads from the cross-job
+  // cache of the task's dataset if the worker config enables it.
+  StatusOr<std::unique_ptr<TaskIterator>> MakeTaskIterator(
+      const TaskDef& task_def) TF_LOCKS_EXCLUDED(cross_job_caches_mu_);
 
   const experimental::WorkerConfig config_;
   // The worker's own address.
@@ -136,6 +147,9 @@ class DataServiceWorkerImpl {
   // Tasks deleted by the local client. If the client tries to read from them
   // again, the worker will return a non-retriable FailedPrecondition error.
   absl::flat_hash_set<int64_t> deleted_tasks_ TF_GUARDED_BY(mu_);
+  // Issues shared memory transfer tokens, or null if the worker does not
+  // serve shared memory transfers.
+  std::function<std::string()> shm_transfer_token_issuer_ TF_GUARDED_BY(mu_);
   bool cancelled_ TF_GUARDED_BY(mu_) = false;
   // Whether the worker has registered with the dispatcher yet.
   bool registered_ TF_GUARDED_BY(mu_) = false;
@@ -148,6 +162,12 @@ class DataServiceWorkerImpl {
   int64_t outstanding_requests_ TF_GUARDED_BY(mu_) = 0;
   CancellationManager cancellation_manager_;
 
+  mutex cross_job_caches_mu_;
+  // Sliding-window caches shared by the tasks of different jobs, keyed by
+  // dataset id. The caches are owned by the iterators of their tasks.
+  absl::flat_hash_map<int64_t, std::weak_ptr<SlidingWindowCache>>
+      cross_job_caches_ TF_GUARDED_BY(cross_job_caches_mu_);
+
   TF_DISALLOW_COPY_AND_ASSIGN(DataServiceWorkerImpl);
 };
 
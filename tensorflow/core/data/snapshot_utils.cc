@@ -26,6 +26,7 @@ limitations under the License.
 #include "tensorflow/core/data/name_utils.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/lib/io/buffered_inputstream.h"
 #include "tensorflow/core/lib/io/random_inputstream.h"
@@ -44,6 +45,7 @@ limitations under the License.
 #include "tensorflow/core/platform/stringprintf.h"
 #include "tensorflow/core/profiler/lib/traceme.h"
 #include "tensorflow/core/protobuf/snapshot.pb.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 namespace data {
@@ -58,6 +60,19 @@ constexpr const char* const kCurrentCheckpointID = "current_checkpoint_id";
 constexpr const char* const kIndex = "index";
 constexpr const char* const kStartIndex = "start_index";
 
+// Returns the options of the parallel readers of snapshot files. Parallel
+// reading is disabled if `num_threads` is 0.
+Status GetParallelReaderOptions(ParallelReader::Options* options) {
+  TF_RETURN_IF_ERROR(ReadInt64FromEnvVar("TF_DATA_SNAPSHOT_READER_NUM_THREADS",
+                                         /*default_val=*/0,
+                                         &options->num_threads));
+  TF_RETURN_IF_ERROR(ReadBoolFromEnvVar("TF_DATA_SNAPSHOT_READER_DETERMINISTIC",
+                                        /*default_val=*/true,
+                                        &options->deterministic));
+  options->buffer_size = 4 * options->num_threads;
+  return Status::OK();
+}
+
 }  // namespace
 
 /* static */ constexpr const int64_t
@@ -359,11 +374,23 @@ Status Reader::Create(Env* env, const std::string& filename,
   return (*out_reader)->Initialize(env);
 }
 
+Status Reader::ReadRawElement(RawElement* element) {
+  element->records.clear();
+  element->tensors.clear();
+  return ReadTensors(&element->tensors);
+}
+
+Status Reader::DecodeElement(RawElement* element,
+                             std::vector<Tensor>* read_tensors) const {
+  *read_tensors = std::move(element->tensors);
+  return Status::OK();
+}
+
 Status Reader::SkipRecords(int64_t num_records) {
-  // TODO(frankchn): Optimize to not parse the entire Tensor and actually skip.
+  // Skipped elements are read but not decoded.
   for (int i = 0; i < num_records; ++i) {
-    std::vector<Tensor> unused_tensors;
-    TF_RETURN_IF_ERROR(ReadTensors(&unused_tensors));
+    RawElement unused_element;
+    TF_RETURN_IF_ERROR(ReadRawElement(&unused_element));
   }
   return Status::OK();
 }
@@ -440,10 +467,7 @@ class Reader::Dataset : public DatasetBase {
       // TODO(jsimsa): This only needs to happen when we are not restoring but
       // parallel_interleave op implementation caches IteratorContext (and thus
       // the is_restoring bit ends up being inaccurate).
-      TF_RETURN_IF_ERROR(Reader::Create(
-          ctx->env(), GetCurrentFilename(), dataset()->compression_,
-          dataset()->version_, dataset()->dtypes_, &reader_));
-      return AdvanceToStartIndex(ctx);
+      return OpenCurrentFile(ctx->env());
     }
 
    protected:
@@ -451,7 +475,8 @@ class Reader::Dataset : public DatasetBase {
                            std::vector<Tensor>* out_tensors,
                            bool* end_of_sequence) override {
       *end_of_sequence = false;
-      Status s = reader_->ReadTensors(out_tensors);
+      Status s = parallel_reader_ ? parallel_reader_->ReadTensors(out_tensors)
+                                  : reader_->ReadTensors(out_tensors);
       if (!errors::IsOutOfRange(s)) {
         start_index_++;
         return s;
@@ -480,10 +505,7 @@ class Reader::Dataset : public DatasetBase {
       TF_RETURN_IF_ERROR(
           reader->ReadScalar(full_name(kStartIndex), &start_index_));
       TF_RETURN_IF_ERROR(ctx->env()->FileExists(GetCurrentFilename()));
-      TF_RETURN_IF_ERROR(Reader::Create(
-          ctx->env(), GetCurrentFilename(), dataset()->compression_,
-          dataset()->version_, dataset()->dtypes_, &reader_));
-      return AdvanceToStartIndex(ctx);
+      return OpenCurrentFile(ctx->env());
     }
 
    private:
@@ -491,8 +513,7 @@ class Reader::Dataset : public DatasetBase {
       start_index_ = 0;
       current_checkpoint_id_++;
       TF_RETURN_IF_ERROR(env->FileExists(GetCurrentFilename()));
-      return Reader::Create(env, GetCurrentFilename(), dataset()->compression_,
-                            dataset()->version_, dataset()->dtypes_, &reader_);
+      return OpenCurrentFile(env);
     }
 
     std::string GetCurrentFilename() {
@@ -500,16 +521,28 @@ class Reader::Dataset : public DatasetBase {
                                    current_checkpoint_id_);
     }
 
-    // TODO(frankchn): Optimize this to not parse every single element.
-    Status AdvanceToStartIndex(IteratorContext* ctx) {
-      for (int64_t i = 0; i < start_index_; ++i) {
-        std::vector<Tensor> unused;
-        TF_RETURN_IF_ERROR(reader_->ReadTensors(&unused));
+    // Opens the current file and skips to `start_index_`. If parallel reading
+    // is enabled, the rest of the file is read by `parallel_reader_`.
+    //
+    // Elements are only checkpointed exactly if they are read in order, so
+    // parallel readers should be deterministic when checkpointing.
+    Status OpenCurrentFile(Env* env) {
+      parallel_reader_.reset();
+      TF_RETURN_IF_ERROR(Reader::Create(
+          env, GetCurrentFilename(), dataset()->compression_,
+          dataset()->version_, dataset()->dtypes_, &reader_));
+      TF_RETURN_IF_ERROR(reader_->SkipRecords(start_index_));
+      ParallelReader::Options options;
+      TF_RETURN_IF_ERROR(GetParallelReaderOptions(&options));
+      if (options.num_threads > 0) {
+        parallel_reader_ =
+            absl::make_unique<ParallelReader>(env, std::move(reader_), options);
       }
       return Status::OK();
     }
 
     std::unique_ptr<Reader> reader_;
+    std::unique_ptr<ParallelReader> parallel_reader_;
 
     // Stores the id current checkpoint file that we are in the process of
     // reading (e.g. if the file is currently 00000001.snapshot, then this will
@@ -724,11 +757,23 @@ Status TFRecordReader::Initialize(Env* env) {
 }
 
 Status TFRecordReader::ReadTensors(std::vector<Tensor>* read_tensors) {
-  read_tensors->reserve(dtypes_.size());
-  for (int i = 0; i < dtypes_.size(); ++i) {
-    tstring record;
+  RawElement element;
+  TF_RETURN_IF_ERROR(ReadRawElement(&element));
+  return DecodeElement(&element, read_tensors);
+}
+
+Status TFRecordReader::ReadRawElement(RawElement* element) {
+  element->records.resize(dtypes_.size());
+  for (tstring& record : element->records) {
     TF_RETURN_IF_ERROR(record_reader_->ReadRecord(&offset_, &record));
+  }
+  return Status::OK();
+}
 
+Status TFRecordReader::DecodeElement(RawElement* element,
+                                     std::vector<Tensor>* read_tensors) const {
+  read_tensors->reserve(element->records.size());
+  for (const tstring& record : element->records) {
     TensorProto proto;
     proto.ParseFromArray(record.data(), record.size());
 
@@ -792,24 +837,45 @@ Status CustomReader::Initialize(Env* env) {
   return Status::OK();
 }
 
+bool CustomReader::IsSnappyV1() const {
+  return version_ != 0 && compression_type_ == io::compression::kSnappy;
+}
+
 Status CustomReader::ReadTensors(std::vector<Tensor>* read_tensors) {
   profiler::TraceMe activity(
       [&]() { return absl::StrCat(kClassName, kSeparator, "ReadTensors"); },
       profiler::TraceMeLevel::kInfo);
-  if (version_ == 0 || compression_type_ != io::compression::kSnappy) {
+  if (!IsSnappyV1()) {
     return ReadTensorsV0(read_tensors);
   }
+  RawElement element;
+  TF_RETURN_IF_ERROR(ReadRawElement(&element));
+  return DecodeElement(&element, read_tensors);
+}
+
+Status CustomReader::ReadRawElement(RawElement* element) {
+  if (!IsSnappyV1()) {
+    return Reader::ReadRawElement(element);
+  }
   if (version_ != 1) {
     return errors::InvalidArgument("Version: ", version_, " is not supported.");
   }
-  if (compression_type_ != io::compression::kSnappy) {
-    return errors::InvalidArgument("Compression ", compression_type_,
-                                   " is not supported.");
-  }
+  // The metadata record followed by the compressed tensors.
+  element->records.resize(2);
+  TF_RETURN_IF_ERROR(ReadRecord(&element->records[0]));
+  return ReadRecord(&element->records[1]);
+}
 
+Status CustomReader::DecodeElement(RawElement* element,
+                                   std::vector<Tensor>* read_tensors) const {
+  if (!IsSnappyV1()) {
+    return Reader::DecodeElement(element, read_tensors);
+  }
+  profiler::TraceMe activity(
+      [&]() { return absl::StrCat(kClassName, kSeparator, "DecodeElement"); },
+      profiler::TraceMeLevel::kInfo);
   experimental::SnapshotTensorMetadata metadata;
-  tstring metadata_str;
-  TF_RETURN_IF_ERROR(ReadRecord(&metadata_str));
+  const tstring& metadata_str = element->records[0];
   if (!metadata.ParseFromArray(metadata_str.data(), metadata_str.size())) {
     return errors::DataLoss("Could not parse SnapshotTensorMetadata");
   }
@@ -819,8 +885,8 @@ Status CustomReader::ReadTensors(std::vector<Tensor>* read_tensors) {
   simple_tensors.reserve(num_simple_);
   std::vector<std::pair<std::unique_ptr<char[]>, size_t>> tensor_proto_strs;
   tensor_proto_strs.reserve(num_complex_);
-  TF_RETURN_IF_ERROR(
-      SnappyUncompress(&metadata, &simple_tensors, &tensor_proto_strs));
+  TF_RETURN_IF_ERROR(SnappyUncompress(&metadata, element->records[1],
+                                      &simple_tensors, &tensor_proto_strs));
 
   int simple_index = 0;
   int complex_index = 0;
@@ -869,11 +935,9 @@ Status CustomReader::ReadTensorsV0(std::vector<Tensor>* read_tensors) {
 
 Status CustomReader::SnappyUncompress(
     const experimental::SnapshotTensorMetadata* metadata,
-    std::vector<Tensor>* simple_tensors,
-    std::vector<std::pair<std::unique_ptr<char[]>, size_t>>*
-        tensor_proto_strs) {
-  tstring compressed;
-  TF_RETURN_IF_ERROR(ReadRecord(&compressed));
+    const tstring& compressed, std::vector<Tensor>* simple_tensors,
+    std::vector<std::pair<std::unique_ptr<char[]>, size_t>>* tensor_proto_strs)
+    const {
   size_t size;
   if (!port::Snappy_GetUncompressedLength(compressed.data(), compressed.size(),
                                           &size)) {
@@ -942,6 +1006,104 @@ Status CustomReader::ReadRecord(absl::Cord* record) {
 }
 #endif  // TF_CORD_SUPPORT
 
+ParallelReader::ParallelReader(Env* env, std::unique_ptr<Reader> reader,
+                               const Options& options)
+    : env_(env), reader_(std::move(reader)), options_(options) {
+  thread_pool_ = absl::make_unique<thread::ThreadPool>(
+      env_, ThreadOptions(), "tf_data_snapshot_decode",
+      std::max<int64_t>(options_.num_threads, 1),
+      /*low_latency_hint=*/false);
+  thread_ = absl::WrapUnique(env_->StartThread(
+      ThreadOptions(), "tf_data_snapshot_read", [this]() { ReadThread(); }));
+}
+
+ParallelReader::~ParallelReader() {
+  {
+    mutex_lock l(mu_);
+    cancelled_ = true;
+    cond_var_.notify_all();
+  }
+  // Joins the reader thread, then waits for the pending decodes.
+  thread_.reset();
+  thread_pool_.reset();
+}
+
+Status ParallelReader::ReadTensors(std::vector<Tensor>* read_tensors) {
+  const uint64 start_micros = env_->NowMicros();
+  mutex_lock l(mu_);
+  while (true) {
+    auto it = results_.find(next_index_);
+    if (it != results_.end()) {
+      Result result = std::move(it->second);
+      results_.erase(it);
+      ++next_index_;
+      cond_var_.notify_all();
+      metrics::RecordTFDataSnapshotReadTime("wait",
+                                            env_->NowMicros() - start_micros);
+      TF_RETURN_IF_ERROR(result.status);
+      *read_tensors = std::move(result.tensors);
+      return Status::OK();
+    }
+    if (read_done_ && next_index_ == num_read_) {
+      return read_status_;
+    }
+    cond_var_.wait(l);
+  }
+}
+
+void ParallelReader::ReadThread() {
+  while (true) {
+    {
+      mutex_lock l(mu_);
+      while (!cancelled_ && num_read_ - next_index_ >= options_.buffer_size) {
+        cond_var_.wait(l);
+      }
+      if (cancelled_) {
+        return;
+      }
+    }
+    Reader::RawElement element;
+    const uint64 start_micros = env_->NowMicros();
+    Status s;
+    {
+      profiler::TraceMe activity("ParallelReader::Read",
+                                 profiler::TraceMeLevel::kInfo);
+      s = reader_->ReadRawElement(&element);
+    }
+    metrics::RecordTFDataSnapshotReadTime("read",
+                                          env_->NowMicros() - start_micros);
+    mutex_lock l(mu_);
+    if (!s.ok()) {
+      read_status_ = s;
+      read_done_ = true;
+      cond_var_.notify_all();
+      return;
+    }
+    const int64_t index = num_read_++;
+    thread_pool_->Schedule(
+        [this, index, element = std::move(element)]() mutable {
+          Decode(index, &element);
+        });
+  }
+}
+
+void ParallelReader::Decode(int64_t index, Reader::RawElement* element) {
+  Result result;
+  const uint64 start_micros = env_->NowMicros();
+  {
+    profiler::TraceMe activity("ParallelReader::Decode",
+                               profiler::TraceMeLevel::kInfo);
+    result.status = reader_->DecodeElement(element, &result.tensors);
+  }
+  metrics::RecordTFDataSnapshotReadTime("decode",
+                                        env_->NowMicros() - start_micros);
+  mutex_lock l(mu_);
+  const int64_t key = options_.deterministic ? index : num_decoded_;
+  ++num_decoded_;
+  results_[key] = std::move(result);
+  cond_var_.notify_all();
+}
+
 Status WriteMetadataFile(Env* env, const string& dir,
                          const experimental::SnapshotMetadataRecord* metadata) {
   string metadata_filename = io::JoinPath(dir, kMetadataFilename);
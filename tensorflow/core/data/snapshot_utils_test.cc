@@ -15,6 +15,9 @@ limitations under the License.
 
 #include "tensorflow/core/data/snapshot_utils.h"
 
+#include <algorithm>
+#include <numeric>
+
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/io/compression.h"
@@ -91,6 +94,139 @@ TEST(SnapshotUtilTest, CombinationRoundTripTest) {
   SnapshotRoundTrip(io::compression::kSnappy, 2);
 }
 
+// Writes `num_elements` elements whose first component is their index.
+void WriteIndexedElements(const std::string& filename,
+                          const std::string& compression_type, int version,
+                          int num_elements, DataTypeVector* dtypes) {
+  *dtypes = {DT_INT64, DT_STRING, DT_FLOAT};
+  std::unique_ptr<Writer> writer;
+  TF_ASSERT_OK(Writer::Create(Env::Default(), filename, compression_type,
+                              version, *dtypes, &writer));
+  for (int64_t i = 0; i < num_elements; ++i) {
+    Tensor floats(DT_FLOAT, TensorShape({256}));
+    floats.flat<float>().setConstant(i);
+    TF_ASSERT_OK(writer->WriteTensors(
+        {Tensor(i), Tensor(tstring(std::string(i % 100, 'x'))), floats}));
+  }
+  TF_ASSERT_OK(writer->Close());
+}
+
+// Reads all elements with a parallel reader, after skipping `num_to_skip`,
+// and returns their indices.
+std::vector<int64_t> ReadIndices(const std::string& filename,
+                                 const std::string& compression_type,
+                                 int version, const DataTypeVector& dtypes,
+                                 int num_to_skip,
+                                 const ParallelReader::Options& options) {
+  std::unique_ptr<Reader> reader;
+  TF_CHECK_OK(Reader::Create(Env::Default(), filename, compression_type,
+                             version, dtypes, &reader));
+  TF_CHECK_OK(reader->SkipRecords(num_to_skip));
+  ParallelReader parallel_reader(Env::Default(), std::move(reader), options);
+  std::vector<int64_t> indices;
+  while (true) {
+    std::vector<Tensor> read_tensors;
+    Status s = parallel_reader.ReadTensors(&read_tensors);
+    if (errors::IsOutOfRange(s)) {
+      break;
+    }
+    TF_CHECK_OK(s);
+    CHECK_EQ(read_tensors.size(), dtypes.size());
+    const int64_t index = read_tensors[0].scalar<int64_t>()();
+    EXPECT_EQ(read_tensors[1].scalar<tstring>()(),
+              std::string(index % 100, 'x'));
+    EXPECT_EQ(read_tensors[2].flat<float>()(255), index);
+    indices.push_back(index);
+  }
+  // Reads past the end keep returning OutOfRange.
+  std::vector<Tensor> read_tensors;
+  EXPECT_TRUE(errors::IsOutOfRange(parallel_reader.ReadTensors(&read_tensors)));
+  return indices;
+}
+
+TEST(SnapshotUtilTest, ParallelReader) {
+  constexpr int kNumElements = 200;
+  std::vector<int64_t> expected(kNumElements - 10);
+  std::iota(expected.begin(), expected.end(), 10);
+  for (const auto& compression_type :
+       {io::compression::kNone, io::compression::kGzip,
+        io::compression::kSnappy}) {
+    for (int version : {1, 2}) {
+      std::string filename;
+      ASSERT_TRUE(Env::Default()->LocalTempFilename(&filename));
+      DataTypeVector dtypes;
+      WriteIndexedElements(filename, compression_type, version, kNumElements,
+                           &dtypes);
+
+      ParallelReader::Options options;
+      options.num_threads = 4;
+      options.buffer_size = 8;
+      EXPECT_EQ(ReadIndices(filename, compression_type, version, dtypes,
+                            /*num_to_skip=*/10, options),
+                expected);
+
+      options.deterministic = false;
+      std::vector<int64_t> indices =
+          ReadIndices(filename, compression_type, version, dtypes,
+                      /*num_to_skip=*/10, options);
+      std::sort(indices.begin(), indices.end());
+      EXPECT_EQ(indices, expected);
+
+      TF_ASSERT_OK(Env::Default()->DeleteFile(filename));
+    }
+  }
+}
+
+TEST(SnapshotUtilTest, ParallelReaderDestroyedEarly) {
+  std::string filename;
+  ASSERT_TRUE(Env::Default()->LocalTempFilename(&filename));
+  DataTypeVector dtypes;
+  WriteIndexedElements(filename, io::compression::kSnappy, /*version=*/1,
+                       /*num_elements=*/100, &dtypes);
+  std::unique_ptr<Reader> reader;
+  TF_ASSERT_OK(Reader::Create(Env::Default(), filename,
+                              io::compression::kSnappy, /*version=*/1, dtypes,
+                              &reader));
+  ParallelReader::Options options;
+  options.num_threads = 4;
+  auto parallel_reader = absl::make_unique<ParallelReader>(
+      Env::Default(), std::move(reader), options);
+  std::vector<Tensor> read_tensors;
+  TF_ASSERT_OK(parallel_reader->ReadTensors(&read_tensors));
+  EXPECT_EQ(read_tensors[0].scalar<int64_t>()(), 0);
+  parallel_reader.reset();
+  TF_ASSERT_OK(Env::Default()->DeleteFile(filename));
+}
+
+TEST(SnapshotUtilTest, ParallelReaderError) {
+  std::string filename;
+  ASSERT_TRUE(Env::Default()->LocalTempFilename(&filename));
+  DataTypeVector dtypes;
+  WriteIndexedElements(filename, io::compression::kNone, /*version=*/2,
+                       /*num_elements=*/10, &dtypes);
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_ASSERT_OK(Env::Default()->NewAppendableFile(filename, &file));
+    TF_ASSERT_OK(file->Append("this is not a TFRecord"));
+    TF_ASSERT_OK(file->Close());
+  }
+  std::unique_ptr<Reader> reader;
+  TF_ASSERT_OK(Reader::Create(Env::Default(), filename,
+                              io::compression::kNone, /*version=*/2, dtypes,
+                              &reader));
+  ParallelReader::Options options;
+  options.num_threads = 2;
+  ParallelReader parallel_reader(Env::Default(), std::move(reader), options);
+  for (int64_t i = 0; i < 10; ++i) {
+    std::vector<Tensor> read_tensors;
+    TF_ASSERT_OK(parallel_reader.ReadTensors(&read_tensors));
+    EXPECT_EQ(read_tensors[0].scalar<int64_t>()(), i);
+  }
+  std::vector<Tensor> read_tensors;
+  EXPECT_TRUE(errors::IsDataLoss(parallel_reader.ReadTensors(&read_tensors)));
+  TF_ASSERT_OK(Env::Default()->DeleteFile(filename));
+}
+
 void SnapshotReaderBenchmarkLoop(::testing::benchmark::State& state,
                                  std::string compression_type, int version) {
   tensorflow::DataTypeVector dtypes;
@@ -147,6 +283,55 @@ BENCHMARK(SnapshotCustomReaderSnappyBenchmark);
 BENCHMARK(SnapshotTFRecordReaderNoneBenchmark);
 BENCHMARK(SnapshotTFRecordReaderGzipBenchmark);
 
+// Reads snappy compressed elements of 10 1MB tensors with a parallel reader
+// using state.range(0) threads.
+void SnapshotParallelReaderSnappyBenchmark(
+    ::testing::benchmark::State& state) {
+  constexpr int kNumElements = 64;
+  DataTypeVector dtypes;
+  std::vector<Tensor> tensors;
+  for (int i = 0; i < 10; ++i) {
+    Tensor t(DT_FLOAT, TensorShape({256 << 10}));
+    t.flat<float>().setRandom();
+    dtypes.push_back(t.dtype());
+    tensors.push_back(t);
+  }
+  std::string filename;
+  ASSERT_TRUE(Env::Default()->LocalTempFilename(&filename));
+  std::unique_ptr<Writer> writer;
+  TF_ASSERT_OK(Writer::Create(Env::Default(), filename,
+                              io::compression::kSnappy, /*version=*/1, dtypes,
+                              &writer));
+  for (int i = 0; i < kNumElements; ++i) {
+    TF_ASSERT_OK(writer->WriteTensors(tensors));
+  }
+  TF_ASSERT_OK(writer->Close());
+
+  ParallelReader::Options options;
+  options.num_threads = state.range(0);
+  options.buffer_size = 4 * options.num_threads;
+  for (auto s : state) {
+    std::unique_ptr<Reader> reader;
+    TF_ASSERT_OK(Reader::Create(Env::Default(), filename,
+                                io::compression::kSnappy, /*version=*/1,
+                                dtypes, &reader));
+    ParallelReader parallel_reader(Env::Default(), std::move(reader), options);
+    for (int i = 0; i < kNumElements; ++i) {
+      std::vector<Tensor> read_tensors;
+      TF_ASSERT_OK(parallel_reader.ReadTensors(&read_tensors));
+    }
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          kNumElements * 10 * (1 << 20));
+  TF_ASSERT_OK(Env::Default()->DeleteFile(filename));
+}
+
+BENCHMARK(SnapshotParallelReaderSnappyBenchmark)
+    ->UseRealTime()
+    ->Arg(1)
+    ->Arg(4)
+    ->Arg(16);
+
 void SnapshotWriterBenchmarkLoop(::testing::benchmark::State& state,
                                  std::string compression_type, int version) {
   tensorflow::DataTypeVector dtypes;
@@ -86,6 +86,13 @@ struct AllocatorStats {
 
   int64_t largest_free_block_bytes;  // Largest free block's size in heap.
 
+  // Stats for allocators that keep freed memory in caches for reuse. Cached
+  // bytes are not counted in `bytes_in_use`.
+  int64_t bytes_cached;      // Number of freed bytes held in caches.
+  int64_t num_cache_hits;    // Number of allocations served from caches.
+  int64_t num_cache_misses;  // Number of cacheable allocations not served
+                             // from caches.
+
   AllocatorStats()
       : num_allocs(0),
         bytes_in_use(0),
@@ -93,7 +100,10 @@ struct AllocatorStats {
         largest_alloc_size(0),
         bytes_reserved(0),
         peak_bytes_reserved(0),
-        largest_free_block_bytes(0) {}
+        largest_free_block_bytes(0),
+        bytes_cached(0),
+        num_cache_hits(0),
+        num_cache_misses(0) {}
 
   std::string DebugString() const;
 };
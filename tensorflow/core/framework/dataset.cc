@@ -414,6 +414,13 @@ Status IteratorBase::InitializeBase(IteratorContext* ctx,
   return Status::OK();
 }
 
+Status IteratorBase::GetNextIntoSlice(IteratorContext* ctx, int64_t index,
+                                      std::vector<Tensor>* batch,
+                                      bool* end_of_sequence) {
+  return errors::Unimplemented("GetNextIntoSlice is not supported by this "
+                               "iterator.");
+}
+
 int64_t GetAllocatedBytes(const std::vector<Tensor>& element) {
   int64_t allocated_bytes = 0;
   DatasetBase* dataset;
@@ -945,6 +952,51 @@ Status DatasetBaseIterator::Skip(IteratorContext* ctx, int num_to_skip,
   return s;
 }
 
+Status DatasetBaseIterator::GetNextIntoSlice(IteratorContext* ctx,
+                                             int64_t index,
+                                             std::vector<Tensor>* batch,
+                                             bool* end_of_sequence) {
+  profiler::TraceMe activity([&] { return BuildTraceMeName(); },
+                             profiler::TraceMeLevel::kInfo);
+  DVLOG(3) << prefix() << " GetNextIntoSlice enter";
+  if (collect_resource_usage(ctx)) {
+    int64_t now_nanos = EnvTime::NowNanos();
+    auto output = node_->output();
+    if (output) {
+      output->record_stop(now_nanos);
+    }
+    node_->record_start(now_nanos);
+  }
+  Status s = GetNextIntoSliceInternal(ctx, index, batch, end_of_sequence);
+  if (TF_PREDICT_TRUE(s.ok()) && TF_PREDICT_TRUE(!*end_of_sequence) &&
+      collect_resource_usage(ctx)) {
+    std::vector<Tensor> slices;
+    slices.reserve(batch->size());
+    for (const Tensor& batch_component : *batch) {
+      slices.push_back(batch_component.SubSlice(index));
+    }
+    RecordElement(ctx, &slices);
+  }
+  if (collect_resource_usage(ctx)) {
+    int64_t now_nanos = EnvTime::NowNanos();
+    node_->record_stop(now_nanos);
+    auto output = node_->output();
+    if (output) {
+      output->record_start(now_nanos);
+    }
+  }
+  if (TF_PREDICT_FALSE(errors::IsOutOfRange(s))) {
+    s = errors::Internal("Iterator \"", params_.prefix,
+                         "\" returned `OutOfRange`. This indicates an "
+                         "implementation error as `OutOfRange` errors are not "
+                         "expected to be returned here. Original message: ",
+                         s.error_message());
+    LOG(ERROR) << s;
+  }
+  DVLOG(3) << prefix() << " GetNextIntoSlice exit";
+  return s;
+}
+
 Status DatasetBaseIterator::SkipInternal(IteratorContext* ctx, int num_to_skip,
                                          bool* end_of_sequence,
                                          int* num_skipped) {
@@ -968,6 +1020,13 @@ Status DatasetBaseIterator::SkipInternal(IteratorContext* ctx, int num_to_skip,
   return Status::OK();
 }
 
+Status DatasetBaseIterator::GetNextIntoSliceInternal(
+    IteratorContext* ctx, int64_t index, std::vector<Tensor>* batch,
+    bool* end_of_sequence) {
+  return errors::Unimplemented("GetNextIntoSlice is not supported by ",
+                               prefix(), ".");
+}
+
 void DatasetOpKernel::Compute(OpKernelContext* ctx) {
   DatasetBase* dataset = nullptr;
   MakeDataset(ctx, &dataset);
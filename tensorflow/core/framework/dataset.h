@@ -30,6 +30,7 @@ limitations under the License.
 #include "tensorflow/core/framework/function.h"
 #include "tensorflow/core/framework/function_handle_cache.h"
 #include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/memory_accountant.h"
 #include "tensorflow/core/framework/model.h"
 #include "tensorflow/core/framework/node_def.pb.h"
 #include "tensorflow/core/framework/op_kernel.h"
@@ -393,12 +394,15 @@ class IteratorContext {
   struct Params {
     explicit Params(IteratorContext* ctx)
         : allocator_getter(ctx->allocator_getter()),
+          blocking_pool(ctx->blocking_pool()),
           cancellation_manager(ctx->cancellation_manager()),
           collective_executor(ctx->collective_executor()),
+          compute_pool(ctx->compute_pool()),
           env(ctx->env()),
           flr(ctx->flr()),
           function_handle_cache(ctx->function_handle_cache()),
           is_restoring(ctx->is_restoring()),
+          memory_pipeline(ctx->memory_pipeline()),
           resource_mgr(ctx->resource_mgr()),
           model(ctx->model()),
           runner(*(ctx->runner())),
@@ -441,12 +445,20 @@ class IteratorContext {
     // The Allocator to be used to allocate the output of an iterator.
     std::function<Allocator*(AllocatorAttributes)> allocator_getter = nullptr;
 
+    // If non-null, a shared thread pool to schedule closures which block on
+    // I/O into. Not owned.
+    thread::ThreadPoolInterface* blocking_pool = nullptr;
+
     // The CancellationManager to be used to cancel execution of ops.
     CancellationManager* cancellation_manager;
 
     // Collective support.
     CollectiveExecutor* collective_executor = nullptr;
 
+    // If non-null, a shared thread pool to schedule short closures which do
+    // not block into. Not owned.
+    thread::ThreadPoolInterface* compute_pool = nullptr;
+
     // Interface to operating system functionality.
     Env* env = nullptr;
 
@@ -459,6 +471,10 @@ class IteratorContext {
     // Marks whether the iterator is restored from a checkpoint.
     bool is_restoring = false;
 
+    // If non-null, identifies the input pipeline against whose share of the
+    // tf.data memory budget buffered elements are accounted.
+    std::shared_ptr<MemoryAccountant::Pipeline> memory_pipeline = nullptr;
+
     // A resource manager for storing dataset-related state, e.g. random
     // seeds or cached tensors. Not owned.
     ResourceMgr* resource_mgr = nullptr;
@@ -508,6 +524,8 @@ class IteratorContext {
     return params_.allocator_getter;
   }
 
+  thread::ThreadPoolInterface* blocking_pool() { return params_.blocking_pool; }
+
   CancellationManager* cancellation_manager() {
     return params_.cancellation_manager;
   }
@@ -516,6 +534,8 @@ class IteratorContext {
     return params_.collective_executor;
   }
 
+  thread::ThreadPoolInterface* compute_pool() { return params_.compute_pool; }
+
   Env* env() const { return params_.env; }
 
   FunctionLibraryRuntime* flr() { return params_.flr; }
@@ -526,6 +546,10 @@ class IteratorContext {
 
   bool is_restoring() { return params_.is_restoring; }
 
+  const std::shared_ptr<MemoryAccountant::Pipeline>& memory_pipeline() {
+    return params_.memory_pipeline;
+  }
+
   ResourceMgr* resource_mgr() { return params_.resource_mgr; }
 
   const std::shared_ptr<model::Model>& model() { return params_.model; }
@@ -577,6 +601,26 @@ class IteratorContext {
     }
   }
 
+  // Schedules a short closure which does not block, using the compute pool if
+  // there is one and the runner otherwise.
+  void ScheduleCompute(std::function<void()> fn) {
+    if (params_.compute_pool) {
+      params_.compute_pool->Schedule(std::move(fn));
+    } else {
+      params_.runner(std::move(fn));
+    }
+  }
+
+  // Schedules a closure which may block on I/O, using the blocking pool if
+  // there is one and the runner otherwise.
+  void ScheduleBlocking(std::function<void()> fn) {
+    if (params_.blocking_pool) {
+      params_.blocking_pool->Schedule(std::move(fn));
+    } else {
+      params_.runner(std::move(fn));
+    }
+  }
+
  private:
   Params params_;
 };
@@ -727,6 +771,22 @@ class IteratorBase {
   virtual Status Skip(IteratorContext* ctx, int num_to_skip,
                       bool* end_of_sequence, int* num_skipped) = 0;
 
+  // Writes the next output of this iterator into the `index`-th slice (in the
+  // 0th dimension) of the respective tensor in `batch`, which contains one
+  // preallocated tensor per tuple component.
+  //
+  // Consumers that assemble batches use this method so that the batch is the
+  // only copy of the element, when iterators produce an element by copying it
+  // from a larger tensor and can copy straight into the batch instead. It may
+  // only be called if the dataset's `SupportsGetNextIntoSlice()` returns true;
+  // the default implementation returns an `Unimplemented` error.
+  //
+  // The shape of each component must match the shape of a slice of `batch`.
+  // Nothing is written to `batch` if `*end_of_sequence` is set to `true`.
+  virtual Status GetNextIntoSlice(IteratorContext* ctx, int64_t index,
+                                  std::vector<Tensor>* batch,
+                                  bool* end_of_sequence);
+
   // Returns a vector of DataType values, representing the respective
   // element types of each tuple component in the outputs of this
   // iterator.
@@ -974,6 +1034,12 @@ class DatasetBase : public core::RefCounted {
   // Returns the cardinality of this dataset.
   virtual int64_t Cardinality() const { return kUnknownCardinality; }
 
+  // Returns whether the iterators of this dataset implement
+  // `IteratorBase::GetNextIntoSlice()`, writing their elements into a batch
+  // without materializing them first. Consumers only preallocate batches when
+  // this returns true.
+  virtual bool SupportsGetNextIntoSlice() const { return false; }
+
   // A human-readable debug string for this dataset.
   virtual string DebugString() const = 0;
 
@@ -1113,6 +1179,10 @@ class DatasetBaseIterator : public IteratorBase {
   Status Skip(IteratorContext* ctx, int num_to_skip, bool* end_of_sequence,
               int* num_skipped) final;
 
+  Status GetNextIntoSlice(IteratorContext* ctx, int64_t index,
+                          std::vector<Tensor>* batch,
+                          bool* end_of_sequence) final;
+
   Status Save(SerializationContext* ctx, IteratorStateWriter* writer) final {
     VLOG(2) << "Attempting to save checkpoints on iterator (prefix: "
             << prefix() << ") from " << dataset()->DebugString();
@@ -1139,6 +1209,13 @@ class DatasetBaseIterator : public IteratorBase {
   virtual Status SkipInternal(IteratorContext* ctx, int num_to_skip,
                               bool* end_of_sequence, int* num_skipped);
 
+  // Internal implementation of GetNextIntoSlice that is wrapped in tracing
+  // logic. Iterators of datasets whose `SupportsGetNextIntoSlice()` returns
+  // true must override it.
+  virtual Status GetNextIntoSliceInternal(IteratorContext* ctx, int64_t index,
+                                          std::vector<Tensor>* batch,
+                                          bool* end_of_sequence);
+
   string full_name(const string& name) const {
     return FullName(params_.prefix, name);
   }
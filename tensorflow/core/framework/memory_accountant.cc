@@ -0,0 +1,229 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/framework/memory_accountant.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include "tensorflow/core/framework/metrics.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mem.h"
+#include "tensorflow/core/platform/strcat.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+constexpr char kMemoryBudgetEnvVar[] = "TF_DATA_MEMORY_BUDGET_BYTES";
+
+// Default share of the host's total RAM that can be used by tf.data buffers.
+constexpr double kRamBudgetShare = 0.5;
+
+// Returns the default budget. The budget is based on the total rather than the
+// free RAM, so that it doesn't depend on what else the process had allocated
+// when the accountant was first used.
+int64_t DefaultBudgetBytes() {
+  const int64_t total_ram = port::GetMemoryInfo().total;
+  if (total_ram == std::numeric_limits<int64_t>::max()) {
+    return total_ram;
+  }
+  return static_cast<int64_t>(kRamBudgetShare * total_ram);
+}
+
+}  // namespace
+
+MemoryAccountant::Pipeline::Pipeline(MemoryAccountant* accountant,
+                                     int64_t index)
+    : accountant_(accountant),
+      index_(index),
+      id_(strings::StrCat(index)) {}
+
+MemoryAccountant::Pipeline::~Pipeline() {
+  mutex_lock l(accountant_->mu_);
+  accountant_->Update(this, -reserved_bytes_);
+  accountant_->num_pipelines_--;
+  accountant_->free_pipeline_indices_.insert(index_);
+  // The remaining pipelines have a larger share of the budget now.
+  accountant_->cond_var_.notify_all();
+}
+
+int64_t MemoryAccountant::Pipeline::reserved_bytes() const {
+  tf_shared_lock l(accountant_->mu_);
+  return reserved_bytes_;
+}
+
+MemoryAccountant::MemoryAccountant(int64_t budget_bytes)
+    : budget_bytes_(budget_bytes) {}
+
+// static
+MemoryAccountant* MemoryAccountant::Global() {
+  static MemoryAccountant* accountant = []() {
+    int64_t budget_bytes;
+    Status s = ReadInt64FromEnvVar(kMemoryBudgetEnvVar, DefaultBudgetBytes(),
+                                   &budget_bytes);
+    if (!s.ok()) {
+      LOG(WARNING) << "Failed to read the tf.data memory budget: " << s;
+      budget_bytes = DefaultBudgetBytes();
+    }
+    metrics::RecordTFDataMemoryBudget(budget_bytes);
+    return new MemoryAccountant(budget_bytes);
+  }();
+  return accountant;
+}
+
+std::shared_ptr<MemoryAccountant::Pipeline>
+MemoryAccountant::RegisterPipeline() {
+  mutex_lock l(mu_);
+  num_pipelines_++;
+  int64_t index;
+  if (free_pipeline_indices_.empty()) {
+    index = next_pipeline_index_++;
+  } else {
+    index = *free_pipeline_indices_.begin();
+    free_pipeline_indices_.erase(free_pipeline_indices_.begin());
+  }
+  return std::shared_ptr<Pipeline>(new Pipeline(this, index));
+}
+
+int64_t MemoryAccountant::reserved_bytes() const {
+  tf_shared_lock l(mu_);
+  return reserved_bytes_;
+}
+
+int64_t MemoryAccountant::num_pipelines() const {
+  tf_shared_lock l(mu_);
+  return num_pipelines_;
+}
+
+bool MemoryAccountant::CanReserve(const Pipeline& pipeline,
+                                  int64_t buffer_bytes, int64_t bytes) const {
+  if (buffer_bytes == 0) {
+    return true;
+  }
+  const int64_t fair_share =
+      budget_bytes_ / std::max<int64_t>(num_pipelines_, 1);
+  return pipeline.reserved_bytes_ + bytes <= fair_share ||
+         reserved_bytes_ + bytes <= budget_bytes_;
+}
+
+void MemoryAccountant::Update(Pipeline* pipeline, int64_t delta) {
+  pipeline->reserved_bytes_ += delta;
+  reserved_bytes_ += delta;
+  metrics::RecordTFDataPipelineMemory(pipeline->id_,
+                                      pipeline->reserved_bytes_);
+}
+
+MemoryReservation::MemoryReservation(
+    std::shared_ptr<MemoryAccountant::Pipeline> pipeline)
+    : pipeline_(std::move(pipeline)) {}
+
+MemoryReservation::~MemoryReservation() {
+  if (pipeline_) {
+    Release(reserved_bytes());
+  }
+}
+
+Status MemoryReservation::Reserve(int64_t bytes,
+                                  CancellationManager* cancellation_manager) {
+  if (!pipeline_) {
+    return Status::OK();
+  }
+  MemoryAccountant* accountant = pipeline_->accountant_;
+  {
+    mutex_lock l(accountant->mu_);
+    if (accountant->CanReserve(*pipeline_, reserved_bytes_, bytes)) {
+      reserved_bytes_ += bytes;
+      accountant->Update(pipeline_.get(), bytes);
+      return Status::OK();
+    }
+  }
+  metrics::RecordTFDataMemoryBackpressure();
+  CancellationToken token = cancellation_manager->get_cancellation_token();
+  bool registered = cancellation_manager->RegisterCallback(token, [=]() {
+    mutex_lock l(accountant->mu_);
+    accountant->cond_var_.notify_all();
+  });
+  Status status;
+  {
+    mutex_lock l(accountant->mu_);
+    while (registered &&
+           !accountant->CanReserve(*pipeline_, reserved_bytes_, bytes) &&
+           !cancellation_manager->IsCancelled()) {
+      accountant->cond_var_.wait(l);
+    }
+    if (!registered || cancellation_manager->IsCancelled()) {
+      status = errors::Cancelled("Iterator was cancelled");
+    } else {
+      reserved_bytes_ += bytes;
+      accountant->Update(pipeline_.get(), bytes);
+    }
+  }
+  // The callback acquires the accountant's mutex, so it must not be held while
+  // deregistering the callback.
+  if (registered) {
+    cancellation_manager->DeregisterCallback(token);
+  }
+  return status;
+}
+
+bool MemoryReservation::TryReserve(int64_t bytes) {
+  if (!pipeline_) {
+    return true;
+  }
+  MemoryAccountant* accountant = pipeline_->accountant_;
+  mutex_lock l(accountant->mu_);
+  if (!accountant->CanReserve(*pipeline_, reserved_bytes_, bytes)) {
+    return false;
+  }
+  reserved_bytes_ += bytes;
+  accountant->Update(pipeline_.get(), bytes);
+  return true;
+}
+
+void MemoryReservation::ForceReserve(int64_t bytes) {
+  if (!pipeline_) {
+    return;
+  }
+  MemoryAccountant* accountant = pipeline_->accountant_;
+  mutex_lock l(accountant->mu_);
+  reserved_bytes_ += bytes;
+  accountant->Update(pipeline_.get(), bytes);
+}
+
+void MemoryReservation::Release(int64_t bytes) {
+  if (!pipeline_ || bytes == 0) {
+    return;
+  }
+  MemoryAccountant* accountant = pipeline_->accountant_;
+  mutex_lock l(accountant->mu_);
+  DCHECK_LE(bytes, reserved_bytes_);
+  reserved_bytes_ -= bytes;
+  accountant->Update(pipeline_.get(), -bytes);
+  accountant->cond_var_.notify_all();
+}
+
+int64_t MemoryReservation::reserved_bytes() const {
+  if (!pipeline_) {
+    return 0;
+  }
+  tf_shared_lock l(pipeline_->accountant_->mu_);
+  return reserved_bytes_;
+}
+
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,156 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_FRAMEWORK_MEMORY_ACCOUNTANT_H_
+#define TENSORFLOW_CORE_FRAMEWORK_MEMORY_ACCOUNTANT_H_
+
+#include <memory>
+#include <set>
+#include <string>
+
+#include "tensorflow/core/framework/cancellation.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data {
+
+// Accounts for the memory held by the buffers of all tf.data input pipelines
+// in the process against a common budget.
+//
+// Each input pipeline registers with the accountant, and each of its buffering
+// iterators reserves the bytes of an element through a `MemoryReservation`
+// before buffering it, releasing them when the element leaves the buffer.
+//
+// A reservation is granted if the pipeline stays within its fair share of the
+// budget (the budget divided by the number of pipelines), or if all pipelines
+// together stay within the budget. Otherwise, the reservation waits until
+// other buffers release memory, which applies backpressure to the buffer
+// rather than failing it. A buffer that holds no reserved bytes is always
+// granted a reservation, so that every buffer can hold at least one element
+// and the pipeline keeps making progress.
+class MemoryAccountant {
+ public:
+  // The bytes reserved by the buffers of one input pipeline.
+  class Pipeline {
+   public:
+    ~Pipeline();
+
+    // An identifier of the pipeline, used to export its usage. Identifiers are
+    // unique among the registered pipelines, and are reused once a pipeline is
+    // deregistered, so that the number of exported values is bounded by the
+    // number of pipelines which are alive at the same time.
+    const std::string& id() const { return id_; }
+
+    // Returns the number of bytes reserved by the buffers of the pipeline.
+    int64_t reserved_bytes() const;
+
+   private:
+    friend class MemoryAccountant;
+    friend class MemoryReservation;
+
+    Pipeline(MemoryAccountant* accountant, int64_t index);
+
+    MemoryAccountant* const accountant_;
+    const int64_t index_;
+    const std::string id_;
+    // Guarded by `accountant_->mu_`.
+    int64_t reserved_bytes_ = 0;
+  };
+
+  explicit MemoryAccountant(int64_t budget_bytes);
+
+  // Returns the accountant shared by all input pipelines of the process. Its
+  // budget is read from the `TF_DATA_MEMORY_BUDGET_BYTES` environment
+  // variable, and defaults to half of the total RAM of the host.
+  static MemoryAccountant* Global();
+
+  // Registers a new input pipeline. The pipeline is deregistered once the
+  // returned pointer and all reservations made for the pipeline are destroyed.
+  std::shared_ptr<Pipeline> RegisterPipeline();
+
+  int64_t budget_bytes() const { return budget_bytes_; }
+
+  // Returns the number of bytes reserved by all pipelines.
+  int64_t reserved_bytes() const;
+
+  // Returns the number of registered pipelines.
+  int64_t num_pipelines() const;
+
+ private:
+  friend class MemoryReservation;
+
+  // Returns whether `bytes` can be reserved by a buffer of `pipeline` which
+  // currently holds `buffer_bytes`.
+  bool CanReserve(const Pipeline& pipeline, int64_t buffer_bytes,
+                  int64_t bytes) const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Adds `delta` to the bytes reserved by `pipeline`.
+  void Update(Pipeline* pipeline, int64_t delta)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const int64_t budget_bytes_;
+  mutable mutex mu_;
+  condition_variable cond_var_;
+  int64_t reserved_bytes_ TF_GUARDED_BY(mu_) = 0;
+  int64_t num_pipelines_ TF_GUARDED_BY(mu_) = 0;
+  int64_t next_pipeline_index_ TF_GUARDED_BY(mu_) = 0;
+  // Indices of deregistered pipelines, which are reused before new indices.
+  std::set<int64_t> free_pipeline_indices_ TF_GUARDED_BY(mu_);
+};
+
+// The bytes reserved by one buffering iterator of an input pipeline. All bytes
+// that are still reserved are released on destruction.
+//
+// A reservation with a null pipeline does not account for memory, and grants
+// all requests immediately.
+class MemoryReservation {
+ public:
+  explicit MemoryReservation(
+      std::shared_ptr<MemoryAccountant::Pipeline> pipeline);
+  ~MemoryReservation();
+
+  // Waits until `bytes` can be reserved, and reserves them. Returns a
+  // `Cancelled` error if `cancellation_manager` is cancelled first.
+  //
+  // `Reserve(0, ...)` waits until the reservation is allowed to grow, which
+  // lets producers that cannot block once an element exists apply
+  // backpressure before producing it.
+  Status Reserve(int64_t bytes, CancellationManager* cancellation_manager);
+
+  // Reserves `bytes` and returns true if that is possible without waiting.
+  bool TryReserve(int64_t bytes);
+
+  // Reserves `bytes` even if that exceeds the budget, e.g. for elements which
+  // are already buffered.
+  void ForceReserve(int64_t bytes);
+
+  // Releases `bytes` which were previously reserved.
+  void Release(int64_t bytes);
+
+  // Returns the number of bytes held by this reservation.
+  int64_t reserved_bytes() const;
+
+ private:
+  const std::shared_ptr<MemoryAccountant::Pipeline> pipeline_;
+  // Guarded by `pipeline_->accountant_->mu_`.
+  int64_t reserved_bytes_ = 0;
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_FRAMEWORK_MEMORY_ACCOUNTANT_H_
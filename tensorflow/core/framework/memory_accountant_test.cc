@@ -0,0 +1,163 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/framework/memory_accountant.h"
+
+#include <memory>
+#include <string>
+
+#include "tensorflow/core/framework/cancellation.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/notification.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+TEST(MemoryAccountantTest, RegisterPipeline) {
+  MemoryAccountant accountant(/*budget_bytes=*/100);
+  EXPECT_EQ(accountant.num_pipelines(), 0);
+  {
+    auto first = accountant.RegisterPipeline();
+    auto second = accountant.RegisterPipeline();
+    EXPECT_NE(first->id(), second->id());
+    EXPECT_EQ(accountant.num_pipelines(), 2);
+  }
+  EXPECT_EQ(accountant.num_pipelines(), 0);
+}
+
+TEST(MemoryAccountantTest, ReusePipelineIds) {
+  MemoryAccountant accountant(/*budget_bytes=*/100);
+  auto first = accountant.RegisterPipeline();
+  std::string second_id;
+  {
+    auto second = accountant.RegisterPipeline();
+    second_id = second->id();
+  }
+  for (int i = 0; i < 10; ++i) {
+    auto pipeline = accountant.RegisterPipeline();
+    EXPECT_EQ(pipeline->id(), second_id);
+  }
+  EXPECT_NE(accountant.RegisterPipeline()->id(), first->id());
+}
+
+TEST(MemoryAccountantTest, ReleaseOnDestruction) {
+  MemoryAccountant accountant(/*budget_bytes=*/100);
+  auto pipeline = accountant.RegisterPipeline();
+  {
+    MemoryReservation reservation(pipeline);
+    EXPECT_TRUE(reservation.TryReserve(30));
+    EXPECT_TRUE(reservation.TryReserve(20));
+    EXPECT_EQ(reservation.reserved_bytes(), 50);
+    EXPECT_EQ(pipeline->reserved_bytes(), 50);
+    EXPECT_EQ(accountant.reserved_bytes(), 50);
+    reservation.Release(30);
+    EXPECT_EQ(accountant.reserved_bytes(), 20);
+  }
+  EXPECT_EQ(pipeline->reserved_bytes(), 0);
+  EXPECT_EQ(accountant.reserved_bytes(), 0);
+}
+
+TEST(MemoryAccountantTest, ProgressGuarantee) {
+  MemoryAccountant accountant(/*budget_bytes=*/100);
+  auto pipeline = accountant.RegisterPipeline();
+  MemoryReservation first(pipeline);
+  MemoryReservation second(pipeline);
+  // An empty buffer can always hold one element, even over the budget.
+  EXPECT_TRUE(first.TryReserve(150));
+  EXPECT_FALSE(first.TryReserve(1));
+  EXPECT_TRUE(second.TryReserve(10));
+  EXPECT_FALSE(second.TryReserve(1));
+}
+
+TEST(MemoryAccountantTest, FairShare) {
+  MemoryAccountant accountant(/*budget_bytes=*/100);
+  auto greedy = accountant.RegisterPipeline();
+  auto modest = accountant.RegisterPipeline();
+  MemoryReservation greedy_reservation(greedy);
+  MemoryReservation modest_reservation(modest);
+  EXPECT_TRUE(greedy_reservation.TryReserve(40));
+  // The greedy pipeline may exceed its share while the budget is not used up.
+  EXPECT_TRUE(greedy_reservation.TryReserve(40));
+  EXPECT_TRUE(modest_reservation.TryReserve(20));
+  EXPECT_FALSE(greedy_reservation.TryReserve(10));
+  // The modest pipeline may use its share even though the budget is used up.
+  EXPECT_TRUE(modest_reservation.TryReserve(20));
+  EXPECT_FALSE(modest_reservation.TryReserve(20));
+}
+
+TEST(MemoryAccountantTest, ForceReserve) {
+  MemoryAccountant accountant(/*budget_bytes=*/100);
+  auto pipeline = accountant.RegisterPipeline();
+  MemoryReservation reservation(pipeline);
+  CancellationManager cancellation_manager;
+  EXPECT_TRUE(reservation.TryReserve(10));
+  reservation.ForceReserve(200);
+  EXPECT_EQ(accountant.reserved_bytes(), 210);
+  EXPECT_FALSE(reservation.TryReserve(0));
+  reservation.Release(150);
+  TF_EXPECT_OK(reservation.Reserve(0, &cancellation_manager));
+}
+
+TEST(MemoryAccountantTest, NullPipeline) {
+  MemoryReservation reservation(/*pipeline=*/nullptr);
+  CancellationManager cancellation_manager;
+  EXPECT_TRUE(reservation.TryReserve(1 << 30));
+  TF_EXPECT_OK(reservation.Reserve(1 << 30, &cancellation_manager));
+  EXPECT_EQ(reservation.reserved_bytes(), 0);
+}
+
+TEST(MemoryAccountantTest, BackpressureIsReleased) {
+  MemoryAccountant accountant(/*budget_bytes=*/100);
+  auto pipeline = accountant.RegisterPipeline();
+  MemoryReservation producer(pipeline);
+  MemoryReservation other(pipeline);
+  CancellationManager cancellation_manager;
+  EXPECT_TRUE(other.TryReserve(90));
+  EXPECT_TRUE(producer.TryReserve(10));
+  Notification reserved;
+  std::unique_ptr<Thread> thread(
+      Env::Default()->StartThread({}, "reserve", [&]() {
+        TF_EXPECT_OK(producer.Reserve(50, &cancellation_manager));
+        reserved.Notify();
+      }));
+  EXPECT_FALSE(WaitForNotificationWithTimeout(&reserved, 10000));
+  other.Release(90);
+  reserved.WaitForNotification();
+  EXPECT_EQ(accountant.reserved_bytes(), 60);
+}
+
+TEST(MemoryAccountantTest, CancelBlockedReservation) {
+  MemoryAccountant accountant(/*budget_bytes=*/100);
+  auto pipeline = accountant.RegisterPipeline();
+  MemoryReservation reservation(pipeline);
+  CancellationManager cancellation_manager;
+  EXPECT_TRUE(reservation.TryReserve(100));
+  Status status;
+  std::unique_ptr<Thread> thread(
+      Env::Default()->StartThread({}, "reserve", [&]() {
+        status = reservation.Reserve(50, &cancellation_manager);
+      }));
+  cancellation_manager.StartCancel();
+  thread.reset();
+  EXPECT_TRUE(errors::IsCancelled(status));
+  EXPECT_EQ(reservation.reserved_bytes(), 100);
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
@@ -19,6 +19,7 @@ limitations under the License.
 #include "tensorflow/core/lib/monitoring/counter.h"
 #include "tensorflow/core/lib/monitoring/gauge.h"
 #include "tensorflow/core/lib/monitoring/sampler.h"
+#include "tensorflow/core/platform/mutex.h"
 
 namespace tensorflow {
 namespace metrics {
@@ -122,6 +123,13 @@ auto* tf_data_service_workers_created_counter =
     monitoring::Counter<0>::New("/tensorflow/data/service/workers_created",
                                 "Number of tf.data service workers created");
 
+auto* tf_data_service_cross_job_cache_lag_gauge =
+    monitoring::Gauge<int64, 1>::New(
+        "/tensorflow/data/service/cross_job_cache_lag",
+        "The number of elements by which jobs lag behind the newest element "
+        "of cross-job sliding-window caches.",
+        "job_id");
+
 auto* tf_data_filename_counter = monitoring::Counter<2>::New(
     "/tensorflow/data/filename", "The file name read by a tf.data Dataset.",
     "name", "filename");
@@ -148,6 +156,64 @@ auto* tf_data_auto_shard_rewrite_batch_size_reason =
         "to rewrite the batch size.",
         "reason");
 
+auto* tf_data_cache_reads_counter = monitoring::Counter<1>::New(
+    "/tensorflow/data/cache/reads",
+    "The number of elements read from tiered tf.data caches, by tier.",
+    "tier");
+
+auto* tf_data_cache_bytes_gauge = monitoring::Gauge<int64, 1>::New(
+    "/tensorflow/data/cache/bytes",
+    "The number of bytes held by tiered tf.data caches, by tier.", "tier");
+
+auto* tf_data_snapshot_read_time_usecs = monitoring::Counter<1>::New(
+    "/tensorflow/data/snapshot/read_time_usecs",
+    "The time spent by parallel snapshot readers, by pipeline stage.",
+    "stage");
+
+auto* tf_data_bucketing_elements_counter = monitoring::Counter<0>::New(
+    "/tensorflow/data/bucketing/elements",
+    "The number of elements batched by tf.data sequence length bucketing.");
+
+auto* tf_data_bucketing_batches_counter = monitoring::Counter<0>::New(
+    "/tensorflow/data/bucketing/batches",
+    "The number of batches produced by tf.data sequence length bucketing.");
+
+auto* tf_data_bucketing_tokens_counter = monitoring::Counter<1>::New(
+    "/tensorflow/data/bucketing/tokens",
+    "The number of sequence positions in batches produced by tf.data "
+    "sequence length bucketing, by type (real or padded).",
+    "type");
+
+auto* tf_data_pipeline_memory_gauge = monitoring::Gauge<int64, 1>::New(
+    "/tensorflow/data/memory/pipeline_bytes",
+    "The number of bytes held by the buffers of a tf.data input pipeline.",
+    "pipeline_id");
+
+auto* tf_data_memory_budget_gauge = monitoring::Gauge<int64, 0>::New(
+    "/tensorflow/data/memory/budget_bytes",
+    "The process-wide memory budget of tf.data buffers.");
+
+auto* tf_data_memory_backpressure_counter = monitoring::Counter<0>::New(
+    "/tensorflow/data/memory/backpressure",
+    "The number of times a tf.data buffer waited for memory to become "
+    "available.");
+
+auto* tf_data_runtime_threads_gauge = monitoring::Gauge<int64, 1>::New(
+    "/tensorflow/data/runtime/threads",
+    "The number of threads running in a tf.data runtime pool.", "pool");
+
+auto* tf_data_runtime_context_switches_counter = monitoring::Counter<1>::New(
+    "/tensorflow/data/runtime/context_switches",
+    "The number of times a thread of a tf.data runtime pool went to sleep "
+    "because it ran out of work.",
+    "pool");
+
+auto* tf_data_runtime_steals_counter = monitoring::Counter<1>::New(
+    "/tensorflow/data/runtime/steals",
+    "The number of closures a thread of a tf.data runtime pool stole from "
+    "the queue of another thread.",
+    "pool");
+
 auto* parse_dense_feature_counter = monitoring::Counter<0>::New(
     "/tensorflow/data/dense_feature",
     "The number of dense features parsed by ops for parsing tf.Example.");
@@ -186,6 +252,12 @@ auto* xla_compilation_time_usecs = monitoring::Counter<0>::New(
     "/tensorflow/core/xla_compilation_time_usecs",
     "The total time spent on compiling XLA graphs in microseconds.");
 
+auto* xla_persistent_cache_lookups = monitoring::Counter<1>::New(
+    "/tensorflow/core/xla_persistent_cache_lookups",
+    "The number of lookups in the persistent XLA compilation cache, by "
+    "result.",
+    "result");
+
 auto* xla_tpu_spmd_cores_per_replica = monitoring::Counter<1>::New(
     "/tensorflow/tpu/xla_spmd_cores_per_replica",
     "The number of cores used by XLA SPMD-replicated models.", "cores");
@@ -266,6 +338,11 @@ void RecordTFDataServiceWorkerCreated() {
   tf_data_service_workers_created_counter->GetCell()->IncrementBy(1);
 }
 
+void RecordTFDataServiceCrossJobCacheLag(int64_t job_id, int64_t lag) {
+  tf_data_service_cross_job_cache_lag_gauge->GetCell(absl::StrCat(job_id))
+      ->Set(lag);
+}
+
 void RecordTFDataFilename(const string& name, const string& filename) {
   tf_data_filename_counter->GetCell(name, filename)->IncrementBy(1);
 }
@@ -277,6 +354,56 @@ void RecordTFDataAutoShard(const string& id, data::AutoShardPolicy policy,
   tf_data_auto_shard->GetCell(id, "num_replicas")->Set(num_replicas);
 }
 
+void RecordTFDataCacheRead(const string& tier) {
+  tf_data_cache_reads_counter->GetCell(tier)->IncrementBy(1);
+}
+
+void RecordTFDataCacheBytes(const string& tier, int64_t num_bytes) {
+  static mutex* mu = new mutex();
+  mutex_lock l(*mu);
+  auto* cell = tf_data_cache_bytes_gauge->GetCell(tier);
+  cell->Set(cell->value() + num_bytes);
+}
+
+void RecordTFDataSnapshotReadTime(const string& stage, uint64 time_usecs) {
+  if (time_usecs > 0) {
+    tf_data_snapshot_read_time_usecs->GetCell(stage)->IncrementBy(time_usecs);
+  }
+}
+
+void RecordTFDataBucketBatch(int64_t num_elements, int64_t num_tokens,
+                             int64_t num_padded_tokens) {
+  tf_data_bucketing_elements_counter->GetCell()->IncrementBy(num_elements);
+  tf_data_bucketing_batches_counter->GetCell()->IncrementBy(1);
+  tf_data_bucketing_tokens_counter->GetCell("real")->IncrementBy(num_tokens);
+  tf_data_bucketing_tokens_counter->GetCell("padded")->IncrementBy(
+      num_padded_tokens - num_tokens);
+}
+
+void RecordTFDataPipelineMemory(const string& pipeline_id, int64_t num_bytes) {
+  tf_data_pipeline_memory_gauge->GetCell(pipeline_id)->Set(num_bytes);
+}
+
+void RecordTFDataMemoryBudget(int64_t num_bytes) {
+  tf_data_memory_budget_gauge->GetCell()->Set(num_bytes);
+}
+
+void RecordTFDataMemoryBackpressure() {
+  tf_data_memory_backpressure_counter->GetCell()->IncrementBy(1);
+}
+
+void RecordTFDataRuntimeThreads(const string& pool, int64_t num_threads) {
+  tf_data_runtime_threads_gauge->GetCell(pool)->Set(num_threads);
+}
+
+void RecordTFDataRuntimeContextSwitch(const string& pool) {
+  tf_data_runtime_context_switches_counter->GetCell(pool)->IncrementBy(1);
+}
+
+void RecordTFDataRuntimeSteal(const string& pool) {
+  tf_data_runtime_steals_counter->GetCell(pool)->IncrementBy(1);
+}
+
 void RecordTFDataAutoShardRewriteBatchSize(
     bool eligible, const std::vector<string>& ineligible_reason) {
   tf_data_auto_shard_rewrite_batch_size_eligible
@@ -412,6 +539,10 @@ void UpdateXlaCompilationTime(const uint64 compilation_time_usecs) {
   }
 }
 
+void RecordXlaPersistentCacheLookup(const string& result) {
+  xla_persistent_cache_lookups->GetCell(result)->IncrementBy(1);
+}
+
 void UpdateBfcAllocatorDelayTime(const uint64 delay_usecs) {
   static auto* bfc_allocator_delay_cell = bfc_allocator_delay->GetCell();
   if (delay_usecs > 0) {
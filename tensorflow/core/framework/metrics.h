@@ -97,11 +97,58 @@ void RecordTFDataOptimization(const string& name, int64_t num_changes);
 // Records that a tf.data service worker has been created.
 void RecordTFDataServiceWorkerCreated();
 
+// Records how many elements the tasks of job `job_id` lag behind the newest
+// element of a cross-job sliding-window cache on a tf.data service worker.
+void RecordTFDataServiceCrossJobCacheLag(int64_t job_id, int64_t lag);
+
 // Records the file name read by a tf.data Dataset.
 //
 // The `name` argument identifies the Dataset type (e.g. "TFRecordDataset").
 void RecordTFDataFilename(const string& name, const string& filename);
 
+// Records a read of an element from a tiered tf.data cache.
+//
+// The `tier` argument identifies where the element was held ("memory" or
+// "disk"), which gives the hit ratio of the memory tier.
+void RecordTFDataCacheRead(const string& tier);
+
+// Adds `num_bytes`, which may be negative, to the number of bytes held by
+// tiered tf.data caches in `tier` ("memory" or "disk").
+void RecordTFDataCacheBytes(const string& tier, int64_t num_bytes);
+
+// Records the time spent by the parallel snapshot reader in `stage`:
+// "read" (file I/O), "decode" (decompression and tensor decoding), or "wait"
+// (consumers waiting for decoded elements).
+void RecordTFDataSnapshotReadTime(const string& stage, uint64 time_usecs);
+
+// Records a batch of `num_elements` elements produced by sequence length
+// bucketing. `num_tokens` is the total length of the sequences in the batch
+// and `num_padded_tokens` the length after padding, so the ratio of the two
+// is the padding efficiency.
+void RecordTFDataBucketBatch(int64_t num_elements, int64_t num_tokens,
+                             int64_t num_padded_tokens);
+
+// Records the number of bytes that the buffers of the tf.data input pipeline
+// identified by `pipeline_id` hold against the process-wide memory budget.
+void RecordTFDataPipelineMemory(const string& pipeline_id, int64_t num_bytes);
+
+// Records the process-wide memory budget of tf.data buffers.
+void RecordTFDataMemoryBudget(int64_t num_bytes);
+
+// Records that a tf.data buffer waited for memory to become available.
+void RecordTFDataMemoryBackpressure();
+
+// Records the number of threads running in the tf.data runtime pool `pool`.
+void RecordTFDataRuntimeThreads(const string& pool, int64_t num_threads);
+
+// Records that a thread of the tf.data runtime pool `pool` went to sleep
+// because it ran out of work.
+void RecordTFDataRuntimeContextSwitch(const string& pool);
+
+// Records that a thread of the tf.data runtime pool `pool` stole a closure from
+// the queue of another thread.
+void RecordTFDataRuntimeSteal(const string& pool);
+
 // Records statistics of tf.data auto sharding.
 //
 // The `id` is a unique identifier of the input pipeline. The `policy`
@@ -174,6 +221,10 @@ void UpdateTpuVariableDistributionTime(const uint64 distribution_time_usecs);
 // Updates the metrics stored about time XLA spents compiling graphs.
 void UpdateXlaCompilationTime(const uint64 compilation_time_usecs);
 
+// Records the outcome of a lookup in the persistent XLA compilation cache.
+// `result` is one of "hit", "miss" or "invalid".
+void RecordXlaPersistentCacheLookup(const string& result);
+
 // Updates the metrics stored about time BFC allocator spents during delay.
 void UpdateBfcAllocatorDelayTime(const uint64 delay_usecs);
 
@@ -121,6 +121,166 @@ inline void UpdateStateValues(Node::ModelParameters* parameters) {
   }
 }
 
+// A stage of the input pipeline used by the critical path optimization. A
+// stage consists of a node that produces its elements asynchronously (or the
+// output node of the pipeline) and the nodes that are executed synchronously
+// by the threads of that node.
+struct Stage {
+  // The CPU time spent per element produced by the pipeline in the node that
+  // starts the stage, which is divided among the threads of the stage.
+  double work = 0.0L;
+  // The CPU time spent per element produced by the pipeline in the other nodes
+  // of the stage. The stage reads its input sequentially, so this time is not
+  // divided by the parallelism of the stage.
+  double input_work = 0.0L;
+  // The index of the stage that consumes the elements of this stage, or -1
+  // for the output stage.
+  int64_t consumer = -1;
+  // The tunable parallelism and buffer size of the stage, if any.
+  Parameter* parallelism = nullptr;
+  Parameter* buffer_size = nullptr;
+  // The parallelism and buffer size used if the parameters are not tunable.
+  // A negative buffer size indicates that the stage buffers one element per
+  // unit of parallelism.
+  double fixed_parallelism = 1.0L;
+  double fixed_buffer_size = -1.0L;
+
+  double Parallelism() const {
+    return parallelism ? parallelism->value : fixed_parallelism;
+  }
+
+  double BufferSize() const {
+    if (buffer_size) {
+      return buffer_size->value;
+    }
+    return fixed_buffer_size >= 0 ? fixed_buffer_size : Parallelism();
+  }
+
+  // The time the stage needs to produce the share of an output element of the
+  // pipeline that flows through it.
+  double Time() const {
+    return work / std::max(Parallelism(), 1.0) + input_work;
+  }
+};
+
+// Returns whether the given node starts a new stage of the input pipeline.
+inline bool IsStageNode(const std::shared_ptr<Node>& node) {
+  return node->has_parameter(kParallelism) ||
+         node->has_parameter(kBufferSize);
+}
+
+// Partitions the tree rooted in `output` into stages. The work of each node is
+// its processing time since the time recorded in `previous_processing_times`,
+// divided by `num_elements` elements produced by the pipeline in that period.
+// The work of the node that starts a stage is accounted as `work` and the work
+// of the remaining nodes as `input_work`.
+std::vector<Stage> CollectStages(
+    std::shared_ptr<Node> output, const Node::ModelParameters& parameters,
+    const absl::flat_hash_map<int64_t, int64_t>& previous_processing_times,
+    int64_t num_elements) {
+  absl::flat_hash_map<std::pair<string, string>, Parameter*>
+      tunable_parameters;
+  for (auto& pair : parameters) {
+    tunable_parameters[std::make_pair(pair.first, pair.second->name)] =
+        pair.second.get();
+  }
+  std::vector<Stage> stages;
+  auto add_stage = [&](const std::shared_ptr<Node>& node, int64_t consumer) {
+    Stage stage;
+    stage.consumer = consumer;
+    const string name = node->long_name();
+    if (node->has_parameter(kParallelism)) {
+      stage.parallelism = gtl::FindPtrOrNull(
+          tunable_parameters, std::make_pair(name, string(kParallelism)));
+      stage.fixed_parallelism =
+          std::max(node->parameter_value(kParallelism), 1.0);
+    }
+    if (node->has_parameter(kBufferSize)) {
+      stage.buffer_size = gtl::FindPtrOrNull(
+          tunable_parameters, std::make_pair(name, string(kBufferSize)));
+      stage.fixed_buffer_size =
+          std::max(node->parameter_value(kBufferSize), 0.0);
+    }
+    stages.push_back(stage);
+    return static_cast<int64_t>(stages.size() - 1);
+  };
+  std::deque<std::pair<std::shared_ptr<Node>, int64_t>> queue;
+  queue.emplace_back(output, add_stage(output, /*consumer=*/-1));
+  while (!queue.empty()) {
+    auto node = queue.front().first;
+    const int64_t stage = queue.front().second;
+    queue.pop_front();
+    const int64_t processing_time = std::max<int64_t>(
+        node->processing_time() -
+            gtl::FindWithDefault(previous_processing_times, node->id(), 0),
+        0);
+    const double work = processing_time / static_cast<double>(num_elements);
+    if (node == output || IsStageNode(node)) {
+      stages[stage].work += work;
+    } else {
+      stages[stage].input_work += work;
+    }
+    for (auto& input : node->inputs()) {
+      if (IsStageNode(input)) {
+        queue.emplace_back(input, add_stage(input, stage));
+      } else {
+        queue.emplace_back(input, stage);
+      }
+    }
+  }
+  return stages;
+}
+
+// Returns the aggregate processing time of each node in the tree rooted in
+// `output`, keyed by node ID.
+absl::flat_hash_map<int64_t, int64_t> CollectProcessingTimes(
+    std::shared_ptr<Node> output) {
+  absl::flat_hash_map<int64_t, int64_t> processing_times;
+  std::deque<std::shared_ptr<Node>> queue = {output};
+  while (!queue.empty()) {
+    auto node = queue.front();
+    queue.pop_front();
+    processing_times[node->id()] = node->processing_time();
+    for (auto& input : node->inputs()) {
+      queue.push_back(input);
+    }
+  }
+  return processing_times;
+}
+
+// Estimates the per-element output time of a pipeline with the given stages.
+// In steady state, every stage is driven at the rate of the slowest stage (or
+// of the consumer of the pipeline, if it is slower), so the output time is the
+// time of the slowest stage plus the expected time consumers spend waiting on
+// the buffers of their producer stages.
+double CriticalPathOutputTime(const std::vector<Stage>& stages,
+                              double model_input_time) {
+  double critical_time = model_input_time;
+  for (const auto& stage : stages) {
+    critical_time = std::max(critical_time, stage.Time());
+  }
+  double wait_time = 0.0L;
+  for (const auto& stage : stages) {
+    if (stage.consumer >= 0) {
+      wait_time += Node::ComputeWaitTime(
+          stage.Time(), critical_time, stage.BufferSize(),
+          /*producer_time_derivative=*/nullptr,
+          /*consumer_time_derivative=*/nullptr,
+          /*buffer_size_derivative=*/nullptr);
+    }
+  }
+  return critical_time + wait_time;
+}
+
+// Returns the number of threads used by the given stages.
+double NumThreads(const std::vector<Stage>& stages) {
+  double num_threads = 0.0L;
+  for (const auto& stage : stages) {
+    num_threads += std::max(stage.Parallelism(), 1.0);
+  }
+  return num_threads;
+}
+
 // Recursively produces protos for nodes in a subtree of `output` node and
 // appends them to nodes of the given model.
 Status ModelToProtoHelper(std::shared_ptr<Node> output, ModelProto* model) {
@@ -1663,6 +1823,10 @@ void Model::Optimize(AutotuneAlgorithm algorithm, int64_t cpu_budget,
       OptimizeGradientDescent(snapshot, optimization_params,
                               cancellation_manager);
       break;
+    case AutotuneAlgorithm::CRITICAL_PATH:
+      OptimizeCriticalPath(snapshot, optimization_params,
+                           cancellation_manager);
+      break;
     default:
       VLOG(2) << "Autotuning algorithm was not recognized. Aborting "
                  "optimization.";
@@ -1901,6 +2065,201 @@ void Model::OptimizeHillClimb(std::shared_ptr<Node> snapshot,
   UpdateStateValues(&parameters);
 }
 
+void Model::OptimizeCriticalPath(std::shared_ptr<Node> snapshot,
+                                 const OptimizationParams& optimization_params,
+                                 CancellationManager* cancellation_manager) {
+  VLOG(2) << "Starting optimization of tunable parameters with Critical Path.";
+  auto parameters = CollectTunableParameters(snapshot);
+  if (parameters.empty()) {
+    VLOG(2) << "The Critical Path optimization is terminated since no node "
+               "with tunable parameters has recorded elements.";
+    return;
+  }
+  VLOG(2) << "Number of tunable parameters: " << parameters.size();
+
+  // An increment is only made if it improves the output time by at least this
+  // fraction, and a decrement is made if it worsens the output time by at most
+  // this fraction. The gap between the two avoids oscillation.
+  constexpr double kMinRelativeGain = 0.01L;
+  constexpr double kMaxRelativeLoss = 0.005L;
+
+  // Bounds the number of parameter updates made in one optimization.
+  constexpr int64_t kMaxIterations = 1000;
+
+  // Measure the stage times over the window since the previous optimization,
+  // so that the allocation follows changes in the pipeline's behavior.
+  absl::flat_hash_map<int64_t, int64_t> processing_times =
+      CollectProcessingTimes(snapshot);
+  absl::flat_hash_map<int64_t, int64_t> previous_processing_times;
+  int64_t num_elements = snapshot->num_elements();
+  {
+    mutex_lock l(mu_);
+    if (num_elements > critical_path_num_elements_) {
+      std::swap(previous_processing_times, critical_path_processing_times_);
+      num_elements -= critical_path_num_elements_;
+    }
+    critical_path_processing_times_ = processing_times;
+    critical_path_num_elements_ = snapshot->num_elements();
+  }
+  if (num_elements <= 0) {
+    VLOG(2) << "The Critical Path optimization is terminated since the "
+               "pipeline has not produced any elements.";
+    return;
+  }
+  std::vector<Stage> stages = CollectStages(
+      snapshot, parameters, previous_processing_times, num_elements);
+
+  // Start from the values currently in use.
+  for (auto& pair : parameters) {
+    auto& parameter = pair.second;
+    tf_shared_lock l(*parameter->state->mu);
+    parameter->value = std::min(
+        std::max(std::round(parameter->state->value), parameter->min),
+        parameter->max);
+  }
+
+  const double cpu_budget = optimization_params.cpu_budget();
+  const double ram_budget = optimization_params.ram_budget();
+  const double model_input_time = optimization_params.model_input_time();
+  auto output_time = [&]() {
+    return CriticalPathOutputTime(stages, model_input_time);
+  };
+  auto num_threads = [&]() { return NumThreads(stages); };
+  auto ram_usage = [&]() { return TotalMaximumBufferedBytes(snapshot); };
+  auto within_budget = [&]() {
+    return num_threads() <= cpu_budget && ram_usage() <= ram_budget;
+  };
+  // The share of the CPU and RAM budgets used by the given number of threads
+  // and bytes.
+  auto cost = [&](double threads, double bytes) {
+    double result = 0.0L;
+    if (threads > 0) {
+      result += cpu_budget > 0 ? threads / cpu_budget
+                               : std::numeric_limits<double>::infinity();
+    }
+    if (bytes > 0) {
+      result += ram_budget > 0 ? bytes / ram_budget
+                               : std::numeric_limits<double>::infinity();
+    }
+    return result;
+  };
+
+  // Tries to change `parameter` by `delta` and returns the resulting output
+  // time, threads and bytes. The parameter value is restored afterwards.
+  struct Change {
+    double output_time;
+    double threads;
+    double bytes;
+  };
+  auto try_change = [&](Parameter* parameter, double delta) {
+    const double threads = num_threads();
+    const double bytes = ram_usage();
+    parameter->value += delta;
+    Change change = {output_time(), num_threads() - threads,
+                     ram_usage() - bytes};
+    parameter->value -= delta;
+    return change;
+  };
+
+  // 1. Release resources until the budgets are met, giving up the resources
+  // whose loss increases the output time the least per unit of budget.
+  for (int64_t i = 0; i < kMaxIterations && !within_budget(); ++i) {
+    const double current = output_time();
+    Parameter* best_parameter = nullptr;
+    double best_ratio = std::numeric_limits<double>::infinity();
+    for (auto& pair : parameters) {
+      Parameter* parameter = pair.second.get();
+      if (parameter->value <= parameter->min) {
+        continue;
+      }
+      Change change = try_change(parameter, -1);
+      const double freed = cost(-change.threads, -change.bytes);
+      if (freed <= 0) {
+        continue;
+      }
+      const double ratio = (change.output_time - current) / freed;
+      if (ratio < best_ratio) {
+        best_ratio = ratio;
+        best_parameter = parameter;
+      }
+    }
+    if (!best_parameter) {
+      break;
+    }
+    best_parameter->value--;
+  }
+
+  // 2. Release resources which do not affect the output time, e.g. threads of
+  // stages that are not on the critical path.
+  for (int64_t i = 0; i < kMaxIterations; ++i) {
+    const double current = output_time();
+    Parameter* best_parameter = nullptr;
+    double best_loss = kMaxRelativeLoss * current;
+    for (auto& pair : parameters) {
+      Parameter* parameter = pair.second.get();
+      if (parameter->value <= parameter->min) {
+        continue;
+      }
+      Change change = try_change(parameter, -1);
+      if (cost(-change.threads, -change.bytes) <= 0) {
+        continue;
+      }
+      const double loss = change.output_time - current;
+      if (loss <= best_loss) {
+        best_loss = loss;
+        best_parameter = parameter;
+      }
+    }
+    if (!best_parameter) {
+      break;
+    }
+    best_parameter->value--;
+  }
+
+  // 3. Spend the budgets on the increments with the largest output time
+  // improvement per unit of budget.
+  for (int64_t i = 0; i < kMaxIterations; ++i) {
+    if (cancellation_manager->IsCancelled()) {
+      break;
+    }
+    const double current = output_time();
+    const double threads = num_threads();
+    const double bytes = ram_usage();
+    Parameter* best_parameter = nullptr;
+    double best_utility = 0.0L;
+    for (auto& pair : parameters) {
+      Parameter* parameter = pair.second.get();
+      if (parameter->value >= parameter->max) {
+        continue;
+      }
+      Change change = try_change(parameter, 1);
+      if (threads + change.threads > cpu_budget ||
+          bytes + change.bytes > ram_budget) {
+        continue;
+      }
+      const double gain = current - change.output_time;
+      if (gain <= 0 || gain < kMinRelativeGain * current) {
+        continue;
+      }
+      const double utility =
+          gain / std::max(cost(change.threads, change.bytes),
+                          std::numeric_limits<double>::epsilon());
+      if (utility > best_utility) {
+        best_utility = utility;
+        best_parameter = parameter;
+      }
+    }
+    if (!best_parameter) {
+      break;
+    }
+    best_parameter->value++;
+  }
+  VLOG(2) << "Critical Path optimization estimated an output time of "
+          << output_time() << " ns using " << num_threads() << " threads and "
+          << ram_usage() << " bytes.";
+  UpdateStateValues(&parameters);
+}
+
 double Model::OutputTime(std::shared_ptr<Node> node, double model_input_time,
                          Model::ParameterGradients* gradients) {
   // To store the input time for each node.
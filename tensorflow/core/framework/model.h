@@ -224,6 +224,12 @@ class Node {
     return bytes_produced_;
   }
 
+  // Indicates whether the node has a parameter with the given name.
+  bool has_parameter(const string& name) const TF_LOCKS_EXCLUDED(mu_) {
+    tf_shared_lock l(mu_);
+    return parameters_.contains(name);
+  }
+
   // Indicates whether the node has tunable parameters.
   bool has_tunable_parameters() const TF_LOCKS_EXCLUDED(mu_) {
     tf_shared_lock l(mu_);
@@ -734,6 +740,22 @@ class Model {
                                const OptimizationParams& optimization_params,
                                CancellationManager* cancellation_manager);
 
+  // This optimization algorithm partitions the input pipeline into stages,
+  // each of which is an asynchronous node together with the nodes executed by
+  // its threads, and estimates the time each stage needs per element from the
+  // processing time measured since the previous optimization. The stage with
+  // the largest time determines the throughput and forms the critical path.
+  //
+  // Starting from the current parameter values, the algorithm first releases
+  // threads and buffer slots whose removal does not affect the estimated
+  // output time, e.g. parallelism of stages off the critical path. It then
+  // repeatedly makes the increment with the largest output time improvement
+  // per unit of CPU and RAM budget it consumes, until neither budget allows
+  // an increment that improves the output time noticeably.
+  void OptimizeCriticalPath(std::shared_ptr<Node> snapshot,
+                            const OptimizationParams& optimization_params,
+                            CancellationManager* cancellation_manager);
+
   // Determines if we should stop the gradient descent optimization iterations
   // based on number of increasable parameters, CPU budget, RAM budget and
   // current resource usage.
@@ -769,6 +791,13 @@ class Model {
   // running optimizations.
   int64_t optimization_period_ms_ TF_GUARDED_BY(mu_);
 
+  // The processing time of each node (by node ID) and the number of elements
+  // produced by the output node at the time of the previous critical path
+  // optimization. Used to measure stage times over the window since then.
+  absl::flat_hash_map<int64_t, int64_t> critical_path_processing_times_
+      TF_GUARDED_BY(mu_);
+  int64_t critical_path_num_elements_ TF_GUARDED_BY(mu_) = 0;
+
   // Gauge cell that can be used to collect the state of the model.
   monitoring::GaugeCell<std::function<std::string()>>* model_gauge_cell_ =
       nullptr;
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/framework/model.h"
 
+#include <algorithm>
 #include <memory>
 
 #include "tensorflow/core/framework/cancellation.h"
@@ -1165,7 +1166,213 @@ TEST_P(OptimizeZeroRamBudgetTest, Model) {
 }
 
 INSTANTIATE_TEST_SUITE_P(Test, OptimizeZeroRamBudgetTest,
-                         ::testing::Values(0, 1));
+                         ::testing::Values(0, 1, 2));
+
+// Simulates the input pipeline `prefetch(batch(map(map(source))))` in which
+// both maps are parallel. Each round of the simulation produces a number of
+// output elements, records the CPU time the maps and the source spend on them,
+// and runs the given autotuning algorithm.
+class SimulatedPipeline {
+ public:
+  static constexpr int64_t kBatchSize = 8;
+  static constexpr int64_t kSourceTime = 50;
+
+  SimulatedPipeline(int64_t first_map_time, int64_t second_map_time)
+      : first_map_time_(first_map_time), second_map_time_(second_map_time) {
+    model_.AddNode(
+        [](Node::Args args) { return MakeKnownRatioNode(args, 1); }, "root",
+        nullptr, &root_);
+    model_.AddNode(
+        [this](Node::Args args) {
+          return MakeAsyncKnownRatioNode(
+              args, 1, {MakeTunableParameter(kBufferSize, /*min=*/1)});
+        },
+        "prefetch", root_, &prefetch_);
+    model_.AddNode(
+        [](Node::Args args) { return MakeKnownRatioNode(args, kBatchSize); },
+        "batch", prefetch_, &batch_);
+    model_.AddNode(
+        [this](Node::Args args) {
+          return MakeAsyncKnownRatioNode(
+              args, 1, {MakeTunableParameter(kParallelism, /*min=*/1)});
+        },
+        "first_map", batch_, &first_map_);
+    model_.AddNode(
+        [this](Node::Args args) {
+          return MakeAsyncKnownRatioNode(
+              args, 1, {MakeTunableParameter(kParallelism, /*min=*/1)});
+        },
+        "second_map", first_map_, &second_map_);
+    model_.AddNode([](Node::Args args) { return MakeSourceNode(args); },
+                   "source", second_map_, &source_);
+  }
+
+  void set_map_times(int64_t first_map_time, int64_t second_map_time) {
+    first_map_time_ = first_map_time;
+    second_map_time_ = second_map_time;
+  }
+
+  // Produces `num_elements` output elements and then runs the optimization.
+  void RunRound(AutotuneAlgorithm algorithm, int64_t num_elements,
+                int64_t cpu_budget) {
+    const int64_t num_inputs = num_elements * kBatchSize;
+    for (int64_t i = 0; i < num_elements; ++i) {
+      root_->record_element();
+      prefetch_->record_element();
+      batch_->record_element();
+    }
+    for (int64_t i = 0; i < num_inputs; ++i) {
+      first_map_->record_element();
+      second_map_->record_element();
+      source_->record_element();
+    }
+    first_map_->add_processing_time(num_inputs * first_map_time_);
+    second_map_->add_processing_time(num_inputs * second_map_time_);
+    source_->add_processing_time(num_inputs * kSourceTime);
+    CancellationManager cancellation_manager;
+    model_.Optimize(algorithm, cpu_budget, /*ram_budget=*/int64_t{1} << 30,
+                    /*model_input_time=*/0, &cancellation_manager);
+  }
+
+  double first_map_parallelism() const {
+    return first_map_->parameter_value(kParallelism);
+  }
+
+  double second_map_parallelism() const {
+    return second_map_->parameter_value(kParallelism);
+  }
+
+  double buffer_size() const { return prefetch_->parameter_value(kBufferSize); }
+
+  // The output and the prefetch stages use one thread each.
+  double NumThreads() const {
+    return 2 + first_map_parallelism() + second_map_parallelism();
+  }
+
+  // Returns the number of output elements produced per second with the given
+  // parallelism of the maps, which is limited by the slowest map stage. The
+  // second map reads from the source sequentially, so the time of the source
+  // is not divided by the parallelism of the second map.
+  double Throughput(double first_map_parallelism,
+                    double second_map_parallelism) const {
+    const double first_stage_time =
+        kBatchSize * first_map_time_ / std::max(first_map_parallelism, 1.0);
+    const double second_stage_time =
+        kBatchSize * (second_map_time_ / std::max(second_map_parallelism, 1.0) +
+                      kSourceTime);
+    return 1e9 / std::max(first_stage_time, second_stage_time);
+  }
+
+  double Throughput() const {
+    return Throughput(first_map_parallelism(), second_map_parallelism());
+  }
+
+  // Returns the largest throughput achievable within the given CPU budget.
+  double OptimalThroughput(int64_t cpu_budget) const {
+    double result = 0.0;
+    for (int64_t first = 1; first < cpu_budget - 2; ++first) {
+      result = std::max(result, Throughput(first, cpu_budget - 2 - first));
+    }
+    return result;
+  }
+
+ private:
+  std::shared_ptr<Parameter> MakeTunableParameter(const string& name,
+                                                  double min) {
+    return MakeParameter(
+        name,
+        std::make_shared<SharedState>(kAutotune, std::make_shared<mutex>(),
+                                      std::make_shared<condition_variable>()),
+        min, /*max=*/16);
+  }
+
+  int64_t first_map_time_;
+  int64_t second_map_time_;
+  Model model_;
+  std::shared_ptr<Node> root_;
+  std::shared_ptr<Node> prefetch_;
+  std::shared_ptr<Node> batch_;
+  std::shared_ptr<Node> first_map_;
+  std::shared_ptr<Node> second_map_;
+  std::shared_ptr<Node> source_;
+};
+
+// Runs `num_rounds` rounds of the simulation and returns the first round after
+// which the parameters no longer changed.
+int64_t RunUntilConverged(SimulatedPipeline* pipeline,
+                          AutotuneAlgorithm algorithm, int64_t num_rounds,
+                          int64_t cpu_budget) {
+  int64_t converged = 0;
+  std::vector<double> previous;
+  for (int64_t round = 1; round <= num_rounds; ++round) {
+    pipeline->RunRound(algorithm, /*num_elements=*/100, cpu_budget);
+    std::vector<double> current = {pipeline->first_map_parallelism(),
+                                   pipeline->second_map_parallelism(),
+                                   pipeline->buffer_size()};
+    if (current != previous) {
+      converged = round;
+      previous = std::move(current);
+    }
+  }
+  return converged;
+}
+
+TEST(CriticalPathConvergenceTest, Model) {
+  constexpr int64_t kCpuBudget = 8;
+  SimulatedPipeline pipeline(/*first_map_time=*/1000, /*second_map_time=*/100);
+  const int64_t converged =
+      RunUntilConverged(&pipeline, AutotuneAlgorithm::CRITICAL_PATH,
+                        /*num_rounds=*/20, kCpuBudget);
+  const double optimal = pipeline.OptimalThroughput(kCpuBudget);
+  VLOG(1) << "Converged after " << converged << " rounds with parallelism "
+          << pipeline.first_map_parallelism() << " and "
+          << pipeline.second_map_parallelism() << ", reaching "
+          << pipeline.Throughput() << " of " << optimal
+          << " elements per second.";
+  EXPECT_LE(converged, 2);
+  EXPECT_LE(pipeline.NumThreads(), kCpuBudget);
+  EXPECT_EQ(pipeline.first_map_parallelism(), 5);
+  EXPECT_EQ(pipeline.second_map_parallelism(), 1);
+  EXPECT_GE(pipeline.Throughput(), 0.95 * optimal);
+}
+
+TEST(CriticalPathComparisonTest, Model) {
+  constexpr int64_t kCpuBudget = 8;
+  SimulatedPipeline critical_path(/*first_map_time=*/1000,
+                                  /*second_map_time=*/100);
+  RunUntilConverged(&critical_path, AutotuneAlgorithm::CRITICAL_PATH,
+                    /*num_rounds=*/20, kCpuBudget);
+  const double optimal = critical_path.OptimalThroughput(kCpuBudget);
+  for (AutotuneAlgorithm algorithm :
+       {AutotuneAlgorithm::HILL_CLIMB, AutotuneAlgorithm::GRADIENT_DESCENT}) {
+    SimulatedPipeline pipeline(/*first_map_time=*/1000,
+                               /*second_map_time=*/100);
+    RunUntilConverged(&pipeline, algorithm, /*num_rounds=*/20, kCpuBudget);
+    // The other algorithms may use more threads than the CPU budget, so their
+    // throughput is capped at the best throughput within the budget.
+    EXPECT_GE(critical_path.Throughput(),
+              0.95 * std::min(pipeline.Throughput(), optimal))
+        << AutotuneAlgorithm_Name(algorithm);
+  }
+}
+
+TEST(CriticalPathAdaptationTest, Model) {
+  constexpr int64_t kCpuBudget = 8;
+  SimulatedPipeline pipeline(/*first_map_time=*/1000, /*second_map_time=*/100);
+  RunUntilConverged(&pipeline, AutotuneAlgorithm::CRITICAL_PATH,
+                    /*num_rounds=*/5, kCpuBudget);
+  EXPECT_GT(pipeline.first_map_parallelism(),
+            pipeline.second_map_parallelism());
+
+  // Once the cost moves to the second map, only the most recent measurements
+  // are used and the threads move to the second map.
+  pipeline.set_map_times(/*first_map_time=*/100, /*second_map_time=*/1000);
+  RunUntilConverged(&pipeline, AutotuneAlgorithm::CRITICAL_PATH,
+                    /*num_rounds=*/5, kCpuBudget);
+  EXPECT_LT(pipeline.first_map_parallelism(),
+            pipeline.second_map_parallelism());
+  EXPECT_LE(pipeline.NumThreads(), kCpuBudget);
+}
 
 TEST(RecordTimeTest, RecordTimeTest) {
   std::shared_ptr<Node> source = model::MakeSourceNode({});
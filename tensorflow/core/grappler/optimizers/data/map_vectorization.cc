@@ -0,0 +1,755 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/grappler/optimizers/data/map_vectorization.h"
+
+#include <array>
+#include <deque>
+
+#include "absl/algorithm/container.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/attr_value_util.h"
+#include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/partial_tensor_shape.h"
+#include "tensorflow/core/framework/shape_inference.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.pb.h"
+#include "tensorflow/core/grappler/clusters/cluster.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/mutable_graph_view.h"
+#include "tensorflow/core/grappler/optimizers/custom_graph_optimizer_registry.h"
+#include "tensorflow/core/grappler/optimizers/data/function_utils.h"
+#include "tensorflow/core/grappler/optimizers/data/graph_utils.h"
+#include "tensorflow/core/grappler/utils.h"
+#include "tensorflow/core/lib/gtl/map_util.h"
+#include "tensorflow/core/public/version.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+constexpr char kMapDataset[] = "MapDataset";
+constexpr char kParallelMapDatasetV2[] = "ParallelMapDatasetV2";
+constexpr char kBatchDataset[] = "BatchDataset";
+constexpr char kBatchDatasetV2[] = "BatchDatasetV2";
+constexpr char kMapDefun[] = "MapDefun";
+constexpr char kOutputShapes[] = "output_shapes";
+constexpr char kOutputTypes[] = "output_types";
+
+// Ops with a single input that compute each output value from the input value
+// at the same position, so applying them to a batch yields the batch of the
+// per-element results.
+constexpr std::array<const char*, 45> kUnaryElementwiseOps = {
+    "Abs",
+    "Acos",
+    "AsString",
+    "Asin",
+    "Atan",
+    "Bucketize",
+    "Cast",
+    "Ceil",
+    "Conj",
+    "Cos",
+    "Cosh",
+    "Elu",
+    "Erf",
+    "Exp",
+    "Expm1",
+    "Floor",
+    "Identity",
+    "Imag",
+    "Invert",
+    "IsFinite",
+    "IsInf",
+    "IsNan",
+    "Log",
+    "Log1p",
+    "LogicalNot",
+    "Neg",
+    "Real",
+    "Reciprocal",
+    "Relu",
+    "Relu6",
+    "Rint",
+    "Round",
+    "Rsqrt",
+    "Selu",
+    "Sigmoid",
+    "Sign",
+    "Sin",
+    "Softplus",
+    "Sqrt",
+    "Square",
+    "StringToHashBucket",
+    "StringToHashBucketFast",
+    "StringToHashBucketStrong",
+    "Tan",
+    "Tanh"};
+
+// Ops with two inputs that are combined element-wise with broadcasting. They
+// can be applied to a batch as long as broadcasting the batched operands
+// lines up the same dimensions as broadcasting the per-element operands.
+constexpr std::array<const char*, 26> kBinaryElementwiseOps = {
+    "Add",           "AddV2",
+    "BitwiseAnd",    "BitwiseOr",
+    "BitwiseXor",    "Div",
+    "DivNoNan",      "Equal",
+    "FloorDiv",      "FloorMod",
+    "Greater",       "GreaterEqual",
+    "Less",          "LessEqual",
+    "LogicalAnd",    "LogicalOr",
+    "Maximum",       "Minimum",
+    "Mod",           "Mul",
+    "NotEqual",      "Pow",
+    "RealDiv",       "SquaredDifference",
+    "Sub",           "TruncateDiv"};
+
+template <size_t N>
+bool IsOneOf(const std::array<const char*, N>& ops, const string& op) {
+  return absl::c_any_of(ops, [&op](const char* o) { return op == o; });
+}
+
+int Rank(const TensorShapeProto& shape) {
+  return shape.unknown_rank() ? -1 : shape.dim_size();
+}
+
+// A tensor of the vectorized function. A batched tensor holds the values of
+// all elements of the batch stacked along a new leading dimension, while an
+// unbatched tensor holds a single value that is shared by all elements.
+struct VectorizedTensor {
+  string name;
+  bool batched = false;
+  // The shape of the tensor for a single element.
+  PartialTensorShape shape;
+  // The original `Const` node if the tensor is a constant.
+  const NodeDef* constant = nullptr;
+
+  // The rank of the tensor for a single element, or -1 if unknown.
+  int rank() const { return shape.dims(); }
+};
+
+// Records how a node of the original function was converted.
+struct ConvertedNode {
+  // The name of the node of the vectorized function that computes the outputs
+  // of the original node.
+  string name;
+  // Whether the node was wrapped in a `MapDefun`, in which case its outputs
+  // are flattened into the `output` list of the `MapDefun` node.
+  bool map_defun = false;
+  bool batched = false;
+  const NodeDef* constant = nullptr;
+  // The per-element shapes of the outputs of the original node, indexed by
+  // the ranges of its output args.
+  std::vector<PartialTensorShape> output_shapes;
+  NameRangeMap output_ranges;
+};
+
+// Converts a map function into a function that computes the results for a
+// whole batch of elements at once.
+class FunctionVectorizer {
+ public:
+  // `component_shapes` holds the per-element shapes of the components of the
+  // input dataset, which are passed as the leading arguments of `function`.
+  // The remaining arguments are captured inputs. Helper functions that are
+  // needed by the vectorized function are added to `library`.
+  FunctionVectorizer(const FunctionDef& function,
+                     const std::vector<PartialTensorShape>& component_shapes,
+                     FunctionDefLibrary* library)
+      : function_(function),
+        component_shapes_(component_shapes),
+        library_(library) {}
+
+  Status Vectorize(FunctionDef* vectorized) {
+    vectorized_ = vectorized;
+    *vectorized_->mutable_signature() = function_.signature();
+    *vectorized_->mutable_attr() = function_.attr();
+    graph_utils::SetUniqueGraphFunctionName(
+        strings::StrCat("vectorized_", function_.signature().name()), library_,
+        vectorized_);
+
+    const auto& signature = function_.signature();
+    if (signature.input_arg_size() <
+            static_cast<int>(component_shapes_.size()) ||
+        component_shapes_.empty()) {
+      return errors::Unimplemented("The function signature does not match "
+                                   "the input dataset.");
+    }
+    for (int i = 0; i < signature.input_arg_size(); ++i) {
+      const auto& arg = signature.input_arg(i);
+      if (arg.type() == DT_INVALID) {
+        return errors::Unimplemented("Argument ", arg.name(),
+                                     " does not have a fixed type.");
+      }
+      VectorizedTensor& tensor = args_[arg.name()];
+      tensor.name = arg.name();
+      if (i < static_cast<int>(component_shapes_.size())) {
+        tensor.batched = true;
+        tensor.shape = component_shapes_[i];
+      }
+    }
+    for (const auto& arg : signature.output_arg()) {
+      if (arg.type() == DT_INVALID) {
+        return errors::Unimplemented("Output ", arg.name(),
+                                     " does not have a fixed type.");
+      }
+    }
+
+    std::vector<const NodeDef*> nodes;
+    TF_RETURN_IF_ERROR(SortNodes(&nodes));
+    for (const NodeDef* node : nodes) {
+      TF_RETURN_IF_ERROR(ConvertNode(*node));
+    }
+    if (num_converted_ == 0) {
+      return errors::Unimplemented("None of the ops could be vectorized.");
+    }
+
+    for (const auto& arg : signature.output_arg()) {
+      const string* ret = gtl::FindOrNull(function_.ret(), arg.name());
+      if (ret == nullptr) {
+        return errors::Unimplemented("Output ", arg.name(), " is not set.");
+      }
+      VectorizedTensor tensor;
+      TF_RETURN_IF_ERROR(Resolve(*ret, &tensor));
+      if (!tensor.batched) {
+        tensor.name = Broadcast(tensor.name, arg.type());
+      }
+      (*vectorized_->mutable_ret())[arg.name()] = tensor.name;
+    }
+    return Status::OK();
+  }
+
+  // The number of ops that were converted to batched ops.
+  int num_converted() const { return num_converted_; }
+
+  // The number of ops that are applied to each element using `MapDefun`.
+  int num_map_defun() const { return num_map_defun_; }
+
+ private:
+  // Returns the nodes of the function in topological order.
+  Status SortNodes(std::vector<const NodeDef*>* sorted) {
+    absl::flat_hash_map<string, const NodeDef*> nodes;
+    absl::flat_hash_map<string, int> num_pending;
+    absl::flat_hash_map<string, std::vector<const NodeDef*>> consumers;
+    for (const NodeDef& node : function_.node_def()) {
+      nodes[node.name()] = &node;
+    }
+    std::deque<const NodeDef*> ready;
+    for (const NodeDef& node : function_.node_def()) {
+      const OpDef* op_def;
+      if (!OpRegistry::Global()->LookUpOpDef(node.op(), &op_def).ok()) {
+        return errors::Unimplemented("Function calls are not supported: ",
+                                     node.op());
+      }
+      int pending = 0;
+      for (const string& input : node.input()) {
+        if (IsControlInput(input)) {
+          return errors::Unimplemented("Control inputs are not supported.");
+        }
+        function_utils::FunctionDefTensorDesc desc(input);
+        if (input.find(':') != string::npos && nodes.contains(desc.node_name)) {
+          consumers[desc.node_name].push_back(&node);
+          ++pending;
+        }
+      }
+      num_pending[node.name()] = pending;
+      if (pending == 0) ready.push_back(&node);
+    }
+    while (!ready.empty()) {
+      const NodeDef* node = ready.front();
+      ready.pop_front();
+      sorted->push_back(node);
+      for (const NodeDef* consumer : consumers[node->name()]) {
+        if (--num_pending[consumer->name()] == 0) ready.push_back(consumer);
+      }
+    }
+    if (sorted->size() != function_.node_def_size()) {
+      return errors::Unimplemented("The function contains a cycle.");
+    }
+    return Status::OK();
+  }
+
+  Status ConvertNode(const NodeDef& node) {
+    std::vector<VectorizedTensor> inputs(node.input_size());
+    bool any_batched = false;
+    for (int i = 0; i < node.input_size(); ++i) {
+      TF_RETURN_IF_ERROR(Resolve(node.input(i), &inputs[i]));
+      any_batched |= inputs[i].batched;
+    }
+
+    ConvertedNode& converted = converted_[node.name()];
+    TF_RETURN_IF_ERROR(InferOutputShapes(node, inputs, &converted));
+    if (!any_batched) {
+      // The node computes the same value for all elements, so it only needs
+      // to run once per batch.
+      converted.name = CopyNode(node, inputs);
+      if (node.op() == "Const") {
+        converted.constant = &node;
+      }
+      return Status::OK();
+    }
+
+    if (IsOneOf(kUnaryElementwiseOps, node.op()) && inputs.size() == 1) {
+      converted.name = CopyNode(node, inputs);
+      converted.batched = true;
+      ++num_converted_;
+      return Status::OK();
+    }
+    if (IsOneOf(kBinaryElementwiseOps, node.op()) && inputs.size() == 2 &&
+        CanBroadcastBatched(inputs[0], inputs[1])) {
+      converted.name = CopyNode(node, inputs);
+      converted.batched = true;
+      ++num_converted_;
+      return Status::OK();
+    }
+    if (node.op() == "Reshape" && inputs.size() == 2 && inputs[0].batched &&
+        !inputs[1].batched) {
+      converted.name = ConvertReshape(node, inputs);
+      converted.batched = true;
+      ++num_converted_;
+      return Status::OK();
+    }
+    return WrapInMapDefun(node, inputs, &converted);
+  }
+
+  // Infers the per-element shapes of the outputs of `node` from the shapes of
+  // its inputs. Shapes which cannot be inferred are left unknown.
+  Status InferOutputShapes(const NodeDef& node,
+                           const std::vector<VectorizedTensor>& inputs,
+                           ConvertedNode* converted) {
+    const OpRegistrationData* op_reg_data;
+    TF_RETURN_IF_ERROR(OpRegistry::Global()->LookUp(node.op(), &op_reg_data));
+    const OpDef& op_def = op_reg_data->op_def;
+    TF_RETURN_IF_ERROR(
+        NameRangesForNode(node, op_def, nullptr, &converted->output_ranges));
+    DataTypeVector input_types, output_types;
+    TF_RETURN_IF_ERROR(
+        InOutTypesForNode(node, op_def, &input_types, &output_types));
+    converted->output_shapes.assign(output_types.size(), PartialTensorShape());
+    if (op_reg_data->shape_inference_fn == nullptr) {
+      return Status::OK();
+    }
+    std::vector<PartialTensorShape> input_shapes;
+    std::vector<Tensor> constants(inputs.size());
+    std::vector<const Tensor*> input_tensors(inputs.size(), nullptr);
+    for (size_t i = 0; i < inputs.size(); ++i) {
+      input_shapes.push_back(inputs[i].shape);
+      if (inputs[i].constant != nullptr &&
+          constants[i].FromProto(
+              inputs[i].constant->attr().at("value").tensor())) {
+        input_tensors[i] = &constants[i];
+      }
+    }
+    shape_inference::InferenceContext context(
+        TF_GRAPH_DEF_VERSION, node, op_def, input_shapes, input_tensors,
+        /*input_tensors_as_shapes=*/{}, /*input_handle_shapes_and_types=*/{});
+    Status s = context.construction_status();
+    if (s.ok()) {
+      s = context.Run(op_reg_data->shape_inference_fn);
+    }
+    if (!s.ok()) {
+      VLOG(2) << "Cannot infer the shapes of " << node.name() << ": " << s;
+      return Status::OK();
+    }
+    for (int i = 0; i < context.num_outputs() &&
+                    i < static_cast<int>(output_types.size());
+         ++i) {
+      TensorShapeProto shape;
+      context.ShapeHandleToProto(context.output(i), &shape);
+      converted->output_shapes[i] = PartialTensorShape(shape);
+    }
+    return Status::OK();
+  }
+
+  // Returns whether a binary element-wise op can be applied to the batched
+  // operands directly. The batch dimension must not be matched against a
+  // dimension of the other operand when the operands are broadcast.
+  static bool CanBroadcastBatched(const VectorizedTensor& x,
+                                  const VectorizedTensor& y) {
+    if (x.batched && y.batched) return x.rank() >= 0 && x.rank() == y.rank();
+    const VectorizedTensor& batched = x.batched ? x : y;
+    const VectorizedTensor& unbatched = x.batched ? y : x;
+    if (unbatched.rank() == 0) return true;
+    return unbatched.rank() > 0 && batched.rank() >= unbatched.rank();
+  }
+
+  // Looks up the tensor of the vectorized function that corresponds to the
+  // tensor `input` of the original function.
+  Status Resolve(const string& input, VectorizedTensor* tensor) {
+    if (input.find(':') == string::npos) {
+      const VectorizedTensor* arg = gtl::FindOrNull(args_, input);
+      if (arg == nullptr) {
+        return errors::Unimplemented("Unknown function input: ", input);
+      }
+      *tensor = *arg;
+      return Status::OK();
+    }
+    function_utils::FunctionDefTensorDesc desc(input);
+    const ConvertedNode* node = gtl::FindOrNull(converted_, desc.node_name);
+    if (node == nullptr) {
+      return errors::Unimplemented("Unknown function input: ", input);
+    }
+    const int position = std::max(desc.position, 0);
+    const auto* range = gtl::FindOrNull(node->output_ranges, desc.node_output);
+    if (range == nullptr || range->first + position >= range->second) {
+      return errors::Unimplemented("Unknown function input: ", input);
+    }
+    const int index = range->first + position;
+    if (node->map_defun) {
+      tensor->name = strings::StrCat(node->name, ":output:", index);
+    } else {
+      tensor->name =
+          strings::StrCat(node->name, ":", desc.node_output, ":", position);
+    }
+    tensor->batched = node->batched;
+    tensor->shape = node->output_shapes[index];
+    tensor->constant = node->constant;
+    return Status::OK();
+  }
+
+  // Copies `node` into the vectorized function, reading its inputs from
+  // `inputs`, and returns the name of the copy.
+  string CopyNode(const NodeDef& node,
+                  const std::vector<VectorizedTensor>& inputs) {
+    NodeDef* copy = vectorized_->add_node_def();
+    *copy = node;
+    copy->clear_name();
+    function_utils::SetUniqueFunctionNodeName(node.name(), vectorized_, copy);
+    copy->clear_input();
+    for (const VectorizedTensor& input : inputs) {
+      copy->add_input(input.name);
+    }
+    return copy->name();
+  }
+
+  // Adds a node to the vectorized function and returns the name of its first
+  // output.
+  string AddNode(StringPiece op, const string& output,
+                 const std::vector<string>& inputs,
+                 const std::vector<std::pair<string, AttrValue>>& attrs) {
+    NodeDef* node = function_utils::AddNode("", op, inputs, attrs, vectorized_);
+    return strings::StrCat(node->name(), ":", output, ":0");
+  }
+
+  string AddInt32Const(const std::vector<int32>& values, bool scalar) {
+    Tensor tensor(DT_INT32, scalar ? TensorShape({})
+                                   : TensorShape({static_cast<int64_t>(
+                                         values.size())}));
+    for (int i = 0; i < values.size(); ++i) {
+      tensor.flat<int32>()(i) = values[i];
+    }
+    AttrValue value;
+    tensor.AsProtoTensorContent(value.mutable_tensor());
+    return AddNode("Const", "output", {},
+                   {{"dtype", TypeAttr(DT_INT32)}, {"value", value}});
+  }
+
+  static AttrValue TypeAttr(DataType type) {
+    AttrValue value;
+    SetAttrValue(type, &value);
+    return value;
+  }
+
+  static AttrValue IntAttr(int64_t i) {
+    AttrValue value;
+    SetAttrValue(i, &value);
+    return value;
+  }
+
+  // Returns the size of the first dimension of `tensor` as a 1-D tensor.
+  string FirstDim(const string& tensor, DataType type, DataType shape_type) {
+    string shape = AddNode(
+        "Shape", "output", {tensor},
+        {{"T", TypeAttr(type)}, {"out_type", TypeAttr(shape_type)}});
+    string begin = AddInt32Const({0}, /*scalar=*/false);
+    string size = AddInt32Const({1}, /*scalar=*/false);
+    return AddNode(
+        "Slice", "output", {shape, begin, size},
+        {{"T", TypeAttr(shape_type)}, {"Index", TypeAttr(DT_INT32)}});
+  }
+
+  string Concat(const string& x, const string& y, DataType type) {
+    string axis = AddInt32Const({0}, /*scalar=*/true);
+    return AddNode("ConcatV2", "output", {x, y, axis},
+                   {{"N", IntAttr(2)},
+                    {"T", TypeAttr(type)},
+                    {"Tidx", TypeAttr(DT_INT32)}});
+  }
+
+  // Returns a 1-D tensor holding the number of elements in the batch.
+  string BatchSize() {
+    if (batch_size_.empty()) {
+      const auto& arg = function_.signature().input_arg(0);
+      batch_size_ = FirstDim(arg.name(), arg.type(), DT_INT32);
+    }
+    return batch_size_;
+  }
+
+  // Reshapes each element of the batch by keeping the batch dimension and
+  // appending the per-element target shape.
+  string ConvertReshape(const NodeDef& node,
+                        const std::vector<VectorizedTensor>& inputs) {
+    DataType type = node.attr().at("T").type();
+    DataType shape_type = DT_INT32;
+    if (const AttrValue* attr = gtl::FindOrNull(node.attr(), "Tshape")) {
+      shape_type = attr->type();
+    }
+    string shape =
+        Concat(FirstDim(inputs[0].name, type, shape_type), inputs[1].name,
+               shape_type);
+    string reshape = AddNode(
+        "Reshape", "output", {inputs[0].name, shape},
+        {{"T", TypeAttr(type)}, {"Tshape", TypeAttr(shape_type)}});
+    return reshape.substr(0, reshape.find(':'));
+  }
+
+  // Repeats an unbatched tensor once for each element of the batch.
+  string Broadcast(const string& tensor, DataType type) {
+    string expanded = AddNode(
+        "ExpandDims", "output", {tensor, AddInt32Const({0}, /*scalar=*/true)},
+        {{"T", TypeAttr(type)}, {"Tdim", TypeAttr(DT_INT32)}});
+    string shape =
+        AddNode("Shape", "output", {tensor},
+                {{"T", TypeAttr(type)}, {"out_type", TypeAttr(DT_INT32)}});
+    return AddNode("BroadcastTo", "output",
+                   {expanded, Concat(BatchSize(), shape, DT_INT32)},
+                   {{"T", TypeAttr(type)}, {"Tidx", TypeAttr(DT_INT32)}});
+  }
+
+  // Wraps `node` in a function and applies it to each element of the batch
+  // using `MapDefun`. Batched inputs are passed as arguments, unbatched inputs
+  // as captured inputs.
+  Status WrapInMapDefun(const NodeDef& node,
+                        const std::vector<VectorizedTensor>& inputs,
+                        ConvertedNode* converted) {
+    const OpDef* op_def;
+    TF_RETURN_IF_ERROR(OpRegistry::Global()->LookUpOpDef(node.op(), &op_def));
+    DataTypeVector input_types, output_types;
+    TF_RETURN_IF_ERROR(
+        InOutTypesForNode(node, *op_def, &input_types, &output_types));
+    if (output_types.empty()) {
+      return errors::Unimplemented("Op ", node.op(), " has no outputs.");
+    }
+    // `MapDefun` stacks the per-element outputs, so their shapes must be
+    // known and the same for every element.
+    for (const PartialTensorShape& shape : converted->output_shapes) {
+      if (!shape.IsFullyDefined()) {
+        return errors::Unimplemented("Op ", node.op(), " applied per element "
+                                     "does not have static output shapes.");
+      }
+    }
+
+    FunctionDef* function = library_->add_function();
+    graph_utils::SetUniqueGraphFunctionName(
+        strings::StrCat(vectorized_->signature().name(), "_", node.op()),
+        library_, function);
+    NodeDef* body = function->add_node_def();
+    *body = node;
+    body->clear_input();
+    std::vector<string> arguments, captured_inputs;
+    DataTypeVector argument_types, captured_types;
+    for (bool batched : {true, false}) {
+      for (int i = 0; i < inputs.size(); ++i) {
+        if (inputs[i].batched != batched) continue;
+        const string arg = strings::StrCat("arg_", i);
+        function_utils::AddFunctionInput(arg, function, input_types[i]);
+        (batched ? arguments : captured_inputs).push_back(inputs[i].name);
+        (batched ? argument_types : captured_types).push_back(input_types[i]);
+      }
+    }
+    for (int i = 0; i < inputs.size(); ++i) {
+      body->add_input(strings::StrCat("arg_", i));
+    }
+    for (const auto& arg : op_def->output_arg()) {
+      const auto& range = converted->output_ranges.at(arg.name());
+      for (int i = range.first; i < range.second; ++i) {
+        function_utils::AddFunctionOutputWithUniqueName(
+            strings::StrCat("output_", i),
+            strings::StrCat(node.name(), ":", arg.name(), ":", i - range.first),
+            function, output_types[i]);
+      }
+    }
+
+    AttrValue f;
+    f.mutable_func()->set_name(function->signature().name());
+    AttrValue output_shapes_attr, output_types_attr, argument_types_attr,
+        captured_types_attr;
+    SetAttrValue(converted->output_shapes, &output_shapes_attr);
+    SetAttrValue(output_types, &output_types_attr);
+    SetAttrValue(argument_types, &argument_types_attr);
+    SetAttrValue(captured_types, &captured_types_attr);
+    std::vector<string> map_defun_inputs = arguments;
+    map_defun_inputs.insert(map_defun_inputs.end(), captured_inputs.begin(),
+                            captured_inputs.end());
+    NodeDef* map_defun = function_utils::AddNode(
+        "", kMapDefun, map_defun_inputs,
+        {{"Targuments", argument_types_attr},
+         {"Tcaptured", captured_types_attr},
+         {kOutputTypes, output_types_attr},
+         {kOutputShapes, output_shapes_attr},
+         {"f", f},
+         {"max_intra_op_parallelism", IntAttr(1)}},
+        vectorized_);
+    converted->name = map_defun->name();
+    converted->map_defun = true;
+    converted->batched = true;
+    ++num_map_defun_;
+    return Status::OK();
+  }
+
+  const FunctionDef& function_;
+  const std::vector<PartialTensorShape> component_shapes_;
+  FunctionDefLibrary* const library_;
+  FunctionDef* vectorized_ = nullptr;
+  absl::flat_hash_map<string, VectorizedTensor> args_;
+  absl::flat_hash_map<string, ConvertedNode> converted_;
+  string batch_size_;
+  int num_converted_ = 0;
+  int num_map_defun_ = 0;
+};
+
+// Returns the shapes of the elements produced by `node` with a leading batch
+// dimension of size `batch_dim` added.
+AttrValue BatchedShapes(const AttrValue& shapes, int64_t batch_dim) {
+  AttrValue batched;
+  for (const TensorShapeProto& shape : shapes.list().shape()) {
+    TensorShapeProto* batched_shape = batched.mutable_list()->add_shape();
+    if (shape.unknown_rank()) {
+      batched_shape->set_unknown_rank(true);
+      continue;
+    }
+    batched_shape->add_dim()->set_size(batch_dim);
+    for (const auto& dim : shape.dim()) {
+      *batched_shape->add_dim() = dim;
+    }
+  }
+  return batched;
+}
+
+}  // namespace
+
+Status MapVectorization::OptimizeAndCollectStats(Cluster* cluster,
+                                                 const GrapplerItem& item,
+                                                 GraphDef* output,
+                                                 OptimizationStats* stats) {
+  *output = item.graph;
+  MutableGraphView graph(output);
+  absl::flat_hash_set<string> nodes_to_delete;
+  FunctionLibraryDefinition function_library(OpRegistry::Global(),
+                                             item.graph.library());
+
+  for (const NodeDef& node : item.graph.node()) {
+    if (node.op() != kBatchDataset && node.op() != kBatchDatasetV2) {
+      continue;
+    }
+    const NodeDef& batch_node = node;
+    NodeDef* map_node = graph_utils::GetInputNode(batch_node, graph);
+    if (map_node->op() != kMapDataset &&
+        map_node->op() != kParallelMapDatasetV2) {
+      continue;
+    }
+    // The map must not feed any other dataset, since it is removed.
+    if (graph.GetFanouts(*map_node, /*include_controlled_nodes=*/true)
+            .size() != 1) {
+      continue;
+    }
+    const NodeDef* input_node = graph_utils::GetInputNode(*map_node, graph);
+    const AttrValue* input_shapes =
+        gtl::FindOrNull(input_node->attr(), kOutputShapes);
+    const AttrValue* input_types =
+        gtl::FindOrNull(input_node->attr(), kOutputTypes);
+    if (input_shapes == nullptr || input_types == nullptr) continue;
+    const FunctionDef* function =
+        function_library.Find(map_node->attr().at("f").func().name());
+    if (function == nullptr ||
+        function_utils::IsFunctionStateful(function_library, *function)) {
+      continue;
+    }
+
+    // Batching the input fails if its elements have different shapes, even
+    // though the results of the map may batch fine, e.g. when the map reduces
+    // variable-length elements.
+    std::vector<PartialTensorShape> component_shapes;
+    for (const TensorShapeProto& shape : input_shapes->list().shape()) {
+      component_shapes.emplace_back(shape);
+    }
+    if (!absl::c_all_of(component_shapes, [](const PartialTensorShape& shape) {
+          return shape.IsFullyDefined();
+        })) {
+      VLOG(1) << "Not vectorizing map " << map_node->name()
+              << ": the shapes of its input elements are not static.";
+      continue;
+    }
+    // Helper functions are added to a copy of the library so that nothing is
+    // left behind if the function cannot be vectorized.
+    FunctionDefLibrary library = output->library();
+    FunctionDef vectorized_function;
+    FunctionVectorizer vectorizer(*function, component_shapes, &library);
+    Status s = vectorizer.Vectorize(&vectorized_function);
+    if (!s.ok()) {
+      VLOG(1) << "Not vectorizing map " << map_node->name() << ": " << s;
+      continue;
+    }
+    VLOG(1) << "Vectorized map " << map_node->name() << ": "
+            << vectorizer.num_converted() << " ops converted, "
+            << vectorizer.num_map_defun() << " ops applied per element.";
+    *library.add_function() = vectorized_function;
+    *output->mutable_library() = std::move(library);
+
+    // The batch dimension is known statically only if the batch node
+    // inferred it, i.e. when the remainder is dropped.
+    int64_t batch_dim = -1;
+    const AttrValue& batch_shapes = batch_node.attr().at(kOutputShapes);
+    if (batch_shapes.list().shape_size() > 0 &&
+        Rank(batch_shapes.list().shape(0)) > 0) {
+      batch_dim = batch_shapes.list().shape(0).dim(0).size();
+    }
+
+    NodeDef new_batch_node = batch_node;
+    graph_utils::SetUniqueGraphNodeName(batch_node.op(), graph.graph(),
+                                        &new_batch_node);
+    new_batch_node.set_input(0, map_node->input(0));
+    (*new_batch_node.mutable_attr())[kOutputTypes] = *input_types;
+    (*new_batch_node.mutable_attr())[kOutputShapes] =
+        BatchedShapes(*input_shapes, batch_dim);
+    NodeDef* batch = graph.AddNode(std::move(new_batch_node));
+
+    NodeDef new_map_node = *map_node;
+    graph_utils::SetUniqueGraphNodeName(map_node->op(), graph.graph(),
+                                        &new_map_node);
+    new_map_node.set_input(0, batch->name());
+    (*new_map_node.mutable_attr())["f"].mutable_func()->set_name(
+        vectorized_function.signature().name());
+    graph_utils::CopyShapesAndTypesAttrs(batch_node, &new_map_node);
+    NodeDef* map = graph.AddNode(std::move(new_map_node));
+
+    TF_RETURN_IF_ERROR(graph.UpdateFanouts(batch_node.name(), map->name()));
+    nodes_to_delete.insert(map_node->name());
+    nodes_to_delete.insert(batch_node.name());
+    stats->num_changes++;
+  }
+
+  TF_RETURN_IF_ERROR(graph.DeleteNodes(nodes_to_delete));
+  return Status::OK();
+}
+
+REGISTER_GRAPH_OPTIMIZER_AS(MapVectorization, "map_vectorization");
+
+}  // namespace grappler
+}  // namespace tensorflow
@@ -0,0 +1,276 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/grappler/optimizers/data/map_vectorization.h"
+
+#include "tensorflow/core/framework/attr_value_util.h"
+#include "tensorflow/core/framework/function_testlib.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/optimizers/data/function_utils.h"
+#include "tensorflow/core/grappler/optimizers/data/graph_test_utils.h"
+#include "tensorflow/core/grappler/optimizers/data/graph_utils.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+using test::function::NDef;
+
+constexpr char kFunctionName[] = "MapFn";
+
+// Creates a `range -> map(function) -> batch` pipeline where the elements
+// produced by the range have shape `element_shape`.
+GrapplerItem MakeMapAndBatchItem(const FunctionDef& function,
+                                 const PartialTensorShape& element_shape) {
+  GrapplerItem item;
+  item.graph = test::function::GDef(
+      {NDef("start", "Const", {}, {{"value", 0}, {"dtype", DT_INT64}}),
+       NDef("stop", "Const", {}, {{"value", 10}, {"dtype", DT_INT64}}),
+       NDef("step", "Const", {}, {{"value", 1}, {"dtype", DT_INT64}}),
+       NDef("range", "RangeDataset", {"start", "stop", "step"},
+            {{"output_shapes",
+              gtl::ArraySlice<PartialTensorShape>{element_shape}},
+             {"output_types", gtl::ArraySlice<DataType>{DT_INT32}}}),
+       graph_tests_utils::MakeMapNode("map", "range", kFunctionName),
+       NDef("batch_size", "Const", {}, {{"value", 4}, {"dtype", DT_INT64}}),
+       NDef("drop_remainder", "Const", {},
+            {{"value", false}, {"dtype", DT_BOOL}}),
+       graph_tests_utils::MakeBatchV2Node("batch", "map", "batch_size",
+                                          "drop_remainder",
+                                          /*parallel_copy=*/false),
+       NDef("Sink", "Identity", {"batch"}, {})},
+      {function});
+  item.fetch.push_back("Sink");
+  return item;
+}
+
+const FunctionDef* FindVectorizedFunction(const GraphDef& graph) {
+  const NodeDef& map_node =
+      graph.node(graph_utils::FindGraphNodeWithOp("MapDataset", graph));
+  int index = graph_utils::FindGraphFunctionWithName(
+      map_node.attr().at("f").func().name(), graph.library());
+  return index == -1 ? nullptr : &graph.library().function(index);
+}
+
+TEST(MapVectorizationTest, VectorizeElementwiseFunction) {
+  FunctionDef function = FunctionDefHelper::Define(
+      kFunctionName, {"x: int32"}, {"y: int64"}, {},
+      {{{"two"}, "Const", {}, {{"value", 2}, {"dtype", DT_INT32}}},
+       {{"scaled"}, "Mul", {"x", "two"}, {{"T", DT_INT32}}},
+       {{"y"}, "Cast", {"scaled"}, {{"SrcT", DT_INT32}, {"DstT", DT_INT64}}}});
+  GrapplerItem item = MakeMapAndBatchItem(function, PartialTensorShape({3}));
+
+  MapVectorization optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  EXPECT_FALSE(graph_utils::ContainsGraphNodeWithName("map", output));
+  EXPECT_FALSE(graph_utils::ContainsGraphNodeWithName("batch", output));
+  const NodeDef& batch_node =
+      output.node(graph_utils::FindGraphNodeWithOp("BatchDatasetV2", output));
+  const NodeDef& map_node =
+      output.node(graph_utils::FindGraphNodeWithOp("MapDataset", output));
+  EXPECT_EQ(batch_node.input(0), "range");
+  EXPECT_EQ(map_node.input(0), batch_node.name());
+  const NodeDef& sink_node =
+      output.node(graph_utils::FindGraphNodeWithName("Sink", output));
+  EXPECT_EQ(sink_node.input(0), map_node.name());
+
+  const auto& batch_shapes = batch_node.attr().at("output_shapes").list();
+  ASSERT_EQ(batch_shapes.shape_size(), 1);
+  EXPECT_EQ(PartialTensorShape(batch_shapes.shape(0)).DebugString(),
+            "[?,3]");
+
+  const FunctionDef* vectorized = FindVectorizedFunction(output);
+  ASSERT_NE(vectorized, nullptr);
+  EXPECT_NE(vectorized->signature().name(), kFunctionName);
+  EXPECT_TRUE(function_utils::ContainsFunctionNodeWithOp("Mul", *vectorized));
+  EXPECT_TRUE(function_utils::ContainsFunctionNodeWithOp("Cast", *vectorized));
+  EXPECT_FALSE(
+      function_utils::ContainsFunctionNodeWithOp("MapDefun", *vectorized));
+}
+
+TEST(MapVectorizationTest, VectorizeReshape) {
+  FunctionDef function = FunctionDefHelper::Define(
+      kFunctionName, {"x: int32"}, {"y: int32"}, {},
+      {{{"shape"},
+        "Const",
+        {},
+        {{"value", test::AsTensor<int32>({2, 2})}, {"dtype", DT_INT32}}},
+       {{"negated"}, "Neg", {"x"}, {{"T", DT_INT32}}},
+       {{"y"},
+        "Reshape",
+        {"negated", "shape"},
+        {{"T", DT_INT32}, {"Tshape", DT_INT32}}}});
+  GrapplerItem item = MakeMapAndBatchItem(function, PartialTensorShape({4}));
+
+  MapVectorization optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  const FunctionDef* vectorized = FindVectorizedFunction(output);
+  ASSERT_NE(vectorized, nullptr);
+  EXPECT_TRUE(
+      function_utils::ContainsFunctionNodeWithOp("Reshape", *vectorized));
+  EXPECT_TRUE(
+      function_utils::ContainsFunctionNodeWithOp("ConcatV2", *vectorized));
+  EXPECT_FALSE(
+      function_utils::ContainsFunctionNodeWithOp("MapDefun", *vectorized));
+}
+
+TEST(MapVectorizationTest, FallBackToMapDefun) {
+  FunctionDef function = FunctionDefHelper::Define(
+      kFunctionName, {"x: int32"}, {"y: int32"}, {},
+      {{{"squared"}, "Mul", {"x", "x"}, {{"T", DT_INT32}}},
+       {{"y"}, "Cumsum", {"squared", "axis"}, {{"T", DT_INT32}}},
+       {{"axis"}, "Const", {}, {{"value", 0}, {"dtype", DT_INT32}}}});
+  GrapplerItem item = MakeMapAndBatchItem(function, PartialTensorShape({3}));
+
+  MapVectorization optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  const FunctionDef* vectorized = FindVectorizedFunction(output);
+  ASSERT_NE(vectorized, nullptr);
+  EXPECT_TRUE(function_utils::ContainsFunctionNodeWithOp("Mul", *vectorized));
+  EXPECT_FALSE(
+      function_utils::ContainsFunctionNodeWithOp("Cumsum", *vectorized));
+  int index = function_utils::FindFunctionNodeWithOp("MapDefun", *vectorized);
+  ASSERT_NE(index, -1);
+  const NodeDef& map_defun = vectorized->node_def(index);
+  // The batched operand is passed as an argument and the constant axis as a
+  // captured input.
+  EXPECT_EQ(map_defun.attr().at("Targuments").list().type_size(), 1);
+  EXPECT_EQ(map_defun.attr().at("Tcaptured").list().type_size(), 1);
+
+  int fallback_index = graph_utils::FindGraphFunctionWithName(
+      map_defun.attr().at("f").func().name(), output.library());
+  ASSERT_NE(fallback_index, -1);
+  EXPECT_TRUE(function_utils::ContainsFunctionNodeWithOp(
+      "Cumsum", output.library().function(fallback_index)));
+}
+
+TEST(MapVectorizationTest, BroadcastUnbatchedOutput) {
+  FunctionDef function = FunctionDefHelper::Define(
+      kFunctionName, {"x: int32"}, {"y: int32", "z: int32"}, {},
+      {{{"y"}, "Neg", {"x"}, {{"T", DT_INT32}}},
+       {{"z"}, "Const", {}, {{"value", 7}, {"dtype", DT_INT32}}}});
+  GrapplerItem item = MakeMapAndBatchItem(function, PartialTensorShape({}));
+
+  MapVectorization optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  const FunctionDef* vectorized = FindVectorizedFunction(output);
+  ASSERT_NE(vectorized, nullptr);
+  EXPECT_TRUE(
+      function_utils::ContainsFunctionNodeWithOp("BroadcastTo", *vectorized));
+}
+
+TEST(MapVectorizationTest, DoNotVectorizeStatefulFunction) {
+  FunctionDef function = FunctionDefHelper::Define(
+      kFunctionName, {"x: int32"}, {"y: float"}, {},
+      {{{"y"},
+        "RandomUniform",
+        {"x"},
+        {{"T", DT_INT32}, {"dtype", DT_FLOAT}, {"seed", 87654321},
+         {"seed2", 42}}}});
+  function.mutable_signature()->set_is_stateful(true);
+  GrapplerItem item = MakeMapAndBatchItem(function, PartialTensorShape({1}));
+
+  MapVectorization optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  EXPECT_TRUE(graph_utils::ContainsGraphNodeWithName("map", output));
+  EXPECT_TRUE(graph_utils::ContainsGraphNodeWithName("batch", output));
+}
+
+TEST(MapVectorizationTest, DoNotVectorizeWithoutConvertibleOps) {
+  FunctionDef function = FunctionDefHelper::Define(
+      kFunctionName, {"x: int32"}, {"y: int32"}, {},
+      {{{"axis"}, "Const", {}, {{"value", 0}, {"dtype", DT_INT32}}},
+       {{"y"}, "Cumsum", {"x", "axis"}, {{"T", DT_INT32}}}});
+  GrapplerItem item = MakeMapAndBatchItem(function, PartialTensorShape({3}));
+
+  MapVectorization optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  EXPECT_TRUE(graph_utils::ContainsGraphNodeWithName("map", output));
+  EXPECT_TRUE(graph_utils::ContainsGraphNodeWithName("batch", output));
+  EXPECT_EQ(output.library().function_size(), 1);
+}
+
+TEST(MapVectorizationTest, DoNotVectorizeMismatchedRanks) {
+  // Broadcasting a per-element vector against a batched scalar would line up
+  // the batch dimension with the vector dimension.
+  FunctionDef function = FunctionDefHelper::Define(
+      kFunctionName, {"x: int32"}, {"y: int32"}, {},
+      {{{"sum"}, "Sum", {"x", "axis"}, {{"T", DT_INT32}, {"Tidx", DT_INT32}}},
+       {{"axis"}, "Const", {}, {{"value", 0}, {"dtype", DT_INT32}}},
+       {{"y"}, "Sub", {"x", "sum"}, {{"T", DT_INT32}}}});
+  GrapplerItem item = MakeMapAndBatchItem(function, PartialTensorShape({3}));
+
+  MapVectorization optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  EXPECT_TRUE(graph_utils::ContainsGraphNodeWithName("map", output));
+}
+
+TEST(MapVectorizationTest, DoNotVectorizeVariableLengthElements) {
+  // The reduced elements batch fine, but batching the variable-length inputs
+  // before the map would fail.
+  FunctionDef function = FunctionDefHelper::Define(
+      kFunctionName, {"x: int32"}, {"y: int32"}, {},
+      {{{"negated"}, "Neg", {"x"}, {{"T", DT_INT32}}},
+       {{"axis"}, "Const", {}, {{"value", 0}, {"dtype", DT_INT32}}},
+       {{"y"},
+        "Sum",
+        {"negated", "axis"},
+        {{"T", DT_INT32}, {"Tidx", DT_INT32}}}});
+  GrapplerItem item = MakeMapAndBatchItem(function, PartialTensorShape({-1}));
+
+  MapVectorization optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  EXPECT_TRUE(graph_utils::ContainsGraphNodeWithName("map", output));
+  EXPECT_TRUE(graph_utils::ContainsGraphNodeWithName("batch", output));
+  EXPECT_EQ(output.library().function_size(), 1);
+}
+
+TEST(MapVectorizationTest, DoNotFallBackWithoutStaticOutputShapes) {
+  // The length of the outputs of `Unique` depends on the element, so they
+  // cannot be stacked by `MapDefun`.
+  FunctionDef function = FunctionDefHelper::Define(
+      kFunctionName, {"x: int32"}, {"y: int32"}, {},
+      {{{"negated"}, "Neg", {"x"}, {{"T", DT_INT32}}},
+       {{"y"},
+        "Unique",
+        {"negated"},
+        {{"T", DT_INT32}, {"out_idx", DT_INT32}}}});
+  GrapplerItem item = MakeMapAndBatchItem(function, PartialTensorShape({3}));
+
+  MapVectorization optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+  EXPECT_TRUE(graph_utils::ContainsGraphNodeWithName("map", output));
+  EXPECT_TRUE(graph_utils::ContainsGraphNodeWithName("batch", output));
+  EXPECT_EQ(output.library().function_size(), 1);
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
@@ -82,6 +82,8 @@ class BatchDatasetOp::Dataset : public DatasetBase {
             PartialTensorShape({-1}).Concatenate(input_shape));
       }
     }
+    batch_in_place_ = CanBatchInPlace(input_, batch_size_, drop_remainder_,
+                                      parallel_copy_);
   }
 
   ~Dataset() override { input_->Unref(); }
@@ -179,6 +181,9 @@ class BatchDatasetOp::Dataset : public DatasetBase {
     Status GetNextInternal(IteratorContext* ctx,
                            std::vector<Tensor>* out_tensors,
                            bool* end_of_sequence) override {
+      if (dataset()->batch_in_place_) {
+        return GetNextInPlace(ctx, out_tensors, end_of_sequence);
+      }
       // Each row of `batch_elements` is a tuple of tensors from the
       // input iterator.
       std::vector<std::vector<Tensor>> batch_elements;
@@ -262,6 +267,40 @@ class BatchDatasetOp::Dataset : public DatasetBase {
     }
 
    private:
+    // Preallocates the batch and has the input iterator write each element
+    // into its slice, so that elements are not held until the batch is
+    // complete and then copied.
+    Status GetNextInPlace(IteratorContext* ctx,
+                          std::vector<Tensor>* out_tensors,
+                          bool* end_of_sequence) {
+      std::vector<Tensor> batch;
+      int64_t num_elements = 0;
+      {
+        mutex_lock l(mu_);
+        if (!input_impl_) {
+          *end_of_sequence = true;
+          return Status::OK();
+        }
+        TF_RETURN_IF_ERROR(AllocateBatch(
+            CopyBatchParams(ctx), dataset()->batch_size_,
+            dataset()->input_->output_dtypes(),
+            dataset()->input_->output_shapes(), &batch));
+        bool end_of_input = false;
+        while (num_elements < dataset()->batch_size_ && !end_of_input) {
+          TF_RETURN_IF_ERROR(input_impl_->GetNextIntoSlice(
+              ctx, num_elements, &batch, &end_of_input));
+          if (!end_of_input) {
+            ++num_elements;
+          } else {
+            input_impl_.reset();
+          }
+        }
+      }
+      return ProcessBatch(dataset()->batch_size_, num_elements,
+                          dataset()->drop_remainder_, Status::OK(), ctx,
+                          out_tensors, end_of_sequence, &batch);
+    }
+
     mutex mu_;
     std::unique_ptr<IteratorBase> input_impl_ TF_GUARDED_BY(mu_);
   };
@@ -272,6 +311,8 @@ class BatchDatasetOp::Dataset : public DatasetBase {
   const bool parallel_copy_;
   const DatasetBase* const input_;
   const int op_version_;
+  // Whether batches are assembled with `GetNextInPlace()`.
+  bool batch_in_place_ = false;
   std::vector<PartialTensorShape> output_shapes_;
   const TraceMeMetadata traceme_metadata_;
 };
@@ -105,7 +105,45 @@ BatchDatasetParams BatchDatasetParams7() {
                             /*node_name=*/kNodeName);
 }
 
-// Test Case 8: test BatchDatasetV2 with an invalid batch size
+// Test Case 8: test BatchDatasetV2 with an input that writes its elements
+// directly into the batch, and a batch size that can not evenly split the input
+// dataset.
+BatchDatasetParams BatchDatasetParams8() {
+  auto tensor_slice_dataset_params = TensorSliceDatasetParams(
+      /*components=*/{CreateTensor<int64_t>(TensorShape{5, 2},
+                                            {0, 1, 2, 3, 4, 5, 6, 7, 8, 9})},
+      /*node_name=*/"tensor_slice");
+  return BatchDatasetParams(tensor_slice_dataset_params,
+                            /*batch_size=*/2,
+                            /*drop_remainder=*/false,
+                            /*parallel_copy=*/false,
+                            /*output_dtypes=*/{DT_INT64},
+                            /*output_shapes=*/{PartialTensorShape({-1, 2})},
+                            /*node_name=*/kNodeName);
+}
+
+// Test Case 9: test BatchDatasetV2 with a take that forwards the writes of its
+// input into the batch, and drops the remainder.
+BatchDatasetParams BatchDatasetParams9() {
+  auto tensor_slice_dataset_params = TensorSliceDatasetParams(
+      /*components=*/{CreateTensor<int64_t>(TensorShape{5, 2},
+                                            {0, 1, 2, 3, 4, 5, 6, 7, 8, 9})},
+      /*node_name=*/"tensor_slice");
+  auto take_dataset_params =
+      TakeDatasetParams(std::move(tensor_slice_dataset_params), /*count=*/3,
+                        /*output_dtypes=*/{DT_INT64},
+                        /*output_shapes=*/{PartialTensorShape({2})},
+                        /*node_name=*/"take");
+  return BatchDatasetParams(std::move(take_dataset_params),
+                            /*batch_size=*/2,
+                            /*drop_remainder=*/true,
+                            /*parallel_copy=*/false,
+                            /*output_dtypes=*/{DT_INT64},
+                            /*output_shapes=*/{PartialTensorShape({2, 2})},
+                            /*node_name=*/kNodeName);
+}
+
+// Test Case 10: test BatchDatasetV2 with an invalid batch size
 BatchDatasetParams InvalidBatchSizeBatchDatasetParams() {
   return BatchDatasetParams(RangeDatasetParams(0, 10, 1),
                             /*batch_size=*/-1,
@@ -143,7 +181,15 @@ std::vector<GetNextTestCase<BatchDatasetParams>> GetNextTestCases() {
                                   {{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}})},
 
           {/*dataset_params=*/BatchDatasetParams7(),
-           /*expected_outputs=*/{}}};
+           /*expected_outputs=*/{}},
+          {/*dataset_params=*/BatchDatasetParams8(),
+           /*expected_outputs=*/
+           {CreateTensor<int64_t>(TensorShape({2, 2}), {0, 1, 2, 3}),
+            CreateTensor<int64_t>(TensorShape({2, 2}), {4, 5, 6, 7}),
+            CreateTensor<int64_t>(TensorShape({1, 2}), {8, 9})}},
+          {/*dataset_params=*/BatchDatasetParams9(),
+           /*expected_outputs=*/
+           {CreateTensor<int64_t>(TensorShape({2, 2}), {0, 1, 2, 3})}}};
 }
 
 ITERATOR_GET_NEXT_TEST_P(BatchDatasetOpTest, BatchDatasetParams,
@@ -28,6 +28,7 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 
 namespace tensorflow {
@@ -59,6 +60,8 @@ constexpr char kCacheCompleted[] = "cache_completed";
 constexpr char kIndex[] = "index";
 constexpr char kImpl[] = "Impl";
 constexpr char kCacheDataset[] = "CacheDataset";
+constexpr char kTieredDatasetPrefix[] = "Tiered";
+constexpr char kCacheWriter[] = "cache_writer";
 constexpr char kIncompleteCacheErrorMessage[] =
     "The calling iterator did not fully read the dataset being cached. In "
     "order to avoid unexpected truncation of the dataset, the partially cached "
@@ -1020,6 +1023,330 @@ class CacheDatasetOp::MemoryDatasetV2
   ResourceMgr* const resource_mgr_;  // Not owned.
 };
 
+// This version of the in-memory cache holds up to a byte budget of elements in
+// memory and spills the others to a local file. Like `MemoryDataset`, the cache
+// is shared across the iterations of the `repeat` transformation, and
+// checkpoints hold the cached elements, including the spilled ones.
+class CacheDatasetOp::TieredDataset : public DatasetBase {
+ public:
+  TieredDataset(OpKernelContext* ctx, const DatasetBase* input,
+                TieredCache::Options options,
+                absl::optional<Tensor> resource_handle)
+      : DatasetBase(DatasetContext(ctx)),
+        input_(input),
+        cache_(std::make_shared<TieredCache>(ctx->env(), std::move(options))),
+        resource_handle_(std::move(resource_handle)) {
+    input_->Ref();
+  }
+
+  ~TieredDataset() override { input_->Unref(); }
+
+  std::unique_ptr<IteratorBase> MakeIteratorInternal(
+      const string& prefix) const override {
+    name_utils::IteratorPrefixParams params;
+    params.dataset_prefix = kTieredDatasetPrefix;
+    return absl::make_unique<TieredIterator>(TieredIterator::Params{
+        this, name_utils::IteratorPrefix(kDatasetType, prefix, params)});
+  }
+
+  const DataTypeVector& output_dtypes() const override {
+    return input_->output_dtypes();
+  }
+
+  const std::vector<PartialTensorShape>& output_shapes() const override {
+    return input_->output_shapes();
+  }
+
+  string DebugString() const override {
+    name_utils::DatasetDebugStringParams params;
+    params.dataset_prefix = kTieredDatasetPrefix;
+    return name_utils::DatasetDebugString(kDatasetType, params);
+  }
+
+  int64_t Cardinality() const override { return input_->Cardinality(); }
+
+  Status InputDatasets(std::vector<const DatasetBase*>* inputs) const override {
+    inputs->push_back(input_);
+    return Status::OK();
+  }
+
+  Status CheckExternalState() const override {
+    return input_->CheckExternalState();
+  }
+
+ protected:
+  Status AsGraphDefInternal(SerializationContext* ctx,
+                            DatasetGraphDefBuilder* b,
+                            Node** output) const override {
+    Node* input_node = nullptr;
+    TF_RETURN_IF_ERROR(b->AddInputDataset(ctx, input_, &input_node));
+    Node* filename_node = nullptr;
+    TF_RETURN_IF_ERROR(b->AddScalar(tstring(""), &filename_node));
+    if (!resource_handle_.has_value()) {
+      return b->AddDataset(this, {input_node, filename_node}, output);
+    }
+    Node* resource_handle_node = nullptr;
+    TF_RETURN_IF_ERROR(b->AddTensor(*resource_handle_, &resource_handle_node));
+    return b->AddDataset(
+        this, {input_node, filename_node, resource_handle_node}, output);
+  }
+
+ private:
+  class TieredIterator : public DatasetIterator<TieredDataset> {
+   public:
+    explicit TieredIterator(const Params& params)
+        : DatasetIterator<TieredDataset>(params) {}
+
+    Status Initialize(IteratorContext* ctx) override {
+      mutex_lock l(mu_);
+      return InitializeIterator(ctx);
+    }
+
+    Status GetNextInternal(IteratorContext* ctx,
+                           std::vector<Tensor>* out_tensors,
+                           bool* end_of_sequence) override {
+      mutex_lock l(mu_);
+      return iterator_->GetNext(ctx, out_tensors, end_of_sequence);
+    }
+
+   protected:
+    std::shared_ptr<model::Node> CreateNode(
+        IteratorContext* ctx, model::Node::Args args) const override {
+      return model::MakeKnownRatioNode(std::move(args),
+                                       /*ratio=*/1);
+    }
+
+    // Like `MemoryIterator`, the checkpoint holds the contents of a completed
+    // cache, including the elements spilled to disk.
+    Status SaveInternal(SerializationContext* ctx,
+                        IteratorStateWriter* writer) override {
+      mutex_lock l(mu_);
+      TieredCache* cache = dataset()->cache_.get();
+      if (cache->IsCompleted()) {
+        TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kCacheCompleted), ""));
+        std::vector<std::vector<Tensor>> elements;
+        TF_RETURN_IF_ERROR(cache->ReadElements(&elements));
+        TF_RETURN_IF_ERROR(
+            WriteElementsToCheckpoint(writer, prefix(), elements));
+      }
+      return SaveInput(ctx, writer, iterator_);
+    }
+
+    Status RestoreInternal(IteratorContext* ctx,
+                           IteratorStateReader* reader) override {
+      mutex_lock l(mu_);
+      iterator_.reset();
+      TieredCache* cache = dataset()->cache_.get();
+      cache->Reset();
+      if (reader->Contains(full_name(kCacheCompleted))) {
+        std::vector<std::vector<Tensor>> elements;
+        TF_RETURN_IF_ERROR(
+            ReadElementsFromCheckpoint(ctx, reader, prefix(), &elements));
+        int64_t writer_id;
+        if (!cache->ClaimWriter(&writer_id)) {
+          return errors::FailedPrecondition(
+              "Failed to restore the tiered cache: it is being populated by "
+              "another iterator.");
+        }
+        for (const auto& element : elements) {
+          bool in_memory;
+          TF_RETURN_IF_ERROR(cache->Append(element, &in_memory));
+        }
+        TF_RETURN_IF_ERROR(cache->Complete());
+      }
+      TF_RETURN_IF_ERROR(InitializeIterator(ctx));
+      return RestoreInput(ctx, reader, iterator_);
+    }
+
+   private:
+    class TieredWriterIterator : public DatasetIterator<TieredDataset> {
+     public:
+      explicit TieredWriterIterator(const Params& params)
+          : DatasetIterator<TieredDataset>(params) {}
+
+      ~TieredWriterIterator() override {
+        mutex_lock l(mu_);
+        // The cache may have been reset and claimed by another writer since,
+        // e.g. when this iterator is replaced by one restored from a
+        // checkpoint.
+        if (writer_ && dataset()->cache_->AbandonWriter(writer_id_)) {
+          LOG(WARNING) << kIncompleteCacheErrorMessage;
+        }
+      }
+
+      Status Initialize(IteratorContext* ctx) override {
+        mutex_lock l(mu_);
+        // Only one iterator populates the cache. Concurrent iterators read
+        // their input without caching it.
+        writer_ = dataset()->cache_->ClaimWriter(&writer_id_);
+        return dataset()->input_->MakeIterator(ctx, this, prefix(),
+                                               &input_impl_);
+      }
+
+      Status GetNextInternal(IteratorContext* ctx,
+                             std::vector<Tensor>* out_tensors,
+                             bool* end_of_sequence) override {
+        mutex_lock l(mu_);
+        TF_RETURN_IF_ERROR(
+            input_impl_->GetNext(ctx, out_tensors, end_of_sequence));
+        if (!writer_) {
+          return Status::OK();
+        }
+        TieredCache* cache = dataset()->cache_.get();
+        if (*end_of_sequence) {
+          if (!cache->IsCompleted()) {
+            VLOG(2) << "Finalizing the cache because EOF has been reached.";
+            TF_RETURN_IF_ERROR(cache->Complete());
+          }
+          return Status::OK();
+        }
+        return Append(ctx, *out_tensors);
+      }
+
+     protected:
+      std::shared_ptr<model::Node> CreateNode(
+          IteratorContext* ctx, model::Node::Args args) const override {
+        return model::MakeKnownRatioNode(std::move(args),
+                                         /*ratio=*/1);
+      }
+
+      Status SaveInternal(SerializationContext* ctx,
+                          IteratorStateWriter* writer) override {
+        mutex_lock l(mu_);
+        TieredCache* cache = dataset()->cache_.get();
+        if (writer_ && !cache->IsCompleted()) {
+          TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kCacheWriter), ""));
+          std::vector<std::vector<Tensor>> elements;
+          TF_RETURN_IF_ERROR(cache->ReadElements(&elements));
+          TF_RETURN_IF_ERROR(
+              WriteElementsToCheckpoint(writer, prefix(), elements));
+        }
+        return SaveInput(ctx, writer, input_impl_);
+      }
+
+      Status RestoreInternal(IteratorContext* ctx,
+                             IteratorStateReader* reader) override {
+        mutex_lock l(mu_);
+        if (reader->Contains(full_name(kCacheWriter))) {
+          if (!writer_) {
+            return errors::FailedPrecondition(
+                "Failed to restore the tiered cache: it is being populated "
+                "by another iterator.");
+          }
+          std::vector<std::vector<Tensor>> elements;
+          TF_RETURN_IF_ERROR(
+              ReadElementsFromCheckpoint(ctx, reader, prefix(), &elements));
+          for (const auto& element : elements) {
+            TF_RETURN_IF_ERROR(Append(ctx, element));
+          }
+        }
+        return RestoreInput(ctx, reader, input_impl_);
+      }
+
+     private:
+      Status Append(IteratorContext* ctx, const std::vector<Tensor>& element)
+          TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        TieredCache* cache = dataset()->cache_.get();
+        bool in_memory;
+        TF_RETURN_IF_ERROR(cache->Append(element, &in_memory));
+        if (in_memory) {
+          RecordBufferEnqueue(ctx, element);
+        }
+        if (cache->size() == dataset()->input_->Cardinality()) {
+          VLOG(2) << "Finalizing the cache because its size matches the "
+                     "expected input cardinality.";
+          TF_RETURN_IF_ERROR(cache->Complete());
+        }
+        return Status::OK();
+      }
+
+      mutex mu_;
+      std::unique_ptr<IteratorBase> input_impl_ TF_GUARDED_BY(mu_);
+      bool writer_ TF_GUARDED_BY(mu_) = false;
+      int64_t writer_id_ TF_GUARDED_BY(mu_) = 0;
+    };  // TieredWriterIterator
+
+    class TieredReaderIterator : public DatasetIterator<TieredDataset> {
+     public:
+      explicit TieredReaderIterator(const Params& params)
+          : DatasetIterator<TieredDataset>(params) {}
+
+      Status Initialize(IteratorContext* ctx) override {
+        mutex_lock l(mu_);
+        return dataset()->cache_->NewReader(&reader_);
+      }
+
+      Status GetNextInternal(IteratorContext* ctx,
+                             std::vector<Tensor>* out_tensors,
+                             bool* end_of_sequence) override {
+        mutex_lock l(mu_);
+        if (index_ >= dataset()->cache_->size()) {
+          *end_of_sequence = true;
+          return Status::OK();
+        }
+        TF_RETURN_IF_ERROR(reader_->Read(index_, out_tensors));
+        index_++;
+        *end_of_sequence = false;
+        return Status::OK();
+      }
+
+     protected:
+      std::shared_ptr<model::Node> CreateNode(
+          IteratorContext* ctx, model::Node::Args args) const override {
+        return model::MakeKnownRatioNode(std::move(args),
+                                         /*ratio=*/1);
+      }
+
+      Status SaveInternal(SerializationContext* ctx,
+                          IteratorStateWriter* writer) override {
+        mutex_lock l(mu_);
+        TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kIndex), index_));
+        return Status::OK();
+      }
+
+      Status RestoreInternal(IteratorContext* ctx,
+                             IteratorStateReader* reader) override {
+        mutex_lock l(mu_);
+        // kIndex will not be set if we are restoring from a checkpoint
+        // written by a TieredWriterIterator that has completed its cache.
+        int64_t temp = dataset()->cache_->size();
+        if (reader->Contains(full_name(kIndex))) {
+          TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kIndex), &temp));
+        }
+        index_ = static_cast<size_t>(temp);
+        return Status::OK();
+      }
+
+     private:
+      mutex mu_;
+      std::unique_ptr<TieredCache::Reader> reader_ TF_GUARDED_BY(mu_);
+      size_t index_ TF_GUARDED_BY(mu_) = 0;
+    };  // TieredReaderIterator
+
+    Status InitializeIterator(IteratorContext* ctx)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      if (dataset()->cache_->IsCompleted()) {
+        iterator_ = absl::make_unique<TieredReaderIterator>(
+            TieredReaderIterator::Params{dataset(),
+                                         strings::StrCat(prefix(), kImpl)});
+      } else {
+        iterator_ = absl::make_unique<TieredWriterIterator>(
+            TieredWriterIterator::Params{dataset(),
+                                         strings::StrCat(prefix(), kImpl)});
+      }
+      TF_RETURN_IF_ERROR(iterator_->InitializeBase(ctx, this));
+      return iterator_->Initialize(ctx);
+    }
+
+    mutex mu_;
+    std::unique_ptr<IteratorBase> iterator_ TF_GUARDED_BY(mu_);
+  };  // TieredIterator
+
+  const DatasetBase* const input_;
+  const std::shared_ptr<TieredCache> cache_;
+  const absl::optional<Tensor> resource_handle_;
+};  // TieredDataset
+
 CacheDatasetOp::CacheDatasetOp(OpKernelConstruction* ctx)
     : UnaryDatasetOpKernel(ctx),
       op_version_(ctx->def().op() == kCacheDataset ? 1 : 2) {}
@@ -1029,7 +1356,25 @@ void CacheDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
   // Parse out the filenames tensor.
   tstring filename;
   OP_REQUIRES_OK(ctx, ParseScalarArgument<tstring>(ctx, kFileName, &filename));
-  if (filename.empty()) {
+  int64_t memory_budget_mb;
+  OP_REQUIRES_OK(ctx, ReadInt64FromEnvVar("TF_DATA_CACHE_MEMORY_BUDGET_MB",
+                                          /*default_val=*/0,
+                                          &memory_budget_mb));
+  if (filename.empty() && memory_budget_mb > 0) {
+    TieredCache::Options options;
+    options.memory_budget_bytes = memory_budget_mb << 20;
+    OP_REQUIRES_OK(ctx, ReadBoolFromEnvVar("TF_DATA_CACHE_COMPRESS",
+                                           /*default_val=*/false,
+                                           &options.compress));
+    OP_REQUIRES(ctx, ctx->env()->LocalTempFilename(&options.spill_filename),
+                errors::Internal("Failed to create a cache spill file name."));
+    absl::optional<Tensor> resource_handle;
+    if (op_version_ == 2) {
+      resource_handle = ctx->input(2);
+    }
+    *output = new TieredDataset(ctx, input, std::move(options),
+                                std::move(resource_handle));
+  } else if (filename.empty()) {
     static std::atomic<int64_t> resource_id_counter(0);
     const string& container = ctx->resource_manager()->default_container();
     auto name = strings::StrCat(ctx->op_kernel().name(), "/", kMemoryCache, "_",
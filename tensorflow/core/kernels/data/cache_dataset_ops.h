@@ -42,6 +42,7 @@ class CacheDatasetOp : public UnaryDatasetOpKernel {
   class FileDatasetV2;
   class MemoryDataset;
   class MemoryDatasetV2;
+  class TieredDataset;
 
   const int op_version_;
 };
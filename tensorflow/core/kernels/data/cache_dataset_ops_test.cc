@@ -11,12 +11,14 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/cache_dataset_ops.h"
 
+#include <numeric>
 #include <string>
 #include <utility>
 
 #include "tensorflow/core/data/dataset_test_base.h"
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/data/serialization_utils.h"
+#include "tensorflow/core/kernels/data/cache_ops.h"
 #include "tensorflow/core/platform/path.h"
 
 namespace tensorflow {
@@ -370,6 +372,166 @@ INSTANTIATE_TEST_CASE_P(CacheDatasetOpTest,
                         ParameterizedIteratorSaveAndRestoreTest,
                         ::testing::ValuesIn(IteratorSaveAndRestoreTestCases()));
 
+TEST_F(CacheDatasetOpTest, TieredCache) {
+  // Each element is 512KB, so two of them fit in the budget and the other two
+  // are spilled to disk.
+  constexpr int kElementSize = 64 << 10;
+  constexpr int kNumElements = 4;
+  std::vector<int64_t> values(kNumElements * kElementSize);
+  std::iota(values.begin(), values.end(), 0);
+  auto tensor_slice_dataset_params = TensorSliceDatasetParams(
+      /*components=*/{CreateTensor<int64_t>(
+          TensorShape{kNumElements, kElementSize}, values)},
+      /*node_name=*/"tensor_slice");
+  CacheDatasetParams dataset_params(
+      std::move(tensor_slice_dataset_params),
+      /*filename=*/"",
+      /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({kElementSize})}, kNodeName);
+  setenv("TF_DATA_CACHE_MEMORY_BUDGET_MB", "1", /*overwrite=*/1);
+  Status s = Initialize(dataset_params);
+  unsetenv("TF_DATA_CACHE_MEMORY_BUDGET_MB");
+  TF_ASSERT_OK(s);
+  // Releases the cache writer claimed by the initial iterator.
+  iterator_.reset();
+
+  std::vector<Tensor> expected_outputs;
+  for (int i = 0; i < kNumElements; ++i) {
+    expected_outputs.push_back(CreateTensor<int64_t>(
+        TensorShape({kElementSize}),
+        std::vector<int64_t>(values.begin() + i * kElementSize,
+                             values.begin() + (i + 1) * kElementSize)));
+  }
+  // Checkpoints taken while the cache is populated hold the elements cached
+  // so far, from both tiers, and the checkpoint taken at the end holds the
+  // completed cache.
+  TF_ASSERT_OK(CheckIteratorSaveAndRestore(dataset_params.iterator_prefix(),
+                                           expected_outputs,
+                                           /*breakpoints=*/{0, 2, 4, 6},
+                                           /*compare_order=*/true));
+
+  // The other epochs read from the restored cache.
+  for (int epoch = 0; epoch < 2; ++epoch) {
+    TF_ASSERT_OK(dataset_->MakeIterator(
+        iterator_ctx_.get(), /*parent=*/nullptr,
+        dataset_params.iterator_prefix(), &iterator_));
+    bool end_of_sequence = false;
+    std::vector<Tensor> out_tensors;
+    while (!end_of_sequence) {
+      std::vector<Tensor> next;
+      TF_ASSERT_OK(
+          iterator_->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+      out_tensors.insert(out_tensors.end(), next.begin(), next.end());
+    }
+    TF_EXPECT_OK(ExpectEqual(out_tensors, expected_outputs,
+                             /*compare_order=*/true));
+  }
+  iterator_.reset();
+  TF_ASSERT_OK(CheckIteratorSaveAndRestore(dataset_params.iterator_prefix(),
+                                           expected_outputs,
+                                           /*breakpoints=*/{0, 1, 6},
+                                           /*compare_order=*/true));
+}
+
+class TieredCacheTest : public DatasetOpsTestBase,
+                        public ::testing::WithParamInterface<bool> {};
+
+TEST_P(TieredCacheTest, SpillsElementsOverBudget) {
+  Env* env = Env::Default();
+  TieredCache::Options options;
+  options.compress = GetParam();
+  options.read_ahead_chunk_size = 64;
+  ASSERT_TRUE(env->LocalTempFilename(&options.spill_filename));
+  std::vector<std::vector<Tensor>> elements;
+  for (int i = 0; i < 10; ++i) {
+    elements.push_back({CreateTensor<int64_t>(TensorShape({4}), {i, i, i, i}),
+                        CreateTensor<tstring>(TensorShape({}), {"abc"})});
+  }
+
+  // Measure the footprint of a single element in each tier.
+  bool in_memory;
+  int64_t writer_id;
+  options.memory_budget_bytes = 1 << 20;
+  TieredCache memory_cache(env, options);
+  ASSERT_TRUE(memory_cache.ClaimWriter(&writer_id));
+  EXPECT_FALSE(memory_cache.ClaimWriter(&writer_id));
+  TF_ASSERT_OK(memory_cache.Append(elements[0], &in_memory));
+  EXPECT_TRUE(in_memory);
+  const int64_t element_memory_bytes = memory_cache.memory_bytes();
+  EXPECT_GT(element_memory_bytes, 0);
+  EXPECT_EQ(memory_cache.disk_bytes(), 0);
+
+  // A writer can only abandon the cache while it still populates it.
+  const int64_t stale_writer_id = writer_id;
+  memory_cache.Reset();
+  ASSERT_TRUE(memory_cache.ClaimWriter(&writer_id));
+  TF_ASSERT_OK(memory_cache.Append(elements[0], &in_memory));
+  EXPECT_FALSE(memory_cache.AbandonWriter(stale_writer_id));
+  EXPECT_EQ(memory_cache.size(), 1);
+  EXPECT_TRUE(memory_cache.AbandonWriter(writer_id));
+  EXPECT_EQ(memory_cache.size(), 0);
+
+  options.memory_budget_bytes = 1;
+  TieredCache disk_cache(env, options);
+  ASSERT_TRUE(disk_cache.ClaimWriter(&writer_id));
+  TF_ASSERT_OK(disk_cache.Append(elements[0], &in_memory));
+  EXPECT_FALSE(in_memory);
+  EXPECT_EQ(disk_cache.memory_bytes(), 0);
+  EXPECT_GT(disk_cache.disk_bytes(), 0);
+  std::unique_ptr<TieredCache::Reader> reader;
+  EXPECT_TRUE(errors::IsFailedPrecondition(disk_cache.NewReader(&reader)));
+  TF_ASSERT_OK(disk_cache.Complete());
+  EXPECT_FALSE(disk_cache.ClaimWriter(&writer_id));
+  TF_ASSERT_OK(env->FileExists(options.spill_filename));
+  disk_cache.Reset();
+  EXPECT_TRUE(errors::IsNotFound(env->FileExists(options.spill_filename)));
+  EXPECT_EQ(disk_cache.disk_bytes(), 0);
+
+  // Leave room for four elements in memory; the rest go to disk.
+  options.memory_budget_bytes = 4 * element_memory_bytes;
+  TieredCache cache(env, options);
+  ASSERT_TRUE(cache.ClaimWriter(&writer_id));
+  int num_in_memory = 0;
+  for (const auto& element : elements) {
+    TF_ASSERT_OK(cache.Append(element, &in_memory));
+    num_in_memory += in_memory;
+  }
+  TF_ASSERT_OK(cache.Complete());
+  // Compressed sizes vary slightly with the contents of the elements.
+  EXPECT_GT(num_in_memory, 0);
+  EXPECT_LT(num_in_memory, elements.size());
+  EXPECT_LE(cache.memory_bytes(), options.memory_budget_bytes);
+  EXPECT_GT(cache.disk_bytes(), 0);
+  EXPECT_EQ(cache.size(), elements.size());
+
+  // Readers are independent, and support non-sequential reads.
+  std::unique_ptr<TieredCache::Reader> reader1, reader2;
+  TF_ASSERT_OK(cache.NewReader(&reader1));
+  TF_ASSERT_OK(cache.NewReader(&reader2));
+  for (int i = 0; i < elements.size(); ++i) {
+    for (TieredCache::Reader* r : {reader1.get(), reader2.get()}) {
+      std::vector<Tensor> element;
+      TF_ASSERT_OK(r->Read(i, &element));
+      TF_EXPECT_OK(ExpectEqual(element, elements[i], /*compare_order=*/true));
+    }
+  }
+  std::vector<Tensor> element;
+  TF_ASSERT_OK(reader1->Read(7, &element));
+  TF_EXPECT_OK(ExpectEqual(element, elements[7], /*compare_order=*/true));
+  TF_ASSERT_OK(reader1->Read(2, &element));
+  TF_EXPECT_OK(ExpectEqual(element, elements[2], /*compare_order=*/true));
+  TF_ASSERT_OK(reader1->Read(5, &element));
+  TF_EXPECT_OK(ExpectEqual(element, elements[5], /*compare_order=*/true));
+  EXPECT_TRUE(errors::IsOutOfRange(reader1->Read(elements.size(), &element)));
+  reader1.reset();
+  reader2.reset();
+  cache.Reset();
+  EXPECT_TRUE(errors::IsNotFound(env->FileExists(options.spill_filename)));
+}
+
+INSTANTIATE_TEST_SUITE_P(TieredCacheTest, TieredCacheTest,
+                         ::testing::Bool());
+
 }  // namespace
 }  // namespace data
 }  // namespace tensorflow
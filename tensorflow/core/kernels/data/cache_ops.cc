@@ -14,8 +14,10 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/cache_ops.h"
 
+#include "tensorflow/core/data/compression_utils.h"
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/tensor.h"
@@ -28,6 +30,16 @@ namespace data {
 namespace {
 
 constexpr char kMemoryCache[] = "MemoryCache";
+constexpr char kMemoryTier[] = "memory";
+constexpr char kDiskTier[] = "disk";
+
+int64_t ElementBytes(const std::vector<Tensor>& element) {
+  int64_t bytes = 0;
+  for (const Tensor& tensor : element) {
+    bytes += tensor.TotalBytes();
+  }
+  return bytes;
+}
 
 }  // namespace
 
@@ -68,6 +80,239 @@ const std::vector<std::vector<Tensor>>& MemoryCache::data() {
   return cache_;
 }
 
+TieredCache::TieredCache(Env* env, Options options)
+    : env_(env), options_(std::move(options)) {}
+
+TieredCache::~TieredCache() {
+  mutex_lock l(mu_);
+  ResetLocked();
+}
+
+bool TieredCache::ClaimWriter(int64_t* writer_id) {
+  mutex_lock l(mu_);
+  if (completed_ || writer_claimed_) {
+    return false;
+  }
+  writer_claimed_ = true;
+  *writer_id = ++writer_id_;
+  return true;
+}
+
+bool TieredCache::AbandonWriter(int64_t writer_id) {
+  mutex_lock l(mu_);
+  if (completed_ || !writer_claimed_ || writer_id != writer_id_) {
+    return false;
+  }
+  const bool discarded = !entries_.empty();
+  ResetLocked();
+  return discarded;
+}
+
+Status TieredCache::Append(const std::vector<Tensor>& element,
+                           bool* in_memory) {
+  mutex_lock l(mu_);
+  if (completed_) {
+    return errors::FailedPrecondition(
+        "Cannot append to a completed tiered cache.");
+  }
+  Entry entry;
+  int64_t bytes;
+  if (options_.compress) {
+    TF_RETURN_IF_ERROR(CompressElement(element, &entry.compressed));
+    bytes = entry.compressed.ByteSizeLong();
+  } else {
+    bytes = ElementBytes(element);
+  }
+  if (memory_bytes_ + bytes <= options_.memory_budget_bytes) {
+    entry.in_memory = true;
+    if (!options_.compress) {
+      entry.element = element;
+    }
+    memory_bytes_ += bytes;
+    metrics::RecordTFDataCacheBytes(kMemoryTier, bytes);
+  } else {
+    TF_RETURN_IF_ERROR(Spill(element, &entry));
+  }
+  *in_memory = entry.in_memory;
+  entries_.push_back(std::move(entry));
+  return Status::OK();
+}
+
+Status TieredCache::Spill(const std::vector<Tensor>& element, Entry* entry) {
+  if (!spill_writer_) {
+    TF_RETURN_IF_ERROR(
+        env_->NewWritableFile(options_.spill_filename, &spill_file_));
+    spill_writer_ = absl::make_unique<io::RecordWriter>(spill_file_.get());
+  }
+  string record;
+  if (options_.compress) {
+    entry->compressed.SerializeToString(&record);
+    entry->compressed.Clear();
+  } else {
+    UncompressedElement uncompressed;
+    for (const Tensor& tensor : element) {
+      tensor.AsProtoTensorContent(uncompressed.add_components());
+    }
+    uncompressed.SerializeToString(&record);
+  }
+  TF_RETURN_IF_ERROR(spill_writer_->WriteRecord(record));
+  const int64_t bytes = io::RecordWriter::kHeaderSize + record.size() +
+                        io::RecordWriter::kFooterSize;
+  entry->offset = disk_bytes_;
+  disk_bytes_ += bytes;
+  metrics::RecordTFDataCacheBytes(kDiskTier, bytes);
+  return Status::OK();
+}
+
+Status TieredCache::Complete() {
+  mutex_lock l(mu_);
+  if (completed_) {
+    return Status::OK();
+  }
+  if (spill_writer_) {
+    TF_RETURN_IF_ERROR(spill_writer_->Close());
+    TF_RETURN_IF_ERROR(spill_file_->Close());
+    spill_writer_.reset();
+    spill_file_.reset();
+  }
+  completed_ = true;
+  return Status::OK();
+}
+
+bool TieredCache::IsCompleted() {
+  tf_shared_lock l(mu_);
+  return completed_;
+}
+
+void TieredCache::Reset() {
+  mutex_lock l(mu_);
+  ResetLocked();
+}
+
+void TieredCache::ResetLocked() {
+  spill_writer_.reset();
+  spill_file_.reset();
+  if (disk_bytes_ > 0) {
+    Status s = env_->DeleteFile(options_.spill_filename);
+    if (!s.ok()) {
+      LOG(WARNING) << "Failed to delete cache spill file "
+                   << options_.spill_filename << ": " << s;
+    }
+  }
+  metrics::RecordTFDataCacheBytes(kMemoryTier, -memory_bytes_);
+  metrics::RecordTFDataCacheBytes(kDiskTier, -disk_bytes_);
+  memory_bytes_ = 0;
+  disk_bytes_ = 0;
+  entries_.clear();
+  completed_ = false;
+  writer_claimed_ = false;
+}
+
+size_t TieredCache::size() {
+  tf_shared_lock l(mu_);
+  return entries_.size();
+}
+
+int64_t TieredCache::memory_bytes() {
+  tf_shared_lock l(mu_);
+  return memory_bytes_;
+}
+
+int64_t TieredCache::disk_bytes() {
+  tf_shared_lock l(mu_);
+  return disk_bytes_;
+}
+
+Status TieredCache::NewReader(std::unique_ptr<Reader>* reader) {
+  tf_shared_lock l(mu_);
+  if (!completed_) {
+    return errors::FailedPrecondition(
+        "Cannot read from an incomplete tiered cache.");
+  }
+  return NewReaderLocked(reader);
+}
+
+Status TieredCache::ReadElements(std::vector<std::vector<Tensor>>* elements) {
+  std::unique_ptr<Reader> reader;
+  size_t num_elements;
+  {
+    mutex_lock l(mu_);
+    if (spill_writer_) {
+      // Makes the elements spilled so far visible to the reader.
+      TF_RETURN_IF_ERROR(spill_writer_->Flush());
+    }
+    TF_RETURN_IF_ERROR(NewReaderLocked(&reader));
+    num_elements = entries_.size();
+  }
+  elements->clear();
+  elements->resize(num_elements);
+  for (size_t i = 0; i < num_elements; ++i) {
+    TF_RETURN_IF_ERROR(reader->Read(i, &(*elements)[i]));
+  }
+  return Status::OK();
+}
+
+Status TieredCache::NewReaderLocked(std::unique_ptr<Reader>* reader) {
+  reader->reset(new Reader(this));
+  if (disk_bytes_ > 0) {
+    TF_RETURN_IF_ERROR(env_->NewRandomAccessFile(options_.spill_filename,
+                                                 &(*reader)->file_));
+    io::RecordReaderOptions reader_options;
+    reader_options.read_ahead_depth = options_.read_ahead_depth;
+    reader_options.read_ahead_chunk_size = options_.read_ahead_chunk_size;
+    (*reader)->reader_ = absl::make_unique<io::RecordReader>(
+        (*reader)->file_.get(), reader_options);
+  }
+  return Status::OK();
+}
+
+Status TieredCache::Reader::Read(int64_t index, std::vector<Tensor>* out) {
+  tf_shared_lock l(cache_->mu_);
+  if (index < 0 || static_cast<size_t>(index) >= cache_->entries_.size()) {
+    return errors::OutOfRange("Index ", index,
+                              " is out of range for a cache of size ",
+                              cache_->entries_.size());
+  }
+  const Entry& entry = cache_->entries_[index];
+  if (entry.in_memory) {
+    metrics::RecordTFDataCacheRead(kMemoryTier);
+    if (cache_->options_.compress) {
+      return UncompressElement(entry.compressed, out);
+    }
+    *out = entry.element;
+    return Status::OK();
+  }
+
+  metrics::RecordTFDataCacheRead(kDiskTier);
+  if (!reader_) {
+    return errors::Internal("The cache spill file was not opened.");
+  }
+  uint64 offset = entry.offset;
+  tstring record;
+  TF_RETURN_IF_ERROR(reader_->ReadRecord(&offset, &record));
+  if (cache_->options_.compress) {
+    CompressedElement compressed;
+    if (!compressed.ParseFromArray(record.data(), record.size())) {
+      return errors::DataLoss("Failed to parse cached element ", index);
+    }
+    return UncompressElement(compressed, out);
+  }
+  UncompressedElement uncompressed;
+  if (!uncompressed.ParseFromArray(record.data(), record.size())) {
+    return errors::DataLoss("Failed to parse cached element ", index);
+  }
+  out->clear();
+  out->reserve(uncompressed.components_size());
+  for (const TensorProto& proto : uncompressed.components()) {
+    Tensor tensor;
+    if (!tensor.FromProto(cpu_allocator(), proto)) {
+      return errors::DataLoss("Failed to parse cached element ", index);
+    }
+    out->push_back(std::move(tensor));
+  }
+  return Status::OK();
+}
+
 AnonymousMemoryCacheHandleOp::AnonymousMemoryCacheHandleOp(
     OpKernelConstruction* ctx)
     : AnonymousResourceOp<MemoryCacheManager>(ctx,
@@ -16,8 +16,15 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_DATA_CACHE_OPS_H_
 #define TENSORFLOW_CORE_KERNELS_DATA_CACHE_OPS_H_
 
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/data/dataset.pb.h"
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/lib/io/record_reader.h"
+#include "tensorflow/core/lib/io/record_writer.h"
+#include "tensorflow/core/platform/env.h"
 
 namespace tensorflow {
 namespace data {
@@ -57,6 +64,121 @@ class MemoryCache {
   std::vector<std::vector<Tensor>> cache_ TF_GUARDED_BY(mu_);
 };
 
+// A thread-safe cache of dataset elements that holds elements in memory up to
+// a byte budget and spills the others to an append-only local file.
+//
+// Like `MemoryCache`, the cache is populated by a single writer and, once
+// completed, read by any number of readers. Elements are assigned to a tier
+// when they are appended: an element stays in memory if it fits in what is
+// left of the budget, and is spilled otherwise. Since every epoch reads all
+// elements in order, keeping a fixed set of elements resident serves more
+// reads from memory than evicting elements would.
+class TieredCache {
+ public:
+  struct Options {
+    // The number of bytes of elements to hold in memory.
+    int64_t memory_budget_bytes = 0;
+    // Whether to compress elements, in memory and on disk, using
+    // `CompressElement`.
+    bool compress = false;
+    // The file to spill elements to. Deleted when the cache is reset or
+    // destroyed.
+    std::string spill_filename;
+    // Read-ahead used to read spilled elements back, see
+    // `io::RecordReaderOptions`.
+    int64_t read_ahead_depth = 4;
+    int64_t read_ahead_chunk_size = 1 << 20;
+  };
+
+  // Reads elements of a completed cache. Each reader iterator uses its own
+  // `Reader`, so that its reads of the spill file are sequential.
+  class Reader {
+   public:
+    // Reads the element at `index` into `out`.
+    Status Read(int64_t index, std::vector<Tensor>* out);
+
+   private:
+    friend class TieredCache;
+    explicit Reader(TieredCache* cache) : cache_(cache) {}
+
+    TieredCache* const cache_;  // Not owned.
+    std::unique_ptr<RandomAccessFile> file_;
+    std::unique_ptr<io::RecordReader> reader_;
+  };
+
+  TieredCache(Env* env, Options options);
+  ~TieredCache();
+
+  // Claims the right to populate the cache, and sets `*writer_id` to identify
+  // the writer in `AbandonWriter`. Returns false if another writer has claimed
+  // it or the cache is completed.
+  bool ClaimWriter(int64_t* writer_id);
+
+  // Discards the elements of the cache if it is incomplete and still being
+  // populated by `writer_id`, i.e. has not been reset since. Returns whether
+  // any elements were discarded.
+  bool AbandonWriter(int64_t writer_id);
+
+  // Appends an element to the cache, and sets `*in_memory` to whether it is
+  // held in memory.
+  Status Append(const std::vector<Tensor>& element, bool* in_memory);
+
+  // Marks the cache as completed, making it readable.
+  Status Complete();
+
+  // Returns whether the cache is completed.
+  bool IsCompleted();
+
+  // Discards the elements of the cache and releases the writer.
+  void Reset();
+
+  // Returns the number of elements in the cache.
+  size_t size();
+
+  // Returns the number of bytes held in each tier.
+  int64_t memory_bytes();
+  int64_t disk_bytes();
+
+  // Creates a reader for the completed cache.
+  Status NewReader(std::unique_ptr<Reader>* reader);
+
+  // Reads all elements appended so far, from both tiers. Unlike `NewReader`,
+  // can be called while the cache is being populated, e.g. to checkpoint it.
+  Status ReadElements(std::vector<std::vector<Tensor>>* elements);
+
+ private:
+  struct Entry {
+    bool in_memory = false;
+    // Set for uncompressed elements held in memory.
+    std::vector<Tensor> element;
+    // Set for compressed elements held in memory.
+    CompressedElement compressed;
+    // Offset in the spill file of spilled elements.
+    uint64 offset = 0;
+  };
+
+  // Writes the element to the spill file. If the cache is compressed, the
+  // element is taken from `entry->compressed`, which is cleared.
+  Status Spill(const std::vector<Tensor>& element, Entry* entry)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  Status NewReaderLocked(std::unique_ptr<Reader>* reader)
+      TF_SHARED_LOCKS_REQUIRED(mu_);
+  void ResetLocked() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  Env* const env_;
+  const Options options_;
+
+  mutex mu_;
+  bool completed_ TF_GUARDED_BY(mu_) = false;
+  bool writer_claimed_ TF_GUARDED_BY(mu_) = false;
+  int64_t writer_id_ TF_GUARDED_BY(mu_) = 0;
+  std::vector<Entry> entries_ TF_GUARDED_BY(mu_);
+  int64_t memory_bytes_ TF_GUARDED_BY(mu_) = 0;
+  int64_t disk_bytes_ TF_GUARDED_BY(mu_) = 0;
+  std::unique_ptr<WritableFile> spill_file_ TF_GUARDED_BY(mu_);
+  std::unique_ptr<io::RecordWriter> spill_writer_ TF_GUARDED_BY(mu_);
+};
+
 // A resource wrapping a shared instance of a memory cache.
 class MemoryCacheManager : public ResourceBase {
  public:
@@ -0,0 +1,503 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/experimental/bucket_by_sequence_length_dataset_op.h"
+
+#include <algorithm>
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_join.h"
+#include "tensorflow/core/data/dataset_utils.h"
+#include "tensorflow/core/data/name_utils.h"
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/metrics.h"
+#include "tensorflow/core/framework/model.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/partial_tensor_shape.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_util.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/util/batch_util.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+
+// Constants declared in bucket_by_sequence_length_dataset_op.h and used both
+// here and in test cases.
+/* static */ constexpr const char* const
+    BucketBySequenceLengthDatasetOp::kDatasetType;
+/* static */ constexpr const char* const
+    BucketBySequenceLengthDatasetOp::kInputDataset;
+/* static */ constexpr const char* const
+    BucketBySequenceLengthDatasetOp::kBucketBoundaries;
+/* static */ constexpr const char* const
+    BucketBySequenceLengthDatasetOp::kTokenBudget;
+/* static */ constexpr const char* const
+    BucketBySequenceLengthDatasetOp::kPaddingValues;
+/* static */ constexpr const char* const
+    BucketBySequenceLengthDatasetOp::kLengthComponent;
+/* static */ constexpr const char* const
+    BucketBySequenceLengthDatasetOp::kToutputTypes;
+/* static */ constexpr const char* const
+    BucketBySequenceLengthDatasetOp::kOutputShapes;
+
+namespace {
+
+constexpr char kExhausted[] = "exhausted";
+constexpr char kBucket[] = "bucket";
+constexpr char kReady[] = "ready";
+constexpr char kSize[] = "size";
+
+}  // namespace
+
+class BucketBySequenceLengthDatasetOp::Dataset : public DatasetBase {
+ public:
+  Dataset(OpKernelContext* ctx, const DatasetBase* input,
+          std::vector<int64_t> bucket_boundaries, int64_t token_budget,
+          std::vector<Tensor> padding_values, int64_t length_component)
+      : DatasetBase(DatasetContext(ctx)),
+        input_(input),
+        bucket_boundaries_(std::move(bucket_boundaries)),
+        token_budget_(token_budget),
+        padding_values_(std::move(padding_values)),
+        length_component_(length_component) {
+    input_->Ref();
+    output_shapes_.reserve(input_->output_shapes().size());
+    for (const PartialTensorShape& shape : input_->output_shapes()) {
+      output_shapes_.push_back(PartialTensorShape({-1}).Concatenate(shape));
+    }
+  }
+
+  ~Dataset() override { input_->Unref(); }
+
+  std::unique_ptr<IteratorBase> MakeIteratorInternal(
+      const string& prefix) const override {
+    return absl::make_unique<Iterator>(Iterator::Params{
+        this, name_utils::IteratorPrefix(kDatasetType, prefix)});
+  }
+
+  const DataTypeVector& output_dtypes() const override {
+    return input_->output_dtypes();
+  }
+
+  const std::vector<PartialTensorShape>& output_shapes() const override {
+    return output_shapes_;
+  }
+
+  string DebugString() const override {
+    name_utils::DatasetDebugStringParams params;
+    params.set_args(token_budget_);
+    return name_utils::DatasetDebugString(kDatasetType, params);
+  }
+
+  int64_t Cardinality() const override {
+    const int64_t n = input_->Cardinality();
+    if (n == kInfiniteCardinality || n == 0) {
+      return n;
+    }
+    // The number of batches depends on the lengths of the elements.
+    return kUnknownCardinality;
+  }
+
+  Status InputDatasets(std::vector<const DatasetBase*>* inputs) const override {
+    inputs->push_back(input_);
+    return Status::OK();
+  }
+
+  Status CheckExternalState() const override {
+    return input_->CheckExternalState();
+  }
+
+ protected:
+  Status AsGraphDefInternal(SerializationContext* ctx,
+                            DatasetGraphDefBuilder* b,
+                            Node** output) const override {
+    Node* input_graph_node = nullptr;
+    TF_RETURN_IF_ERROR(b->AddInputDataset(ctx, input_, &input_graph_node));
+    Node* bucket_boundaries = nullptr;
+    TF_RETURN_IF_ERROR(b->AddVector(bucket_boundaries_, &bucket_boundaries));
+    Node* token_budget = nullptr;
+    TF_RETURN_IF_ERROR(b->AddScalar(token_budget_, &token_budget));
+    std::vector<Node*> padding_values;
+    padding_values.reserve(padding_values_.size());
+    for (const Tensor& t : padding_values_) {
+      Node* node;
+      TF_RETURN_IF_ERROR(b->AddTensor(t, &node));
+      padding_values.emplace_back(node);
+    }
+
+    AttrValue length_component;
+    b->BuildAttrValue(length_component_, &length_component);
+    AttrValue output_types;
+    b->BuildAttrValue(output_dtypes(), &output_types);
+
+    TF_RETURN_IF_ERROR(b->AddDataset(
+        this,
+        {{0, input_graph_node}, {1, bucket_boundaries}, {2, token_budget}},
+        {{3, padding_values}},
+        {{kLengthComponent, length_component}, {kToutputTypes, output_types}},
+        output));
+    return Status::OK();
+  }
+
+ private:
+  // Assigns each input element to the bucket of its sequence length and
+  // produces a bucket's elements as one batch as soon as another element
+  // could no longer fit in the token budget. Elements in a bucket have similar
+  // lengths, so they waste little of the budget on padding.
+  class Iterator : public DatasetIterator<Dataset> {
+   public:
+    explicit Iterator(const Params& params)
+        : DatasetIterator<Dataset>(params),
+          buckets_(params.dataset->bucket_boundaries_.size() + 1) {}
+
+    Status Initialize(IteratorContext* ctx) override {
+      return dataset()->input_->MakeIterator(ctx, this, prefix(), &input_impl_);
+    }
+
+    Status GetNextInternal(IteratorContext* ctx,
+                           std::vector<Tensor>* out_tensors,
+                           bool* end_of_sequence) override {
+      std::vector<std::vector<Tensor>> batch;
+      {
+        mutex_lock l(mu_);
+        while (ready_.empty() && input_impl_) {
+          std::vector<Tensor> element;
+          bool end_of_input = false;
+          TF_RETURN_IF_ERROR(
+              input_impl_->GetNext(ctx, &element, &end_of_input));
+          if (end_of_input) {
+            input_impl_.reset();
+            for (Bucket& bucket : buckets_) {
+              if (!bucket.elements.empty()) {
+                EmitBucket(&bucket);
+              }
+            }
+            break;
+          }
+          TF_RETURN_IF_ERROR(AddElement(std::move(element)));
+        }
+        if (ready_.empty()) {
+          *end_of_sequence = true;
+          return Status::OK();
+        }
+        batch = std::move(ready_.front());
+        ready_.pop_front();
+      }
+      *end_of_sequence = false;
+      return CopyBatch(ctx, batch, out_tensors);
+    }
+
+   protected:
+    std::shared_ptr<model::Node> CreateNode(
+        IteratorContext* ctx, model::Node::Args args) const override {
+      return model::MakeUnknownRatioNode(std::move(args));
+    }
+
+    Status SaveInternal(SerializationContext* ctx,
+                        IteratorStateWriter* writer) override {
+      mutex_lock l(mu_);
+      if (input_impl_) {
+        TF_RETURN_IF_ERROR(SaveInput(ctx, writer, input_impl_));
+      } else {
+        TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kExhausted), ""));
+      }
+      for (size_t i = 0; i < buckets_.size(); ++i) {
+        TF_RETURN_IF_ERROR(SaveGroup(
+            writer, full_name(strings::StrCat(kBucket, "[", i, "]")),
+            buckets_[i].elements));
+      }
+      TF_RETURN_IF_ERROR(writer->WriteScalar(
+          full_name(strings::StrCat(kReady, "_", kSize)), ready_.size()));
+      for (size_t i = 0; i < ready_.size(); ++i) {
+        TF_RETURN_IF_ERROR(SaveGroup(
+            writer, full_name(strings::StrCat(kReady, "[", i, "]")),
+            ready_[i]));
+      }
+      return Status::OK();
+    }
+
+    Status RestoreInternal(IteratorContext* ctx,
+                           IteratorStateReader* reader) override {
+      mutex_lock l(mu_);
+      if (reader->Contains(full_name(kExhausted))) {
+        input_impl_.reset();
+      } else {
+        TF_RETURN_IF_ERROR(RestoreInput(ctx, reader, input_impl_));
+      }
+      for (size_t i = 0; i < buckets_.size(); ++i) {
+        Bucket& bucket = buckets_[i];
+        TF_RETURN_IF_ERROR(RestoreGroup(
+            ctx, reader, full_name(strings::StrCat(kBucket, "[", i, "]")),
+            &bucket.elements));
+        bucket.max_length = 0;
+        for (const std::vector<Tensor>& element : bucket.elements) {
+          bucket.max_length =
+              std::max(bucket.max_length,
+                       element[dataset()->length_component_].dim_size(0));
+        }
+      }
+      int64_t ready_size;
+      TF_RETURN_IF_ERROR(reader->ReadScalar(
+          full_name(strings::StrCat(kReady, "_", kSize)), &ready_size));
+      ready_.clear();
+      ready_.resize(ready_size);
+      for (int64_t i = 0; i < ready_size; ++i) {
+        TF_RETURN_IF_ERROR(RestoreGroup(
+            ctx, reader, full_name(strings::StrCat(kReady, "[", i, "]")),
+            &ready_[i]));
+      }
+      return Status::OK();
+    }
+
+   private:
+    struct Bucket {
+      std::vector<std::vector<Tensor>> elements;
+      // The largest sequence length of `elements`.
+      int64_t max_length = 0;
+    };
+
+    // Adds `element` to the bucket of its sequence length, first producing the
+    // bucket's elements if `element` would not fit in the token budget, and
+    // afterwards if no further element could fit. An element that exceeds the
+    // budget on its own is produced in a batch of one.
+    Status AddElement(std::vector<Tensor> element)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      const Tensor& sequence = element[dataset()->length_component_];
+      if (sequence.dims() < 1) {
+        return errors::InvalidArgument(
+            "The sequence length component of BucketBySequenceLengthDataset "
+            "elements must have rank of at least 1, but got shape ",
+            sequence.shape().DebugString());
+      }
+      const int64_t length = sequence.dim_size(0);
+      const std::vector<int64_t>& boundaries = dataset()->bucket_boundaries_;
+      Bucket& bucket =
+          buckets_[std::upper_bound(boundaries.begin(), boundaries.end(),
+                                    length) -
+                   boundaries.begin()];
+      const int64_t budget = dataset()->token_budget_;
+      int64_t num_elements = bucket.elements.size();
+      if (num_elements > 0 &&
+          (num_elements + 1) * std::max(bucket.max_length, length) > budget) {
+        EmitBucket(&bucket);
+        num_elements = 0;
+      }
+      bucket.elements.push_back(std::move(element));
+      bucket.max_length = std::max(bucket.max_length, length);
+      if ((num_elements + 2) * bucket.max_length > budget) {
+        EmitBucket(&bucket);
+      }
+      return Status::OK();
+    }
+
+    void EmitBucket(Bucket* bucket) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      ready_.push_back(std::move(bucket->elements));
+      bucket->elements.clear();
+      bucket->max_length = 0;
+    }
+
+    // Pads every component of `batch` to the largest shape of that component
+    // in the batch, rather than to a static shape, and copies the elements
+    // into one preallocated output tensor per component.
+    Status CopyBatch(IteratorContext* ctx,
+                     const std::vector<std::vector<Tensor>>& batch,
+                     std::vector<Tensor>* out_tensors) {
+      const int64_t num_elements = batch.size();
+      const size_t num_components = batch[0].size();
+      out_tensors->clear();
+      out_tensors->reserve(num_components);
+      for (size_t component = 0; component < num_components; ++component) {
+        const int rank = batch[0][component].dims();
+        TensorShape element_shape = batch[0][component].shape();
+        for (int64_t i = 1; i < num_elements; ++i) {
+          const TensorShape& shape = batch[i][component].shape();
+          if (shape.dims() != rank) {
+            return errors::InvalidArgument(
+                "All elements in a batch must have the same rank for "
+                "component ",
+                component, ": expected rank ", rank,
+                " but got element with rank ", shape.dims());
+          }
+          for (int dim = 0; dim < rank; ++dim) {
+            if (shape.dim_size(dim) > element_shape.dim_size(dim)) {
+              element_shape.set_dim(dim, shape.dim_size(dim));
+            }
+          }
+        }
+        TensorShape batch_shape({num_elements});
+        batch_shape.AppendShape(element_shape);
+        out_tensors->emplace_back(ctx->allocator({}),
+                                  dataset()->output_dtypes()[component],
+                                  batch_shape);
+        Tensor& batch_component = out_tensors->back();
+        TF_RETURN_IF_ERROR(batch_util::SetElementZero(
+            &batch_component, dataset()->padding_values_[component]));
+        for (int64_t i = 0; i < num_elements; ++i) {
+          // Take the fast path if possible.
+          if (batch[i][component].shape() == element_shape) {
+            TF_RETURN_IF_ERROR(batch_util::CopyElementToSlice(
+                batch[i][component], &batch_component, i));
+          } else {
+            TF_RETURN_IF_ERROR(batch_util::CopyElementToLargerSlice(
+                batch[i][component], &batch_component, i));
+          }
+        }
+      }
+
+      int64_t num_tokens = 0;
+      int64_t max_length = 0;
+      for (const std::vector<Tensor>& element : batch) {
+        const int64_t length =
+            element[dataset()->length_component_].dim_size(0);
+        num_tokens += length;
+        max_length = std::max(max_length, length);
+      }
+      metrics::RecordTFDataBucketBatch(num_elements, num_tokens,
+                                       num_elements * max_length);
+      return Status::OK();
+    }
+
+    Status SaveGroup(IteratorStateWriter* writer, const string& name,
+                     const std::vector<std::vector<Tensor>>& group)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(strings::StrCat(name, "_", kSize), group.size()));
+      for (size_t i = 0; i < group.size(); ++i) {
+        TF_RETURN_IF_ERROR(writer->WriteScalar(
+            strings::StrCat(name, "[", i, "]_", kSize), group[i].size()));
+        for (size_t j = 0; j < group[i].size(); ++j) {
+          TF_RETURN_IF_ERROR(writer->WriteTensor(
+              strings::StrCat(name, "[", i, "][", j, "]"), group[i][j]));
+        }
+      }
+      return Status::OK();
+    }
+
+    Status RestoreGroup(IteratorContext* ctx, IteratorStateReader* reader,
+                        const string& name,
+                        std::vector<std::vector<Tensor>>* group)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      int64_t group_size;
+      TF_RETURN_IF_ERROR(
+          reader->ReadScalar(strings::StrCat(name, "_", kSize), &group_size));
+      group->clear();
+      group->resize(group_size);
+      for (int64_t i = 0; i < group_size; ++i) {
+        int64_t element_size;
+        TF_RETURN_IF_ERROR(reader->ReadScalar(
+            strings::StrCat(name, "[", i, "]_", kSize), &element_size));
+        (*group)[i].resize(element_size);
+        for (int64_t j = 0; j < element_size; ++j) {
+          TF_RETURN_IF_ERROR(reader->ReadTensor(
+              ctx->flr(), strings::StrCat(name, "[", i, "][", j, "]"),
+              &(*group)[i][j]));
+        }
+      }
+      return Status::OK();
+    }
+
+    mutex mu_;
+    std::unique_ptr<IteratorBase> input_impl_ TF_GUARDED_BY(mu_);
+    // One bucket per interval between consecutive bucket boundaries.
+    std::vector<Bucket> buckets_ TF_GUARDED_BY(mu_);
+    // Groups of elements which are to be produced as batches, in order.
+    std::deque<std::vector<std::vector<Tensor>>> ready_ TF_GUARDED_BY(mu_);
+  };
+
+  const DatasetBase* const input_;
+  const std::vector<int64_t> bucket_boundaries_;
+  const int64_t token_budget_;
+  const std::vector<Tensor> padding_values_;
+  const int64_t length_component_;
+  std::vector<PartialTensorShape> output_shapes_;
+};
+
+BucketBySequenceLengthDatasetOp::BucketBySequenceLengthDatasetOp(
+    OpKernelConstruction* ctx)
+    : UnaryDatasetOpKernel(ctx) {
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kLengthComponent, &length_component_));
+}
+
+void BucketBySequenceLengthDatasetOp::MakeDataset(OpKernelContext* ctx,
+                                                  DatasetBase* input,
+                                                  DatasetBase** output) {
+  const int64_t num_components = input->output_dtypes().size();
+  OP_REQUIRES(
+      ctx, length_component_ >= 0 && length_component_ < num_components,
+      errors::InvalidArgument("length_component (", length_component_,
+                              ") must be non-negative and less than the "
+                              "number of components in the input dataset's "
+                              "elements (",
+                              num_components, ")"));
+
+  std::vector<int64_t> bucket_boundaries;
+  OP_REQUIRES_OK(ctx, ParseVectorArgument<int64_t>(ctx, kBucketBoundaries,
+                                                   &bucket_boundaries));
+  for (size_t i = 0; i < bucket_boundaries.size(); ++i) {
+    OP_REQUIRES(ctx,
+                bucket_boundaries[i] > 0 &&
+                    (i == 0 || bucket_boundaries[i] > bucket_boundaries[i - 1]),
+                errors::InvalidArgument(
+                    "Bucket boundaries must be positive and strictly "
+                    "increasing, but got ",
+                    absl::StrJoin(bucket_boundaries, ", ")));
+  }
+
+  int64_t token_budget;
+  OP_REQUIRES_OK(ctx, ParseScalarArgument<int64_t>(ctx, kTokenBudget,
+                                                   &token_budget));
+  OP_REQUIRES(
+      ctx, token_budget > 0,
+      errors::InvalidArgument("Token budget must be greater than zero."));
+
+  OpInputList padding_values_list;
+  OP_REQUIRES_OK(ctx, ctx->input_list(kPaddingValues, &padding_values_list));
+  OP_REQUIRES(ctx, padding_values_list.size() == num_components,
+              errors::InvalidArgument(
+                  "Number of padding values (", padding_values_list.size(),
+                  ") must match the number of components in the input "
+                  "dataset's elements (",
+                  num_components, ")"));
+  std::vector<Tensor> padding_values;
+  for (int i = 0; i < padding_values_list.size(); ++i) {
+    const Tensor& padding_value_t = padding_values_list[i];
+    OP_REQUIRES(ctx, TensorShapeUtils::IsScalar(padding_value_t.shape()),
+                errors::InvalidArgument("All padding values must be scalars"));
+    OP_REQUIRES(ctx, padding_value_t.dtype() == input->output_dtypes()[i],
+                errors::InvalidArgument(
+                    "Mismatched type between padding value ", i,
+                    " and input dataset's component ", i, ": ",
+                    DataTypeString(padding_value_t.dtype()), " vs. ",
+                    DataTypeString(input->output_dtypes()[i])));
+    padding_values.push_back(tensor::DeepCopy(padding_value_t));
+  }
+
+  *output = new Dataset(ctx, input, std::move(bucket_boundaries), token_budget,
+                        std::move(padding_values), length_component_);
+}
+
+namespace {
+REGISTER_KERNEL_BUILDER(
+    Name("BucketBySequenceLengthDataset").Device(DEVICE_CPU),
+    BucketBySequenceLengthDatasetOp);
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,248 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/experimental/bucket_by_sequence_length_dataset_op.h"
+
+#include "tensorflow/core/data/dataset_test_base.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+namespace {
+
+constexpr char kNodeName[] = "bucket_by_sequence_length_dataset";
+
+class BucketBySequenceLengthDatasetParams : public DatasetParams {
+ public:
+  template <typename T>
+  BucketBySequenceLengthDatasetParams(
+      T input_dataset_params, std::vector<int64_t> bucket_boundaries,
+      int64_t token_budget, std::vector<Tensor> padding_values,
+      int64_t length_component, DataTypeVector output_dtypes,
+      std::vector<PartialTensorShape> output_shapes, string node_name)
+      : DatasetParams(std::move(output_dtypes), std::move(output_shapes),
+                      std::move(node_name)),
+        bucket_boundaries_(std::move(bucket_boundaries)),
+        token_budget_(token_budget),
+        padding_values_(std::move(padding_values)),
+        length_component_(length_component) {
+    input_dataset_params_.push_back(absl::make_unique<T>(input_dataset_params));
+    iterator_prefix_ =
+        name_utils::IteratorPrefix(input_dataset_params.dataset_type(),
+                                   input_dataset_params.iterator_prefix());
+  }
+
+  std::vector<Tensor> GetInputTensors() const override {
+    std::vector<Tensor> input_tensors = {
+        CreateTensor<int64_t>(
+            TensorShape({static_cast<int64_t>(bucket_boundaries_.size())}),
+            bucket_boundaries_),
+        CreateTensor<int64_t>(TensorShape({}), {token_budget_})};
+    for (const Tensor& padding_value : padding_values_) {
+      input_tensors.push_back(padding_value);
+    }
+    return input_tensors;
+  }
+
+  Status GetInputNames(std::vector<string>* input_names) const override {
+    *input_names = {BucketBySequenceLengthDatasetOp::kInputDataset,
+                    BucketBySequenceLengthDatasetOp::kBucketBoundaries,
+                    BucketBySequenceLengthDatasetOp::kTokenBudget};
+    for (int i = 0; i < padding_values_.size(); ++i) {
+      input_names->push_back(strings::StrCat(
+          BucketBySequenceLengthDatasetOp::kPaddingValues, "_", i));
+    }
+    return Status::OK();
+  }
+
+  Status GetAttributes(AttributeVector* attr_vector) const override {
+    *attr_vector = {
+        {BucketBySequenceLengthDatasetOp::kLengthComponent, length_component_},
+        {BucketBySequenceLengthDatasetOp::kToutputTypes, output_dtypes_},
+        {BucketBySequenceLengthDatasetOp::kOutputShapes, output_shapes_}};
+    return Status::OK();
+  }
+
+  string dataset_type() const override {
+    return BucketBySequenceLengthDatasetOp::kDatasetType;
+  }
+
+ private:
+  std::vector<int64_t> bucket_boundaries_;
+  int64_t token_budget_;
+  std::vector<Tensor> padding_values_;
+  int64_t length_component_;
+};
+
+class BucketBySequenceLengthDatasetOpTest : public DatasetOpsTestBase {};
+
+// Returns params for an input of two sequences of length 3, [0, 1, 2] and
+// [3, 4, 5], followed by two sequences of length 1, [6] and [7].
+BucketBySequenceLengthDatasetParams SequenceParams(
+    std::vector<int64_t> bucket_boundaries, int64_t token_budget,
+    int64_t length_component = 0) {
+  auto tensor_slice_dataset_params_0 = TensorSliceDatasetParams(
+      /*components=*/CreateTensors<int64_t>(TensorShape{2, 3},
+                                            {{0, 1, 2, 3, 4, 5}}),
+      /*node_name=*/"tensor_slice_0");
+  auto tensor_slice_dataset_params_1 = TensorSliceDatasetParams(
+      /*components=*/CreateTensors<int64_t>(TensorShape{2, 1}, {{6, 7}}),
+      /*node_name=*/"tensor_slice_1");
+  auto concatenate_dataset_params =
+      ConcatenateDatasetParams(std::move(tensor_slice_dataset_params_0),
+                               std::move(tensor_slice_dataset_params_1),
+                               /*output_dtypes=*/{DT_INT64},
+                               /*output_shapes=*/{PartialTensorShape({-1})},
+                               /*node_name=*/"concatenate");
+  return BucketBySequenceLengthDatasetParams(
+      /*input_dataset_params=*/concatenate_dataset_params,
+      std::move(bucket_boundaries), token_budget,
+      /*padding_values=*/{CreateTensor<int64_t>(TensorShape{}, {-1})},
+      length_component,
+      /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({-1, -1})},
+      /*node_name=*/kNodeName);
+}
+
+// Test case 1: all sequences share one bucket, so the shorter sequence in the
+// first batch is padded.
+BucketBySequenceLengthDatasetParams BucketBySequenceLengthDatasetParams1() {
+  return SequenceParams(/*bucket_boundaries=*/{5}, /*token_budget=*/10);
+}
+
+// Test case 2: sequences of different lengths go to different buckets and
+// the remaining buckets are produced in bucket order at the end of the input.
+BucketBySequenceLengthDatasetParams BucketBySequenceLengthDatasetParams2() {
+  return SequenceParams(/*bucket_boundaries=*/{2}, /*token_budget=*/10);
+}
+
+// Test case 3: sequences longer than the token budget are produced alone.
+BucketBySequenceLengthDatasetParams BucketBySequenceLengthDatasetParams3() {
+  return SequenceParams(/*bucket_boundaries=*/{}, /*token_budget=*/2);
+}
+
+BucketBySequenceLengthDatasetParams DecreasingBoundariesParams() {
+  return SequenceParams(/*bucket_boundaries=*/{4, 2}, /*token_budget=*/10);
+}
+
+BucketBySequenceLengthDatasetParams InvalidTokenBudgetParams() {
+  return SequenceParams(/*bucket_boundaries=*/{2}, /*token_budget=*/0);
+}
+
+BucketBySequenceLengthDatasetParams NegativeLengthComponentParams() {
+  return SequenceParams(/*bucket_boundaries=*/{2}, /*token_budget=*/10,
+                        /*length_component=*/-1);
+}
+
+BucketBySequenceLengthDatasetParams OutOfRangeLengthComponentParams() {
+  return SequenceParams(/*bucket_boundaries=*/{2}, /*token_budget=*/10,
+                        /*length_component=*/1);
+}
+
+std::vector<GetNextTestCase<BucketBySequenceLengthDatasetParams>>
+GetNextTestCases() {
+  return {
+      {/*dataset_params=*/BucketBySequenceLengthDatasetParams1(),
+       /*expected_outputs=*/
+       {CreateTensor<int64_t>(TensorShape{3, 3},
+                              {0, 1, 2, 3, 4, 5, 6, -1, -1}),
+        CreateTensor<int64_t>(TensorShape{1, 1}, {7})}},
+      {/*dataset_params=*/BucketBySequenceLengthDatasetParams2(),
+       /*expected_outputs=*/
+       {CreateTensor<int64_t>(TensorShape{2, 1}, {6, 7}),
+        CreateTensor<int64_t>(TensorShape{2, 3}, {0, 1, 2, 3, 4, 5})}},
+      {/*dataset_params=*/BucketBySequenceLengthDatasetParams3(),
+       /*expected_outputs=*/
+       {CreateTensor<int64_t>(TensorShape{1, 3}, {0, 1, 2}),
+        CreateTensor<int64_t>(TensorShape{1, 3}, {3, 4, 5}),
+        CreateTensor<int64_t>(TensorShape{2, 1}, {6, 7})}}};
+}
+
+ITERATOR_GET_NEXT_TEST_P(BucketBySequenceLengthDatasetOpTest,
+                         BucketBySequenceLengthDatasetParams,
+                         GetNextTestCases())
+
+TEST_F(BucketBySequenceLengthDatasetOpTest, DatasetNodeName) {
+  auto dataset_params = BucketBySequenceLengthDatasetParams1();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(CheckDatasetNodeName(dataset_params.node_name()));
+}
+
+TEST_F(BucketBySequenceLengthDatasetOpTest, DatasetTypeString) {
+  auto dataset_params = BucketBySequenceLengthDatasetParams1();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(CheckDatasetTypeString(
+      name_utils::OpName(BucketBySequenceLengthDatasetOp::kDatasetType)));
+}
+
+TEST_F(BucketBySequenceLengthDatasetOpTest, DatasetOutputDtypes) {
+  auto dataset_params = BucketBySequenceLengthDatasetParams1();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(CheckDatasetOutputDtypes({DT_INT64}));
+}
+
+TEST_F(BucketBySequenceLengthDatasetOpTest, DatasetOutputShapes) {
+  auto dataset_params = BucketBySequenceLengthDatasetParams1();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(CheckDatasetOutputShapes({PartialTensorShape({-1, -1})}));
+}
+
+TEST_F(BucketBySequenceLengthDatasetOpTest, Cardinality) {
+  auto dataset_params = BucketBySequenceLengthDatasetParams1();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(CheckDatasetCardinality(kUnknownCardinality));
+}
+
+TEST_F(BucketBySequenceLengthDatasetOpTest, IteratorPrefix) {
+  auto dataset_params = BucketBySequenceLengthDatasetParams1();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(CheckIteratorPrefix(
+      name_utils::IteratorPrefix(BucketBySequenceLengthDatasetOp::kDatasetType,
+                                 dataset_params.iterator_prefix())));
+}
+
+std::vector<IteratorSaveAndRestoreTestCase<BucketBySequenceLengthDatasetParams>>
+IteratorSaveAndRestoreTestCases() {
+  return {
+      {/*dataset_params=*/BucketBySequenceLengthDatasetParams2(),
+       /*breakpoints=*/{0, 1, 3},
+       /*expected_outputs=*/
+       {CreateTensor<int64_t>(TensorShape{2, 1}, {6, 7}),
+        CreateTensor<int64_t>(TensorShape{2, 3}, {0, 1, 2, 3, 4, 5})}},
+      {/*dataset_params=*/BucketBySequenceLengthDatasetParams3(),
+       /*breakpoints=*/{0, 1, 2, 4},
+       /*expected_outputs=*/
+       {CreateTensor<int64_t>(TensorShape{1, 3}, {0, 1, 2}),
+        CreateTensor<int64_t>(TensorShape{1, 3}, {3, 4, 5}),
+        CreateTensor<int64_t>(TensorShape{2, 1}, {6, 7})}}};
+}
+
+ITERATOR_SAVE_AND_RESTORE_TEST_P(BucketBySequenceLengthDatasetOpTest,
+                                 BucketBySequenceLengthDatasetParams,
+                                 IteratorSaveAndRestoreTestCases())
+
+TEST_F(BucketBySequenceLengthDatasetOpTest, InvalidArguments) {
+  std::vector<BucketBySequenceLengthDatasetParams> invalid_params = {
+      DecreasingBoundariesParams(), InvalidTokenBudgetParams(),
+      NegativeLengthComponentParams(), OutOfRangeLengthComponentParams()};
+  for (auto& dataset_params : invalid_params) {
+    EXPECT_EQ(Initialize(dataset_params).code(),
+              tensorflow::error::INVALID_ARGUMENT);
+  }
+}
+
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
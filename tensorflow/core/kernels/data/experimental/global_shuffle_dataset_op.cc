@@ -0,0 +1,459 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/experimental/global_shuffle_dataset_op.h"
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <utility>
+
+#include "tensorflow/core/data/dataset_utils.h"
+#include "tensorflow/core/data/index_permutation.h"
+#include "tensorflow/core/data/name_utils.h"
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/model.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/partial_tensor_shape.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/gtl/cleanup.h"
+#include "tensorflow/core/lib/random/philox_random.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+
+// Constants declared in global_shuffle_dataset_op.h and used both here and in
+// test cases.
+/* static */ constexpr const char* const GlobalShuffleDatasetOp::kDatasetType;
+/* static */ constexpr const char* const GlobalShuffleDatasetOp::kInputDataset;
+/* static */ constexpr const char* const GlobalShuffleDatasetOp::kSeed;
+/* static */ constexpr const char* const GlobalShuffleDatasetOp::kSeed2;
+/* static */ constexpr const char* const
+    GlobalShuffleDatasetOp::kNumParallelCalls;
+/* static */ constexpr const char* const
+    GlobalShuffleDatasetOp::kReshuffleEachIteration;
+/* static */ constexpr const char* const GlobalShuffleDatasetOp::kOutputTypes;
+/* static */ constexpr const char* const GlobalShuffleDatasetOp::kOutputShapes;
+
+namespace {
+
+constexpr char kSeedState[] = "seed";
+constexpr char kSeed2State[] = "seed2";
+constexpr char kPosition[] = "position";
+constexpr char kEpoch[] = "epoch";
+
+// Returns the seeds of the permutation used by the given epoch. The first epoch
+// uses `seeds` directly, later ones draw new seeds from a generator keyed by
+// `seeds`.
+std::pair<int64_t, int64_t> EpochSeeds(std::pair<int64_t, int64_t> seeds,
+                                       int64_t epoch) {
+  if (epoch == 0) {
+    return seeds;
+  }
+  random::PhiloxRandom generator(seeds.first, seeds.second);
+  generator.Skip(epoch - 1);
+  random::PhiloxRandom::ResultType sample = generator();
+  return {static_cast<int64_t>((static_cast<uint64>(sample[0]) << 32) |
+                               sample[1]),
+          static_cast<int64_t>((static_cast<uint64>(sample[2]) << 32) |
+                               sample[3])};
+}
+
+}  // namespace
+
+class GlobalShuffleDatasetOp::Dataset : public DatasetBase {
+ public:
+  Dataset(OpKernelContext* ctx, const DatasetBase* input, int64_t seed,
+          int64_t seed2, int64_t num_parallel_calls,
+          bool reshuffle_each_iteration)
+      : DatasetBase(DatasetContext(ctx)),
+        input_(input),
+        input_seeds_(seed, seed2),
+        seeds_(MaybeOverrideSeeds(input_seeds_)),
+        num_parallel_calls_(num_parallel_calls),
+        reshuffle_each_iteration_(reshuffle_each_iteration) {
+    input_->Ref();
+  }
+
+  ~Dataset() override { input_->Unref(); }
+
+  std::unique_ptr<IteratorBase> MakeIteratorInternal(
+      const string& prefix) const override {
+    return absl::make_unique<Iterator>(Iterator::Params{
+        this, name_utils::IteratorPrefix(kDatasetType, prefix)});
+  }
+
+  const DataTypeVector& output_dtypes() const override {
+    return input_->output_dtypes();
+  }
+
+  const std::vector<PartialTensorShape>& output_shapes() const override {
+    return input_->output_shapes();
+  }
+
+  string DebugString() const override {
+    name_utils::DatasetDebugStringParams params;
+    params.set_args(input_seeds_.first, input_seeds_.second);
+    return name_utils::DatasetDebugString(kDatasetType, params);
+  }
+
+  int64_t Cardinality() const override { return input_->Cardinality(); }
+
+  Status InputDatasets(std::vector<const DatasetBase*>* inputs) const override {
+    inputs->push_back(input_);
+    return Status::OK();
+  }
+
+  Status CheckExternalState() const override {
+    return input_->CheckExternalState();
+  }
+
+  // Shuffling a randomly accessible dataset keeps it randomly accessible.
+  // Elements are returned in the order of the first iteration, which is the
+  // order of every iteration unless `reshuffle_each_iteration` is set.
+  Status Get(OpKernelContext* ctx, int64 index,
+             std::vector<Tensor>* out_tensors) const override {
+    TF_RETURN_IF_ERROR(CheckRandomAccessCompatible(index));
+    const std::pair<int64_t, int64_t> seeds = EpochSeeds(seeds_, /*epoch=*/0);
+    IndexPermutation permutation(input_->Cardinality(), seeds.first,
+                                 seeds.second);
+    return input_->Get(ctx, permutation(index), out_tensors);
+  }
+
+ protected:
+  Status AsGraphDefInternal(SerializationContext* ctx,
+                            DatasetGraphDefBuilder* b,
+                            Node** output) const override {
+    Node* input_graph_node = nullptr;
+    TF_RETURN_IF_ERROR(b->AddInputDataset(ctx, input_, &input_graph_node));
+    Node* seed = nullptr;
+    Node* seed2 = nullptr;
+    Node* num_parallel_calls = nullptr;
+    TF_RETURN_IF_ERROR(b->AddScalar(input_seeds_.first, &seed));
+    TF_RETURN_IF_ERROR(b->AddScalar(input_seeds_.second, &seed2));
+    TF_RETURN_IF_ERROR(b->AddScalar(num_parallel_calls_, &num_parallel_calls));
+    AttrValue reshuffle_each_iteration;
+    b->BuildAttrValue(reshuffle_each_iteration_, &reshuffle_each_iteration);
+    TF_RETURN_IF_ERROR(b->AddDataset(
+        this, {input_graph_node, seed, seed2, num_parallel_calls},
+        {std::make_pair(kReshuffleEachIteration, reshuffle_each_iteration)},
+        output));
+    return Status::OK();
+  }
+
+ private:
+  // Iterates over the input in the order of an `IndexPermutation`, fetching
+  // up to `num_parallel_calls` elements ahead of the consumer through random
+  // access. The only state is the epoch, the seeds of the permutation and the
+  // position of the next element, so checkpoints are small regardless of the
+  // size of the input.
+  class Iterator : public DatasetIterator<Dataset> {
+   public:
+    explicit Iterator(const Params& params)
+        : DatasetIterator<Dataset>(params),
+          cardinality_(params.dataset->input_->Cardinality()) {}
+
+    ~Iterator() override {
+      CancelThreads(/*wait=*/true);
+      if (deregister_fn_) deregister_fn_();
+    }
+
+    Status Initialize(IteratorContext* ctx) override {
+      mutex_lock l(mu_);
+      if (ctx->flr() == nullptr) {
+        return errors::FailedPrecondition(
+            "GlobalShuffleDataset requires a function library runtime.");
+      }
+      num_parallel_calls_ = dataset()->num_parallel_calls_;
+      if (num_parallel_calls_ == model::kAutotune) {
+        num_parallel_calls_ = ctx->runner_threadpool_size();
+      }
+      num_parallel_calls_ = std::max<int64_t>(num_parallel_calls_, 1);
+      epoch_ =
+          dataset()->reshuffle_each_iteration_ ? dataset()->NextEpoch() : 0;
+      ResetPermutation(EpochSeeds(dataset()->seeds_, epoch_));
+      return RegisterCancellationCallback(
+          ctx->cancellation_manager(),
+          [this]() { CancelThreads(/*wait=*/false); }, &deregister_fn_);
+    }
+
+    Status GetNextInternal(IteratorContext* ctx,
+                           std::vector<Tensor>* out_tensors,
+                           bool* end_of_sequence) override {
+      std::shared_ptr<Result> result;
+      {
+        mutex_lock l(mu_);
+        if (position_ >= cardinality_) {
+          *end_of_sequence = true;
+          return Status::OK();
+        }
+        EnsureRunnerThreadStarted(ctx);
+        while (!cancelled_ &&
+               (results_.empty() || !results_.front()->done)) {
+          RecordStop(ctx);
+          cond_var_.wait(l);
+          RecordStart(ctx);
+        }
+        if (cancelled_) {
+          return errors::Cancelled("Iterator was cancelled");
+        }
+        result = std::move(results_.front());
+        results_.pop_front();
+        ++position_;
+        cond_var_.notify_all();
+      }
+      if (!result->status.ok()) {
+        return result->status;
+      }
+      *out_tensors = std::move(result->element);
+      RecordBufferDequeue(ctx, *out_tensors);
+      *end_of_sequence = false;
+      return Status::OK();
+    }
+
+   protected:
+    std::shared_ptr<model::Node> CreateNode(
+        IteratorContext* ctx, model::Node::Args args) const override {
+      // The input is read through random access, so it has no iterator which
+      // could be modeled.
+      return model::MakeSourceNode(std::move(args));
+    }
+
+    Status SaveInternal(SerializationContext* ctx,
+                        IteratorStateWriter* writer) override {
+      mutex_lock l(mu_);
+      TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kEpoch), epoch_));
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(full_name(kSeedState), seeds_.first));
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(full_name(kSeed2State), seeds_.second));
+      TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kPosition), position_));
+      return Status::OK();
+    }
+
+    Status RestoreInternal(IteratorContext* ctx,
+                           IteratorStateReader* reader) override {
+      mutex_lock l(mu_);
+      if (runner_thread_) {
+        return errors::FailedPrecondition(
+            "Cannot restore a GlobalShuffleDataset iterator that has started "
+            "producing elements.");
+      }
+      int64_t seed;
+      int64_t seed2;
+      TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kEpoch), &epoch_));
+      TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kSeedState), &seed));
+      TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kSeed2State), &seed2));
+      TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kPosition), &position_));
+      // The seeds are restored as saved rather than derived from the epoch, in
+      // case the dataset seeds were chosen at random.
+      ResetPermutation({seed, seed2});
+      if (dataset()->reshuffle_each_iteration_) {
+        // Later iterators continue from the epoch after the restored one.
+        dataset()->RestoreEpoch(epoch_);
+      }
+      return Status::OK();
+    }
+
+   private:
+    struct Result {
+      bool done = false;
+      Status status;
+      std::vector<Tensor> element;
+    };
+
+    void ResetPermutation(std::pair<int64_t, int64_t> seeds)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      seeds_ = seeds;
+      permutation_ = absl::make_unique<IndexPermutation>(
+          cardinality_, seeds_.first, seeds_.second);
+      next_to_schedule_ = position_;
+      results_.clear();
+    }
+
+    void CancelThreads(bool wait) TF_LOCKS_EXCLUDED(mu_) {
+      mutex_lock l(mu_);
+      cancelled_ = true;
+      cond_var_.notify_all();
+      // Wait for all in-flight calls to complete.
+      while (wait && num_calls_ > 0) {
+        cond_var_.wait(l);
+      }
+    }
+
+    void EnsureRunnerThreadStarted(IteratorContext* ctx)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      if (!runner_thread_) {
+        auto ctx_copy = std::make_shared<IteratorContext>(*ctx);
+        runner_thread_ = ctx->StartThread(
+            "tf_data_global_shuffle",
+            std::bind(&Iterator::RunnerThread, this, ctx_copy));
+      }
+    }
+
+    // Schedules random access reads of the upcoming elements on the runner,
+    // keeping at most `num_parallel_calls_` elements in flight or buffered.
+    void RunnerThread(const std::shared_ptr<IteratorContext>& ctx)
+        TF_LOCKS_EXCLUDED(mu_) {
+      RecordStart(ctx.get());
+      auto cleanup = gtl::MakeCleanup([this, ctx] { RecordStop(ctx.get()); });
+      auto busy = [this]() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) -> bool {
+        return results_.size() >= num_parallel_calls_ ||
+               next_to_schedule_ >= cardinality_;
+      };
+      std::vector<std::pair<int64_t, std::shared_ptr<Result>>> new_calls;
+      while (true) {
+        {
+          mutex_lock l(mu_);
+          while (!cancelled_ && busy()) {
+            RecordStop(ctx.get());
+            cond_var_.wait(l);
+            RecordStart(ctx.get());
+          }
+          if (cancelled_) {
+            return;
+          }
+          while (!busy()) {
+            results_.push_back(std::make_shared<Result>());
+            new_calls.emplace_back((*permutation_)(next_to_schedule_++),
+                                   results_.back());
+            num_calls_++;
+          }
+        }
+        for (auto& call : new_calls) {
+          (*ctx->runner())([this, ctx, index = call.first,
+                            result = std::move(call.second)]() {
+            Status s;
+            std::vector<Tensor> element;
+            if (IsRecording(ctx.get())) {
+              s = GetInputElement(ctx.get(), index, &element);
+            } else {
+              RecordStart(ctx.get());
+              s = GetInputElement(ctx.get(), index, &element);
+              RecordStop(ctx.get());
+            }
+            mutex_lock l(mu_);
+            result->status = s;
+            result->element = std::move(element);
+            result->done = true;
+            RecordBufferEnqueue(ctx.get(), result->element);
+            num_calls_--;
+            cond_var_.notify_all();
+          });
+        }
+        new_calls.clear();
+      }
+    }
+
+    // Reads the element at `index` of the input. `DatasetBase::Get()` takes
+    // an `OpKernelContext`, so one is created from the iterator context.
+    Status GetInputElement(IteratorContext* ctx, int64_t index,
+                           std::vector<Tensor>* out_tensors) {
+      OpKernelContext::Params params;
+      params.device = ctx->flr()->device();
+      params.function_library = ctx->flr();
+      params.resource_manager = ctx->resource_mgr();
+      params.runner = ctx->runner();
+      OpKernelContext op_ctx(&params, /*num_outputs=*/0);
+      return dataset()->input_->Get(&op_ctx, index, out_tensors);
+    }
+
+    const int64_t cardinality_;
+
+    mutex mu_;
+    condition_variable cond_var_;
+    int64_t num_parallel_calls_ TF_GUARDED_BY(mu_) = 1;
+    int64_t epoch_ TF_GUARDED_BY(mu_) = 0;
+    std::pair<int64_t, int64_t> seeds_ TF_GUARDED_BY(mu_);
+    std::unique_ptr<IndexPermutation> permutation_ TF_GUARDED_BY(mu_);
+    // Position in the permutation of the next element to return.
+    int64_t position_ TF_GUARDED_BY(mu_) = 0;
+    // Position in the permutation of the next element to read.
+    int64_t next_to_schedule_ TF_GUARDED_BY(mu_) = 0;
+    // Elements at positions [position_, next_to_schedule_), in order.
+    std::deque<std::shared_ptr<Result>> results_ TF_GUARDED_BY(mu_);
+    int64_t num_calls_ TF_GUARDED_BY(mu_) = 0;
+    bool cancelled_ TF_GUARDED_BY(mu_) = false;
+    std::function<void()> deregister_fn_;
+    std::unique_ptr<Thread> runner_thread_ TF_GUARDED_BY(mu_);
+  };
+
+  // Returns the epoch of a new iterator, used to reshuffle each iteration.
+  int64_t NextEpoch() const {
+    mutex_lock l(mu_);
+    return num_epochs_++;
+  }
+
+  // Makes the next iterator use the epoch after the given one.
+  void RestoreEpoch(int64_t epoch) const {
+    mutex_lock l(mu_);
+    num_epochs_ = epoch + 1;
+  }
+
+  const DatasetBase* const input_;
+  // The seeds the dataset was created with, and the seeds actually used: if
+  // both input seeds are zero, they are replaced by random seeds once, so that
+  // all iterators and `Get()` agree.
+  const std::pair<int64_t, int64_t> input_seeds_;
+  const std::pair<int64_t, int64_t> seeds_;
+  const int64_t num_parallel_calls_;
+  const bool reshuffle_each_iteration_;
+
+  mutable mutex mu_;
+  mutable int64_t num_epochs_ TF_GUARDED_BY(mu_) = 0;
+};
+
+GlobalShuffleDatasetOp::GlobalShuffleDatasetOp(OpKernelConstruction* ctx)
+    : UnaryDatasetOpKernel(ctx) {
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kReshuffleEachIteration,
+                                   &reshuffle_each_iteration_));
+}
+
+void GlobalShuffleDatasetOp::MakeDataset(OpKernelContext* ctx,
+                                         DatasetBase* input,
+                                         DatasetBase** output) {
+  const int64_t cardinality = input->Cardinality();
+  OP_REQUIRES(ctx,
+              cardinality != kInfiniteCardinality &&
+                  cardinality != kUnknownCardinality,
+              errors::InvalidArgument(
+                  "GlobalShuffleDataset requires an input with a finite, "
+                  "known cardinality, but got ",
+                  cardinality));
+  int64_t seed;
+  int64_t seed2;
+  int64_t num_parallel_calls;
+  OP_REQUIRES_OK(ctx, ParseScalarArgument<int64_t>(ctx, kSeed, &seed));
+  OP_REQUIRES_OK(ctx, ParseScalarArgument<int64_t>(ctx, kSeed2, &seed2));
+  OP_REQUIRES_OK(ctx, ParseScalarArgument<int64_t>(ctx, kNumParallelCalls,
+                                                   &num_parallel_calls));
+  OP_REQUIRES(
+      ctx, num_parallel_calls > 0 || num_parallel_calls == model::kAutotune,
+      errors::InvalidArgument("num_parallel_calls must be greater than zero."));
+
+  *output = new Dataset(ctx, input, seed, seed2, num_parallel_calls,
+                        reshuffle_each_iteration_);
+}
+
+namespace {
+REGISTER_KERNEL_BUILDER(Name("GlobalShuffleDataset").Device(DEVICE_CPU),
+                        GlobalShuffleDatasetOp);
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
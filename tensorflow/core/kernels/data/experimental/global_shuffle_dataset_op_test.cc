@@ -0,0 +1,344 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/experimental/global_shuffle_dataset_op.h"
+
+#include <algorithm>
+
+#include "tensorflow/core/data/dataset_test_base.h"
+#include "tensorflow/core/data/index_permutation.h"
+#include "tensorflow/core/data/serialization_utils.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+namespace {
+
+constexpr char kNodeName[] = "global_shuffle_dataset";
+constexpr int64_t kRandomSeed = 42;
+constexpr int64_t kRandomSeed2 = 7;
+
+class GlobalShuffleDatasetParams : public DatasetParams {
+ public:
+  template <typename T>
+  GlobalShuffleDatasetParams(T input_dataset_params, int64_t num_parallel_calls,
+                             bool reshuffle_each_iteration,
+                             DataTypeVector output_dtypes,
+                             std::vector<PartialTensorShape> output_shapes,
+                             string node_name)
+      : DatasetParams(std::move(output_dtypes), std::move(output_shapes),
+                      std::move(node_name)),
+        num_parallel_calls_(num_parallel_calls),
+        reshuffle_each_iteration_(reshuffle_each_iteration) {
+    input_dataset_params_.push_back(absl::make_unique<T>(input_dataset_params));
+    iterator_prefix_ =
+        name_utils::IteratorPrefix(input_dataset_params.dataset_type(),
+                                   input_dataset_params.iterator_prefix());
+  }
+
+  std::vector<Tensor> GetInputTensors() const override {
+    return {CreateTensor<int64_t>(TensorShape({}), {kRandomSeed}),
+            CreateTensor<int64_t>(TensorShape({}), {kRandomSeed2}),
+            CreateTensor<int64_t>(TensorShape({}), {num_parallel_calls_})};
+  }
+
+  Status GetInputNames(std::vector<string>* input_names) const override {
+    *input_names = {GlobalShuffleDatasetOp::kInputDataset,
+                    GlobalShuffleDatasetOp::kSeed,
+                    GlobalShuffleDatasetOp::kSeed2,
+                    GlobalShuffleDatasetOp::kNumParallelCalls};
+    return Status::OK();
+  }
+
+  Status GetAttributes(AttributeVector* attr_vector) const override {
+    *attr_vector = {{GlobalShuffleDatasetOp::kReshuffleEachIteration,
+                     reshuffle_each_iteration_},
+                    {GlobalShuffleDatasetOp::kOutputTypes, output_dtypes_},
+                    {GlobalShuffleDatasetOp::kOutputShapes, output_shapes_}};
+    return Status::OK();
+  }
+
+  string dataset_type() const override {
+    return GlobalShuffleDatasetOp::kDatasetType;
+  }
+
+ private:
+  int64_t num_parallel_calls_;
+  bool reshuffle_each_iteration_;
+};
+
+class GlobalShuffleDatasetOpTest : public DatasetOpsTestBase {};
+
+GlobalShuffleDatasetParams ShuffleRangeParams(int64_t stop,
+                                              int64_t num_parallel_calls,
+                                              bool reshuffle_each_iteration) {
+  return GlobalShuffleDatasetParams(RangeDatasetParams(0, stop, 1),
+                                    num_parallel_calls,
+                                    reshuffle_each_iteration,
+                                    /*output_dtypes=*/{DT_INT64},
+                                    /*output_shapes=*/{PartialTensorShape({})},
+                                    /*node_name=*/kNodeName);
+}
+
+GlobalShuffleDatasetParams GlobalShuffleDatasetParams1() {
+  return ShuffleRangeParams(/*stop=*/10, /*num_parallel_calls=*/1,
+                            /*reshuffle_each_iteration=*/false);
+}
+
+GlobalShuffleDatasetParams GlobalShuffleDatasetParams2() {
+  return ShuffleRangeParams(/*stop=*/100, /*num_parallel_calls=*/4,
+                            /*reshuffle_each_iteration=*/false);
+}
+
+GlobalShuffleDatasetParams GlobalShuffleDatasetParams3() {
+  return ShuffleRangeParams(/*stop=*/100, model::kAutotune,
+                            /*reshuffle_each_iteration=*/false);
+}
+
+GlobalShuffleDatasetParams EmptyInputParams() {
+  return ShuffleRangeParams(/*stop=*/0, /*num_parallel_calls=*/2,
+                            /*reshuffle_each_iteration=*/false);
+}
+
+GlobalShuffleDatasetParams InvalidNumParallelCallsParams() {
+  return ShuffleRangeParams(/*stop=*/10, /*num_parallel_calls=*/0,
+                            /*reshuffle_each_iteration=*/false);
+}
+
+// Returns the range [0, stop) in the order of the first epoch's permutation.
+std::vector<Tensor> ShuffledRange(int64_t stop) {
+  IndexPermutation permutation(stop, kRandomSeed, kRandomSeed2);
+  std::vector<Tensor> outputs;
+  for (int64_t i = 0; i < stop; ++i) {
+    outputs.push_back(CreateTensor<int64_t>(TensorShape({}), {permutation(i)}));
+  }
+  return outputs;
+}
+
+std::vector<GetNextTestCase<GlobalShuffleDatasetParams>> GetNextTestCases() {
+  return {{/*dataset_params=*/GlobalShuffleDatasetParams1(),
+           /*expected_outputs=*/ShuffledRange(10)},
+          {/*dataset_params=*/GlobalShuffleDatasetParams2(),
+           /*expected_outputs=*/ShuffledRange(100)},
+          {/*dataset_params=*/GlobalShuffleDatasetParams3(),
+           /*expected_outputs=*/ShuffledRange(100)},
+          {/*dataset_params=*/EmptyInputParams(),
+           /*expected_outputs=*/{}}};
+}
+
+ITERATOR_GET_NEXT_TEST_P(GlobalShuffleDatasetOpTest, GlobalShuffleDatasetParams,
+                         GetNextTestCases())
+
+TEST_F(GlobalShuffleDatasetOpTest, DatasetNodeName) {
+  auto dataset_params = GlobalShuffleDatasetParams1();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(CheckDatasetNodeName(dataset_params.node_name()));
+}
+
+TEST_F(GlobalShuffleDatasetOpTest, DatasetTypeString) {
+  auto dataset_params = GlobalShuffleDatasetParams1();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(CheckDatasetTypeString(
+      name_utils::OpName(GlobalShuffleDatasetOp::kDatasetType)));
+}
+
+TEST_F(GlobalShuffleDatasetOpTest, DatasetOutputDtypes) {
+  auto dataset_params = GlobalShuffleDatasetParams1();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(CheckDatasetOutputDtypes({DT_INT64}));
+}
+
+TEST_F(GlobalShuffleDatasetOpTest, DatasetOutputShapes) {
+  auto dataset_params = GlobalShuffleDatasetParams1();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(CheckDatasetOutputShapes({PartialTensorShape({})}));
+}
+
+std::vector<CardinalityTestCase<GlobalShuffleDatasetParams>>
+CardinalityTestCases() {
+  return {{/*dataset_params=*/GlobalShuffleDatasetParams1(),
+           /*expected_cardinality=*/10},
+          {/*dataset_params=*/GlobalShuffleDatasetParams2(),
+           /*expected_cardinality=*/100},
+          {/*dataset_params=*/EmptyInputParams(),
+           /*expected_cardinality=*/0}};
+}
+
+DATASET_CARDINALITY_TEST_P(GlobalShuffleDatasetOpTest,
+                           GlobalShuffleDatasetParams, CardinalityTestCases())
+
+TEST_F(GlobalShuffleDatasetOpTest, IteratorPrefix) {
+  auto dataset_params = GlobalShuffleDatasetParams1();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(CheckIteratorPrefix(
+      name_utils::IteratorPrefix(GlobalShuffleDatasetOp::kDatasetType,
+                                 dataset_params.iterator_prefix())));
+}
+
+std::vector<IteratorSaveAndRestoreTestCase<GlobalShuffleDatasetParams>>
+IteratorSaveAndRestoreTestCases() {
+  return {{/*dataset_params=*/GlobalShuffleDatasetParams1(),
+           /*breakpoints=*/{0, 4, 11},
+           /*expected_outputs=*/ShuffledRange(10)},
+          {/*dataset_params=*/GlobalShuffleDatasetParams2(),
+           /*breakpoints=*/{0, 1, 50, 99, 100},
+           /*expected_outputs=*/ShuffledRange(100)}};
+}
+
+ITERATOR_SAVE_AND_RESTORE_TEST_P(GlobalShuffleDatasetOpTest,
+                                 GlobalShuffleDatasetParams,
+                                 IteratorSaveAndRestoreTestCases())
+
+TEST_F(GlobalShuffleDatasetOpTest, InvalidNumParallelCalls) {
+  auto dataset_params = InvalidNumParallelCallsParams();
+  EXPECT_EQ(Initialize(dataset_params).code(),
+            tensorflow::error::INVALID_ARGUMENT);
+}
+
+// Reads all the elements of a new iterator over `dataset`.
+Status GetEpoch(DatasetBase* dataset,
+                IteratorContext* ctx, const string& prefix,
+                std::vector<int64_t>* values) {
+  std::unique_ptr<IteratorBase> iterator;
+  TF_RETURN_IF_ERROR(
+      dataset->MakeIterator(ctx, /*parent=*/nullptr, prefix, &iterator));
+  bool end_of_sequence = false;
+  while (true) {
+    std::vector<Tensor> next;
+    TF_RETURN_IF_ERROR(iterator->GetNext(ctx, &next, &end_of_sequence));
+    if (end_of_sequence) break;
+    values->push_back(next[0].scalar<int64_t>()());
+  }
+  return Status::OK();
+}
+
+TEST_F(GlobalShuffleDatasetOpTest, ReshuffleEachIteration) {
+  constexpr int64_t kNumElements = 100;
+  auto dataset_params = ShuffleRangeParams(kNumElements,
+                                           /*num_parallel_calls=*/4,
+                                           /*reshuffle_each_iteration=*/true);
+  TF_ASSERT_OK(Initialize(dataset_params));
+  std::vector<int64_t> epoch1, epoch2;
+  TF_ASSERT_OK(GetEpoch(dataset_, iterator_ctx_.get(),
+                        dataset_params.iterator_prefix(), &epoch1));
+  TF_ASSERT_OK(GetEpoch(dataset_, iterator_ctx_.get(),
+                        dataset_params.iterator_prefix(), &epoch2));
+  EXPECT_NE(epoch1, epoch2);
+  std::sort(epoch1.begin(), epoch1.end());
+  std::sort(epoch2.begin(), epoch2.end());
+  EXPECT_EQ(epoch1, epoch2);
+  for (int64_t i = 0; i < kNumElements; ++i) {
+    EXPECT_EQ(epoch1[i], i);
+  }
+}
+
+TEST_F(GlobalShuffleDatasetOpTest, ReshuffleEachIterationAfterRestore) {
+  constexpr int64_t kNumElements = 100;
+  constexpr int kBreakpoint = 30;
+  auto dataset_params = ShuffleRangeParams(kNumElements,
+                                           /*num_parallel_calls=*/4,
+                                           /*reshuffle_each_iteration=*/true);
+  TF_ASSERT_OK(Initialize(dataset_params));
+  const string& prefix = dataset_params.iterator_prefix();
+  std::vector<int64_t> epoch1;
+  TF_ASSERT_OK(GetEpoch(dataset_, iterator_ctx_.get(), prefix, &epoch1));
+
+  // Checkpoint the second epoch part way through.
+  std::unique_ptr<IteratorBase> iterator;
+  TF_ASSERT_OK(dataset_->MakeIterator(iterator_ctx_.get(), /*parent=*/nullptr,
+                                      prefix, &iterator));
+  std::vector<int64_t> epoch2;
+  bool end_of_sequence = false;
+  for (int i = 0; i < kBreakpoint; ++i) {
+    std::vector<Tensor> next;
+    TF_ASSERT_OK(
+        iterator->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+    epoch2.push_back(next[0].scalar<int64_t>()());
+  }
+  std::unique_ptr<SerializationContext> serialization_ctx;
+  TF_ASSERT_OK(CreateSerializationContext(&serialization_ctx));
+  VariantTensorDataWriter writer;
+  TF_ASSERT_OK(iterator->Save(serialization_ctx.get(), &writer));
+  while (true) {
+    std::vector<Tensor> next;
+    TF_ASSERT_OK(
+        iterator->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+    if (end_of_sequence) break;
+    epoch2.push_back(next[0].scalar<int64_t>()());
+  }
+  std::vector<int64_t> epoch3;
+  TF_ASSERT_OK(GetEpoch(dataset_, iterator_ctx_.get(), prefix, &epoch3));
+
+  // A new dataset restored from the checkpoint finishes the second epoch, and
+  // then continues with the third one.
+  std::unique_ptr<TestDataset> restored_dataset;
+  TF_ASSERT_OK(MakeDataset(dataset_params, &restored_dataset));
+  std::vector<const VariantTensorData*> data;
+  writer.GetData(&data);
+  VariantTensorDataReader reader(data);
+  std::unique_ptr<IteratorBase> restored_iterator;
+  TF_ASSERT_OK(RestoreIterator(iterator_ctx_.get(), &reader, prefix,
+                               *restored_dataset->dataset(),
+                               &restored_iterator));
+  std::vector<int64_t> restored_epoch2(epoch2.begin(),
+                                       epoch2.begin() + kBreakpoint);
+  while (true) {
+    std::vector<Tensor> next;
+    TF_ASSERT_OK(restored_iterator->GetNext(iterator_ctx_.get(), &next,
+                                            &end_of_sequence));
+    if (end_of_sequence) break;
+    restored_epoch2.push_back(next[0].scalar<int64_t>()());
+  }
+  EXPECT_EQ(restored_epoch2, epoch2);
+  std::vector<int64_t> restored_epoch3;
+  TF_ASSERT_OK(GetEpoch(restored_dataset->dataset(), iterator_ctx_.get(),
+                        prefix, &restored_epoch3));
+  EXPECT_EQ(restored_epoch3, epoch3);
+  EXPECT_NE(epoch3, epoch2);
+}
+
+TEST_F(GlobalShuffleDatasetOpTest, GetMatchesFirstIteration) {
+  constexpr int64_t kNumElements = 100;
+  auto dataset_params = ShuffleRangeParams(kNumElements,
+                                           /*num_parallel_calls=*/4,
+                                           /*reshuffle_each_iteration=*/true);
+  TF_ASSERT_OK(Initialize(dataset_params));
+  std::vector<int64_t> epoch1, epoch2;
+  TF_ASSERT_OK(GetEpoch(dataset_, iterator_ctx_.get(),
+                        dataset_params.iterator_prefix(), &epoch1));
+  TF_ASSERT_OK(GetEpoch(dataset_, iterator_ctx_.get(),
+                        dataset_params.iterator_prefix(), &epoch2));
+  ASSERT_EQ(epoch1.size(), kNumElements);
+  for (int64_t i = 0; i < kNumElements; ++i) {
+    std::vector<Tensor> element;
+    TF_ASSERT_OK(dataset_->Get(dataset_ctx_.get(), i, &element));
+    EXPECT_EQ(element[0].scalar<int64_t>()(), epoch1[i]);
+  }
+}
+
+TEST_F(GlobalShuffleDatasetOpTest, SameOrderWithoutReshuffle) {
+  auto dataset_params = GlobalShuffleDatasetParams2();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  std::vector<int64_t> epoch1, epoch2;
+  TF_ASSERT_OK(GetEpoch(dataset_, iterator_ctx_.get(),
+                        dataset_params.iterator_prefix(), &epoch1));
+  TF_ASSERT_OK(GetEpoch(dataset_, iterator_ctx_.get(),
+                        dataset_params.iterator_prefix(), &epoch2));
+  EXPECT_EQ(epoch1, epoch2);
+}
+
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
@@ -332,7 +332,7 @@ class MatchingFilesDatasetOp : public DatasetOpKernel {
 
           BlockingCounter counter(children.size());
           for (int i = 0; i < children.size(); i++) {
-            (*ctx->runner())([&is_directory_fn, &counter, i] {
+            ctx->ScheduleBlocking([&is_directory_fn, &counter, i] {
               is_directory_fn(i);
               counter.DecrementCount();
             });
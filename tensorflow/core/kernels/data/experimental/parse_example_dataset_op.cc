@@ -26,6 +26,7 @@ limitations under the License.
 #include "tensorflow/core/platform/stringprintf.h"
 #include "tensorflow/core/profiler/lib/traceme.h"
 #include "tensorflow/core/profiler/lib/traceme_encode.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/example_proto_fast_parsing.h"
 
 namespace tensorflow {
@@ -83,6 +84,10 @@ class ParseExampleDatasetOp : public UnaryDatasetOpKernel {
       OP_REQUIRES_OK(ctx,
                      ctx->GetAttr("ragged_split_types", &ragged_split_types_));
     }
+    // Opt-in for the two-pass columnar parser, see
+    // `FastParseExampleConfig::columnar`.
+    OP_REQUIRES_OK(ctx, ReadBoolFromEnvVar("TF_PARSE_EXAMPLE_COLUMNAR",
+                                           /*default_val=*/false, &columnar_));
     for (int i = 0; i < dense_shapes_.size(); ++i) {
       bool shape_ok = true;
       if (dense_shapes_[i].dims() == -1) {
@@ -167,6 +172,7 @@ class ParseExampleDatasetOp : public UnaryDatasetOpKernel {
     }
 
     example::FastParseExampleConfig config;
+    config.columnar = columnar_;
     std::map<string, int> key_to_output_index;
     for (int d = 0; d < dense_keys_.size(); ++d) {
       config.dense.push_back({dense_keys_[d], dense_types_[d], dense_shapes_[d],
@@ -949,6 +955,7 @@ class ParseExampleDatasetOp : public UnaryDatasetOpKernel {
   std::vector<bool> variable_length_;
   std::vector<std::size_t> elements_per_stride_;
   bool has_ragged_keys_;
+  bool columnar_ = false;
   const int op_version_;
 };
 
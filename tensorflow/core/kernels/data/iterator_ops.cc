@@ -28,6 +28,7 @@ limitations under the License.
 #include "tensorflow/core/data/captured_function.h"
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/data/root_dataset.h"
+#include "tensorflow/core/data/runtime_scheduler.h"
 #include "tensorflow/core/data/serialization_utils.h"
 #include "tensorflow/core/framework/cancellation.h"
 #include "tensorflow/core/framework/function.h"
@@ -73,6 +74,9 @@ const char kIteratorVariantTypeName[] = "tensorflow::Iterator";
 const char kOutputShapes[] = "output_shapes";
 const char kOutputTypes[] = "output_types";
 
+// Runs iterators on the threads of the shared tf.data runtime scheduler.
+const char kRuntimeSchedulerExperiment[] = "runtime_scheduler";
+
 // Safely subtracts x from y avoiding underflow.
 inline uint64 safe_sub(uint64 x, uint64 y) { return x >= y ? x - y : 0; }
 
@@ -89,6 +93,8 @@ IteratorResource::IteratorResource(
     std::unique_ptr<ProcessFunctionLibraryRuntime> pflr,
     FunctionLibraryRuntime* flr)
     : unbounded_thread_pool_(env, "tf_data_iterator_resource"),
+      use_runtime_scheduler_(
+          GetExperiments().contains(kRuntimeSchedulerExperiment)),
       device_mgr_(std::move(device_mgr)),
       iterator_state_(std::make_shared<State>(std::move(flib_def),
                                               std::move(pflr), flr,
@@ -106,6 +112,19 @@ IteratorResource::~IteratorResource() {
   VLOG(2) << "destroying iterator resource";
 }
 
+void IteratorResource::SetThreadParams(IteratorContext::Params* params) {
+  if (use_runtime_scheduler_) {
+    RuntimeScheduler* scheduler = RuntimeScheduler::Global();
+    params->thread_factory = scheduler->get_thread_factory();
+    params->thread_pool = scheduler->dedicated_pool();
+    params->compute_pool = scheduler->compute_pool();
+    params->blocking_pool = scheduler->blocking_pool();
+  } else {
+    params->thread_factory = unbounded_thread_pool_.get_thread_factory();
+    params->thread_pool = &unbounded_thread_pool_;
+  }
+}
+
 Status IteratorResource::GetNext(OpKernelContext* ctx,
                                  std::vector<Tensor>* out_tensors,
                                  bool* end_of_sequence) {
@@ -124,8 +143,7 @@ Status IteratorResource::GetNext(OpKernelContext* ctx,
   params.flr = captured_state->flr();
   params.function_handle_cache = captured_state->function_handle_cache();
   params.resource_mgr = captured_state->resource_mgr();
-  params.thread_factory = unbounded_thread_pool_.get_thread_factory();
-  params.thread_pool = &unbounded_thread_pool_;
+  SetThreadParams(&params);
   params.cancellation_manager = captured_state->cancellation_manager();
   std::function<void()> deregister_fn;
   TF_RETURN_IF_ERROR(RegisterCancellationCallback(
@@ -212,8 +230,7 @@ Status IteratorResource::Restore(OpKernelContext* ctx,
   params.flr = new_state->flr();
   params.function_handle_cache = new_state->function_handle_cache();
   params.resource_mgr = new_state->resource_mgr();
-  params.thread_factory = unbounded_thread_pool_.get_thread_factory();
-  params.thread_pool = &unbounded_thread_pool_;
+  SetThreadParams(&params);
   params.cancellation_manager = new_state->cancellation_manager();
   std::function<void()> deregister_fn;
   TF_RETURN_IF_ERROR(RegisterCancellationCallback(
@@ -247,8 +264,7 @@ Status IteratorResource::SetIteratorFromDataset(OpKernelContext* ctx,
   params.flr = new_state->flr();
   params.function_handle_cache = new_state->function_handle_cache();
   params.resource_mgr = new_state->resource_mgr();
-  params.thread_factory = unbounded_thread_pool_.get_thread_factory();
-  params.thread_pool = &unbounded_thread_pool_;
+  SetThreadParams(&params);
   params.cancellation_manager = new_state->cancellation_manager();
   std::function<void()> deregister_fn;
   TF_RETURN_IF_ERROR(RegisterCancellationCallback(
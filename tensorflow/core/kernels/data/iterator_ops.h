@@ -121,7 +121,13 @@ class IteratorResource : public ResourceBase {
     std::unique_ptr<DatasetBaseIterator> iterator_;
   };
 
+  // Configures the threads used by the iterator, which run either on the
+  // shared tf.data runtime scheduler or on `unbounded_thread_pool_`.
+  void SetThreadParams(IteratorContext::Params* params);
+
   UnboundedThreadPool unbounded_thread_pool_;
+  // Whether the iterator runs on the shared tf.data runtime scheduler.
+  const bool use_runtime_scheduler_;
   mutex mu_;
   // Records the number of currently active `GetNext()` calls.
   uint64 num_get_next_calls_ TF_GUARDED_BY(mu_) = 0;
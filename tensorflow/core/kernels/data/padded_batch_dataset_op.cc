@@ -377,8 +377,8 @@ class PaddedBatchDatasetOp::Dataset : public DatasetBase {
             // evenly, the size of some slices is incremented to guarantee their
             // sizes add up to the total number of elements.
             if (i < num_batch_elements % num_threads) ++length;
-            (*ctx->runner())([offset, length, &status, &status_mu, &counter,
-                              &copy_element_fn]() {
+            ctx->ScheduleCompute([offset, length, &status, &status_mu,
+                                  &counter, &copy_element_fn]() {
               for (size_t j = offset; j < offset + length; ++j) {
                 {
                   Status s = copy_element_fn(j);
@@ -104,6 +104,8 @@ class ParallelBatchDatasetOp::Dataset : public DatasetBase {
             PartialTensorShape({-1}).Concatenate(input_shape));
       }
     }
+    batch_in_place_ = CanBatchInPlace(input_, batch_size_, drop_remainder_,
+                                      parallel_copy_);
   }
 
   ~Dataset() override { input_->Unref(); }
@@ -367,6 +369,11 @@ class ParallelBatchDatasetOp::Dataset : public DatasetBase {
         return;
       }
 
+      if (dataset()->batch_in_place_) {
+        CallBatchingInPlace(ctx, result);
+        return;
+      }
+
       // Each row of `batch_elements` is a tuple of tensors from the input
       // iterator.
       auto batch_elements =
@@ -421,6 +428,47 @@ class ParallelBatchDatasetOp::Dataset : public DatasetBase {
       (*ctx->runner())(copy_elements_fn);
     }
 
+    // Preallocates the batch and has the input iterator write each element
+    // into its slice. Unlike the copies of `CallBatching()`, the writes are not
+    // parallelized across batches, but the elements of a batch are never held
+    // in memory together with the batch.
+    void CallBatchingInPlace(const std::shared_ptr<IteratorContext>& ctx,
+                             const std::shared_ptr<BatchResult>& result)
+        TF_LOCKS_EXCLUDED(*mu_) {
+      std::vector<Tensor> batch;
+      Status status = AllocateBatch(
+          CopyBatchParams(ctx.get()), dataset()->batch_size_,
+          dataset()->input_->output_dtypes(),
+          dataset()->input_->output_shapes(), &batch);
+      {
+        mutex_lock l(result->mu);
+        result->status.Update(status);
+        if (status.ok()) {
+          // The result shares the buffers that the input writes into.
+          result->output = batch;
+          result->output_allocated = true;
+          RecordBufferEnqueue(ctx.get(), result->output);
+        }
+      }
+      bool end_of_input = false;
+      for (int64_t i = 0;
+           status.ok() && i < dataset()->batch_size_ && !end_of_input; ++i) {
+        status = input_impl_->GetNextIntoSlice(ctx.get(), i, &batch,
+                                               &end_of_input);
+        mutex_lock l(result->mu);
+        result->end_of_input = result->end_of_input || end_of_input;
+        result->status.Update(status);
+        if (status.ok() && !end_of_input) {
+          result->num_elements++;
+        }
+      }
+      if (end_of_input) {
+        input_impl_.reset();
+      }
+      batch.clear();
+      CallCompleted(ctx, result);
+    }
+
     void CancelThreads(bool wait) TF_LOCKS_EXCLUDED(mu_) {
       cancellation_manager_->StartCancel();
       mutex_lock l(*mu_);
@@ -626,6 +674,8 @@ class ParallelBatchDatasetOp::Dataset : public DatasetBase {
   const bool drop_remainder_;
   const bool parallel_copy_;
   const DatasetBase* const input_;
+  // Whether batches are assembled with `CallBatchingInPlace()`.
+  bool batch_in_place_ = false;
   std::vector<PartialTensorShape> output_shapes_;
   const DeterminismPolicy deterministic_;
   const TraceMeMetadata traceme_metadata_;
@@ -29,6 +29,7 @@ limitations under the License.
 #include "tensorflow/core/data/name_utils.h"
 #include "tensorflow/core/data/stats_utils.h"
 #include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/memory_accountant.h"
 #include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/framework/model.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
@@ -549,6 +550,9 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
       Status status;
       int64_t id = -1;
       std::vector<Tensor> return_values;
+      // The number of bytes reserved for `return_values` against the memory
+      // budget.
+      int64_t reserved_bytes = 0;
     };
 
     // The interleave transformation repeatedly inputs elements, applies the
@@ -557,6 +561,9 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
     //
     // This structure represents an input element and derived state.
     struct Element {
+      explicit Element(std::shared_ptr<MemoryAccountant::Pipeline> pipeline)
+          : reservation(std::move(pipeline)) {}
+
       // Unique identifier, needed to support checkpointing.
       int64_t id TF_GUARDED_BY(&ParallelInterleaveIterator::mu_);
       // The actual input element.  Iterator created from the input element. A
@@ -583,9 +590,18 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
       // Whether we tried to initialize the element, but the input iterator
       // was exhausted so we could produce no inputs.
       bool no_input TF_GUARDED_BY(&ParallelInterleaveIterator::mu_) = false;
+      // Whether the results of the element exceed its share of the tf.data
+      // memory budget, so that it is not processed again until one of its
+      // results is consumed.
+      bool over_budget TF_GUARDED_BY(&ParallelInterleaveIterator::mu_) =
+          false;
       // Condition variable for communicating between current worker threads
       // and GetNext.
       condition_variable cond_var;
+      // Accounts for `results` against the tf.data memory budget. Each element
+      // has its own reservation so that an element whose results have all been
+      // consumed can always produce the next result.
+      MemoryReservation reservation;
 
       std::string DebugString()
           TF_EXCLUSIVE_LOCKS_REQUIRED(&ParallelInterleaveIterator::mu_) {
@@ -712,6 +728,8 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
           // We found a result.
           std::swap(*result, element->results.front());
           element->results.pop_front();
+          element->reservation.Release((*result)->reserved_bytes);
+          element->over_budget = false;
           if (!element->active) {
             elements_to_process_.push_back(cycle_index_);
             current_workers_cond_var_.notify_one();
@@ -768,7 +786,7 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
       if (end_of_input_) {
         return nullptr;
       }
-      auto element = std::make_shared<Element>();
+      auto element = std::make_shared<Element>(ctx_->memory_pipeline());
       element->id = element_id_counter_++;
       uninitialized_elements_.push_back(element);
       return element;
@@ -1000,11 +1018,24 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
           NotifyElementUpdate(element);
           break;
         }
+        // Waiting for memory would hold on to the worker thread. Instead, a
+        // result which does not fit into the tf.data memory budget is buffered
+        // anyway, and the element is not processed again until one of its
+        // results is consumed.
+        const int64_t bytes = GetAllocatedBytes(result->return_values);
+        const bool within_budget = element->reservation.TryReserve(bytes);
+        if (!within_budget) {
+          element->reservation.ForceReserve(bytes);
+          metrics::RecordTFDataMemoryBackpressure();
+        }
+        result->reserved_bytes = bytes;
         RecordBufferEnqueue(ctx_.get(), result->return_values);
         mutex_lock l(*mu_);
         element->results.push_back(std::move(result));
+        element->over_budget = !within_budget;
         NotifyElementUpdate(element);
-        if (element->results.size() == dataset()->buffer_output_elements_) {
+        if (element->over_budget ||
+            element->results.size() == dataset()->buffer_output_elements_) {
           break;
         }
       }
@@ -1105,7 +1136,7 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
       if (!element->initialized) {
         return true;
       }
-      return element->iterator &&
+      return element->iterator && !element->over_budget &&
              element->results.size() < dataset()->buffer_output_elements_;
     }
 
@@ -1292,7 +1323,7 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
                        int idx, const string& key_prefix,
                        std::shared_ptr<Element>* out) {
       std::unique_ptr<IteratorBase> iterator;
-      auto element = std::make_shared<Element>();
+      auto element = std::make_shared<Element>(ctx->memory_pipeline());
       {
         mutex_lock l(*mu_);
         const auto& iterator_name =
@@ -1324,6 +1355,8 @@ class ParallelInterleaveDatasetOp::Dataset : public DatasetBase {
                 &result->return_values.back()));
           }
           RecordBufferEnqueue(ctx, result->return_values);
+          result->reserved_bytes = GetAllocatedBytes(result->return_values);
+          element->reservation.ForceReserve(result->reserved_bytes);
           element->results[i] = std::move(result);
         }
         if (!reader->Contains(iterator_name,
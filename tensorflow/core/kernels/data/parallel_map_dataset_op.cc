@@ -21,6 +21,7 @@ limitations under the License.
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/data/name_utils.h"
 #include "tensorflow/core/data/stats_utils.h"
+#include "tensorflow/core/framework/memory_accountant.h"
 #include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/framework/model.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
@@ -234,6 +235,8 @@ class ParallelMapDatasetOp::Dataset : public DatasetBase {
         num_parallel_calls_->value = ctx->runner_threadpool_size();
       }
       cancellation_manager_ = absl::make_unique<CancellationManager>();
+      memory_reservation_ =
+          absl::make_unique<MemoryReservation>(ctx->memory_pipeline());
       TF_RETURN_IF_ERROR(RegisterCancellationCallback(
           ctx->cancellation_manager(),
           [this]() { CancelThreads(/*wait=*/false); }, &deregister_fn_));
@@ -355,6 +358,8 @@ class ParallelMapDatasetOp::Dataset : public DatasetBase {
         }
         result.end_of_input = reader->Contains(element_prefix, kEndOfInput);
         RecordBufferEnqueue(ctx, result.return_values);
+        result.reserved_bytes = GetAllocatedBytes(result.return_values);
+        memory_reservation_->ForceReserve(result.reserved_bytes);
         result.notification.Notify();
       }
       return Status::OK();
@@ -392,6 +397,9 @@ class ParallelMapDatasetOp::Dataset : public DatasetBase {
       Status status;
       std::vector<Tensor> return_values;
       bool end_of_input = false;
+      // The number of bytes reserved for `return_values` against the memory
+      // budget.
+      int64_t reserved_bytes = 0;
       const int64_t uid;
     };
 
@@ -449,6 +457,10 @@ class ParallelMapDatasetOp::Dataset : public DatasetBase {
       auto done = [this, ctx, result](Status status) {
         result->status.Update(status);
         RecordBufferEnqueue(ctx.get(), result->return_values);
+        // The result already exists, so it is accounted for without waiting.
+        // The runner thread applies backpressure before scheduling new calls.
+        result->reserved_bytes = GetAllocatedBytes(result->return_values);
+        memory_reservation_->ForceReserve(result->reserved_bytes);
         CallCompleted(ctx, result);
       };
 
@@ -460,8 +472,10 @@ class ParallelMapDatasetOp::Dataset : public DatasetBase {
             std::move(done), model_node());
       } else {
         // In this case, the function will be executed using single-threaded
-        // executor. We schedule it using `ctx->runner()` to enable concurrent
-        // application of the function over different input elements.
+        // executor. We schedule it using `ctx->ScheduleCompute()` to enable
+        // concurrent application of the function over different input
+        // elements. With a runtime scheduler, the calls of all pipelines share
+        // its compute pool, and otherwise they run on `ctx->runner()`.
         auto fn = std::bind(
             [this, ctx, result](std::vector<Tensor> input_element) {
               return instantiated_captured_func_->Run(
@@ -469,7 +483,7 @@ class ParallelMapDatasetOp::Dataset : public DatasetBase {
                   model_node());
             },
             std::move(input_element));
-        (*ctx->runner())(
+        ctx->ScheduleCompute(
             [this, ctx, fn = std::move(fn), done = std::move(done)]() {
               Status s;
               // Check whether we are already recording to prevent invalid
@@ -490,6 +504,7 @@ class ParallelMapDatasetOp::Dataset : public DatasetBase {
                          const std::shared_ptr<InvocationResult>& result,
                          std::vector<Tensor>* out_tensors,
                          bool* end_of_sequence) TF_LOCKS_EXCLUDED(*mu_) {
+      memory_reservation_->Release(result->reserved_bytes);
       if (!result->end_of_input && result->status.ok()) {
         *out_tensors = std::move(result->return_values);
         RecordBufferDequeue(ctx, *out_tensors);
@@ -530,6 +545,17 @@ class ParallelMapDatasetOp::Dataset : public DatasetBase {
                invocation_results_.size() >= num_parallel_calls;
       };
       while (true) {
+        // Wait while the buffered results exceed this iterator's share of the
+        // tf.data memory budget.
+        if (!memory_reservation_->TryReserve(0)) {
+          RecordStop(ctx.get());
+          Status s =
+              memory_reservation_->Reserve(0, cancellation_manager_.get());
+          RecordStart(ctx.get());
+          if (!s.ok()) {
+            return;
+          }
+        }
         {
           mutex_lock l(*mu_);
           while (!cancelled_ && busy()) {
@@ -661,6 +687,8 @@ class ParallelMapDatasetOp::Dataset : public DatasetBase {
     // Controls cancellation of `input_impl_`. Must be ordered before
     // `input_impl_` so that `input_impl_` is destroyed first.
     std::unique_ptr<CancellationManager> cancellation_manager_;
+    // Accounts for the buffered results against the tf.data memory budget.
+    std::unique_ptr<MemoryReservation> memory_reservation_;
     std::unique_ptr<InstantiatedCapturedFunction> instantiated_captured_func_;
     // Must be ordered after `cancellation_manager_` so that `input_impl_` is
     // destroyed first.
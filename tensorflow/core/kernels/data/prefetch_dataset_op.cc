@@ -20,6 +20,7 @@ limitations under the License.
 #include "tensorflow/core/data/name_utils.h"
 #include "tensorflow/core/data/stats_utils.h"
 #include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/memory_accountant.h"
 #include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/framework/model.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
@@ -160,6 +161,8 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
         buffer_size_->value = buffer_size_min_;
       }
       cancellation_manager_ = absl::make_unique<CancellationManager>();
+      memory_reservation_ =
+          absl::make_unique<MemoryReservation>(ctx->memory_pipeline());
       TF_RETURN_IF_ERROR(RegisterCancellationCallback(
           ctx->cancellation_manager(), [this]() { CancelThreads(); },
           &deregister_fn_));
@@ -298,6 +301,9 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
                                    absl::StrCat(kBuffer, "[", j, "]"),
                                    &buffer_element.value.back()));
           }
+          buffer_element.reserved_bytes =
+              GetAllocatedBytes(buffer_element.value);
+          memory_reservation_->ForceReserve(buffer_element.reserved_bytes);
         }
         RecordBufferEnqueue(ctx, buffer_element.value);
       }
@@ -357,6 +363,8 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
       Status status;
       // The buffered data element.
       std::vector<Tensor> value;
+      // The number of bytes reserved for `value` against the memory budget.
+      int64_t reserved_bytes = 0;
       int64_t created_us;
       const uint64 uid;
     };
@@ -428,6 +436,7 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
         auto_tuner_.RecordConsumption(buffer_.size());
         buffer_size_->value = auto_tuner_.buffer_limit();
       }
+      memory_reservation_->Release(buffer_.front().reserved_bytes);
       buffer_.pop_front();
       *end_of_sequence = false;
 
@@ -509,7 +518,26 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
           return;
         }
 
-        // 3. Signal that the element has been produced.
+        // 3. Reserve memory for the element, waiting for other buffers to
+        // drain if the tf.data memory budget is exhausted.
+        if (buffer_element.status.ok()) {
+          const int64_t bytes = GetAllocatedBytes(buffer_element.value);
+          if (!memory_reservation_->TryReserve(bytes)) {
+            RecordStop(ctx.get());
+            Status s = memory_reservation_->Reserve(
+                bytes, cancellation_manager_.get());
+            RecordStart(ctx.get());
+            if (!s.ok()) {
+              mutex_lock l(*mu_);
+              prefetch_thread_finished_ = true;
+              cond_var_->notify_all();
+              return;
+            }
+          }
+          buffer_element.reserved_bytes = bytes;
+        }
+
+        // 4. Signal that the element has been produced.
         {
           mutex_lock l(*mu_);
           RecordBufferEnqueue(ctx.get(), buffer_element.value);
@@ -571,6 +599,10 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
     // Controls cancellation of `input_impl_`. Must be ordered before
     // `input_impl_` so that `input_impl_` is destroyed first.
     std::unique_ptr<CancellationManager> cancellation_manager_;
+    // Accounts for the buffered elements against the tf.data memory budget.
+    // Must be ordered before `buffer_` and `prefetch_thread_` so that it
+    // outlives them.
+    std::unique_ptr<MemoryReservation> memory_reservation_;
     std::unique_ptr<IteratorBase> input_impl_ TF_GUARDED_BY(input_mu_);
     const std::shared_ptr<condition_variable> cond_var_;
     const int64_t buffer_size_min_;
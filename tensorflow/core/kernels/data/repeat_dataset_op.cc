@@ -14,6 +14,7 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/repeat_dataset_op.h"
 
+#include <functional>
 #include <utility>
 
 #include "tensorflow/core/data/name_utils.h"
@@ -91,6 +92,10 @@ class RepeatDatasetOp::Dataset : public DatasetBase {
     return count_ * n;
   }
 
+  bool SupportsGetNextIntoSlice() const override {
+    return input_->SupportsGetNextIntoSlice();
+  }
+
   Status InputDatasets(std::vector<const DatasetBase*>* inputs) const override {
     inputs->push_back(input_);
     return Status::OK();
@@ -159,27 +164,20 @@ class RepeatDatasetOp::Dataset : public DatasetBase {
     Status GetNextInternal(IteratorContext* ctx,
                            std::vector<Tensor>* out_tensors,
                            bool* end_of_sequence) override {
-      mutex_lock l(mu_);  // TODO(mrry): Make locking less conservative.
-      if (!input_impl_) {
-        *end_of_sequence = true;
-        return Status::OK();
-      }
-      while (i_ < dataset()->count_) {
-        TF_RETURN_IF_ERROR(
-            input_impl_->GetNext(ctx, out_tensors, end_of_sequence));
-        if (!*end_of_sequence) {
-          return Status::OK();
-        }
-        ++i_;
-        for (const auto& provider : ctx->split_providers()) {
-          TF_RETURN_IF_ERROR(provider->Reset());
-        }
-        TF_RETURN_IF_ERROR(
-            dataset()->input_->MakeIterator(ctx, this, prefix(), &input_impl_));
-      }
-      *end_of_sequence = true;
-      input_impl_.reset();
-      return Status::OK();
+      return GetNextFromInput(
+          ctx, end_of_sequence, [&](IteratorBase* input_impl) {
+            return input_impl->GetNext(ctx, out_tensors, end_of_sequence);
+          });
+    }
+
+    Status GetNextIntoSliceInternal(IteratorContext* ctx, int64_t index,
+                                    std::vector<Tensor>* batch,
+                                    bool* end_of_sequence) override {
+      return GetNextFromInput(
+          ctx, end_of_sequence, [&](IteratorBase* input_impl) {
+            return input_impl->GetNextIntoSlice(ctx, index, batch,
+                                                end_of_sequence);
+          });
     }
 
    protected:
@@ -214,6 +212,33 @@ class RepeatDatasetOp::Dataset : public DatasetBase {
     }
 
    private:
+    // Reads the next element with `get_next`, starting the next repetition of
+    // the input when the current one is exhausted.
+    Status GetNextFromInput(
+        IteratorContext* ctx, bool* end_of_sequence,
+        const std::function<Status(IteratorBase*)>& get_next) {
+      mutex_lock l(mu_);  // TODO(mrry): Make locking less conservative.
+      if (!input_impl_) {
+        *end_of_sequence = true;
+        return Status::OK();
+      }
+      while (i_ < dataset()->count_) {
+        TF_RETURN_IF_ERROR(get_next(input_impl_.get()));
+        if (!*end_of_sequence) {
+          return Status::OK();
+        }
+        ++i_;
+        for (const auto& provider : ctx->split_providers()) {
+          TF_RETURN_IF_ERROR(provider->Reset());
+        }
+        TF_RETURN_IF_ERROR(
+            dataset()->input_->MakeIterator(ctx, this, prefix(), &input_impl_));
+      }
+      *end_of_sequence = true;
+      input_impl_.reset();
+      return Status::OK();
+    }
+
     mutex mu_;
     int64_t i_ TF_GUARDED_BY(mu_);
     std::unique_ptr<IteratorBase> input_impl_ TF_GUARDED_BY(mu_);
@@ -234,33 +259,23 @@ class RepeatDatasetOp::Dataset : public DatasetBase {
     Status GetNextInternal(IteratorContext* ctx,
                            std::vector<Tensor>* out_tensors,
                            bool* end_of_sequence) override {
-      mutex_lock l(mu_);  // TODO(mrry): Make locking less conservative.
-      do {
-        if (!input_impl_) {
-          TF_RETURN_IF_ERROR(dataset()->input_->MakeIterator(
-              ctx, this, prefix(), &input_impl_));
-        }
-        TF_RETURN_IF_ERROR(
-            input_impl_->GetNext(ctx, out_tensors, end_of_sequence));
-        DCHECK(!*end_of_sequence || out_tensors->empty());
-        if (first_call_ && *end_of_sequence && ctx->split_providers().empty()) {
-          // If the first call to GetNext() fails because the end of sequence
-          // has been reached, we terminate the iteration immediately.
-          // Otherwise, this iterator would loop infinitely and never produce a
-          // value.
-          input_impl_.reset();
-          return Status::OK();
-        }
-        first_call_ = false;
-        if (!*end_of_sequence) {
-          return Status::OK();
-        }
-        for (const auto& provider : ctx->split_providers()) {
-          TF_RETURN_IF_ERROR(provider->Reset());
-        }
-        input_impl_.reset();
-        first_call_ = true;
-      } while (true);
+      return GetNextFromInput(
+          ctx, end_of_sequence, [&](IteratorBase* input_impl) {
+            TF_RETURN_IF_ERROR(
+                input_impl->GetNext(ctx, out_tensors, end_of_sequence));
+            DCHECK(!*end_of_sequence || out_tensors->empty());
+            return Status::OK();
+          });
+    }
+
+    Status GetNextIntoSliceInternal(IteratorContext* ctx, int64_t index,
+                                    std::vector<Tensor>* batch,
+                                    bool* end_of_sequence) override {
+      return GetNextFromInput(
+          ctx, end_of_sequence, [&](IteratorBase* input_impl) {
+            return input_impl->GetNextIntoSlice(ctx, index, batch,
+                                                end_of_sequence);
+          });
     }
 
    protected:
@@ -296,6 +311,38 @@ class RepeatDatasetOp::Dataset : public DatasetBase {
     }
 
    private:
+    // Reads the next element with `get_next`, starting the next repetition of
+    // the input when the current one is exhausted.
+    Status GetNextFromInput(
+        IteratorContext* ctx, bool* end_of_sequence,
+        const std::function<Status(IteratorBase*)>& get_next) {
+      mutex_lock l(mu_);  // TODO(mrry): Make locking less conservative.
+      do {
+        if (!input_impl_) {
+          TF_RETURN_IF_ERROR(dataset()->input_->MakeIterator(
+              ctx, this, prefix(), &input_impl_));
+        }
+        TF_RETURN_IF_ERROR(get_next(input_impl_.get()));
+        if (first_call_ && *end_of_sequence && ctx->split_providers().empty()) {
+          // If the first call to GetNext() fails because the end of sequence
+          // has been reached, we terminate the iteration immediately.
+          // Otherwise, this iterator would loop infinitely and never produce a
+          // value.
+          input_impl_.reset();
+          return Status::OK();
+        }
+        first_call_ = false;
+        if (!*end_of_sequence) {
+          return Status::OK();
+        }
+        for (const auto& provider : ctx->split_providers()) {
+          TF_RETURN_IF_ERROR(provider->Reset());
+        }
+        input_impl_.reset();
+        first_call_ = true;
+      } while (true);
+    }
+
     mutex mu_;
     std::unique_ptr<IteratorBase> input_impl_ TF_GUARDED_BY(mu_);
     bool first_call_ TF_GUARDED_BY(mu_);
@@ -14,8 +14,11 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/shuffle_dataset_op.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <deque>
+#include <map>
+#include <numeric>
 #include <string>
 #include <tuple>
 #include <utility>
@@ -25,16 +28,21 @@ limitations under the License.
 #include "tensorflow/core/data/name_utils.h"
 #include "tensorflow/core/data/serialization_utils.h"
 #include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/memory_accountant.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/kernels/data/random_seed_ops.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/lib/random/philox_random.h"
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/random/random_distributions.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/stringprintf.h"
+#include "tensorflow/core/util/determinism.h"
 
 namespace tensorflow {
 namespace data {
@@ -59,6 +67,10 @@ namespace data {
 
 const int64_t kLogIntervalMicros = 10 * 1000000;  // 10 seconds.
 const int64_t kMaxEpochsInBuffer = 3;
+// The sharded shuffle buffer (see `ShardedIterator`) creates at most this many
+// shards, each with at least `kMinElementsPerShuffleShard` slots.
+const int64_t kMaxShuffleShards = 16;
+const int64_t kMinElementsPerShuffleShard = 1024;
 
 constexpr char kNumRandomSamples[] = "num_random_samples";
 constexpr char kDataProduced[] = "data_produced";
@@ -75,6 +87,19 @@ constexpr char kShuffleDatasetV2[] = "ShuffleDatasetV2";
 constexpr char kShuffleDatasetV3[] = "ShuffleDatasetV3";
 constexpr char kShuffleAndRepeatDatasetV1[] = "ShuffleAndRepeatDataset";
 constexpr char kShuffleAndRepeatDatasetV2[] = "ShuffleAndRepeatDatasetV2";
+constexpr char kShardedShuffleBufferExperiment[] = "sharded_shuffle_buffer";
+
+// Returns the number of shards to partition a shuffle buffer of the given size
+// into, or 1 if the buffer should not be sharded.
+int64_t ComputeNumShuffleShards(int64_t buffer_size) {
+  if (!GetExperiments().contains(kShardedShuffleBufferExperiment)) {
+    return 1;
+  }
+  return std::max<int64_t>(
+      1, std::min<int64_t>(
+             {kMaxShuffleShards, buffer_size / kMinElementsPerShuffleShard,
+              std::max(2, port::MaxParallelism())}));
+}
 
 ShuffleDatasetOpBase::ShuffleDatasetOpBase(OpKernelConstruction* ctx)
     : UnaryDatasetOpKernel(ctx) {}
@@ -91,9 +116,12 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
         buffer_size_(buffer_size),
         seed_generator_(std::move(seed_generator)),
         count_(count),
+        num_shards_(ComputeNumShuffleShards(buffer_size)),
         traceme_metadata_(
             {{"buffer_size",
-              strings::Printf("%lld", static_cast<long long>(buffer_size))}}) {
+              strings::Printf("%lld", static_cast<long long>(buffer_size))},
+             {"num_shards",
+              strings::Printf("%lld", static_cast<long long>(num_shards_))}}) {
     input_->Ref();
   }
 
@@ -155,11 +183,27 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
 
   std::unique_ptr<IteratorBase> MakeIteratorInternal(
       const string& prefix) const override {
+    if (num_shards_ > 1 && !RequiresDeterminism()) {
+      return absl::make_unique<ShardedIterator>(
+          ShardedIterator::Params{this,
+                                  name_utils::IteratorPrefix(op_type(), prefix)},
+          seed_generator_.get(), num_shards_);
+    }
     return absl::make_unique<Iterator>(
         Iterator::Params{this, name_utils::IteratorPrefix(op_type(), prefix)},
         seed_generator_.get());
   }
 
+  // Whether the output order must not depend on thread timing, in which case
+  // the sharded shuffle buffer is not used. The order may only vary if the
+  // `deterministic` option of the input is false and op determinism is off.
+  bool RequiresDeterminism() const {
+    return OpDeterminismRequired() ||
+           options().optional_deterministic_case() !=
+               Options::kDeterministic ||
+           options().deterministic();
+  }
+
   void InitializeRandomAccessIndices() const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
     const int64 cardinality = Cardinality();
     shuffled_indices_ = std::vector<std::int64_t>(cardinality);
@@ -194,6 +238,8 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       mutex_lock l(mu_);
       seed_generator_->GenerateSeeds(&seed_, &seed2_);
       ResetRngs();
+      memory_reservation_ =
+          absl::make_unique<MemoryReservation>(ctx->memory_pipeline());
       return Status::OK();
     }
 
@@ -218,6 +264,7 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       int64_t index = (slices_.front()->start + offset) % buffer_->size();
       *out_tensors = std::move(buffer_->at(index));
       this->RecordBufferDequeue(ctx, *out_tensors);
+      memory_reservation_->Release(GetAllocatedBytes(*out_tensors));
       std::swap(buffer_->at(index),
                 buffer_->at(slices_.front()->start % buffer_->size()));
       slices_.front()->start++;
@@ -321,10 +368,12 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
         slices_size = static_cast<size_t>(temp);
       }
       buffer_ = absl::make_unique<std::vector<std::vector<Tensor>>>();
+      memory_reservation_->Release(memory_reservation_->reserved_bytes());
       TF_RETURN_IF_ERROR(
           ReadElementsFromCheckpoint(ctx, reader, prefix(), buffer_.get()));
       for (const auto& element : *buffer_) {
         RecordBufferEnqueue(ctx, element);
+        memory_reservation_->ForceReserve(GetAllocatedBytes(element));
       }
       buffer_->resize(dataset()->buffer_size_);
       slices_.clear();
@@ -388,6 +437,10 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
         TF_RETURN_IF_ERROR(
             input_impl_->GetNext(ctx, &input_element, &end_of_input_sequence));
         if (!end_of_input_sequence) {
+          // The buffer is always filled to `buffer_size`, since the order of
+          // the elements depends on it. Its memory is accounted for so that
+          // other buffers of the process can back off instead.
+          memory_reservation_->ForceReserve(GetAllocatedBytes(input_element));
           AddToShuffleBuffer(ctx, std::move(input_element));
           continue;
         }
@@ -471,6 +524,8 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
 
     mutex mu_;
     SeedGenerator* const seed_generator_ TF_GUARDED_BY(mu_);  // Not owned.
+    // Accounts for the buffered elements against the tf.data memory budget.
+    std::unique_ptr<MemoryReservation> memory_reservation_;
     std::unique_ptr<std::vector<std::vector<Tensor>>> buffer_
         TF_GUARDED_BY(mu_);
     std::unique_ptr<IteratorBase> input_impl_ TF_GUARDED_BY(mu_) = nullptr;
@@ -490,6 +545,565 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
     bool data_produced_ TF_GUARDED_BY(mu_) = false;
   };
 
+  // Shuffling iterator whose buffer is partitioned into shards that are filled
+  // concurrently by background threads, one per shard. Filling does not hold
+  // the lock used by `GetNext()`, so the consumer only blocks on the buffer
+  // while it is not full, instead of filling it on its own thread.
+  //
+  // To produce an element, the iterator picks a shard with probability
+  // proportional to the number of elements of the oldest buffered epoch it
+  // holds and then picks one of those elements uniformly at random using the
+  // shard's own generator. Every buffered element of the oldest epoch is thus
+  // equally likely to be produced, as with `Iterator`. The order in which the
+  // fill threads insert elements is not deterministic, so neither is the
+  // output order of this iterator. It is therefore only used if determinism is
+  // not required (see `RequiresDeterminism()`).
+  //
+  // The checkpoint format is the same as the one used by `Iterator`, so
+  // checkpoints written by either iterator can be restored by the other.
+  class ShardedIterator : public DatasetIterator<ShuffleDatasetBase> {
+   public:
+    ShardedIterator(const Params& params, SeedGenerator* seed_generator,
+                    int64_t num_shards)
+        : DatasetIterator<ShuffleDatasetBase>(params),
+          seed_generator_(seed_generator),
+          parent_generator_(seed_generator->seed(), seed_generator->seed2()),
+          generator_(&parent_generator_) {
+      shards_.reserve(num_shards);
+      for (int64_t i = 0; i < num_shards; ++i) {
+        shards_.push_back(absl::make_unique<Shard>());
+      }
+    }
+
+    ~ShardedIterator() override {
+      CancelThreads();
+      if (deregister_fn_) deregister_fn_();
+    }
+
+    Status Initialize(IteratorContext* ctx) override {
+      mutex_lock l(mu_);
+      seed_generator_->GenerateSeeds(&seed_, &seed2_);
+      ResetRngs();
+      cancellation_manager_ = absl::make_unique<CancellationManager>();
+      memory_reservation_ =
+          absl::make_unique<MemoryReservation>(ctx->memory_pipeline());
+      return RegisterCancellationCallback(
+          ctx->cancellation_manager(), [this]() { CancelThreads(); },
+          &deregister_fn_);
+    }
+
+    Status GetNextInternal(IteratorContext* ctx,
+                           std::vector<Tensor>* out_tensors,
+                           bool* end_of_sequence) override {
+      mutex_lock l(mu_);
+      EnsureFillThreadsStarted(ctx);
+      std::vector<int64_t> shard_sizes(shards_.size());
+      while (true) {
+        if (cancelled_) {
+          return errors::Cancelled("Iterator was cancelled");
+        }
+        TF_RETURN_IF_ERROR(status_);
+        if (IsFilling() && num_elements_ < dataset()->buffer_size_) {
+          RecordStop(ctx);
+          cond_var_.wait(l);
+          RecordStart(ctx);
+          continue;
+        }
+        int64_t num_front_elements = 0;
+        for (size_t i = 0; i < shards_.size(); ++i) {
+          shard_sizes[i] = shards_[i]->NumElements(front_epoch_);
+          num_front_elements += shard_sizes[i];
+        }
+        if (num_front_elements > 0) {
+          break;
+        }
+        if (front_epoch_ < epoch_) {
+          // All elements of the oldest epoch have been produced. The input
+          // having moved past that epoch guarantees that no fill thread is
+          // still inserting elements of it.
+          AdvanceFrontEpoch();
+          continue;
+        }
+        if (end_of_input_) {
+          *end_of_sequence = true;
+          return Status::OK();
+        }
+        RecordStop(ctx);
+        cond_var_.wait(l);
+        RecordStart(ctx);
+      }
+
+      // Elements are only removed from the shards by this method, which
+      // holds `mu_`, so each shard still holds at least the elements counted
+      // in `shard_sizes`. Elements inserted since are appended and therefore
+      // not eligible for the sample below.
+      int64_t offset =
+          Random() % std::accumulate(shard_sizes.begin(), shard_sizes.end(),
+                                     int64_t{0});
+      size_t shard_index = 0;
+      while (offset >= shard_sizes[shard_index]) {
+        offset -= shard_sizes[shard_index];
+        ++shard_index;
+      }
+      *out_tensors = shards_[shard_index]->Remove(front_epoch_,
+                                                  shard_sizes[shard_index]);
+      RecordBufferDequeue(ctx, *out_tensors);
+      memory_reservation_->Release(GetAllocatedBytes(*out_tensors));
+      --num_elements_;
+      --num_reserved_;
+      fill_cond_var_.notify_one();
+      *end_of_sequence = false;
+      return Status::OK();
+    }
+
+   protected:
+    std::shared_ptr<model::Node> CreateNode(
+        IteratorContext* ctx, model::Node::Args args) const override {
+      return model::MakeAsyncKnownRatioNode(std::move(args),
+                                            /*ratio=*/1, /*parameters=*/{});
+    }
+
+    Status SaveInternal(SerializationContext* ctx,
+                        IteratorStateWriter* writer) override {
+      // Holding `input_mu_` exclusively waits for fill threads to finish
+      // inserting the elements they have read from the input.
+      mutex_lock input_l(input_mu_);
+      mutex_lock l(mu_);
+      TF_RETURN_IF_ERROR(status_);
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(full_name(kEpochNumRandomSamples),
+                              seed_generator_->num_random_samples()));
+      TF_RETURN_IF_ERROR(writer->WriteScalar(this->full_name(kNumRandomSamples),
+                                             num_random_samples_));
+      TF_RETURN_IF_ERROR(writer->WriteScalar(this->full_name(kSeed), seed_));
+      TF_RETURN_IF_ERROR(writer->WriteScalar(this->full_name(kSeed2), seed2_));
+      if (!input_impl_) {
+        TF_RETURN_IF_ERROR(
+            writer->WriteScalar(this->full_name(kEndOfInputSequence), ""));
+      } else {
+        TF_RETURN_IF_ERROR(this->SaveInput(ctx, writer, input_impl_));
+      }
+
+      // Lay the shards out as the contiguous buffer and per-epoch slices
+      // written by `Iterator`.
+      std::vector<std::vector<Tensor>> buffer;
+      std::vector<std::pair<int64_t, int64_t>> slices;
+      for (int64_t epoch = front_epoch_; epoch <= epoch_; ++epoch) {
+        int64_t start = buffer.size();
+        for (const auto& shard : shards_) {
+          shard->AppendElements(epoch, &buffer);
+        }
+        slices.emplace_back(start, buffer.size());
+      }
+      TF_RETURN_IF_ERROR(writer->WriteScalar(this->full_name(kEpoch), epoch_));
+      TF_RETURN_IF_ERROR(writer->WriteScalar(
+          this->full_name(kNumElements), static_cast<int64_t>(buffer.size())));
+      TF_RETURN_IF_ERROR(WriteElementsToCheckpoint(writer, prefix(), buffer));
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(this->full_name(kSlicesSize), slices.size()));
+      for (size_t i = 0; i < slices.size(); ++i) {
+        TF_RETURN_IF_ERROR(
+            writer->WriteScalar(this->full_name(absl::StrJoin(
+                                    std::make_tuple(kSlicesStart, i), "_")),
+                                slices[i].first));
+        TF_RETURN_IF_ERROR(writer->WriteScalar(
+            this->full_name(absl::StrJoin(std::make_tuple(kSlicesEnd, i), "_")),
+            slices[i].second));
+      }
+      if (data_produced_) {
+        TF_RETURN_IF_ERROR(
+            writer->WriteScalar(this->full_name(kDataProduced), ""));
+      }
+      return Status::OK();
+    }
+
+    Status RestoreInternal(IteratorContext* ctx,
+                           IteratorStateReader* reader) override {
+      StopFillThreads();
+      mutex_lock input_l(input_mu_);
+      mutex_lock l(mu_);
+      cancelled_ = false;
+      status_ = Status::OK();
+      cancellation_manager_ = absl::make_unique<CancellationManager>();
+      int64_t num_random_samples;
+      TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kEpochNumRandomSamples),
+                                            &num_random_samples));
+      seed_generator_->set_num_random_samples(num_random_samples);
+      seed_generator_->Reset();
+      TF_RETURN_IF_ERROR(reader->ReadScalar(this->full_name(kNumRandomSamples),
+                                            &num_random_samples_));
+      TF_RETURN_IF_ERROR(reader->ReadScalar(this->full_name(kSeed), &seed_));
+      TF_RETURN_IF_ERROR(reader->ReadScalar(this->full_name(kSeed2), &seed2_));
+      ResetRngs();
+
+      if (!reader->Contains(this->full_name(kEndOfInputSequence))) {
+        TF_RETURN_IF_ERROR(this->dataset()->input_->MakeIterator(
+            MakeInputContext(ctx), this, this->prefix(), &input_impl_));
+        TF_RETURN_IF_ERROR(this->RestoreInput(ctx, reader, input_impl_));
+      } else {
+        input_impl_.reset();
+      }
+
+      TF_RETURN_IF_ERROR(reader->ReadScalar(this->full_name(kEpoch), &epoch_));
+      input_epoch_ = epoch_;
+      int64_t slices_size;
+      TF_RETURN_IF_ERROR(
+          reader->ReadScalar(this->full_name(kSlicesSize), &slices_size));
+      std::vector<std::vector<Tensor>> buffer;
+      TF_RETURN_IF_ERROR(
+          ReadElementsFromCheckpoint(ctx, reader, prefix(), &buffer));
+      buffer.resize(dataset()->buffer_size_);
+
+      // Distribute the elements of each slice across the shards round-robin.
+      for (const auto& shard : shards_) {
+        shard->Clear();
+      }
+      num_elements_ = 0;
+      memory_reservation_->Release(memory_reservation_->reserved_bytes());
+      front_epoch_ = epoch_ - slices_size + 1;
+      for (int64_t i = 0; i < slices_size; ++i) {
+        int64_t start;
+        TF_RETURN_IF_ERROR(
+            reader->ReadScalar(this->full_name(absl::StrJoin(
+                                   std::make_tuple(kSlicesStart, i), "_")),
+                               &start));
+        int64_t end;
+        TF_RETURN_IF_ERROR(reader->ReadScalar(
+            this->full_name(absl::StrJoin(std::make_tuple(kSlicesEnd, i), "_")),
+            &end));
+        for (int64_t j = start; j < end; ++j) {
+          std::vector<Tensor>& element = buffer[j % buffer.size()];
+          RecordBufferEnqueue(ctx, element);
+          memory_reservation_->ForceReserve(GetAllocatedBytes(element));
+          shards_[num_elements_ % shards_.size()]->Insert(front_epoch_ + i,
+                                                          std::move(element));
+          ++num_elements_;
+        }
+      }
+      num_reserved_ = num_elements_;
+      data_produced_ = reader->Contains(this->full_name(kDataProduced));
+      end_of_input_ = false;
+      return Status::OK();
+    }
+
+    TraceMeMetadata GetTraceMeMetadata() const override {
+      return this->dataset()->traceme_metadata_;
+    }
+
+   private:
+    // A shard of the shuffle buffer. Elements are only removed by `GetNext()`
+    // and appended by the fill thread of the shard, so each shard lock is
+    // contended by at most two threads.
+    class Shard {
+     public:
+      Shard() : generator_(&parent_generator_) {}
+
+      int64_t NumElements(int64_t epoch) TF_LOCKS_EXCLUDED(mu_) {
+        tf_shared_lock l(mu_);
+        auto it = elements_.find(epoch);
+        return it == elements_.end() ? 0 : it->second.size();
+      }
+
+      void Insert(int64_t epoch, std::vector<Tensor>&& element)
+          TF_LOCKS_EXCLUDED(mu_) {
+        mutex_lock l(mu_);
+        elements_[epoch].push_back(std::move(element));
+      }
+
+      // Removes and returns an element of the given epoch chosen uniformly at
+      // random among the first `num_eligible` elements of that epoch.
+      std::vector<Tensor> Remove(int64_t epoch, int64_t num_eligible)
+          TF_LOCKS_EXCLUDED(mu_) {
+        mutex_lock l(mu_);
+        std::vector<std::vector<Tensor>>& elements = elements_[epoch];
+        DCHECK_LE(num_eligible, static_cast<int64_t>(elements.size()));
+        int64_t index = generator_() % num_eligible;
+        std::vector<Tensor> element = std::move(elements[index]);
+        // Preserve the order of the ineligible (most recently inserted)
+        // elements by filling the hole with the last eligible element.
+        elements[index] = std::move(elements[num_eligible - 1]);
+        elements.erase(elements.begin() + num_eligible - 1);
+        if (elements.empty()) {
+          elements_.erase(epoch);
+        }
+        return element;
+      }
+
+      void AppendElements(int64_t epoch,
+                          std::vector<std::vector<Tensor>>* buffer)
+          TF_LOCKS_EXCLUDED(mu_) {
+        tf_shared_lock l(mu_);
+        auto it = elements_.find(epoch);
+        if (it != elements_.end()) {
+          buffer->insert(buffer->end(), it->second.begin(), it->second.end());
+        }
+      }
+
+      void Clear() TF_LOCKS_EXCLUDED(mu_) {
+        mutex_lock l(mu_);
+        elements_.clear();
+      }
+
+      void ResetRng(int64_t seed, int64_t seed2) TF_LOCKS_EXCLUDED(mu_) {
+        mutex_lock l(mu_);
+        parent_generator_ = random::PhiloxRandom(seed, seed2);
+        generator_ =
+            random::SingleSampleAdapter<random::PhiloxRandom>(&parent_generator_);
+      }
+
+     private:
+      mutex mu_;
+      // Buffered elements, keyed by the epoch of the input they belong to.
+      std::map<int64_t, std::vector<std::vector<Tensor>>> elements_
+          TF_GUARDED_BY(mu_);
+      random::PhiloxRandom parent_generator_ TF_GUARDED_BY(mu_);
+      random::SingleSampleAdapter<random::PhiloxRandom> generator_
+          TF_GUARDED_BY(mu_);
+    };
+
+    random::SingleSampleAdapter<random::PhiloxRandom>::ResultType Random()
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      num_random_samples_++;
+      return generator_();
+    }
+
+    void ResetRngs() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      parent_generator_ = random::PhiloxRandom(seed_, seed2_);
+      generator_ =
+          random::SingleSampleAdapter<random::PhiloxRandom>(&parent_generator_);
+      generator_.Skip(num_random_samples_);
+      // The shard generators are derived from the iterator seeds. Their state
+      // is not checkpointed, which is consistent with the output order of
+      // this iterator not being deterministic.
+      for (size_t i = 0; i < shards_.size(); ++i) {
+        shards_[i]->ResetRng(seed_ + num_random_samples_,
+                             seed2_ + static_cast<int64_t>(i) + 1);
+      }
+    }
+
+    // Starts producing elements of the oldest buffered epoch after all
+    // elements of the previous one have been produced.
+    void AdvanceFrontEpoch() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      ++front_epoch_;
+      // Reinitialize the RNG state for the next epoch.
+      num_random_samples_ = 0;
+      seed_generator_->GenerateSeeds(&seed_, &seed2_);
+      ResetRngs();
+      fill_cond_var_.notify_all();
+    }
+
+    // Whether the fill threads may still add elements to the buffer.
+    bool IsFilling() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      return !end_of_input_ && !IsEpochLimitReached();
+    }
+
+    bool IsEpochLimitReached() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      // See `Iterator::ShouldFillBuffer()`.
+      return epoch_ - front_epoch_ + 1 > kMaxEpochsInBuffer &&
+             num_elements_ > 0;
+    }
+
+    void EnsureFillThreadsStarted(IteratorContext* ctx)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      if (!fill_threads_.empty()) {
+        return;
+      }
+      VLOG(1) << "Starting to fill up shuffle buffer of size "
+              << dataset()->buffer_size_ << " with " << shards_.size()
+              << " threads.";
+      auto new_ctx = std::make_shared<IteratorContext>(MakeInputContext(ctx));
+      for (size_t i = 0; i < shards_.size(); ++i) {
+        fill_threads_.push_back(ctx->StartThread(
+            strings::StrCat("tf_data_shuffle_fill_", i),
+            [this, new_ctx, i]() { FillThread(new_ctx, shards_[i].get()); }));
+      }
+    }
+
+    // Returns a context which propagates cancellation of this iterator to the
+    // input iterator.
+    IteratorContext MakeInputContext(IteratorContext* ctx) {
+      IteratorContext::Params params(ctx);
+      params.cancellation_manager = cancellation_manager_.get();
+      return IteratorContext(std::move(params));
+    }
+
+    // Reads elements from the input and appends them to `shard` whenever the
+    // buffer has room for them.
+    void FillThread(const std::shared_ptr<IteratorContext>& ctx, Shard* shard) {
+      RecordStart(ctx.get());
+      auto cleanup = gtl::MakeCleanup([this, ctx] { RecordStop(ctx.get()); });
+      while (true) {
+        {
+          mutex_lock l(mu_);
+          while (!cancelled_ && status_.ok() && IsFilling() &&
+                 num_reserved_ >= dataset()->buffer_size_) {
+            RecordStop(ctx.get());
+            fill_cond_var_.wait(l);
+            RecordStart(ctx.get());
+          }
+          if (cancelled_ || !status_.ok() || end_of_input_) {
+            return;
+          }
+          if (IsEpochLimitReached()) {
+            RecordStop(ctx.get());
+            fill_cond_var_.wait(l);
+            RecordStart(ctx.get());
+            continue;
+          }
+          // Reserve a slot in the buffer for the element to read.
+          ++num_reserved_;
+        }
+        std::vector<Tensor> element;
+        bool end_of_sequence = true;
+        int64_t element_epoch;
+        Status s;
+        {
+          // Fill threads read from the input concurrently; `input_mu_` is
+          // only held exclusively to move to the next epoch or to checkpoint
+          // the iterator.
+          tf_shared_lock input_l(input_mu_);
+          element_epoch = input_epoch_;
+          if (input_impl_) {
+            s = input_impl_->GetNext(ctx.get(), &element, &end_of_sequence);
+          }
+          if (s.ok() && !end_of_sequence) {
+            RecordBufferEnqueue(ctx.get(), element);
+            // Like the unsharded buffer, the buffer is always filled to
+            // `buffer_size`, and its memory is only accounted for.
+            memory_reservation_->ForceReserve(GetAllocatedBytes(element));
+            shard->Insert(element_epoch, std::move(element));
+            // Update the state before releasing `input_mu_`, so that a fill
+            // thread which moves to the next epoch observes the element.
+            mutex_lock l(mu_);
+            data_produced_ = true;
+            ++num_elements_;
+            cond_var_.notify_all();
+          }
+        }
+        if (s.ok() && !end_of_sequence) {
+          continue;
+        }
+        {
+          mutex_lock l(mu_);
+          --num_reserved_;
+        }
+        if (s.ok()) {
+          s = MoveToNextInputEpoch(ctx.get(), element_epoch);
+        }
+        if (!s.ok()) {
+          mutex_lock l(mu_);
+          status_ = s;
+          cond_var_.notify_all();
+          fill_cond_var_.notify_all();
+          return;
+        }
+      }
+    }
+
+    // Creates the input iterator for the epoch following `exhausted_epoch`,
+    // unless another fill thread has already done so, or marks the end of the
+    // input if no further epochs should be read.
+    Status MoveToNextInputEpoch(IteratorContext* ctx, int64_t exhausted_epoch)
+        TF_LOCKS_EXCLUDED(input_mu_, mu_) {
+      mutex_lock input_l(input_mu_);
+      if (input_epoch_ != exhausted_epoch) {
+        return Status::OK();
+      }
+      input_impl_.reset();
+      {
+        mutex_lock l(mu_);
+        bool end_of_input =
+            dataset()->count_ != -1 && epoch_ >= dataset()->count_;
+        // If we encounter the end of sequence without producing data, we
+        // terminate the iteration immediately. (Otherwise, this iterator
+        // would loop infinitely and never produce a value.)
+        end_of_input |= epoch_ > 0 && ctx->split_providers().empty() &&
+                        !data_produced_ && dataset()->count_ == -1;
+        if (end_of_input) {
+          end_of_input_ = true;
+          cond_var_.notify_all();
+          fill_cond_var_.notify_all();
+          return Status::OK();
+        }
+      }
+      if (input_epoch_ > 0) {
+        for (const auto& provider : ctx->split_providers()) {
+          TF_RETURN_IF_ERROR(provider->Reset());
+        }
+      }
+      TF_RETURN_IF_ERROR(this->dataset()->input_->MakeIterator(
+          ctx, this, this->prefix(), &input_impl_));
+      ++input_epoch_;
+      mutex_lock l(mu_);
+      epoch_ = input_epoch_;
+      cond_var_.notify_all();
+      return Status::OK();
+    }
+
+    void CancelThreads() TF_LOCKS_EXCLUDED(mu_) {
+      if (cancellation_manager_) {
+        cancellation_manager_->StartCancel();
+      }
+      mutex_lock l(mu_);
+      cancelled_ = true;
+      cond_var_.notify_all();
+      fill_cond_var_.notify_all();
+    }
+
+    // Cancels and joins the fill threads, which are restarted by the next call
+    // to `GetNext()`.
+    void StopFillThreads() TF_LOCKS_EXCLUDED(input_mu_, mu_) {
+      CancelThreads();
+      std::vector<std::unique_ptr<Thread>> fill_threads;
+      {
+        mutex_lock l(mu_);
+        fill_threads.swap(fill_threads_);
+      }
+    }
+
+    // Guards the input iterator. Fill threads hold it shared while reading
+    // from the input and inserting the element read into their shard.
+    mutex input_mu_ TF_ACQUIRED_BEFORE(mu_);
+    std::unique_ptr<IteratorBase> input_impl_ TF_GUARDED_BY(input_mu_);
+    // The epoch of the elements produced by `input_impl_`.
+    int64_t input_epoch_ TF_GUARDED_BY(input_mu_) = 0;
+
+    mutex mu_;
+    // Signals the consumer that elements were added or the state changed.
+    condition_variable cond_var_;
+    // Signals the fill threads that room was made in the buffer.
+    condition_variable fill_cond_var_;
+    SeedGenerator* const seed_generator_ TF_GUARDED_BY(mu_);  // Not owned.
+    std::vector<std::unique_ptr<Shard>> shards_;
+    // Mirrors `input_epoch_` for readers that do not hold `input_mu_`.
+    int64_t epoch_ TF_GUARDED_BY(mu_) = 0;
+    // The epoch whose elements are currently being produced.
+    int64_t front_epoch_ TF_GUARDED_BY(mu_) = 1;
+    // The number of elements inserted into the shards and not yet produced.
+    int64_t num_elements_ TF_GUARDED_BY(mu_) = 0;
+    // `num_elements_` plus the number of elements being read by fill threads.
+    int64_t num_reserved_ TF_GUARDED_BY(mu_) = 0;
+    int64_t seed_ TF_GUARDED_BY(mu_) = 0;
+    int64_t seed2_ TF_GUARDED_BY(mu_) = 0;
+    random::PhiloxRandom parent_generator_ TF_GUARDED_BY(mu_);
+    random::SingleSampleAdapter<random::PhiloxRandom> generator_
+        TF_GUARDED_BY(mu_);
+    int64_t num_random_samples_ TF_GUARDED_BY(mu_) = 0;
+    bool data_produced_ TF_GUARDED_BY(mu_) = false;
+    bool end_of_input_ TF_GUARDED_BY(mu_) = false;
+    bool cancelled_ TF_GUARDED_BY(mu_) = false;
+    // The first error encountered by a fill thread, returned by all
+    // subsequent calls to `GetNext()`.
+    Status status_ TF_GUARDED_BY(mu_);
+    std::unique_ptr<CancellationManager> cancellation_manager_;
+    std::function<void()> deregister_fn_;
+    // Accounts for the buffered elements against the tf.data memory budget.
+    std::unique_ptr<MemoryReservation> memory_reservation_;
+    // Declared last so that the threads are joined before the state they
+    // access is destroyed.
+    std::vector<std::unique_ptr<Thread>> fill_threads_ TF_GUARDED_BY(mu_);
+  };
+
   const DatasetBase* const input_;
   const int64_t buffer_size_;
   const std::shared_ptr<SeedGenerator> seed_generator_;
@@ -497,6 +1111,9 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
   // fuse shuffle and repeat together, and make the shuffle dataset op
   // responsible for repeating as well.
   const int64_t count_;
+  // The number of shards of the shuffle buffer. If greater than 1, iterators
+  // use the sharded shuffle buffer implemented by `ShardedIterator`.
+  const int64_t num_shards_;
   const TraceMeMetadata traceme_metadata_;
   mutable mutex mu_;
   mutable std::vector<std::int64_t> shuffled_indices_ TF_GUARDED_BY(mu_);
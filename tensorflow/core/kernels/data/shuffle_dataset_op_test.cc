@@ -17,6 +17,9 @@ limitations under the License.
 #include "tensorflow/core/data/dataset_test_base.h"
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/data/serialization_utils.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/blocking_counter.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 
 namespace tensorflow {
 namespace data {
@@ -565,6 +568,206 @@ TEST_F(ShuffleDatasetOpTest, InvalidArguments) {
   }
 }
 
+// Opts into the sharded shuffle buffer experiment for the lifetime of the
+// object.
+class ScopedShardedShuffleBuffer {
+ public:
+  ScopedShardedShuffleBuffer() {
+    setenv("TF_JOB_NAME", "test_job", 1);
+    setenv("TF_DATA_EXPERIMENT_OPT_IN", "sharded_shuffle_buffer", 1);
+  }
+  ~ScopedShardedShuffleBuffer() {
+    unsetenv("TF_JOB_NAME");
+    unsetenv("TF_DATA_EXPERIMENT_OPT_IN");
+  }
+};
+
+// The sharded shuffle buffer is only used for buffers of at least two
+// shards' worth of elements, and only if the input allows a nondeterministic
+// order.
+ShuffleDatasetParams ShardedShuffleDatasetParams(int64_t count,
+                                                 bool deterministic = false) {
+  Options options;
+  options.set_deterministic(deterministic);
+  return ShuffleDatasetParams(OptionsDatasetParams(
+                                  RangeDatasetParams(0, 10000, 1),
+                                  options.SerializeAsString(),
+                                  /*output_dtypes=*/{DT_INT64},
+                                  /*output_shapes=*/{PartialTensorShape({})},
+                                  /*node_name=*/"options_dataset_0"),
+                              /*buffer_size=*/4096,
+                              /*seed=*/1,
+                              /*seed2=*/2,
+                              /*count=*/count,
+                              /*reshuffle_each_iteration=*/true,
+                              /*output_dtypes=*/{DT_INT64},
+                              /*output_shapes=*/{PartialTensorShape({})},
+                              /*node_name=*/count == 1
+                                  ? kShuffleNodeName
+                                  : kShuffleAndRepeatNodeName);
+}
+
+std::vector<Tensor> RangeTensors(int64_t n) {
+  std::vector<Tensor> tensors;
+  tensors.reserve(n);
+  for (int64_t i = 0; i < n; ++i) {
+    tensors.push_back(CreateTensor<int64_t>(TensorShape({}), {i}));
+  }
+  return tensors;
+}
+
+TEST_F(ShuffleDatasetOpTest, ShardedShuffleBufferGetNext) {
+  ScopedShardedShuffleBuffer scoped_sharded_shuffle_buffer;
+  TF_ASSERT_OK(Initialize(ShardedShuffleDatasetParams(/*count=*/2)));
+  // Each epoch must be produced in its entirety before the next one starts.
+  for (int epoch = 0; epoch < 2; ++epoch) {
+    std::vector<Tensor> out_tensors;
+    bool end_of_sequence = false;
+    for (int i = 0; i < 10000; ++i) {
+      std::vector<Tensor> next;
+      TF_ASSERT_OK(
+          iterator_->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+      ASSERT_FALSE(end_of_sequence);
+      out_tensors.insert(out_tensors.end(), next.begin(), next.end());
+    }
+    TF_EXPECT_OK(ExpectEqual(out_tensors, RangeTensors(10000),
+                             /*compare_order=*/false));
+  }
+  std::vector<Tensor> next;
+  bool end_of_sequence = false;
+  TF_ASSERT_OK(
+      iterator_->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+  EXPECT_TRUE(end_of_sequence);
+}
+
+TEST_F(ShuffleDatasetOpTest, ShardedShuffleBufferRequiresNondeterminism) {
+  auto dataset_params =
+      ShardedShuffleDatasetParams(/*count=*/1, /*deterministic=*/true);
+  std::vector<Tensor> expected_outputs;
+  TF_ASSERT_OK(Initialize(dataset_params));
+  bool end_of_sequence = false;
+  while (!end_of_sequence) {
+    std::vector<Tensor> next;
+    TF_ASSERT_OK(
+        iterator_->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+    expected_outputs.insert(expected_outputs.end(), next.begin(), next.end());
+  }
+
+  // With the deterministic option, the experiment does not change the order.
+  ScopedShardedShuffleBuffer scoped_sharded_shuffle_buffer;
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(CheckIteratorGetNext(expected_outputs, /*compare_order=*/true));
+}
+
+TEST_F(ShuffleDatasetOpTest, ShardedShuffleBufferSaveAndRestore) {
+  ScopedShardedShuffleBuffer scoped_sharded_shuffle_buffer;
+  auto dataset_params = ShardedShuffleDatasetParams(/*count=*/1);
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(CheckIteratorSaveAndRestore(
+      dataset_params.iterator_prefix(), RangeTensors(10000),
+      /*breakpoints=*/{0, 100, 5000, 10001}, /*compare_order=*/false));
+}
+
+TEST_F(ShuffleDatasetOpTest, ShardedShuffleBufferRestoredByUnshardedIterator) {
+  auto dataset_params = ShardedShuffleDatasetParams(/*count=*/1);
+  std::vector<Tensor> out_tensors;
+  std::unique_ptr<SerializationContext> serialization_ctx;
+  VariantTensorDataWriter writer;
+  {
+    ScopedShardedShuffleBuffer scoped_sharded_shuffle_buffer;
+    TF_ASSERT_OK(Initialize(dataset_params));
+    bool end_of_sequence = false;
+    for (int i = 0; i < 5000; ++i) {
+      std::vector<Tensor> next;
+      TF_ASSERT_OK(
+          iterator_->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+      out_tensors.insert(out_tensors.end(), next.begin(), next.end());
+    }
+    TF_ASSERT_OK(CreateSerializationContext(&serialization_ctx));
+    TF_ASSERT_OK(iterator_->Save(serialization_ctx.get(), &writer));
+  }
+  // Without the experiment, the checkpoint is restored into `Iterator`.
+  TF_ASSERT_OK(Initialize(dataset_params));
+  std::vector<const VariantTensorData*> data;
+  writer.GetData(&data);
+  VariantTensorDataReader reader(data);
+  TF_ASSERT_OK(RestoreIterator(iterator_ctx_.get(), &reader,
+                               dataset_params.iterator_prefix(), *dataset_,
+                               &iterator_));
+  bool end_of_sequence = false;
+  while (!end_of_sequence) {
+    std::vector<Tensor> next;
+    TF_ASSERT_OK(
+        iterator_->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+    out_tensors.insert(out_tensors.end(), next.begin(), next.end());
+  }
+  TF_EXPECT_OK(ExpectEqual(out_tensors, RangeTensors(10000),
+                           /*compare_order=*/false));
+}
+
+// Measures the elements/sec produced by a repeated shuffle dataset for the
+// given buffer size (`state.range(0)`) and number of threads concurrently
+// calling `GetNext()` (`state.range(1)`), with the sharded shuffle buffer
+// disabled (`state.range(2) == 0`) or enabled.
+class ShuffleDatasetBenchmark : public ShuffleDatasetOpTest {
+ public:
+  void TestBody() override {}
+
+  void Run(::testing::benchmark::State& state) {
+    const int64_t buffer_size = state.range(0);
+    const int num_threads = state.range(1);
+    std::unique_ptr<ScopedShardedShuffleBuffer> scoped_sharded_shuffle_buffer;
+    if (state.range(2)) {
+      scoped_sharded_shuffle_buffer =
+          absl::make_unique<ScopedShardedShuffleBuffer>();
+    }
+    TF_CHECK_OK(Initialize(ShuffleDatasetParams(
+        RangeDatasetParams(0, 1 << 20, 1), buffer_size, /*seed=*/1,
+        /*seed2=*/2, /*count=*/-1, /*reshuffle_each_iteration=*/true,
+        /*output_dtypes=*/{DT_INT64},
+        /*output_shapes=*/{PartialTensorShape({})},
+        /*node_name=*/kShuffleAndRepeatNodeName)));
+    constexpr int kElementsPerThread = 1024;
+    thread::ThreadPool pool(Env::Default(), "shuffle_benchmark", num_threads);
+    for (auto s : state) {
+      BlockingCounter counter(num_threads);
+      for (int i = 0; i < num_threads; ++i) {
+        pool.Schedule([this, &counter]() {
+          for (int j = 0; j < kElementsPerThread; ++j) {
+            std::vector<Tensor> next;
+            bool end_of_sequence;
+            TF_CHECK_OK(iterator_->GetNext(iterator_ctx_.get(), &next,
+                                           &end_of_sequence));
+          }
+          counter.DecrementCount();
+        });
+      }
+      counter.Wait();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                            num_threads * kElementsPerThread);
+  }
+};
+
+void BM_ShuffleDataset(::testing::benchmark::State& state) {
+  ShuffleDatasetBenchmark benchmark;
+  benchmark.Run(state);
+}
+
+BENCHMARK(BM_ShuffleDataset)
+    ->Args({1 << 12, 1, 0})
+    ->Args({1 << 12, 1, 1})
+    ->Args({1 << 12, 8, 0})
+    ->Args({1 << 12, 8, 1})
+    ->Args({1 << 16, 1, 0})
+    ->Args({1 << 16, 1, 1})
+    ->Args({1 << 16, 8, 0})
+    ->Args({1 << 16, 8, 1})
+    ->Args({1 << 18, 1, 0})
+    ->Args({1 << 18, 1, 1})
+    ->Args({1 << 18, 32, 0})
+    ->Args({1 << 18, 32, 1});
+
 }  // namespace
 }  // namespace data
 }  // namespace tensorflow
@@ -74,6 +74,10 @@ int64_t TakeDataset::Cardinality() const {
   return std::min(n, count_);
 }
 
+bool TakeDataset::SupportsGetNextIntoSlice() const {
+  return input_->SupportsGetNextIntoSlice();
+}
+
 Status TakeDataset::InputDatasets(
     std::vector<const DatasetBase*>* inputs) const {
   inputs->push_back(input_);
@@ -142,6 +146,23 @@ class TakeDataset::FiniteIterator : public DatasetIterator<TakeDataset> {
     return Status::OK();
   }
 
+  Status GetNextIntoSliceInternal(IteratorContext* ctx, int64_t index,
+                                  std::vector<Tensor>* batch,
+                                  bool* end_of_sequence) override {
+    mutex_lock l(mu_);
+    if (input_impl_ && (dataset()->count_ < 0 || i_ < dataset()->count_)) {
+      TF_RETURN_IF_ERROR(
+          input_impl_->GetNextIntoSlice(ctx, index, batch, end_of_sequence));
+      if (!*end_of_sequence) {
+        ++i_;
+        return Status::OK();
+      }
+    }
+    *end_of_sequence = true;
+    input_impl_.reset();
+    return Status::OK();
+  }
+
  protected:
   std::shared_ptr<model::Node> CreateNode(
       IteratorContext* ctx, model::Node::Args args) const override {
@@ -40,6 +40,8 @@ class TakeDataset : public DatasetBase {
 
   int64_t Cardinality() const override;
 
+  bool SupportsGetNextIntoSlice() const override;
+
   Status InputDatasets(std::vector<const DatasetBase*>* inputs) const override;
 
   Status CheckExternalState() const override;
@@ -83,6 +83,8 @@ class TensorSliceDatasetOp::Dataset : public DatasetBase {
 
   int64_t Cardinality() const override { return tensors_[0].dim_size(0); }
 
+  bool SupportsGetNextIntoSlice() const override { return true; }
+
   Status InputDatasets(std::vector<const DatasetBase*>* inputs) const override {
     return Status::OK();
   }
@@ -166,6 +168,42 @@ class TensorSliceDatasetOp::Dataset : public DatasetBase {
       return Status::OK();
     }
 
+    // Copies the slice straight from the dataset's tensors into the batch,
+    // without materializing the element.
+    Status GetNextIntoSliceInternal(IteratorContext* ctx, int64_t batch_index,
+                                    std::vector<Tensor>* batch,
+                                    bool* end_of_sequence) override {
+      if (batch->size() != dataset()->tensors_.size()) {
+        return errors::InvalidArgument(
+            "Cannot batch an element with ", dataset()->tensors_.size(),
+            " components into a batch with ", batch->size(), " components.");
+      }
+      for (size_t i = 0; i < dataset()->tensors_.size(); ++i) {
+        TensorShape slice_shape((*batch)[i].shape());
+        slice_shape.RemoveDim(0);
+        if (slice_shape != dataset()->shapes_[i]) {
+          return errors::InvalidArgument(
+              "Cannot batch tensors with different shapes in component ", i,
+              ". The batch has slices of shape ", slice_shape.DebugString(),
+              " and the element had shape ",
+              dataset()->shapes_[i].DebugString(), ".");
+        }
+      }
+      Tensor split;
+      TF_RETURN_IF_ERROR(split_provider_->GetNext(&split, end_of_sequence));
+      if (*end_of_sequence) {
+        return Status::OK();
+      }
+      int64_t index = split.scalar<int64_t>()();
+      for (size_t i = 0; i < dataset()->tensors_.size(); ++i) {
+        TF_RETURN_IF_ERROR(batch_util::CopyContiguousSlices(
+            dataset()->tensors_[i], index, batch_index, /*num_slices=*/1,
+            &(*batch)[i]));
+      }
+      *end_of_sequence = false;
+      return Status::OK();
+    }
+
    protected:
     std::shared_ptr<model::Node> CreateNode(
         IteratorContext* ctx, model::Node::Args args) const override {
@@ -14,6 +14,8 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/tf_record_dataset_op.h"
 
+#include <algorithm>
+
 #include "tensorflow/core/data/name_utils.h"
 #include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
@@ -21,9 +23,11 @@ limitations under the License.
 #include "tensorflow/core/lib/io/buffered_inputstream.h"
 #include "tensorflow/core/lib/io/inputbuffer.h"
 #include "tensorflow/core/lib/io/random_inputstream.h"
+#include "tensorflow/core/lib/io/record_index.h"
 #include "tensorflow/core/lib/io/record_reader.h"
 #include "tensorflow/core/lib/io/zlib_compression_options.h"
 #include "tensorflow/core/lib/io/zlib_inputstream.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 namespace data {
@@ -38,10 +42,12 @@ namespace data {
 
 constexpr char kCurrentFileIndex[] = "current_file_index";
 constexpr char kOffset[] = "offset";
+constexpr char kRecordInFile[] = "record_in_file";
 constexpr char kGcsFsPrefix[] = "gs://";
 constexpr char kS3FsPrefix[] = "s3://";
 constexpr int64_t kCloudTpuBlockSize = 127LL << 20;  // 127MB.
 constexpr int64_t kS3BlockSize = kCloudTpuBlockSize;
+constexpr int64_t kDefaultReadAheadChunkSize = 8LL << 20;  // 8MB.
 
 bool is_cloud_tpu_gcs_fs() {
 #if (defined(PLATFORM_CLOUD_TPU) && defined(TPU_GCS_FS)) || \
@@ -54,15 +60,29 @@ bool is_cloud_tpu_gcs_fs() {
 class TFRecordDatasetOp::Dataset : public DatasetBase {
  public:
   explicit Dataset(OpKernelContext* ctx, std::vector<string> filenames,
-                   const string& compression_type, int64_t buffer_size)
+                   const string& compression_type, int64_t buffer_size,
+                   int64_t read_ahead_depth, int64_t read_ahead_chunk_size,
+                   std::vector<std::unique_ptr<io::RecordIndex>> indices)
       : DatasetBase(DatasetContext(ctx)),
         filenames_(std::move(filenames)),
         compression_type_(compression_type),
         options_(io::RecordReaderOptions::CreateRecordReaderOptions(
-            compression_type)) {
+            compression_type)),
+        indices_(std::move(indices)),
+        random_access_files_(indices_.size()) {
     if (buffer_size > 0) {
       options_.buffer_size = buffer_size;
     }
+    if (read_ahead_depth > 0) {
+      options_.read_ahead_depth = read_ahead_depth;
+      options_.read_ahead_chunk_size = read_ahead_chunk_size;
+    }
+    int64_t num_records = 0;
+    cumulative_num_records_.reserve(indices_.size());
+    for (const auto& index : indices_) {
+      num_records += index->num_records();
+      cumulative_num_records_.push_back(num_records);
+    }
   }
 
   std::unique_ptr<IteratorBase> MakeIteratorInternal(
@@ -90,8 +110,45 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
     return Status::OK();
   }
 
+  int64_t Cardinality() const override {
+    if (indices_.empty()) {
+      return kUnknownCardinality;
+    }
+    return cumulative_num_records_.back();
+  }
+
   Status CheckExternalState() const override { return Status::OK(); }
 
+  // Reads the record at `index` by looking up its location in the record
+  // index of the file containing it.
+  Status Get(OpKernelContext* ctx, int64 index,
+             std::vector<Tensor>* out_tensors) const override {
+    TF_RETURN_IF_ERROR(CheckRandomAccessCompatible(index));
+    const size_t file_index =
+        std::upper_bound(cumulative_num_records_.begin(),
+                         cumulative_num_records_.end(), index) -
+        cumulative_num_records_.begin();
+    const int64_t record_in_file =
+        file_index == 0 ? index
+                        : index - cumulative_num_records_[file_index - 1];
+    uint64 offset;
+    uint64 length;
+    TF_RETURN_IF_ERROR(
+        indices_[file_index]->Lookup(record_in_file, &offset, &length));
+    RandomAccessFile* file;
+    TF_RETURN_IF_ERROR(GetRandomAccessFile(ctx->env(), file_index, &file));
+    io::RecordReader reader(file, io::RecordReaderOptions());
+    out_tensors->clear();
+    out_tensors->emplace_back(ctx->get_allocator({}), DT_STRING,
+                              TensorShape({}));
+    TF_RETURN_IF_ERROR(
+        reader.ReadRecord(&offset, &out_tensors->back().scalar<tstring>()()));
+    static monitoring::CounterCell* bytes_counter =
+        metrics::GetTFDataBytesReadCounter(kDatasetType);
+    bytes_counter->IncrementBy(length);
+    return Status::OK();
+  }
+
  protected:
   Status AsGraphDefInternal(SerializationContext* ctx,
                             DatasetGraphDefBuilder* b,
@@ -130,6 +187,7 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
                 metrics::GetTFDataBytesReadCounter(kDatasetType);
             bytes_counter->IncrementBy(
                 out_tensors->back().scalar<tstring>()().size());
+            ++record_in_file_;
             *end_of_sequence = false;
             return Status::OK();
           }
@@ -163,6 +221,9 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
                         bool* end_of_sequence, int* num_skipped) override {
       *num_skipped = 0;
       mutex_lock l(mu_);
+      if (!dataset()->indices_.empty()) {
+        return SeekLocked(ctx, num_to_skip, end_of_sequence, num_skipped);
+      }
       do {
         // We are currently processing a file, so try to skip reading
         // the next (num_to_skip - *num_skipped) record.
@@ -171,6 +232,7 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
           Status s = reader_->SkipRecords(num_to_skip - *num_skipped,
                                           &last_num_skipped);
           *num_skipped += last_num_skipped;
+          record_in_file_ += last_num_skipped;
           if (s.ok()) {
             *end_of_sequence = false;
             return Status::OK();
@@ -215,6 +277,8 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
       if (reader_) {
         TF_RETURN_IF_ERROR(
             writer->WriteScalar(full_name(kOffset), reader_->TellOffset()));
+        TF_RETURN_IF_ERROR(
+            writer->WriteScalar(full_name(kRecordInFile), record_in_file_));
       }
       return Status::OK();
     }
@@ -227,16 +291,62 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
       TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kCurrentFileIndex),
                                             &current_file_index));
       current_file_index_ = size_t(current_file_index);
-      if (reader->Contains(full_name(kOffset))) {
-        int64_t offset;
-        TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kOffset), &offset));
-        TF_RETURN_IF_ERROR(SetupStreamsLocked(ctx->env()));
-        TF_RETURN_IF_ERROR(reader_->SeekOffset(offset));
+      if (!reader->Contains(full_name(kOffset))) {
+        return Status::OK();
+      }
+      int64_t offset;
+      TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kOffset), &offset));
+      TF_RETURN_IF_ERROR(SetupStreamsLocked(ctx->env()));
+      TF_RETURN_IF_ERROR(reader_->SeekOffset(offset));
+      if (reader->Contains(full_name(kRecordInFile))) {
+        TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kRecordInFile),
+                                              &record_in_file_));
+      } else if (!dataset()->indices_.empty()) {
+        // Checkpoints written before the record position was saved only have
+        // the offset, so the position is looked up in the record index.
+        TF_RETURN_IF_ERROR(dataset()->indices_[current_file_index_]->Find(
+            offset, &record_in_file_));
       }
       return Status::OK();
     }
 
    private:
+    // Skips records by seeking past them using the record indices, so that
+    // skipped records are never read and skipped files are never opened.
+    Status SeekLocked(IteratorContext* ctx, int num_to_skip,
+                      bool* end_of_sequence, int* num_skipped)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      while (*num_skipped < num_to_skip) {
+        if (current_file_index_ == dataset()->filenames_.size()) {
+          *end_of_sequence = true;
+          return Status::OK();
+        }
+        const io::RecordIndex& index =
+            *dataset()->indices_[current_file_index_];
+        const int64_t remaining = index.num_records() - record_in_file_;
+        const int64_t to_skip = num_to_skip - *num_skipped;
+        if (to_skip < remaining) {
+          uint64 offset;
+          uint64 length;
+          TF_RETURN_IF_ERROR(
+              index.Lookup(record_in_file_ + to_skip, &offset, &length));
+          if (!reader_) {
+            TF_RETURN_IF_ERROR(SetupStreamsLocked(ctx->env()));
+          }
+          TF_RETURN_IF_ERROR(reader_->SeekOffset(offset));
+          record_in_file_ += to_skip;
+          *num_skipped = num_to_skip;
+          break;
+        }
+        // The rest of the file is skipped, so move on to the next file.
+        *num_skipped += remaining;
+        ResetStreamsLocked();
+        ++current_file_index_;
+      }
+      *end_of_sequence = false;
+      return Status::OK();
+    }
+
     // Sets up reader streams to read from the file at `current_file_index_`.
     Status SetupStreamsLocked(Env* env) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
       if (current_file_index_ >= dataset()->filenames_.size()) {
@@ -257,10 +367,13 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
     void ResetStreamsLocked() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
       reader_.reset();
       file_.reset();
+      record_in_file_ = 0;
     }
 
     mutex mu_;
     size_t current_file_index_ TF_GUARDED_BY(mu_) = 0;
+    // The number of records of the current file read or skipped so far.
+    int64_t record_in_file_ TF_GUARDED_BY(mu_) = 0;
 
     // `reader_` will borrow the object that `file_` points to, so
     // we must destroy `reader_` before `file_`.
@@ -268,9 +381,32 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
     std::unique_ptr<io::SequentialRecordReader> reader_ TF_GUARDED_BY(mu_);
   };
 
+  // Returns the file at `file_index` for random access, opening it on first
+  // use.
+  Status GetRandomAccessFile(Env* env, size_t file_index,
+                             RandomAccessFile** file) const {
+    mutex_lock l(mu_);
+    std::unique_ptr<RandomAccessFile>& cached =
+        random_access_files_[file_index];
+    if (!cached) {
+      TF_RETURN_IF_ERROR(
+          env->NewRandomAccessFile(filenames_[file_index], &cached));
+    }
+    *file = cached.get();
+    return Status::OK();
+  }
+
   const std::vector<string> filenames_;
   const tstring compression_type_;
   io::RecordReaderOptions options_;
+  // The record index of each file, or empty if the files are not indexed.
+  const std::vector<std::unique_ptr<io::RecordIndex>> indices_;
+  // The number of records in files [0, i], for each file i.
+  std::vector<int64_t> cumulative_num_records_;
+
+  mutable mutex mu_;
+  mutable std::vector<std::unique_ptr<RandomAccessFile>> random_access_files_
+      TF_GUARDED_BY(mu_);
 };
 
 TFRecordDatasetOp::TFRecordDatasetOp(OpKernelConstruction* ctx)
@@ -322,8 +458,49 @@ void TFRecordDatasetOp::MakeDataset(OpKernelContext* ctx,
     buffer_size = kS3BlockSize;
   }
 
-  *output =
-      new Dataset(ctx, std::move(filenames), compression_type, buffer_size);
+  // Reading ahead costs up to `depth` chunks of memory per open file in
+  // exchange for hiding the latency of reads, so it is opt-in.
+  int64_t read_ahead_depth;
+  OP_REQUIRES_OK(ctx, ReadInt64FromEnvVar("TF_TFRECORD_READ_AHEAD_DEPTH",
+                                          /*default_val=*/0,
+                                          &read_ahead_depth));
+  int64_t read_ahead_chunk_size;
+  OP_REQUIRES_OK(ctx, ReadInt64FromEnvVar("TF_TFRECORD_READ_AHEAD_CHUNK_SIZE",
+                                          kDefaultReadAheadChunkSize,
+                                          &read_ahead_chunk_size));
+  OP_REQUIRES(ctx, read_ahead_chunk_size > 0,
+              errors::InvalidArgument(
+                  "TF_TFRECORD_READ_AHEAD_CHUNK_SIZE must be positive, got ",
+                  read_ahead_chunk_size));
+
+  // Record indices make random access and skipping cheap, at the cost of
+  // opening one more file per input file, so they are opt-in.
+  bool use_index;
+  OP_REQUIRES_OK(ctx, ReadBoolFromEnvVar("TF_TFRECORD_USE_INDEX",
+                                         /*default_val=*/false, &use_index));
+  std::vector<std::unique_ptr<io::RecordIndex>> indices;
+  if (use_index) {
+    if (!compression_type.empty()) {
+      LOG(WARNING) << "Record indices are only supported for uncompressed "
+                   << "TFRecord files, ignoring TF_TFRECORD_USE_INDEX.";
+    } else {
+      indices.resize(filenames.size());
+      for (size_t i = 0; i < filenames.size(); ++i) {
+        Status s = io::RecordIndex::Open(
+            ctx->env(), io::RecordIndexFilename(filenames[i]), &indices[i]);
+        if (!s.ok()) {
+          LOG(WARNING) << "Failed to open the record index of " << filenames[i]
+                       << ", reading the files sequentially instead: " << s;
+          indices.clear();
+          break;
+        }
+      }
+    }
+  }
+
+  *output = new Dataset(ctx, std::move(filenames), compression_type,
+                        buffer_size, read_ahead_depth, read_ahead_chunk_size,
+                        std::move(indices));
 }
 
 namespace {
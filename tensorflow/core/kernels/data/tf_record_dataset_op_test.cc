@@ -12,6 +12,9 @@ limitations under the License.
 #include "tensorflow/core/kernels/data/tf_record_dataset_op.h"
 
 #include "tensorflow/core/data/dataset_test_base.h"
+#include "tensorflow/core/data/serialization_utils.h"
+#include "tensorflow/core/lib/io/record_index.h"
+#include "tensorflow/core/lib/io/record_reader.h"
 
 namespace tensorflow {
 namespace data {
@@ -264,6 +267,138 @@ IteratorSaveAndRestoreTestCases() {
 ITERATOR_SAVE_AND_RESTORE_TEST_P(TFRecordDatasetOpTest, TFRecordDatasetParams,
                                  IteratorSaveAndRestoreTestCases())
 
+// Uncompressed files with record indices.
+TFRecordDatasetParams IndexedTFRecordDatasetParams() {
+  std::vector<tstring> filenames = {
+      absl::StrCat(testing::TmpDir(), "/tf_record_INDEXED_1"),
+      absl::StrCat(testing::TmpDir(), "/tf_record_INDEXED_2")};
+  std::vector<std::vector<string>> contents = {{"1", "22", "333"},
+                                               {"a", "bb", "ccc"}};
+  TF_CHECK_OK(
+      CreateTestFiles(filenames, contents, CompressionType::UNCOMPRESSED));
+  for (const tstring& filename : filenames) {
+    TF_CHECK_OK(io::BuildRecordIndex(Env::Default(), filename,
+                                     io::RecordIndexFilename(filename)));
+  }
+  return TFRecordDatasetParams(filenames,
+                               /*compression_type=*/
+                               CompressionType::UNCOMPRESSED,
+                               /*buffer_size=*/10,
+                               /*node_name=*/kNodeName);
+}
+
+TEST_F(TFRecordDatasetOpTest, IndexedCardinalityAndGet) {
+  setenv("TF_TFRECORD_USE_INDEX", "1", /*overwrite=*/1);
+  auto dataset_params = IndexedTFRecordDatasetParams();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  unsetenv("TF_TFRECORD_USE_INDEX");
+  TF_ASSERT_OK(CheckDatasetCardinality(6));
+
+  std::vector<tstring> expected = {"1", "22", "333", "a", "bb", "ccc"};
+  for (int i = expected.size() - 1; i >= 0; --i) {
+    std::vector<Tensor> out_tensors;
+    TF_ASSERT_OK(dataset_->Get(dataset_ctx_.get(), i, &out_tensors));
+    ASSERT_EQ(out_tensors.size(), 1);
+    EXPECT_EQ(out_tensors[0].scalar<tstring>()(), expected[i]);
+  }
+  std::vector<Tensor> out_tensors;
+  EXPECT_TRUE(errors::IsOutOfRange(
+      dataset_->Get(dataset_ctx_.get(), expected.size(), &out_tensors)));
+}
+
+TEST_F(TFRecordDatasetOpTest, IndexedSkip) {
+  setenv("TF_TFRECORD_USE_INDEX", "1", /*overwrite=*/1);
+  auto dataset_params = IndexedTFRecordDatasetParams();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  unsetenv("TF_TFRECORD_USE_INDEX");
+
+  // Reads every other record, like a shard of a dataset split in two.
+  std::vector<tstring> outputs;
+  bool end_of_sequence = false;
+  int num_skipped;
+  TF_ASSERT_OK(iterator_->Skip(iterator_ctx_.get(), /*num_to_skip=*/1,
+                               &end_of_sequence, &num_skipped));
+  EXPECT_EQ(num_skipped, 1);
+  while (!end_of_sequence) {
+    std::vector<Tensor> out_tensors;
+    TF_ASSERT_OK(iterator_->GetNext(iterator_ctx_.get(), &out_tensors,
+                                    &end_of_sequence));
+    if (end_of_sequence) break;
+    outputs.push_back(out_tensors[0].scalar<tstring>()());
+    TF_ASSERT_OK(iterator_->Skip(iterator_ctx_.get(), /*num_to_skip=*/1,
+                                 &end_of_sequence, &num_skipped));
+  }
+  EXPECT_EQ(outputs, std::vector<tstring>({"22", "a", "ccc"}));
+
+  // Skipping across files after a restore from a checkpoint.
+  TF_ASSERT_OK(dataset_->MakeIterator(iterator_ctx_.get(), /*parent=*/nullptr,
+                                      dataset_params.iterator_prefix(),
+                                      &iterator_));
+  std::vector<Tensor> out_tensors;
+  TF_ASSERT_OK(
+      iterator_->GetNext(iterator_ctx_.get(), &out_tensors, &end_of_sequence));
+  std::unique_ptr<SerializationContext> serialization_ctx;
+  TF_ASSERT_OK(CreateSerializationContext(&serialization_ctx));
+  VariantTensorDataWriter writer;
+  TF_ASSERT_OK(iterator_->Save(serialization_ctx.get(), &writer));
+  std::vector<const VariantTensorData*> data;
+  writer.GetData(&data);
+  VariantTensorDataReader reader(data);
+  TF_ASSERT_OK(RestoreIterator(iterator_ctx_.get(), &reader,
+                               dataset_params.iterator_prefix(), *dataset_,
+                               &iterator_));
+  TF_ASSERT_OK(iterator_->Skip(iterator_ctx_.get(), /*num_to_skip=*/3,
+                               &end_of_sequence, &num_skipped));
+  EXPECT_EQ(num_skipped, 3);
+  out_tensors.clear();
+  TF_ASSERT_OK(
+      iterator_->GetNext(iterator_ctx_.get(), &out_tensors, &end_of_sequence));
+  ASSERT_FALSE(end_of_sequence);
+  EXPECT_EQ(out_tensors[0].scalar<tstring>()(), "bb");
+  TF_ASSERT_OK(iterator_->Skip(iterator_ctx_.get(), /*num_to_skip=*/5,
+                               &end_of_sequence, &num_skipped));
+  EXPECT_EQ(num_skipped, 1);
+  EXPECT_TRUE(end_of_sequence);
+}
+
+TEST_F(TFRecordDatasetOpTest, IndexedRestoreWithoutRecordPosition) {
+  setenv("TF_TFRECORD_USE_INDEX", "1", /*overwrite=*/1);
+  auto dataset_params = IndexedTFRecordDatasetParams();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  unsetenv("TF_TFRECORD_USE_INDEX");
+
+  // Checkpoints written before the position of the record in its file was
+  // saved only have the offset of the next record, here the second one.
+  const string prefix = name_utils::IteratorPrefix(
+      TFRecordDatasetOp::kDatasetType, dataset_params.iterator_prefix());
+  VariantTensorDataWriter writer;
+  TF_ASSERT_OK(writer.WriteScalar(FullName(prefix, "current_file_index"),
+                                  int64_t{0}));
+  TF_ASSERT_OK(writer.WriteScalar(
+      FullName(prefix, "offset"),
+      static_cast<int64_t>(io::RecordReader::kHeaderSize + 1 +
+                           io::RecordReader::kFooterSize)));
+  std::vector<const VariantTensorData*> data;
+  writer.GetData(&data);
+  VariantTensorDataReader reader(data);
+  TF_ASSERT_OK(RestoreIterator(iterator_ctx_.get(), &reader,
+                               dataset_params.iterator_prefix(), *dataset_,
+                               &iterator_));
+
+  // Skipping the last two records of the first file relies on the position
+  // derived from the offset.
+  bool end_of_sequence = false;
+  int num_skipped;
+  TF_ASSERT_OK(iterator_->Skip(iterator_ctx_.get(), /*num_to_skip=*/2,
+                               &end_of_sequence, &num_skipped));
+  EXPECT_EQ(num_skipped, 2);
+  std::vector<Tensor> out_tensors;
+  TF_ASSERT_OK(
+      iterator_->GetNext(iterator_ctx_.get(), &out_tensors, &end_of_sequence));
+  ASSERT_FALSE(end_of_sequence);
+  EXPECT_EQ(out_tensors[0].scalar<tstring>()(), "a");
+}
+
 }  // namespace
 }  // namespace data
 }  // namespace tensorflow
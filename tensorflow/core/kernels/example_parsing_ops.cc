@@ -30,6 +30,7 @@ limitations under the License.
 #include "tensorflow/core/lib/gtl/array_slice.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/protobuf.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/example_proto_fast_parsing.h"
 #include "tensorflow/core/util/example_proto_helper.h"
 #include "tensorflow/core/util/sparse/sparse_tensor.h"
@@ -50,6 +51,10 @@ class ParseExampleOp : public OpKernel {
   explicit ParseExampleOp(OpKernelConstruction* ctx)
       : OpKernel(ctx), op_version_(ctx->def().op() == kParseExampleV2 ? 2 : 1) {
     OP_REQUIRES_OK(ctx, attrs_.Init(ctx, op_version_));
+    // Opt-in for the two-pass columnar parser, see
+    // `example::FastParseExampleConfig::columnar`.
+    OP_REQUIRES_OK(ctx, ReadBoolFromEnvVar("TF_PARSE_EXAMPLE_COLUMNAR",
+                                           /*default_val=*/false, &columnar_));
   }
 
   void Compute(OpKernelContext* ctx) override {
@@ -211,6 +216,7 @@ class ParseExampleOp : public OpKernel {
       const std::vector<StringPiece>& ragged_keys_t,
       const OpInputList& dense_defaults) const {
     example::FastParseExampleConfig config;
+    config.columnar = columnar_;
     config.dense.reserve(attrs_.num_dense);
     for (int d = 0; d < attrs_.num_dense; ++d) {
       config.dense.emplace_back(dense_keys_t[d], attrs_.dense_types[d],
@@ -285,6 +291,7 @@ class ParseExampleOp : public OpKernel {
 
   ParseExampleAttrs attrs_;
   int op_version_;
+  bool columnar_ = false;
   absl::once_flag flag_;
 };
 
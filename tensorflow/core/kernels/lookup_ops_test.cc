@@ -15,16 +15,24 @@ limitations under the License.
 
 // Tests kernels of lookup ops.
 
+#include <map>
+
 #include "tensorflow/core/framework/fake_input.h"
 #include "tensorflow/core/framework/lookup_interface.h"
 #include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/shape_inference_testutil.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/kernels/lookup_table_op.h"
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/blocking_counter.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 
 namespace tensorflow {
 namespace {
@@ -100,5 +108,215 @@ TEST_F(LookupOpsTest, AnonymousHashTable_RefCounting) {
   EXPECT_FALSE(alive);
 }
 
+class ConcurrentMutableHashTableTest : public OpsTestBase {
+ public:
+  // Creates a table with the `op` op and returns its handle.
+  template <typename K, typename V>
+  Tensor CreateTable(const string& op) {
+    TF_CHECK_OK(NodeDefBuilder("table", op)
+                    .Attr("key_dtype", DataTypeToEnum<K>::v())
+                    .Attr("value_dtype", DataTypeToEnum<V>::v())
+                    .Finalize(node_def()));
+    TF_CHECK_OK(InitOp());
+    TF_CHECK_OK(RunOpKernel());
+    return *GetOutput(0);
+  }
+
+  core::RefCountPtr<lookup::LookupInterface> GetTable(const Tensor& handle) {
+    core::RefCountPtr<lookup::LookupInterface> table;
+    TF_CHECK_OK(LookupResource(context_.get(),
+                               handle.scalar<ResourceHandle>()(), &table));
+    return table;
+  }
+
+  // Exports the keys and values of the table with handle `handle`.
+  template <typename K, typename V>
+  void Export(const Tensor& handle, Tensor* keys, Tensor* values) {
+    TF_CHECK_OK(NodeDefBuilder("export", "LookupTableExportV2")
+                    .Input(FakeInput(DT_RESOURCE))
+                    .Attr("Tkeys", DataTypeToEnum<K>::v())
+                    .Attr("Tvalues", DataTypeToEnum<V>::v())
+                    .Finalize(node_def()));
+    TF_CHECK_OK(InitOp());
+    AddInputFromArray<ResourceHandle>(TensorShape({}),
+                                      {handle.scalar<ResourceHandle>()()});
+    TF_CHECK_OK(RunOpKernel());
+    *keys = *GetOutput(0);
+    *values = *GetOutput(1);
+  }
+};
+
+TEST_F(ConcurrentMutableHashTableTest, InsertFindRemove) {
+  Tensor handle = CreateTable<int64_t, float>("ConcurrentMutableHashTable");
+  core::RefCountPtr<lookup::LookupInterface> table = GetTable(handle);
+  EXPECT_EQ(table->size(), 0);
+
+  const int kNumKeys = 1000;
+  Tensor keys(DT_INT64, TensorShape({kNumKeys}));
+  Tensor values(DT_FLOAT, TensorShape({kNumKeys}));
+  for (int i = 0; i < kNumKeys; ++i) {
+    keys.vec<int64_t>()(i) = i * 7919;
+    values.vec<float>()(i) = i;
+  }
+  TF_ASSERT_OK(table->Insert(nullptr, keys, values));
+  EXPECT_EQ(table->size(), kNumKeys);
+
+  // The last value inserted for a key wins.
+  TF_ASSERT_OK(table->Insert(nullptr, test::AsTensor<int64_t>({0, 0}),
+                             test::AsTensor<float>({-1, -2})));
+  EXPECT_EQ(table->size(), kNumKeys);
+
+  Tensor found(DT_FLOAT, TensorShape({3}));
+  TF_ASSERT_OK(table->Find(nullptr, test::AsTensor<int64_t>({0, 7919, 1}),
+                           &found, test::AsTensor<float>({42})));
+  test::ExpectTensorEqual<float>(found, test::AsTensor<float>({-2, 1, 42}));
+  TF_ASSERT_OK(table->Find(nullptr, test::AsTensor<int64_t>({0, 7919, 1}),
+                           &found, test::AsTensor<float>({40, 41, 42})));
+  test::ExpectTensorEqual<float>(found, test::AsTensor<float>({-2, 1, 42}));
+
+  TF_ASSERT_OK(table->Remove(nullptr, test::AsTensor<int64_t>({0, 1})));
+  EXPECT_EQ(table->size(), kNumKeys - 1);
+  TF_ASSERT_OK(table->Find(nullptr, test::AsTensor<int64_t>({0, 7919, 1}),
+                           &found, test::AsTensor<float>({42})));
+  test::ExpectTensorEqual<float>(found, test::AsTensor<float>({42, 1, 42}));
+}
+
+TEST_F(ConcurrentMutableHashTableTest, StringKeys) {
+  Tensor handle = CreateTable<tstring, int64_t>("ConcurrentMutableHashTable");
+  core::RefCountPtr<lookup::LookupInterface> table = GetTable(handle);
+  TF_ASSERT_OK(table->Insert(nullptr, test::AsTensor<tstring>({"a", "b", "c"}),
+                             test::AsTensor<int64_t>({1, 2, 3})));
+  Tensor found(DT_INT64, TensorShape({3}));
+  TF_ASSERT_OK(table->Find(nullptr, test::AsTensor<tstring>({"c", "d", "a"}),
+                           &found, test::AsTensor<int64_t>({-1})));
+  test::ExpectTensorEqual<int64_t>(found, test::AsTensor<int64_t>({3, -1, 1}));
+}
+
+TEST_F(ConcurrentMutableHashTableTest, ExportImportCompatibleWithHashTable) {
+  Tensor handle = CreateTable<int64_t, int64_t>("ConcurrentMutableHashTable");
+  core::RefCountPtr<lookup::LookupInterface> table = GetTable(handle);
+  TF_ASSERT_OK(table->Insert(nullptr, test::AsTensor<int64_t>({1, 2, 3}),
+                             test::AsTensor<int64_t>({10, 20, 30})));
+  Tensor keys, values;
+  Export<int64_t, int64_t>(handle, &keys, &values);
+  ASSERT_EQ(keys.NumElements(), 3);
+  std::map<int64_t, int64_t> exported;
+  for (int i = 0; i < 3; ++i) {
+    exported[keys.vec<int64_t>()(i)] = values.vec<int64_t>()(i);
+  }
+  EXPECT_EQ(exported, (std::map<int64_t, int64_t>{{1, 10}, {2, 20}, {3, 30}}));
+
+  // Import into a MutableHashTableV2 and back, replacing the contents.
+  Tensor other_handle = CreateTable<int64_t, int64_t>("MutableHashTableV2");
+  core::RefCountPtr<lookup::LookupInterface> other = GetTable(other_handle);
+  TF_ASSERT_OK(other->ImportValues(nullptr, keys, values));
+  Export<int64_t, int64_t>(other_handle, &keys, &values);
+  TF_ASSERT_OK(table->Insert(nullptr, test::AsTensor<int64_t>({4}),
+                             test::AsTensor<int64_t>({40})));
+  TF_ASSERT_OK(table->ImportValues(nullptr, keys, values));
+  EXPECT_EQ(table->size(), 3);
+  Tensor found(DT_INT64, TensorShape({4}));
+  TF_ASSERT_OK(table->Find(nullptr, test::AsTensor<int64_t>({1, 2, 3, 4}),
+                           &found, test::AsTensor<int64_t>({-1})));
+  test::ExpectTensorEqual<int64_t>(found,
+                                   test::AsTensor<int64_t>({10, 20, 30, -1}));
+}
+
+TEST_F(ConcurrentMutableHashTableTest, ConcurrentInsertAndFind) {
+  Tensor handle = CreateTable<int64_t, int64_t>("ConcurrentMutableHashTable");
+  core::RefCountPtr<lookup::LookupInterface> table = GetTable(handle);
+  const int kNumThreads = 8;
+  const int kKeysPerThread = 10000;
+  const int kBatchSize = 100;
+  {
+    thread::ThreadPool pool(Env::Default(), "test", kNumThreads);
+    for (int t = 0; t < kNumThreads; ++t) {
+      pool.Schedule([&, t]() {
+        Tensor keys(DT_INT64, TensorShape({kBatchSize}));
+        Tensor values(DT_INT64, TensorShape({kBatchSize}));
+        Tensor found(DT_INT64, TensorShape({kBatchSize}));
+        for (int b = 0; b < kKeysPerThread; b += kBatchSize) {
+          for (int i = 0; i < kBatchSize; ++i) {
+            const int64_t key = (t * kKeysPerThread + b + i);
+            keys.vec<int64_t>()(i) = key;
+            values.vec<int64_t>()(i) = -key;
+          }
+          TF_EXPECT_OK(table->Insert(nullptr, keys, values));
+          TF_EXPECT_OK(table->Find(nullptr, keys, &found,
+                                   test::AsTensor<int64_t>({1})));
+          test::ExpectTensorEqual<int64_t>(found, values);
+        }
+      });
+    }
+  }
+  EXPECT_EQ(table->size(), kNumThreads * kKeysPerThread);
+}
+
+class ConcurrentMutableHashTableBenchmark
+    : public ConcurrentMutableHashTableTest {
+ public:
+  void TestBody() override {}
+};
+
+// Runs `state.range(0)` threads that each look up batches of 1024 keys, and
+// insert a batch after every 16 lookups, into a MutableHashTableV2 if
+// `state.range(1)` is 0 and a ConcurrentMutableHashTable otherwise.
+void BM_MutableHashTableFindInsert(::testing::benchmark::State& state) {
+  const int num_threads = state.range(0);
+  const string op = state.range(1) ? "ConcurrentMutableHashTable"
+                                   : "MutableHashTableV2";
+  const int kNumKeys = 1 << 20;
+  const int kBatchSize = 1024;
+  const int kBatchesPerThread = 64;
+
+  ConcurrentMutableHashTableBenchmark helper;
+  Tensor handle = helper.CreateTable<int64_t, int64_t>(op);
+  core::RefCountPtr<lookup::LookupInterface> table = helper.GetTable(handle);
+  Tensor all_keys(DT_INT64, TensorShape({kNumKeys}));
+  for (int i = 0; i < kNumKeys; ++i) {
+    all_keys.vec<int64_t>()(i) = i;
+  }
+  TF_CHECK_OK(table->Insert(nullptr, all_keys, all_keys));
+
+  thread::ThreadPool pool(Env::Default(), "bench", num_threads);
+  for (auto s : state) {
+    BlockingCounter counter(num_threads);
+    for (int t = 0; t < num_threads; ++t) {
+      pool.Schedule([&, t]() {
+        random::PhiloxRandom philox(t, 17);
+        random::SimplePhilox rand(&philox);
+        Tensor keys(DT_INT64, TensorShape({kBatchSize}));
+        Tensor found(DT_INT64, TensorShape({kBatchSize}));
+        Tensor default_value = test::AsTensor<int64_t>({-1});
+        for (int b = 0; b < kBatchesPerThread; ++b) {
+          for (int i = 0; i < kBatchSize; ++i) {
+            keys.vec<int64_t>()(i) = rand.Uniform(2 * kNumKeys);
+          }
+          if (b % 16 == 0) {
+            TF_CHECK_OK(table->Insert(nullptr, keys, keys));
+          } else {
+            TF_CHECK_OK(table->Find(nullptr, keys, &found, default_value));
+          }
+        }
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          num_threads * kBatchesPerThread * kBatchSize);
+}
+
+BENCHMARK(BM_MutableHashTableFindInsert)
+    ->ArgPair(1, 0)
+    ->ArgPair(1, 1)
+    ->ArgPair(4, 0)
+    ->ArgPair(4, 1)
+    ->ArgPair(16, 0)
+    ->ArgPair(16, 1)
+    ->ArgPair(64, 0)
+    ->ArgPair(64, 1)
+    ->UseRealTime();
+
 }  // namespace
 }  // namespace tensorflow
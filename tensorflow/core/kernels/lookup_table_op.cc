@@ -16,10 +16,14 @@ limitations under the License.
 #include "tensorflow/core/kernels/lookup_table_op.h"
 #define EIGEN_USE_THREADS
 
+#include <limits>
 #include <string>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/hash/hash.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/variant.h"
@@ -212,6 +216,293 @@ class MutableHashTableOfScalars final : public LookupInterface {
   std::unordered_map<K, V> table_ TF_GUARDED_BY(mu_);
 };
 
+// Lookup table with the same semantics as MutableHashTableOfScalars that
+// partitions its entries across `kNumShards` open-addressing hash tables
+// (absl::flat_hash_map), each guarded by its own mutex, so that concurrent
+// Find() and Insert() calls only contend on the shards they share.
+//
+// Each batched operation groups its keys by shard and takes the lock of each
+// shard it touches once. Find() prefetches the bucket of an upcoming key while
+// probing the current one.
+//
+// Export and import use the same key and value tensors as
+// MutableHashTableOfScalars, so checkpoints of both tables are interchangeable.
+template <class K, class V>
+class ConcurrentMutableHashTableOfScalars final : public LookupInterface {
+ public:
+  ConcurrentMutableHashTableOfScalars(OpKernelContext* ctx, OpKernel* kernel) {}
+
+  size_t size() const override {
+    size_t size = 0;
+    for (const Shard& shard : shards_) {
+      tf_shared_lock l(shard.mu);
+      size += shard.table.size();
+    }
+    return size;
+  }
+
+  Status Find(OpKernelContext* ctx, const Tensor& key, Tensor* value,
+              const Tensor& default_value) override {
+    const auto key_values = key.flat<K>();
+    auto value_values = value->flat<V>();
+    const auto default_flat = default_value.flat<V>();
+
+    int64_t total = value_values.size();
+    int64_t default_total = default_flat.size();
+    bool is_full_size_default = (total == default_total);
+
+    std::vector<K> keys;
+    std::vector<int64_t> order, shard_starts;
+    GroupByShard(key_values, &keys, &order, &shard_starts);
+    for (int s = 0; s < kNumShards; ++s) {
+      const int64_t start = shard_starts[s], end = shard_starts[s + 1];
+      if (start == end) continue;
+      const Shard& shard = shards_[s];
+      tf_shared_lock l(shard.mu);
+      for (int64_t j = start; j < end; ++j) {
+        if (j + kPrefetchDistance < end) {
+          shard.table.prefetch(keys[order[j + kPrefetchDistance]]);
+        }
+        const int64_t i = order[j];
+        auto it = shard.table.find(keys[i]);
+        // See MutableHashTableOfScalars::Find() for how default values are
+        // used.
+        value_values(i) =
+            it != shard.table.end()
+                ? it->second
+                : (is_full_size_default ? default_flat(i) : default_flat(0));
+      }
+    }
+    return Status::OK();
+  }
+
+  Status DoInsert(bool clear, const Tensor& keys, const Tensor& values) {
+    const auto key_values = keys.flat<K>();
+    const auto value_values = values.flat<V>();
+
+    std::vector<K> copied_keys;
+    std::vector<int64_t> order, shard_starts;
+    GroupByShard(key_values, &copied_keys, &order, &shard_starts);
+    // The keys of a shard keep their relative order, so that the last of
+    // several values inserted for the same key wins.
+    auto insert_into_shard = [&](int s) {
+      for (int64_t j = shard_starts[s]; j < shard_starts[s + 1]; ++j) {
+        const int64_t i = order[j];
+        shards_[s].table.insert_or_assign(
+            std::move(copied_keys[i]),
+            SubtleMustCopyIfIntegral(value_values(i)));
+      }
+    };
+    if (clear) {
+      // Replaces the contents of all shards at once.
+      AllShardsLock l(this, /*exclusive=*/true);
+      for (int s = 0; s < kNumShards; ++s) {
+        shards_[s].table.clear();
+        insert_into_shard(s);
+      }
+      return Status::OK();
+    }
+    for (int s = 0; s < kNumShards; ++s) {
+      if (shard_starts[s] == shard_starts[s + 1]) continue;
+      mutex_lock l(shards_[s].mu);
+      insert_into_shard(s);
+    }
+    return Status::OK();
+  }
+
+  Status Insert(OpKernelContext* ctx, const Tensor& keys,
+                const Tensor& values) override {
+    return DoInsert(false, keys, values);
+  }
+
+  Status Remove(OpKernelContext* ctx, const Tensor& keys) override {
+    const auto key_values = keys.flat<K>();
+
+    std::vector<K> copied_keys;
+    std::vector<int64_t> order, shard_starts;
+    GroupByShard(key_values, &copied_keys, &order, &shard_starts);
+    for (int s = 0; s < kNumShards; ++s) {
+      const int64_t start = shard_starts[s], end = shard_starts[s + 1];
+      if (start == end) continue;
+      Shard& shard = shards_[s];
+      mutex_lock l(shard.mu);
+      for (int64_t j = start; j < end; ++j) {
+        shard.table.erase(copied_keys[order[j]]);
+      }
+    }
+    return Status::OK();
+  }
+
+  Status ImportValues(OpKernelContext* ctx, const Tensor& keys,
+                      const Tensor& values) override {
+    return DoInsert(true, keys, values);
+  }
+
+  Status ExportValues(OpKernelContext* ctx) override {
+    AllShardsLock l(this, /*exclusive=*/false);
+    int64_t size = SizeLocked();
+
+    Tensor* keys;
+    Tensor* values;
+    TF_RETURN_IF_ERROR(
+        ctx->allocate_output("keys", TensorShape({size}), &keys));
+    TF_RETURN_IF_ERROR(
+        ctx->allocate_output("values", TensorShape({size}), &values));
+    ExportKeysAndValues(keys, values);
+    return Status::OK();
+  }
+
+  DataType key_dtype() const override { return DataTypeToEnum<K>::v(); }
+
+  DataType value_dtype() const override { return DataTypeToEnum<V>::v(); }
+
+  TensorShape key_shape() const final { return TensorShape(); }
+
+  TensorShape value_shape() const override { return TensorShape(); }
+
+  int64_t MemoryUsed() const override {
+    int64_t ret = sizeof(ConcurrentMutableHashTableOfScalars);
+    for (const Shard& shard : shards_) {
+      tf_shared_lock l(shard.mu);
+      // One control byte and one slot per bucket.
+      ret += shard.table.capacity() * (1 + sizeof(K) + sizeof(V));
+    }
+    return ret;
+  }
+
+  Status AsGraphDef(GraphDefBuilder* builder, Node** out) const override {
+    AllShardsLock l(this, /*exclusive=*/false);
+    int64_t size = SizeLocked();
+    Tensor keys(key_dtype(), TensorShape({size}));
+    Tensor values(value_dtype(), TensorShape({size}));
+    ExportKeysAndValues(&keys, &values);
+
+    // See MutableHashTableOfScalars::AsGraphDef() for why the table is shared
+    // using a unique node name.
+    Node* table = ops::SourceOp(
+        "ConcurrentMutableHashTable",
+        builder->opts()
+            .WithName(UniqueNodeName("ConcurrentMutableHashTableFromGraphDef"))
+            .WithAttr("use_node_name_sharing", true)
+            .WithAttr("key_dtype", key_dtype())
+            .WithAttr("value_dtype", value_dtype()));
+    Node* keys_node = ops::SourceOp(
+        "Const",
+        builder->opts().WithAttr("dtype", key_dtype()).WithAttr("value", keys));
+    Node* values_node =
+        ops::SourceOp("Const", builder->opts()
+                                   .WithAttr("dtype", value_dtype())
+                                   .WithAttr("value", values));
+    Node* import_table =
+        ops::TernaryOp("LookupTableImportV2", table, keys_node, values_node,
+                       builder->opts()
+                           .WithAttr("Tin", key_dtype())
+                           .WithAttr("Tout", value_dtype()));
+    *out = ops::UnaryOp("Identity", table,
+                        builder->opts().WithControlInput(import_table));
+    return Status::OK();
+  }
+
+ private:
+  static constexpr int kNumShardBits = 6;
+  static constexpr int kNumShards = 1 << kNumShardBits;
+  // How many keys ahead of the current one Find() prefetches buckets for.
+  static constexpr int kPrefetchDistance = 8;
+
+  struct Shard {
+    mutable mutex mu;
+    // Guarded by `mu`. Not annotated since operations on all shards lock them
+    // through AllShardsLock.
+    absl::flat_hash_map<K, V> table;
+  };
+
+  // Holds the locks of all shards, taken in order.
+  class AllShardsLock {
+   public:
+    AllShardsLock(const ConcurrentMutableHashTableOfScalars* t, bool exclusive)
+        : table_(t), exclusive_(exclusive) {
+      for (const Shard& shard : table_->shards_) {
+        if (exclusive_) {
+          shard.mu.lock();
+        } else {
+          shard.mu.lock_shared();
+        }
+      }
+    }
+    ~AllShardsLock() {
+      for (const Shard& shard : table_->shards_) {
+        if (exclusive_) {
+          shard.mu.unlock();
+        } else {
+          shard.mu.unlock_shared();
+        }
+      }
+    }
+
+   private:
+    const ConcurrentMutableHashTableOfScalars* const table_;
+    const bool exclusive_;
+  };
+
+  // Returns the shard of the key with hash `hash`. Uses the high bits of the
+  // hash, which absl::flat_hash_map does not use to place keys.
+  static int ShardOf(size_t hash) {
+    return hash >> (std::numeric_limits<size_t>::digits - kNumShardBits);
+  }
+
+  // Copies `key_values` into `keys` and sets `order` to the indices of the
+  // keys grouped by shard, keeping the relative order of the keys of each
+  // shard. The indices of the keys of shard `s` are
+  // `order[shard_starts[s]:shard_starts[s + 1]]`.
+  template <typename KeyValues>
+  static void GroupByShard(const KeyValues& key_values, std::vector<K>* keys,
+                           std::vector<int64_t>* order,
+                           std::vector<int64_t>* shard_starts) {
+    const int64_t num_keys = key_values.size();
+    keys->reserve(num_keys);
+    std::vector<uint8> shard_ids(num_keys);
+    shard_starts->assign(kNumShards + 1, 0);
+    absl::Hash<K> hasher;
+    for (int64_t i = 0; i < num_keys; ++i) {
+      keys->push_back(SubtleMustCopyIfIntegral(key_values(i)));
+      shard_ids[i] = ShardOf(hasher(keys->back()));
+      ++(*shard_starts)[shard_ids[i] + 1];
+    }
+    for (int s = 0; s < kNumShards; ++s) {
+      (*shard_starts)[s + 1] += (*shard_starts)[s];
+    }
+    std::vector<int64_t> next(shard_starts->begin(), shard_starts->end() - 1);
+    order->resize(num_keys);
+    for (int64_t i = 0; i < num_keys; ++i) {
+      (*order)[next[shard_ids[i]]++] = i;
+    }
+  }
+
+  // REQUIRES: all shards are locked.
+  int64_t SizeLocked() const {
+    int64_t size = 0;
+    for (const Shard& shard : shards_) size += shard.table.size();
+    return size;
+  }
+
+  // Writes all keys and values into `keys` and `values`. `keys` and `values`
+  // must point to tensors of size `SizeLocked()`.
+  // REQUIRES: all shards are locked.
+  void ExportKeysAndValues(Tensor* keys, Tensor* values) const {
+    auto keys_data = keys->flat<K>();
+    auto values_data = values->flat<V>();
+    int64_t i = 0;
+    for (const Shard& shard : shards_) {
+      for (auto it = shard.table.begin(); it != shard.table.end(); ++it, ++i) {
+        keys_data(i) = it->first;
+        values_data(i) = it->second;
+      }
+    }
+  }
+
+  Shard shards_[kNumShards];
+};
+
 // Lookup table that wraps an unordered_map. Behaves identical to
 // MutableHashTableOfScalars except that each value must be a vector.
 template <class K, class V>
@@ -1160,6 +1451,33 @@ REGISTER_KERNEL(tstring, int64_t);
 
 #undef REGISTER_KERNEL
 
+// Register the ConcurrentMutableHashTable op.
+#define REGISTER_KERNEL(key_dtype, value_dtype)                       \
+  REGISTER_KERNEL_BUILDER(                                            \
+      Name("ConcurrentMutableHashTable")                              \
+          .Device(DEVICE_CPU)                                         \
+          .TypeConstraint<key_dtype>("key_dtype")                     \
+          .TypeConstraint<value_dtype>("value_dtype"),                \
+      LookupTableOp<lookup::ConcurrentMutableHashTableOfScalars<      \
+                        key_dtype, value_dtype>,                      \
+                    key_dtype, value_dtype>)
+
+REGISTER_KERNEL(int32, double);
+REGISTER_KERNEL(int32, float);
+REGISTER_KERNEL(int32, int32);
+REGISTER_KERNEL(int64_t, double);
+REGISTER_KERNEL(int64_t, float);
+REGISTER_KERNEL(int64_t, int32);
+REGISTER_KERNEL(int64_t, int64_t);
+REGISTER_KERNEL(int64_t, tstring);
+REGISTER_KERNEL(tstring, bool);
+REGISTER_KERNEL(tstring, double);
+REGISTER_KERNEL(tstring, float);
+REGISTER_KERNEL(tstring, int32);
+REGISTER_KERNEL(tstring, int64_t);
+
+#undef REGISTER_KERNEL
+
 // Register the MutableHashTableOfTensors op.
 #define REGISTER_KERNEL(key_dtype, value_dtype)                                \
   REGISTER_KERNEL_BUILDER(                                                     \
@@ -0,0 +1,224 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/lib/io/read_ahead_inputstream.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "tensorflow/core/lib/core/errors.h"
+
+namespace tensorflow {
+namespace io {
+
+ReadAheadInputStream::ReadAheadInputStream(RandomAccessFile* file,
+                                           size_t chunk_size, int depth,
+                                           Env* env)
+    : file_(file),
+      chunk_size_(std::max<size_t>(chunk_size, 1)),
+      depth_(std::max(depth, 1)),
+      env_(env) {
+  {
+    mutex_lock l(mu_);
+    for (int i = 0; i < depth_ + 1; ++i) {
+      free_buffers_.emplace_back(new char[chunk_size_]);
+    }
+  }
+  Restart(0);
+}
+
+ReadAheadInputStream::~ReadAheadInputStream() { StopFetching(); }
+
+void ReadAheadInputStream::StopFetching() {
+  {
+    mutex_lock l(mu_);
+    cancelled_ = true;
+    cond_var_.notify_all();
+  }
+  // Joins the background thread.
+  thread_.reset();
+}
+
+void ReadAheadInputStream::Restart(int64_t position) {
+  StopFetching();
+  {
+    mutex_lock l(mu_);
+    for (Chunk& chunk : ready_) {
+      free_buffers_.push_back(std::move(chunk.buffer));
+    }
+    ready_.clear();
+    if (current_.buffer) {
+      free_buffers_.push_back(std::move(current_.buffer));
+    }
+    current_ = Chunk();
+    current_.offset = position;
+    pos_ = 0;
+    initial_skip_ = position % chunk_size_;
+    next_fetch_offset_ = position - initial_skip_;
+    cancelled_ = false;
+  }
+  thread_.reset(env_->StartThread(ThreadOptions(), "read_ahead_inputstream",
+                                  [this]() { FetchLoop(); }));
+}
+
+void ReadAheadInputStream::FetchLoop() {
+  while (true) {
+    std::unique_ptr<char[]> buffer;
+    int64_t offset;
+    {
+      mutex_lock l(mu_);
+      while (!cancelled_ && free_buffers_.empty()) {
+        cond_var_.wait(l);
+      }
+      if (cancelled_) return;
+      buffer = std::move(free_buffers_.back());
+      free_buffers_.pop_back();
+      offset = next_fetch_offset_;
+      next_fetch_offset_ += chunk_size_;
+    }
+
+    StringPiece data;
+    Status s = file_->Read(offset, chunk_size_, &data, buffer.get());
+    if (s.ok() && data.size() < chunk_size_) {
+      s = errors::OutOfRange("eof");
+    }
+    if (!s.ok() && !errors::IsOutOfRange(s)) {
+      data = StringPiece();
+    }
+    if (!data.empty() && data.data() != buffer.get()) {
+      memmove(buffer.get(), data.data(), data.size());
+    }
+
+    mutex_lock l(mu_);
+    if (cancelled_) {
+      free_buffers_.push_back(std::move(buffer));
+      return;
+    }
+    Chunk chunk;
+    chunk.offset = offset;
+    chunk.buffer = std::move(buffer);
+    chunk.size = data.size();
+    chunk.status = s;
+    ready_.push_back(std::move(chunk));
+    cond_var_.notify_all();
+    if (!s.ok()) return;
+  }
+}
+
+Status ReadAheadInputStream::EnsureCurrentChunk() {
+  while (pos_ >= current_.size) {
+    if (!current_.status.ok()) return current_.status;
+    mutex_lock l(mu_);
+    if (current_.buffer) {
+      free_buffers_.push_back(std::move(current_.buffer));
+      cond_var_.notify_all();
+    }
+    while (ready_.empty()) {
+      cond_var_.wait(l);
+    }
+    current_ = std::move(ready_.front());
+    ready_.pop_front();
+    pos_ = std::min(initial_skip_, current_.size);
+    initial_skip_ = 0;
+  }
+  return Status::OK();
+}
+
+Status ReadAheadInputStream::ReadNBytes(int64_t bytes_to_read,
+                                        tstring* result) {
+  if (bytes_to_read < 0) {
+    return errors::InvalidArgument("Can't read a negative number of bytes: ",
+                                   bytes_to_read);
+  }
+  result->clear();
+  while (result->size() < bytes_to_read) {
+    // On OUT_OF_RANGE, `result` keeps the bytes read before the end of file.
+    TF_RETURN_IF_ERROR(EnsureCurrentChunk());
+    const size_t bytes_to_copy =
+        std::min<size_t>(current_.size - pos_, bytes_to_read - result->size());
+    result->append(current_.buffer.get() + pos_, bytes_to_copy);
+    pos_ += bytes_to_copy;
+  }
+  return Status::OK();
+}
+
+Status ReadAheadInputStream::ReadNBytesView(int64_t bytes_to_read,
+                                            tstring* scratch,
+                                            StringPiece* result) {
+  if (bytes_to_read < 0) {
+    return errors::InvalidArgument("Can't read a negative number of bytes: ",
+                                   bytes_to_read);
+  }
+  *result = StringPiece();
+  if (bytes_to_read == 0) return Status::OK();
+  Status s = EnsureCurrentChunk();
+  if (!s.ok()) {
+    scratch->clear();
+    return s;
+  }
+  if (current_.size - pos_ >= bytes_to_read) {
+    *result = StringPiece(current_.buffer.get() + pos_, bytes_to_read);
+    pos_ += bytes_to_read;
+    return Status::OK();
+  }
+  s = ReadNBytes(bytes_to_read, scratch);
+  *result = *scratch;
+  return s;
+}
+
+Status ReadAheadInputStream::SkipNBytes(int64_t bytes_to_skip) {
+  if (bytes_to_skip < 0) {
+    return errors::InvalidArgument("Can't skip a negative number of bytes: ",
+                                   bytes_to_skip);
+  }
+  const int64_t target = Tell() + bytes_to_skip;
+  bool beyond_read_ahead;
+  {
+    mutex_lock l(mu_);
+    const Chunk& last = ready_.empty() ? current_ : ready_.back();
+    const int64_t read_ahead_end =
+        next_fetch_offset_ + static_cast<int64_t>(chunk_size_) * depth_;
+    beyond_read_ahead = last.status.ok() && target >= read_ahead_end;
+  }
+  if (beyond_read_ahead) {
+    // Rather than reading all the chunks in between, restart the reads at the
+    // target. As in RandomAccessInputStream, probe the last skipped byte
+    // first: skips past the end of file fall through to the loop below, which
+    // stops at the end of file.
+    char byte;
+    StringPiece data;
+    Status s = file_->Read(target - 1, 1, &data, &byte);
+    if ((s.ok() || errors::IsOutOfRange(s)) && data.size() == 1) {
+      Restart(target);
+      return Status::OK();
+    }
+  }
+  while (target > current_.offset + current_.size) {
+    pos_ = current_.size;
+    TF_RETURN_IF_ERROR(EnsureCurrentChunk());
+  }
+  pos_ = target - current_.offset;
+  return Status::OK();
+}
+
+int64_t ReadAheadInputStream::Tell() const { return current_.offset + pos_; }
+
+Status ReadAheadInputStream::Reset() {
+  Restart(0);
+  return Status::OK();
+}
+
+}  // namespace io
+}  // namespace tensorflow
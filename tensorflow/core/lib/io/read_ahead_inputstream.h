@@ -0,0 +1,118 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_LIB_IO_READ_AHEAD_INPUTSTREAM_H_
+#define TENSORFLOW_CORE_LIB_IO_READ_AHEAD_INPUTSTREAM_H_
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/lib/io/inputstream_interface.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/file_system.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/stringpiece.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace io {
+
+// Wraps a RandomAccessFile in an InputStreamInterface that reads ahead of the
+// caller. A background thread reads consecutive, `chunk_size`-aligned chunks
+// of the file into a ring of `depth` buffers while the caller consumes the
+// ones before them, which hides the latency of each read on filesystems with
+// high latency but high bandwidth.
+//
+// Sequential reads are the fast path. Skips that land beyond the chunks
+// already read, and Reset(), discard the ring and restart the background reads
+// at the new position.
+//
+// A given instance of ReadAheadInputStream is NOT safe for concurrent use by
+// multiple threads.
+class ReadAheadInputStream : public InputStreamInterface {
+ public:
+  // Does not take ownership of `file`, which must outlive *this. Allocates
+  // `depth + 1` buffers of `chunk_size` bytes: `depth` for the background
+  // reads and one for the chunk being consumed.
+  ReadAheadInputStream(RandomAccessFile* file, size_t chunk_size, int depth,
+                       Env* env = Env::Default());
+
+  ~ReadAheadInputStream() override;
+
+  Status ReadNBytes(int64_t bytes_to_read, tstring* result) override;
+
+  // Like ReadNBytes, but avoids copying when possible: if the bytes lie
+  // within a single chunk, `*result` points into that chunk and stays valid
+  // until the next call on this stream. Otherwise the bytes are copied into
+  // `*scratch` and `*result` points to it.
+  Status ReadNBytesView(int64_t bytes_to_read, tstring* scratch,
+                        StringPiece* result);
+
+  Status SkipNBytes(int64_t bytes_to_skip) override;
+
+  int64_t Tell() const override;
+
+  Status Reset() override;
+
+ private:
+  struct Chunk {
+    int64_t offset = 0;
+    std::unique_ptr<char[]> buffer;
+    size_t size = 0;
+    // Status of the read that produced the chunk. OUT_OF_RANGE marks the last
+    // chunk of the file, whose data is still valid.
+    Status status;
+  };
+
+  // Stops the background reads and restarts them at `position`.
+  void Restart(int64_t position);
+  void StopFetching();
+
+  // Background thread body: fills free buffers with consecutive chunks.
+  void FetchLoop();
+
+  // Makes `current_` a chunk with unread bytes, waiting for the background
+  // thread if needed. Returns OUT_OF_RANGE at the end of the file.
+  Status EnsureCurrentChunk();
+
+  RandomAccessFile* const file_;  // Not owned.
+  const size_t chunk_size_;
+  const int depth_;
+  Env* const env_;
+
+  // The chunk being consumed by the caller, and the position within it.
+  Chunk current_;
+  size_t pos_ = 0;
+  // Bytes to skip in the first chunk fetched after a restart.
+  size_t initial_skip_ = 0;
+
+  mutex mu_;
+  condition_variable cond_var_;
+  std::unique_ptr<Thread> thread_;
+  bool cancelled_ TF_GUARDED_BY(mu_) = false;
+  int64_t next_fetch_offset_ TF_GUARDED_BY(mu_) = 0;
+  // Chunks read by the background thread but not yet consumed, in order.
+  std::deque<Chunk> ready_ TF_GUARDED_BY(mu_);
+  std::vector<std::unique_ptr<char[]>> free_buffers_ TF_GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ReadAheadInputStream);
+};
+
+}  // namespace io
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_LIB_IO_READ_AHEAD_INPUTSTREAM_H_
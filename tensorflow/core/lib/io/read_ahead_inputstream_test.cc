@@ -0,0 +1,144 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/lib/io/read_ahead_inputstream.h"
+
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace io {
+namespace {
+
+std::unique_ptr<RandomAccessFile> MakeFile(const string& contents) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/read_ahead_inputstream_test";
+  TF_CHECK_OK(WriteStringToFile(env, fname, contents));
+  std::unique_ptr<RandomAccessFile> file;
+  TF_CHECK_OK(env->NewRandomAccessFile(fname, &file));
+  return file;
+}
+
+TEST(ReadAheadInputStream, ReadNBytes) {
+  std::unique_ptr<RandomAccessFile> file = MakeFile("0123456789");
+  for (size_t chunk_size : {1, 2, 3, 4, 10, 11, 1024}) {
+    for (int depth : {1, 2, 5}) {
+      tstring read;
+      ReadAheadInputStream in(file.get(), chunk_size, depth);
+      TF_ASSERT_OK(in.ReadNBytes(3, &read));
+      EXPECT_EQ(read, "012");
+      EXPECT_EQ(3, in.Tell());
+      TF_ASSERT_OK(in.ReadNBytes(0, &read));
+      EXPECT_EQ(read, "");
+      EXPECT_EQ(3, in.Tell());
+      TF_ASSERT_OK(in.ReadNBytes(5, &read));
+      EXPECT_EQ(read, "34567");
+      EXPECT_EQ(8, in.Tell());
+      EXPECT_TRUE(errors::IsOutOfRange(in.ReadNBytes(20, &read)));
+      EXPECT_EQ(read, "89");
+      EXPECT_EQ(10, in.Tell());
+      TF_ASSERT_OK(in.ReadNBytes(0, &read));
+      EXPECT_EQ(read, "");
+      EXPECT_EQ(10, in.Tell());
+    }
+  }
+}
+
+TEST(ReadAheadInputStream, ReadNBytesView) {
+  std::unique_ptr<RandomAccessFile> file = MakeFile("0123456789");
+  tstring scratch;
+  StringPiece view;
+  ReadAheadInputStream in(file.get(), /*chunk_size=*/4, /*depth=*/2);
+  // Within the first chunk: no copy.
+  TF_ASSERT_OK(in.ReadNBytesView(3, &scratch, &view));
+  EXPECT_EQ(view, "012");
+  EXPECT_NE(view.data(), scratch.data());
+  // Spanning chunks: copied to the scratch buffer.
+  TF_ASSERT_OK(in.ReadNBytesView(6, &scratch, &view));
+  EXPECT_EQ(view, "345678");
+  EXPECT_EQ(view.data(), scratch.data());
+  EXPECT_EQ(9, in.Tell());
+  EXPECT_TRUE(errors::IsOutOfRange(in.ReadNBytesView(5, &scratch, &view)));
+  EXPECT_EQ(view, "9");
+  EXPECT_EQ(10, in.Tell());
+}
+
+TEST(ReadAheadInputStream, SkipNBytes) {
+  std::unique_ptr<RandomAccessFile> file = MakeFile("0123456789");
+  for (size_t chunk_size : {1, 2, 3, 4, 10, 11, 1024}) {
+    tstring read;
+    ReadAheadInputStream in(file.get(), chunk_size, /*depth=*/2);
+    TF_ASSERT_OK(in.SkipNBytes(3));
+    EXPECT_EQ(3, in.Tell());
+    TF_ASSERT_OK(in.SkipNBytes(0));
+    EXPECT_EQ(3, in.Tell());
+    TF_ASSERT_OK(in.ReadNBytes(2, &read));
+    EXPECT_EQ(read, "34");
+    EXPECT_EQ(5, in.Tell());
+    TF_ASSERT_OK(in.SkipNBytes(4));
+    EXPECT_EQ(9, in.Tell());
+    TF_ASSERT_OK(in.ReadNBytes(1, &read));
+    EXPECT_EQ(read, "9");
+    TF_ASSERT_OK(in.SkipNBytes(0));
+    EXPECT_EQ(10, in.Tell());
+    EXPECT_TRUE(errors::IsOutOfRange(in.SkipNBytes(5)));
+    EXPECT_EQ(10, in.Tell());
+    EXPECT_TRUE(errors::IsOutOfRange(in.ReadNBytes(1, &read)));
+    EXPECT_EQ(read, "");
+  }
+}
+
+TEST(ReadAheadInputStream, SkipToEndOfFile) {
+  std::unique_ptr<RandomAccessFile> file = MakeFile("0123456789");
+  for (size_t chunk_size : {1, 3, 4, 10, 1024}) {
+    ReadAheadInputStream in(file.get(), chunk_size, /*depth=*/1);
+    TF_ASSERT_OK(in.SkipNBytes(10));
+    EXPECT_EQ(10, in.Tell());
+    tstring read;
+    EXPECT_TRUE(errors::IsOutOfRange(in.ReadNBytes(1, &read)));
+  }
+}
+
+TEST(ReadAheadInputStream, Reset) {
+  std::unique_ptr<RandomAccessFile> file = MakeFile("0123456789");
+  tstring read;
+  ReadAheadInputStream in(file.get(), /*chunk_size=*/3, /*depth=*/2);
+  TF_ASSERT_OK(in.ReadNBytes(8, &read));
+  EXPECT_EQ(read, "01234567");
+  TF_ASSERT_OK(in.Reset());
+  EXPECT_EQ(0, in.Tell());
+  TF_ASSERT_OK(in.ReadNBytes(4, &read));
+  EXPECT_EQ(read, "0123");
+  // Skipping far ahead restarts the reads from the middle of a chunk.
+  TF_ASSERT_OK(in.Reset());
+  TF_ASSERT_OK(in.SkipNBytes(7));
+  TF_ASSERT_OK(in.ReadNBytes(3, &read));
+  EXPECT_EQ(read, "789");
+}
+
+TEST(ReadAheadInputStream, EmptyFile) {
+  std::unique_ptr<RandomAccessFile> file = MakeFile("");
+  tstring read;
+  ReadAheadInputStream in(file.get(), /*chunk_size=*/4, /*depth=*/2);
+  TF_ASSERT_OK(in.ReadNBytes(0, &read));
+  EXPECT_TRUE(errors::IsOutOfRange(in.ReadNBytes(1, &read)));
+  EXPECT_EQ(read, "");
+  EXPECT_EQ(0, in.Tell());
+}
+
+}  // anonymous namespace
+}  // namespace io
+}  // namespace tensorflow
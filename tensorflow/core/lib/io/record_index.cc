@@ -0,0 +1,159 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/lib/io/record_index.h"
+
+#include "tensorflow/core/lib/core/coding.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/io/record_reader.h"
+#include "tensorflow/core/platform/strcat.h"
+
+namespace tensorflow {
+namespace io {
+
+std::string RecordIndexFilename(StringPiece filename) {
+  return strings::StrCat(filename, ".idx");
+}
+
+/* static */ constexpr size_t RecordIndexBuilder::kEntrySize;
+/* static */ constexpr size_t RecordIndexBuilder::kFooterSize;
+/* static */ constexpr uint64 RecordIndexBuilder::kMagic;
+
+RecordIndexBuilder::RecordIndexBuilder(WritableFile* dest) : dest_(dest) {}
+
+Status RecordIndexBuilder::Add(uint64 offset, uint64 length) {
+  char entry[kEntrySize];
+  core::EncodeFixed64(entry, offset);
+  core::EncodeFixed64(entry + sizeof(uint64), length);
+  TF_RETURN_IF_ERROR(dest_->Append(StringPiece(entry, sizeof(entry))));
+  ++num_records_;
+  return Status::OK();
+}
+
+Status RecordIndexBuilder::Finish() {
+  char footer[kFooterSize];
+  core::EncodeFixed64(footer, num_records_);
+  core::EncodeFixed64(footer + sizeof(uint64), kMagic);
+  return dest_->Append(StringPiece(footer, sizeof(footer)));
+}
+
+RecordIndex::RecordIndex(std::unique_ptr<RandomAccessFile> file,
+                         int64_t num_records)
+    : file_(std::move(file)), num_records_(num_records) {}
+
+Status RecordIndex::Open(Env* env, const std::string& index_filename,
+                         std::unique_ptr<RecordIndex>* index) {
+  uint64 file_size;
+  TF_RETURN_IF_ERROR(env->GetFileSize(index_filename, &file_size));
+  if (file_size < RecordIndexBuilder::kFooterSize ||
+      (file_size - RecordIndexBuilder::kFooterSize) %
+              RecordIndexBuilder::kEntrySize !=
+          0) {
+    return errors::DataLoss("Record index ", index_filename,
+                            " has an invalid size of ", file_size, " bytes");
+  }
+  std::unique_ptr<RandomAccessFile> file;
+  TF_RETURN_IF_ERROR(env->NewRandomAccessFile(index_filename, &file));
+  char scratch[RecordIndexBuilder::kFooterSize];
+  StringPiece footer;
+  TF_RETURN_IF_ERROR(file->Read(file_size - RecordIndexBuilder::kFooterSize,
+                                sizeof(scratch), &footer, scratch));
+  const uint64 num_records = core::DecodeFixed64(footer.data());
+  const uint64 magic = core::DecodeFixed64(footer.data() + sizeof(uint64));
+  if (magic != RecordIndexBuilder::kMagic ||
+      num_records != (file_size - RecordIndexBuilder::kFooterSize) /
+                         RecordIndexBuilder::kEntrySize) {
+    return errors::DataLoss("Record index ", index_filename,
+                            " has an invalid footer");
+  }
+  index->reset(new RecordIndex(std::move(file), num_records));
+  return Status::OK();
+}
+
+Status RecordIndex::Lookup(int64_t i, uint64* offset, uint64* length) const {
+  if (i < 0 || i >= num_records_) {
+    return errors::OutOfRange("Record ", i, " is out of range [0, ",
+                              num_records_, ")");
+  }
+  char scratch[RecordIndexBuilder::kEntrySize];
+  StringPiece entry;
+  TF_RETURN_IF_ERROR(file_->Read(i * RecordIndexBuilder::kEntrySize,
+                                 sizeof(scratch), &entry, scratch));
+  if (entry.size() != sizeof(scratch)) {
+    return errors::DataLoss("Truncated record index entry ", i);
+  }
+  *offset = core::DecodeFixed64(entry.data());
+  *length = core::DecodeFixed64(entry.data() + sizeof(uint64));
+  return Status::OK();
+}
+
+Status RecordIndex::Find(uint64 offset, int64_t* i) const {
+  int64_t lo = 0;
+  int64_t hi = num_records_;
+  while (lo < hi) {
+    const int64_t mid = lo + (hi - lo) / 2;
+    uint64 mid_offset;
+    uint64 length;
+    TF_RETURN_IF_ERROR(Lookup(mid, &mid_offset, &length));
+    if (mid_offset < offset) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  uint64 record_offset = 0;
+  if (lo < num_records_) {
+    uint64 length;
+    TF_RETURN_IF_ERROR(Lookup(lo, &record_offset, &length));
+  } else if (num_records_ > 0) {
+    uint64 length;
+    TF_RETURN_IF_ERROR(Lookup(num_records_ - 1, &record_offset, &length));
+    record_offset +=
+        RecordReader::kHeaderSize + length + RecordReader::kFooterSize;
+  }
+  if (record_offset != offset) {
+    return errors::NotFound("No record starts at offset ", offset);
+  }
+  *i = lo;
+  return Status::OK();
+}
+
+Status BuildRecordIndex(Env* env, const std::string& filename,
+                        const std::string& index_filename) {
+  std::unique_ptr<RandomAccessFile> file;
+  TF_RETURN_IF_ERROR(env->NewRandomAccessFile(filename, &file));
+  std::unique_ptr<WritableFile> index_file;
+  TF_RETURN_IF_ERROR(env->NewWritableFile(index_filename, &index_file));
+  RecordIndexBuilder builder(index_file.get());
+
+  RecordReaderOptions options;
+  options.buffer_size = 256 << 10;
+  RecordReader reader(file.get(), options);
+  uint64 offset = 0;
+  tstring record;
+  while (true) {
+    const uint64 record_offset = offset;
+    Status s = reader.ReadRecord(&offset, &record);
+    if (errors::IsOutOfRange(s)) {
+      break;
+    }
+    TF_RETURN_IF_ERROR(s);
+    TF_RETURN_IF_ERROR(builder.Add(record_offset, record.size()));
+  }
+  TF_RETURN_IF_ERROR(builder.Finish());
+  return index_file->Close();
+}
+
+}  // namespace io
+}  // namespace tensorflow
@@ -0,0 +1,114 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_LIB_IO_RECORD_INDEX_H_
+#define TENSORFLOW_CORE_LIB_IO_RECORD_INDEX_H_
+
+#include <memory>
+#include <string>
+
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/stringpiece.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace io {
+
+// A record index is a sidecar file which stores the location of every record
+// of an uncompressed TFRecord file, so that records can be read in any order.
+// By convention the index of "file" is "file.idx".
+//
+// Format of an index of n records:
+//  entry     entries[n]
+//  uint64    n
+//  uint64    magic number
+//
+// Format of an entry:
+//  uint64    offset of the record in the TFRecord file
+//  uint64    length of the record data
+//
+// All integers are encoded as little-endian fixed64.
+
+// Returns the conventional name of the index of `filename`.
+std::string RecordIndexFilename(StringPiece filename);
+
+// Writes a record index to a file, one entry at a time.
+class RecordIndexBuilder {
+ public:
+  static constexpr size_t kEntrySize = 2 * sizeof(uint64);
+  static constexpr size_t kFooterSize = 2 * sizeof(uint64);
+  // "TFRECIDX" when encoded.
+  static constexpr uint64 kMagic = 0x5844494345524654ULL;
+
+  // Creates a builder that will append the index to "*dest", which must be
+  // initially empty and remain live while the builder is in use.
+  explicit RecordIndexBuilder(WritableFile* dest);
+
+  // Adds the record of `length` bytes of data at `offset` in the TFRecord
+  // file.
+  Status Add(uint64 offset, uint64 length);
+
+  // Writes the footer of the index. Does *not* close the WritableFile.
+  Status Finish();
+
+  int64_t num_records() const { return num_records_; }
+
+ private:
+  WritableFile* dest_;
+  int64_t num_records_ = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(RecordIndexBuilder);
+};
+
+// Looks up the location of records in a record index. The index is read on
+// demand, so the memory usage is independent of the number of records.
+// Thread-safe.
+class RecordIndex {
+ public:
+  // Opens the index at `index_filename`, checking that its size is consistent
+  // with its footer.
+  static Status Open(Env* env, const std::string& index_filename,
+                     std::unique_ptr<RecordIndex>* index);
+
+  int64_t num_records() const { return num_records_; }
+
+  // Looks up the record at position `i`, which must be in [0, num_records()).
+  // `offset` may be passed to `RecordReader::ReadRecord()`.
+  Status Lookup(int64_t i, uint64* offset, uint64* length) const;
+
+  // Finds the position `i` of the record which starts at `offset`, with a
+  // binary search. An offset at the end of the last record maps to
+  // num_records(). Returns NotFound if no record starts at `offset`.
+  Status Find(uint64 offset, int64_t* i) const;
+
+ private:
+  RecordIndex(std::unique_ptr<RandomAccessFile> file, int64_t num_records);
+
+  const std::unique_ptr<RandomAccessFile> file_;
+  const int64_t num_records_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(RecordIndex);
+};
+
+// Builds the index of the uncompressed TFRecord file `filename` by scanning it,
+// and writes it to `index_filename`.
+Status BuildRecordIndex(Env* env, const std::string& filename,
+                        const std::string& index_filename);
+
+}  // namespace io
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_LIB_IO_RECORD_INDEX_H_
@@ -0,0 +1,251 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/lib/io/record_index.h"
+
+#include <vector>
+
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/record_reader.h"
+#include "tensorflow/core/lib/io/record_writer.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/blocking_counter.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/platform/threadpool.h"
+
+namespace tensorflow {
+namespace io {
+namespace {
+
+std::vector<string> TestRecords() {
+  std::vector<string> records;
+  for (int i = 0; i < 100; ++i) {
+    records.push_back(string(i * 7 % 31, 'a' + i % 26));
+  }
+  return records;
+}
+
+// Writes `records` to `filename`, and their index to `index_filename` if it
+// is not empty.
+Status WriteRecords(const string& filename, const string& index_filename,
+                    const std::vector<string>& records) {
+  Env* env = Env::Default();
+  std::unique_ptr<WritableFile> file;
+  TF_RETURN_IF_ERROR(env->NewWritableFile(filename, &file));
+  std::unique_ptr<WritableFile> index_file;
+  RecordWriter writer(file.get());
+  if (!index_filename.empty()) {
+    TF_RETURN_IF_ERROR(env->NewWritableFile(index_filename, &index_file));
+    TF_RETURN_IF_ERROR(writer.EnableIndex(index_file.get()));
+  }
+  for (const string& record : records) {
+    TF_RETURN_IF_ERROR(writer.WriteRecord(record));
+  }
+  TF_RETURN_IF_ERROR(writer.Close());
+  if (index_file) {
+    TF_RETURN_IF_ERROR(index_file->Close());
+  }
+  return file->Close();
+}
+
+// Reads every record of `filename` through `index_filename`, in reverse order.
+void VerifyIndex(const string& filename, const string& index_filename,
+                 const std::vector<string>& records) {
+  Env* env = Env::Default();
+  std::unique_ptr<RecordIndex> index;
+  TF_ASSERT_OK(RecordIndex::Open(env, index_filename, &index));
+  ASSERT_EQ(index->num_records(), records.size());
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(env->NewRandomAccessFile(filename, &file));
+  RecordReader reader(file.get());
+  for (int64_t i = records.size() - 1; i >= 0; --i) {
+    uint64 offset;
+    uint64 length;
+    TF_ASSERT_OK(index->Lookup(i, &offset, &length));
+    EXPECT_EQ(length, records[i].size());
+    tstring record;
+    TF_ASSERT_OK(reader.ReadRecord(&offset, &record));
+    EXPECT_EQ(record, records[i]);
+  }
+  uint64 offset = 0;
+  uint64 length;
+  for (int64_t i = 0; i < index->num_records(); ++i) {
+    TF_ASSERT_OK(index->Lookup(i, &offset, &length));
+    int64_t found;
+    TF_ASSERT_OK(index->Find(offset, &found));
+    EXPECT_EQ(found, i);
+    EXPECT_TRUE(errors::IsNotFound(index->Find(offset + 1, &found)));
+  }
+  // The offset at the end of the file maps to one past the last record.
+  uint64 file_size;
+  TF_ASSERT_OK(env->GetFileSize(filename, &file_size));
+  int64_t found;
+  TF_ASSERT_OK(index->Find(file_size, &found));
+  EXPECT_EQ(found, index->num_records());
+  EXPECT_TRUE(errors::IsOutOfRange(
+      index->Lookup(records.size(), &offset, &length)));
+  EXPECT_TRUE(errors::IsOutOfRange(index->Lookup(-1, &offset, &length)));
+}
+
+TEST(RecordIndexTest, WriterIndex) {
+  const string filename = testing::TmpDir() + "/record_index_writer";
+  const std::vector<string> records = TestRecords();
+  TF_ASSERT_OK(
+      WriteRecords(filename, RecordIndexFilename(filename), records));
+  VerifyIndex(filename, RecordIndexFilename(filename), records);
+}
+
+TEST(RecordIndexTest, BuildRecordIndex) {
+  const string filename = testing::TmpDir() + "/record_index_build";
+  const std::vector<string> records = TestRecords();
+  TF_ASSERT_OK(WriteRecords(filename, /*index_filename=*/"", records));
+  TF_ASSERT_OK(BuildRecordIndex(Env::Default(), filename,
+                                RecordIndexFilename(filename)));
+  VerifyIndex(filename, RecordIndexFilename(filename), records);
+
+  // The index matches the one written by RecordWriter.
+  const string writer_filename = testing::TmpDir() + "/record_index_build2";
+  TF_ASSERT_OK(WriteRecords(writer_filename,
+                            RecordIndexFilename(writer_filename), records));
+  string built;
+  string written;
+  TF_ASSERT_OK(ReadFileToString(Env::Default(), RecordIndexFilename(filename),
+                                &built));
+  TF_ASSERT_OK(ReadFileToString(Env::Default(),
+                                RecordIndexFilename(writer_filename),
+                                &written));
+  EXPECT_EQ(built, written);
+}
+
+TEST(RecordIndexTest, EmptyFile) {
+  const string filename = testing::TmpDir() + "/record_index_empty";
+  TF_ASSERT_OK(WriteRecords(filename, RecordIndexFilename(filename), {}));
+  VerifyIndex(filename, RecordIndexFilename(filename), {});
+}
+
+TEST(RecordIndexTest, InvalidIndex) {
+  Env* env = Env::Default();
+  const string filename = testing::TmpDir() + "/record_index_invalid";
+  const std::vector<string> records = TestRecords();
+  TF_ASSERT_OK(WriteRecords(filename, RecordIndexFilename(filename), records));
+  string contents;
+  TF_ASSERT_OK(
+      ReadFileToString(env, RecordIndexFilename(filename), &contents));
+  std::unique_ptr<RecordIndex> index;
+
+  // Truncated.
+  TF_ASSERT_OK(WriteStringToFile(env, RecordIndexFilename(filename),
+                                 contents.substr(0, contents.size() - 1)));
+  EXPECT_TRUE(errors::IsDataLoss(
+      RecordIndex::Open(env, RecordIndexFilename(filename), &index)));
+
+  // Missing an entry.
+  TF_ASSERT_OK(WriteStringToFile(
+      env, RecordIndexFilename(filename),
+      contents.substr(RecordIndexBuilder::kEntrySize)));
+  EXPECT_TRUE(errors::IsDataLoss(
+      RecordIndex::Open(env, RecordIndexFilename(filename), &index)));
+
+  // Not an index.
+  TF_ASSERT_OK(WriteStringToFile(env, RecordIndexFilename(filename),
+                                 string(contents.size(), 'x')));
+  EXPECT_TRUE(errors::IsDataLoss(
+      RecordIndex::Open(env, RecordIndexFilename(filename), &index)));
+}
+
+TEST(RecordIndexTest, EnableIndexErrors) {
+  Env* env = Env::Default();
+  const string filename = testing::TmpDir() + "/record_index_errors";
+  std::unique_ptr<WritableFile> file;
+  TF_ASSERT_OK(env->NewWritableFile(filename, &file));
+  std::unique_ptr<WritableFile> index_file;
+  TF_ASSERT_OK(
+      env->NewWritableFile(RecordIndexFilename(filename), &index_file));
+
+  RecordWriter compressed_writer(
+      file.get(), RecordWriterOptions::CreateRecordWriterOptions("ZLIB"));
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      compressed_writer.EnableIndex(index_file.get())));
+
+  std::unique_ptr<WritableFile> file2;
+  TF_ASSERT_OK(env->NewWritableFile(filename + "2", &file2));
+  RecordWriter writer(file2.get());
+  TF_ASSERT_OK(writer.WriteRecord("abc"));
+  EXPECT_TRUE(
+      errors::IsFailedPrecondition(writer.EnableIndex(index_file.get())));
+}
+
+// Reads a file of 4096 4KB records split into 64 shards by 64 concurrent
+// workers, each reading every 64th record. Without an index (use_index == 0)
+// each worker has to skip over the records of the other shards.
+void BM_ShardedRead(::testing::benchmark::State& state) {
+  const bool use_index = state.range(0);
+  constexpr int kNumWorkers = 64;
+  constexpr int kNumRecords = 4096;
+  constexpr int kRecordSize = 4 << 10;
+
+  Env* env = Env::Default();
+  string fname;
+  ASSERT_TRUE(env->LocalTempFilename(&fname));
+  const string index_fname = RecordIndexFilename(fname);
+  TF_CHECK_OK(WriteRecords(fname, index_fname,
+                           std::vector<string>(kNumRecords,
+                                               string(kRecordSize, 'x'))));
+  std::unique_ptr<RandomAccessFile> file;
+  TF_CHECK_OK(env->NewRandomAccessFile(fname, &file));
+  std::unique_ptr<RecordIndex> index;
+  TF_CHECK_OK(RecordIndex::Open(env, index_fname, &index));
+
+  thread::ThreadPool pool(env, "sharded_read", kNumWorkers);
+  for (auto s : state) {
+    BlockingCounter counter(kNumWorkers);
+    for (int worker = 0; worker < kNumWorkers; ++worker) {
+      pool.Schedule([&, worker]() {
+        tstring record;
+        if (use_index) {
+          RecordReader reader(file.get(), RecordReaderOptions());
+          for (int i = worker; i < kNumRecords; i += kNumWorkers) {
+            uint64 offset;
+            uint64 length;
+            TF_CHECK_OK(index->Lookup(i, &offset, &length));
+            TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+          }
+        } else {
+          SequentialRecordReader reader(file.get(), RecordReaderOptions());
+          int num_skipped;
+          TF_CHECK_OK(reader.SkipRecords(worker, &num_skipped));
+          for (int i = worker; i < kNumRecords; i += kNumWorkers) {
+            TF_CHECK_OK(reader.ReadRecord(&record));
+            Status s = reader.SkipRecords(kNumWorkers - 1, &num_skipped);
+            CHECK(s.ok() || errors::IsOutOfRange(s)) << s;
+          }
+        }
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          kNumRecords * kRecordSize);
+  TF_CHECK_OK(env->DeleteFile(fname));
+  TF_CHECK_OK(env->DeleteFile(index_fname));
+}
+BENCHMARK(BM_ShardedRead)->UseRealTime()->Arg(0)->Arg(1);
+
+}  // namespace
+}  // namespace io
+}  // namespace tensorflow
@@ -23,6 +23,7 @@ limitations under the License.
 #include "tensorflow/core/lib/io/buffered_inputstream.h"
 #include "tensorflow/core/lib/io/compression.h"
 #include "tensorflow/core/lib/io/random_inputstream.h"
+#include "tensorflow/core/lib/io/read_ahead_inputstream.h"
 #include "tensorflow/core/platform/env.h"
 
 namespace tensorflow {
@@ -56,9 +57,19 @@ RecordReaderOptions RecordReaderOptions::CreateRecordReaderOptions(
 
 RecordReader::RecordReader(RandomAccessFile* file,
                            const RecordReaderOptions& options)
-    : options_(options),
-      input_stream_(new RandomAccessInputStream(file)),
-      last_read_failed_(false) {
+    : options_(options), last_read_failed_(false) {
+  if (options.read_ahead_depth > 0 &&
+      options.compression_type == RecordReaderOptions::NONE) {
+    read_ahead_stream_ = new ReadAheadInputStream(
+        file, options.read_ahead_chunk_size, options.read_ahead_depth);
+    input_stream_.reset(read_ahead_stream_);
+    return;
+  }
+  if (options.read_ahead_depth > 0) {
+    VLOG(1) << "Reading ahead is not supported for compressed input; reading "
+               "synchronously instead.";
+  }
+  input_stream_.reset(new RandomAccessInputStream(file));
   if (options.buffer_size > 0) {
     input_stream_.reset(new BufferedInputStream(input_stream_.release(),
                                                 options.buffer_size, true));
@@ -114,6 +125,32 @@ Status RecordReader::ReadChecksummed(uint64 offset, size_t n, tstring* result) {
   return Status::OK();
 }
 
+Status RecordReader::ReadChecksummedView(uint64 offset, size_t n,
+                                         StringPiece* result) {
+  if (n >= SIZE_MAX - sizeof(uint32)) {
+    return errors::DataLoss("record size too large");
+  }
+
+  const size_t expected = n + sizeof(uint32);
+  TF_RETURN_IF_ERROR(read_ahead_stream_->ReadNBytesView(
+      expected, &read_ahead_scratch_, result));
+
+  if (result->size() != expected) {
+    if (result->empty()) {
+      return errors::OutOfRange("eof");
+    } else {
+      return errors::DataLoss("truncated record at ", offset);
+    }
+  }
+
+  const uint32 masked_crc = core::DecodeFixed32(result->data() + n);
+  if (crc32c::Unmask(masked_crc) != crc32c::Value(result->data(), n)) {
+    return errors::DataLoss("corrupted record at ", offset);
+  }
+  *result = StringPiece(result->data(), n);
+  return Status::OK();
+}
+
 Status RecordReader::GetMetadata(Metadata* md) {
   if (!md) {
     return errors::InvalidArgument(
@@ -184,6 +221,9 @@ Status RecordReader::PositionInputStream(uint64 offset) {
 
 Status RecordReader::ReadRecord(uint64* offset, tstring* record) {
   TF_RETURN_IF_ERROR(PositionInputStream(*offset));
+  if (read_ahead_stream_ != nullptr) {
+    return ReadRecordFromReadAhead(offset, record);
+  }
 
   // Read header data.
   Status s = ReadChecksummed(*offset, sizeof(uint64), record);
@@ -209,6 +249,42 @@ Status RecordReader::ReadRecord(uint64* offset, tstring* record) {
   return Status::OK();
 }
 
+Status RecordReader::ReadRecordFromReadAhead(uint64* offset,
+                                             tstring* record) {
+  // Parse the header and verify the checksums in place, so that the record is
+  // copied at most once, into `record`.
+  StringPiece header;
+  Status s = ReadChecksummedView(*offset, sizeof(uint64), &header);
+  if (!s.ok()) {
+    last_read_failed_ = true;
+    return s;
+  }
+  const uint64 length = core::DecodeFixed64(header.data());
+
+  StringPiece data;
+  s = ReadChecksummedView(*offset + kHeaderSize, length, &data);
+  if (!s.ok()) {
+    last_read_failed_ = true;
+    if (errors::IsOutOfRange(s)) {
+      s = errors::DataLoss("truncated record at ", *offset, "' failed with ",
+                           s.error_message());
+    }
+    return s;
+  }
+  if (data.data() == read_ahead_scratch_.data()) {
+    // The record spans chunks, so it has already been copied to the scratch
+    // buffer.
+    read_ahead_scratch_.resize(length);
+    std::swap(*record, read_ahead_scratch_);
+  } else {
+    record->assign(data.data(), data.size());
+  }
+
+  *offset += kHeaderSize + length + kFooterSize;
+  DCHECK_EQ(*offset, input_stream_->Tell());
+  return Status::OK();
+}
+
 Status RecordReader::SkipRecords(uint64* offset, int num_to_skip,
                                  int* num_skipped) {
   TF_RETURN_IF_ERROR(PositionInputStream(*offset));
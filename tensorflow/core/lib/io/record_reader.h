@@ -19,6 +19,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/stringpiece.h"
 #include "tensorflow/core/lib/io/inputstream_interface.h"
+#include "tensorflow/core/lib/io/read_ahead_inputstream.h"
 #if !defined(IS_SLIM_BUILD)
 #include "tensorflow/core/lib/io/snappy/snappy_compression_options.h"
 #include "tensorflow/core/lib/io/snappy/snappy_inputstream.h"
@@ -47,6 +48,15 @@ struct RecordReaderOptions {
   // compressed files.) Consider using SequentialRecordReader.
   int64_t buffer_size = 0;
 
+  // If read_ahead_depth is non-zero and the input is not compressed, a
+  // background thread reads the file in chunks of read_ahead_chunk_size bytes,
+  // keeping up to read_ahead_depth chunks ahead of the reader, and records are
+  // parsed directly out of those chunks. buffer_size is then ignored.
+  // Non-sequential reads are supported but discard the chunks read ahead.
+  // Compressed input ignores these options and reads synchronously.
+  int64_t read_ahead_depth = 0;
+  int64_t read_ahead_chunk_size = 8 << 20;  // 8MB
+
   static RecordReaderOptions CreateRecordReaderOptions(
       const string& compression_type);
 
@@ -117,10 +127,18 @@ class RecordReader {
 
  private:
   Status ReadChecksummed(uint64 offset, size_t n, tstring* result);
+  // Like ReadChecksummed, but reads from `read_ahead_stream_` and sets
+  // `*result` to a view of the data, which stays valid until the next read.
+  Status ReadChecksummedView(uint64 offset, size_t n, StringPiece* result);
   Status PositionInputStream(uint64 offset);
+  Status ReadRecordFromReadAhead(uint64* offset, tstring* record);
 
   RecordReaderOptions options_;
   std::unique_ptr<InputStreamInterface> input_stream_;
+  // Set iff reading ahead; aliases `input_stream_`.
+  ReadAheadInputStream* read_ahead_stream_ = nullptr;
+  // Holds the bytes of records that span read-ahead chunks.
+  tstring read_ahead_scratch_;
   bool last_read_failed_;
 
   std::unique_ptr<Metadata> cached_metadata_;
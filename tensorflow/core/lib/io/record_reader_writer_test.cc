@@ -26,6 +26,7 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 
 namespace tensorflow {
 
@@ -328,4 +329,186 @@ TEST(RecordReaderWriterTest, TestUseAfterClose) {
   }
 }
 
+// Writes `num_records` records of increasing sizes to `fname` and returns
+// them.
+static std::vector<string> WriteRecords(const string& fname, int num_records) {
+  std::vector<string> records;
+  std::unique_ptr<WritableFile> file;
+  TF_CHECK_OK(Env::Default()->NewWritableFile(fname, &file));
+  io::RecordWriter writer(file.get());
+  for (int i = 0; i < num_records; ++i) {
+    records.push_back(string(i * 7 % 101, 'a' + i % 26));
+    TF_CHECK_OK(writer.WriteRecord(records.back()));
+  }
+  TF_CHECK_OK(writer.Close());
+  TF_CHECK_OK(file->Close());
+  return records;
+}
+
+TEST(RecordReaderWriterTest, TestReadAhead) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/record_reader_writer_read_ahead_test";
+  const std::vector<string> records = WriteRecords(fname, 200);
+  std::unique_ptr<RandomAccessFile> read_file;
+  TF_CHECK_OK(env->NewRandomAccessFile(fname, &read_file));
+
+  for (int64_t chunk_size : {1, 7, 64, 4096, 1 << 20}) {
+    for (int64_t depth : {1, 4}) {
+      io::RecordReaderOptions options;
+      options.read_ahead_depth = depth;
+      options.read_ahead_chunk_size = chunk_size;
+
+      // Sequential reads.
+      io::RecordReader reader(read_file.get(), options);
+      std::vector<uint64> offsets;
+      uint64 offset = 0;
+      tstring record;
+      for (const string& expected : records) {
+        offsets.push_back(offset);
+        TF_ASSERT_OK(reader.ReadRecord(&offset, &record));
+        EXPECT_EQ(expected, record);
+      }
+      EXPECT_TRUE(errors::IsOutOfRange(reader.ReadRecord(&offset, &record)));
+
+      // Non-sequential reads.
+      for (int i : {150, 3, 3, 199, 0, 100}) {
+        offset = offsets[i];
+        TF_ASSERT_OK(reader.ReadRecord(&offset, &record));
+        EXPECT_EQ(records[i], record);
+      }
+
+      io::RecordReader::Metadata md;
+      TF_ASSERT_OK(reader.GetMetadata(&md));
+      EXPECT_EQ(records.size(), md.stats.entries);
+
+      // Skipping.
+      io::SequentialRecordReader sequential_reader(read_file.get(), options);
+      int num_skipped;
+      TF_ASSERT_OK(sequential_reader.SkipRecords(120, &num_skipped));
+      EXPECT_EQ(120, num_skipped);
+      TF_ASSERT_OK(sequential_reader.ReadRecord(&record));
+      EXPECT_EQ(records[120], record);
+    }
+  }
+}
+
+TEST(RecordReaderWriterTest, TestReadAheadCorruption) {
+  Env* env = Env::Default();
+  string fname =
+      testing::TmpDir() + "/record_reader_writer_read_ahead_corruption_test";
+  WriteRecords(fname, 10);
+  string contents;
+  TF_ASSERT_OK(ReadFileToString(env, fname, &contents));
+  // Flip a byte of the data of the second record.
+  contents[16 + 12 + 3] ^= 1;
+  TF_ASSERT_OK(WriteStringToFile(env, fname, contents));
+
+  std::unique_ptr<RandomAccessFile> read_file;
+  TF_CHECK_OK(env->NewRandomAccessFile(fname, &read_file));
+  io::RecordReaderOptions options;
+  options.read_ahead_depth = 2;
+  options.read_ahead_chunk_size = 16;
+  io::RecordReader reader(read_file.get(), options);
+  uint64 offset = 0;
+  tstring record;
+  TF_ASSERT_OK(reader.ReadRecord(&offset, &record));
+  Status s = reader.ReadRecord(&offset, &record);
+  EXPECT_TRUE(errors::IsDataLoss(s)) << s;
+}
+
+TEST(RecordReaderWriterTest, TestReadAheadIgnoredForCompressedInput) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/record_reader_writer_read_ahead_zlib";
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_CHECK_OK(env->NewWritableFile(fname, &file));
+    io::RecordWriter writer(
+        file.get(), io::RecordWriterOptions::CreateRecordWriterOptions("ZLIB"));
+    TF_EXPECT_OK(writer.WriteRecord("abc"));
+    TF_EXPECT_OK(writer.WriteRecord("defg"));
+    TF_CHECK_OK(writer.Close());
+  }
+  std::unique_ptr<RandomAccessFile> read_file;
+  TF_CHECK_OK(env->NewRandomAccessFile(fname, &read_file));
+  io::RecordReaderOptions options =
+      io::RecordReaderOptions::CreateRecordReaderOptions("ZLIB");
+  options.read_ahead_depth = 4;
+  io::SequentialRecordReader reader(read_file.get(), options);
+  tstring record;
+  TF_ASSERT_OK(reader.ReadRecord(&record));
+  EXPECT_EQ("abc", record);
+  TF_ASSERT_OK(reader.ReadRecord(&record));
+  EXPECT_EQ("defg", record);
+  EXPECT_TRUE(errors::IsOutOfRange(reader.ReadRecord(&record)));
+}
+
+// Simulates a networked filesystem: every read pays a fixed latency,
+// regardless of its size.
+class HighLatencyRandomAccessFile : public RandomAccessFile {
+ public:
+  HighLatencyRandomAccessFile(RandomAccessFile* file, int64_t latency_micros)
+      : file_(file), latency_micros_(latency_micros) {}
+
+  Status Read(uint64 offset, size_t n, StringPiece* result,
+              char* scratch) const override {
+    Env::Default()->SleepForMicroseconds(latency_micros_);
+    return file_->Read(offset, n, result, scratch);
+  }
+
+ private:
+  RandomAccessFile* const file_;
+  const int64_t latency_micros_;
+};
+
+// Reads 16MB of 16KB records through 1MB reads that each take 2ms, either
+// buffered (read_ahead_depth == 0) or with read-ahead.
+void BM_ReadRecordsHighLatency(::testing::benchmark::State& state) {
+  const int read_ahead_depth = state.range(0);
+  constexpr int kNumRecords = 1024;
+  constexpr int kRecordSize = 16 << 10;
+  constexpr int64_t kChunkSize = 1 << 20;
+  constexpr int64_t kLatencyMicros = 2000;
+
+  Env* env = Env::Default();
+  string fname;
+  ASSERT_TRUE(env->LocalTempFilename(&fname));
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_CHECK_OK(env->NewWritableFile(fname, &file));
+    io::RecordWriter writer(file.get());
+    const string record(kRecordSize, 'x');
+    for (int i = 0; i < kNumRecords; ++i) {
+      TF_CHECK_OK(writer.WriteRecord(record));
+    }
+    TF_CHECK_OK(writer.Close());
+  }
+  std::unique_ptr<RandomAccessFile> local_file;
+  TF_CHECK_OK(env->NewRandomAccessFile(fname, &local_file));
+  HighLatencyRandomAccessFile file(local_file.get(), kLatencyMicros);
+
+  io::RecordReaderOptions options;
+  if (read_ahead_depth > 0) {
+    options.read_ahead_depth = read_ahead_depth;
+    options.read_ahead_chunk_size = kChunkSize;
+  } else {
+    options.buffer_size = kChunkSize;
+  }
+  tstring record;
+  for (auto s : state) {
+    io::SequentialRecordReader reader(&file, options);
+    for (int i = 0; i < kNumRecords; ++i) {
+      TF_CHECK_OK(reader.ReadRecord(&record));
+    }
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          kNumRecords * kRecordSize);
+  TF_CHECK_OK(env->DeleteFile(fname));
+}
+BENCHMARK(BM_ReadRecordsHighLatency)
+    ->UseRealTime()
+    ->Arg(0)
+    ->Arg(1)
+    ->Arg(4)
+    ->Arg(16);
+
 }  // namespace tensorflow
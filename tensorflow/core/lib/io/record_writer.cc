@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/core/lib/io/record_writer.h"
 
 #include "tensorflow/core/lib/core/coding.h"
+#include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/hash/crc32c.h"
 #include "tensorflow/core/lib/io/compression.h"
 #include "tensorflow/core/platform/env.h"
@@ -112,7 +113,8 @@ Status RecordWriter::WriteRecord(StringPiece data) {
   PopulateFooter(footer, data.data(), data.size());
   TF_RETURN_IF_ERROR(dest_->Append(StringPiece(header, sizeof(header))));
   TF_RETURN_IF_ERROR(dest_->Append(data));
-  return dest_->Append(StringPiece(footer, sizeof(footer)));
+  TF_RETURN_IF_ERROR(dest_->Append(StringPiece(footer, sizeof(footer))));
+  return MaybeIndexRecord(data.size());
 }
 
 #if defined(TF_CORD_SUPPORT)
@@ -132,12 +134,39 @@ Status RecordWriter::WriteRecord(const absl::Cord& data) {
   PopulateFooter(footer, data);
   TF_RETURN_IF_ERROR(dest_->Append(StringPiece(header, sizeof(header))));
   TF_RETURN_IF_ERROR(dest_->Append(data));
-  return dest_->Append(StringPiece(footer, sizeof(footer)));
+  TF_RETURN_IF_ERROR(dest_->Append(StringPiece(footer, sizeof(footer))));
+  return MaybeIndexRecord(data.size());
 }
 #endif
 
+Status RecordWriter::EnableIndex(WritableFile* index) {
+  if (options_.compression_type != RecordWriterOptions::NONE) {
+    return errors::InvalidArgument("Compressed records cannot be indexed.");
+  }
+  if (offset_ > 0 || index_builder_ != nullptr) {
+    return errors::FailedPrecondition(
+        "EnableIndex must be called once, before writing any record.");
+  }
+  index_builder_.reset(new RecordIndexBuilder(index));
+  return Status::OK();
+}
+
+Status RecordWriter::MaybeIndexRecord(size_t length) {
+  const uint64 offset = offset_;
+  offset_ += kHeaderSize + length + kFooterSize;
+  if (index_builder_ == nullptr) {
+    return Status::OK();
+  }
+  return index_builder_->Add(offset, length);
+}
+
 Status RecordWriter::Close() {
   if (dest_ == nullptr) return Status::OK();
+  if (index_builder_ != nullptr) {
+    Status s = index_builder_->Finish();
+    index_builder_.reset();
+    TF_RETURN_IF_ERROR(s);
+  }
   if (IsZlibCompressed(options_) || IsSnappyCompressed(options_)) {
     Status s = dest_->Close();
     delete dest_;
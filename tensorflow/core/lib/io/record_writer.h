@@ -16,10 +16,13 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_LIB_IO_RECORD_WRITER_H_
 #define TENSORFLOW_CORE_LIB_IO_RECORD_WRITER_H_
 
+#include <memory>
+
 #include "tensorflow/core/lib/core/coding.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/core/stringpiece.h"
 #include "tensorflow/core/lib/hash/crc32c.h"
+#include "tensorflow/core/lib/io/record_index.h"
 #if !defined(IS_SLIM_BUILD)
 #include "tensorflow/core/lib/io/snappy/snappy_compression_options.h"
 #include "tensorflow/core/lib/io/snappy/snappy_outputbuffer.h"
@@ -94,6 +97,15 @@ class RecordWriter {
   // are invalid.
   Status Close();
 
+  // Writes the record index (see record_index.h) of the records to "*index",
+  // which must be initially empty and remain live while this Writer is in
+  // use. The index is completed by Close(), which does *not* close "*index"
+  // either.
+  //
+  // Must be called before any record is written. Compressed files cannot be
+  // indexed.
+  Status EnableIndex(WritableFile* index);
+
   // Utility method to populate TFRecord headers.  Populates record-header in
   // "header[0,kHeaderSize-1]".  The record-header is based on data[0, n-1].
   inline static void PopulateHeader(char* header, const char* data, size_t n);
@@ -113,6 +125,13 @@ class RecordWriter {
  private:
   WritableFile* dest_;
   RecordWriterOptions options_;
+  // Offset of the next record, when indexing.
+  uint64 offset_ = 0;
+  std::unique_ptr<RecordIndexBuilder> index_builder_;
+
+  // Advances the offset past a record of `length` bytes of data, and adds the
+  // record to the index if there is one.
+  Status MaybeIndexRecord(size_t length);
 
   inline static uint32 MaskedCrc(const char* data, size_t n) {
     return crc32c::Mask(crc32c::Value(data, n));
@@ -410,6 +410,16 @@ REGISTER_OP("AnonymousMutableHashTable")
     .SetIsStateful()
     .SetShapeFn(MutableHashTableShapeFn);
 
+REGISTER_OP("ConcurrentMutableHashTable")
+    .Output("table_handle: resource")
+    .Attr("container: string = ''")
+    .Attr("shared_name: string = ''")
+    .Attr("use_node_name_sharing: bool = false")
+    .Attr("key_dtype: type")
+    .Attr("value_dtype: type")
+    .SetIsStateful()
+    .SetShapeFn(MutableHashTableShapeFn);
+
 REGISTER_OP("MutableHashTableOfTensors")
     .Output("table_handle: Ref(string)")
     .Attr("container: string = ''")
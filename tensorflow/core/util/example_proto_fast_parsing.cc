@@ -166,6 +166,75 @@ class Feature {
     return true;
   }
 
+  // Returns the number of elements ParseFloatList would produce, without
+  // decoding them. Both encodings store a fixed number of bytes per value, so
+  // this only inspects the list header.
+  bool GetNumElementsInFloatList(int* num_elements) {
+    protobuf::io::CodedInputStream stream(
+        reinterpret_cast<const uint8*>(serialized_.data()), serialized_.size());
+    EnableAliasing(&stream);
+    uint32 length = 0;
+    if (!stream.ReadVarint32(&length)) return false;
+    auto limit = stream.PushLimit(length);
+    *num_elements = 0;
+    if (!stream.ExpectAtEnd()) {
+      constexpr int32_t kNumFloatBytes = 4;
+      uint8 peek_tag = PeekTag(&stream);
+      if (peek_tag == kDelimitedTag(1)) {  // packed
+        if (!stream.ExpectTag(kDelimitedTag(1))) return false;
+        uint32 packed_length;
+        if (!stream.ReadVarint32(&packed_length)) return false;
+        *num_elements = packed_length / kNumFloatBytes;
+      } else if (peek_tag == kFixed32Tag(1)) {  // non-packed
+        *num_elements = stream.BytesUntilLimit() / (1 + kNumFloatBytes);
+      } else {
+        return false;
+      }
+    }
+    stream.PopLimit(limit);
+    return true;
+  }
+
+  // Returns the number of elements ParseInt64List would produce. Packed
+  // varints are counted by their terminating bytes instead of being decoded.
+  bool GetNumElementsInInt64List(int* num_elements) {
+    protobuf::io::CodedInputStream stream(
+        reinterpret_cast<const uint8*>(serialized_.data()), serialized_.size());
+    EnableAliasing(&stream);
+    uint32 length = 0;
+    if (!stream.ReadVarint32(&length)) return false;
+    auto limit = stream.PushLimit(length);
+    *num_elements = 0;
+    if (!stream.ExpectAtEnd()) {
+      uint8 peek_tag = PeekTag(&stream);
+      if (peek_tag == kDelimitedTag(1)) {  // packed
+        if (!stream.ExpectTag(kDelimitedTag(1))) return false;
+        uint32 packed_length;
+        if (!stream.ReadVarint32(&packed_length)) return false;
+        if (packed_length > static_cast<uint32>(stream.BytesUntilLimit())) {
+          return false;
+        }
+        const uint8* packed = reinterpret_cast<const uint8*>(
+                                  serialized_.data()) +
+                              stream.CurrentPosition();
+        for (uint32 i = 0; i < packed_length; ++i) {
+          if (packed[i] < 0x80) ++*num_elements;
+        }
+      } else if (peek_tag == kVarintTag(1)) {  // non-packed
+        while (!stream.ExpectAtEnd()) {
+          if (!stream.ExpectTag(kVarintTag(1))) return false;
+          protobuf_uint64 n;
+          if (!stream.ReadVarint64(&n)) return false;
+          ++*num_elements;
+        }
+      } else {
+        return false;
+      }
+    }
+    stream.PopLimit(limit);
+    return true;
+  }
+
   // Helper methods
   tstring* construct_at_end(LimitedArraySlice<tstring>* bytes_list) {
     if (bytes_list->EndDistance() <= 0) {
@@ -568,6 +637,100 @@ void LogSparseFeatureDataLoss(StringPiece feature_name) {
   duplicated_sparse_feature->GetCell()->IncrementBy(1);
 }
 
+// Parses a fixed-length dense `feature` of example `example_index` directly
+// into its slot of the batched `out` tensor.
+template <typename ExampleErrorFn>
+Status ParseFixedLenDenseFeature(const Config::Dense& dense,
+                                 const size_t example_index,
+                                 const ExampleErrorFn& example_error,
+                                 parsed::Feature* feature, Tensor* out) {
+  const std::size_t num_elements = dense.elements_per_stride;
+  const std::size_t offset = example_index * num_elements;
+
+  auto parse_error = [&] {
+    return example_error("Can't parse serialized Example.");
+  };
+
+  auto shape_error = [&](size_t size, StringPiece type_str) {
+    return example_error(strings::StrCat(
+        "Number of ", type_str,
+        " values != expected.  "
+        "Values size: ",
+        size, " but output shape: ", dense.shape.DebugString()));
+  };
+
+  switch (dense.dtype) {
+    case DT_INT64: {
+      auto out_p = out->flat<int64_t>().data() + offset;
+      LimitedArraySlice<int64_t> slice(out_p, num_elements);
+      if (!feature->ParseInt64List(&slice)) return parse_error();
+      if (slice.EndDistance() != 0) {
+        return shape_error(num_elements - slice.EndDistance(), "int64");
+      }
+      break;
+    }
+    case DT_FLOAT: {
+      auto out_p = out->flat<float>().data() + offset;
+      LimitedArraySlice<float> slice(out_p, num_elements);
+      if (!feature->ParseFloatList(&slice)) return parse_error();
+      if (slice.EndDistance() != 0) {
+        return shape_error(num_elements - slice.EndDistance(), "float");
+      }
+      break;
+    }
+    case DT_STRING: {
+      auto out_p = out->flat<tstring>().data() + offset;
+      LimitedArraySlice<tstring> slice(out_p, num_elements);
+      if (!feature->ParseBytesList(&slice)) return parse_error();
+      if (slice.EndDistance() != 0) {
+        return shape_error(num_elements - slice.EndDistance(), "bytes");
+      }
+      break;
+    }
+    default:
+      LOG(FATAL) << "Should not happen.";
+  }
+  return Status::OK();
+}
+
+// Copies the default value of a fixed-length dense feature that is missing
+// from example `example_index` into its slot of the batched `out` tensor.
+Status FillMissingFixedLenDenseFeature(const Config::Dense& dense,
+                                       StringPiece example_name,
+                                       const size_t example_index,
+                                       Tensor* out) {
+  if (dense.default_value.NumElements() == 0) {
+    return errors::InvalidArgument(
+        "Name: ", example_name, ", Feature: ", dense.feature_name,
+        " (data type: ", DataTypeString(dense.dtype), ")",
+        " is required but could not be found.");
+  }
+  const Tensor& in = dense.default_value;
+  const std::size_t num_elements = in.shape().num_elements();
+  const std::size_t offset = example_index * num_elements;
+
+  switch (dense.dtype) {
+    case DT_INT64: {
+      std::copy_n(in.flat<int64_t>().data(), num_elements,
+                  out->flat<int64_t>().data() + offset);
+      break;
+    }
+    case DT_FLOAT: {
+      std::copy_n(in.flat<float>().data(), num_elements,
+                  out->flat<float>().data() + offset);
+      break;
+    }
+    case DT_STRING: {
+      std::copy_n(in.flat<tstring>().data(), num_elements,
+                  out->flat<tstring>().data() + offset);
+      break;
+    }
+    default:
+      LOG(FATAL) << "Should not happen.";
+  }
+  return Status::OK();
+}
+
 Status FastParseSerializedExample(
     const tstring& serialized_example, const tstring& example_name,
     const size_t example_index, const Config& config,
@@ -657,8 +820,6 @@ Status FastParseSerializedExample(
             " but expected type: ", DataTypeString(config.dense[d].dtype)));
       }
       if (!config.dense[d].variable_length) {
-        Tensor& out = (*output_dense)[d];
-
         const std::size_t num_elements = config.dense[d].elements_per_stride;
         if (output_stats) {
           // TODO(b/111553342): If desirable, we could add support for counting
@@ -666,49 +827,9 @@ Status FastParseSerializedExample(
           // considerable runtime cost.
           output_stats->feature_values_count += num_elements;
         }
-
-        const std::size_t offset = example_index * num_elements;
-
-        auto shape_error = [&](size_t size, StringPiece type_str) {
-          return example_error(strings::StrCat(
-              "Number of ", type_str,
-              " values != expected.  "
-              "Values size: ",
-              size,
-              " but output shape: ", config.dense[d].shape.DebugString()));
-        };
-
-        switch (config.dense[d].dtype) {
-          case DT_INT64: {
-            auto out_p = out.flat<int64_t>().data() + offset;
-            LimitedArraySlice<int64_t> slice(out_p, num_elements);
-            if (!feature.ParseInt64List(&slice)) return parse_error();
-            if (slice.EndDistance() != 0) {
-              return shape_error(num_elements - slice.EndDistance(), "int64");
-            }
-            break;
-          }
-          case DT_FLOAT: {
-            auto out_p = out.flat<float>().data() + offset;
-            LimitedArraySlice<float> slice(out_p, num_elements);
-            if (!feature.ParseFloatList(&slice)) return parse_error();
-            if (slice.EndDistance() != 0) {
-              return shape_error(num_elements - slice.EndDistance(), "float");
-            }
-            break;
-          }
-          case DT_STRING: {
-            auto out_p = out.flat<tstring>().data() + offset;
-            LimitedArraySlice<tstring> slice(out_p, num_elements);
-            if (!feature.ParseBytesList(&slice)) return parse_error();
-            if (slice.EndDistance() != 0) {
-              return shape_error(num_elements - slice.EndDistance(), "bytes");
-            }
-            break;
-          }
-          default:
-            LOG(FATAL) << "Should not happen.";
-        }
+        TF_RETURN_IF_ERROR(ParseFixedLenDenseFeature(
+            config.dense[d], example_index, example_error, &feature,
+            &(*output_dense)[d]));
       } else {  // if variable length
         SparseBuffer& out = (*output_varlen_dense)[d];
 
@@ -866,36 +987,8 @@ Status FastParseSerializedExample(
   for (size_t d = 0; d < config.dense.size(); ++d) {
     if (config.dense[d].variable_length) continue;
     if (dense_feature_last_example[d] == example_index) continue;
-    if (config.dense[d].default_value.NumElements() == 0) {
-      return errors::InvalidArgument(
-          "Name: ", example_name, ", Feature: ", config.dense[d].feature_name,
-          " (data type: ", DataTypeString(config.dense[d].dtype), ")",
-          " is required but could not be found.");
-    }
-    const Tensor& in = config.dense[d].default_value;
-    Tensor& out = (*output_dense)[d];
-    const std::size_t num_elements = in.shape().num_elements();
-    const std::size_t offset = example_index * num_elements;
-
-    switch (config.dense[d].dtype) {
-      case DT_INT64: {
-        std::copy_n(in.flat<int64_t>().data(), num_elements,
-                    out.flat<int64_t>().data() + offset);
-        break;
-      }
-      case DT_FLOAT: {
-        std::copy_n(in.flat<float>().data(), num_elements,
-                    out.flat<float>().data() + offset);
-        break;
-      }
-      case DT_STRING: {
-        std::copy_n(in.flat<tstring>().data(), num_elements,
-                    out.flat<tstring>().data() + offset);
-        break;
-      }
-      default:
-        LOG(FATAL) << "Should not happen.";
-    }
+    TF_RETURN_IF_ERROR(FillMissingFixedLenDenseFeature(
+        config.dense[d], example_name, example_index, &(*output_dense)[d]));
   }
 
   // Handle missing varlen dense features.
@@ -1110,6 +1203,474 @@ void CopySparseBufferToTensor(DataType dtype, size_t offset, SparseBuffer* src,
   }
 }
 
+// Calculates the number of minibatches a batch of examples is split into for
+// parallel parsing.
+size_t NumMiniBatches(gtl::ArraySlice<tstring> serialized) {
+  // This parameter affects performance in a big and data-dependent way.
+  const size_t kMiniBatchSizeBytes = 50000;
+
+  // In main regime make each minibatch around kMiniBatchSizeBytes bytes.
+  // Apply 'special logic' below for small and big regimes.
+  size_t result = 0;
+  size_t minibatch_bytes = 0;
+  for (size_t i = 0; i < serialized.size(); i++) {
+    if (minibatch_bytes == 0) {  // start minibatch
+      result++;
+    }
+    minibatch_bytes += serialized[i].size() + 1;
+    if (minibatch_bytes > kMiniBatchSizeBytes) {
+      minibatch_bytes = 0;
+    }
+  }
+  // 'special logic'
+  const size_t min_minibatches = std::min<size_t>(8, serialized.size());
+  const size_t max_minibatches = 64;
+  return std::max<size_t>(min_minibatches,
+                          std::min<size_t>(max_minibatches, result));
+}
+
+// Location and value count of a variable-length dense, sparse or ragged
+// feature in every example of a batch, gathered by the first pass of columnar
+// parsing.
+struct ColumnarFeature {
+  explicit ColumnarFeature(size_t batch_size = 0)
+      : features(batch_size), num_values(batch_size, 0) {}
+
+  // Still-encoded value list of each example. Empty if the example does not
+  // contain the feature.
+  std::vector<parsed::Feature> features;
+  std::vector<size_t> num_values;
+
+  // Exclusive prefix sum of `num_values`, i.e. the offset of the first value
+  // of each example in a values tensor holding the whole batch.
+  std::vector<size_t> value_offsets;
+  size_t total_num_values = 0;
+  size_t max_num_values = 0;
+
+  void ComputeOffsets() {
+    value_offsets.resize(num_values.size());
+    total_num_values = 0;
+    max_num_values = 0;
+    for (size_t e = 0; e < num_values.size(); ++e) {
+      value_offsets[e] = total_num_values;
+      total_num_values += num_values[e];
+      max_num_values = std::max(max_num_values, num_values[e]);
+    }
+  }
+};
+
+// Counts the values of an encoded feature list without decoding them.
+bool CountFeatureValues(DataType dtype, parsed::Feature* feature,
+                        int* num_values) {
+  switch (dtype) {
+    case DT_INT64:
+      return feature->GetNumElementsInInt64List(num_values);
+    case DT_FLOAT:
+      return feature->GetNumElementsInFloatList(num_values);
+    case DT_STRING:
+      return feature->GetNumElementsInBytesList(num_values);
+    default:
+      ReportUnexpectedDataType(dtype);
+      return false;
+  }
+}
+
+// Decodes exactly `num_values` values of an encoded feature list into the
+// flat `out` tensor, starting at `offset`.
+bool DecodeFeatureValues(DataType dtype, parsed::Feature feature,
+                         size_t offset, size_t num_values, Tensor* out) {
+  switch (dtype) {
+    case DT_INT64: {
+      LimitedArraySlice<int64_t> slice(out->flat<int64_t>().data() + offset,
+                                       num_values);
+      return feature.ParseInt64List(&slice) && slice.EndDistance() == 0;
+    }
+    case DT_FLOAT: {
+      LimitedArraySlice<float> slice(out->flat<float>().data() + offset,
+                                     num_values);
+      return feature.ParseFloatList(&slice) && slice.EndDistance() == 0;
+    }
+    case DT_STRING: {
+      LimitedArraySlice<tstring> slice(out->flat<tstring>().data() + offset,
+                                       num_values);
+      return feature.ParseBytesList(&slice) && slice.EndDistance() == 0;
+    }
+    default:
+      ReportUnexpectedDataType(dtype);
+      return false;
+  }
+}
+
+// Fills the flat range [begin, end) of `out` with the padding value of a
+// variable-length dense feature.
+void PadVarLenDenseFeature(const Config::Dense& dense, size_t begin,
+                           size_t end, Tensor* out) {
+  if (begin == end) return;
+  switch (dense.dtype) {
+    case DT_INT64: {
+      auto data = out->flat<int64_t>().data();
+      std::fill(data + begin, data + end,
+                dense.default_value.flat<int64_t>()(0));
+      break;
+    }
+    case DT_FLOAT: {
+      auto data = out->flat<float>().data();
+      std::fill(data + begin, data + end, dense.default_value.flat<float>()(0));
+      break;
+    }
+    case DT_STRING: {
+      auto data = out->flat<tstring>().data();
+      std::fill(data + begin, data + end,
+                dense.default_value.flat<tstring>()(0));
+      break;
+    }
+    default:
+      ReportUnexpectedDataType(dense.dtype);
+  }
+}
+
+// First pass of columnar parsing for a single example. Fixed-length dense
+// features are parsed directly into `output_dense`; all other requested
+// features are only located and their values counted.
+Status LocateSerializedExampleFeatures(
+    const tstring& serialized_example, const tstring& example_name,
+    const size_t example_index, const Config& config,
+    const PresizedCuckooMap<std::pair<size_t, Type>>& config_index,
+    SeededHasher hasher, std::vector<Tensor>* output_dense,
+    std::vector<ColumnarFeature>* varlen_dense_columns,
+    std::vector<ColumnarFeature>* sparse_columns,
+    std::vector<ColumnarFeature>* ragged_columns,
+    PerExampleFeatureStats* output_stats) {
+  parsed::Example parsed_example;
+  if (!ParseExample(serialized_example, &parsed_example)) {
+    return errors::InvalidArgument("Could not parse example input, value: '",
+                                   serialized_example, "'");
+  }
+  std::vector<int64_t> sparse_feature_last_example(config.sparse.size(), -1);
+  std::vector<int64_t> dense_feature_last_example(config.dense.size(), -1);
+  std::vector<int64_t> ragged_feature_last_example(config.ragged.size(), -1);
+
+  const size_t parsed_example_size = parsed_example.size();
+  if (output_stats) {
+    output_stats->features_count = parsed_example_size;
+  }
+
+  for (size_t i = 0; i < parsed_example_size; ++i) {
+    // Last entry in the map overwrites all the previous ones, see
+    // FastParseSerializedExample().
+    parsed::FeatureMapEntry& name_and_feature =
+        parsed_example[parsed_example_size - i - 1];
+
+    const StringPiece feature_name = name_and_feature.first;
+    parsed::Feature& feature = name_and_feature.second;
+
+    std::pair<size_t, Type> d_and_type;
+    uint64 h = hasher(feature_name);
+    if (!config_index.Find(h, &d_and_type)) continue;
+
+    size_t d = d_and_type.first;
+    bool is_dense = d_and_type.second == Type::Dense;
+    bool is_ragged = d_and_type.second == Type::Ragged;
+
+    {
+      // Testing for PresizedCuckooMap collision.
+      const tstring& config_feature_name =
+          is_dense ? config.dense[d].feature_name
+                   : (is_ragged ? config.ragged[d].feature_name
+                                : config.sparse[d].feature_name);
+      if (feature_name != config_feature_name) continue;
+    }
+
+    auto example_error = [&](StringPiece suffix) {
+      return errors::InvalidArgument("Name: ", example_name,
+                                     ", Key: ", feature_name,
+                                     ", Index: ", example_index, ".  ", suffix);
+    };
+
+    DataType example_dtype;
+    TF_RETURN_IF_ERROR(feature.ParseDataType(&example_dtype));
+
+    ColumnarFeature* column = nullptr;
+    DataType feature_dtype = DT_INVALID;
+    size_t stride = 1;
+    if (is_dense) {
+      if (example_dtype == DT_INVALID) continue;
+
+      if (dense_feature_last_example[d] == example_index) {
+        LogDenseFeatureDataLoss(feature_name);
+        continue;
+      }
+      dense_feature_last_example[d] = example_index;
+
+      if (example_dtype != config.dense[d].dtype) {
+        return example_error(strings::StrCat(
+            "Data types don't match. Data type: ",
+            DataTypeString(example_dtype),
+            " but expected type: ", DataTypeString(config.dense[d].dtype)));
+      }
+      if (!config.dense[d].variable_length) {
+        if (output_stats) {
+          output_stats->feature_values_count +=
+              config.dense[d].elements_per_stride;
+        }
+        TF_RETURN_IF_ERROR(ParseFixedLenDenseFeature(
+            config.dense[d], example_index, example_error, &feature,
+            &(*output_dense)[d]));
+        continue;
+      }
+      column = &(*varlen_dense_columns)[d];
+      feature_dtype = config.dense[d].dtype;
+      stride = config.dense[d].elements_per_stride;
+    } else {
+      auto& last_example =
+          is_ragged ? ragged_feature_last_example : sparse_feature_last_example;
+      if (last_example[d] == example_index) {
+        LogSparseFeatureDataLoss(feature_name);
+        continue;
+      }
+      last_example[d] = example_index;
+
+      feature_dtype =
+          is_ragged ? config.ragged[d].dtype : config.sparse[d].dtype;
+      if (example_dtype != DT_INVALID && example_dtype != feature_dtype) {
+        return example_error(
+            strings::StrCat("Data types don't match. ",
+                            "Expected type: ", DataTypeString(feature_dtype),
+                            ", Actual type: ", DataTypeString(example_dtype)));
+      }
+      // An empty feature contributes no values.
+      if (example_dtype == DT_INVALID) continue;
+      column = is_ragged ? &(*ragged_columns)[d] : &(*sparse_columns)[d];
+    }
+
+    int num_values = 0;
+    if (!CountFeatureValues(feature_dtype, &feature, &num_values)) {
+      return example_error("Can't parse serialized Example.");
+    }
+    if (num_values % stride != 0) {
+      const char* type_str = feature_dtype == DT_INT64
+                                 ? "int64"
+                                 : (feature_dtype == DT_FLOAT ? "float"
+                                                              : "bytes");
+      return example_error(strings::StrCat(
+          "Number of ", type_str,
+          " values is not a multiple of stride length. Saw ", num_values,
+          " values but output shape is: ",
+          config.dense[d].shape.DebugString()));
+    }
+    column->features[example_index] = feature;
+    column->num_values[example_index] = num_values;
+    if (output_stats) {
+      output_stats->feature_values_count += num_values;
+    }
+  }
+
+  // Handle missing dense features for fixed strides. Missing features of the
+  // other kinds have no values, which is how their columns start out.
+  for (size_t d = 0; d < config.dense.size(); ++d) {
+    if (config.dense[d].variable_length) continue;
+    if (dense_feature_last_example[d] == example_index) continue;
+    TF_RETURN_IF_ERROR(FillMissingFixedLenDenseFeature(
+        config.dense[d], example_name, example_index, &(*output_dense)[d]));
+  }
+
+  return Status::OK();
+}
+
+// Columnar variant of FastParseExample(), used if `config.columnar` is set.
+//
+// The first pass parses every example once, writing fixed-length dense
+// features in place and recording where the other requested features are
+// and how many values they hold. All outputs are then allocated at their
+// final size, and the second pass decodes every recorded feature straight
+// into them. Unlike the row-oriented path, no values are buffered per
+// minibatch and nothing is copied when the minibatches are merged.
+Status FastParseExampleColumnar(
+    const Config& config, gtl::ArraySlice<tstring> serialized,
+    gtl::ArraySlice<tstring> example_names, thread::ThreadPool* thread_pool,
+    const PresizedCuckooMap<std::pair<size_t, Type>>& config_index,
+    SeededHasher hasher, std::vector<Tensor> fixed_dense_values,
+    Result* result) {
+  const size_t batch_size = serialized.size();
+
+  std::vector<ColumnarFeature> varlen_dense_columns(config.dense.size());
+  for (size_t d = 0; d < config.dense.size(); ++d) {
+    if (config.dense[d].variable_length) {
+      varlen_dense_columns[d] = ColumnarFeature(batch_size);
+    }
+  }
+  std::vector<ColumnarFeature> sparse_columns(config.sparse.size(),
+                                              ColumnarFeature(batch_size));
+  std::vector<ColumnarFeature> ragged_columns(config.ragged.size(),
+                                              ColumnarFeature(batch_size));
+
+  const size_t num_minibatches = NumMiniBatches(serialized);
+  auto first_example_of_minibatch = [&](size_t minibatch) -> size_t {
+    return (batch_size * minibatch) / num_minibatches;
+  };
+
+  // Pass 1: locate features and count values.
+  std::vector<Status> status_of_minibatch(num_minibatches);
+  auto LocateMiniBatch = [&](size_t minibatch) {
+    size_t start = first_example_of_minibatch(minibatch);
+    size_t end = first_example_of_minibatch(minibatch + 1);
+    for (size_t e = start; e < end; ++e) {
+      PerExampleFeatureStats* stats = nullptr;
+      if (config.collect_feature_stats) {
+        stats = &result->feature_stats[e];
+      }
+      status_of_minibatch[minibatch] = LocateSerializedExampleFeatures(
+          serialized[e],
+          (!example_names.empty() ? example_names[e] : "<unknown>"), e, config,
+          config_index, hasher, &fixed_dense_values, &varlen_dense_columns,
+          &sparse_columns, &ragged_columns, stats);
+      if (!status_of_minibatch[minibatch].ok()) break;
+    }
+  };
+  ParallelFor(LocateMiniBatch, num_minibatches, thread_pool);
+  for (Status& status : status_of_minibatch) {
+    TF_RETURN_IF_ERROR(status);
+  }
+
+  // Allocate all outputs at their final size.
+  result->dense_values = std::move(fixed_dense_values);
+  for (size_t d = 0; d < config.dense.size(); ++d) {
+    if (!config.dense[d].variable_length) continue;
+    ColumnarFeature& column = varlen_dense_columns[d];
+    column.ComputeOffsets();
+    TensorShape values_shape;
+    values_shape.AddDim(batch_size);
+    values_shape.AddDim(column.max_num_values /
+                        config.dense[d].elements_per_stride);
+    for (int i = 1; i < config.dense[d].shape.dims(); ++i) {
+      values_shape.AddDim(config.dense[d].shape.dim_size(i));
+    }
+    result->dense_values[d] = Tensor(config.dense[d].dtype, values_shape);
+  }
+
+  result->sparse_indices.reserve(config.sparse.size());
+  result->sparse_values.reserve(config.sparse.size());
+  result->sparse_shapes.reserve(config.sparse.size());
+  for (size_t d = 0; d < config.sparse.size(); ++d) {
+    ColumnarFeature& column = sparse_columns[d];
+    column.ComputeOffsets();
+    result->sparse_indices.emplace_back(
+        DT_INT64, TensorShape({static_cast<int64_t>(column.total_num_values),
+                               2}));
+    result->sparse_values.emplace_back(
+        config.sparse[d].dtype,
+        TensorShape({static_cast<int64_t>(column.total_num_values)}));
+    result->sparse_shapes.emplace_back(DT_INT64, TensorShape({2}));
+    auto shapes_shape_t = result->sparse_shapes.back().vec<int64_t>();
+    shapes_shape_t(0) = batch_size;
+    shapes_shape_t(1) = column.max_num_values;
+  }
+
+  result->ragged_values.reserve(config.ragged.size());
+  result->ragged_splits.reserve(config.ragged.size());
+  for (size_t d = 0; d < config.ragged.size(); ++d) {
+    ColumnarFeature& column = ragged_columns[d];
+    column.ComputeOffsets();
+    result->ragged_values.emplace_back(
+        config.ragged[d].dtype,
+        TensorShape({static_cast<int64_t>(column.total_num_values)}));
+    result->ragged_splits.emplace_back(
+        config.ragged[d].splits_dtype,
+        TensorShape({static_cast<int64_t>(batch_size + 1)}));
+    Tensor& row_splits = result->ragged_splits.back();
+    if (config.ragged[d].splits_dtype == DT_INT64) {
+      auto row_splits_t = row_splits.flat<int64_t>();
+      for (size_t e = 0; e < batch_size; ++e) {
+        row_splits_t(e) = column.value_offsets[e];
+      }
+      row_splits_t(batch_size) = column.total_num_values;
+    } else {
+      auto row_splits_t = row_splits.flat<int32>();
+      for (size_t e = 0; e < batch_size; ++e) {
+        row_splits_t(e) = column.value_offsets[e];
+      }
+      row_splits_t(batch_size) = column.total_num_values;
+    }
+  }
+
+  // Pass 2: decode values directly into the outputs, one feature at a time
+  // within each minibatch.
+  auto decode_error = [&](size_t e, StringPiece feature_name) {
+    return errors::InvalidArgument(
+        "Name: ", (!example_names.empty() ? example_names[e] : "<unknown>"),
+        ", Key: ", feature_name, ", Index: ", e,
+        ".  Can't parse serialized Example.");
+  };
+  auto DecodeMiniBatch = [&](size_t minibatch) {
+    size_t start = first_example_of_minibatch(minibatch);
+    size_t end = first_example_of_minibatch(minibatch + 1);
+    Status& status = status_of_minibatch[minibatch];
+
+    for (size_t d = 0; d < config.dense.size(); ++d) {
+      if (!config.dense[d].variable_length) continue;
+      const ColumnarFeature& column = varlen_dense_columns[d];
+      Tensor* values = &result->dense_values[d];
+      // Each example occupies `max_num_values` values of the padded output.
+      const size_t values_per_example = column.max_num_values;
+      for (size_t e = start; e < end; ++e) {
+        const size_t offset = e * values_per_example;
+        const size_t num_values = column.num_values[e];
+        if (num_values > 0 &&
+            !DecodeFeatureValues(config.dense[d].dtype, column.features[e],
+                                 offset, num_values, values)) {
+          status = decode_error(e, config.dense[d].feature_name);
+          return;
+        }
+        PadVarLenDenseFeature(config.dense[d], offset + num_values,
+                              offset + values_per_example, values);
+      }
+    }
+
+    for (size_t d = 0; d < config.sparse.size(); ++d) {
+      const ColumnarFeature& column = sparse_columns[d];
+      Tensor* values = &result->sparse_values[d];
+      int64* indices = result->sparse_indices[d].flat<int64_t>().data();
+      for (size_t e = start; e < end; ++e) {
+        const size_t offset = column.value_offsets[e];
+        const size_t num_values = column.num_values[e];
+        if (num_values == 0) continue;
+        if (!DecodeFeatureValues(config.sparse[d].dtype, column.features[e],
+                                 offset, num_values, values)) {
+          status = decode_error(e, config.sparse[d].feature_name);
+          return;
+        }
+        int64* ix_p = indices + 2 * offset;
+        for (size_t i = 0; i < num_values; ++i) {
+          // Column 0: example index; column 1: index within the example.
+          *ix_p++ = e;
+          *ix_p++ = i;
+        }
+      }
+    }
+
+    for (size_t d = 0; d < config.ragged.size(); ++d) {
+      const ColumnarFeature& column = ragged_columns[d];
+      Tensor* values = &result->ragged_values[d];
+      for (size_t e = start; e < end; ++e) {
+        const size_t num_values = column.num_values[e];
+        if (num_values == 0) continue;
+        if (!DecodeFeatureValues(config.ragged[d].dtype, column.features[e],
+                                 column.value_offsets[e], num_values,
+                                 values)) {
+          status = decode_error(e, config.ragged[d].feature_name);
+          return;
+        }
+      }
+    }
+  };
+  ParallelFor(DecodeMiniBatch, num_minibatches, thread_pool);
+  for (Status& status : status_of_minibatch) {
+    TF_RETURN_IF_ERROR(status);
+  }
+
+  return Status::OK();
+}
+
 }  // namespace
 
 Status FastParseExample(const Config& config,
@@ -1168,30 +1729,13 @@ Status FastParseExample(const Config& config,
     fixed_dense_values[d] = Tensor(config.dense[d].dtype, out_shape);
   }
 
-  // This parameter affects performance in a big and data-dependent way.
-  const size_t kMiniBatchSizeBytes = 50000;
+  if (config.columnar) {
+    return FastParseExampleColumnar(config, serialized, example_names,
+                                    thread_pool, config_index, hasher,
+                                    std::move(fixed_dense_values), result);
+  }
 
-  // Calculate number of minibatches.
-  // In main regime make each minibatch around kMiniBatchSizeBytes bytes.
-  // Apply 'special logic' below for small and big regimes.
-  const size_t num_minibatches = [&] {
-    size_t result = 0;
-    size_t minibatch_bytes = 0;
-    for (size_t i = 0; i < serialized.size(); i++) {
-      if (minibatch_bytes == 0) {  // start minibatch
-        result++;
-      }
-      minibatch_bytes += serialized[i].size() + 1;
-      if (minibatch_bytes > kMiniBatchSizeBytes) {
-        minibatch_bytes = 0;
-      }
-    }
-    // 'special logic'
-    const size_t min_minibatches = std::min<size_t>(8, serialized.size());
-    const size_t max_minibatches = 64;
-    return std::max<size_t>(min_minibatches,
-                            std::min<size_t>(max_minibatches, result));
-  }();
+  const size_t num_minibatches = NumMiniBatches(serialized);
 
   auto first_example_of_minibatch = [&](size_t minibatch) -> size_t {
     return (serialized.size() * minibatch) / num_minibatches;
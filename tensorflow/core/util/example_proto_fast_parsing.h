@@ -95,6 +95,14 @@ struct FastParseExampleConfig {
   // If `true`, `Result::feature_stats` will contain one
   // `PerExampleFeatureStats` for each serialized example in the input.
   bool collect_feature_stats = false;
+
+  // If `true`, `FastParseExample()` parses the batch column by column: a first
+  // pass counts the values of every variable-length dense, sparse and ragged
+  // feature, after which the outputs are allocated at their final size and a
+  // second pass decodes the values directly into them. This avoids buffering
+  // values per minibatch and merging the buffers afterwards, which pays off
+  // for large batches of such features.
+  bool columnar = false;
 };
 
 // Statistics about the features in each example passed to
@@ -19,6 +19,9 @@ limitations under the License.
 
 #include "tensorflow/core/example/example.pb.h"
 #include "tensorflow/core/example/feature.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/random/philox_random.h"
 #include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/platform/protobuf.h"
@@ -413,6 +416,171 @@ TEST(FastParse, FuzzTest) {
   }
 }
 
+// Returns a batch of examples whose features have random lengths, and are
+// sometimes missing, empty or duplicated by concatenation.
+std::vector<tstring> ExamplesForColumnarParsing(random::SimplePhilox* rng,
+                                                int num_examples) {
+  std::vector<tstring> serialized;
+  for (int i = 0; i < num_examples; ++i) {
+    string serialized_example;
+    const int num_concats = 1 + rng->Uniform(2);
+    for (int c = 0; c < num_concats; ++c) {
+      Example example;
+      auto& features = *example.mutable_features()->mutable_feature();
+      FloatList* fixed_float = features["fixed_float"].mutable_float_list();
+      for (int j = 0; j < 3; ++j) fixed_float->add_value(rng->RandFloat());
+      if (!rng->OneIn(4)) {
+        Int64List* varlen = features["varlen_int64"].mutable_int64_list();
+        for (int j = 2 * rng->Uniform(4); j > 0; --j) {
+          varlen->add_value(rng->Rand64());
+        }
+      }
+      if (!rng->OneIn(4)) {
+        BytesList* varlen = features["varlen_string"].mutable_bytes_list();
+        for (int j = rng->Uniform(4); j > 0; --j) {
+          varlen->add_value(RandStr(rng));
+        }
+      }
+      if (rng->OneIn(8)) {
+        // Feature without a value list.
+        features["sparse_float"];
+      } else if (!rng->OneIn(4)) {
+        FloatList* sparse = features["sparse_float"].mutable_float_list();
+        for (int j = rng->Uniform(5); j > 0; --j) {
+          sparse->add_value(rng->RandFloat());
+        }
+      }
+      if (!rng->OneIn(4)) {
+        BytesList* sparse = features["sparse_string"].mutable_bytes_list();
+        for (int j = rng->Uniform(4); j > 0; --j) {
+          sparse->add_value(RandStr(rng));
+        }
+      }
+      if (!rng->OneIn(4)) {
+        Int64List* ragged = features["ragged_int64"].mutable_int64_list();
+        for (int j = rng->Uniform(6); j > 0; --j) {
+          ragged->add_value(static_cast<int64_t>(rng->Rand64()) >> 4);
+        }
+      }
+      if (!rng->OneIn(4)) {
+        FloatList* ragged = features["ragged_float"].mutable_float_list();
+        for (int j = rng->Uniform(6); j > 0; --j) {
+          ragged->add_value(rng->RandFloat());
+        }
+      }
+      serialized_example += example.SerializeAsString();
+    }
+    serialized.push_back(serialized_example);
+  }
+  return serialized;
+}
+
+FastParseExampleConfig ConfigForColumnarParsing(bool columnar) {
+  FastParseExampleConfig config;
+  config.dense.emplace_back("fixed_float", DT_FLOAT, PartialTensorShape({3}),
+                            test::AsTensor<float>({0.f, 0.f, 0.f}), false, 3);
+  config.dense.emplace_back("missing_float", DT_FLOAT, PartialTensorShape({2}),
+                            test::AsTensor<float>({1.f, 2.f}), false, 2);
+  config.dense.emplace_back("varlen_int64", DT_INT64,
+                            PartialTensorShape({-1, 2}),
+                            test::AsScalar<int64_t>(-1), true, 2);
+  config.dense.emplace_back("varlen_string", DT_STRING, PartialTensorShape({-1}),
+                            test::AsScalar<tstring>("pad"), true, 1);
+  config.sparse.emplace_back("sparse_float", DT_FLOAT);
+  config.sparse.emplace_back("sparse_string", DT_STRING);
+  config.ragged.emplace_back("ragged_int64", DT_INT64, DT_INT32);
+  config.ragged.emplace_back("ragged_float", DT_FLOAT, DT_INT64);
+  config.collect_feature_stats = true;
+  config.columnar = columnar;
+  return config;
+}
+
+void ExpectTensorsEqual(const std::vector<Tensor>& expected,
+                        const std::vector<Tensor>& actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    test::ExpectEqual(expected[i], actual[i]);
+  }
+}
+
+void ExpectResultsEqual(const Result& expected, const Result& actual) {
+  ExpectTensorsEqual(expected.dense_values, actual.dense_values);
+  ExpectTensorsEqual(expected.sparse_indices, actual.sparse_indices);
+  ExpectTensorsEqual(expected.sparse_values, actual.sparse_values);
+  ExpectTensorsEqual(expected.sparse_shapes, actual.sparse_shapes);
+  ExpectTensorsEqual(expected.ragged_values, actual.ragged_values);
+  ExpectTensorsEqual(expected.ragged_splits, actual.ragged_splits);
+  ASSERT_EQ(expected.feature_stats.size(), actual.feature_stats.size());
+  for (size_t i = 0; i < expected.feature_stats.size(); ++i) {
+    EXPECT_EQ(expected.feature_stats[i].features_count,
+              actual.feature_stats[i].features_count);
+    EXPECT_EQ(expected.feature_stats[i].feature_values_count,
+              actual.feature_stats[i].feature_values_count);
+  }
+}
+
+TEST(FastParse, ColumnarMatchesRowOriented) {
+  random::PhiloxRandom philox(1337);
+  random::SimplePhilox rng(&philox);
+  thread::ThreadPool thread_pool(Env::Default(), "test", 4);
+  for (int num_examples : {0, 1, 7, 100, 1000}) {
+    std::vector<tstring> serialized =
+        ExamplesForColumnarParsing(&rng, num_examples);
+    for (thread::ThreadPool* pool : {static_cast<thread::ThreadPool*>(nullptr),
+                                     &thread_pool}) {
+      Result expected;
+      TF_ASSERT_OK(FastParseExample(ConfigForColumnarParsing(false),
+                                    serialized, {}, pool, &expected));
+      Result actual;
+      TF_ASSERT_OK(FastParseExample(ConfigForColumnarParsing(true), serialized,
+                                    {}, pool, &actual));
+      ExpectResultsEqual(expected, actual);
+    }
+  }
+}
+
+TEST(FastParse, ColumnarPackedAndNonPacked) {
+  // The same int64 feature "age", once packed and once non-packed.
+  std::vector<tstring> serialized = {
+      "\x0a\x0e\x0a\x0c\x0a\x03\x61\x67\x65\x12\x05\x1a\x03\x0a\x01\x0d",
+      "\x0a\x0d\x0a\x0b\x0a\x03\x61\x67\x65\x12\x04\x1a\x02\x08\x0d"};
+  FastParseExampleConfig config;
+  config.sparse.emplace_back("age", DT_INT64);
+  Result expected;
+  TF_ASSERT_OK(FastParseExample(config, serialized, {}, nullptr, &expected));
+  config.columnar = true;
+  Result actual;
+  TF_ASSERT_OK(FastParseExample(config, serialized, {}, nullptr, &actual));
+  ExpectResultsEqual(expected, actual);
+  test::ExpectEqual(test::AsTensor<int64_t>({13, 13}), actual.sparse_values[0]);
+}
+
+TEST(FastParse, ColumnarErrors) {
+  Example example;
+  auto& features = *example.mutable_features()->mutable_feature();
+  features["varlen"].mutable_int64_list()->add_value(1);
+  std::vector<tstring> serialized = {Serialize(example)};
+
+  // Three values per stride, but the example only has one.
+  FastParseExampleConfig config;
+  config.columnar = true;
+  config.dense.emplace_back("varlen", DT_INT64, PartialTensorShape({-1, 3}),
+                            test::AsScalar<int64_t>(0), true, 3);
+  Result result;
+  Status status = FastParseExample(config, serialized, {}, nullptr, &result);
+  EXPECT_TRUE(errors::IsInvalidArgument(status)) << status;
+  EXPECT_THAT(status.error_message(),
+              ::testing::HasSubstr("not a multiple of stride length"));
+
+  // Mismatched data type.
+  config.dense.clear();
+  config.sparse.emplace_back("varlen", DT_FLOAT);
+  status = FastParseExample(config, serialized, {}, nullptr, &result);
+  EXPECT_TRUE(errors::IsInvalidArgument(status)) << status;
+  EXPECT_THAT(status.error_message(),
+              ::testing::HasSubstr("Data types don't match"));
+}
+
 TEST(TestFastParseExample, Empty) {
   Result result;
   FastParseExampleConfig config;
@@ -423,6 +591,36 @@ TEST(TestFastParseExample, Empty) {
   EXPECT_TRUE(status.ok()) << status;
 }
 
+void BM_FastParseExample(::testing::benchmark::State& state) {
+  const bool columnar = state.range(0);
+  const int batch_size = state.range(1);
+  random::PhiloxRandom philox(1337);
+  random::SimplePhilox rng(&philox);
+  std::vector<tstring> serialized =
+      ExamplesForColumnarParsing(&rng, batch_size);
+  FastParseExampleConfig config = ConfigForColumnarParsing(columnar);
+  config.collect_feature_stats = false;
+  thread::ThreadPool thread_pool(Env::Default(), "bm", 4);
+
+  int64_t num_bytes = 0;
+  for (const tstring& s : serialized) num_bytes += s.size();
+  for (auto s : state) {
+    Result result;
+    TF_CHECK_OK(
+        FastParseExample(config, serialized, {}, &thread_pool, &result));
+  }
+  state.SetBytesProcessed(state.iterations() * num_bytes);
+}
+
+BENCHMARK(BM_FastParseExample)
+    ->UseRealTime()
+    ->ArgPair(false, 128)
+    ->ArgPair(true, 128)
+    ->ArgPair(false, 1024)
+    ->ArgPair(true, 1024)
+    ->ArgPair(false, 8192)
+    ->ArgPair(true, 8192);
+
 }  // namespace
 }  // namespace example
 }  // namespace tensorflow
@@ -21,6 +21,8 @@ limitations under the License.
 #include <memory>
 #include <utility>
 
+#include "absl/memory/memory.h"
+#include "tensorflow/core/framework/allocation_description.pb.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
@@ -70,6 +72,32 @@ const char* const kHeaderEntryKey = "";
 
 namespace {
 
+// A read-only buffer of tensor data in a memory-mapped data file.  Keeps the
+// data file mapped for as long as it is referenced.
+class MappedTensorBuffer : public TensorBuffer {
+ public:
+  MappedTensorBuffer(std::shared_ptr<ReadOnlyMemoryRegion> region,
+                     const char* data, size_t size)
+      : TensorBuffer(const_cast<char*>(data)),
+        region_(std::move(region)),
+        size_(size) {}
+
+  size_t size() const override { return size_; }
+  TensorBuffer* root_buffer() override { return this; }
+  void FillAllocationDescription(AllocationDescription* proto) const override {
+    proto->set_requested_bytes(size_);
+    proto->set_allocator_name("mmap");
+  }
+  bool GetAllocatedBytes(size_t* out_bytes) const override { return false; }
+
+  // Prevents input forwarding from mutating the read-only mapping.
+  bool OwnsMemory() const override { return false; }
+
+ private:
+  const std::shared_ptr<ReadOnlyMemoryRegion> region_;
+  const size_t size_;
+};
+
 // Reads "num_elements" string elements from file[offset, offset+size) into the
 // length-N "destination".  Discards the original content of "destination".
 //
@@ -409,10 +437,49 @@ Status PadAlignment(FileOutputBuffer* out, int alignment, int64_t* size) {
   return status;
 }
 
+// Appends the contents of "val" to "out", followed by zeros up to the next
+// multiple of "alignment".  "size" is the current size of "out" and is updated
+// to the new size.  Sets the offset, size and crc32c of "entry".
+Status AppendTensor(const Tensor& val, int alignment, FileOutputBuffer* out,
+                    int64_t* size, BundleEntryProto* entry) {
+  entry->set_offset(*size);
+
+  size_t data_bytes_written = 0;
+  uint32 crc32c = 0;
+  out->clear_crc32c();
+  if (val.dtype() == DT_STRING) {
+    TF_RETURN_IF_ERROR(
+        WriteStringTensor(val, out, &data_bytes_written, &crc32c));
+  } else if (val.dtype() == DT_VARIANT) {
+    TF_RETURN_IF_ERROR(
+        WriteVariantTensor(val, out, &data_bytes_written, &crc32c));
+  } else {
+    TF_RETURN_IF_ERROR(WriteTensor(val, out, &data_bytes_written));
+    crc32c = out->crc32c();
+  }
+
+  entry->set_size(data_bytes_written);
+  entry->set_crc32c(crc32c::Mask(crc32c));
+  *size += data_bytes_written;
+  return PadAlignment(out, alignment, size);
+}
+
 }  // namespace
 
 BundleWriter::BundleWriter(Env* env, StringPiece prefix, const Options& options)
-    : env_(env), options_(options), prefix_(prefix), out_(nullptr), size_(0) {
+    : env_(env),
+      options_(options),
+      prefix_(prefix),
+      out_(nullptr),
+      size_(0),
+      num_shards_(options.num_shards) {
+  if (num_shards_ < 1) {
+    status_ = errors::InvalidArgument(
+        "BundleWriter requires at least one data file, got num_shards = ",
+        num_shards_);
+    return;
+  }
+
   status_ = env_->HasAtomicMove(prefix_, &use_temp_file_);
   if (!status_.ok()) return;
 
@@ -429,6 +496,28 @@ BundleWriter::BundleWriter(Env* env, StringPiece prefix, const Options& options)
     return;
   }
 
+  if (num_shards_ > 1) {
+    for (int i = 0; i < num_shards_; ++i) {
+      auto shard = absl::make_unique<DataShard>();
+      shard->path = DataFilename(prefix_, i, num_shards_);
+      if (use_temp_file_) {
+        shard->path =
+            strings::StrCat(shard->path, ".tempstate", random::New64());
+      }
+      std::unique_ptr<WritableFile> wrapper;
+      status_ = env_->NewWritableFile(shard->path, &wrapper);
+      if (!status_.ok()) return;
+      mutex_lock l(shard->mu);
+      shard->out = absl::make_unique<FileOutputBuffer>(
+          wrapper.release(), 8 << 20 /* 8MB write buffer */);
+      shards_.push_back(std::move(shard));
+    }
+    thread_pool_ = absl::make_unique<thread::ThreadPool>(
+        env_, "bundle_writer", num_shards_);
+    VLOG(1) << "Writing to " << num_shards_ << " data files of " << prefix_;
+    return;
+  }
+
   std::unique_ptr<WritableFile> wrapper;
   status_ = env_->NewWritableFile(data_path_, &wrapper);
   if (!status_.ok()) return;
@@ -450,29 +539,72 @@ Status BundleWriter::Add(StringPiece key, const Tensor& val) {
   BundleEntryProto* entry = &entries_[key_string];
   entry->set_dtype(val.dtype());
   val.shape().AsProto(entry->mutable_shape());
+  if (!shards_.empty()) {
+    AddToShard(key_string, val, entry);
+    return status_;
+  }
   entry->set_shard_id(0);
-  entry->set_offset(size_);
 
   // Updates the data file.
-  size_t data_bytes_written = 0;
-  uint32 crc32c = 0;
-  out_->clear_crc32c();
-  if (val.dtype() == DT_STRING) {
-    status_ = WriteStringTensor(val, out_.get(), &data_bytes_written, &crc32c);
-  } else if (val.dtype() == DT_VARIANT) {
-    status_ = WriteVariantTensor(val, out_.get(), &data_bytes_written, &crc32c);
-  } else {
-    status_ = WriteTensor(val, out_.get(), &data_bytes_written);
-    crc32c = out_->crc32c();
+  status_ =
+      AppendTensor(val, options_.data_alignment, out_.get(), &size_, entry);
+  return status_;
+}
+
+void BundleWriter::AddToShard(const string& key, const Tensor& val,
+                              BundleEntryProto* entry) {
+  int shard_id = 0;
+  for (int i = 1; i < num_shards_; ++i) {
+    if (shards_[i]->assigned_bytes < shards_[shard_id]->assigned_bytes) {
+      shard_id = i;
+    }
   }
+  DataShard* shard = shards_[shard_id].get();
+  shard->assigned_bytes += val.TotalBytes();
+  entry->set_shard_id(shard_id);
+
+  // The offset, size and checksum of "entry" are filled in by FinishShards().
+  thread_pool_->Schedule([this, shard, key, val]() {
+    mutex_lock l(shard->mu);
+    if (!shard->status.ok()) return;
+    BundleEntryProto written;
+    shard->status = AppendTensor(val, options_.data_alignment,
+                                 shard->out.get(), &shard->size, &written);
+    if (shard->status.ok()) {
+      shard->written.push_back(
+          {key, written.offset(), written.size(), written.crc32c()});
+    }
+  });
+}
 
-  if (status_.ok()) {
-    entry->set_size(data_bytes_written);
-    entry->set_crc32c(crc32c::Mask(crc32c));
-    size_ += data_bytes_written;
-    status_ = PadAlignment(out_.get(), options_.data_alignment, &size_);
+Status BundleWriter::FinishShards() {
+  // Waits for the scheduled writes.
+  thread_pool_.reset();
+
+  Status status = status_;
+  for (std::unique_ptr<DataShard>& shard : shards_) {
+    mutex_lock l(shard->mu);
+    status.Update(shard->status);
+    status.Update(shard->out->Close());
+    shard->out = nullptr;
+    for (const DataShard::WrittenEntry& written : shard->written) {
+      BundleEntryProto* entry = &entries_[written.key];
+      entry->set_offset(written.offset);
+      entry->set_size(written.size);
+      entry->set_crc32c(written.masked_crc32c);
+    }
   }
-  return status_;
+  for (size_t i = 0; i < shards_.size(); ++i) {
+    const string& path = shards_[i]->path;
+    if (!status.ok()) {
+      env_->DeleteFile(path).IgnoreError();
+    } else if (use_temp_file_) {
+      status.Update(env_->RenameFile(
+          path, DataFilename(prefix_, i, num_shards_)));
+    }
+  }
+  shards_.clear();
+  return status;
 }
 
 Status BundleWriter::AddSlice(StringPiece full_tensor_key,
@@ -519,16 +651,18 @@ Status BundleWriter::AddSlice(StringPiece full_tensor_key,
 // TODO(zongheng): on metadata write failure or !status_.ok(), consider removing
 // the orphaned data file.
 Status BundleWriter::Finish() {
+  if (!shards_.empty()) {
+    status_.Update(FinishShards());
+  }
   if (out_) {
     status_.Update(out_->Close());
     out_ = nullptr;
     if (status_.ok()) {
       if (use_temp_file_) {
-        status_ =
-            Env::Default()->RenameFile(data_path_, DataFilename(prefix_, 0, 1));
+        status_ = env_->RenameFile(data_path_, DataFilename(prefix_, 0, 1));
       }
     } else {
-      Env::Default()->DeleteFile(data_path_).IgnoreError();
+      env_->DeleteFile(data_path_).IgnoreError();
     }
   }
   if (!status_.ok()) return status_;
@@ -544,7 +678,7 @@ Status BundleWriter::Finish() {
     table::TableBuilder builder(options, file.get());
     // Header entry.
     BundleHeaderProto header;
-    header.set_num_shards(1);
+    header.set_num_shards(num_shards_);
     header.set_endianness(BundleHeaderProto::LITTLE);
     if (!port::kLittleEndian) header.set_endianness(BundleHeaderProto::BIG);
     VersionDef* version = header.mutable_version();
@@ -561,10 +695,10 @@ Status BundleWriter::Finish() {
   }
   status_.Update(file->Close());
   if (!status_.ok()) {
-    Env::Default()->DeleteFile(metadata_path_).IgnoreError();
+    env_->DeleteFile(metadata_path_).IgnoreError();
     return status_;
   } else if (use_temp_file_) {
-    status_ = Env::Default()->RenameFile(metadata_path_, MetaFilename(prefix_));
+    status_ = env_->RenameFile(metadata_path_, MetaFilename(prefix_));
     if (!status_.ok()) return status_;
   }
   status_ = errors::Internal("BundleWriter is closed");
@@ -743,14 +877,24 @@ Status MergeBundles(Env* env, gtl::ArraySlice<tstring> prefixes,
 
 // Interface for reading a tensor bundle.
 
-BundleReader::BundleReader(Env* env, StringPiece prefix)
+BundleReader::BundleReader(Env* env, StringPiece prefix,
+                           const Options& options)
     : env_(env),
       prefix_(prefix),
       metadata_(nullptr),
       table_(nullptr),
       index_cache_(nullptr),
       iter_(nullptr),
+      use_mmap_(options.use_mmap),
       need_to_swap_bytes_(false) {
+  if (!use_mmap_) {
+    Status s =
+        ReadBoolFromEnvVar("TF_BUNDLE_READER_USE_MMAP", false, &use_mmap_);
+    if (!s.ok()) {
+      LOG(WARNING) << s;
+    }
+  }
+
   const string filename = MetaFilename(prefix_);
   uint64 file_size;
   status_ = env_->GetFileSize(filename, &file_size);
@@ -819,6 +963,8 @@ BundleReader::~BundleReader() {
   }
   data_.clear();
   tensor_slices_.clear();
+  // Tensors restored from the mapped data files keep them mapped.
+  mapped_data_.clear();
 }
 
 Status BundleReader::GetBundleEntryProto(StringPiece key,
@@ -842,7 +988,79 @@ Status BundleReader::GetBundleEntryProto(StringPiece key,
   return Status::OK();
 }
 
+Status BundleReader::GetMappedValue(const BundleEntryProto& entry,
+                                    Tensor* val, bool* mapped) {
+  *mapped = false;
+  DataType dtype = entry.dtype();
+  TensorShape shape(entry.shape());
+  if (val->NumElements() != 0) {
+    dtype = val->dtype();
+    shape = val->shape();
+  }
+  const size_t expected_size = DataTypeSize(dtype) * shape.num_elements();
+  if (entry.size() != expected_size) {
+    return errors::DataLoss("Invalid size in bundle entry: key ", key(),
+                            "; stored size ", entry.size(), "; expected size ",
+                            expected_size);
+  }
+
+  // Map the data file if it has not been mapped.
+  auto it = mapped_data_.find(entry.shard_id());
+  if (it == mapped_data_.end()) {
+    const string filename =
+        DataFilename(prefix_, entry.shard_id(), num_shards_);
+    std::unique_ptr<ReadOnlyMemoryRegion> region;
+    Status s = env_->NewReadOnlyMemoryRegionFromFile(filename, &region);
+    if (!s.ok()) {
+      VLOG(1) << "Unable to memory-map " << filename
+              << ", restoring its tensors by copy: " << s;
+    }
+    it = mapped_data_.emplace(entry.shard_id(), std::move(region)).first;
+  }
+  std::shared_ptr<ReadOnlyMemoryRegion> region = it->second;
+  if (region == nullptr) {
+    return Status::OK();
+  }
+  if (entry.offset() < 0 ||
+      static_cast<uint64>(entry.offset() + entry.size()) > region->length()) {
+    return errors::DataLoss("TensorBundle at ", prefix_, " shard ",
+                            entry.shard_id(), ": entry at offset ",
+                            entry.offset(), " of ", entry.size(),
+                            " bytes is out of bounds of the data file of ",
+                            region->length(), " bytes");
+  }
+  const char* data = static_cast<const char*>(region->data()) + entry.offset();
+  if (reinterpret_cast<intptr_t>(data) % EIGEN_MAX_ALIGN_BYTES != 0) {
+    return Status::OK();
+  }
+
+  // Note that this faults in the mapped pages, but as page cache rather than
+  // as anonymous memory of this process.
+  const uint32 actual_crc32c = crc32c::Value(data, entry.size());
+  if (crc32c::Unmask(entry.crc32c()) != actual_crc32c) {
+    return errors::DataLoss(
+        "TensorBundle at ", prefix_, " shard ", entry.shard_id(), " (",
+        entry.size(), " bytes): Checksum does not match: stored ",
+        strings::Printf("%08u", crc32c::Unmask(entry.crc32c())),
+        " vs. calculated on the restored bytes ", actual_crc32c);
+  }
+
+  MappedTensorBuffer* buf =
+      new MappedTensorBuffer(std::move(region), data, entry.size());
+  *val = Tensor(dtype, shape, buf);
+  buf->Unref();
+  *mapped = true;
+  return Status::OK();
+}
+
 Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
+  if (use_mmap_ && DataTypeCanUseMemcpy(entry.dtype()) &&
+      !need_to_swap_bytes_) {
+    bool mapped;
+    TF_RETURN_IF_ERROR(GetMappedValue(entry, val, &mapped));
+    if (mapped) return Status::OK();
+  }
+
   Tensor* ret = val;
   const TensorShape stored_shape(TensorShape(entry.shape()));
   if (val->NumElements() == 0) {
@@ -62,8 +62,10 @@ limitations under the License.
 #define TENSORFLOW_CORE_UTIL_TENSOR_BUNDLE_TENSOR_BUNDLE_H_
 
 #include <map>
+#include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
@@ -77,6 +79,9 @@ limitations under the License.
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/file_system.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/threadpool.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/protobuf/tensor_bundle.pb.h"
 #include "tensorflow/core/util/tensor_bundle/naming.h"
@@ -113,12 +118,22 @@ class BundleWriter {
     // Alignment, in bytes, for tensor data.
     // Must be >= 1. The default size of 1 densely packs tensors.
     int data_alignment{1};
+    // Number of data files to partition the tensors across.  Must be >= 1.
+    //
+    // If greater than 1, each added tensor is assigned to the data file with
+    // the fewest bytes assigned so far, and the data files are written (and
+    // checksummed) concurrently by a pool of "num_shards" background threads.
+    // Added tensors must then not be mutated until Finish() returns.
+    int num_shards{1};
   };
   BundleWriter(Env* env, StringPiece prefix,
                const Options& options = Options());
 
   // Adds the tensor "val" under key "key".
   // Across calls "key" must be unique but can be added in any order.
+  //
+  // When writing multiple data files, errors writing "val" are only reported
+  // by Finish().
   Status Add(StringPiece key, const Tensor& val);
 
   // Partitioned variables support.
@@ -147,6 +162,37 @@ class BundleWriter {
   Status status() const { return status_; }
 
  private:
+  // One of the data files written when writing multiple data files.
+  struct DataShard {
+    // The location of the entry written into this data file.
+    struct WrittenEntry {
+      string key;
+      int64_t offset;
+      int64_t size;
+      uint32 masked_crc32c;
+    };
+
+    string path;
+    // The number of bytes of the tensors assigned to this data file.  Only
+    // accessed by the thread calling Add().
+    int64_t assigned_bytes = 0;
+
+    mutex mu;
+    std::unique_ptr<FileOutputBuffer> out TF_GUARDED_BY(mu);
+    int64_t size TF_GUARDED_BY(mu) = 0;  // Number of bytes written into out.
+    std::vector<WrittenEntry> written TF_GUARDED_BY(mu);
+    Status status TF_GUARDED_BY(mu);
+  };
+
+  // Assigns "val" to a data file and schedules writing it.
+  // REQUIRES: !shards_.empty()
+  void AddToShard(const string& key, const Tensor& val,
+                  BundleEntryProto* entry);
+
+  // Waits for the data files to be written, closes them and fills in the
+  // entries written into them.
+  Status FinishShards();
+
   Env* const env_;  // Not owned.
   const Options options_;
   const string prefix_;
@@ -158,6 +204,13 @@ class BundleWriter {
   std::map<string, BundleEntryProto> entries_;
   Status status_;
 
+  // The number of data files written.
+  int num_shards_;
+  // When writing multiple data files, the data files, and the threads writing
+  // them.  "shards_" must outlive "thread_pool_".
+  std::vector<std::unique_ptr<DataShard>> shards_;
+  std::unique_ptr<thread::ThreadPool> thread_pool_;
+
   TF_DISALLOW_COPY_AND_ASSIGN(BundleWriter);
 };
 
@@ -183,7 +236,21 @@ Status MergeBundles(Env* env, gtl::ArraySlice<tstring> prefixes,
 // All threads accessing the same BundleReader must synchronize.
 class BundleReader {
  public:
-  BundleReader(Env* const env, StringPiece prefix);
+  struct Options {
+    Options() {}
+    // If true, the data files are memory-mapped and each restored tensor of a
+    // memcpy-able dtype whose data is suitably aligned in its data file (see
+    // `BundleWriter::Options::data_alignment`) is backed directly by the
+    // mapping instead of a copy. Such tensors are read-only: the caller must
+    // not mutate them.  Other tensors, and bundles whose data files cannot be
+    // memory-mapped, are copied as usual.
+    //
+    // Can also be enabled by setting the environment variable
+    // TF_BUNDLE_READER_USE_MMAP to true.
+    bool use_mmap{false};
+  };
+  BundleReader(Env* const env, StringPiece prefix,
+               const Options& options = Options());
   ~BundleReader();
 
   // Is ok() iff the reader construction is successful (completed the read of
@@ -216,6 +283,10 @@ class BundleReader {
   // On error, "val" may contain nonsense data.  Returns a NotFound error if
   // tensor keyed by "key" does not exist in this bundle.
   //
+  // If the tensor is restored from a memory-mapped data file (see
+  // `Options::use_mmap`), "val" is made to refer to the mapped bytes rather
+  // than being filled in place.
+  //
   // Validates the stored crc32c checksum against the restored bytes.
   // REQUIRES: status().ok()
   Status Lookup(StringPiece key, Tensor* val) TF_MUST_USE_RESULT;
@@ -276,6 +347,13 @@ class BundleReader {
   Status GetValue(const BundleEntryProto& entry,
                   Tensor* val) TF_MUST_USE_RESULT;
 
+  // Makes "val" refer to the bytes of the tensor described by "entry" in the
+  // memory-mapped data file, if possible.  Sets "*mapped" to false if the
+  // tensor must be copied instead.
+  // REQUIRES: use_mmap_
+  Status GetMappedValue(const BundleEntryProto& entry, Tensor* val,
+                        bool* mapped) TF_MUST_USE_RESULT;
+
   // Reads the slice described by "slice_spec".  The corresponding full tensor
   // has key "ful_tensor_key" and metadata proto "full_tensor_entry".
   // REQUIRES: full_tensor_entry.slices_size() > 0
@@ -295,6 +373,13 @@ class BundleReader {
   // Owned the InputBuffer objects and their underlying RandomAccessFile's.
   std::unordered_map<int32, io::InputBuffer*> data_;
 
+  // Whether to restore tensors from memory-mapped data files.
+  bool use_mmap_;
+  // The memory-mapped data files, shared with the tensors backed by them.  A
+  // null entry marks a data file that cannot be memory-mapped.
+  std::unordered_map<int32, std::shared_ptr<ReadOnlyMemoryRegion>>
+      mapped_data_;
+
   // Maps each partitioned tensor's key to its stored slices (represented in a
   // TensorSliceSet).  Populated on-demand.
   std::unordered_map<string, checkpoint::TensorSliceSet*> tensor_slices_;
@@ -15,9 +15,14 @@ limitations under the License.
 
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
 #include <random>
+#include <set>
 #include <vector>
 
+#include "tensorflow/core/framework/tensor_description.pb.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/tensor_util.h"
 #include "tensorflow/core/framework/types.pb.h"
@@ -1113,6 +1118,169 @@ TEST_F(TensorBundleAlignmentTest, AlignmentTest) {
   }
 }
 
+TEST(TensorBundleTest, MultipleDataFiles) {
+  {
+    BundleWriter::Options opts;
+    opts.num_shards = 4;
+    opts.data_alignment = 8;
+    BundleWriter writer(Env::Default(), Prefix("sharded"), opts);
+    TF_ASSERT_OK(writer.status());
+    for (int i = 0; i < 32; ++i) {
+      TF_EXPECT_OK(writer.Add(strings::StrCat("float_", i),
+                              Constant(1.f * i, TensorShape({i + 1, 3}))));
+    }
+    TF_EXPECT_OK(
+        writer.Add("strings", test::AsTensor<tstring>({"hello", "world"})));
+    TF_EXPECT_OK(writer.AddSlice("partitioned", TensorShape({4}),
+                                 TensorSlice::ParseOrDie("0,2"),
+                                 test::AsTensor<int64_t>({0, 1})));
+    TF_EXPECT_OK(writer.AddSlice("partitioned", TensorShape({4}),
+                                 TensorSlice::ParseOrDie("2,2"),
+                                 test::AsTensor<int64_t>({2, 3})));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  for (int i = 0; i < 4; ++i) {
+    TF_EXPECT_OK(
+        Env::Default()->FileExists(DataFilename(Prefix("sharded"), i, 4)));
+  }
+
+  BundleReader reader(Env::Default(), Prefix("sharded"));
+  TF_ASSERT_OK(reader.status());
+  std::set<int> shard_ids;
+  for (int i = 0; i < 32; ++i) {
+    const string key = strings::StrCat("float_", i);
+    Expect<float>(&reader, key, Constant(1.f * i, TensorShape({i + 1, 3})));
+    BundleEntryProto entry;
+    ASSERT_TRUE(entry.ParseFromString(string(reader.value())));
+    EXPECT_EQ(0, entry.offset() % 8);
+    shard_ids.insert(entry.shard_id());
+  }
+  EXPECT_EQ(4, shard_ids.size());
+  Expect<tstring>(&reader, "strings",
+                  test::AsTensor<tstring>({"hello", "world"}));
+  Expect<int64_t>(&reader, "partitioned",
+                  test::AsTensor<int64_t>({0, 1, 2, 3}));
+}
+
+TEST(TensorBundleTest, MergeMultipleDataFiles) {
+  for (const string& name : {"sharded_foo", "sharded_bar"}) {
+    BundleWriter::Options opts;
+    opts.num_shards = 3;
+    BundleWriter writer(Env::Default(), Prefix(name), opts);
+    for (int i = 0; i < 8; ++i) {
+      TF_EXPECT_OK(
+          writer.Add(strings::StrCat(name, "_", i), Constant_2x3<float>(i)));
+    }
+    TF_ASSERT_OK(writer.Finish());
+  }
+  TF_ASSERT_OK(MergeBundles(Env::Default(),
+                            {Prefix("sharded_foo"), Prefix("sharded_bar")},
+                            Prefix("sharded_merged")));
+
+  BundleReader reader(Env::Default(), Prefix("sharded_merged"));
+  TF_ASSERT_OK(reader.status());
+  for (const string& name : {"sharded_foo", "sharded_bar"}) {
+    for (int i = 0; i < 8; ++i) {
+      Expect<float>(&reader, strings::StrCat(name, "_", i),
+                    Constant_2x3<float>(i));
+    }
+  }
+}
+
+TEST(TensorBundleTest, InvalidNumDataFiles) {
+  BundleWriter::Options opts;
+  opts.num_shards = 0;
+  BundleWriter writer(Env::Default(), Prefix("no_shards"), opts);
+  EXPECT_TRUE(errors::IsInvalidArgument(writer.status()));
+}
+
+// Returns whether "t" is backed by a memory-mapped data file.
+bool IsMapped(const Tensor& t) {
+  TensorDescription desc;
+  t.FillDescription(&desc);
+  return desc.allocation_description().allocator_name() == "mmap";
+}
+
+TEST(TensorBundleTest, MmapRestore) {
+  {
+    BundleWriter::Options opts;
+    opts.data_alignment = EIGEN_MAX_ALIGN_BYTES;
+    BundleWriter writer(Env::Default(), Prefix("mmap_aligned"), opts);
+    TF_EXPECT_OK(writer.Add("foo_000", Constant_2x3<float>(0)));
+    TF_EXPECT_OK(writer.Add("foo_001", Constant_2x3<int64_t>(1)));
+    TF_EXPECT_OK(writer.Add("foo_002", Constant_2x3<double>(2)));
+    TF_EXPECT_OK(
+        writer.Add("foo_003", test::AsTensor<tstring>({"hello", "world"})));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  Tensor lookup_float, lookup_string, current;
+  {
+    BundleReader::Options opts;
+    opts.use_mmap = true;
+    BundleReader reader(Env::Default(), Prefix("mmap_aligned"), opts);
+    TF_ASSERT_OK(reader.status());
+    Expect<float>(&reader, "foo_000", Constant_2x3<float>(0));
+    Expect<int64_t>(&reader, "foo_001", Constant_2x3<int64_t>(1));
+    Expect<double>(&reader, "foo_002", Constant_2x3<double>(2));
+    Expect<tstring>(&reader, "foo_003",
+                    test::AsTensor<tstring>({"hello", "world"}));
+
+    TF_ASSERT_OK(reader.Lookup("foo_000", &lookup_float));
+    EXPECT_TRUE(IsMapped(lookup_float));
+    TF_ASSERT_OK(reader.Lookup("foo_003", &lookup_string));
+    EXPECT_FALSE(IsMapped(lookup_string));
+
+    reader.Seek("foo_001");
+    TF_ASSERT_OK(reader.ReadCurrent(&current));
+    EXPECT_TRUE(IsMapped(current));
+  }
+  // The restored tensors outlive the reader.
+  test::ExpectTensorEqual<float>(lookup_float, Constant_2x3<float>(0));
+  test::ExpectTensorEqual<tstring>(lookup_string,
+                                   test::AsTensor<tstring>({"hello", "world"}));
+  test::ExpectTensorEqual<int64_t>(current, Constant_2x3<int64_t>(1));
+}
+
+TEST(TensorBundleTest, MmapRestoreFallsBackToCopyWhenUnaligned) {
+  {
+    BundleWriter writer(Env::Default(), Prefix("mmap_unaligned"));
+    TF_EXPECT_OK(writer.Add("foo_000", Constant(true, TensorShape({1}))));
+    TF_EXPECT_OK(writer.Add("foo_001", Constant_2x3<float>(1)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  BundleReader::Options opts;
+  opts.use_mmap = true;
+  BundleReader reader(Env::Default(), Prefix("mmap_unaligned"), opts);
+  TF_ASSERT_OK(reader.status());
+  Tensor val;
+  TF_ASSERT_OK(reader.Lookup("foo_001", &val));
+  // "foo_001" is stored right after the single byte of "foo_000".
+  EXPECT_FALSE(IsMapped(val));
+  test::ExpectTensorEqual<float>(val, Constant_2x3<float>(1));
+}
+
+TEST(TensorBundleTest, MmapRestoreChecksum) {
+  {
+    BundleWriter writer(Env::Default(), Prefix("mmap_checksum"));
+    TF_EXPECT_OK(writer.Add("foo", Constant_2x3(1.f)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  const string datafile = DataFilename(Prefix("mmap_checksum"), 0, 1);
+  string data;
+  TF_ASSERT_OK(ReadFileToString(Env::Default(), datafile, &data));
+  data[0] = ~data[0];
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), datafile, data));
+
+  BundleReader::Options opts;
+  opts.use_mmap = true;
+  BundleReader reader(Env::Default(), Prefix("mmap_checksum"), opts);
+  TF_ASSERT_OK(reader.status());
+  Tensor val;
+  Status status = reader.Lookup("foo", &val);
+  EXPECT_TRUE(errors::IsDataLoss(status));
+  EXPECT_TRUE(absl::StrContains(status.ToString(), "Checksum does not match"));
+}
+
 static void BM_BundleAlignment(::testing::benchmark::State& state) {
   {
     const int alignment = state.range(0);
@@ -1164,4 +1332,87 @@ static void BM_BundleWriterLargeTensor(::testing::benchmark::State& state) {
 BENCHMARK(BM_BundleWriterLargeTensor)->Arg(1 << 10);
 BENCHMARK(BM_BundleWriterLargeTensor)->Arg(4 << 10);
 
+// Writes 16 tensors of `state.range(1)` MB each into `state.range(0)` data
+// files.
+static void BM_BundleWriterMultipleDataFiles(
+    ::testing::benchmark::State& state) {
+  const int num_shards = state.range(0);
+  const int64_t bytes = state.range(1) * (1 << 20);
+  const int kNumTensors = 16;
+  Tensor t = Constant(static_cast<int8>('a'), TensorShape{bytes});
+  BundleWriter::Options opts;
+  opts.num_shards = num_shards;
+  for (auto s : state) {
+    BundleWriter writer(Env::Default(), Prefix("multiple_data_files"), opts);
+    for (int i = 0; i < kNumTensors; ++i) {
+      TF_CHECK_OK(writer.Add(strings::StrCat("big_", i), t));
+    }
+    TF_CHECK_OK(writer.Finish());
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          kNumTensors * bytes);
+}
+
+BENCHMARK(BM_BundleWriterMultipleDataFiles)
+    ->ArgPair(1, 64)
+    ->ArgPair(4, 64)
+    ->ArgPair(16, 64);
+
+// Returns the anonymous resident memory of this process in bytes, or -1 if it
+// is unknown.
+static int64_t AnonymousRssBytes() {
+  std::ifstream status("/proc/self/status");
+  string line;
+  while (std::getline(status, line)) {
+    int64_t kb;
+    if (sscanf(line.c_str(), "RssAnon: %" SCNd64 " kB", &kb) == 1) {
+      return kb << 10;
+    }
+  }
+  return -1;
+}
+
+// Measures the time until all tensors of a bundle of `state.range(0)` tensors
+// of `state.range(1)` MB each are restored, and the anonymous memory held by
+// the restored tensors, with `state.range(2)` selecting mmap restore.
+static void BM_BundleRestore(::testing::benchmark::State& state) {
+  const int num_tensors = state.range(0);
+  const int64_t num_elements = state.range(1) * (1 << 20) / sizeof(float);
+  const string prefix = Prefix(strings::StrCat("restore_", num_tensors, "_",
+                                               state.range(1)));
+  {
+    BundleWriter::Options opts;
+    opts.data_alignment = EIGEN_MAX_ALIGN_BYTES;
+    BundleWriter writer(Env::Default(), prefix, opts);
+    for (int i = 0; i < num_tensors; ++i) {
+      TF_CHECK_OK(writer.Add(strings::StrCat("tensor_", i),
+                             Constant(1.f * i, TensorShape({num_elements}))));
+    }
+    TF_CHECK_OK(writer.Finish());
+  }
+  BundleReader::Options opts;
+  opts.use_mmap = state.range(2);
+  int64_t max_rss_increase = 0;
+  for (auto s : state) {
+    const int64_t rss_before = AnonymousRssBytes();
+    std::vector<Tensor> restored(num_tensors);
+    BundleReader reader(Env::Default(), prefix, opts);
+    TF_CHECK_OK(reader.status());
+    for (int i = 0; i < num_tensors; ++i) {
+      TF_CHECK_OK(reader.Lookup(strings::StrCat("tensor_", i), &restored[i]));
+    }
+    const int64_t rss_after = AnonymousRssBytes();
+    max_rss_increase = std::max(max_rss_increase, rss_after - rss_before);
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          num_tensors * num_elements * sizeof(float));
+  state.counters["anon_rss_increase_mb"] = max_rss_increase >> 20;
+}
+
+BENCHMARK(BM_BundleRestore)
+    ->Args({16, 64, 0})
+    ->Args({16, 64, 1})
+    ->Args({4, 512, 0})
+    ->Args({4, 512, 1});
+
 }  // namespace tensorflow
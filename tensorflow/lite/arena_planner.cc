@@ -36,13 +36,15 @@ constexpr int32_t kNodeNotAssigned = std::numeric_limits<int32_t>::max();
 
 ArenaPlanner::ArenaPlanner(TfLiteContext* context,
                            std::unique_ptr<GraphInfo> graph_info,
-                           bool preserve_all_tensors, int tensor_alignment)
+                           bool preserve_all_tensors, int tensor_alignment,
+                           int max_cached_plans)
     : context_(context),
       graph_info_(std::move(graph_info)),
       arena_(kDefaultArenaAlignment),
       persistent_arena_(kDefaultArenaAlignment),
       preserve_all_tensors_(preserve_all_tensors),
-      tensor_alignment_(tensor_alignment) {}
+      tensor_alignment_(tensor_alignment),
+      max_cached_plans_(max_cached_plans) {}
 
 ArenaPlanner::~ArenaPlanner() {}
 
@@ -61,6 +63,7 @@ TfLiteStatus ArenaPlanner::ResetAllocations() {
   TF_LITE_ENSURE_STATUS(persistent_arena_.ClearPlan());
   allocs_.clear();
   allocs_.resize(graph_info_->num_tensors());
+  plan_is_empty_ = true;
   return kTfLiteOk;
 }
 
@@ -82,6 +85,8 @@ TfLiteStatus ArenaPlanner::ResetAllocationsAfter(int node) {
 TfLiteStatus ArenaPlanner::PlanAllocations() {
   // Invalidate any existing data.
   TF_LITE_ENSURE_STATUS(ResetAllocations());
+  // The usage intervals of the tensors may change.
+  cached_plans_.clear();
   // Maybe other verb instead of 'Assigned'
   alloc_node_.assign(graph_info_->num_tensors(), kNodeNotAssigned);
   dealloc_node_.assign(graph_info_->num_tensors(), kNodeNotAssigned);
@@ -205,7 +210,18 @@ TfLiteStatus ArenaPlanner::ExecuteAllocations(int first_node, int last_node) {
     }
   }
 
-  TF_LITE_ENSURE_STATUS(CalculateAllocations(first_node, last_node));
+  // Plans starting from scratch only depend on the sizes and usage intervals
+  // of the tensors, which makes them cacheable.
+  if (max_cached_plans_ > 0 && first_node == 0 && plan_is_empty_) {
+    std::vector<int64_t> key = CreatePlanKey(last_node);
+    if (!RestoreCachedPlan(key)) {
+      TF_LITE_ENSURE_STATUS(CalculateAllocations(first_node, last_node));
+      CachePlan(std::move(key));
+    }
+  } else {
+    TF_LITE_ENSURE_STATUS(CalculateAllocations(first_node, last_node));
+  }
+  plan_is_empty_ = false;
   TF_LITE_ENSURE_STATUS(Commit());
 
   for (int i = 0; i < static_cast<int>(graph_info_->num_tensors()); ++i) {
@@ -257,6 +273,45 @@ TfLiteStatus ArenaPlanner::Commit() {
   return kTfLiteOk;
 }
 
+std::vector<int64_t> ArenaPlanner::CreatePlanKey(int last_node) const {
+  const size_t num_tensors = graph_info_->num_tensors();
+  std::vector<int64_t> key;
+  key.reserve(1 + 4 * num_tensors);
+  key.push_back(last_node);
+  for (size_t i = 0; i < num_tensors; ++i) {
+    const TfLiteTensor& tensor = *graph_info_->tensor(i);
+    key.push_back(tensor.bytes);
+    key.push_back(tensor.allocation_type);
+    key.push_back(alloc_node_[i]);
+    key.push_back(dealloc_node_[i]);
+  }
+  return key;
+}
+
+bool ArenaPlanner::RestoreCachedPlan(const std::vector<int64_t>& key) {
+  for (auto it = cached_plans_.begin(); it != cached_plans_.end(); ++it) {
+    if (it->key != key) continue;
+    allocs_ = it->allocs;
+    arena_.RestorePlan(it->arena_plan);
+    persistent_arena_.RestorePlan(it->persistent_arena_plan);
+    cached_plans_.splice(cached_plans_.begin(), cached_plans_, it);
+    return true;
+  }
+  return false;
+}
+
+void ArenaPlanner::CachePlan(std::vector<int64_t> key) {
+  if (cached_plans_.size() >= static_cast<size_t>(max_cached_plans_)) {
+    cached_plans_.pop_back();
+  }
+  CachedPlan plan;
+  plan.key = std::move(key);
+  plan.allocs = allocs_;
+  plan.arena_plan = arena_.GetPlan();
+  plan.persistent_arena_plan = persistent_arena_.GetPlan();
+  cached_plans_.push_front(std::move(plan));
+}
+
 std::vector<int32_t> ArenaPlanner::CreateTensorAllocationVector(int first_node,
                                                                 int last_node) {
   auto tensor_compare = [this](int idx1, int idx2) {
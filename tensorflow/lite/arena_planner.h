@@ -16,6 +16,7 @@ limitations under the License.
 #define TENSORFLOW_LITE_ARENA_PLANNER_H_
 
 #include <cstdint>
+#include <list>
 #include <memory>
 #include <vector>
 
@@ -43,6 +44,11 @@ struct AllocationInfo;
 // execution. Since dynamic tensors don't have sizes until after the
 // corresponding operation is executed, this class supports incremental
 // planning.
+//
+// If 'max_cached_plans' is positive, the planner remembers the allocations
+// computed for up to that many distinct sets of tensor sizes. When the sizes
+// later return to a remembered set, e.g. when the inputs alternate between a
+// few shapes, the allocations are reused instead of being recalculated.
 class ArenaPlanner : public MemoryPlanner {
  public:
   // Ownership of 'context' is not taken and it must remain util the
@@ -50,7 +56,8 @@ class ArenaPlanner : public MemoryPlanner {
   // memory with any other tensor, effectively preserving them until the end
   // of inference.
   ArenaPlanner(TfLiteContext* context, std::unique_ptr<GraphInfo> graph_info,
-               bool preserve_all_tensors, int tensor_alignment);
+               bool preserve_all_tensors, int tensor_alignment,
+               int max_cached_plans = 0);
   ~ArenaPlanner() override;
   ArenaPlanner(const ArenaPlanner&) = delete;
   ArenaPlanner& operator=(const ArenaPlanner&) = delete;
@@ -67,7 +74,32 @@ class ArenaPlanner : public MemoryPlanner {
   // Returns the base arena location for a given allocation type.
   std::intptr_t BasePointer(TfLiteAllocationType type);
 
+  // Returns the number of allocation plans currently cached.
+  int num_cached_plans() const { return cached_plans_.size(); }
+
  private:
+  // The allocations of all tensors for a set of tensor sizes, as computed by
+  // CalculateAllocations() on an empty plan.
+  struct CachedPlan {
+    // The last node planned, followed by the size, allocation type and usage
+    // interval of each tensor.
+    std::vector<int64_t> key;
+    std::vector<ArenaAllocWithUsageInterval> allocs;
+    SimpleMemoryArena::Plan arena_plan;
+    SimpleMemoryArena::Plan persistent_arena_plan;
+  };
+
+  // Returns the key identifying the allocations of nodes up to `last_node`.
+  std::vector<int64_t> CreatePlanKey(int last_node) const;
+
+  // Restores the cached plan with the given key, if any, and marks it as the
+  // most recently used. Returns true on success.
+  bool RestoreCachedPlan(const std::vector<int64_t>& key);
+
+  // Caches the current plan under `key`, evicting the least recently used
+  // plan if the cache is full.
+  void CachePlan(std::vector<int64_t> key);
+
   // Make sure all the arenas have reserved enough memory to store all their
   // tensors.
   TfLiteStatus Commit();
@@ -127,6 +159,15 @@ class ArenaPlanner : public MemoryPlanner {
 
   // Number of bytes that tensor buffers should be aligned to.
   int tensor_alignment_;
+
+  // Maximum number of cached plans. Caching is disabled if not positive.
+  int max_cached_plans_;
+
+  // Whether no allocations were made since the last ResetAllocations().
+  bool plan_is_empty_ = true;
+
+  // Cached plans, the most recently used first.
+  std::list<CachedPlan> cached_plans_;
 };
 
 }  // namespace tflite
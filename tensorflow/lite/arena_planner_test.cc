@@ -174,12 +174,13 @@ void ReportError(TfLiteContext* context, const char* format, ...) {
 
 class ArenaPlannerTest : public ::testing::Test {
  protected:
-  void SetGraph(TestGraph* graph, bool preserve_all_tensors = false) {
+  void SetGraph(TestGraph* graph, bool preserve_all_tensors = false,
+                int max_cached_plans = 0) {
     graph_ = graph;
     context_.ReportError = ReportError;
     planner_.reset(new ArenaPlanner(
         &context_, std::unique_ptr<GraphInfo>(new TestGraphInfo(graph)),
-        preserve_all_tensors, kTensorAlignment));
+        preserve_all_tensors, kTensorAlignment, max_cached_plans));
     CHECK(planner_->ResetAllocations() == kTfLiteOk);
     CHECK(planner_->PlanAllocations() == kTfLiteOk);
   }
@@ -193,6 +194,10 @@ class ArenaPlannerTest : public ::testing::Test {
     CHECK(planner_->ExecuteAllocations(start, end) == kTfLiteOk);
   }
 
+  void ResetAllocations() {
+    CHECK(planner_->ResetAllocations() == kTfLiteOk);
+  }
+
   void ReleaseNonPersistentMemory() {
     CHECK(planner_->ReleaseNonPersistentMemory() == kTfLiteOk);
   }
@@ -759,5 +764,52 @@ TEST_F(ArenaPlannerTest, DebugTensors) {
   EXPECT_EQ(tensorOffsets.size(), 8);
 }
 
+TEST_F(ArenaPlannerTest, CachedPlans) {
+  TestGraph graph({0, 1},
+                  {
+                      /* in, out, tmp */
+                      {{0, 1}, {2}, {}},
+                      {{2, 0}, {4}, {5}},
+                      {{4}, {3}, {}},
+                  },
+                  {3});
+  SetGraph(&graph, /*preserve_all_tensors=*/false, /*max_cached_plans=*/2);
+  auto offsets = [this]() {
+    std::vector<std::ptrdiff_t> offsets;
+    for (int i = 0; i < 6; ++i) offsets.push_back(GetOffset(i));
+    return offsets;
+  };
+  auto replan = [this](int input_bytes) {
+    (*graph_->tensors())[0].bytes = input_bytes;
+    ResetAllocations();
+    Execute(0, 10);
+  };
+
+  Execute(0, 10);
+  const std::vector<std::ptrdiff_t> small_offsets = offsets();
+  EXPECT_EQ(planner_->num_cached_plans(), 1);
+  replan(1000);
+  const std::vector<std::ptrdiff_t> large_offsets = offsets();
+  EXPECT_NE(small_offsets, large_offsets);
+  EXPECT_EQ(planner_->num_cached_plans(), 2);
+
+  // Returning to known sizes restores their plans.
+  replan(3);
+  EXPECT_EQ(offsets(), small_offsets);
+  replan(1000);
+  EXPECT_EQ(offsets(), large_offsets);
+  EXPECT_EQ(planner_->num_cached_plans(), 2);
+
+  // New sizes evict the least recently used plan.
+  replan(500);
+  EXPECT_EQ(planner_->num_cached_plans(), 2);
+  replan(3);
+  EXPECT_EQ(offsets(), small_offsets);
+
+  // Changing the graph invalidates the cache.
+  CHECK(planner_->PlanAllocations() == kTfLiteOk);
+  EXPECT_EQ(planner_->num_cached_plans(), 0);
+}
+
 }  // namespace
 }  // namespace tflite
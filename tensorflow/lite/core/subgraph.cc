@@ -1047,9 +1047,9 @@ TfLiteStatus Subgraph::PrepareOpsAndTensors() {
 #ifdef TFLITE_USE_SIMPLE_MEMORY_PLANNER
     memory_planner_.reset(new SimplePlanner(&context_, CreateGraphInfo()));
 #else
-    memory_planner_.reset(new ArenaPlanner(&context_, CreateGraphInfo(),
-                                           preserve_all_tensors_,
-                                           kDefaultTensorAlignment));
+    memory_planner_.reset(new ArenaPlanner(
+        &context_, CreateGraphInfo(), preserve_all_tensors_,
+        kDefaultTensorAlignment, memory_plan_cache_size_));
 #endif
     memory_planner_->PlanAllocations();
   }
@@ -1805,6 +1805,16 @@ TfLiteStatus Subgraph::PreserveAllTensorsExperimental() {
   return kTfLiteOk;
 }
 
+TfLiteStatus Subgraph::SetMemoryPlanCacheSize(int max_cached_plans) {
+  if (memory_planner_) {
+    ReportError("SetMemoryPlanCacheSize called after memory was planned. ");
+    return kTfLiteError;
+  }
+  TF_LITE_ENSURE(&context_, max_cached_plans >= 0);
+  memory_plan_cache_size_ = max_cached_plans;
+  return kTfLiteOk;
+}
+
 std::unique_ptr<GraphInfo> Subgraph::CreateGraphInfo() {
   return std::unique_ptr<GraphInfo>(new InterpreterInfo(this));
 }
@@ -240,6 +240,14 @@ class Subgraph {
   // Returns status of success or failure.
   TfLiteStatus AllocateTensors();
 
+  // Makes AllocateTensors() remember the memory plans computed for up to
+  // `max_cached_plans` distinct sets of tensor sizes, and reuse them when the
+  // sizes repeat, e.g. when the inputs alternate between a few shapes. Ops are
+  // still prepared again. Only has an effect with the arena memory planner,
+  // and must be called before memory is planned.
+  // WARNING: This is an experimental API and subject to change.
+  TfLiteStatus SetMemoryPlanCacheSize(int max_cached_plans);
+
   // Invoke the subgraph (run the whole graph in dependency order).
   //
   // NOTE: It is possible that the interpreter is not in a ready state
@@ -826,6 +834,9 @@ class Subgraph {
   // debugging.
   bool preserve_all_tensors_ = false;
 
+  // Maximum number of memory plans cached by the memory planner.
+  int memory_plan_cache_size_ = 0;
+
   // Model-metadata owned by the Interpreter.
   const std::map<std::string, std::string>* metadata_ = nullptr;
 };
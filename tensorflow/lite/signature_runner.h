@@ -119,6 +119,18 @@ class SignatureRunner {
   /// Updates allocations for all tensors, related to the given signature.
   TfLiteStatus AllocateTensors() { return subgraph_->AllocateTensors(); }
 
+  /// Makes AllocateTensors() cache the memory plans of up to
+  /// `max_cached_plans` sets of input shapes for this signature. Each
+  /// signature has its own memory arena, so switching between signatures
+  /// doesn't re-plan memory; with this cache, neither does switching back to
+  /// an input shape that was allocated before, which is useful when requests
+  /// come in a few shapes (e.g. a few batch sizes). Ops are still prepared for
+  /// the new shapes. Must be called before the first call to
+  /// AllocateTensors().
+  TfLiteStatus SetMemoryPlanCacheSize(int max_cached_plans) {
+    return subgraph_->SetMemoryPlanCacheSize(max_cached_plans);
+  }
+
   /// Invokes the signature runner (run the graph identified by the given
   /// signature in dependency order).
   TfLiteStatus Invoke();
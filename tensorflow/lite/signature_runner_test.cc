@@ -93,5 +93,44 @@ TEST(SignatureRunnerTest, TestMultiSignatures) {
   ASSERT_EQ(sub_output->data.f[2], 3);
 }
 
+TEST(SignatureRunnerTest, TestMemoryPlanCache) {
+  TestErrorReporter reporter;
+  auto model = FlatBufferModel::BuildFromFile(
+      "tensorflow/lite/testdata/multi_signatures.bin", &reporter);
+  ASSERT_TRUE(model);
+  ops::builtin::BuiltinOpResolver resolver;
+  InterpreterBuilder builder(*model, resolver);
+  std::unique_ptr<Interpreter> interpreter;
+  ASSERT_EQ(builder(&interpreter), kTfLiteOk);
+  ASSERT_NE(interpreter, nullptr);
+
+  SignatureRunner* add_runner = interpreter->GetSignatureRunner("add");
+  SignatureRunner* sub_runner = interpreter->GetSignatureRunner("sub");
+  ASSERT_NE(add_runner, nullptr);
+  ASSERT_NE(sub_runner, nullptr);
+  ASSERT_EQ(add_runner->SetMemoryPlanCacheSize(2), kTfLiteOk);
+  ASSERT_EQ(sub_runner->SetMemoryPlanCacheSize(2), kTfLiteOk);
+
+  // Alternates between signatures and between input shapes, so that the
+  // later iterations reuse the cached plans.
+  for (int i = 0; i < 6; ++i) {
+    SignatureRunner* runner = i % 2 == 0 ? add_runner : sub_runner;
+    const int size = i % 4 < 2 ? 2 : 3;
+    ASSERT_EQ(runner->ResizeInputTensor("x", {size}), kTfLiteOk);
+    ASSERT_EQ(runner->AllocateTensors(), kTfLiteOk);
+    TfLiteTensor* input = runner->input_tensor("x");
+    for (int j = 0; j < size; ++j) input->data.f[j] = j * 2 + i;
+    ASSERT_EQ(runner->Invoke(), kTfLiteOk);
+    const TfLiteTensor* output = runner->output_tensor("output_0");
+    ASSERT_EQ(output->dims->data[0], size);
+    for (int j = 0; j < size; ++j) {
+      EXPECT_EQ(output->data.f[j], j * 2 + i + (runner == add_runner ? 2 : -3));
+    }
+  }
+
+  // The cache size can't change once memory is planned.
+  EXPECT_EQ(add_runner->SetMemoryPlanCacheSize(4), kTfLiteError);
+}
+
 }  // namespace
 }  // namespace tflite
@@ -97,6 +97,21 @@ class SimpleMemoryArena {
   // again.
   TfLiteStatus ClearPlan();
 
+  // The allocation plan of an arena: the scheduled allocations, ordered by
+  // offset, and the size of the buffer they need.
+  struct Plan {
+    size_t high_water_mark = 0;
+    std::vector<ArenaAllocWithUsageInterval> ordered_allocs;
+  };
+
+  // Returns a copy of the current allocation plan.
+  Plan GetPlan() const { return {high_water_mark_, ordered_allocs_}; }
+
+  // Replaces the allocation plan with one returned by GetPlan(). As after
+  // ClearPlan(), the arena must be committed & allocations resolved before
+  // using it again.
+  TfLiteStatus RestorePlan(const Plan& plan);
+
   // This releases the underlying buffer but does not clear the allocation plan.
   // Since all associated pointers are invalidated, the arena cannot be used
   // again until Commit() is called & tensor allocations are resolved.
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/lite/tools/benchmark/benchmark_tflite_model.h"
 
+#include <algorithm>
 #include <cstdarg>
 #include <cstdint>
 #include <cstdlib>
@@ -292,6 +293,10 @@ BenchmarkParams BenchmarkTfLiteModel::DefaultParams() {
                           BenchmarkParam::Create<bool>(false));
   default_params.AddParam("print_postinvoke_state",
                           BenchmarkParam::Create<bool>(false));
+  default_params.AddParam("alternate_input_layer_shape",
+                          BenchmarkParam::Create<std::string>(""));
+  default_params.AddParam("memory_plan_cache_size",
+                          BenchmarkParam::Create<int32_t>(0));
 
   tools::ProvidedDelegateList delegate_providers(&default_params);
   delegate_providers.AddAllDelegateParams();
@@ -359,7 +364,17 @@ std::vector<Flag> BenchmarkTfLiteModel::GetFlags() {
           "print_postinvoke_state", &params_,
           "print out the interpreter internals just before benchmark completes "
           "(i.e. after all repeated Invoke calls complete). The internals will "
-          "include allocated memory size of each tensor etc.")};
+          "include allocated memory size of each tensor etc."),
+      CreateFlag<std::string>(
+          "alternate_input_layer_shape", &params_,
+          "input layer shapes to alternate with, in the format of "
+          "--input_layer_shape. Each run then resizes the inputs and "
+          "reallocates tensors before invoking, which measures the cost of "
+          "switching between input shapes."),
+      CreateFlag<int32_t>(
+          "memory_plan_cache_size", &params_,
+          "number of memory plans each subgraph caches, so that switching "
+          "back to known input shapes doesn't re-plan memory. 0 disables it.")};
 
   flags.insert(flags.end(), specific_flags.begin(), specific_flags.end());
 
@@ -395,6 +410,10 @@ void BenchmarkTfLiteModel::LogParams() {
                       "Print pre-invoke interpreter state", verbose);
   LOG_BENCHMARK_PARAM(bool, "print_postinvoke_state",
                       "Print post-invoke interpreter state", verbose);
+  LOG_BENCHMARK_PARAM(std::string, "alternate_input_layer_shape",
+                      "Alternate input shapes", verbose);
+  LOG_BENCHMARK_PARAM(int32_t, "memory_plan_cache_size",
+                      "Memory plan cache size", verbose);
 
   for (const auto& delegate_provider :
        tools::GetRegisteredDelegateProviders()) {
@@ -411,11 +430,27 @@ TfLiteStatus BenchmarkTfLiteModel::ValidateParams() {
     return kTfLiteError;
   }
 
-  return PopulateInputLayerInfo(
+  TF_LITE_ENSURE_STATUS(PopulateInputLayerInfo(
       params_.Get<std::string>("input_layer"),
       params_.Get<std::string>("input_layer_shape"),
       params_.Get<std::string>("input_layer_value_range"),
-      params_.Get<std::string>("input_layer_value_files"), &inputs_);
+      params_.Get<std::string>("input_layer_value_files"), &inputs_));
+
+  alternate_inputs_.clear();
+  const std::string alternate_shapes =
+      params_.Get<std::string>("alternate_input_layer_shape");
+  if (!alternate_shapes.empty()) {
+    if (inputs_.empty()) {
+      TFLITE_LOG(ERROR) << "--alternate_input_layer_shape requires "
+                        << "--input_layer and --input_layer_shape.";
+      return kTfLiteError;
+    }
+    TF_LITE_ENSURE_STATUS(PopulateInputLayerInfo(
+        params_.Get<std::string>("input_layer"), alternate_shapes,
+        params_.Get<std::string>("input_layer_value_range"),
+        /*value_files_string=*/"", &alternate_inputs_));
+  }
+  return kTfLiteOk;
 }
 
 uint64_t BenchmarkTfLiteModel::ComputeInputBytes() {
@@ -625,8 +660,11 @@ TfLiteStatus BenchmarkTfLiteModel::ResetInputsAndOutputs() {
         buffer.WriteToTensor(t, /*new_shape=*/nullptr);
       }
     } else {
-      std::memcpy(t->data.raw, inputs_data_[j].data.get(),
-                  inputs_data_[j].bytes);
+      // With --alternate_input_layer_shape, the input may currently be
+      // smaller or larger than the data prepared for it.
+      const size_t bytes = std::min(t->bytes, inputs_data_[j].bytes);
+      std::memcpy(t->data.raw, inputs_data_[j].data.get(), bytes);
+      std::memset(t->data.raw + bytes, 0, t->bytes - bytes);
     }
   }
 
@@ -662,6 +700,15 @@ TfLiteStatus BenchmarkTfLiteModel::Init() {
   TF_LITE_ENSURE_STATUS(LoadModel());
   TF_LITE_ENSURE_STATUS(InitInterpreter());
 
+  const int32_t memory_plan_cache_size =
+      params_.Get<int32_t>("memory_plan_cache_size");
+  if (memory_plan_cache_size > 0) {
+    for (int i = 0; i < interpreter_->subgraphs_size(); ++i) {
+      TF_LITE_ENSURE_STATUS(interpreter_->subgraph(i)->SetMemoryPlanCacheSize(
+          memory_plan_cache_size));
+    }
+  }
+
   // Install profilers if necessary right after interpreter is created so that
   // any memory allocations inside the TFLite runtime could be recorded if the
   // installed profiler profile memory usage information.
@@ -778,15 +825,7 @@ TfLiteStatus BenchmarkTfLiteModel::Init() {
     }
   }
 
-  // Resize all non-string tensors.
-  for (int j = 0; j < inputs_.size(); ++j) {
-    const InputLayerInfo& input = inputs_[j];
-    int i = interpreter_inputs[j];
-    TfLiteTensor* t = interpreter_->tensor(i);
-    if (t->type != kTfLiteString) {
-      interpreter_->ResizeInputTensor(i, input.shape);
-    }
-  }
+  TF_LITE_ENSURE_STATUS(ResizeInputTensors(inputs_));
 
   if (interpreter_->AllocateTensors() != kTfLiteOk) {
     TFLITE_LOG(ERROR) << "Failed to allocate tensors!";
@@ -839,7 +878,33 @@ BenchmarkTfLiteModel::MayCreateProfilingListener() const {
           !params_.Get<std::string>("profiling_output_csv_file").empty())));
 }
 
-TfLiteStatus BenchmarkTfLiteModel::RunImpl() { return interpreter_->Invoke(); }
+TfLiteStatus BenchmarkTfLiteModel::ResizeInputTensors(
+    const std::vector<InputLayerInfo>& inputs) {
+  // Resize all non-string tensors.
+  auto interpreter_inputs = interpreter_->inputs();
+  for (int j = 0; j < inputs.size(); ++j) {
+    const InputLayerInfo& input = inputs[j];
+    int i = interpreter_inputs[j];
+    TfLiteTensor* t = interpreter_->tensor(i);
+    if (t->type != kTfLiteString) {
+      TF_LITE_ENSURE_STATUS(interpreter_->ResizeInputTensor(i, input.shape));
+    }
+  }
+  return kTfLiteOk;
+}
+
+TfLiteStatus BenchmarkTfLiteModel::RunImpl() {
+  if (!alternate_inputs_.empty()) {
+    // Switch to the other set of input shapes, so that the measured latency
+    // includes re-allocating the tensors.
+    use_alternate_inputs_ = !use_alternate_inputs_;
+    TF_LITE_ENSURE_STATUS(ResizeInputTensors(
+        use_alternate_inputs_ ? alternate_inputs_ : inputs_));
+    TF_LITE_ENSURE_STATUS(interpreter_->AllocateTensors());
+    TF_LITE_ENSURE_STATUS(ResetInputsAndOutputs());
+  }
+  return interpreter_->Invoke();
+}
 
 }  // namespace benchmark
 }  // namespace tflite
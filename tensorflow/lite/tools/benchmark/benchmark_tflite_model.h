@@ -97,7 +97,14 @@ class BenchmarkTfLiteModel : public BenchmarkModel {
   InputTensorData LoadInputTensorData(const TfLiteTensor& t,
                                       const std::string& input_file_path);
 
+  // Resizes the inputs of the interpreter to the shapes in `inputs`.
+  TfLiteStatus ResizeInputTensors(const std::vector<InputLayerInfo>& inputs);
+
   std::vector<InputLayerInfo> inputs_;
+  // Input shapes to alternate with between runs, if any.
+  std::vector<InputLayerInfo> alternate_inputs_;
+  // Whether the interpreter inputs currently have the alternate shapes.
+  bool use_alternate_inputs_ = false;
   std::vector<InputTensorData> inputs_data_;
   std::unique_ptr<tflite::FlatBufferModel> model_;
   std::unique_ptr<tflite::Interpreter> interpreter_;
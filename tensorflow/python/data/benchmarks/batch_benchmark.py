@@ -104,6 +104,33 @@ class BatchBenchmark(benchmark_base.DatasetBenchmarkBase):
           },
           name="batch_size_%d_%s" % (batch_size, op_str))
 
+  def benchmark_batch_memory_bandwidth(self):
+    """Measures the bytes per second written into batches of images."""
+    batch_size = 64
+    image_shape = [224, 224, 3]
+    image_bytes = int(np.prod(image_shape))
+    images = np.zeros([batch_size] + image_shape, dtype=np.uint8)
+    # `from_tensor_slices` writes its elements directly into the batch. Other
+    # sources, such as `map`, copy each element into the batch as before.
+    source = dataset_ops.Dataset.from_tensor_slices(images).repeat()
+    for num_parallel_calls in [None, dataset_ops.AUTOTUNE]:
+      dataset = source.batch(
+          batch_size,
+          drop_remainder=True,
+          num_parallel_calls=num_parallel_calls)
+      op_str = "batch" if num_parallel_calls is None else "parallel_batch"
+      wall_time = self.run_benchmark(
+          dataset=dataset, num_elements=100, iters=5, warmup=True)
+      self.report_benchmark(
+          wall_time=wall_time,
+          iters=5,
+          extras={
+              "model_name": "batch.benchmark.5",
+              "parameters": "tensor_slices.%s" % op_str,
+              "bytes_per_sec": batch_size * image_bytes / wall_time,
+          },
+          name="memory_bandwidth_tensor_slices_%s" % op_str)
+
 
 if __name__ == "__main__":
   benchmark_base.test.main()
@@ -17,7 +17,10 @@
 from tensorflow.python.data.benchmarks import benchmark_base
 from tensorflow.python.data.ops import dataset_ops
 from tensorflow.python.data.ops import options as options_lib
+from tensorflow.python.framework import dtypes
+from tensorflow.python.ops import array_ops
 from tensorflow.python.ops import math_ops
+from tensorflow.python.ops import string_ops
 
 
 class OptimizationBenchmark(benchmark_base.DatasetBenchmarkBase):
@@ -125,6 +128,51 @@ class OptimizationBenchmark(benchmark_base.DatasetBenchmarkBase):
         },
         name="filter_fusion_{}_chain_length_{}".format(opt_mark, chain_length))
 
+  # This benchmark compares the performance of a map followed by a batch with
+  # and without vectorizing the map function.
+
+  def benchmark_map_vectorization(self):
+    map_fns = {
+        "cwise": lambda x: math_ops.cast(x * 2.0 + 1.0, dtypes.int64),
+        "reshape": lambda x: array_ops.reshape(math_ops.sqrt(x), [4, 4]),
+        "hash": lambda x: string_ops.string_to_hash_bucket_fast(
+            string_ops.as_string(x), 1000),
+    }
+    for fn_name, map_fn in map_fns.items():
+      for batch_size in [1, 10, 100]:
+        self._benchmark_map_vectorization(
+            fn_name, map_fn, batch_size, optimize_dataset=False)
+        self._benchmark_map_vectorization(
+            fn_name, map_fn, batch_size, optimize_dataset=True)
+
+  def _benchmark_map_vectorization(self, fn_name, map_fn, batch_size,
+                                   optimize_dataset):
+
+    dataset = dataset_ops.Dataset.from_tensors(
+        array_ops.ones([16], dtype=dtypes.float32)).repeat(None)
+    dataset = dataset.map(map_fn).batch(batch_size)
+    options = options_lib.Options()
+    options.experimental_optimization.apply_default_optimizations = False
+    options.experimental_optimization.map_vectorization = optimize_dataset
+    dataset = dataset.with_options(options)
+
+    num_batches = max(1000 // batch_size, 10)
+    wall_time = self.run_benchmark(
+        dataset=dataset, num_elements=num_batches, iters=10, warmup=True)
+    # `wall_time` is the time per batch, so report the throughput in input
+    # elements to make the results comparable across batch sizes.
+    opt_mark = "opt" if optimize_dataset else "noopt"
+    self.report_benchmark(
+        wall_time=wall_time,
+        iters=10,
+        extras={
+            "model_name": "optimize.benchmark.4",
+            "parameters": "%s.%d.%s" % (fn_name, batch_size, optimize_dataset),
+            "elements_per_sec": batch_size / wall_time,
+        },
+        name="map_vectorization_{}_{}_batch_size_{}".format(
+            opt_mark, fn_name, batch_size))
+
 
 if __name__ == "__main__":
   benchmark_base.test.main()